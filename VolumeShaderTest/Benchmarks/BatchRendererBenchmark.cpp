@@ -0,0 +1,57 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "BatchRenderer.h"
+#include <string>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+using namespace DirectX;
+
+// Images per second of an orbit batch at one thread and at every hardware thread, with a one-slot queue and with
+// the default of two jobs per thread, and the share of submits the full queue made wait. Images are handed to the
+// callback only, so disk writes stay out of the numbers.
+BENCHMARK(BatchThroughput)
+{
+	std::shared_ptr<VolumeData> volume = std::make_shared<VolumeData>();
+	GenerateFogSphereVolume(*volume, context.Size(128u, 32u));
+	uint32_t count = context.Size(64u, 4u);
+	uint32_t size = context.Size(128u, 32u);
+
+	std::vector<uint32_t> threadCounts(1, 1);
+	if (std::thread::hardware_concurrency() > 1)
+	{
+		threadCounts.push_back(std::thread::hardware_concurrency());
+	}
+	const uint32_t capacities[] = { 1, 0 };
+
+	std::string name = "BatchThroughput/" + std::to_string(count) + "x" + std::to_string(size) + "^2";
+	for (uint32_t threads : threadCounts)
+	{
+		for (uint32_t capacity : capacities)
+		{
+			BatchSettings settings;
+			settings.threadCount = threads;
+			settings.queueCapacity = capacity;
+			BatchStats stats;
+			{
+				BatchRenderer renderer(settings);
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					BatchJob job;
+					job.volume = volume;
+					job.width = job.height = size;
+					job.settings.frameIndex = i;
+					job.camera = MakeOrbitCamera(2.0f * XM_PI * i / count, 0.3f, 1.8f, 1.0f, XMFLOAT3(2.0f, 1.5f, 0.0f));
+					renderer.Submit(std::move(job));
+				}
+				renderer.WaitIdle();
+				stats = renderer.GetStats();
+			}
+
+			std::string metric = std::to_string(threads) + (threads == 1 ? " thread, queue " : " threads, queue ") +
+				(capacity == 0 ? std::to_string(2 * threads) : std::to_string(capacity));
+			Report(name.c_str(), metric.c_str(), stats.imagesPerSecond, "images/s");
+			Report(name.c_str(), (metric + " blocked").c_str(), 100.0 * stats.blockedSubmits / stats.submitted, "%");
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+// Minimal self-registering benchmark harness for the headless CMake build. Each benchmark executable
+// links BenchmarkMain.cpp and declares its measurements with BENCHMARK; --quick shrinks them to a
+// smoke run that ctest uses to keep them compiling and working, and any other argument filters by name.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+namespace VolumeShaderTest
+{
+	namespace Benchmarking
+	{
+		struct Context
+		{
+			bool quick;
+
+			// Picks the full or the --quick size of a problem.
+			template <typename T>
+			T Size(T full, T quickSize) const { return quick ? quickSize : full; }
+		};
+
+		struct Benchmark
+		{
+			const char* name;
+			void (*function)(const Context& context);
+		};
+
+		inline std::vector<Benchmark>& Registry()
+		{
+			static std::vector<Benchmark> benchmarks;
+			return benchmarks;
+		}
+
+		struct Registrar
+		{
+			Registrar(const char* name, void (*function)(const Context& context))
+			{
+				Benchmark benchmark = { name, function };
+				Registry().push_back(benchmark);
+			}
+		};
+
+		// Calls function until at least minimumSeconds have passed (one call under --quick) and returns the
+		// average seconds per call.
+		template <typename Function>
+		double SecondsPerCall(const Context& context, Function&& function, double minimumSeconds = 0.5)
+		{
+			typedef std::chrono::steady_clock Clock;
+			Clock::time_point start = Clock::now();
+			double elapsed = 0.0;
+			unsigned calls = 0;
+			do
+			{
+				function();
+				++calls;
+				elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+			} while (!context.quick && elapsed < minimumSeconds);
+			return elapsed / calls;
+		}
+
+		inline void Report(const char* benchmark, const char* metric, double value, const char* unit)
+		{
+			std::printf("%-36s %-34s %14.3f %s\n", benchmark, metric, value, unit);
+		}
+
+		inline int RunAllBenchmarks(int argc, char** argv)
+		{
+			Context context = { false };
+			const char* filter = nullptr;
+			for (int i = 1; i < argc; ++i)
+			{
+				if (std::strcmp(argv[i], "--quick") == 0)
+				{
+					context.quick = true;
+				}
+				else
+				{
+					filter = argv[i];
+				}
+			}
+
+			int failed = 0;
+			for (const Benchmark& benchmark : Registry())
+			{
+				if (filter && !std::strstr(benchmark.name, filter))
+				{
+					continue;
+				}
+
+				try
+				{
+					benchmark.function(context);
+				}
+				catch (const std::exception& e)
+				{
+					std::fprintf(stderr, "%s: unexpected exception: %s\n", benchmark.name, e.what());
+					++failed;
+				}
+			}
+			return failed == 0 ? 0 : 1;
+		}
+	}
+}
+
+#define BENCHMARK(name) \
+	static void name(const ::VolumeShaderTest::Benchmarking::Context& context); \
+	static ::VolumeShaderTest::Benchmarking::Registrar name##_registrar(#name, &name); \
+	static void name(const ::VolumeShaderTest::Benchmarking::Context& context)
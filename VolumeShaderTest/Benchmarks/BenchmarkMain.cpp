@@ -0,0 +1,6 @@
+#include "BenchmarkHarness.h"
+
+int main(int argc, char** argv)
+{
+	return VolumeShaderTest::Benchmarking::RunAllBenchmarks(argc, argv);
+}
@@ -0,0 +1,212 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "BrickContainer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+
+namespace
+{
+	DX::FilePath ToFilePath(const std::filesystem::path& path)
+	{
+#if defined(_WIN32)
+		return path.wstring();
+#else
+		return path.string();
+#endif
+	}
+
+	// 12-bit scanner-like data: a smooth radial falloff, with noise of the given amplitude on top.
+	std::vector<uint16_t> MakeVolume(uint32_t size, int noise)
+	{
+		std::vector<uint16_t> voxels(static_cast<size_t>(size) * size * size);
+		std::mt19937 random(5);
+		std::uniform_int_distribution<int> jitter(-noise, noise);
+		float center = (size - 1) * 0.5f;
+		size_t i = 0;
+		for (uint32_t z = 0; z < size; ++z)
+		{
+			for (uint32_t y = 0; y < size; ++y)
+			{
+				for (uint32_t x = 0; x < size; ++x)
+				{
+					float dx = x - center, dy = y - center, dz = z - center;
+					float radius = std::sqrt(dx * dx + dy * dy + dz * dz) / center;
+					int value = static_cast<int>(4095.0f * std::max(0.0f, 1.0f - radius)) + (noise > 0 ? jitter(random) : 0);
+					voxels[i++] = static_cast<uint16_t>(std::min(4095, std::max(0, value)));
+				}
+			}
+		}
+		return voxels;
+	}
+
+	// Copies every brickSize^3 brick out of the volume, x fastest, as WriteBrickContainer lays them out.
+	std::vector<std::vector<uint16_t>> SplitBricks(const std::vector<uint16_t>& voxels, uint32_t size, uint32_t brickSize)
+	{
+		std::vector<std::vector<uint16_t>> bricks;
+		for (uint32_t bz = 0; bz < size; bz += brickSize)
+		{
+			for (uint32_t by = 0; by < size; by += brickSize)
+			{
+				for (uint32_t bx = 0; bx < size; bx += brickSize)
+				{
+					std::vector<uint16_t> brick;
+					brick.reserve(static_cast<size_t>(brickSize) * brickSize * brickSize);
+					for (uint32_t z = 0; z < brickSize; ++z)
+					{
+						for (uint32_t y = 0; y < brickSize; ++y)
+						{
+							const uint16_t* row = &voxels[(static_cast<size_t>(bz + z) * size + by + y) * size + bx];
+							brick.insert(brick.end(), row, row + brickSize);
+						}
+					}
+					bricks.push_back(std::move(brick));
+				}
+			}
+		}
+		return bricks;
+	}
+}
+
+// Encode and decode throughput of 32^3 bricks, in MB/s of 16-bit voxels, and the compression ratio for each
+// filter combination, on smooth data and on the same data with +-32 of noise.
+BENCHMARK(BrickCodecThroughput)
+{
+	const uint32_t brickSize = 32;
+	uint32_t size = context.Size(256u, 64u);
+	const struct { const char* name; uint8_t filters; } filterSets[] =
+	{
+		{ "none", BrickFilterNone },
+		{ "delta", BrickFilterDelta },
+		{ "bitplane", BrickFilterBitPlane },
+		{ "delta+bitplane", BrickFilterDelta | BrickFilterBitPlane },
+	};
+
+	for (int noise : { 0, 32 })
+	{
+		std::vector<std::vector<uint16_t>> bricks = SplitBricks(MakeVolume(size, noise), size, brickSize);
+		size_t brickVoxels = bricks[0].size();
+		double megabytes = bricks.size() * brickVoxels * sizeof(uint16_t) / 1e6;
+
+		for (const auto& filterSet : filterSets)
+		{
+			std::vector<std::vector<uint8_t>> encoded(bricks.size());
+			std::vector<BrickCodec> codecs(bricks.size());
+			double encodeSeconds = SecondsPerCall(context, [&]()
+			{
+				for (size_t i = 0; i < bricks.size(); ++i)
+				{
+					encoded[i].clear();
+					codecs[i] = CompressBrick(bricks[i].data(), brickVoxels, filterSet.filters, encoded[i]);
+				}
+			});
+
+			size_t compressedBytes = 0;
+			for (const std::vector<uint8_t>& brick : encoded)
+			{
+				compressedBytes += brick.size();
+			}
+
+			std::vector<uint16_t> decoded(brickVoxels);
+			std::vector<uint8_t> scratch;
+			bool decodes = true;
+			double decodeSeconds = SecondsPerCall(context, [&]()
+			{
+				for (size_t i = 0; i < bricks.size(); ++i)
+				{
+					decodes = DecompressBrick(encoded[i].data(), encoded[i].size(), codecs[i], filterSet.filters, decoded.data(), brickVoxels, scratch) && decodes;
+				}
+			});
+
+			// Checked outside the timed loop, so the numbers stay decode only.
+			std::string name = std::string("BrickCodec/") + (noise ? "noisy/" : "smooth/") + filterSet.name;
+			for (size_t i = 0; i < bricks.size() && decodes; ++i)
+			{
+				decodes = DecompressBrick(encoded[i].data(), encoded[i].size(), codecs[i], filterSet.filters, decoded.data(), brickVoxels, scratch) &&
+					decoded == bricks[i];
+			}
+			if (!decodes)
+			{
+				throw std::runtime_error(name + " does not round trip");
+			}
+
+			Report(name.c_str(), "encode", megabytes / encodeSeconds, "MB/s");
+			Report(name.c_str(), "decode", megabytes / decodeSeconds, "MB/s");
+			Report(name.c_str(), "ratio", megabytes * 1e6 / compressedBytes, "x");
+		}
+	}
+}
+
+// Decoding every brick of a container through BrickContainerReader, mapped from disk, on one thread and on all
+// of them, in MB/s of decoded voxels. This is what streaming a whole volume in costs on the CPU.
+BENCHMARK(BrickContainerDecode)
+{
+	uint32_t size = context.Size(256u, 64u);
+	std::vector<uint16_t> voxels = MakeVolume(size, 32);
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "VolumeShaderTestBrickBenchmark.vsbc";
+	if (!WriteBrickContainer(ToFilePath(path), voxels.data(), size, size, size, BrickContainerSettings()))
+	{
+		throw std::runtime_error("cannot write " + path.string());
+	}
+
+	BrickContainerReader reader;
+	if (!reader.Open(ToFilePath(path)))
+	{
+		throw std::runtime_error("cannot open " + path.string());
+	}
+
+	uint32_t brickCount = reader.GetHeader().brickCount;
+	double megabytes = brickCount * reader.GetBrickVoxelCount() * sizeof(uint16_t) / 1e6;
+	std::vector<uint32_t> threadCounts(1, 1);
+	if (std::thread::hardware_concurrency() > 1)
+	{
+		threadCounts.push_back(std::thread::hardware_concurrency());
+	}
+	for (uint32_t threadCount : threadCounts)
+	{
+		std::atomic<uint32_t> failures(0);
+		double seconds = SecondsPerCall(context, [&]()
+		{
+			std::atomic<uint32_t> next(0);
+			auto decode = [&]()
+			{
+				std::vector<uint16_t> brick(reader.GetBrickVoxelCount());
+				std::vector<uint8_t> scratch;
+				for (uint32_t index = next++; index < brickCount; index = next++)
+				{
+					failures += reader.ReadBrick(index, brick.data(), scratch) ? 0 : 1;
+				}
+			};
+
+			std::vector<std::thread> workers;
+			for (uint32_t t = 1; t < threadCount; ++t)
+			{
+				workers.emplace_back(decode);
+			}
+			decode();
+			for (std::thread& worker : workers)
+			{
+				worker.join();
+			}
+		});
+
+		std::string name = "BrickContainerDecode/" + std::to_string(size) + "^3";
+		if (failures)
+		{
+			throw std::runtime_error(name + ": " + std::to_string(failures) + " bricks failed to decode");
+		}
+		std::string metric = std::to_string(threadCount) + (threadCount == 1 ? " thread" : " threads");
+		Report(name.c_str(), metric.c_str(), megabytes / seconds, "MB/s");
+	}
+
+	std::error_code ignored;
+	std::filesystem::remove(path, ignored);
+}
@@ -0,0 +1,68 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "ChannelVolume.h"
+#include <string>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+
+// Packing cost per channel count, SSE2 against the scalar loop, in GB/s of float input.
+BENCHMARK(ChannelPacking)
+{
+	ChannelVolume volume;
+	GenerateChannelVolume(volume, context.Size(256u, 32u), MaxVolumeChannels);
+	size_t voxels = volume.VoxelCount();
+
+	for (uint32_t channelCount = 2; channelCount <= MaxVolumeChannels; ++channelCount)
+	{
+		const float* planes[MaxVolumeChannels];
+		ChannelWindow windows[MaxVolumeChannels];
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			planes[c] = volume.channels[c].data();
+		}
+		std::vector<uint8_t> packed(voxels * PackedChannelStride(channelCount));
+
+		double simd = SecondsPerCall(context, [&]() { PackChannels(planes, windows, channelCount, voxels, packed.data()); });
+		double scalar = SecondsPerCall(context, [&]() { PackChannelsScalar(planes, windows, channelCount, voxels, packed.data()); });
+		double inputGigabytes = voxels * channelCount * sizeof(float) / 1e9;
+
+		std::string name = "ChannelPacking/" + std::to_string(channelCount);
+		Report(name.c_str(), "PackChannels", inputGigabytes / simd, "GB/s");
+		Report(name.c_str(), "PackChannelsScalar", inputGigabytes / scalar, "GB/s");
+	}
+}
+
+// Texture memory, and bytes read to sample every channel once with trilinear filtering, for the layouts a
+// multi-channel volume could be uploaded in. Sample bytes assume eight texels per fetch and no cache reuse.
+BENCHMARK(ChannelLayoutMemory)
+{
+	uint32_t size = context.Size(512u, 64u);
+	double voxels = static_cast<double>(size) * size * size;
+	double megabytes = voxels / (1024.0 * 1024.0);
+
+	for (uint32_t channelCount = 2; channelCount <= MaxVolumeChannels; ++channelCount)
+	{
+		struct Layout
+		{
+			const char* name;
+			double bytesPerVoxel;
+		};
+		const Layout layouts[] =
+		{
+			{ "packed unorm8", static_cast<double>(PackedChannelStride(channelCount)) },
+			{ "R32_FLOAT per channel", 4.0 * channelCount },
+			{ "R8_UNORM per channel", 1.0 * channelCount },
+			{ "RGBA32_FLOAT", 16.0 },
+		};
+
+		std::string name = "ChannelLayoutMemory/" + std::to_string(size) + "^3x" + std::to_string(channelCount);
+		for (const Layout& layout : layouts)
+		{
+			std::string metric = std::string(layout.name) + " memory";
+			Report(name.c_str(), metric.c_str(), megabytes * layout.bytesPerVoxel, "MB");
+			metric = std::string(layout.name) + " per sample";
+			Report(name.c_str(), metric.c_str(), 8.0 * layout.bytesPerVoxel, "B");
+		}
+	}
+}
@@ -0,0 +1,50 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "ReferenceRaymarcher.h"
+#include <string>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+using namespace DirectX;
+
+// Milliseconds per frame of the reference raymarcher in each compositing mode, with and without the distance
+// field. MinIP and average take every sample whatever the field says; MinIP mostly stops on an empty first sample.
+BENCHMARK(CompositeModes)
+{
+	uint32_t size = context.Size(256u, 32u);
+	uint32_t resolution = context.Size(256u, 32u);
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, size);
+	DistanceField field;
+	BuildDistanceField(volume, DistanceFieldSettings(), field);
+
+	XMMATRIX world = XMMatrixRotationY(0.3f);
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.7f, -2.0f, 0.0f), XMVectorSet(0.0f, -0.1f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, 1.0f, 0.01f, 100.0f);
+	RaymarchCamera camera = MakeRaymarchCamera(world, view, projection, XMFLOAT3(0.0f, 0.7f, -2.0f), XMFLOAT3(2.0f, 1.5f, 0.0f));
+
+	const struct { const char* name; CompositeMode mode; } modes[] =
+	{
+		{ "alpha", CompositeMode::Alpha },
+		{ "mip", CompositeMode::MaximumIntensity },
+		{ "minip", CompositeMode::MinimumIntensity },
+		{ "average", CompositeMode::AverageIntensity },
+		{ "firsthit", CompositeMode::FirstHit },
+	};
+
+	std::string name = "CompositeModes/" + std::to_string(size) + "^3 " + std::to_string(resolution) + "x" + std::to_string(resolution);
+	for (const auto& entry : modes)
+	{
+		RaymarchSettings settings;
+		settings.composite = entry.mode;
+		settings.firstHitThreshold = 0.15f;
+		ReferenceImage image;
+		image.Resize(resolution, resolution);
+		double plain = SecondsPerCall(context, [&]() { ReferenceRaymarcher::Render(volume, camera, settings, image); });
+		settings.distanceField = &field;
+		double skipping = SecondsPerCall(context, [&]() { ReferenceRaymarcher::Render(volume, camera, settings, image); });
+
+		Report(name.c_str(), entry.name, plain * 1e3, "ms/frame");
+		Report(name.c_str(), (std::string(entry.name) + ", distance field").c_str(), skipping * 1e3, "ms/frame");
+	}
+}
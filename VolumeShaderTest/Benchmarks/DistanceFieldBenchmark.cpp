@@ -0,0 +1,87 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "Benchmark.h"
+#include "DistanceField.h"
+#include "ReferenceRaymarcher.h"
+#include <algorithm>
+#include <string>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+using namespace DirectX;
+
+namespace
+{
+	// A dense ball of a tenth of the volume's width off to one side, with nothing else around it.
+	void GenerateSparseVolume(VolumeData& volume, uint32_t size)
+	{
+		volume.Resize(size, size, size);
+		std::fill(volume.voxels.begin(), volume.voxels.end(), 0.0f);
+		float center = size * 0.35f;
+		float radius = size * 0.1f;
+		for (uint32_t z = 0; z < size; ++z)
+		{
+			for (uint32_t y = 0; y < size; ++y)
+			{
+				for (uint32_t x = 0; x < size; ++x)
+				{
+					float dx = x - center, dy = y - size * 0.5f, dz = z - size * 0.5f;
+					if (dx * dx + dy * dy + dz * dz < radius * radius)
+					{
+						float* voxel = volume.voxels.data() + volume.Index(x, y, z);
+						voxel[0] = voxel[1] = voxel[2] = 1.0f;
+						voxel[3] = 0.5f;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Building the field, and the samples it saves the reference raymarcher on a full and on a mostly empty volume.
+// Skipping never changes the image, so the sample count is the whole of its effect.
+BENCHMARK(EmptySpaceSkipping)
+{
+	uint32_t size = context.Size(128u, 32u);
+	uint32_t width = context.Size(256u, 32u);
+	uint32_t height = context.Size(256u, 32u);
+
+	CameraPose pose = GetDefaultBenchmarkPaths()[0].Evaluate(1.3);
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, static_cast<float>(width) / height, 0.001f, 500.0f);
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&pose.eye), XMLoadFloat3(&pose.target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	RaymarchCamera camera = MakeRaymarchCamera(XMMatrixRotationY(pose.modelRotation), view, projection, pose.eye, pose.lightPosition);
+
+	const char* scenes[] = { "fog sphere", "sparse" };
+	for (const char* scene : scenes)
+	{
+		VolumeData volume;
+		if (scene == scenes[0])
+		{
+			GenerateFogSphereVolume(volume, size);
+		}
+		else
+		{
+			GenerateSparseVolume(volume, size);
+		}
+
+		DistanceField field;
+		double build = SecondsPerCall(context, [&]() { BuildDistanceField(volume, DistanceFieldSettings(), field); });
+
+		RaymarchSettings settings;
+		ReferenceImage image;
+		image.Resize(width, height);
+		double plain = SecondsPerCall(context, [&]() { ReferenceRaymarcher::Render(volume, camera, settings, image); });
+		uint64_t plainSamples = image.samples;
+		settings.distanceField = &field;
+		double skipping = SecondsPerCall(context, [&]() { ReferenceRaymarcher::Render(volume, camera, settings, image); });
+		uint64_t skippingSamples = image.samples;
+
+		double pixels = static_cast<double>(width) * height;
+		std::string name = std::string("EmptySpaceSkipping/") + scene + " " + std::to_string(size) + "^3";
+		Report(name.c_str(), "field build", build * 1e3, "ms");
+		Report(name.c_str(), "plain", plainSamples / pixels, "samples/pixel");
+		Report(name.c_str(), "skipping", skippingSamples / pixels, "samples/pixel");
+		Report(name.c_str(), "samples saved", 100.0 * (1.0 - static_cast<double>(skippingSamples) / plainSamples), "%");
+		Report(name.c_str(), "render speedup", plain / skipping, "x");
+	}
+}
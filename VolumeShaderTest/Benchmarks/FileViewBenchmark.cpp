@@ -0,0 +1,152 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "VolumeData.h"
+#include "Common/FileView.h"
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+
+namespace
+{
+	DX::FilePath ToFilePath(const std::filesystem::path& path)
+	{
+#if defined(_WIN32)
+		return path.wstring();
+#else
+		return path.string();
+#endif
+	}
+
+	// Memory the process owns outright, leaving out file pages a mapping shares with the OS cache.
+	double PrivateMegabytes()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS_EX counters = {};
+		GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters));
+		return counters.PrivateUsage / (1024.0 * 1024.0);
+#else
+		unsigned long size = 0, resident = 0, shared = 0;
+		FILE* statm = std::fopen("/proc/self/statm", "r");
+		if (statm)
+		{
+			if (std::fscanf(statm, "%lu %lu %lu", &size, &resident, &shared) != 3)
+			{
+				resident = shared = 0;
+			}
+			std::fclose(statm);
+		}
+		return static_cast<double>(resident - shared) * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#endif
+	}
+
+	std::vector<uint8_t> ReadWholeFile(const std::filesystem::path& path)
+	{
+		std::vector<uint8_t> buffer(static_cast<size_t>(std::filesystem::file_size(path)));
+		FILE* file = std::fopen(path.string().c_str(), "rb");
+		if (file)
+		{
+			buffer.resize(std::fread(buffer.data(), 1, buffer.size(), file));
+			std::fclose(file);
+		}
+		return buffer;
+	}
+
+	uint64_t Sum(const uint8_t* data, size_t size)
+	{
+		uint64_t sum = 0;
+		for (size_t i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			memcpy(&word, data + i, sizeof(word));
+			sum += word;
+		}
+		return sum;
+	}
+}
+
+// Opening and reading a RAW volume of at least 100 MB (RGBA float, as LoadRawVolume takes) three ways: mapped
+// with OpenFileView, one read into a buffer, and a read followed by a copy, which is what ReadDataAsync did
+// through its IBuffer and DataReader. Throughput includes the open; the file is in the OS cache. Private memory
+// is measured at each path's peak: while the bytes, and for LoadRawVolume the VolumeData they fill, are alive.
+BENCHMARK(RawVolumeLoad)
+{
+	uint32_t size = context.Size(256u, 48u);
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "VolumeShaderTestFileViewBenchmark.raw";
+	{
+		VolumeData volume;
+		GenerateFogSphereVolume(volume, size);
+		FILE* file = std::fopen(path.string().c_str(), "wb");
+		if (!file)
+		{
+			std::fprintf(stderr, "cannot write %s\n", path.string().c_str());
+			return;
+		}
+		std::fwrite(volume.voxels.data(), sizeof(volume.voxels[0]), volume.voxels.size(), file);
+		std::fclose(file);
+	}
+	double gigabytes = std::filesystem::file_size(path) / 1e9;
+
+	volatile uint64_t sink = 0;
+	double mapped = SecondsPerCall(context, [&]()
+	{
+		bool valid = false;
+		DX::FileView view = DX::OpenFileView(ToFilePath(path), valid);
+		sink = sink + Sum(view.Data(), view.Size());
+	});
+	double readOnce = SecondsPerCall(context, [&]()
+	{
+		std::vector<uint8_t> bytes = ReadWholeFile(path);
+		sink = sink + Sum(bytes.data(), bytes.size());
+	});
+	double readAndCopy = SecondsPerCall(context, [&]()
+	{
+		std::vector<uint8_t> buffer = ReadWholeFile(path);
+		std::vector<uint8_t> bytes(buffer.begin(), buffer.end());
+		sink = sink + Sum(bytes.data(), bytes.size());
+	});
+
+	uint64_t megabytes = (std::filesystem::file_size(path) + (1 << 19)) >> 20;
+	std::string name = "RawVolumeLoad/" + std::to_string(megabytes) + "MB";
+	Report(name.c_str(), "mapped", gigabytes / mapped, "GB/s");
+	Report(name.c_str(), "read once", gigabytes / readOnce, "GB/s");
+	Report(name.c_str(), "read and copy", gigabytes / readAndCopy, "GB/s");
+
+	// Peak private memory, each path measured from the same baseline with everything it allocated still alive.
+	double baseline = PrivateMegabytes();
+	{
+		bool valid = false;
+		DX::FileView view = DX::OpenFileView(ToFilePath(path), valid);
+		sink = sink + Sum(view.Data(), view.Size());
+		Report(name.c_str(), "mapped private", PrivateMegabytes() - baseline, "MB");
+
+		VolumeData volume;
+		LoadRawVolume(view, size, size, size, volume);
+		Report(name.c_str(), "LoadRawVolume mapped private", PrivateMegabytes() - baseline, "MB");
+	}
+	baseline = PrivateMegabytes();
+	{
+		DX::FileView view = DX::MakeFileView(ReadWholeFile(path));
+		VolumeData volume;
+		LoadRawVolume(view, size, size, size, volume);
+		Report(name.c_str(), "LoadRawVolume read private", PrivateMegabytes() - baseline, "MB");
+	}
+	baseline = PrivateMegabytes();
+	{
+		std::vector<uint8_t> buffer = ReadWholeFile(path);
+		std::vector<uint8_t> bytes(buffer.begin(), buffer.end());
+		Report(name.c_str(), "read and copy private", PrivateMegabytes() - baseline, "MB");
+	}
+
+	std::error_code ignored;
+	std::filesystem::remove(path, ignored);
+}
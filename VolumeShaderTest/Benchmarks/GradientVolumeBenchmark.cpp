@@ -0,0 +1,41 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "GradientVolume.h"
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+
+// Sobel filtering a noisy density volume into packed gradients, in voxels per second on one thread and on one
+// thread per hardware thread.
+BENCHMARK(GradientBuild)
+{
+	uint32_t size = context.Size(192u, 32u);
+	std::vector<float> density(static_cast<size_t>(size) * size * size);
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (float& value : density)
+	{
+		value = unit(random);
+	}
+
+	uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	uint32_t threadCounts[2] = { 1, (hardwareThreads > 1) ? hardwareThreads : 1 };
+	double voxels = static_cast<double>(density.size());
+	double seconds[2] = {};
+	std::vector<uint32_t> texels;
+	for (int i = 0; i < 2; ++i)
+	{
+		GradientBuildSettings settings;
+		settings.threadCount = threadCounts[i];
+		seconds[i] = SecondsPerCall(context, [&]() { BuildGradientVolume(density.data(), 1, size, size, size, settings, texels); });
+	}
+
+	std::string name = "GradientBuild/" + std::to_string(size) + "^3";
+	std::string threads = "hardware threads (" + std::to_string(threadCounts[1]) + ")";
+	Report(name.c_str(), "1 thread", voxels / seconds[0] / 1e6, "Mvoxels/s");
+	Report(name.c_str(), threads.c_str(), voxels / seconds[1] / 1e6, "Mvoxels/s");
+	Report(name.c_str(), "speedup", seconds[0] / seconds[1], "x");
+}
@@ -0,0 +1,64 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "Isosurface.h"
+#include "VolumeData.h"
+#include <string>
+#include <thread>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+
+// Surface nets over the fog sphere's opacity in millions of triangles per second: a full extraction at one
+// thread and at every hardware thread, a threshold change that only revisits the bricks either surface
+// crosses, and joining the bricks into one mesh. Memory is what the joined mesh takes per million triangles.
+BENCHMARK(IsosurfaceExtraction)
+{
+	uint32_t size = context.Size(256u, 48u);
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, size);
+
+	std::vector<uint32_t> threadCounts(1, 1);
+	if (std::thread::hardware_concurrency() > 1)
+	{
+		threadCounts.push_back(std::thread::hardware_concurrency());
+	}
+
+	std::string name = "IsosurfaceExtraction/" + std::to_string(size) + "^3";
+	for (uint32_t threads : threadCounts)
+	{
+		IsosurfaceSettings settings;
+		settings.threadCount = threads;
+		IsosurfaceExtractor extractor(settings);
+		double full = SecondsPerCall(context, [&]()
+		{
+			extractor.SetVolume(volume.voxels.data() + 3, 4, volume.width, volume.height, volume.depth);
+			extractor.Extract(0.05f);
+		});
+		double megatriangles = extractor.GetStats().triangles / 1e6;
+		std::string metric = "full, " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+		Report(name.c_str(), metric.c_str(), megatriangles / full, "Mtri/s");
+
+		// Alternates between two thresholds so that every call has bricks to rebuild.
+		bool low = false;
+		double change = SecondsPerCall(context, [&]()
+		{
+			low = !low;
+			extractor.Extract(low ? 0.04f : 0.05f);
+		});
+		metric = "threshold change, " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+		Report(name.c_str(), metric.c_str(), (extractor.GetStats().triangles / 1e6) / change, "Mtri/s");
+	}
+
+	IsosurfaceExtractor extractor;
+	extractor.SetVolume(volume.voxels.data() + 3, 4, volume.width, volume.height, volume.depth);
+	extractor.Extract(0.05f);
+	IsosurfaceMesh mesh;
+	double join = SecondsPerCall(context, [&]() { extractor.BuildMesh(mesh); });
+
+	double triangles = static_cast<double>(mesh.indices.size() / 3);
+	double bytes = static_cast<double>(mesh.vertices.size() * sizeof(VertexPositionColor) + mesh.indices.size() * sizeof(uint32_t));
+	Report(name.c_str(), "triangles", triangles / 1e6, "M");
+	Report(name.c_str(), "vertices per triangle", mesh.vertices.size() / triangles, "");
+	Report(name.c_str(), "BuildMesh", (triangles / 1e6) / join, "Mtri/s");
+	Report(name.c_str(), "mesh memory", bytes / (1024.0 * 1024.0) / (triangles / 1e6), "MiB/Mtri");
+}
@@ -0,0 +1,132 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "LinearArena.h"
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+
+namespace
+{
+	uint64_t PageFaultCount()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters = {};
+		GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.PageFaultCount;
+#else
+		rusage usage = {};
+		getrusage(RUSAGE_SELF, &usage);
+		return static_cast<uint64_t>(usage.ru_minflt) + static_cast<uint64_t>(usage.ru_majflt);
+#endif
+	}
+
+	// Writes every element once, as a volume generator or loader does.
+	template <typename Vector>
+	void FillOnce(Vector& voxels)
+	{
+		for (size_t i = 0; i < voxels.size(); ++i)
+		{
+			voxels[i] = static_cast<float>(i & 255);
+		}
+	}
+
+	struct FillResult
+	{
+		double seconds;
+		double faultsPerCall;
+	};
+
+	template <typename Function>
+	FillResult Measure(const Context& context, Function&& function)
+	{
+		uint64_t faultsBefore = PageFaultCount();
+		uint64_t calls = 0;
+		double seconds = SecondsPerCall(context, [&]() { function(); ++calls; });
+		FillResult result = { seconds, static_cast<double>(PageFaultCount() - faultsBefore) / calls };
+		return result;
+	}
+}
+
+// A volume buffer allocated and written once, the way a load fills VolumeData: a heap vector zero-fills on
+// resize and then gets written, while an arena vector skips the zero-fill and only takes the page faults of its
+// first write. Every call allocates fresh memory, so each one pays its faults.
+BENCHMARK(VolumeBufferFill)
+{
+	size_t floats = context.Size<size_t>(64u * 1024 * 1024, 1024 * 1024);
+	double gigabytes = floats * sizeof(float) / 1e9;
+
+	FillResult heap = Measure(context, [&]()
+	{
+		std::vector<float> voxels(floats);
+		FillOnce(voxels);
+	});
+	FillResult heapZeroOnly = Measure(context, [&]()
+	{
+		std::vector<float> voxels(floats);
+		volatile float sink = voxels[floats / 2];
+		(void)sink;
+	});
+	FillResult arena = Measure(context, [&]()
+	{
+		LinearArena pages(LinearArena::DefaultBlockSize, false);
+		ArenaVector<float> voxels{ ArenaAllocator<float>(&pages) };
+		voxels.resize(floats);
+		FillOnce(voxels);
+	});
+	bool hugePagesBacked = false;
+	FillResult hugeArena = Measure(context, [&]()
+	{
+		LinearArena pages(LinearArena::DefaultBlockSize, true);
+		ArenaVector<float> voxels{ ArenaAllocator<float>(&pages) };
+		voxels.resize(floats);
+		FillOnce(voxels);
+		hugePagesBacked = pages.GetStats().hugePageBlocks > 0;
+	});
+
+	std::string name = "VolumeBufferFill/" + std::to_string(floats * sizeof(float) >> 20) + "MB";
+	Report(name.c_str(), "heap vector", heap.seconds * 1e3, "ms");
+	Report(name.c_str(), "heap vector zero-fill only", heapZeroOnly.seconds * 1e3, "ms");
+	Report(name.c_str(), "arena", arena.seconds * 1e3, "ms");
+	Report(name.c_str(), hugePagesBacked ? "arena huge pages" : "arena huge pages (not granted)", hugeArena.seconds * 1e3, "ms");
+	Report(name.c_str(), "heap vector fill rate", gigabytes / heap.seconds, "GB/s");
+	Report(name.c_str(), "arena fill rate", gigabytes / arena.seconds, "GB/s");
+	Report(name.c_str(), "heap vector faults", heap.faultsPerCall, "per call");
+	Report(name.c_str(), "arena faults", arena.faultsPerCall, "per call");
+	Report(name.c_str(), "arena huge pages faults", hugeArena.faultsPerCall, "per call");
+}
+
+// First touch of freshly committed pages, one byte per 4 KB page, with and without huge pages: the fault
+// cost every new arena block pays once.
+BENCHMARK(ArenaPageFaults)
+{
+	size_t bytes = context.Size<size_t>(256u * 1024 * 1024, 8 * 1024 * 1024);
+	size_t pages = bytes / 4096;
+
+	for (int huge = 0; huge < 2; ++huge)
+	{
+		bool granted = false;
+		FillResult result = Measure(context, [&]()
+		{
+			LinearArena arena(bytes, huge != 0);
+			uint8_t* base = static_cast<uint8_t*>(arena.Allocate(bytes, 4096));
+			for (size_t page = 0; page < pages; ++page)
+			{
+				base[page * 4096] = 1;
+			}
+			granted = arena.GetStats().hugePageBlocks > 0;
+		});
+
+		std::string name = "ArenaPageFaults/" + std::string(huge ? (granted ? "huge" : "huge (not granted)") : "4KB");
+		Report(name.c_str(), "first touch", result.seconds * 1e9 / pages, "ns per 4 KB");
+		Report(name.c_str(), "faults", result.faultsPerCall, "per call");
+		Report(name.c_str(), "fault cost", result.faultsPerCall > 0 ? result.seconds * 1e9 / result.faultsPerCall : 0.0, "ns per fault");
+	}
+}
@@ -0,0 +1,64 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "ReferenceRaymarcher.h"
+#include <cfloat>
+#include <string>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+using namespace DirectX;
+
+// The reference raymarcher over the fog sphere with an opaque plane through the middle of the box, with and without
+// ending rays at its depth. The depth is always at full resolution; the march runs at full and at half resolution.
+BENCHMARK(SceneDepthClamp)
+{
+	uint32_t size = context.Size(256u, 32u);
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, context.Size(128u, 32u));
+
+	XMMATRIX world = XMMatrixRotationY(0.3f);
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.7f, -3.0f, 0.0f), XMVectorSet(0.0f, -0.1f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, 1.0f, 0.01f, 100.0f);
+	XMMATRIX worldViewProjection = world * view * projection;
+	RaymarchCamera camera = MakeRaymarchCamera(world, view, projection, XMFLOAT3(0.0f, 0.7f, -3.0f), XMFLOAT3(2.0f, 1.5f, 0.0f));
+
+	// Rasterizes the local plane z = 0.
+	SceneDepthImage depth;
+	depth.width = depth.height = size;
+	depth.depth.assign(static_cast<size_t>(size) * size, 1.0f);
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			XMFLOAT3 origin, direction;
+			float tEntry, tExit;
+			ReferenceRaymarcher::ComputeRay(camera, x + 0.5f, y + 0.5f, size, size, origin, direction, tEntry, tExit);
+			float t = (fabsf(direction.z) > 1e-6f) ? -origin.z / direction.z : -1.0f;
+			if (t > 0.0f)
+			{
+				XMVECTOR clip = XMVector4Transform(XMVectorSet(origin.x + direction.x * t, origin.y + direction.y * t, 0.0f, 1.0f), worldViewProjection);
+				depth.depth[static_cast<size_t>(y) * size + x] = XMVectorGetZ(clip) / XMVectorGetW(clip);
+			}
+		}
+	}
+
+	const uint32_t scales[] = { 1, 2 };
+	for (uint32_t scale : scales)
+	{
+		RaymarchSettings settings;
+		ReferenceImage image;
+		image.Resize(size / scale, size / scale);
+		double plain = SecondsPerCall(context, [&]() { ReferenceRaymarcher::Render(volume, camera, settings, image); });
+		uint64_t plainSamples = image.samples;
+		settings.sceneDepth = &depth;
+		double clamped = SecondsPerCall(context, [&]() { ReferenceRaymarcher::Render(volume, camera, settings, image); });
+
+		double pixels = static_cast<double>(image.width) * image.height;
+		std::string name = "SceneDepthClamp/" + std::to_string(image.width) + "x" + std::to_string(image.height);
+		Report(name.c_str(), "plain", plainSamples / pixels, "samples/pixel");
+		Report(name.c_str(), "clamped", image.samples / pixels, "samples/pixel");
+		Report(name.c_str(), "steps skipped", image.depthSkippedSamples / pixels, "steps/pixel");
+		Report(name.c_str(), "samples saved", 100.0 * (1.0 - static_cast<double>(image.samples) / plainSamples), "%");
+		Report(name.c_str(), "render speedup", plain / clamped, "x");
+	}
+}
@@ -0,0 +1,126 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "ShaderArchive.h"
+#include "Common/FileView.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+
+namespace
+{
+	DX::FilePath ToFilePath(const std::filesystem::path& path)
+	{
+#if defined(_WIN32)
+		return path.wstring();
+#else
+		return path.string();
+#endif
+	}
+
+	bool WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& bytes)
+	{
+		FILE* file = std::fopen(path.string().c_str(), "wb");
+		if (!file)
+		{
+			return false;
+		}
+		bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+		return (std::fclose(file) == 0) && written;
+	}
+
+	// Touches every blob the way shader creation would, so neither path gets away with an unread mapping.
+	uint64_t Checksum(const uint8_t* data, size_t size)
+	{
+		uint64_t sum = 0;
+		for (size_t i = 0; i < size; i += 64)
+		{
+			sum += data[i];
+		}
+		return sum;
+	}
+}
+
+// Startup shader loading: one archive against a loose .cso per shader, with the files in the OS cache as on
+// every launch after the first. The shader count and sizes match the app's: a few small vertex and geometry
+// shaders and a couple of dozen raymarch permutations of 20 to 40 KB.
+BENCHMARK(ShaderArchiveStartup)
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "VolumeShaderTestArchiveBenchmark";
+	std::filesystem::create_directories(directory);
+
+	std::mt19937 random(11);
+	uint32_t shaderCount = context.Size(40u, 8u);
+	ShaderArchiveWriter writer;
+	std::vector<std::string> names;
+	uint64_t totalBytes = 0;
+	for (uint32_t i = 0; i < shaderCount; ++i)
+	{
+		size_t size = (i < 8) ? 2048 + random() % 4096 : 20480 + random() % 20480;
+		std::vector<uint8_t> blob(size);
+		for (uint8_t& byte : blob)
+		{
+			byte = static_cast<uint8_t>(random());
+		}
+
+		names.push_back("Shader" + std::to_string(i) + ".cso");
+		if (!WriteFile(directory / names.back(), blob))
+		{
+			std::fprintf(stderr, "cannot write %s\n", (directory / names.back()).string().c_str());
+			return;
+		}
+		writer.Add(names.back(), blob.data(), blob.size());
+		totalBytes += size;
+	}
+
+	std::string hashes = "benchmark";
+	uint64_t buildId = HashShaderArchiveKey(hashes.data(), hashes.size());
+	std::vector<uint8_t> serialized = writer.Serialize(buildId);
+	WriteFile(directory / "ShaderArchive.bin", serialized);
+
+	// Volatile so the checksums, and with them the reads, cannot be optimized away.
+	volatile uint64_t sink = 0;
+	double loose = SecondsPerCall(context, [&]()
+	{
+		for (const std::string& name : names)
+		{
+			bool valid = false;
+			DX::FileView view = DX::OpenFileView(ToFilePath(directory / name), valid);
+			sink = sink + Checksum(view.Data(), view.Size());
+		}
+	});
+
+	double archived = SecondsPerCall(context, [&]()
+	{
+		bool valid = false;
+		DX::FileView view = DX::OpenFileView(ToFilePath(directory / "ShaderArchive.bin"), valid);
+		ShaderArchiveReader reader;
+		if (reader.Open(view.Data(), view.Size(), buildId))
+		{
+			for (const std::string& name : names)
+			{
+				const uint8_t* data;
+				size_t size;
+				if (reader.Find(name, data, size))
+				{
+					sink = sink + Checksum(data, size);
+				}
+			}
+		}
+	});
+
+	// What a launch would pay to hash the shaders itself instead of reading the key baked in by the build.
+	double hashing = SecondsPerCall(context, [&]() { sink = sink + HashShaderArchiveKey(serialized.data(), serialized.size()); });
+
+	std::string name = "ShaderArchiveStartup/" + std::to_string(shaderCount);
+	Report(name.c_str(), "loose files", loose * 1e3, "ms");
+	Report(name.c_str(), "archive", archived * 1e3, "ms");
+	Report(name.c_str(), "hash every shader", hashing * 1e3, "ms");
+	Report(name.c_str(), "shader bytes", totalBytes / 1024.0, "KB");
+
+	std::error_code ignored;
+	std::filesystem::remove_all(directory, ignored);
+}
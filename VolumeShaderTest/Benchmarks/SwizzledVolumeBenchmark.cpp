@@ -0,0 +1,48 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "SwizzledVolume.h"
+#include <random>
+#include <string>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+
+// The 3x3x3 mean filter on the linear and the tiled Morton layout, in millions of voxels per second, plus
+// what converting between them costs. Volumes past the last level cache are where the layouts differ: the
+// linear filter streams nine rows from three slices, the tiled one reads 27 neighboring tiles.
+BENCHMARK(NeighborhoodFilter)
+{
+	const uint32_t fullSizes[] = { 64, 128, 256 };
+	const uint32_t quickSizes[] = { 32 };
+	const uint32_t* sizes = context.quick ? quickSizes : fullSizes;
+	size_t sizeCount = context.quick ? 1 : 3;
+
+	for (size_t s = 0; s < sizeCount; ++s)
+	{
+		uint32_t size = sizes[s];
+		size_t voxels = static_cast<size_t>(size) * size * size;
+		std::vector<float> source(voxels);
+		std::mt19937 random(9);
+		std::uniform_real_distribution<float> values(0.0f, 1.0f);
+		for (float& voxel : source)
+		{
+			voxel = values(random);
+		}
+
+		std::vector<float> linearResult(voxels);
+		double linear = SecondsPerCall(context, [&]() { BoxFilter3x3x3(source.data(), size, size, size, linearResult.data()); });
+
+		TiledVolume<float> tiledSource, tiledResult;
+		double toTiled = SecondsPerCall(context, [&]() { tiledSource.FromLinear(source.data(), size, size, size); });
+		double tiled = SecondsPerCall(context, [&]() { BoxFilter3x3x3(tiledSource, tiledResult); });
+		double toLinear = SecondsPerCall(context, [&]() { tiledResult.ToLinear(linearResult.data()); });
+
+		std::string name = "NeighborhoodFilter/" + std::to_string(size) + "^3";
+		double megavoxels = voxels / 1e6;
+		Report(name.c_str(), "linear", megavoxels / linear, "Mvoxel/s");
+		Report(name.c_str(), "tiled", megavoxels / tiled, "Mvoxel/s");
+		Report(name.c_str(), "tiled speedup", linear / tiled, "x");
+		Report(name.c_str(), "FromLinear", megavoxels / toTiled, "Mvoxel/s");
+		Report(name.c_str(), "ToLinear", megavoxels / toLinear, "Mvoxel/s");
+	}
+}
@@ -0,0 +1,97 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "VolumeCulling.h"
+#include <algorithm>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+using namespace DirectX;
+
+namespace
+{
+	// The unit volume split into bricksPerAxis^3 bricks, as the renderer lays them out.
+	std::vector<VolumeBrickBounds> MakeBrickGrid(uint32_t bricksPerAxis)
+	{
+		std::vector<VolumeBrickBounds> bricks;
+		float size = 1.0f / bricksPerAxis;
+		for (uint32_t z = 0; z < bricksPerAxis; ++z)
+		{
+			for (uint32_t y = 0; y < bricksPerAxis; ++y)
+			{
+				for (uint32_t x = 0; x < bricksPerAxis; ++x)
+				{
+					VolumeBrickBounds brick =
+					{
+						XMFLOAT3((x + 0.5f) * size - 0.5f, (y + 0.5f) * size - 0.5f, (z + 0.5f) * size - 0.5f),
+						XMFLOAT3(0.5f * size, 0.5f * size, 0.5f * size)
+					};
+					bricks.push_back(brick);
+				}
+			}
+		}
+		return bricks;
+	}
+
+	// Close enough that part of the volume is off screen, so the frustum test has work to reject.
+	XMMATRIX BenchmarkViewProjection()
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.3f, 0.2f, -0.9f, 1.0f), XMVectorSet(0.3f, 0.2f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, 16.0f / 9.0f, 0.01f, 100.0f);
+		return XMMatrixMultiply(view, projection);
+	}
+
+	void ReportCull(const char* name, const CullingStats& stats, size_t count, double seconds)
+	{
+		Report(name, "boxes per microsecond", count / (seconds * 1e6), "boxes/us");
+		Report(name, "frustum culled", 100.0 * stats.frustumCulled / count, "%");
+		Report(name, "occlusion culled", 100.0 * stats.occlusionCulled / count, "%");
+	}
+}
+
+BENCHMARK(FrustumCulling)
+{
+	std::vector<VolumeBrickBounds> bricks = MakeBrickGrid(context.Size(32u, 8u));
+	std::vector<uint8_t> visibility(bricks.size());
+	VolumeCuller culler;
+	culler.SetWorldViewProjection(BenchmarkViewProjection());
+
+	CullingStats stats = {};
+	double seconds = SecondsPerCall(context, [&]()
+	{
+		stats = culler.Cull(bricks.data(), bricks.size(), visibility.data(), nullptr);
+	});
+	ReportCull("FrustumCulling", stats, bricks.size(), seconds);
+}
+
+BENCHMARK(FrustumAndHiZCulling)
+{
+	std::vector<VolumeBrickBounds> bricks = MakeBrickGrid(context.Size(32u, 8u));
+	std::vector<uint8_t> visibility(bricks.size());
+	XMMATRIX viewProjection = BenchmarkViewProjection();
+	VolumeCuller culler;
+	culler.SetWorldViewProjection(viewProjection);
+
+	// A 1920x1080 depth buffer with a near wall over its left half, reduced to 1/16 as the renderer does.
+	const uint32_t depthWidth = 1920;
+	const uint32_t depthHeight = 1080;
+	std::vector<float> depth(depthWidth * depthHeight, 1.0f);
+	for (uint32_t y = 0; y < depthHeight; ++y)
+	{
+		std::fill(depth.begin() + y * depthWidth, depth.begin() + y * depthWidth + depthWidth / 2, 0.1f);
+	}
+	HiZOcclusionBuffer occlusion;
+	occlusion.Resize(depthWidth / 16, depthHeight / 16);
+
+	double buildSeconds = SecondsPerCall(context, [&]()
+	{
+		occlusion.BuildFromDepth(depth.data(), depthWidth, depthHeight, viewProjection);
+	});
+	Report("FrustumAndHiZCulling", "BuildFromDepth 1920x1080", buildSeconds * 1e3, "ms");
+
+	CullingStats stats = {};
+	double seconds = SecondsPerCall(context, [&]()
+	{
+		stats = culler.Cull(bricks.data(), bricks.size(), visibility.data(), &occlusion);
+	});
+	ReportCull("FrustumAndHiZCulling", stats, bricks.size(), seconds);
+}
@@ -0,0 +1,87 @@
+﻿#include "pch.h"
+#include "BenchmarkHarness.h"
+#include "VolumeEditing.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+using namespace VolumeShaderTest;
+using namespace VolumeShaderTest::Benchmarking;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	double Median(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values[values.size() / 2];
+	}
+}
+
+// What a user waits for between a dab, an undo or a redo and the frame that shows it, on the fog sphere at 512^3
+// (the size the journal was designed for). Each dab is applied and committed, then undone and committed, then
+// redone and committed; Commit refreshes the mips, gradients and distance field over the touched boxes. Medians
+// over dabs spread along x, so no two dabs share bricks.
+BENCHMARK(EditLatency)
+{
+	uint32_t size = context.Size(512u, 64u);
+	VolumeEditor editor;
+	Clock::time_point start = Clock::now();
+	GenerateFogSphereVolume(editor.GetVolume(), size);
+	editor.Rebuild();
+	std::string name = "EditLatency/" + std::to_string(size) + "^3";
+	Report(name.c_str(), "generate and rebuild", MillisecondsSince(start), "ms");
+
+	const float fullRadii[] = { 4.0f, 8.0f, 16.0f, 32.0f };
+	const float quickRadii[] = { 4.0f };
+	const float* radii = context.quick ? quickRadii : fullRadii;
+	size_t radiusCount = context.quick ? 1 : 4;
+	uint32_t dabs = context.Size(9u, 2u);
+
+	for (size_t r = 0; r < radiusCount; ++r)
+	{
+		float radius = radii[r];
+		std::vector<double> apply, commit, undo, redo;
+		for (uint32_t i = 0; i < dabs; ++i)
+		{
+			VolumeBrush brush;
+			brush.center = DirectX::XMFLOAT3(size * (i + 1.0f) / (dabs + 1.0f), size * 0.5f, size * 0.5f);
+			brush.extents = DirectX::XMFLOAT3(radius, radius, radius);
+			VolumeEditChanges changes;
+
+			start = Clock::now();
+			editor.Apply(brush);
+			apply.push_back(MillisecondsSince(start));
+			start = Clock::now();
+			editor.Commit(changes);
+			commit.push_back(MillisecondsSince(start));
+
+			start = Clock::now();
+			editor.Undo();
+			editor.Commit(changes);
+			undo.push_back(MillisecondsSince(start));
+
+			start = Clock::now();
+			editor.Redo();
+			editor.Commit(changes);
+			redo.push_back(MillisecondsSince(start));
+		}
+
+		std::string metric = "r=" + std::to_string(static_cast<int>(radius)) + " ";
+		Report(name.c_str(), (metric + "apply").c_str(), Median(apply), "ms");
+		Report(name.c_str(), (metric + "commit").c_str(), Median(commit), "ms");
+		Report(name.c_str(), (metric + "apply + commit").c_str(), Median(apply) + Median(commit), "ms");
+		Report(name.c_str(), (metric + "undo + commit").c_str(), Median(undo), "ms");
+		Report(name.c_str(), (metric + "redo + commit").c_str(), Median(redo), "ms");
+	}
+
+	EditJournalStats stats = editor.GetJournalStats();
+	Report(name.c_str(), "journal", stats.versionBytes / (1024.0 * 1024.0), "MiB");
+	Report(name.c_str(), "one snapshot", editor.GetVolume().voxels.size() * sizeof(float) / (1024.0 * 1024.0), "MiB");
+}
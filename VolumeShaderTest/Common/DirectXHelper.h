@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <ppltasks.h>	// For create_task
+#include "FileView.h"
 
 namespace DX
 {
@@ -33,6 +34,51 @@ namespace DX
 		});
 	}
 
+	// Maps a file from the app's install folder without copying it; the task fails when the file is missing.
+	// Prefer this over ReadDataAsync, which copies every byte twice on the way to its vector.
+	inline Concurrency::task<FileView> OpenFileViewAsync(const std::wstring& filename)
+	{
+		std::wstring path = std::wstring(Windows::ApplicationModel::Package::Current->InstalledLocation->Path->Data()) + L"\\" + filename;
+
+		return Concurrency::create_task([path]()
+		{
+			bool valid;
+			FileView view = OpenFileView(path, valid);
+			if (!valid)
+			{
+				throw Platform::Exception::CreateException(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+			}
+			return view;
+		});
+	}
+
+	// Maps a file from the app's local data folder; the view is empty when the file does not exist.
+	inline Concurrency::task<FileView> OpenLocalFileViewAsync(const std::wstring& filename)
+	{
+		std::wstring path = std::wstring(Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data()) + L"\\" + filename;
+
+		return Concurrency::create_task([path]()
+		{
+			bool valid;
+			return OpenFileView(path, valid);
+		});
+	}
+
+	// Replaces a file in the app's local data folder.
+	inline Concurrency::task<void> WriteLocalDataAsync(const std::wstring& filename, const std::vector<byte>& data)
+	{
+		using namespace Windows::Storage;
+		using namespace Concurrency;
+
+		auto folder = ApplicationData::Current->LocalFolder;
+		auto bytes = ref new Platform::Array<byte>(const_cast<byte*>(data.data()), static_cast<unsigned int>(data.size()));
+
+		return create_task(folder->CreateFileAsync(Platform::StringReference(filename.c_str()), CreationCollisionOption::ReplaceExisting)).then([bytes] (StorageFile^ file)
+		{
+			return FileIO::WriteBytesAsync(file, bytes);
+		});
+	}
+
 	// Converts a length in device-independent pixels (DIPs) to a length in physical pixels.
 	inline float ConvertDipsToPixels(float dips, float dpi)
 	{
@@ -0,0 +1,147 @@
+﻿#include "pch.h"
+#include "FileView.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace DX;
+
+FileView FileView::Subview(size_t offset, size_t size) const
+{
+	offset = (offset < m_size) ? offset : m_size;
+	size = (size < m_size - offset) ? size : m_size - offset;
+	return FileView(m_data + offset, size, m_owner, m_mapped);
+}
+
+FileView DX::MakeFileView(std::vector<uint8_t>&& buffer)
+{
+	auto owner = std::make_shared<std::vector<uint8_t>>(std::move(buffer));
+	return FileView(owner->data(), owner->size(), owner, false);
+}
+
+#if defined(_WIN32)
+
+FileView DX::OpenFileView(const FilePath& path, bool& valid)
+{
+	valid = false;
+
+	HANDLE file = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return FileView();
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) > SIZE_MAX)
+	{
+		CloseHandle(file);
+		return FileView();
+	}
+
+	size_t size = static_cast<size_t>(fileSize.QuadPart);
+	if (size == 0)
+	{
+		// Empty files cannot be mapped.
+		CloseHandle(file);
+		valid = true;
+		return FileView();
+	}
+
+	// The view keeps the mapping alive, so both handles can be closed once it exists.
+	HANDLE mapping = CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr);
+	void* view = (mapping != nullptr) ? MapViewOfFileFromApp(mapping, FILE_MAP_READ, 0, 0) : nullptr;
+	if (mapping != nullptr)
+	{
+		CloseHandle(mapping);
+	}
+
+	if (view != nullptr)
+	{
+		CloseHandle(file);
+		valid = true;
+		std::shared_ptr<const void> owner(view, [](const void* address) { UnmapViewOfFile(address); });
+		return FileView(static_cast<const uint8_t*>(view), size, owner, true);
+	}
+
+	// Mapping can fail on some file systems; read the file once instead.
+	std::vector<uint8_t> buffer(size);
+	size_t offset = 0;
+	while (offset < size)
+	{
+		DWORD chunk = static_cast<DWORD>((size - offset < 0x40000000) ? size - offset : 0x40000000);
+		DWORD read = 0;
+		if (!ReadFile(file, buffer.data() + offset, chunk, &read, nullptr) || read == 0)
+		{
+			CloseHandle(file);
+			return FileView();
+		}
+		offset += read;
+	}
+
+	CloseHandle(file);
+	valid = true;
+	return MakeFileView(std::move(buffer));
+}
+
+#else
+
+FileView DX::OpenFileView(const FilePath& path, bool& valid)
+{
+	valid = false;
+
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return FileView();
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		return FileView();
+	}
+
+	size_t size = static_cast<size_t>(status.st_size);
+	if (size == 0)
+	{
+		close(file);
+		valid = true;
+		return FileView();
+	}
+
+	void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (view != MAP_FAILED)
+	{
+		close(file);
+		valid = true;
+		std::shared_ptr<const void> owner(view, [size](const void* address) { munmap(const_cast<void*>(address), size); });
+		return FileView(static_cast<const uint8_t*>(view), size, owner, true);
+	}
+
+	// Pipes and some special files cannot be mapped; read them once instead.
+	std::vector<uint8_t> buffer(size);
+	size_t offset = 0;
+	while (offset < size)
+	{
+		ssize_t bytesRead = read(file, buffer.data() + offset, size - offset);
+		if (bytesRead <= 0)
+		{
+			close(file);
+			return FileView();
+		}
+		offset += static_cast<size_t>(bytesRead);
+	}
+
+	close(file);
+	valid = true;
+	return MakeFileView(std::move(buffer));
+}
+
+#endif
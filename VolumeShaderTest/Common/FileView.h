@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+#if defined(_WIN32)
+	typedef std::wstring FilePath;
+#else
+	typedef std::string FilePath;
+#endif
+
+	// Read-only bytes of a file plus whatever keeps them alive: a mapped view, or a buffer filled by a single
+	// read when the file cannot be mapped. Copies share the owner, so views can be passed around freely.
+	class FileView
+	{
+	public:
+		FileView() : m_data(nullptr), m_size(0), m_mapped(false) {}
+		FileView(const uint8_t* data, size_t size, std::shared_ptr<const void> owner, bool mapped) :
+			m_data(data), m_size(size), m_owner(std::move(owner)), m_mapped(mapped) {}
+
+		const uint8_t* Data() const { return m_data; }
+		size_t Size() const { return m_size; }
+		bool Empty() const { return m_size == 0; }
+		bool IsMapped() const { return m_mapped; }
+
+		// A range of this view that keeps the whole file alive; clamped to the view.
+		FileView Subview(size_t offset, size_t size) const;
+
+	private:
+		const uint8_t*				m_data;
+		size_t						m_size;
+		std::shared_ptr<const void>	m_owner;
+		bool						m_mapped;
+	};
+
+	// Maps the file read-only, falling back to one read into an owned buffer. Returns an empty view, with
+	// valid set to false, when the file cannot be opened.
+	FileView OpenFileView(const FilePath& path, bool& valid);
+
+	// Wraps an in-memory buffer without copying it.
+	FileView MakeFileView(std::vector<uint8_t>&& buffer);
+}
@@ -1,10 +1,19 @@
 ﻿#pragma once
 
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#include <stdexcept>
 #include <wrl.h>
+#else
+#include <chrono>
+#endif
 
 namespace DX
 {
-	// Helper class for animation and simulation timing.
+	// Helper class for animation and simulation timing. QueryPerformanceCounter drives it on Windows and
+	// steady_clock elsewhere.
 	class StepTimer
 	{
 	public:
@@ -17,48 +26,47 @@ namespace DX
 			m_framesThisSecond(0),
 			m_qpcSecondCounter(0),
 			m_isFixedTimeStep(false),
+			m_isDeterministic(false),
 			m_targetElapsedTicks(TicksPerSecond / 60)
 		{
-			if (!QueryPerformanceFrequency(&m_qpcFrequency))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_qpcFrequency = QueryFrequency();
+			m_qpcLastTime = QueryCounter();
 
 			// Initialize max delta to 1/10 of a second.
-			m_qpcMaxDelta = m_qpcFrequency.QuadPart / 10;
+			m_qpcMaxDelta = m_qpcFrequency / 10;
 		}
 
 		// Get elapsed time since the previous Update call.
-		uint64 GetElapsedTicks() const						{ return m_elapsedTicks; }
+		uint64_t GetElapsedTicks() const					{ return m_elapsedTicks; }
 		double GetElapsedSeconds() const					{ return TicksToSeconds(m_elapsedTicks); }
 
 		// Get total time since the start of the program.
-		uint64 GetTotalTicks() const						{ return m_totalTicks; }
+		uint64_t GetTotalTicks() const						{ return m_totalTicks; }
 		double GetTotalSeconds() const						{ return TicksToSeconds(m_totalTicks); }
 
 		// Get total number of updates since start of the program.
-		uint32 GetFrameCount() const						{ return m_frameCount; }
+		uint32_t GetFrameCount() const						{ return m_frameCount; }
 
 		// Get the current framerate.
-		uint32 GetFramesPerSecond() const					{ return m_framesPerSecond; }
+		uint32_t GetFramesPerSecond() const					{ return m_framesPerSecond; }
 
 		// Set whether to use fixed or variable timestep mode.
 		void SetFixedTimeStep(bool isFixedTimestep)			{ m_isFixedTimeStep = isFixedTimestep; }
 
+		// In deterministic mode every Tick runs exactly one update of the target elapsed time, however long the
+		// frame really took, so animation replays identically from run to run. The frame rate still uses real time.
+		void SetDeterministic(bool isDeterministic)			{ m_isDeterministic = isDeterministic; }
+		bool IsDeterministic() const						{ return m_isDeterministic; }
+
 		// Set how often to call Update when in fixed timestep mode.
-		void SetTargetElapsedTicks(uint64 targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
+		void SetTargetElapsedTicks(uint64_t targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
 		void SetTargetElapsedSeconds(double targetElapsed)	{ m_targetElapsedTicks = SecondsToTicks(targetElapsed); }
 
 		// Integer format represents time using 10,000,000 ticks per second.
-		static const uint64 TicksPerSecond = 10000000;
+		static const uint64_t TicksPerSecond = 10000000;
 
-		static double TicksToSeconds(uint64 ticks)			{ return static_cast<double>(ticks) / TicksPerSecond; }
-		static uint64 SecondsToTicks(double seconds)		{ return static_cast<uint64>(seconds * TicksPerSecond); }
+		static double TicksToSeconds(uint64_t ticks)		{ return static_cast<double>(ticks) / TicksPerSecond; }
+		static uint64_t SecondsToTicks(double seconds)		{ return static_cast<uint64_t>(seconds * TicksPerSecond); }
 
 		// After an intentional timing discontinuity (for instance a blocking IO operation)
 		// call this to avoid having the fixed timestep logic attempt a set of catch-up 
@@ -66,10 +74,7 @@ namespace DX
 
 		void ResetElapsedTime()
 		{
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_qpcLastTime = QueryCounter();
 
 			m_leftOverTicks = 0;
 			m_framesPerSecond = 0;
@@ -82,14 +87,9 @@ namespace DX
 		void Tick(const TUpdate& update)
 		{
 			// Query the current time.
-			LARGE_INTEGER currentTime;
+			uint64_t currentTime = QueryCounter();
 
-			if (!QueryPerformanceCounter(&currentTime))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			uint64 timeDelta = currentTime.QuadPart - m_qpcLastTime.QuadPart;
+			uint64_t timeDelta = currentTime - m_qpcLastTime;
 
 			m_qpcLastTime = currentTime;
 			m_qpcSecondCounter += timeDelta;
@@ -102,11 +102,21 @@ namespace DX
 
 			// Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
 			timeDelta *= TicksPerSecond;
-			timeDelta /= m_qpcFrequency.QuadPart;
+			timeDelta /= m_qpcFrequency;
 
-			uint32 lastFrameCount = m_frameCount;
+			uint32_t lastFrameCount = m_frameCount;
 
-			if (m_isFixedTimeStep)
+			if (m_isDeterministic)
+			{
+				// Simulated time only, one step per Tick.
+				m_elapsedTicks = m_targetElapsedTicks;
+				m_totalTicks += m_targetElapsedTicks;
+				m_leftOverTicks = 0;
+				m_frameCount++;
+
+				update();
+			}
+			else if (m_isFixedTimeStep)
 			{
 				// Fixed timestep update logic
 
@@ -117,7 +127,7 @@ namespace DX
 				// accumulate enough tiny errors that it would drop a frame. It is better to just round 
 				// small deviations down to zero to leave things running smoothly.
 
-				if (abs(static_cast<int64>(timeDelta - m_targetElapsedTicks)) < TicksPerSecond / 4000)
+				if (std::abs(static_cast<int64_t>(timeDelta - m_targetElapsedTicks)) < static_cast<int64_t>(TicksPerSecond / 4000))
 				{
 					timeDelta = m_targetElapsedTicks;
 				}
@@ -151,33 +161,76 @@ namespace DX
 				m_framesThisSecond++;
 			}
 
-			if (m_qpcSecondCounter >= static_cast<uint64>(m_qpcFrequency.QuadPart))
+			if (m_qpcSecondCounter >= m_qpcFrequency)
 			{
 				m_framesPerSecond = m_framesThisSecond;
 				m_framesThisSecond = 0;
-				m_qpcSecondCounter %= m_qpcFrequency.QuadPart;
+				m_qpcSecondCounter %= m_qpcFrequency;
 			}
 		}
 
 	private:
+#if defined(_WIN32)
+		static uint64_t QueryFrequency()
+		{
+			LARGE_INTEGER frequency;
+			if (!QueryPerformanceFrequency(&frequency))
+			{
+				ThrowQueryFailed();
+			}
+			return frequency.QuadPart;
+		}
+
+		static uint64_t QueryCounter()
+		{
+			LARGE_INTEGER counter;
+			if (!QueryPerformanceCounter(&counter))
+			{
+				ThrowQueryFailed();
+			}
+			return counter.QuadPart;
+		}
+
+		// The UWP app builds with /ZW; the headless CMake build on Windows does not.
+		static void ThrowQueryFailed()
+		{
+#if defined(__cplusplus_winrt)
+			throw ref new Platform::FailureException();
+#else
+			throw std::runtime_error("QueryPerformanceCounter failed");
+#endif
+		}
+#else
+		static uint64_t QueryFrequency()
+		{
+			return 1000000000;
+		}
+
+		static uint64_t QueryCounter()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+#endif
+
 		// Source timing data uses QPC units.
-		LARGE_INTEGER m_qpcFrequency;
-		LARGE_INTEGER m_qpcLastTime;
-		uint64 m_qpcMaxDelta;
+		uint64_t m_qpcFrequency;
+		uint64_t m_qpcLastTime;
+		uint64_t m_qpcMaxDelta;
 
 		// Derived timing data uses a canonical tick format.
-		uint64 m_elapsedTicks;
-		uint64 m_totalTicks;
-		uint64 m_leftOverTicks;
+		uint64_t m_elapsedTicks;
+		uint64_t m_totalTicks;
+		uint64_t m_leftOverTicks;
 
 		// Members for tracking the framerate.
-		uint32 m_frameCount;
-		uint32 m_framesPerSecond;
-		uint32 m_framesThisSecond;
-		uint64 m_qpcSecondCounter;
+		uint32_t m_frameCount;
+		uint32_t m_framesPerSecond;
+		uint32_t m_framesThisSecond;
+		uint64_t m_qpcSecondCounter;
 
 		// Members for configuring fixed timestep mode.
 		bool m_isFixedTimeStep;
-		uint64 m_targetElapsedTicks;
+		bool m_isDeterministic;
+		uint64_t m_targetElapsedTicks;
 	};
 }
@@ -0,0 +1,196 @@
+﻿#include "pch.h"
+#include "BatchRenderer.h"
+#include <fstream>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+BatchRenderer::BatchRenderer(const BatchSettings& settings, CompletionCallback onComplete) :
+	m_onComplete(std::move(onComplete)),
+	m_active(0),
+	m_stopping(false)
+{
+	m_stats = BatchStats();
+
+	uint32_t threadCount = (settings.threadCount > 0) ? settings.threadCount : std::thread::hardware_concurrency();
+	threadCount = (threadCount > 0) ? threadCount : 1;
+	m_capacity = (settings.queueCapacity > 0) ? settings.queueCapacity : 2 * threadCount;
+
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		m_workers.emplace_back(&BatchRenderer::WorkerLoop, this);
+	}
+}
+
+BatchRenderer::~BatchRenderer()
+{
+	WaitIdle();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void BatchRenderer::Submit(BatchJob job)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_queue.size() >= m_capacity)
+		{
+			m_stats.blockedSubmits++;
+			m_notFull.wait(lock, [this]() { return m_queue.size() < m_capacity; });
+		}
+		Enqueue(std::move(job));
+	}
+	m_wake.notify_one();
+}
+
+bool BatchRenderer::TrySubmit(BatchJob& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_queue.size() >= m_capacity)
+		{
+			return false;
+		}
+		Enqueue(std::move(job));
+	}
+	m_wake.notify_one();
+	return true;
+}
+
+// Called with the lock held.
+void BatchRenderer::Enqueue(BatchJob&& job)
+{
+	if (m_stats.submitted == 0)
+	{
+		m_firstSubmit = std::chrono::steady_clock::now();
+	}
+	m_stats.submitted++;
+	m_queue.push_back(std::move(job));
+}
+
+void BatchRenderer::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_queue.empty() && m_active == 0; });
+}
+
+BatchStats BatchRenderer::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	BatchStats stats = m_stats;
+	if (stats.completed > 0)
+	{
+		stats.seconds = std::chrono::duration<double>(m_lastCompletion - m_firstSubmit).count();
+		stats.imagesPerSecond = (stats.seconds > 0.0) ? stats.completed / stats.seconds : 0.0;
+	}
+	return stats;
+}
+
+void BatchRenderer::WorkerLoop()
+{
+	// Each worker reuses one image, so the batch never holds more images than workers.
+	ReferenceImage image;
+	for (;;)
+	{
+		BatchJob job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+			if (m_queue.empty())
+			{
+				return;
+			}
+
+			job = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_active++;
+		}
+		m_notFull.notify_one();
+
+		RaymarchSettings settings = job.settings;
+		settings.transferFunction = job.transferFunction.get();
+		image.Resize(job.width, job.height);
+		ReferenceRaymarcher::Render(*job.volume, job.camera, settings, image);
+
+		bool written = job.outputPath.empty() || WriteTga(job.outputPath, image);
+		if (m_onComplete)
+		{
+			m_onComplete(job, image, written);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_active--;
+			m_stats.completed++;
+			m_stats.failedWrites += written ? 0 : 1;
+			m_stats.samples += image.samples;
+			m_lastCompletion = std::chrono::steady_clock::now();
+			if (m_queue.empty() && m_active == 0)
+			{
+				m_idle.notify_all();
+			}
+		}
+	}
+}
+
+RaymarchCamera VolumeShaderTest::MakeOrbitCamera(
+	float yawRadians,
+	float pitchRadians,
+	float distance,
+	float aspectRatio,
+	const XMFLOAT3& lightPosition)
+{
+	XMFLOAT3 eye(
+		-distance * cosf(pitchRadians) * sinf(yawRadians),
+		distance * sinf(pitchRadians),
+		-distance * cosf(pitchRadians) * cosf(yawRadians));
+
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, aspectRatio, 0.001f, 500.0f);
+	return MakeRaymarchCamera(XMMatrixIdentity(), view, projection, eye, lightPosition);
+}
+
+bool VolumeShaderTest::WriteTga(const DX::FilePath& path, const ReferenceImage& image)
+{
+	// Uncompressed true color, 32 bits per pixel with 8 alpha bits, origin at the top left.
+	uint8_t header[18] = {};
+	header[2] = 2;
+	header[12] = static_cast<uint8_t>(image.width & 0xff);
+	header[13] = static_cast<uint8_t>(image.width >> 8);
+	header[14] = static_cast<uint8_t>(image.height & 0xff);
+	header[15] = static_cast<uint8_t>(image.height >> 8);
+	header[16] = 32;
+	header[17] = 0x28;
+	if (image.width > 0xffff || image.height > 0xffff)
+	{
+		return false;
+	}
+
+	// The march leaves color premultiplied by alpha.
+	std::vector<uint8_t> pixels(image.color.size() * 4);
+	for (size_t i = 0; i < image.color.size(); ++i)
+	{
+		const XMFLOAT4& color = image.color[i];
+		float alpha = (color.w < 0.0f) ? 0.0f : (color.w > 1.0f ? 1.0f : color.w);
+		float scale = (alpha > 0.0f) ? 1.0f / alpha : 0.0f;
+		const float channels[4] = { color.z * scale, color.y * scale, color.x * scale, alpha };
+		for (int c = 0; c < 4; ++c)
+		{
+			float value = (channels[c] < 0.0f) ? 0.0f : (channels[c] > 1.0f ? 1.0f : channels[c]);
+			pixels[i * 4 + c] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+		}
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Common/FileView.h"
+#include "ReferenceRaymarcher.h"
+
+namespace VolumeShaderTest
+{
+	// One image of a batch. The volume and transfer function are shared, so thousands of jobs over a few volumes
+	// hold one copy of each.
+	struct BatchJob
+	{
+		BatchJob() : width(256), height(256) {}
+
+		std::shared_ptr<const VolumeData> volume;
+		std::shared_ptr<const std::vector<DirectX::XMFLOAT4>> transferFunction;	// Null keeps the volume's color.
+		RaymarchCamera camera;
+		RaymarchSettings settings;	// settings.transferFunction is replaced by the table above.
+		uint32_t width;
+		uint32_t height;
+		DX::FilePath outputPath;	// Written with WriteTga; empty hands the image to the callback only.
+	};
+
+	struct BatchSettings
+	{
+		BatchSettings() : threadCount(0), queueCapacity(0) {}
+
+		uint32_t threadCount;	// 0 = one per hardware thread.
+		uint32_t queueCapacity;	// Jobs waiting for a worker; 0 = twice the thread count.
+	};
+
+	struct BatchStats
+	{
+		uint64_t submitted;
+		uint64_t completed;
+		uint64_t failedWrites;
+		uint64_t blockedSubmits;	// Submit calls that waited for room in the queue.
+		uint64_t samples;			// Volume fetches over all completed images.
+		double seconds;				// From the first submission to the latest completion.
+		double imagesPerSecond;
+	};
+
+	// Renders images without a window or a GPU. Worker threads take jobs from a bounded queue and march each image
+	// on one core with ReferenceRaymarcher, so the batch scales with the cores and the output matches the reference
+	// renderer exactly. Submit blocks while the queue is full, which keeps a producer streaming thousands of jobs
+	// to at most queueCapacity jobs and threadCount images in memory.
+	class BatchRenderer
+	{
+	public:
+		// Called on the worker thread that rendered the image, after it was written.
+		typedef std::function<void(const BatchJob& job, const ReferenceImage& image, bool written)> CompletionCallback;
+
+		explicit BatchRenderer(const BatchSettings& settings = BatchSettings(), CompletionCallback onComplete = CompletionCallback());
+
+		// Finishes every queued job before returning.
+		~BatchRenderer();
+
+		BatchRenderer(const BatchRenderer&) = delete;
+		BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+		void Submit(BatchJob job);
+
+		// Queues the job unless the queue is full; the job is left untouched when it returns false.
+		bool TrySubmit(BatchJob& job);
+
+		// Blocks until every submitted job has completed.
+		void WaitIdle();
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+		BatchStats GetStats() const;
+
+	private:
+		void Enqueue(BatchJob&& job);
+		void WorkerLoop();
+
+		CompletionCallback						m_onComplete;
+		std::vector<std::thread>				m_workers;
+		size_t									m_capacity;
+
+		mutable std::mutex						m_mutex;
+		std::condition_variable					m_wake;
+		std::condition_variable					m_notFull;
+		std::condition_variable					m_idle;
+		std::deque<BatchJob>					m_queue;
+		uint32_t								m_active;		// Jobs a worker is rendering.
+		BatchStats								m_stats;
+		std::chrono::steady_clock::time_point	m_firstSubmit;
+		std::chrono::steady_clock::time_point	m_lastCompletion;
+		bool									m_stopping;
+	};
+
+	// Camera on a sphere around the volume looking at its center, with the 70 degree vertical field of view of the
+	// interactive renderer. Yaw turns about +y starting from -z; positive pitch looks down from above.
+	RaymarchCamera MakeOrbitCamera(
+		float yawRadians,
+		float pitchRadians,
+		float distance,
+		float aspectRatio,
+		const DirectX::XMFLOAT3& lightPosition);
+
+	// Writes 8-bit straight alpha BGRA, top row first. Returns false when the file cannot be written.
+	bool WriteTga(const DX::FilePath& path, const ReferenceImage& image);
+}
@@ -0,0 +1,442 @@
+﻿#include "pch.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	inline XMFLOAT3 Lerp3(const XMFLOAT3& a, const XMFLOAT3& b, float t)
+	{
+		return XMFLOAT3(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t);
+	}
+
+	BenchmarkKeyframe MakeKeyframe(double time, const XMFLOAT3& eye, const XMFLOAT3& target, const XMFLOAT3& light, float rotation)
+	{
+		BenchmarkKeyframe key;
+		key.time = time;
+		key.pose.eye = eye;
+		key.pose.target = target;
+		key.pose.lightPosition = light;
+		key.pose.modelRotation = rotation;
+		return key;
+	}
+
+	// The light orbit of Sample3DSceneRenderer::Update.
+	inline XMFLOAT3 OrbitLight(double seconds)
+	{
+		float angle = static_cast<float>(seconds) * 1.2f;
+		return XMFLOAT3(2.0f * cosf(angle), 1.5f, 2.0f * sinf(angle));
+	}
+
+	void WriteJsonString(std::ostream& stream, const std::string& value)
+	{
+		stream << '"';
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				stream << '\\' << c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+			}
+			else
+			{
+				stream << c;
+			}
+		}
+		stream << '"';
+	}
+}
+
+CameraPose BenchmarkPath::Evaluate(double seconds) const
+{
+	if (keyframes.empty())
+	{
+		CameraPose pose = {};
+		return pose;
+	}
+
+	double duration = GetDuration();
+	double t = (duration > 0.0) ? fmod(seconds, duration) : 0.0;
+	t = (t < 0.0) ? t + duration : t;
+
+	size_t next = 0;
+	while (next < keyframes.size() && keyframes[next].time <= t)
+	{
+		++next;
+	}
+	if (next == 0)
+	{
+		return keyframes.front().pose;
+	}
+	if (next == keyframes.size())
+	{
+		return keyframes.back().pose;
+	}
+
+	const BenchmarkKeyframe& a = keyframes[next - 1];
+	const BenchmarkKeyframe& b = keyframes[next];
+	float s = static_cast<float>((t - a.time) / (b.time - a.time));
+
+	CameraPose pose;
+	pose.eye = Lerp3(a.pose.eye, b.pose.eye, s);
+	pose.target = Lerp3(a.pose.target, b.pose.target, s);
+	pose.lightPosition = Lerp3(a.pose.lightPosition, b.pose.lightPosition, s);
+	pose.modelRotation = a.pose.modelRotation + (b.pose.modelRotation - a.pose.modelRotation) * s;
+	return pose;
+}
+
+std::vector<BenchmarkPath> VolumeShaderTest::GetDefaultBenchmarkPaths()
+{
+	// The camera of CreateWindowSizeDependentResources.
+	const XMFLOAT3 eye(0.0f, 0.7f, -3.0f);
+	const XMFLOAT3 at(0.0f, -0.1f, 0.0f);
+	const XMFLOAT3 center(0.0f, 0.0f, 0.0f);
+	const XMFLOAT3 light(2.0f, 1.5f, 0.0f);
+
+	std::vector<BenchmarkPath> paths(3);
+
+	// Keys every quarter second keep the linear light orbit within 1% of the circle.
+	paths[0].name = "orbit";
+	for (int i = 0; i <= 32; ++i)
+	{
+		double time = i * 0.25;
+		paths[0].keyframes.push_back(MakeKeyframe(time, eye, at, OrbitLight(time), XM_2PI * i / 32.0f));
+	}
+
+	paths[1].name = "dolly";
+	paths[1].keyframes.push_back(MakeKeyframe(0.0, XMFLOAT3(0.0f, 0.3f, -3.0f), center, light, 0.0f));
+	paths[1].keyframes.push_back(MakeKeyframe(3.0, XMFLOAT3(0.0f, 0.02f, -0.1f), XMFLOAT3(0.0f, 0.0f, 1.0f), light, 0.0f));
+	paths[1].keyframes.push_back(MakeKeyframe(4.0, XMFLOAT3(0.0f, 0.02f, 0.1f), XMFLOAT3(0.0f, 0.0f, 1.0f), light, 0.0f));
+	paths[1].keyframes.push_back(MakeKeyframe(6.0, XMFLOAT3(0.0f, 0.3f, -3.0f), center, light, 0.0f));
+
+	paths[2].name = "grazing";
+	for (int i = 0; i <= 16; ++i)
+	{
+		float angle = XM_2PI * i / 16.0f;
+		XMFLOAT3 grazingEye(1.1f * sinf(angle), 0.05f, -1.1f * cosf(angle));
+		paths[2].keyframes.push_back(MakeKeyframe(i * 0.5, grazingEye, center, light, 0.0f));
+	}
+
+	return paths;
+}
+
+bool VolumeShaderTest::ParseBenchmarkPaths(const std::string& text, std::vector<BenchmarkPath>& paths, std::string* error)
+{
+	std::istringstream lines(text);
+	std::string line;
+	uint32_t lineNumber = 0;
+	auto fail = [&](const char* message)
+	{
+		if (error != nullptr)
+		{
+			*error = "line " + std::to_string(lineNumber) + ": " + message;
+		}
+		return false;
+	};
+
+	while (std::getline(lines, line))
+	{
+		++lineNumber;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+
+		std::istringstream fields(line);
+		std::string keyword;
+		if (!(fields >> keyword))
+		{
+			continue;
+		}
+
+		if (keyword == "path")
+		{
+			BenchmarkPath path;
+			if (!(fields >> path.name))
+			{
+				return fail("path needs a name");
+			}
+			paths.push_back(path);
+		}
+		else if (keyword == "key")
+		{
+			if (paths.empty())
+			{
+				return fail("key before any path");
+			}
+
+			BenchmarkKeyframe key;
+			CameraPose& pose = key.pose;
+			if (!(fields >> key.time
+				>> pose.eye.x >> pose.eye.y >> pose.eye.z
+				>> pose.target.x >> pose.target.y >> pose.target.z
+				>> pose.lightPosition.x >> pose.lightPosition.y >> pose.lightPosition.z
+				>> pose.modelRotation))
+			{
+				return fail("key needs a time and 10 numbers");
+			}
+
+			std::vector<BenchmarkKeyframe>& keyframes = paths.back().keyframes;
+			if (!keyframes.empty() && key.time <= keyframes.back().time)
+			{
+				return fail("key times must increase");
+			}
+			keyframes.push_back(key);
+		}
+		else
+		{
+			return fail("expected path or key");
+		}
+
+		std::string extra;
+		if (fields >> extra)
+		{
+			return fail("unexpected text after the values");
+		}
+	}
+
+	for (const BenchmarkPath& path : paths)
+	{
+		if (path.keyframes.empty())
+		{
+			return fail(("path " + path.name + " has no keys").c_str());
+		}
+	}
+	return true;
+}
+
+BenchmarkFrameTimeSummary VolumeShaderTest::SummarizeFrameTimes(const std::vector<BenchmarkFrameSample>& frames)
+{
+	BenchmarkFrameTimeSummary summary = {};
+	if (frames.empty())
+	{
+		return summary;
+	}
+
+	std::vector<double> times;
+	times.reserve(frames.size());
+	double total = 0.0;
+	for (const BenchmarkFrameSample& frame : frames)
+	{
+		times.push_back(frame.milliseconds);
+		total += frame.milliseconds;
+	}
+	std::sort(times.begin(), times.end());
+
+	auto percentile = [&](double p)
+	{
+		size_t rank = static_cast<size_t>(ceil(p / 100.0 * times.size()));
+		return times[(rank > 0) ? rank - 1 : 0];
+	};
+
+	summary.min = times.front();
+	summary.p50 = percentile(50.0);
+	summary.p90 = percentile(90.0);
+	summary.p95 = percentile(95.0);
+	summary.p99 = percentile(99.0);
+	summary.max = times.back();
+	summary.mean = total / times.size();
+	return summary;
+}
+
+void VolumeShaderTest::WriteBenchmarkJson(std::ostream& stream, const BenchmarkReport& report)
+{
+	std::ios::fmtflags flags = stream.flags();
+	std::streamsize precision = stream.precision();
+	stream << std::setprecision(6);
+
+	stream << "{\n  \"label\": ";
+	WriteJsonString(stream, report.label);
+	stream << ",\n  \"backend\": ";
+	WriteJsonString(stream, report.backend);
+	stream << ",\n  \"width\": " << report.width;
+	stream << ",\n  \"height\": " << report.height;
+	stream << ",\n  \"warmupFrames\": " << report.settings.warmupFrames;
+	stream << ",\n  \"measuredFrames\": " << report.settings.measuredFrames;
+	stream << ",\n  \"frameSeconds\": " << report.settings.frameSeconds;
+	stream << ",\n  \"paths\": [";
+
+	for (size_t i = 0; i < report.paths.size(); ++i)
+	{
+		const BenchmarkPathResult& path = report.paths[i];
+		BenchmarkFrameTimeSummary times = SummarizeFrameTimes(path.frames);
+
+		bool samplesKnown = !path.frames.empty();
+		double samplesTotal = 0.0, samplesMax = 0.0;
+		uint64_t uploadTotal = 0, uploadMax = 0;
+		for (const BenchmarkFrameSample& frame : path.frames)
+		{
+			samplesKnown = samplesKnown && frame.samplesPerPixel >= 0.0;
+			samplesTotal += frame.samplesPerPixel;
+			samplesMax = (std::max)(samplesMax, frame.samplesPerPixel);
+			uploadTotal += frame.uploadBytes;
+			uploadMax = (std::max)(uploadMax, frame.uploadBytes);
+		}
+
+		stream << (i > 0 ? "," : "") << "\n    {\n      \"name\": ";
+		WriteJsonString(stream, path.name);
+		stream << ",\n      \"frames\": " << path.frames.size();
+		stream << ",\n      \"frameMilliseconds\": { \"min\": " << times.min << ", \"p50\": " << times.p50 << ", \"p90\": " << times.p90
+			<< ", \"p95\": " << times.p95 << ", \"p99\": " << times.p99 << ", \"max\": " << times.max << ", \"mean\": " << times.mean << " }";
+		if (samplesKnown)
+		{
+			stream << ",\n      \"samplesPerPixel\": { \"mean\": " << samplesTotal / path.frames.size() << ", \"max\": " << samplesMax << " }";
+		}
+		else
+		{
+			stream << ",\n      \"samplesPerPixel\": null";
+		}
+		stream << ",\n      \"uploadBytes\": { \"total\": " << uploadTotal << ", \"maxPerFrame\": " << uploadMax << " }";
+		stream << ",\n      \"frameTimes\": [";
+		for (size_t f = 0; f < path.frames.size(); ++f)
+		{
+			stream << (f > 0 ? ", " : "") << path.frames[f].milliseconds;
+		}
+		stream << "]\n    }";
+	}
+
+	stream << "\n  ]\n}\n";
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+bool VolumeShaderTest::WriteBenchmarkJson(const DX::FilePath& path, const BenchmarkReport& report)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	WriteBenchmarkJson(file, report);
+	return static_cast<bool>(file);
+}
+
+BenchmarkRunner::BenchmarkRunner(const BenchmarkSettings& settings, const std::vector<BenchmarkPath>& paths) :
+	m_settings(settings),
+	m_paths(paths),
+	m_pathIndex(0),
+	m_frameInPhase(0),
+	m_measuring(settings.warmupFrames == 0),
+	m_phaseStarted(false),
+	m_phaseStart(0.0)
+{
+	// Nothing to record leaves nothing to run.
+	if (m_settings.measuredFrames == 0)
+	{
+		m_pathIndex = m_paths.size();
+	}
+	for (const BenchmarkPath& path : m_paths)
+	{
+		BenchmarkPathResult result;
+		result.name = path.name;
+		m_results.push_back(result);
+	}
+}
+
+void BenchmarkRunner::ConfigureTimer(DX::StepTimer& timer) const
+{
+	timer.SetDeterministic(true);
+	timer.SetTargetElapsedSeconds(m_settings.frameSeconds);
+}
+
+CameraPose BenchmarkRunner::BeginFrame(double timerSeconds)
+{
+	if (!m_phaseStarted)
+	{
+		m_phaseStart = timerSeconds;
+		m_phaseStarted = true;
+	}
+	return m_paths[m_pathIndex].Evaluate(timerSeconds - m_phaseStart);
+}
+
+void BenchmarkRunner::EndFrame(const BenchmarkFrameSample& sample)
+{
+	if (IsFinished())
+	{
+		return;
+	}
+
+	if (m_measuring)
+	{
+		m_results[m_pathIndex].frames.push_back(sample);
+	}
+
+	uint32_t phaseFrames = m_measuring ? m_settings.measuredFrames : m_settings.warmupFrames;
+	if (++m_frameInPhase < phaseFrames)
+	{
+		return;
+	}
+
+	// Next phase, restarting the path at zero.
+	m_frameInPhase = 0;
+	m_phaseStarted = false;
+	if (m_measuring)
+	{
+		m_pathIndex++;
+		m_measuring = (m_settings.warmupFrames == 0);
+	}
+	else
+	{
+		m_measuring = true;
+	}
+}
+
+bool VolumeShaderTest::RunBenchmarkFrame(BenchmarkRunner& runner, DX::StepTimer& timer, IRenderBackend& backend)
+{
+	CameraPose pose;
+	timer.Tick([&]()
+	{
+		pose = runner.BeginFrame(timer.GetTotalSeconds());
+	});
+
+	RenderFrameStats stats;
+	auto start = std::chrono::steady_clock::now();
+	if (!backend.RenderFrame(pose, timer.GetFrameCount(), stats))
+	{
+		runner.CancelFrame();
+		return false;
+	}
+
+	BenchmarkFrameSample sample;
+	sample.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	sample.samplesPerPixel = stats.samplesPerPixel;
+	sample.uploadBytes = stats.uploadBytes;
+	runner.EndFrame(sample);
+	return true;
+}
+
+BenchmarkReport VolumeShaderTest::MakeBenchmarkReport(const BenchmarkRunner& runner, const IRenderBackend& backend, const std::string& label)
+{
+	BenchmarkReport report;
+	report.label = label;
+	report.backend = backend.GetName();
+	report.width = backend.GetWidth();
+	report.height = backend.GetHeight();
+	report.settings = runner.GetSettings();
+	report.paths = runner.GetResults();
+	return report;
+}
+
+BenchmarkReport VolumeShaderTest::RunBenchmark(
+	IRenderBackend& backend,
+	const BenchmarkSettings& settings,
+	const std::vector<BenchmarkPath>& paths,
+	const std::string& label)
+{
+	BenchmarkRunner runner(settings, paths);
+	DX::StepTimer timer;
+	runner.ConfigureTimer(timer);
+
+	while (!runner.IsFinished())
+	{
+		RunBenchmarkFrame(runner, timer, backend);
+	}
+	return MakeBenchmarkReport(runner, backend, label);
+}
@@ -0,0 +1,140 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Common/FileView.h"
+#include "Common/StepTimer.h"
+#include "RenderBackend.h"
+
+namespace VolumeShaderTest
+{
+	struct BenchmarkKeyframe
+	{
+		double time;	// Seconds from the start of the path.
+		CameraPose pose;
+	};
+
+	// Poses between keyframes are interpolated linearly, and the path loops after its last keyframe.
+	struct BenchmarkPath
+	{
+		std::string name;
+		std::vector<BenchmarkKeyframe> keyframes;	// Sorted by time.
+
+		double GetDuration() const { return keyframes.empty() ? 0.0 : keyframes.back().time; }
+		CameraPose Evaluate(double seconds) const;
+	};
+
+	// Orbit: the default camera while the volume turns once and the light orbits as in Update.
+	// Dolly: the camera flies from outside into the middle of the volume and back.
+	// Grazing: a low close orbit where rays cross the most voxels.
+	std::vector<BenchmarkPath> GetDefaultBenchmarkPaths();
+
+	// Reads paths from text:
+	//   # comment
+	//   path <name>
+	//   key <time> <eye xyz> <target xyz> <light xyz> <model rotation>
+	// Keyframe times must increase within a path. Returns false and describes the first bad line in error.
+	bool ParseBenchmarkPaths(const std::string& text, std::vector<BenchmarkPath>& paths, std::string* error = nullptr);
+
+	struct BenchmarkSettings
+	{
+		BenchmarkSettings() : warmupFrames(30), measuredFrames(240), frameSeconds(1.0 / 60.0) {}
+
+		uint32_t warmupFrames;		// Rendered from the start of each path and discarded.
+		uint32_t measuredFrames;	// Rendered from the start of the path again and recorded.
+		double frameSeconds;		// Simulated time per frame, whatever the frame really took.
+	};
+
+	struct BenchmarkFrameSample
+	{
+		double milliseconds;
+		double samplesPerPixel;	// Negative when the backend cannot count samples.
+		uint64_t uploadBytes;	// Texture data copied to the renderer during the frame.
+	};
+
+	struct BenchmarkPathResult
+	{
+		std::string name;
+		std::vector<BenchmarkFrameSample> frames;
+	};
+
+	// Nearest rank percentiles of the measured frame times.
+	struct BenchmarkFrameTimeSummary
+	{
+		double min;
+		double p50;
+		double p90;
+		double p95;
+		double p99;
+		double max;
+		double mean;
+	};
+
+	BenchmarkFrameTimeSummary SummarizeFrameTimes(const std::vector<BenchmarkFrameSample>& frames);
+
+	struct BenchmarkReport
+	{
+		std::string label;		// Build or configuration being measured.
+		std::string backend;
+		uint32_t width;
+		uint32_t height;
+		BenchmarkSettings settings;
+		std::vector<BenchmarkPathResult> paths;
+	};
+
+	// One JSON object per report: the settings, then per path the frame time summary in milliseconds, mean and
+	// maximum samples per pixel (null when unknown), upload bytes and every frame time.
+	void WriteBenchmarkJson(std::ostream& stream, const BenchmarkReport& report);
+	bool WriteBenchmarkJson(const DX::FilePath& path, const BenchmarkReport& report);
+
+	// Steps through the paths in order, each with its warmup frames then its measured frames. The caller ticks a
+	// deterministic StepTimer once per frame, asks for the pose with the timer's total time, renders, and reports
+	// the frame; every phase starts its path at zero, so runs see the same poses frame for frame.
+	class BenchmarkRunner
+	{
+	public:
+		BenchmarkRunner(const BenchmarkSettings& settings, const std::vector<BenchmarkPath>& paths);
+
+		// Puts the timer in the deterministic mode the runner expects.
+		void ConfigureTimer(DX::StepTimer& timer) const;
+
+		bool IsFinished() const { return m_pathIndex >= m_paths.size(); }
+		bool IsWarmup() const { return !m_measuring; }
+		uint32_t GetFrameIndex() const { return m_frameInPhase; }
+		const BenchmarkPath& GetPath() const { return m_paths[m_pathIndex]; }
+		const BenchmarkSettings& GetSettings() const { return m_settings; }
+
+		CameraPose BeginFrame(double timerSeconds);
+		void EndFrame(const BenchmarkFrameSample& sample);
+
+		// Drops the frame begun last, so the next BeginFrame, one timer step later, returns the same pose again.
+		void CancelFrame() { m_phaseStart += m_settings.frameSeconds; }
+
+		const std::vector<BenchmarkPathResult>& GetResults() const { return m_results; }
+
+	private:
+		BenchmarkSettings				m_settings;
+		std::vector<BenchmarkPath>		m_paths;
+		std::vector<BenchmarkPathResult>	m_results;
+		size_t							m_pathIndex;
+		uint32_t						m_frameInPhase;
+		bool							m_measuring;
+		bool							m_phaseStarted;
+		double							m_phaseStart;
+	};
+
+	// Ticks the timer, renders the runner's next frame on the backend and records it, timing RenderFrame alone.
+	// Returns false when the backend drew nothing; the same frame is then retried on the next call.
+	bool RunBenchmarkFrame(BenchmarkRunner& runner, DX::StepTimer& timer, IRenderBackend& backend);
+
+	BenchmarkReport MakeBenchmarkReport(const BenchmarkRunner& runner, const IRenderBackend& backend, const std::string& label);
+
+	// Runs every path to completion on the backend. With CpuRenderBackend this needs no window or device.
+	BenchmarkReport RunBenchmark(
+		IRenderBackend& backend,
+		const BenchmarkSettings& settings,
+		const std::vector<BenchmarkPath>& paths,
+		const std::string& label);
+}
@@ -0,0 +1,86 @@
+﻿#include "pch.h"
+#include "BilateralUpsample.h"
+#include <cfloat>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+void VolumeShaderTest::BilateralUpsample(
+	const ReferenceImage& lowRes,
+	const RaymarchCamera& camera,
+	float depthSigma,
+	ReferenceImage& highRes)
+{
+	highRes.Resize(highRes.width, highRes.height);
+	if (lowRes.width == 0 || lowRes.height == 0)
+	{
+		return;
+	}
+
+	for (uint32_t y = 0; y < highRes.height; ++y)
+	{
+		for (uint32_t x = 0; x < highRes.width; ++x)
+		{
+			// Full resolution guide: the analytic box entry distance, no marching required.
+			XMFLOAT3 ro, rd;
+			float tEntry, tExit;
+			if (!ReferenceRaymarcher::ComputeRay(camera, x + 0.5f, y + 0.5f, highRes.width, highRes.height, ro, rd, tEntry, tExit))
+			{
+				continue;
+			}
+
+			// Position of this pixel center in low resolution texel space.
+			float lx = (x + 0.5f) * lowRes.width / highRes.width - 0.5f;
+			float ly = (y + 0.5f) * lowRes.height / highRes.height - 0.5f;
+			float bx = floorf(lx);
+			float by = floorf(ly);
+			float fx = lx - bx;
+			float fy = ly - by;
+
+			XMFLOAT4 sum(0.0f, 0.0f, 0.0f, 0.0f);
+			float weightSum = 0.0f;
+			float bestDiff = FLT_MAX;
+			XMFLOAT4 bestColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+			for (int tap = 0; tap < 4; ++tap)
+			{
+				int sx = static_cast<int>(bx) + (tap & 1);
+				int sy = static_cast<int>(by) + (tap >> 1);
+				sx = (sx < 0) ? 0 : (sx >= static_cast<int>(lowRes.width) ? lowRes.width - 1 : sx);
+				sy = (sy < 0) ? 0 : (sy >= static_cast<int>(lowRes.height) ? lowRes.height - 1 : sy);
+				size_t index = static_cast<size_t>(sy) * lowRes.width + sx;
+
+				// Low resolution pixels that missed the box store -1, which lands far from any valid entry depth.
+				float depthDiff = fabsf(lowRes.entryDepth[index] - tEntry);
+				float bilinear = ((tap & 1) ? fx : 1.0f - fx) * ((tap >> 1) ? fy : 1.0f - fy);
+				float weight = bilinear * expf(-depthDiff / depthSigma);
+
+				const XMFLOAT4& c = lowRes.color[index];
+				sum.x += c.x * weight;
+				sum.y += c.y * weight;
+				sum.z += c.z * weight;
+				sum.w += c.w * weight;
+				weightSum += weight;
+
+				if (depthDiff < bestDiff)
+				{
+					bestDiff = depthDiff;
+					bestColor = c;
+				}
+			}
+
+			// When every tap is rejected, fall back to the tap with the closest depth.
+			size_t pixel = static_cast<size_t>(y) * highRes.width + x;
+			if (weightSum > 1e-4f)
+			{
+				float invWeight = 1.0f / weightSum;
+				highRes.color[pixel] = XMFLOAT4(sum.x * invWeight, sum.y * invWeight, sum.z * invWeight, sum.w * invWeight);
+			}
+			else
+			{
+				highRes.color[pixel] = bestColor;
+			}
+			highRes.entryDepth[pixel] = tEntry;
+		}
+	}
+}
@@ -0,0 +1,14 @@
+﻿#pragma once
+
+#include "ReferenceRaymarcher.h"
+
+namespace VolumeShaderTest
+{
+	// Depth-aware upsampling of a reduced resolution volume render, mirroring UpsamplePixelShader.hlsl.
+	// highRes must already be sized; its guide depth is computed analytically from the camera, as on the GPU.
+	void BilateralUpsample(
+		const ReferenceImage& lowRes,
+		const RaymarchCamera& camera,
+		float depthSigma,
+		ReferenceImage& highRes);
+}
@@ -0,0 +1,334 @@
+﻿#include "pch.h"
+#include "BrickCodec.h"
+#include <cstring>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	const size_t MinMatch = 4;
+	const size_t MaxOffset = 65535;
+	const uint32_t HashBits = 12;
+
+	inline uint32_t Load32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	void WriteLength(size_t length, std::vector<uint8_t>& destination)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			destination.push_back(255);
+		}
+		destination.push_back(static_cast<uint8_t>(length));
+	}
+
+	bool ReadLength(const uint8_t*& source, const uint8_t* end, size_t& length)
+	{
+		uint8_t next;
+		do
+		{
+			if (source == end)
+			{
+				return false;
+			}
+			next = *source++;
+			length += next;
+		} while (next == 255);
+		return true;
+	}
+
+	void WriteSequence(const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength, std::vector<uint8_t>& destination)
+	{
+		size_t matchCode = (matchLength >= MinMatch) ? matchLength - MinMatch : 0;
+		uint8_t token = static_cast<uint8_t>(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+		destination.push_back(token);
+		if (literalCount >= 15)
+		{
+			WriteLength(literalCount - 15, destination);
+		}
+		destination.insert(destination.end(), literals, literals + literalCount);
+
+		if (matchLength >= MinMatch)
+		{
+			destination.push_back(static_cast<uint8_t>(offset));
+			destination.push_back(static_cast<uint8_t>(offset >> 8));
+			if (matchCode >= 15)
+			{
+				WriteLength(matchCode - 15, destination);
+			}
+		}
+	}
+
+	const uint64_t ByteLsbMask = 0x0101010101010101ull;
+
+	// Byte k of entry p holds bit k of p.
+	struct BitSpreadTable
+	{
+		BitSpreadTable()
+		{
+			for (uint32_t p = 0; p < 256; ++p)
+			{
+				spread[p] = 0;
+				for (uint32_t k = 0; k < 8; ++k)
+				{
+					spread[p] |= static_cast<uint64_t>((p >> k) & 1u) << (8 * k);
+				}
+			}
+		}
+
+		uint64_t spread[256];
+	};
+
+	const BitSpreadTable s_bitSpread;
+
+	// Bit b of voxel i lands in plane b, byte i / 8, bit i % 8. Voxels past the last full group of 8 are copied as is.
+	// Each group of 8 voxels is handled as two 64-bit words of low and high bytes.
+	void TransposeBitPlanes(const uint16_t* voxels, size_t count, uint8_t* planes)
+	{
+		size_t groups = count / 8;
+		for (size_t group = 0; group < groups; ++group)
+		{
+			const uint16_t* v = voxels + group * 8;
+			uint64_t bytes[2] = { 0, 0 };
+			for (uint32_t k = 0; k < 8; ++k)
+			{
+				bytes[0] |= static_cast<uint64_t>(v[k] & 0xFF) << (8 * k);
+				bytes[1] |= static_cast<uint64_t>(v[k] >> 8) << (8 * k);
+			}
+
+			// Multiplying the isolated low bits gathers byte k's bit into bit k of the top byte.
+			for (uint32_t bit = 0; bit < 16; ++bit)
+			{
+				uint64_t lsbs = (bytes[bit >> 3] >> (bit & 7)) & ByteLsbMask;
+				planes[bit * groups + group] = static_cast<uint8_t>((lsbs * 0x0102040810204080ull) >> 56);
+			}
+		}
+		memcpy(planes + groups * 16, voxels + groups * 8, (count - groups * 8) * sizeof(uint16_t));
+	}
+
+	void UntransposeBitPlanes(const uint8_t* planes, size_t count, uint16_t* voxels)
+	{
+		size_t groups = count / 8;
+		for (size_t group = 0; group < groups; ++group)
+		{
+			uint64_t bytes[2] = { 0, 0 };
+			for (uint32_t bit = 0; bit < 16; ++bit)
+			{
+				bytes[bit >> 3] |= s_bitSpread.spread[planes[bit * groups + group]] << (bit & 7);
+			}
+
+			uint16_t* v = voxels + group * 8;
+			for (uint32_t k = 0; k < 8; ++k)
+			{
+				v[k] = static_cast<uint16_t>(((bytes[0] >> (8 * k)) & 0xFF) | (((bytes[1] >> (8 * k)) & 0xFF) << 8));
+			}
+		}
+		memcpy(voxels + groups * 8, planes + groups * 16, (count - groups * 8) * sizeof(uint16_t));
+	}
+}
+
+void VolumeShaderTest::CompressLz(const uint8_t* source, size_t size, std::vector<uint8_t>& destination)
+{
+	int64_t table[1 << HashBits];
+	for (int64_t& entry : table)
+	{
+		entry = -1;
+	}
+
+	size_t anchor = 0;
+	size_t position = 0;
+	while (position + MinMatch <= size)
+	{
+		uint32_t sequence = Load32(source + position);
+		uint32_t hash = Hash(sequence);
+		int64_t candidate = table[hash];
+		table[hash] = static_cast<int64_t>(position);
+
+		if (candidate < 0 || position - candidate > MaxOffset || Load32(source + candidate) != sequence)
+		{
+			position++;
+			continue;
+		}
+
+		size_t length = MinMatch;
+		while (position + length < size && source[candidate + length] == source[position + length])
+		{
+			length++;
+		}
+
+		WriteSequence(source + anchor, position - anchor, position - static_cast<size_t>(candidate), length, destination);
+		position += length;
+		anchor = position;
+	}
+
+	WriteSequence(source + anchor, size - anchor, 0, 0, destination);
+}
+
+bool VolumeShaderTest::DecompressLz(const uint8_t* source, size_t size, uint8_t* destination, size_t destinationSize)
+{
+	const uint8_t* end = source + size;
+	size_t written = 0;
+	while (source < end)
+	{
+		uint8_t token = *source++;
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !ReadLength(source, end, literalCount))
+		{
+			return false;
+		}
+		if (literalCount > static_cast<size_t>(end - source) || literalCount > destinationSize - written)
+		{
+			return false;
+		}
+		memcpy(destination + written, source, literalCount);
+		source += literalCount;
+		written += literalCount;
+
+		// The literal-only sequence closes the block.
+		if (source == end)
+		{
+			break;
+		}
+
+		if (end - source < 2)
+		{
+			return false;
+		}
+		size_t offset = source[0] | (static_cast<size_t>(source[1]) << 8);
+		source += 2;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(source, end, matchLength))
+		{
+			return false;
+		}
+		matchLength += MinMatch;
+		if (offset == 0 || offset > written || matchLength > destinationSize - written)
+		{
+			return false;
+		}
+
+		// Matches may overlap their own output (offset < length), which repeats the last offset bytes.
+		const uint8_t* match = destination + written - offset;
+		uint8_t* out = destination + written;
+		if (offset >= matchLength)
+		{
+			memcpy(out, match, matchLength);
+		}
+		else
+		{
+			for (size_t i = 0; i < matchLength; ++i)
+			{
+				out[i] = match[i];
+			}
+		}
+		written += matchLength;
+	}
+	return written == destinationSize;
+}
+
+BrickCodec VolumeShaderTest::CompressBrick(const uint16_t* voxels, size_t count, uint8_t filters, std::vector<uint8_t>& destination)
+{
+	size_t rawBytes = count * sizeof(uint16_t);
+
+	std::vector<uint16_t> delta;
+	const uint16_t* filtered = voxels;
+	if (filters & BrickFilterDelta)
+	{
+		delta.resize(count);
+		uint16_t previous = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			delta[i] = static_cast<uint16_t>(voxels[i] - previous);
+			previous = voxels[i];
+		}
+		filtered = delta.data();
+	}
+
+	std::vector<uint8_t> bytes(rawBytes);
+	if (filters & BrickFilterBitPlane)
+	{
+		TransposeBitPlanes(filtered, count, bytes.data());
+	}
+	else
+	{
+		memcpy(bytes.data(), filtered, rawBytes);
+	}
+
+	size_t start = destination.size();
+	CompressLz(bytes.data(), rawBytes, destination);
+	if (destination.size() - start < rawBytes)
+	{
+		return BrickCodec::Lz;
+	}
+
+	destination.resize(start);
+	const uint8_t* raw = reinterpret_cast<const uint8_t*>(voxels);
+	destination.insert(destination.end(), raw, raw + rawBytes);
+	return BrickCodec::Stored;
+}
+
+bool VolumeShaderTest::DecompressBrick(
+	const uint8_t* data,
+	size_t size,
+	BrickCodec codec,
+	uint8_t filters,
+	uint16_t* voxels,
+	size_t count,
+	std::vector<uint8_t>& scratch)
+{
+	size_t rawBytes = count * sizeof(uint16_t);
+	if (codec == BrickCodec::Stored)
+	{
+		if (size != rawBytes)
+		{
+			return false;
+		}
+		memcpy(voxels, data, rawBytes);
+		return true;
+	}
+
+	if (codec != BrickCodec::Lz)
+	{
+		return false;
+	}
+
+	// Without the bit plane filter the codec can write the voxels directly.
+	uint8_t* bytes = reinterpret_cast<uint8_t*>(voxels);
+	if (filters & BrickFilterBitPlane)
+	{
+		scratch.resize(rawBytes);
+		bytes = scratch.data();
+	}
+
+	if (!DecompressLz(data, size, bytes, rawBytes))
+	{
+		return false;
+	}
+
+	if (filters & BrickFilterBitPlane)
+	{
+		UntransposeBitPlanes(bytes, count, voxels);
+	}
+
+	if (filters & BrickFilterDelta)
+	{
+		uint16_t previous = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			previous = static_cast<uint16_t>(previous + voxels[i]);
+			voxels[i] = previous;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VolumeShaderTest
+{
+	// Byte-oriented LZ77 codec in the LZ4 family, small enough to live in the tree.
+	//
+	// A block is a run of sequences: a token (high nibble literal count, low nibble match length - 4, 15 meaning
+	// more length bytes follow, each adding up to 255), the literals, then a 16-bit little endian match offset
+	// and the extra match length. The last sequence holds literals only and ends at the end of the block.
+	void CompressLz(const uint8_t* source, size_t size, std::vector<uint8_t>& destination);
+
+	// Returns false unless the block decodes to exactly destinationSize bytes without reading or writing out of bounds.
+	bool DecompressLz(const uint8_t* source, size_t size, uint8_t* destination, size_t destinationSize);
+
+	// Reversible transforms applied to 16-bit voxels before the codec.
+	enum BrickFilterFlags : uint8_t
+	{
+		BrickFilterNone = 0,
+		BrickFilterDelta = 1,		// Difference from the previous voxel, so smooth data turns into small values.
+		BrickFilterBitPlane = 2		// Groups bit b of every voxel together, so the unused high bits become zero runs.
+	};
+
+	enum class BrickCodec : uint8_t
+	{
+		Stored,		// Raw voxels; chosen when compression would not save anything.
+		Lz
+	};
+
+	// Filters and compresses count voxels, appending to destination. Returns the codec used; stored bricks are unfiltered.
+	BrickCodec CompressBrick(const uint16_t* voxels, size_t count, uint8_t filters, std::vector<uint8_t>& destination);
+
+	// Inverse of CompressBrick. Scratch is reused between calls to avoid an allocation per brick.
+	bool DecompressBrick(
+		const uint8_t* data,
+		size_t size,
+		BrickCodec codec,
+		uint8_t filters,
+		uint16_t* voxels,
+		size_t count,
+		std::vector<uint8_t>& scratch);
+}
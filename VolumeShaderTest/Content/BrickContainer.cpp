@@ -0,0 +1,290 @@
+﻿#include "pch.h"
+#include "BrickContainer.h"
+#include <cstring>
+#include <fstream>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	inline uint32_t ClampCoord(uint64_t value, uint32_t size)
+	{
+		return static_cast<uint32_t>((value >= size) ? size - 1 : value);
+	}
+
+	BrickLevelInfo MakeLevel(uint32_t width, uint32_t height, uint32_t depth, uint32_t brickSize, uint32_t firstBrick)
+	{
+		BrickLevelInfo level = {};
+		level.width = width;
+		level.height = height;
+		level.depth = depth;
+		level.bricksX = (width + brickSize - 1) / brickSize;
+		level.bricksY = (height + brickSize - 1) / brickSize;
+		level.bricksZ = (depth + brickSize - 1) / brickSize;
+		level.firstBrick = firstBrick;
+		return level;
+	}
+
+	// Averages each 2x2x2 block; odd edges reuse the last voxel.
+	void Downsample(const uint16_t* source, const BrickLevelInfo& from, const BrickLevelInfo& to, std::vector<uint16_t>& destination)
+	{
+		destination.resize(static_cast<size_t>(to.width) * to.height * to.depth);
+		size_t out = 0;
+		for (uint32_t z = 0; z < to.depth; ++z)
+		{
+			for (uint32_t y = 0; y < to.height; ++y)
+			{
+				for (uint32_t x = 0; x < to.width; ++x)
+				{
+					uint32_t sum = 0;
+					for (uint32_t corner = 0; corner < 8; ++corner)
+					{
+						uint32_t sx = ClampCoord(2ull * x + (corner & 1), from.width);
+						uint32_t sy = ClampCoord(2ull * y + ((corner >> 1) & 1), from.height);
+						uint32_t sz = ClampCoord(2ull * z + (corner >> 2), from.depth);
+						sum += source[(static_cast<size_t>(sz) * from.height + sy) * from.width + sx];
+					}
+					destination[out++] = static_cast<uint16_t>((sum + 4) / 8);
+				}
+			}
+		}
+	}
+}
+
+bool VolumeShaderTest::WriteBrickContainer(
+	const DX::FilePath& path,
+	const uint16_t* voxels,
+	uint32_t width,
+	uint32_t height,
+	uint32_t depth,
+	const BrickContainerSettings& settings)
+{
+	uint32_t brickSize = settings.brickSize;
+	if (voxels == nullptr || width == 0 || height == 0 || depth == 0 || brickSize == 0)
+	{
+		return false;
+	}
+
+	// The level table is known up front, so bricks can be written as they are compressed.
+	std::vector<BrickLevelInfo> levels;
+	uint32_t brickCount = 0;
+	for (uint32_t w = width, h = height, d = depth; ; w = (w + 1) / 2, h = (h + 1) / 2, d = (d + 1) / 2)
+	{
+		levels.push_back(MakeLevel(w, h, d, brickSize, brickCount));
+		brickCount += levels.back().bricksX * levels.back().bricksY * levels.back().bricksZ;
+
+		bool singleBrick = w <= brickSize && h <= brickSize && d <= brickSize;
+		if (singleBrick || (settings.maxLevels > 0 && levels.size() == settings.maxLevels))
+		{
+			break;
+		}
+	}
+
+	BrickContainerHeader header = {};
+	header.magic = BrickContainerMagic;
+	header.version = BrickContainerVersion;
+	header.width = width;
+	header.height = height;
+	header.depth = depth;
+	header.brickSize = brickSize;
+	header.levelCount = static_cast<uint32_t>(levels.size());
+	header.brickCount = brickCount;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(BrickLevelInfo));
+
+	uint64_t offset = sizeof(header) + levels.size() * sizeof(BrickLevelInfo);
+	std::vector<BrickIndexEntry> index;
+	index.reserve(brickCount);
+
+	std::vector<uint16_t> brick(static_cast<size_t>(brickSize) * brickSize * brickSize);
+	std::vector<uint8_t> compressed;
+	std::vector<uint16_t> current;
+	std::vector<uint16_t> coarser;
+	const uint16_t* source = voxels;
+
+	for (size_t levelIndex = 0; levelIndex < levels.size(); ++levelIndex)
+	{
+		const BrickLevelInfo& level = levels[levelIndex];
+		if (levelIndex > 0)
+		{
+			Downsample(source, levels[levelIndex - 1], level, coarser);
+			current.swap(coarser);
+			source = current.data();
+		}
+
+		for (uint32_t bz = 0; bz < level.bricksZ; ++bz)
+		{
+			for (uint32_t by = 0; by < level.bricksY; ++by)
+			{
+				for (uint32_t bx = 0; bx < level.bricksX; ++bx)
+				{
+					size_t out = 0;
+					for (uint32_t z = 0; z < brickSize; ++z)
+					{
+						size_t slice = static_cast<size_t>(ClampCoord(static_cast<uint64_t>(bz) * brickSize + z, level.depth)) * level.height;
+						for (uint32_t y = 0; y < brickSize; ++y)
+						{
+							const uint16_t* row = source + (slice + ClampCoord(static_cast<uint64_t>(by) * brickSize + y, level.height)) * level.width;
+							for (uint32_t x = 0; x < brickSize; ++x)
+							{
+								brick[out++] = row[ClampCoord(static_cast<uint64_t>(bx) * brickSize + x, level.width)];
+							}
+						}
+					}
+
+					compressed.clear();
+					BrickIndexEntry entry = {};
+					entry.offset = offset;
+					entry.codec = CompressBrick(brick.data(), brick.size(), settings.filters, compressed);
+					entry.filters = (entry.codec == BrickCodec::Lz) ? settings.filters : static_cast<uint8_t>(BrickFilterNone);
+					entry.size = static_cast<uint32_t>(compressed.size());
+					index.push_back(entry);
+
+					file.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+					offset += compressed.size();
+				}
+			}
+		}
+	}
+
+	// Pad so the reader can use the index in place.
+	const char padding[alignof(BrickIndexEntry)] = {};
+	size_t paddingBytes = (alignof(BrickIndexEntry) - offset % alignof(BrickIndexEntry)) % alignof(BrickIndexEntry);
+	file.write(padding, paddingBytes);
+	offset += paddingBytes;
+
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(BrickIndexEntry));
+
+	header.indexOffset = offset;
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return static_cast<bool>(file);
+}
+
+bool VolumeShaderTest::ConvertRawToBrickContainer(
+	const DX::FilePath& rawPath,
+	const DX::FilePath& containerPath,
+	uint32_t width,
+	uint32_t height,
+	uint32_t depth,
+	const BrickContainerSettings& settings)
+{
+	bool valid;
+	DX::FileView raw = DX::OpenFileView(rawPath, valid);
+	if (!valid || raw.Size() != static_cast<size_t>(width) * height * depth * sizeof(uint16_t))
+	{
+		return false;
+	}
+
+	return WriteBrickContainer(containerPath, reinterpret_cast<const uint16_t*>(raw.Data()), width, height, depth, settings);
+}
+
+BrickContainerReader::BrickContainerReader() :
+	m_index(nullptr)
+{
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+bool BrickContainerReader::Open(const DX::FilePath& path)
+{
+	bool valid;
+	DX::FileView view = DX::OpenFileView(path, valid);
+	return valid && Open(view);
+}
+
+bool BrickContainerReader::Open(const DX::FileView& view)
+{
+	m_view = DX::FileView();
+	m_levels.clear();
+	m_index = nullptr;
+	memset(&m_header, 0, sizeof(m_header));
+
+	const uint8_t* data = view.Data();
+	uint64_t size = view.Size();
+	if (size < sizeof(BrickContainerHeader))
+	{
+		return false;
+	}
+
+	BrickContainerHeader header;
+	memcpy(&header, data, sizeof(header));
+	uint64_t levelBytes = static_cast<uint64_t>(header.levelCount) * sizeof(BrickLevelInfo);
+	uint64_t indexBytes = static_cast<uint64_t>(header.brickCount) * sizeof(BrickIndexEntry);
+	if (header.magic != BrickContainerMagic || header.version != BrickContainerVersion || header.brickSize == 0 ||
+		header.levelCount == 0 || sizeof(header) + levelBytes > size ||
+		header.indexOffset > size || indexBytes > size - header.indexOffset || header.indexOffset % alignof(BrickIndexEntry) != 0)
+	{
+		return false;
+	}
+
+	std::vector<BrickLevelInfo> levels(header.levelCount);
+	memcpy(levels.data(), data + sizeof(header), levelBytes);
+
+	uint32_t expectedFirst = 0;
+	for (const BrickLevelInfo& level : levels)
+	{
+		BrickLevelInfo check = MakeLevel(level.width, level.height, level.depth, header.brickSize, expectedFirst);
+		if (level.width == 0 || level.height == 0 || level.depth == 0 || level.bricksX != check.bricksX ||
+			level.bricksY != check.bricksY || level.bricksZ != check.bricksZ || level.firstBrick != expectedFirst)
+		{
+			return false;
+		}
+		expectedFirst += level.bricksX * level.bricksY * level.bricksZ;
+	}
+	if (expectedFirst != header.brickCount)
+	{
+		return false;
+	}
+
+	// Entries are read in place, so ReadBrick only checks the index it is given.
+	const BrickIndexEntry* index = reinterpret_cast<const BrickIndexEntry*>(data + header.indexOffset);
+	for (uint32_t i = 0; i < header.brickCount; ++i)
+	{
+		if (index[i].offset > header.indexOffset || index[i].size > header.indexOffset - index[i].offset)
+		{
+			return false;
+		}
+	}
+
+	m_view = view;
+	m_header = header;
+	m_levels.swap(levels);
+	m_index = index;
+	return true;
+}
+
+size_t BrickContainerReader::GetBrickVoxelCount() const
+{
+	size_t size = m_header.brickSize;
+	return size * size * size;
+}
+
+uint32_t BrickContainerReader::GetBrickIndex(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const
+{
+	const BrickLevelInfo& info = m_levels[level];
+	return info.firstBrick + (z * info.bricksY + y) * info.bricksX + x;
+}
+
+bool BrickContainerReader::ReadBrick(uint32_t index, uint16_t* voxels, std::vector<uint8_t>& scratch) const
+{
+	if (index >= m_header.brickCount)
+	{
+		return false;
+	}
+
+	const BrickIndexEntry& entry = m_index[index];
+	return DecompressBrick(
+		m_view.Data() + entry.offset,
+		entry.size,
+		entry.codec,
+		entry.filters,
+		voxels,
+		GetBrickVoxelCount(),
+		scratch);
+}
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Common/FileView.h"
+#include "BrickCodec.h"
+
+namespace VolumeShaderTest
+{
+	// Persistent container for 16-bit scalar volumes: fixed size bricks, each compressed on its own, at several
+	// resolutions.
+	//
+	// Layout, little endian:
+	//   header    BrickContainerHeader
+	//   levels    one BrickLevelInfo per level, full resolution first
+	//   bricks    compressed brick data, back to back
+	//   index     one BrickIndexEntry per brick at header.indexOffset, levels in order, x fastest within a level
+	//
+	// Every brick holds brickSize^3 voxels; bricks past the volume edge repeat the edge voxels. Any brick is
+	// found in O(1) through the index and decoded without touching its neighbors.
+	const uint32_t BrickContainerMagic = 0x43425356;	// "VSBC"
+	const uint32_t BrickContainerVersion = 1;
+
+	struct BrickContainerHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		uint32_t brickSize;
+		uint32_t levelCount;
+		uint32_t brickCount;	// Over all levels.
+		uint64_t indexOffset;
+		uint32_t reserved[6];
+	};
+
+	struct BrickLevelInfo
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		uint32_t bricksX;
+		uint32_t bricksY;
+		uint32_t bricksZ;
+		uint32_t firstBrick;	// Index entry of the level's first brick.
+		uint32_t reserved;
+	};
+
+	struct BrickIndexEntry
+	{
+		uint64_t offset;
+		uint32_t size;
+		BrickCodec codec;
+		uint8_t filters;
+		uint16_t reserved;
+	};
+
+	struct BrickContainerSettings
+	{
+		BrickContainerSettings() : brickSize(32), maxLevels(0), filters(BrickFilterDelta | BrickFilterBitPlane) {}
+
+		uint32_t brickSize;
+		uint32_t maxLevels;		// 0 = halve until a level fits in one brick.
+		uint8_t filters;
+	};
+
+	// Writes a dense volume (x fastest) and its 2x box-filtered levels. Level 0 is read straight from voxels,
+	// which may be a mapped file; each coarser level is built in memory from the one before it.
+	bool WriteBrickContainer(
+		const DX::FilePath& path,
+		const uint16_t* voxels,
+		uint32_t width,
+		uint32_t height,
+		uint32_t depth,
+		const BrickContainerSettings& settings);
+
+	// Converts a headerless little endian 16-bit RAW file. Returns false when its size does not match the dimensions.
+	bool ConvertRawToBrickContainer(
+		const DX::FilePath& rawPath,
+		const DX::FilePath& containerPath,
+		uint32_t width,
+		uint32_t height,
+		uint32_t depth,
+		const BrickContainerSettings& settings);
+
+	// Maps a container and decodes bricks on demand; ReadBrick may be called from several threads at once.
+	class BrickContainerReader
+	{
+	public:
+		BrickContainerReader();
+
+		bool Open(const DX::FilePath& path);
+		// Validates the header, level table and every index entry against the view's size.
+		bool Open(const DX::FileView& view);
+
+		const BrickContainerHeader& GetHeader() const { return m_header; }
+		uint32_t GetLevelCount() const { return m_header.levelCount; }
+		const BrickLevelInfo& GetLevel(uint32_t level) const { return m_levels[level]; }
+		size_t GetBrickVoxelCount() const;
+		uint32_t GetBrickIndex(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const;
+		const BrickIndexEntry& GetBrickEntry(uint32_t index) const { return m_index[index]; }
+
+		// Decodes one brick into voxels, which must hold GetBrickVoxelCount() values.
+		// Scratch belongs to the calling thread and is reused between calls.
+		bool ReadBrick(uint32_t index, uint16_t* voxels, std::vector<uint8_t>& scratch) const;
+
+	private:
+		DX::FileView					m_view;
+		BrickContainerHeader			m_header;
+		std::vector<BrickLevelInfo>		m_levels;
+		const BrickIndexEntry*			m_index;
+	};
+}
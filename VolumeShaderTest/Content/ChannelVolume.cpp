@@ -0,0 +1,228 @@
+﻿#include "pch.h"
+#include "ChannelVolume.h"
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VOLUME_CHANNELS_SSE2 1
+#else
+#define VOLUME_CHANNELS_SSE2 0
+#endif
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// 255 / window width, so quantizing is one subtract and one multiply. A window of zero width packs 0.
+	inline float WindowScale(const ChannelWindow& window)
+	{
+		return (window.maximum > window.minimum) ? 255.0f / (window.maximum - window.minimum) : 0.0f;
+	}
+
+	// Clamps before rounding, in the same order as the SSE2 path, so both round identically. NaN packs as 0.
+	inline uint8_t Quantize(float value, float minimum, float scale)
+	{
+		float scaled = (value - minimum) * scale;
+		scaled = (scaled > 0.0f) ? scaled : 0.0f;
+		scaled = (scaled < 255.0f) ? scaled : 255.0f;
+		return static_cast<uint8_t>(static_cast<int>(scaled + 0.5f));
+	}
+
+#if VOLUME_CHANNELS_SSE2
+	// Sixteen voxels of one channel as bytes.
+	inline __m128i Quantize16(const float* values, __m128 minimum, __m128 scale)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 top = _mm_set1_ps(255.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		__m128i quads[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128 scaled = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(values + i * 4), minimum), scale);
+			scaled = _mm_min_ps(_mm_max_ps(scaled, zero), top);
+			quads[i] = _mm_cvttps_epi32(_mm_add_ps(scaled, half));
+		}
+
+		// Values are already in [0, 255], so the saturating packs only narrow.
+		return _mm_packus_epi16(_mm_packs_epi32(quads[0], quads[1]), _mm_packs_epi32(quads[2], quads[3]));
+	}
+#endif
+}
+
+uint32_t VolumeShaderTest::PackedChannelStride(uint32_t channelCount)
+{
+	return (channelCount <= 2) ? 2 : 4;
+}
+
+void VolumeShaderTest::PackChannelsScalar(const float* const* channels, const ChannelWindow* windows, uint32_t channelCount, size_t voxelCount, uint8_t* packed)
+{
+	uint32_t stride = PackedChannelStride(channelCount);
+	for (uint32_t c = 0; c < stride; ++c)
+	{
+		if (c >= channelCount)
+		{
+			for (size_t i = 0; i < voxelCount; ++i)
+			{
+				packed[i * stride + c] = 0;
+			}
+			continue;
+		}
+
+		float minimum = windows[c].minimum;
+		float scale = WindowScale(windows[c]);
+		const float* values = channels[c];
+		for (size_t i = 0; i < voxelCount; ++i)
+		{
+			packed[i * stride + c] = Quantize(values[i], minimum, scale);
+		}
+	}
+}
+
+void VolumeShaderTest::PackChannels(const float* const* channels, const ChannelWindow* windows, uint32_t channelCount, size_t voxelCount, uint8_t* packed)
+{
+	size_t done = 0;
+#if VOLUME_CHANNELS_SSE2
+	__m128 minimum[MaxVolumeChannels];
+	__m128 scale[MaxVolumeChannels];
+	for (uint32_t c = 0; c < channelCount && c < MaxVolumeChannels; ++c)
+	{
+		minimum[c] = _mm_set1_ps(windows[c].minimum);
+		scale[c] = _mm_set1_ps(WindowScale(windows[c]));
+	}
+
+	// Byte unpacks interleave channel pairs, word unpacks then interleave the pairs into RGBA texels.
+	size_t blocks = (channelCount >= 2 && channelCount <= MaxVolumeChannels) ? voxelCount / 16 : 0;
+	for (size_t block = 0; block < blocks; ++block)
+	{
+		size_t first = block * 16;
+		__m128i bytes[MaxVolumeChannels];
+		for (uint32_t c = 0; c < MaxVolumeChannels; ++c)
+		{
+			bytes[c] = (c < channelCount) ? Quantize16(channels[c] + first, minimum[c], scale[c]) : _mm_setzero_si128();
+		}
+
+		__m128i lowPairs = _mm_unpacklo_epi8(bytes[0], bytes[1]);
+		__m128i highPairs = _mm_unpackhi_epi8(bytes[0], bytes[1]);
+		if (channelCount == 2)
+		{
+			__m128i* out = reinterpret_cast<__m128i*>(packed + first * 2);
+			_mm_storeu_si128(out, lowPairs);
+			_mm_storeu_si128(out + 1, highPairs);
+			continue;
+		}
+
+		__m128i lowPairs23 = _mm_unpacklo_epi8(bytes[2], bytes[3]);
+		__m128i highPairs23 = _mm_unpackhi_epi8(bytes[2], bytes[3]);
+		__m128i* out = reinterpret_cast<__m128i*>(packed + first * 4);
+		_mm_storeu_si128(out, _mm_unpacklo_epi16(lowPairs, lowPairs23));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lowPairs, lowPairs23));
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(highPairs, highPairs23));
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(highPairs, highPairs23));
+	}
+	done = blocks * 16;
+#endif
+
+	// The tail, or everything without SSE2.
+	if (done < voxelCount)
+	{
+		const float* tails[MaxVolumeChannels];
+		for (uint32_t c = 0; c < channelCount && c < MaxVolumeChannels; ++c)
+		{
+			tails[c] = channels[c] + done;
+		}
+		PackChannelsScalar(tails, windows, channelCount, voxelCount - done, packed + done * PackedChannelStride(channelCount));
+	}
+}
+
+void VolumeShaderTest::PackChannelVolume(const ChannelVolume& volume, const std::vector<ChannelWindow>& windows, std::vector<uint8_t>& packed)
+{
+	uint32_t channelCount = (volume.ChannelCount() < MaxVolumeChannels) ? volume.ChannelCount() : MaxVolumeChannels;
+	const float* channels[MaxVolumeChannels];
+	ChannelWindow channelWindows[MaxVolumeChannels];
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		channels[c] = volume.channels[c].data();
+		channelWindows[c] = (c < windows.size()) ? windows[c] : ChannelWindow();
+	}
+
+	packed.resize(volume.VoxelCount() * PackedChannelStride(channelCount));
+	PackChannels(channels, channelWindows, channelCount, volume.VoxelCount(), packed.data());
+}
+
+XMFLOAT4 VolumeShaderTest::SampleTransferFunction(const std::vector<XMFLOAT4>& table, float u)
+{
+	if (table.empty())
+	{
+		return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	// Texel centers sit at (i + 0.5) / size.
+	float position = u * table.size() - 0.5f;
+	position = (position > 0.0f) ? position : 0.0f;
+	size_t last = table.size() - 1;
+	size_t i0 = static_cast<size_t>(position);
+	i0 = (i0 < last) ? i0 : last;
+	size_t i1 = (i0 < last) ? i0 + 1 : last;
+	float f = position - i0;
+	f = (f < 1.0f) ? f : 1.0f;
+
+	const XMFLOAT4& a = table[i0];
+	const XMFLOAT4& b = table[i1];
+	return XMFLOAT4(a.x + (b.x - a.x) * f, a.y + (b.y - a.y) * f, a.z + (b.z - a.z) * f, a.w + (b.w - a.w) * f);
+}
+
+XMFLOAT4 VolumeShaderTest::MixChannels(const float* values, uint32_t channelCount, const std::vector<XMFLOAT4>* tables, const float* weights)
+{
+	float r = 0.0f, g = 0.0f, b = 0.0f, alpha = 0.0f;
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		XMFLOAT4 color = SampleTransferFunction(tables[c], values[c]);
+		float weighted = color.w * weights[c];
+		r += color.x * weighted;
+		g += color.y * weighted;
+		b += color.z * weighted;
+		alpha += weighted;
+	}
+
+	if (alpha <= 0.0f)
+	{
+		return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+	return XMFLOAT4(r / alpha, g / alpha, b / alpha, (alpha < 1.0f) ? alpha : 1.0f);
+}
+
+void VolumeShaderTest::GenerateChannelVolume(ChannelVolume& volume, uint32_t size, uint32_t channelCount)
+{
+	channelCount = (channelCount < MaxVolumeChannels) ? channelCount : MaxVolumeChannels;
+	volume.width = volume.height = volume.depth = size;
+	volume.channels.assign(channelCount, std::vector<float>(volume.VoxelCount()));
+
+	for (uint32_t z = 0; z < size; ++z)
+	{
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				// Centered coordinates in [-1, 1].
+				float px = (x + 0.5f) / size * 2.0f - 1.0f;
+				float py = (y + 0.5f) / size * 2.0f - 1.0f;
+				float pz = (z + 0.5f) / size * 2.0f - 1.0f;
+				float radius = sqrtf(px * px + py * py + pz * pz);
+				size_t index = (static_cast<size_t>(z) * size + y) * size + x;
+
+				float values[MaxVolumeChannels];
+				values[0] = (radius < 1.0f) ? 1.0f - radius : 0.0f;
+				values[1] = expf(-(radius - 0.6f) * (radius - 0.6f) / 0.002f);
+				float hx = px - 0.3f, hy = py + 0.2f, hz = pz - 0.1f;
+				values[2] = expf(-(hx * hx + hy * hy + hz * hz) / 0.02f);
+				values[3] = (px > -0.2f && px < 0.2f) ? 0.5f + 0.5f * py : 0.0f;
+				for (uint32_t c = 0; c < channelCount; ++c)
+				{
+					volume.channels[c][index] = values[c];
+				}
+			}
+		}
+	}
+}
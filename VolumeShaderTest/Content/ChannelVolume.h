@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VolumeShaderTest
+{
+	const uint32_t MaxVolumeChannels = 4;
+
+	// Co-registered scalar channels of one volume, such as CT and PET, each laid out like VolumeData without the
+	// RGBA interleave.
+	struct ChannelVolume
+	{
+		ChannelVolume() : width(0), height(0), depth(0) {}
+
+		size_t VoxelCount() const { return static_cast<size_t>(width) * height * depth; }
+		uint32_t ChannelCount() const { return static_cast<uint32_t>(channels.size()); }
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		std::vector<std::vector<float>> channels;
+	};
+
+	// Values mapped to [0, 1] when quantizing; anything outside clamps.
+	struct ChannelWindow
+	{
+		ChannelWindow() : minimum(0.0f), maximum(1.0f) {}
+		ChannelWindow(float minimum, float maximum) : minimum(minimum), maximum(maximum) {}
+
+		float minimum;
+		float maximum;
+	};
+
+	// Bytes per packed voxel: two channels fill R8G8_UNORM, three or four R8G8B8A8_UNORM with a fourth byte of 0 for
+	// three channels.
+	uint32_t PackedChannelStride(uint32_t channelCount);
+
+	// Quantizes 2 to 4 planar float channels to unorm8 and interleaves them, PackedChannelStride bytes per voxel.
+	// Works 16 voxels at a time with SSE2 where the target has it; PackChannelsScalar writes the same bytes.
+	void PackChannels(const float* const* channels, const ChannelWindow* windows, uint32_t channelCount, size_t voxelCount, uint8_t* packed);
+	void PackChannelsScalar(const float* const* channels, const ChannelWindow* windows, uint32_t channelCount, size_t voxelCount, uint8_t* packed);
+
+	// Packs the whole volume with one window per channel.
+	void PackChannelVolume(const ChannelVolume& volume, const std::vector<ChannelWindow>& windows, std::vector<uint8_t>& packed);
+
+	// Linear lookup with clamp addressing at u in [0, 1], like SampleLevel on a row of the channel texture array.
+	DirectX::XMFLOAT4 SampleTransferFunction(const std::vector<DirectX::XMFLOAT4>& table, float u);
+
+	// Mirror of MixChannels() in SamplePixelShader.hlsl: every channel colored by its own transfer function, mixed by
+	// opacity times weight. The opacities add up and saturate; the color is their weighted average.
+	DirectX::XMFLOAT4 MixChannels(
+		const float* values,
+		uint32_t channelCount,
+		const std::vector<DirectX::XMFLOAT4>* tables,
+		const float* weights);
+
+	// Test data on a size^3 grid: a soft sphere, a thin shell inside it, an off-center hot spot and a slab gradient,
+	// one per channel.
+	void GenerateChannelVolume(ChannelVolume& volume, uint32_t size, uint32_t channelCount);
+}
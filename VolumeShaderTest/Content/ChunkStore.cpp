@@ -0,0 +1,193 @@
+﻿#include "pch.h"
+#include "ChunkStore.h"
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	const uint64_t HeaderBytes = sizeof(ChunkStoreHeader);
+
+	inline uint32_t ClampCoord(int64_t value, uint32_t size)
+	{
+		return static_cast<uint32_t>((value < 0) ? 0 : (value >= size ? size - 1 : value));
+	}
+}
+
+VolumeChunkStore::VolumeChunkStore()
+{
+	memset(&m_header, 0, sizeof(m_header));
+#if defined(_WIN32)
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	m_file = -1;
+#endif
+}
+
+VolumeChunkStore::~VolumeChunkStore()
+{
+	Close();
+}
+
+size_t VolumeChunkStore::GetChunkVoxelCount() const
+{
+	size_t padded = GetPaddedChunkSize();
+	return padded * padded * padded;
+}
+
+bool VolumeChunkStore::Open(const DX::FilePath& path)
+{
+	Close();
+
+#if defined(_WIN32)
+	m_file = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD read = 0;
+	bool headerRead = ReadFile(m_file, &m_header, sizeof(m_header), &read, nullptr) && read == sizeof(m_header);
+#else
+	m_file = open(path.c_str(), O_RDONLY);
+	if (m_file < 0)
+	{
+		return false;
+	}
+
+	bool headerRead = pread(m_file, &m_header, sizeof(m_header), 0) == static_cast<ssize_t>(sizeof(m_header));
+#endif
+
+	if (!headerRead || m_header.magic != ChunkStoreMagic || m_header.version != ChunkStoreVersion || m_header.chunkSize == 0)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void VolumeChunkStore::Close()
+{
+#if defined(_WIN32)
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_file >= 0)
+	{
+		close(m_file);
+		m_file = -1;
+	}
+#endif
+}
+
+bool VolumeChunkStore::ReadChunk(uint32_t index, uint16_t* destination) const
+{
+	if (index >= GetChunkCount())
+	{
+		return false;
+	}
+
+	size_t bytes = GetChunkVoxelCount() * sizeof(uint16_t);
+	uint64_t offset = HeaderBytes + static_cast<uint64_t>(index) * bytes;
+	uint8_t* target = reinterpret_cast<uint8_t*>(destination);
+
+	// Positional reads leave no shared file pointer, so worker threads can read different chunks concurrently.
+	size_t done = 0;
+	while (done < bytes)
+	{
+#if defined(_WIN32)
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>(offset + done);
+		overlapped.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+		DWORD read = 0;
+		if (!ReadFile(m_file, target + done, static_cast<DWORD>(bytes - done), &read, &overlapped) || read == 0)
+		{
+			return false;
+		}
+#else
+		ssize_t read = pread(m_file, target + done, bytes - done, static_cast<off_t>(offset + done));
+		if (read <= 0)
+		{
+			return false;
+		}
+#endif
+		done += static_cast<size_t>(read);
+	}
+	return true;
+}
+
+bool VolumeShaderTest::WriteChunkStore(
+	const DX::FilePath& path,
+	const uint16_t* voxels,
+	uint32_t width,
+	uint32_t height,
+	uint32_t depth,
+	uint32_t chunkSize)
+{
+	if (voxels == nullptr || width == 0 || height == 0 || depth == 0 || chunkSize == 0)
+	{
+		return false;
+	}
+
+	ChunkStoreHeader header = {};
+	header.magic = ChunkStoreMagic;
+	header.version = ChunkStoreVersion;
+	header.width = width;
+	header.height = height;
+	header.depth = depth;
+	header.chunkSize = chunkSize;
+	header.chunksX = (width + chunkSize - 1) / chunkSize;
+	header.chunksY = (height + chunkSize - 1) / chunkSize;
+	header.chunksZ = (depth + chunkSize - 1) / chunkSize;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	uint32_t padded = chunkSize + 2;
+	std::vector<uint16_t> chunk(static_cast<size_t>(padded) * padded * padded);
+	for (uint32_t cz = 0; cz < header.chunksZ; ++cz)
+	{
+		for (uint32_t cy = 0; cy < header.chunksY; ++cy)
+		{
+			for (uint32_t cx = 0; cx < header.chunksX; ++cx)
+			{
+				// Padded voxel (0, 0, 0) sits one voxel before the chunk's first voxel on every axis.
+				int64_t baseX = static_cast<int64_t>(cx) * chunkSize - 1;
+				int64_t baseY = static_cast<int64_t>(cy) * chunkSize - 1;
+				int64_t baseZ = static_cast<int64_t>(cz) * chunkSize - 1;
+
+				size_t out = 0;
+				for (uint32_t z = 0; z < padded; ++z)
+				{
+					size_t sliceOffset = static_cast<size_t>(ClampCoord(baseZ + z, depth)) * height;
+					for (uint32_t y = 0; y < padded; ++y)
+					{
+						const uint16_t* row = voxels + (sliceOffset + ClampCoord(baseY + y, height)) * width;
+						for (uint32_t x = 0; x < padded; ++x)
+						{
+							chunk[out++] = row[ClampCoord(baseX + x, width)];
+						}
+					}
+				}
+
+				file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(uint16_t));
+			}
+		}
+	}
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Common/FileView.h"
+
+namespace VolumeShaderTest
+{
+	// On-disk layout of a 16-bit scalar volume split into cubic chunks for out-of-core rendering.
+	//
+	// A 64 byte header is followed by every chunk in x, then y, then z order. Each chunk stores
+	// (chunkSize + 2)^3 voxels: its own plus a one voxel apron copied from its neighbors (clamped at the
+	// volume edge), so trilinear filtering inside a brick pool slot never reads another slot.
+	const uint32_t ChunkStoreMagic = 0x4B435356;	// "VSCK"
+	const uint32_t ChunkStoreVersion = 1;
+
+	struct ChunkStoreHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		uint32_t chunkSize;
+		uint32_t chunksX;
+		uint32_t chunksY;
+		uint32_t chunksZ;
+		uint32_t reserved[7];
+	};
+
+	class VolumeChunkStore
+	{
+	public:
+		VolumeChunkStore();
+		~VolumeChunkStore();
+
+		VolumeChunkStore(const VolumeChunkStore&) = delete;
+		VolumeChunkStore& operator=(const VolumeChunkStore&) = delete;
+
+		bool Open(const DX::FilePath& path);
+		void Close();
+
+		const ChunkStoreHeader& GetHeader() const { return m_header; }
+		uint32_t GetChunkCount() const { return m_header.chunksX * m_header.chunksY * m_header.chunksZ; }
+		uint32_t GetPaddedChunkSize() const { return m_header.chunkSize + 2; }
+		size_t GetChunkVoxelCount() const;
+		uint32_t GetChunkIndex(uint32_t x, uint32_t y, uint32_t z) const { return (z * m_header.chunksY + y) * m_header.chunksX + x; }
+
+		// Reads one padded chunk into destination, which must hold GetChunkVoxelCount() voxels.
+		// Safe to call from several threads at once.
+		bool ReadChunk(uint32_t index, uint16_t* destination) const;
+
+	private:
+		ChunkStoreHeader	m_header;
+#if defined(_WIN32)
+		void*				m_file;
+#else
+		int					m_file;
+#endif
+	};
+
+	// Splits a dense 16-bit volume (x fastest) into a chunk store file, one chunk in memory at a time.
+	// The voxels can come straight from a mapped RAW file.
+	bool WriteChunkStore(
+		const DX::FilePath& path,
+		const uint16_t* voxels,
+		uint32_t width,
+		uint32_t height,
+		uint32_t depth,
+		uint32_t chunkSize);
+}
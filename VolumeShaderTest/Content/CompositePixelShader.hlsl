@@ -0,0 +1,13 @@
+Texture2D<float4> volumeColor : register(t0);
+
+struct PixelShaderInput
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+// Copies a full resolution volume result into the back buffer; blending is done by the output merger.
+float4 main(PixelShaderInput input) : SV_Target
+{
+    return volumeColor.Load(int3(input.position.xy, 0));
+}
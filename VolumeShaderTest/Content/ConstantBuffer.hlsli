@@ -0,0 +1,39 @@
+// Mirrors ModelViewProjectionConstantBuffer in ShaderStructures.h; keep the two in sync.
+#define MAX_CLIP_PLANES 6 // MaxClipPlanes
+#define STEREO_VIEW_COUNT 2 // StereoViewCount
+
+cbuffer ConstantBuffer : register(b0)
+{
+    float4x4 worldMatrix;
+    float4x4 viewMatrix;
+    float4x4 projectionMatrix;
+    float4x4 worldviewprojection;
+    float4x4 invworldviewprojection;
+    float4x4 invWorldMatrix;
+    float4 cameraPosition;
+    float4 lightPosition;
+    float4 renderTargetSize; // xy: full resolution, zw: volume pass resolution
+    float4 upsampleParams;   // x: depth sigma
+    float4x4 prevWorldViewProjection;
+    float4 temporalParams;   // x: frame index, y: history blend weight, z: steps per frame (0 = 128), w: history valid
+    float4 interleaveParams; // xy: pixel marched inside each block this frame, z: block size (0 = off)
+    float4 importanceParams;     // x: tile size in volume pass pixels (0 = off), y: margin read around each tile
+    float4 importanceThresholds; // x: transparent alpha, y: opaque alpha, z: detailed variance
+    float4 importanceBudgets;    // Fraction of the base steps for empty, transparent, opaque and detailed tiles
+    float4 outOfCoreParams;      // xyz: volume size in chunks (fractional for partial edge chunks), w: chunk size in voxels
+    float4 outOfCorePool;        // xyz: brick pool slots per axis, w: padded chunk size
+    float4 gradientParams;       // x: ambient term of the gradient lighting, y: gain on the stored magnitude
+    float4 distanceParams;       // xyz: distance field size in cells, w: local units per cell distance (0 = off)
+    float4 isosurfaceParams;     // rgb: isosurface albedo, w: ambient term
+    float4 sceneDepthParams;     // x: 1 when the opaque scene depth is bound and limits the march
+    float4 clipParams;           // x: active clip planes, y: 1 when the crop box is active
+    float4 clipPlanes[MAX_CLIP_PLANES]; // xyz: local space normal, w: offset; keeps dot(n, p) + w >= 0
+    float4x4 cropBoxMatrix;      // Local space to crop space, where the kept box spans [-1, 1]
+    float4 compositeParams;      // x: density threshold of the first-hit mode
+    float4 channelParams;        // x: channels packed in the volume texture (format 3)
+    float4 channelWeights;       // Blending weight of each channel's transfer function
+    float4x4 eyeWorldViewProjection[STEREO_VIEW_COUNT]; // Local to clip of the left and right eye
+    float4 eyePositions[STEREO_VIEW_COUNT]; // World space position of each eye
+    float4 stereoParams;         // x: 1 in multi-view mode, yz: size of one eye's target
+    float4 outOfCoreCoarse;      // xyz: volume to coarse texture coordinate scale
+};
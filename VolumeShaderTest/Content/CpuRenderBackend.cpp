@@ -0,0 +1,110 @@
+﻿#include "pch.h"
+#include "CpuRenderBackend.h"
+#include <algorithm>
+#include <thread>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+CpuRenderBackend::CpuRenderBackend(const CpuRenderBackendSettings& settings) :
+	m_settings(settings),
+	m_distanceFieldValid(false)
+{
+	Resize(settings.width, settings.height);
+}
+
+void CpuRenderBackend::SetVolume(const std::shared_ptr<const VolumeData>& volume)
+{
+	m_volume = volume;
+	m_distanceFieldValid = false;
+}
+
+void CpuRenderBackend::SetTransferFunction(const std::vector<XMFLOAT4>& table)
+{
+	m_transferFunction = table;
+}
+
+bool CpuRenderBackend::SetOptions(const RenderOptions& options)
+{
+	m_options = options;
+	return true;
+}
+
+void CpuRenderBackend::Resize(uint32_t width, uint32_t height)
+{
+	m_image.Resize((width > 0) ? width : 1, (height > 0) ? height : 1);
+}
+
+// Generates the default volume and builds the distance field the first time a frame needs them.
+void CpuRenderBackend::PrepareVolume()
+{
+	if (m_volume == nullptr)
+	{
+		std::shared_ptr<VolumeData> generated = std::make_shared<VolumeData>();
+		GenerateFogSphereVolume(*generated, m_settings.generatedVolumeSize);
+		m_volume = generated;
+		m_distanceFieldValid = false;
+	}
+
+	if (m_options.emptySpaceSkipping && !m_distanceFieldValid)
+	{
+		BuildDistanceField(*m_volume, DistanceFieldSettings(), m_distanceField);
+		m_distanceFieldValid = true;
+	}
+}
+
+bool CpuRenderBackend::RenderFrame(const CameraPose& pose, uint32_t frameIndex, RenderFrameStats& stats)
+{
+	PrepareVolume();
+
+	// Same projection as Sample3DSceneRenderer::CreateWindowSizeDependentResources, without a display orientation.
+	uint32_t width = m_image.width;
+	uint32_t height = m_image.height;
+	float aspectRatio = static_cast<float>(width) / height;
+	float fovAngleY = 70.0f * XM_PI / 180.0f;
+	fovAngleY *= (aspectRatio < 1.0f) ? 2.0f : 1.0f;
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(fovAngleY, aspectRatio, 0.001f, 500.0f);
+
+	XMMATRIX world = XMMatrixRotationY(pose.modelRotation);
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&pose.eye), XMLoadFloat3(&pose.target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	RaymarchCamera camera = MakeRaymarchCamera(world, view, projection, pose.eye, pose.lightPosition);
+
+	RaymarchSettings settings;
+	settings.steps = m_settings.steps;
+	settings.shadows = m_options.shadows;
+	settings.frameIndex = frameIndex;
+	settings.composite = m_options.composite;
+	settings.firstHitThreshold = m_options.firstHitThreshold;
+	settings.distanceField = m_options.emptySpaceSkipping ? &m_distanceField : nullptr;
+	settings.transferFunction = m_transferFunction.empty() ? nullptr : &m_transferFunction;
+
+	// One band of rows per thread; the calling thread takes the first.
+	uint32_t threadCount = (m_settings.threadCount > 0) ? m_settings.threadCount : std::thread::hardware_concurrency();
+	threadCount = (std::min)((std::max)(threadCount, 1u), height);
+	m_bandSamples.assign(threadCount, 0);
+
+	std::vector<std::thread> workers;
+	for (uint32_t t = 1; t < threadCount; ++t)
+	{
+		workers.emplace_back([&, t]()
+		{
+			m_bandSamples[t] = ReferenceRaymarcher::RenderRows(*m_volume, camera, settings, m_image, height * t / threadCount, height * (t + 1) / threadCount);
+		});
+	}
+	m_bandSamples[0] = ReferenceRaymarcher::RenderRows(*m_volume, camera, settings, m_image, 0, height / threadCount);
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	m_image.samples = 0;
+	for (uint64_t samples : m_bandSamples)
+	{
+		m_image.samples += samples;
+	}
+
+	// The volume is read in place, so nothing is uploaded.
+	stats.samplesPerPixel = static_cast<double>(m_image.samples) / (static_cast<double>(width) * height);
+	stats.uploadBytes = 0;
+	return true;
+}
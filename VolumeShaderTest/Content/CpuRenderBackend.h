@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "RenderBackend.h"
+#include "DistanceField.h"
+#include "ReferenceRaymarcher.h"
+
+namespace VolumeShaderTest
+{
+	struct CpuRenderBackendSettings
+	{
+		CpuRenderBackendSettings() : width(256), height(256), threadCount(0), steps(128), generatedVolumeSize(256) {}
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t threadCount;			// Rows are split across this many threads; 0 = one per hardware thread.
+		int steps;						// The GPU marches 128.
+		uint32_t generatedVolumeSize;	// Edge of the fog sphere used until SetVolume supplies a volume.
+	};
+
+	// Software backend over ReferenceRaymarcher. Needs no window, device or GPU; frames land in an image the
+	// caller reads back with GetImage.
+	class CpuRenderBackend : public IRenderBackend
+	{
+	public:
+		explicit CpuRenderBackend(const CpuRenderBackendSettings& settings = CpuRenderBackendSettings());
+
+		virtual const char* GetName() const { return "cpu"; }
+		virtual void SetVolume(const std::shared_ptr<const VolumeData>& volume);
+		virtual void SetTransferFunction(const std::vector<DirectX::XMFLOAT4>& table);
+		// The reference raymarcher implements every option.
+		virtual bool SupportsOptions(const RenderOptions&) const { return true; }
+		virtual bool SetOptions(const RenderOptions& options);
+		virtual void Resize(uint32_t width, uint32_t height);
+		virtual uint32_t GetWidth() const { return m_image.width; }
+		virtual uint32_t GetHeight() const { return m_image.height; }
+		virtual bool RenderFrame(const CameraPose& pose, uint32_t frameIndex, RenderFrameStats& stats);
+
+		const ReferenceImage& GetImage() const { return m_image; }
+
+	private:
+		void PrepareVolume();
+
+		CpuRenderBackendSettings			m_settings;
+		RenderOptions						m_options;
+		std::shared_ptr<const VolumeData>	m_volume;
+		std::vector<DirectX::XMFLOAT4>		m_transferFunction;
+		DistanceField						m_distanceField;
+		bool								m_distanceFieldValid;
+		ReferenceImage						m_image;
+		std::vector<uint64_t>				m_bandSamples;
+	};
+}
@@ -0,0 +1,89 @@
+﻿#include "pch.h"
+#include "D3D11RenderBackend.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+D3D11RenderBackend::D3D11RenderBackend(const std::shared_ptr<DX::DeviceResources>& deviceResources, Sample3DSceneRenderer& renderer) :
+	m_deviceResources(deviceResources),
+	m_renderer(renderer),
+	m_uploadedBytes(renderer.GetUploadedBytes())
+{
+}
+
+void D3D11RenderBackend::SetVolume(const std::shared_ptr<const VolumeData>& volume)
+{
+	m_renderer.SetVolume(volume);
+}
+
+void D3D11RenderBackend::SetTransferFunction(const std::vector<XMFLOAT4>& table)
+{
+	m_renderer.SetTransferFunction(table);
+}
+
+bool D3D11RenderBackend::SupportsOptions(const RenderOptions& options) const
+{
+	return m_renderer.SupportsRaymarchOptions(options.shadows, options.emptySpaceSkipping, options.composite);
+}
+
+bool D3D11RenderBackend::SetOptions(const RenderOptions& options)
+{
+	if (!SupportsOptions(options))
+	{
+		return false;
+	}
+
+	m_renderer.SetShadowsEnabled(options.shadows);
+	m_renderer.SetEmptySpaceSkipping(options.emptySpaceSkipping);
+	m_renderer.SetCompositeMode(options.composite, options.firstHitThreshold);
+	return true;
+}
+
+void D3D11RenderBackend::Resize(uint32_t width, uint32_t height)
+{
+	// The logical size is in dips.
+	float dipsPerPixel = 96.0f / m_deviceResources->GetDpi();
+	m_deviceResources->SetLogicalSize(Windows::Foundation::Size(width * dipsPerPixel, height * dipsPerPixel));
+	m_renderer.CreateWindowSizeDependentResources();
+}
+
+uint32_t D3D11RenderBackend::GetWidth() const
+{
+	return static_cast<uint32_t>(m_deviceResources->GetOutputSize().Width);
+}
+
+uint32_t D3D11RenderBackend::GetHeight() const
+{
+	return static_cast<uint32_t>(m_deviceResources->GetOutputSize().Height);
+}
+
+bool D3D11RenderBackend::RenderFrame(const CameraPose& pose, uint32_t frameIndex, RenderFrameStats& stats)
+{
+	if (!m_renderer.IsLoadingComplete())
+	{
+		return false;
+	}
+
+	m_renderer.SetCameraPose(pose);
+
+	// Same target setup as VolumeShaderTestMain::Render.
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	auto viewport = m_deviceResources->GetScreenViewport();
+	context->RSSetViewports(1, &viewport);
+
+	ID3D11RenderTargetView *const targets[1] = { m_deviceResources->GetBackBufferRenderTargetView() };
+	context->OMSetRenderTargets(1, targets, m_deviceResources->GetDepthStencilView());
+	context->ClearRenderTargetView(m_deviceResources->GetBackBufferRenderTargetView(), DirectX::Colors::CornflowerBlue);
+	context->ClearDepthStencilView(m_deviceResources->GetDepthStencilView(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+	// The renderer keeps its own frame count for the jitter.
+	(void)frameIndex;
+	m_renderer.Render();
+	m_deviceResources->Present();
+
+	uint64 uploadedBytes = m_renderer.GetUploadedBytes();
+	stats.samplesPerPixel = -1.0;
+	stats.uploadBytes = uploadedBytes - m_uploadedBytes;
+	m_uploadedBytes = uploadedBytes;
+	return true;
+}
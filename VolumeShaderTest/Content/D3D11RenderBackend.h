@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "..\Common\DeviceResources.h"
+#include "RenderBackend.h"
+#include "Sample3DSceneRenderer.h"
+
+namespace VolumeShaderTest
+{
+	// Direct3D 11 backend over the app's renderer, drawing into the swap chain and presenting it. Call from the
+	// render loop thread with the loop's lock held, like any other use of the renderer.
+	class D3D11RenderBackend : public IRenderBackend
+	{
+	public:
+		D3D11RenderBackend(const std::shared_ptr<DX::DeviceResources>& deviceResources, Sample3DSceneRenderer& renderer);
+
+		virtual const char* GetName() const { return "d3d11"; }
+		virtual void SetVolume(const std::shared_ptr<const VolumeData>& volume);
+		virtual void SetTransferFunction(const std::vector<DirectX::XMFLOAT4>& table);
+		// Supported when the renderer has a raymarch permutation for them; see SupportsRaymarchOptions.
+		virtual bool SupportsOptions(const RenderOptions& options) const;
+		virtual bool SetOptions(const RenderOptions& options);
+		// Sizes the swap chain in pixels at the current DPI.
+		virtual void Resize(uint32_t width, uint32_t height);
+		virtual uint32_t GetWidth() const;
+		virtual uint32_t GetHeight() const;
+		// Not ready until the renderer has finished loading. The GPU does not count samples.
+		virtual bool RenderFrame(const CameraPose& pose, uint32_t frameIndex, RenderFrameStats& stats);
+
+	private:
+		std::shared_ptr<DX::DeviceResources>	m_deviceResources;
+		Sample3DSceneRenderer&					m_renderer;
+		uint64									m_uploadedBytes;	// Renderer upload count at the last frame.
+	};
+}
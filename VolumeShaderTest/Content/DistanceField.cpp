@@ -0,0 +1,329 @@
+﻿#include "pch.h"
+#include "DistanceField.h"
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	const float Infinity = std::numeric_limits<float>::infinity();
+
+	uint32_t ResolveThreadCount(uint32_t requested, size_t work)
+	{
+		uint32_t threadCount = (requested == 0) ? std::thread::hardware_concurrency() : requested;
+		threadCount = (threadCount < 1) ? 1 : threadCount;
+		return (threadCount > work) ? static_cast<uint32_t>(work < 1 ? 1 : work) : threadCount;
+	}
+
+	// Runs body(first, last) over [0, count) split into one contiguous range per thread.
+	template<typename Body>
+	void ParallelRanges(size_t count, uint32_t threadCount, const Body& body)
+	{
+		threadCount = ResolveThreadCount(threadCount, count);
+		if (threadCount == 1)
+		{
+			body(size_t(0), count);
+			return;
+		}
+
+		std::vector<std::thread> workers;
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			size_t first = count * i / threadCount;
+			size_t last = count * (i + 1) / threadCount;
+			workers.emplace_back([&body, first, last]() { body(first, last); });
+		}
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	// One dimensional squared distance transform: output[q] = min over p of (q - p)^2 + input[p]. Builds the lower
+	// envelope of the parabolas rooted at every finite input, then walks it once. vertices and bounds hold n and
+	// n + 1 entries.
+	void TransformLine(const float* input, uint32_t n, float* output, uint32_t* vertices, float* bounds)
+	{
+		int k = -1;
+		for (uint32_t q = 0; q < n; ++q)
+		{
+			if (input[q] == Infinity)
+			{
+				continue;
+			}
+
+			float fq = input[q] + static_cast<float>(q) * q;
+			float s = -Infinity;
+			while (k >= 0)
+			{
+				uint32_t p = vertices[k];
+				s = (fq - (input[p] + static_cast<float>(p) * p)) / (2.0f * (static_cast<float>(q) - p));
+				if (s > bounds[k])
+				{
+					break;
+				}
+				--k;
+				s = -Infinity;
+			}
+
+			++k;
+			vertices[k] = q;
+			bounds[k] = s;
+			bounds[k + 1] = Infinity;
+		}
+
+		if (k < 0)
+		{
+			for (uint32_t q = 0; q < n; ++q)
+			{
+				output[q] = Infinity;
+			}
+			return;
+		}
+
+		k = 0;
+		for (uint32_t q = 0; q < n; ++q)
+		{
+			while (bounds[k + 1] < static_cast<float>(q))
+			{
+				++k;
+			}
+			float offset = static_cast<float>(q) - vertices[k];
+			output[q] = offset * offset + input[vertices[k]];
+		}
+	}
+
+	// Transforms every line of the grid along one axis in place. Line i starts at lineStart(i) and steps by stride.
+	template<typename LineStart>
+	void TransformAxis(float* values, size_t lineCount, uint32_t length, size_t stride, uint32_t threadCount, const LineStart& lineStart)
+	{
+		ParallelRanges(lineCount, threadCount, [&](size_t first, size_t last)
+		{
+			std::vector<float> input(length), output(length), bounds(length + 1);
+			std::vector<uint32_t> vertices(length);
+			for (size_t line = first; line < last; ++line)
+			{
+				float* start = values + lineStart(line);
+				for (uint32_t i = 0; i < length; ++i)
+				{
+					input[i] = start[i * stride];
+				}
+				TransformLine(input.data(), length, output.data(), vertices.data(), bounds.data());
+				for (uint32_t i = 0; i < length; ++i)
+				{
+					start[i * stride] = output[i];
+				}
+			}
+		});
+	}
+
+	// First and last voxel that a trilinear sample anywhere in each cell along one axis can read.
+	void ComputeCellFootprints(uint32_t voxels, uint32_t cells, std::vector<uint32_t>& first, std::vector<uint32_t>& last)
+	{
+		first.resize(cells);
+		last.resize(cells);
+		for (uint32_t i = 0; i < cells; ++i)
+		{
+			int64_t lo = static_cast<int64_t>(floor(static_cast<double>(i) / cells * voxels - 0.5));
+			int64_t hi = static_cast<int64_t>(floor(static_cast<double>(i + 1) / cells * voxels - 0.5)) + 1;
+			first[i] = static_cast<uint32_t>(lo < 0 ? 0 : lo);
+			last[i] = static_cast<uint32_t>(hi >= voxels ? voxels - 1 : hi);
+		}
+	}
+
+	struct CellFootprints
+	{
+		std::vector<uint32_t> first[3];
+		std::vector<uint32_t> last[3];
+	};
+
+	void ComputeFootprints(const VolumeData& volume, const DistanceField& field, CellFootprints& footprints)
+	{
+		ComputeCellFootprints(volume.width, field.width, footprints.first[0], footprints.last[0]);
+		ComputeCellFootprints(volume.height, field.height, footprints.first[1], footprints.last[1]);
+		ComputeCellFootprints(volume.depth, field.depth, footprints.first[2], footprints.last[2]);
+	}
+
+	// Re-tests cells [cellMin, cellMax) and returns whether any of them changed state. A cell is occupied when any
+	// voxel its samples can blend exceeds the threshold; footprints of neighboring cells overlap by the filter's
+	// reach, so each slab of cells reads a little past its own voxels.
+	bool TestCells(
+		const VolumeData& volume,
+		const DistanceFieldSettings& settings,
+		const CellFootprints& footprints,
+		const uint32_t cellMin[3],
+		const uint32_t cellMax[3],
+		DistanceField& field)
+	{
+		std::atomic<bool> changed(false);
+		ParallelRanges(cellMax[2] - cellMin[2], settings.threadCount, [&](size_t first, size_t last)
+		{
+			bool sliceChanged = false;
+			for (uint32_t cz = cellMin[2] + static_cast<uint32_t>(first); cz < cellMin[2] + last; ++cz)
+			{
+				for (uint32_t cy = cellMin[1]; cy < cellMax[1]; ++cy)
+				{
+					for (uint32_t cx = cellMin[0]; cx < cellMax[0]; ++cx)
+					{
+						bool found = false;
+						for (uint32_t z = footprints.first[2][cz]; z <= footprints.last[2][cz] && !found; ++z)
+						{
+							for (uint32_t y = footprints.first[1][cy]; y <= footprints.last[1][cy] && !found; ++y)
+							{
+								const float* row = volume.voxels.data() + volume.Index(0, y, z) + 3;
+								for (uint32_t x = footprints.first[0][cx]; x <= footprints.last[0][cx]; ++x)
+								{
+									if (row[x * 4] > settings.threshold)
+									{
+										found = true;
+										break;
+									}
+								}
+							}
+						}
+
+						uint8_t& cell = field.occupied[field.Index(cx, cy, cz)];
+						sliceChanged |= (cell != (found ? 1 : 0));
+						cell = found ? 1 : 0;
+					}
+				}
+			}
+			if (sliceChanged)
+			{
+				changed = true;
+			}
+		});
+		return changed;
+	}
+}
+
+float DistanceField::Lookup(float u, float v, float w) const
+{
+	if (distance.empty())
+	{
+		return 0.0f;
+	}
+
+	float coords[3] = { u, v, w };
+	uint32_t sizes[3] = { width, height, depth };
+	uint32_t cell[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float c = (coords[axis] < 0.0f) ? 0.0f : (coords[axis] > 1.0f ? 1.0f : coords[axis]);
+		cell[axis] = static_cast<uint32_t>(c * sizes[axis]);
+		cell[axis] = (cell[axis] >= sizes[axis]) ? sizes[axis] - 1 : cell[axis];
+	}
+	return distance[Index(cell[0], cell[1], cell[2])];
+}
+
+void VolumeShaderTest::ComputeSquaredDistanceTransform(
+	const uint8_t* occupied,
+	uint32_t width,
+	uint32_t height,
+	uint32_t depth,
+	uint32_t threadCount,
+	std::vector<float>& squaredDistance)
+{
+	size_t count = static_cast<size_t>(width) * height * depth;
+	squaredDistance.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		squaredDistance[i] = occupied[i] ? 0.0f : Infinity;
+	}
+	if (count == 0)
+	{
+		return;
+	}
+
+	// The transform separates by axis, so each pass only sees the result of the previous one along its own lines.
+	size_t slice = static_cast<size_t>(width) * height;
+	float* values = squaredDistance.data();
+	TransformAxis(values, static_cast<size_t>(height) * depth, width, 1, threadCount,
+		[width](size_t line) { return line * width; });
+	TransformAxis(values, static_cast<size_t>(width) * depth, height, width, threadCount,
+		[width, slice](size_t line) { return (line / width) * slice + line % width; });
+	TransformAxis(values, slice, depth, slice, threadCount,
+		[](size_t line) { return line; });
+}
+
+void VolumeShaderTest::BuildDistanceField(const VolumeData& volume, const DistanceFieldSettings& settings, DistanceField& field)
+{
+	uint32_t cellSize = (settings.cellSize < 1) ? 1 : settings.cellSize;
+	field.width = (volume.width + cellSize - 1) / cellSize;
+	field.height = (volume.height + cellSize - 1) / cellSize;
+	field.depth = (volume.depth + cellSize - 1) / cellSize;
+	field.distance.clear();
+	field.occupied.clear();
+	if (volume.VoxelCount() == 0)
+	{
+		field.width = field.height = field.depth = 0;
+		return;
+	}
+
+	CellFootprints footprints;
+	ComputeFootprints(volume, field, footprints);
+	field.occupied.resize(static_cast<size_t>(field.width) * field.height * field.depth);
+	uint32_t cellMin[3] = { 0, 0, 0 };
+	uint32_t cellMax[3] = { field.width, field.height, field.depth };
+	TestCells(volume, settings, footprints, cellMin, cellMax, field);
+	RecomputeDistances(settings, field);
+}
+
+bool VolumeShaderTest::UpdateOccupancy(
+	const VolumeData& volume,
+	const DistanceFieldSettings& settings,
+	const uint32_t voxelMin[3],
+	const uint32_t voxelMax[3],
+	DistanceField& field)
+{
+	if (field.occupied.size() != static_cast<size_t>(field.width) * field.height * field.depth || field.occupied.empty())
+	{
+		return false;
+	}
+
+	// Footprints grow monotonically along each axis, so the cells reaching the voxels form one contiguous range.
+	CellFootprints footprints;
+	ComputeFootprints(volume, field, footprints);
+	uint32_t sizes[3] = { field.width, field.height, field.depth };
+	uint32_t cellMin[3], cellMax[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		cellMin[axis] = sizes[axis];
+		cellMax[axis] = 0;
+		for (uint32_t i = 0; i < sizes[axis]; ++i)
+		{
+			if (footprints.first[axis][i] < voxelMax[axis] && footprints.last[axis][i] >= voxelMin[axis])
+			{
+				cellMin[axis] = (i < cellMin[axis]) ? i : cellMin[axis];
+				cellMax[axis] = i + 1;
+			}
+		}
+		if (cellMin[axis] >= cellMax[axis])
+		{
+			return false;
+		}
+	}
+
+	return TestCells(volume, settings, footprints, cellMin, cellMax, field);
+}
+
+void VolumeShaderTest::RecomputeDistances(const DistanceFieldSettings& settings, DistanceField& field)
+{
+	// One cell can shorten or lengthen distances anywhere in the grid, so there is no cheaper partial transform;
+	// over the coarse grid the full one costs little next to the voxel scan.
+	ComputeSquaredDistanceTransform(field.occupied.data(), field.width, field.height, field.depth, settings.threadCount, field.distance);
+
+	// Center to center distance e between cells leaves at least e - sqrt(3) between any two points of them. With
+	// nothing occupied a single jump may cross the whole grid.
+	const float cellDiagonal = 1.7320508f;
+	float gridDiagonal = sqrtf(static_cast<float>(field.width) * field.width + static_cast<float>(field.height) * field.height + static_cast<float>(field.depth) * field.depth);
+	for (float& value : field.distance)
+	{
+		float safe = (value == Infinity) ? gridDiagonal : sqrtf(value) - cellDiagonal;
+		value = (safe > 0.0f) ? safe : 0.0f;
+	}
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "VolumeData.h"
+
+namespace VolumeShaderTest
+{
+	struct DistanceFieldSettings
+	{
+		DistanceFieldSettings() : cellSize(4), threshold(0.001f), threadCount(0) {}
+
+		uint32_t cellSize;		// Voxels per cell along each axis.
+		float threshold;		// Opacity above which a voxel is occupied, the same cutoff as the shader's shadow branch.
+		uint32_t threadCount;	// 0 = one per hardware thread.
+	};
+
+	// Empty space distances over a coarse grid of cells, uploaded as an R32_FLOAT Texture3D. Cell i along an axis
+	// covers texture coordinates [i / cells, (i + 1) / cells). Each value is a lower bound, in cell widths, on the
+	// distance from any point in the cell to any point whose trilinear sample can reach an occupied voxel; 0 for
+	// occupied cells and their neighbors.
+	struct DistanceField
+	{
+		DistanceField() : width(0), height(0), depth(0) {}
+
+		size_t Index(uint32_t x, uint32_t y, uint32_t z) const { return (static_cast<size_t>(z) * height + y) * width + x; }
+
+		// Distance at a texture coordinate in [0, 1], clamped like the shader's Load.
+		float Lookup(float u, float v, float w) const;
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		std::vector<float> distance;
+		std::vector<uint8_t> occupied;	// The occupancy grid the distances were computed from.
+	};
+
+	// Exact squared Euclidean distance, in cells, from every cell to the nearest nonzero entry of occupied
+	// (x fastest). Runs the Felzenszwalb-Huttenlocher lower envelope pass along x, then y, then z, with the lines
+	// of each pass split across threads. Cells are infinitely far away when nothing is occupied.
+	void ComputeSquaredDistanceTransform(
+		const uint8_t* occupied,
+		uint32_t width,
+		uint32_t height,
+		uint32_t depth,
+		uint32_t threadCount,
+		std::vector<float>& squaredDistance);
+
+	void BuildDistanceField(const VolumeData& volume, const DistanceFieldSettings& settings, DistanceField& field);
+
+	// Re-tests the occupancy of the cells whose footprint reaches voxels [voxelMin, voxelMax) of a field built by
+	// BuildDistanceField with the same settings, and returns whether any cell changed state. The distances are left
+	// alone so that several edited regions can share one RecomputeDistances.
+	bool UpdateOccupancy(
+		const VolumeData& volume,
+		const DistanceFieldSettings& settings,
+		const uint32_t voxelMin[3],
+		const uint32_t voxelMax[3],
+		DistanceField& field);
+
+	// Recomputes every distance from the field's occupancy grid.
+	void RecomputeDistances(const DistanceFieldSettings& settings, DistanceField& field);
+}
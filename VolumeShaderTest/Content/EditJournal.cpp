@@ -0,0 +1,258 @@
+﻿#include "pch.h"
+#include "EditJournal.h"
+#include "VolumeEditing.h"
+#include <cstring>
+
+using namespace VolumeShaderTest;
+
+EditJournal::EditJournal(const EditJournalSettings& settings) :
+	m_settings(settings),
+	m_position(0),
+	m_counters(std::make_shared<Counters>())
+{
+	m_settings.brickSize = (m_settings.brickSize < 1) ? 1 : m_settings.brickSize;
+	m_size[0] = m_size[1] = m_size[2] = 0;
+	m_brickCounts[0] = m_brickCounts[1] = m_brickCounts[2] = 0;
+	m_counters->versions = 0;
+	m_counters->bytes = 0;
+}
+
+void EditJournal::Reset(const VolumeData& volume)
+{
+	m_steps.clear();
+	m_open = Step();
+	m_position = 0;
+
+	m_size[0] = volume.width;
+	m_size[1] = volume.height;
+	m_size[2] = volume.depth;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		m_brickCounts[axis] = (m_size[axis] + m_settings.brickSize - 1) / m_settings.brickSize;
+	}
+	size_t brickCount = static_cast<size_t>(m_brickCounts[0]) * m_brickCounts[1] * m_brickCounts[2];
+	m_current.assign(brickCount, VersionRef());
+	m_touched.assign(brickCount, 0);
+}
+
+void EditJournal::BeforeEdit(const VolumeData& volume, const VoxelRegion& region)
+{
+	if (region.Empty() || m_current.empty())
+	{
+		return;
+	}
+
+	uint32_t first[3], last[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		first[axis] = region.min[axis] / m_settings.brickSize;
+		last[axis] = (region.max[axis] - 1) / m_settings.brickSize;
+		last[axis] = (last[axis] >= m_brickCounts[axis]) ? m_brickCounts[axis] - 1 : last[axis];
+	}
+
+	for (uint32_t bz = first[2]; bz <= last[2]; ++bz)
+	{
+		for (uint32_t by = first[1]; by <= last[1]; ++by)
+		{
+			for (uint32_t bx = first[0]; bx <= last[0]; ++bx)
+			{
+				uint32_t brick = (bz * m_brickCounts[1] + by) * m_brickCounts[0] + bx;
+				if (m_touched[brick])
+				{
+					continue;
+				}
+
+				// The current version is shared as is; a brick no step has needed yet is copied once here.
+				if (m_current[brick] == nullptr)
+				{
+					m_current[brick] = Capture(volume, brick);
+				}
+				m_touched[brick] = 1;
+				m_open.bricks.push_back(brick);
+				m_open.before.push_back(m_current[brick]);
+			}
+		}
+	}
+}
+
+void EditJournal::CloseStep(const VolumeData& volume)
+{
+	if (!IsStepOpen())
+	{
+		return;
+	}
+
+	// Bricks inside the edit's box that no voxel of changed, such as the corners around a sphere, leave the step.
+	Step step;
+	std::vector<uint32_t> unchanged;
+	for (size_t i = 0; i < m_open.bricks.size(); ++i)
+	{
+		uint32_t brick = m_open.bricks[i];
+		m_touched[brick] = 0;
+
+		VersionRef after = Capture(volume, brick);
+		if (after->voxels == m_open.before[i]->voxels)
+		{
+			unchanged.push_back(brick);
+			continue;
+		}
+		m_current[brick] = after;
+		step.bricks.push_back(brick);
+		step.before.push_back(m_open.before[i]);
+		step.after.push_back(after);
+	}
+	m_open = Step();
+	ReleaseUnreferenced(unchanged);
+
+	if (step.bricks.empty())
+	{
+		return;
+	}
+
+	// A new step replaces whatever could have been redone.
+	std::vector<uint32_t> dropped;
+	for (size_t i = m_position; i < m_steps.size(); ++i)
+	{
+		dropped.insert(dropped.end(), m_steps[i].bricks.begin(), m_steps[i].bricks.end());
+	}
+	m_steps.erase(m_steps.begin() + m_position, m_steps.end());
+	ReleaseUnreferenced(dropped);
+
+	m_steps.push_back(std::move(step));
+	m_position = m_steps.size();
+	Trim();
+}
+
+bool EditJournal::Undo(VolumeData& volume, std::vector<VoxelRegion>& restored)
+{
+	CloseStep(volume);
+	if (m_position == 0)
+	{
+		return false;
+	}
+
+	const Step& step = m_steps[--m_position];
+	for (size_t i = 0; i < step.bricks.size(); ++i)
+	{
+		uint32_t brick = step.bricks[i];
+		Restore(volume, brick, *step.before[i]);
+		m_current[brick] = step.before[i];
+
+		VoxelRegion region;
+		BrickBounds(brick, region.min, region.max);
+		restored.push_back(region);
+	}
+	return true;
+}
+
+bool EditJournal::Redo(VolumeData& volume, std::vector<VoxelRegion>& restored)
+{
+	CloseStep(volume);
+	if (m_position == m_steps.size())
+	{
+		return false;
+	}
+
+	const Step& step = m_steps[m_position++];
+	for (size_t i = 0; i < step.bricks.size(); ++i)
+	{
+		uint32_t brick = step.bricks[i];
+		Restore(volume, brick, *step.after[i]);
+		m_current[brick] = step.after[i];
+
+		VoxelRegion region;
+		BrickBounds(brick, region.min, region.max);
+		restored.push_back(region);
+	}
+	return true;
+}
+
+EditJournalStats EditJournal::GetStats() const
+{
+	EditJournalStats stats = {};
+	stats.undoSteps = static_cast<uint32_t>(m_position);
+	stats.redoSteps = static_cast<uint32_t>(m_steps.size() - m_position);
+	stats.versions = m_counters->versions;
+	stats.versionBytes = m_counters->bytes;
+	return stats;
+}
+
+EditJournal::VersionRef EditJournal::Capture(const VolumeData& volume, uint32_t brick) const
+{
+	uint32_t min[3], max[3];
+	BrickBounds(brick, min, max);
+	size_t rowFloats = static_cast<size_t>(max[0] - min[0]) * 4;
+
+	BrickVersion* version = new BrickVersion();
+	version->voxels.resize(rowFloats * (max[1] - min[1]) * (max[2] - min[2]));
+	float* out = version->voxels.data();
+	for (uint32_t z = min[2]; z < max[2]; ++z)
+	{
+		for (uint32_t y = min[1]; y < max[1]; ++y)
+		{
+			memcpy(out, volume.voxels.data() + volume.Index(min[0], y, z), rowFloats * sizeof(float));
+			out += rowFloats;
+		}
+	}
+
+	uint64_t bytes = version->voxels.size() * sizeof(float);
+	std::shared_ptr<Counters> counters = m_counters;
+	counters->versions += 1;
+	counters->bytes += bytes;
+	return VersionRef(version, [counters, bytes](const BrickVersion* released)
+	{
+		counters->versions -= 1;
+		counters->bytes -= bytes;
+		delete released;
+	});
+}
+
+void EditJournal::Restore(VolumeData& volume, uint32_t brick, const BrickVersion& version) const
+{
+	uint32_t min[3], max[3];
+	BrickBounds(brick, min, max);
+	size_t rowFloats = static_cast<size_t>(max[0] - min[0]) * 4;
+
+	const float* in = version.voxels.data();
+	for (uint32_t z = min[2]; z < max[2]; ++z)
+	{
+		for (uint32_t y = min[1]; y < max[1]; ++y)
+		{
+			memcpy(volume.voxels.data() + volume.Index(min[0], y, z), in, rowFloats * sizeof(float));
+			in += rowFloats;
+		}
+	}
+}
+
+void EditJournal::BrickBounds(uint32_t brick, uint32_t min[3], uint32_t max[3]) const
+{
+	uint32_t coords[3] = { brick % m_brickCounts[0], (brick / m_brickCounts[0]) % m_brickCounts[1], brick / (m_brickCounts[0] * m_brickCounts[1]) };
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		min[axis] = coords[axis] * m_settings.brickSize;
+		max[axis] = (min[axis] + m_settings.brickSize > m_size[axis]) ? m_size[axis] : min[axis] + m_settings.brickSize;
+	}
+}
+
+void EditJournal::ReleaseUnreferenced(const std::vector<uint32_t>& bricks)
+{
+	// A version only the current table still holds is the volume's own content; the next edit recaptures it.
+	for (uint32_t brick : bricks)
+	{
+		if (m_current[brick] != nullptr && m_current[brick].use_count() == 1 && !m_touched[brick])
+		{
+			m_current[brick].reset();
+		}
+	}
+}
+
+void EditJournal::Trim()
+{
+	while (m_position > 0 && (m_steps.size() > m_settings.maxEntries || m_counters->bytes > m_settings.memoryBudget))
+	{
+		std::vector<uint32_t> bricks = std::move(m_steps.front().bricks);
+		m_steps.pop_front();
+		--m_position;
+		ReleaseUnreferenced(bricks);
+	}
+}
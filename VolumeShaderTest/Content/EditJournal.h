@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "VolumeData.h"
+
+namespace VolumeShaderTest
+{
+	struct VoxelRegion;
+
+	struct EditJournalSettings
+	{
+		EditJournalSettings() : brickSize(16), memoryBudget(512ull << 20), maxEntries(256) {}
+
+		uint32_t brickSize;		// Voxels per brick along each axis.
+		uint64_t memoryBudget;	// Bytes of brick versions kept for undo before the oldest steps are dropped.
+		uint32_t maxEntries;	// Undo steps kept.
+	};
+
+	struct EditJournalStats
+	{
+		uint32_t undoSteps;
+		uint32_t redoSteps;
+		uint64_t versions;		// Brick versions alive, each shared by every step that references it.
+		uint64_t versionBytes;
+	};
+
+	// Undo history for a dense RGBA float volume, kept as immutable versions of the bricks that edits touched
+	// rather than as snapshots. Each step references the version of every brick it changed from before and after
+	// the change; the after version of one step is the before version of the next step touching that brick, so a
+	// step costs one brick copy per brick it changed and undo or redo only copies those bricks back.
+	class EditJournal
+	{
+	public:
+		explicit EditJournal(const EditJournalSettings& settings = EditJournalSettings());
+
+		// Forgets all history and sizes the brick grid for the volume.
+		void Reset(const VolumeData& volume);
+
+		// Call before changing voxels in region. Bricks the open step has not touched yet keep their current version.
+		void BeforeEdit(const VolumeData& volume, const VoxelRegion& region);
+
+		// Ends the open step, capturing the new version of each brick it changed. Redo steps are dropped.
+		void CloseStep(const VolumeData& volume);
+		bool IsStepOpen() const { return !m_open.bricks.empty(); }
+
+		// Copy the versions of the last step back into the volume and append the box of each restored brick.
+		// An open step is closed first.
+		bool Undo(VolumeData& volume, std::vector<VoxelRegion>& restored);
+		bool Redo(VolumeData& volume, std::vector<VoxelRegion>& restored);
+
+		EditJournalStats GetStats() const;
+
+	private:
+		struct BrickVersion
+		{
+			std::vector<float> voxels;
+		};
+
+		typedef std::shared_ptr<const BrickVersion> VersionRef;
+
+		struct Step
+		{
+			std::vector<uint32_t> bricks;
+			std::vector<VersionRef> before;
+			std::vector<VersionRef> after;
+		};
+
+		// Live version count and bytes, shared with the deleters so versions can outlive any one step.
+		struct Counters
+		{
+			std::atomic<uint64_t> versions;
+			std::atomic<uint64_t> bytes;
+		};
+
+		VersionRef Capture(const VolumeData& volume, uint32_t brick) const;
+		void Restore(VolumeData& volume, uint32_t brick, const BrickVersion& version) const;
+		void BrickBounds(uint32_t brick, uint32_t min[3], uint32_t max[3]) const;
+		void ReleaseUnreferenced(const std::vector<uint32_t>& bricks);
+		void Trim();
+
+		EditJournalSettings			m_settings;
+		uint32_t					m_size[3];
+		uint32_t					m_brickCounts[3];
+		std::vector<VersionRef>		m_current;		// Version matching the volume per brick, null when no step needs it.
+		std::vector<uint8_t>		m_touched;		// Bricks in the open step.
+		std::deque<Step>			m_steps;
+		size_t						m_position;		// Steps before this one can be undone.
+		Step						m_open;
+		std::shared_ptr<Counters>	m_counters;
+	};
+}
@@ -0,0 +1,14 @@
+struct VS_OUTPUT
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+// Generates a single triangle that covers the whole viewport from SV_VertexID; no vertex buffer is bound.
+VS_OUTPUT main(uint vertexId : SV_VertexID)
+{
+    VS_OUTPUT output;
+    output.uv = float2((vertexId << 1) & 2, vertexId & 2);
+    output.position = float4(output.uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+    return output;
+}
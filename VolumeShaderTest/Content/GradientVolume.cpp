@@ -0,0 +1,303 @@
+﻿#include "pch.h"
+#include "GradientVolume.h"
+#include <cmath>
+#include <thread>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	inline uint32_t ClampCoord(int64_t value, uint32_t size)
+	{
+		return static_cast<uint32_t>((value < 0) ? 0 : (value >= size ? size - 1 : value));
+	}
+
+	inline uint32_t ToUnorm8(float value)
+	{
+		value = (value < 0.0f) ? 0.0f : (value > 1.0f ? 1.0f : value);
+		return static_cast<uint32_t>(value * 255.0f + 0.5f);
+	}
+
+	inline float SignNotZero(float value)
+	{
+		return (value >= 0.0f) ? 1.0f : -1.0f;
+	}
+
+	// Columns and rows of the volume one thread filters.
+	struct SlabBox
+	{
+		uint32_t x;
+		uint32_t width;
+		uint32_t y;
+		uint32_t height;
+	};
+
+	// Padded copies of the z slices one thread needs, three at a time, cut down to the box plus one clamped voxel
+	// on every side. Rows are widened to a multiple of four so the filter can load four voxels at x - 1 and x + 1
+	// without branches. Row r of a slice is volume row box.y + r - 1.
+	class SliceWindow
+	{
+	public:
+		SliceWindow(const float* density, size_t stride, uint32_t width, uint32_t height, uint32_t depth, const SlabBox& box) :
+			m_density(density), m_stride(stride), m_width(width), m_height(height), m_depth(depth), m_box(box)
+		{
+			m_rowLength = ((box.width + 3) & ~3u) + 4;
+			for (int i = 0; i < 3; ++i)
+			{
+				m_slices[i].resize(static_cast<size_t>(m_rowLength) * (box.height + 2));
+				m_sliceIds[i] = -1;
+			}
+		}
+
+		uint32_t GetRowLength() const { return m_rowLength; }
+
+		// Slices are requested in increasing z, so the oldest buffer is always the one to refill.
+		const float* GetSlice(uint32_t z)
+		{
+			int oldest = 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				if (m_sliceIds[i] == static_cast<int64_t>(z))
+				{
+					return m_slices[i].data();
+				}
+				if (m_sliceIds[i] < m_sliceIds[oldest])
+				{
+					oldest = i;
+				}
+			}
+
+			float* slice = m_slices[oldest].data();
+			for (uint32_t r = 0; r < m_box.height + 2; ++r)
+			{
+				uint32_t y = ClampCoord(static_cast<int64_t>(m_box.y) + r - 1, m_height);
+				const float* source = m_density + (static_cast<size_t>(z) * m_height + y) * m_width * m_stride;
+				float* row = slice + static_cast<size_t>(r) * m_rowLength;
+				for (uint32_t x = 0; x < m_rowLength; ++x)
+				{
+					row[x] = source[ClampCoord(static_cast<int64_t>(m_box.x) + x - 1, m_width) * m_stride];
+				}
+			}
+			m_sliceIds[oldest] = z;
+			return slice;
+		}
+
+	private:
+		const float*		m_density;
+		size_t				m_stride;
+		uint32_t			m_width;
+		uint32_t			m_height;
+		uint32_t			m_depth;
+		SlabBox				m_box;
+		uint32_t			m_rowLength;
+		std::vector<float>	m_slices[3];
+		int64_t				m_sliceIds[3];
+	};
+
+	void BuildSlab(
+		const float* density,
+		size_t stride,
+		uint32_t width,
+		uint32_t height,
+		uint32_t depth,
+		SlabBox box,
+		uint32_t firstSlice,
+		uint32_t lastSlice,
+		float maxMagnitude,
+		uint32_t* texels)
+	{
+		SliceWindow window(density, stride, width, height, depth, box);
+		uint32_t rowLength = window.GetRowLength();
+
+		// The separable 3D Sobel kernel is a [-1, 0, 1] difference along one axis and [1, 2, 1] smoothing along
+		// the other two. Smooth and difference across the nine input rows first, then along x.
+		std::vector<float> smoothed(rowLength), diffY(rowLength), diffZ(rowLength);
+		std::vector<float> gradient[3] = { std::vector<float>(rowLength), std::vector<float>(rowLength), std::vector<float>(rowLength) };
+		const XMVECTOR two = XMVectorReplicate(2.0f);
+		const XMVECTOR scale = XMVectorReplicate(1.0f / 32.0f);
+
+		for (uint32_t z = firstSlice; z < lastSlice; ++z)
+		{
+			const float* slices[3];
+			slices[0] = window.GetSlice(ClampCoord(static_cast<int64_t>(z) - 1, depth));
+			slices[1] = window.GetSlice(z);
+			slices[2] = window.GetSlice(ClampCoord(static_cast<int64_t>(z) + 1, depth));
+
+			for (uint32_t y = 0; y < box.height; ++y)
+			{
+				const float* rows[3][3];
+				for (int dz = 0; dz < 3; ++dz)
+				{
+					for (int dy = 0; dy < 3; ++dy)
+					{
+						rows[dz][dy] = slices[dz] + static_cast<size_t>(y + dy) * rowLength;
+					}
+				}
+
+				for (uint32_t x = 0; x < rowLength; x += 4)
+				{
+					XMVECTOR r[3][3];
+					for (int dz = 0; dz < 3; ++dz)
+					{
+						for (int dy = 0; dy < 3; ++dy)
+						{
+							r[dz][dy] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(rows[dz][dy] + x));
+						}
+					}
+
+					// Smoothing along y for each z row, and the y difference.
+					XMVECTOR smoothY[3], differenceY[3];
+					for (int dz = 0; dz < 3; ++dz)
+					{
+						smoothY[dz] = XMVectorMultiplyAdd(r[dz][1], two, XMVectorAdd(r[dz][0], r[dz][2]));
+						differenceY[dz] = XMVectorSubtract(r[dz][2], r[dz][0]);
+					}
+
+					XMVECTOR yz = XMVectorMultiplyAdd(smoothY[1], two, XMVectorAdd(smoothY[0], smoothY[2]));
+					XMVECTOR dy = XMVectorMultiplyAdd(differenceY[1], two, XMVectorAdd(differenceY[0], differenceY[2]));
+					XMVECTOR dz = XMVectorSubtract(smoothY[2], smoothY[0]);
+					XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(smoothed.data() + x), yz);
+					XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(diffY.data() + x), dy);
+					XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(diffZ.data() + x), dz);
+				}
+
+				// Padded element x + 1 is voxel x, so voxel x reads elements x, x + 1 and x + 2.
+				for (uint32_t x = 0; x + 4 <= rowLength - 2; x += 4)
+				{
+					XMVECTOR left = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(smoothed.data() + x));
+					XMVECTOR right = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(smoothed.data() + x + 2));
+					XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(gradient[0].data() + x), XMVectorMultiply(XMVectorSubtract(right, left), scale));
+
+					const std::vector<float>* crossed[2] = { &diffY, &diffZ };
+					for (int axis = 0; axis < 2; ++axis)
+					{
+						const float* values = crossed[axis]->data() + x;
+						XMVECTOR a = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(values));
+						XMVECTOR b = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(values + 1));
+						XMVECTOR c = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(values + 2));
+						XMVECTOR sum = XMVectorMultiplyAdd(b, two, XMVectorAdd(a, c));
+						XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(gradient[axis + 1].data() + x), XMVectorMultiply(sum, scale));
+					}
+				}
+
+				uint32_t* out = texels + (static_cast<size_t>(z) * height + box.y + y) * width + box.x;
+				for (uint32_t x = 0; x < box.width; ++x)
+				{
+					out[x] = PackGradient(gradient[0][x], gradient[1][x], gradient[2][x], maxMagnitude);
+				}
+			}
+		}
+	}
+}
+
+uint32_t VolumeShaderTest::PackGradient(float gx, float gy, float gz, float maxMagnitude)
+{
+	float magnitude = sqrtf(gx * gx + gy * gy + gz * gz);
+	if (magnitude <= 0.0f)
+	{
+		return 0xFF000000u | (128u << 8) | 128u;
+	}
+
+	// Normal = -gradient, projected onto the octahedron and folded into the upper half.
+	float l1 = fabsf(gx) + fabsf(gy) + fabsf(gz);
+	float nx = -gx / l1;
+	float ny = -gy / l1;
+	if (gz > 0.0f)
+	{
+		float fx = (1.0f - fabsf(ny)) * SignNotZero(nx);
+		float fy = (1.0f - fabsf(nx)) * SignNotZero(ny);
+		nx = fx;
+		ny = fy;
+	}
+
+	return ToUnorm8(nx * 0.5f + 0.5f) |
+		(ToUnorm8(ny * 0.5f + 0.5f) << 8) |
+		(ToUnorm8(magnitude / maxMagnitude) << 16) |
+		0xFF000000u;
+}
+
+void VolumeShaderTest::UnpackGradient(uint32_t texel, float maxMagnitude, float normal[3], float& magnitude)
+{
+	float x = (texel & 0xFF) / 255.0f * 2.0f - 1.0f;
+	float y = ((texel >> 8) & 0xFF) / 255.0f * 2.0f - 1.0f;
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f)
+	{
+		float fx = (1.0f - fabsf(y)) * SignNotZero(x);
+		float fy = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = fx;
+		y = fy;
+	}
+
+	float length = sqrtf(x * x + y * y + z * z);
+	normal[0] = x / length;
+	normal[1] = y / length;
+	normal[2] = z / length;
+	magnitude = ((texel >> 16) & 0xFF) / 255.0f * maxMagnitude;
+}
+
+void VolumeShaderTest::BuildGradientVolume(
+	const float* density,
+	size_t stride,
+	uint32_t width,
+	uint32_t height,
+	uint32_t depth,
+	const GradientBuildSettings& settings,
+	std::vector<uint32_t>& texels)
+{
+	texels.resize(static_cast<size_t>(width) * height * depth);
+	if (texels.empty())
+	{
+		return;
+	}
+
+	const uint32_t all[3] = { 0, 0, 0 };
+	const uint32_t size[3] = { width, height, depth };
+	UpdateGradientRegion(density, stride, width, height, depth, all, size, settings, texels);
+}
+
+void VolumeShaderTest::UpdateGradientRegion(
+	const float* density,
+	size_t stride,
+	uint32_t width,
+	uint32_t height,
+	uint32_t depth,
+	const uint32_t voxelMin[3],
+	const uint32_t voxelMax[3],
+	const GradientBuildSettings& settings,
+	std::vector<uint32_t>& texels)
+{
+	uint32_t xMax = (voxelMax[0] > width) ? width : voxelMax[0];
+	uint32_t yMax = (voxelMax[1] > height) ? height : voxelMax[1];
+	uint32_t firstSlice = voxelMin[2];
+	uint32_t lastSlice = (voxelMax[2] > depth) ? depth : voxelMax[2];
+	if (voxelMin[0] >= xMax || voxelMin[1] >= yMax || firstSlice >= lastSlice || texels.size() != static_cast<size_t>(width) * height * depth)
+	{
+		return;
+	}
+
+	SlabBox box = { voxelMin[0], xMax - voxelMin[0], voxelMin[1], yMax - voxelMin[1] };
+
+	uint32_t slices = lastSlice - firstSlice;
+	uint32_t threadCount = settings.threadCount;
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+	threadCount = (threadCount < 1) ? 1 : (threadCount > slices ? slices : threadCount);
+
+	// Each thread re-reads the two slices around its slab, which is cheap next to the filtering.
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		uint32_t first = firstSlice + static_cast<uint32_t>(static_cast<uint64_t>(slices) * i / threadCount);
+		uint32_t last = firstSlice + static_cast<uint32_t>(static_cast<uint64_t>(slices) * (i + 1) / threadCount);
+		workers.emplace_back(BuildSlab, density, stride, width, height, depth, box, first, last, settings.maxMagnitude, texels.data());
+	}
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
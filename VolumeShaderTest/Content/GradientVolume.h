@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VolumeShaderTest
+{
+	// Density gradients packed for DXGI_FORMAT_R8G8B8A8_UNORM: rg hold the octahedral encoded surface normal
+	// (the negated, normalized gradient, pointing out of dense regions), b the gradient magnitude divided by
+	// maxMagnitude and clamped, a is unused. Magnitudes are in density units per voxel.
+	struct GradientBuildSettings
+	{
+		GradientBuildSettings() : threadCount(0), maxMagnitude(0.8660254f) {}
+
+		uint32_t threadCount;	// 0 = one per hardware thread.
+		float maxMagnitude;		// The largest 3D Sobel response for densities in [0, 1] is sqrt(3) / 2.
+	};
+
+	uint32_t PackGradient(float gx, float gy, float gz, float maxMagnitude);
+	void UnpackGradient(uint32_t texel, float maxMagnitude, float normal[3], float& magnitude);
+
+	// Sobel filters the density (element i at density[i * stride], x fastest) with clamped edges into one texel
+	// per voxel. Slabs of z slices run on separate threads; each row is filtered four voxels at a time.
+	void BuildGradientVolume(
+		const float* density,
+		size_t stride,
+		uint32_t width,
+		uint32_t height,
+		uint32_t depth,
+		const GradientBuildSettings& settings,
+		std::vector<uint32_t>& texels);
+
+	// Refilters texels [voxelMin, voxelMax) of a volume built by BuildGradientVolume. After an edit, pass the edited
+	// box grown by one voxel, which is as far as the filter reaches.
+	void UpdateGradientRegion(
+		const float* density,
+		size_t stride,
+		uint32_t width,
+		uint32_t height,
+		uint32_t depth,
+		const uint32_t voxelMin[3],
+		const uint32_t voxelMax[3],
+		const GradientBuildSettings& settings,
+		std::vector<uint32_t>& texels);
+}
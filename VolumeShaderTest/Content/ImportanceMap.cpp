@@ -0,0 +1,182 @@
+﻿#include "pch.h"
+#include "ImportanceMap.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	TileClass ClassifyRegion(
+		const ReferenceImage& image,
+		const ImportanceSettings& settings,
+		int minX,
+		int minY,
+		int maxX,
+		int maxY)
+	{
+		// Same single pass statistics as ImportancePixelShader.hlsl.
+		float hits = 0.0f;
+		float alphaSum = 0.0f;
+		float alphaSquaredSum = 0.0f;
+		float minAlpha = 1.0f;
+		float maxAlpha = 0.0f;
+		for (int y = minY; y < maxY; ++y)
+		{
+			for (int x = minX; x < maxX; ++x)
+			{
+				size_t pixel = static_cast<size_t>(y) * image.width + x;
+				if (image.entryDepth[pixel] < 0.0f)
+				{
+					continue;
+				}
+
+				float alpha = image.color[pixel].w;
+				hits += 1.0f;
+				alphaSum += alpha;
+				alphaSquaredSum += alpha * alpha;
+				minAlpha = (alpha < minAlpha) ? alpha : minAlpha;
+				maxAlpha = (alpha > maxAlpha) ? alpha : maxAlpha;
+			}
+		}
+
+		if (hits == 0.0f)
+		{
+			return TileClass::Empty;
+		}
+
+		float mean = alphaSum / hits;
+		float variance = alphaSquaredSum / hits - mean * mean;
+		if (variance > settings.varianceThreshold)
+		{
+			return TileClass::Detailed;
+		}
+		if (maxAlpha < settings.emptyAlpha)
+		{
+			return TileClass::Transparent;
+		}
+		if (minAlpha >= settings.opaqueAlpha)
+		{
+			return TileClass::Opaque;
+		}
+		return TileClass::Detailed;
+	}
+}
+
+int VolumeShaderTest::GetBudgetedSteps(int baseSteps, float budget)
+{
+	int steps = static_cast<int>(ceilf(baseSteps * budget));
+	return (steps > 1) ? steps : 1;
+}
+
+ImportanceMap::ImportanceMap() :
+	m_width(0),
+	m_height(0),
+	m_tilesX(0),
+	m_tilesY(0)
+{
+}
+
+void ImportanceMap::Classify(const ReferenceImage& previous, const ImportanceSettings& settings)
+{
+	m_settings = settings;
+	m_settings.tileSize = (settings.tileSize > 0) ? settings.tileSize : 1;
+	m_width = previous.width;
+	m_height = previous.height;
+	m_tilesX = (m_width + m_settings.tileSize - 1) / m_settings.tileSize;
+	m_tilesY = (m_height + m_settings.tileSize - 1) / m_settings.tileSize;
+	m_classes.assign(static_cast<size_t>(m_tilesX) * m_tilesY, TileClass::Detailed);
+
+	int tileSize = static_cast<int>(m_settings.tileSize);
+	int margin = static_cast<int>(m_settings.margin);
+	for (uint32_t tileY = 0; tileY < m_tilesY; ++tileY)
+	{
+		for (uint32_t tileX = 0; tileX < m_tilesX; ++tileX)
+		{
+			int minX = static_cast<int>(tileX) * tileSize - margin;
+			int minY = static_cast<int>(tileY) * tileSize - margin;
+			int maxX = minX + tileSize + 2 * margin;
+			int maxY = minY + tileSize + 2 * margin;
+			minX = (minX > 0) ? minX : 0;
+			minY = (minY > 0) ? minY : 0;
+			maxX = (maxX < static_cast<int>(m_width)) ? maxX : static_cast<int>(m_width);
+			maxY = (maxY < static_cast<int>(m_height)) ? maxY : static_cast<int>(m_height);
+
+			m_classes[static_cast<size_t>(tileY) * m_tilesX + tileX] =
+				ClassifyRegion(previous, m_settings, minX, minY, maxX, maxY);
+		}
+	}
+}
+
+float ImportanceMap::GetBudget(uint32_t pixelX, uint32_t pixelY) const
+{
+	if (m_classes.empty())
+	{
+		return 1.0f;
+	}
+
+	uint32_t tileX = pixelX / m_settings.tileSize;
+	uint32_t tileY = pixelY / m_settings.tileSize;
+	tileX = (tileX < m_tilesX) ? tileX : m_tilesX - 1;
+	tileY = (tileY < m_tilesY) ? tileY : m_tilesY - 1;
+	return m_settings.budget[static_cast<int>(GetClass(tileX, tileY))];
+}
+
+ImportanceStats ImportanceMap::GetStats(int baseSteps) const
+{
+	ImportanceStats stats = {};
+	stats.tiles = m_tilesX * m_tilesY;
+
+	for (uint32_t tileY = 0; tileY < m_tilesY; ++tileY)
+	{
+		for (uint32_t tileX = 0; tileX < m_tilesX; ++tileX)
+		{
+			TileClass tileClass = GetClass(tileX, tileY);
+			stats.tilesPerClass[static_cast<int>(tileClass)]++;
+
+			// Edge tiles only cover the pixels left inside the image.
+			uint32_t tileWidth = m_width - tileX * m_settings.tileSize;
+			uint32_t tileHeight = m_height - tileY * m_settings.tileSize;
+			tileWidth = (tileWidth < m_settings.tileSize) ? tileWidth : m_settings.tileSize;
+			tileHeight = (tileHeight < m_settings.tileSize) ? tileHeight : m_settings.tileSize;
+
+			uint64_t pixels = static_cast<uint64_t>(tileWidth) * tileHeight;
+			stats.stepsBudgeted += pixels * GetBudgetedSteps(baseSteps, m_settings.budget[static_cast<int>(tileClass)]);
+			stats.stepsFull += pixels * baseSteps;
+		}
+	}
+	return stats;
+}
+
+uint64_t VolumeShaderTest::RenderWithImportance(
+	const VolumeData& volume,
+	const RaymarchCamera& camera,
+	const RaymarchSettings& settings,
+	const ImportanceMap& map,
+	ReferenceImage& image)
+{
+	image.Resize(image.width, image.height);
+
+	RaymarchSettings pixelSettings = settings;
+	for (uint32_t y = 0; y < image.height; ++y)
+	{
+		for (uint32_t x = 0; x < image.width; ++x)
+		{
+			pixelSettings.steps = GetBudgetedSteps(settings.steps, map.GetBudget(x, y));
+			pixelSettings.opacityCorrection = static_cast<float>(settings.steps) / pixelSettings.steps;
+
+			size_t pixel = static_cast<size_t>(y) * image.width + x;
+			image.color[pixel] = ReferenceRaymarcher::TracePixel(
+				volume,
+				camera,
+				pixelSettings,
+				x + 0.5f,
+				y + 0.5f,
+				image.width,
+				image.height,
+				image.entryDepth[pixel],
+				image.weightedDepth[pixel],
+				image.samples);
+		}
+	}
+	return image.samples;
+}
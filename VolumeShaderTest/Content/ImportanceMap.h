@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include "ReferenceRaymarcher.h"
+
+namespace VolumeShaderTest
+{
+	// What the previous frame showed inside a screen tile, in order of increasing step budget.
+	enum class TileClass : uint8_t
+	{
+		Empty,			// No pixel hit the volume box.
+		Transparent,	// Every pixel stayed below emptyAlpha.
+		Opaque,			// Every pixel saturated above opaqueAlpha with little variation.
+		Detailed,		// Anything else; marched at the full step count.
+		Count
+	};
+
+	// Mirrors importanceParams, importanceThresholds and importanceBudgets in ConstantBuffer.hlsli.
+	struct ImportanceSettings
+	{
+		ImportanceSettings() :
+			tileSize(16),
+			margin(4),
+			emptyAlpha(0.02f),
+			opaqueAlpha(0.95f),
+			varianceThreshold(0.005f)
+		{
+			budget[static_cast<int>(TileClass::Empty)] = 0.125f;
+			budget[static_cast<int>(TileClass::Transparent)] = 0.25f;
+			budget[static_cast<int>(TileClass::Opaque)] = 0.5f;
+			budget[static_cast<int>(TileClass::Detailed)] = 1.0f;
+		}
+
+		uint32_t tileSize;			// Pixels of the volume pass per tile side.
+		uint32_t margin;			// Pixels read around each tile so content moving in is not undersampled.
+		float emptyAlpha;
+		float opaqueAlpha;
+		float varianceThreshold;	// Alpha variance above which a tile is always Detailed.
+		float budget[static_cast<int>(TileClass::Count)];	// Fraction of the base step count per class.
+	};
+
+	struct ImportanceStats
+	{
+		uint32_t tiles;
+		uint32_t tilesPerClass[static_cast<int>(TileClass::Count)];
+		uint64_t stepsBudgeted;		// Sum of the per-pixel step budgets over the image.
+		uint64_t stepsFull;			// The same sum at the base step count.
+	};
+
+	// Steps a pixel marches for a budget fraction, identical to SamplePixelShader.hlsl.
+	int GetBudgetedSteps(int baseSteps, float budget);
+
+	// CPU mirror of ImportancePixelShader.hlsl: classifies screen tiles of the previous frame's volume pass
+	// and assigns each a fraction of the base step count for the next one.
+	class ImportanceMap
+	{
+	public:
+		ImportanceMap();
+
+		// previous must carry the color and entry depth of the last volume pass at the resolution about to be marched.
+		void Classify(const ReferenceImage& previous, const ImportanceSettings& settings);
+
+		ImportanceStats GetStats(int baseSteps) const;
+
+		uint32_t GetTilesX() const { return m_tilesX; }
+		uint32_t GetTilesY() const { return m_tilesY; }
+		TileClass GetClass(uint32_t tileX, uint32_t tileY) const { return m_classes[static_cast<size_t>(tileY) * m_tilesX + tileX]; }
+		float GetBudget(uint32_t pixelX, uint32_t pixelY) const;
+
+	private:
+		ImportanceSettings		m_settings;
+		uint32_t				m_width;
+		uint32_t				m_height;
+		uint32_t				m_tilesX;
+		uint32_t				m_tilesY;
+		std::vector<TileClass>	m_classes;
+	};
+
+	// Renders image at its current size with each pixel marching its budgeted steps, with the per-step opacity
+	// corrected so the result converges to the full step count. Returns the volume fetches taken; compare with
+	// the samples of a plain ReferenceRaymarcher::Render to get the samples saved.
+	uint64_t RenderWithImportance(
+		const VolumeData& volume,
+		const RaymarchCamera& camera,
+		const RaymarchSettings& settings,
+		const ImportanceMap& map,
+		ReferenceImage& image);
+}
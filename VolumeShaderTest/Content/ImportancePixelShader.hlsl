@@ -0,0 +1,59 @@
+Texture2D<float4> previousColor : register(t0);
+Texture2D<float2> previousRayDepth : register(t1);
+
+#include "ConstantBuffer.hlsli"
+
+struct PixelShaderInput
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+// Classifies one screen tile of the previous volume pass and writes the fraction of the base step count
+// the next pass marches there. Mirrors ImportanceMap::Classify on the CPU.
+float main(PixelShaderInput input) : SV_Target
+{
+    int tileSize = int(importanceParams.x);
+    int margin = int(importanceParams.y);
+    int2 tile = int2(input.position.xy);
+
+    uint width, height;
+    previousColor.GetDimensions(width, height);
+    int2 minPixel = max(tile * tileSize - margin, int2(0, 0));
+    int2 maxPixel = min(tile * tileSize + tileSize + margin, int2(width, height));
+
+    float hits = 0.0f;
+    float alphaSum = 0.0f;
+    float alphaSquaredSum = 0.0f;
+    float minAlpha = 1.0f;
+    float maxAlpha = 0.0f;
+    for (int y = minPixel.y; y < maxPixel.y; y++)
+    {
+        for (int x = minPixel.x; x < maxPixel.x; x++)
+        {
+            // Pixels that missed the box keep the cleared entry depth of -1.
+            if (previousRayDepth.Load(int3(x, y, 0)).x < 0.0f)
+                continue;
+
+            float alpha = previousColor.Load(int3(x, y, 0)).a;
+            hits += 1.0f;
+            alphaSum += alpha;
+            alphaSquaredSum += alpha * alpha;
+            minAlpha = min(minAlpha, alpha);
+            maxAlpha = max(maxAlpha, alpha);
+        }
+    }
+
+    if (hits == 0.0f)
+        return importanceBudgets.x;
+
+    float mean = alphaSum / hits;
+    float variance = alphaSquaredSum / hits - mean * mean;
+    if (variance > importanceThresholds.z)
+        return importanceBudgets.w;
+    if (maxAlpha < importanceThresholds.x)
+        return importanceBudgets.y;
+    if (minAlpha >= importanceThresholds.y)
+        return importanceBudgets.z;
+    return importanceBudgets.w;
+}
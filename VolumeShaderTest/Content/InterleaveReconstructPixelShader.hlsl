@@ -0,0 +1,87 @@
+Texture2D<float4> marchedColor : register(t0);
+Texture2D<float2> marchedRayDepth : register(t1);
+Texture2D<float4> historyColor : register(t2);
+SamplerState linearSampler : register(s0);
+
+#include "ConstantBuffer.hlsli"
+#include "RayClip.hlsli"
+
+struct PixelShaderInput
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+float2 IntersectBox(float3 ro, float3 rd, float3 boxMin, float3 boxMax)
+{
+    float3 invRd = 1.0f / (rd + 1e-6f);
+    float3 t0 = (boxMin - ro) * invRd;
+    float3 t1 = (boxMax - ro) * invRd;
+    
+    float3 tMin = min(t0, t1);
+    float3 tMax = max(t0, t1);
+    
+    float tNear = max(max(tMin.x, tMin.y), tMin.z);
+    float tFar = min(min(tMax.x, tMax.y), tMax.z);
+    return float2(tNear, tFar);
+}
+
+// Rebuilds the full resolution image from the one pixel per block marched this frame.
+float4 main(PixelShaderInput input) : SV_Target
+{
+    int2 pixel = int2(input.position.xy);
+    int blockSize = int(interleaveParams.z);
+
+    uint lowWidth, lowHeight;
+    marchedColor.GetDimensions(lowWidth, lowHeight);
+    int2 maxLow = int2(lowWidth, lowHeight) - 1;
+    int2 low = min(pixel / blockSize, maxLow);
+
+    // 1. The pixel marched this frame is copied as is.
+    float4 fresh = marchedColor.Load(int3(low, 0));
+    if (all(pixel % blockSize == int2(interleaveParams.xy)))
+        return fresh;
+
+    // 2. Pixels whose own ray misses the box or is clipped away stay empty.
+    float2 ndc = float2(input.position.x / renderTargetSize.x * 2.0f - 1.0f, 1.0f - input.position.y / renderTargetSize.y * 2.0f);
+    float4 farPoint = mul(float4(ndc, 1.0f, 1.0f), invworldviewprojection);
+    float3 localCam = mul(float4(cameraPosition.xyz, 1.0f), invWorldMatrix).xyz;
+    float3 rayDir = normalize(farPoint.xyz / farPoint.w - localCam);
+
+    float2 t = IntersectBox(localCam, rayDir, float3(-0.5f, -0.5f, -0.5f), float3(0.5f, 0.5f, 0.5f));
+    t = ClipRay(localCam, rayDir, float2(max(t.x, 0.0f), t.y));
+    float tEntry = t.x;
+    if (tEntry > t.y)
+        return float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    if (temporalParams.w == 0.0f)
+        return fresh;
+
+    // 3. Reproject at the nearest fresh sample's weighted depth.
+    float weightedDepth = marchedRayDepth.Load(int3(low, 0)).y;
+    float3 localPoint = localCam + rayDir * ((weightedDepth >= 0.0f) ? weightedDepth : tEntry);
+    float4 prevClip = mul(float4(localPoint, 1.0f), prevWorldViewProjection);
+    if (prevClip.w <= 0.0f)
+        return fresh;
+
+    float2 prevUV = float2(prevClip.x / prevClip.w * 0.5f + 0.5f, -prevClip.y / prevClip.w * 0.5f + 0.5f);
+    if (any(prevUV < 0.0f) || any(prevUV > 1.0f))
+        return fresh;
+
+    // 4. Clamp against the fresh 3x3 neighborhood so disoccluded history cannot persist.
+    float4 minColor = fresh;
+    float4 maxColor = fresh;
+    [unroll]
+    for (int y = -1; y <= 1; y++)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; x++)
+        {
+            float4 neighbor = marchedColor.Load(int3(clamp(low + int2(x, y), int2(0, 0), maxLow), 0));
+            minColor = min(minColor, neighbor);
+            maxColor = max(maxColor, neighbor);
+        }
+    }
+
+    return clamp(historyColor.SampleLevel(linearSampler, prevUV, 0), minColor, maxColor);
+}
@@ -0,0 +1,197 @@
+﻿#include "pch.h"
+#include "InterleavedSampling.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// Recursive Bayer index: M(2n) = [4M, 4M + 2; 4M + 3, 4M + 1].
+	uint32_t BayerIndex(uint32_t x, uint32_t y, uint32_t size)
+	{
+		if (size <= 1)
+		{
+			return 0;
+		}
+
+		uint32_t half = size / 2;
+		static const uint32_t quadrant[2][2] = { { 0, 2 }, { 3, 1 } };
+		return 4 * BayerIndex(x % half, y % half, half) + quadrant[y >= half ? 1 : 0][x >= half ? 1 : 0];
+	}
+
+	inline float Clamp(float value, float lo, float hi)
+	{
+		return (value < lo) ? lo : (value > hi ? hi : value);
+	}
+}
+
+void VolumeShaderTest::GetInterleaveOffset(uint32_t patternSize, uint32_t frameIndex, uint32_t& offsetX, uint32_t& offsetY)
+{
+	offsetX = 0;
+	offsetY = 0;
+	if (patternSize <= 1)
+	{
+		return;
+	}
+
+	uint32_t target = frameIndex % (patternSize * patternSize);
+	for (uint32_t y = 0; y < patternSize; ++y)
+	{
+		for (uint32_t x = 0; x < patternSize; ++x)
+		{
+			if (BayerIndex(x, y, patternSize) == target)
+			{
+				offsetX = x;
+				offsetY = y;
+				return;
+			}
+		}
+	}
+}
+
+InterleavedReconstructor::InterleavedReconstructor() :
+	m_historyValid(false)
+{
+	XMStoreFloat4x4(&m_prevWorldViewProjection, XMMatrixIdentity());
+}
+
+void InterleavedReconstructor::Reset()
+{
+	m_historyValid = false;
+}
+
+InterleaveStats InterleavedReconstructor::RenderFrame(
+	const VolumeData& volume,
+	const RaymarchCamera& camera,
+	FXMMATRIX worldViewProjection,
+	const RaymarchSettings& settings,
+	uint32_t patternSize,
+	uint32_t frameIndex,
+	uint32_t width,
+	uint32_t height)
+{
+	InterleaveStats stats = {};
+	uint32_t n = (patternSize > 0) ? patternSize : 1;
+
+	uint32_t offsetX, offsetY;
+	GetInterleaveOffset(n, frameIndex, offsetX, offsetY);
+
+	// 1. March one pixel per block; the reduced image is what the GPU writes at 1/n resolution.
+	uint32_t lowWidth = (width + n - 1) / n;
+	uint32_t lowHeight = (height + n - 1) / n;
+	m_marched.Resize(lowWidth, lowHeight);
+
+	RaymarchSettings frameSettings = settings;
+	frameSettings.frameIndex = frameIndex;
+	for (uint32_t ly = 0; ly < lowHeight; ++ly)
+	{
+		for (uint32_t lx = 0; lx < lowWidth; ++lx)
+		{
+			uint32_t px = lx * n + offsetX;
+			uint32_t py = ly * n + offsetY;
+			if (px >= width || py >= height)
+			{
+				continue;
+			}
+
+			size_t index = static_cast<size_t>(ly) * lowWidth + lx;
+			m_marched.color[index] = ReferenceRaymarcher::TracePixel(
+				volume,
+				camera,
+				frameSettings,
+				px + 0.5f,
+				py + 0.5f,
+				width,
+				height,
+				m_marched.entryDepth[index],
+				m_marched.weightedDepth[index],
+				stats.samples);
+			stats.raysMarched++;
+		}
+	}
+
+	// 2. Reconstruct the full image: fresh pixels are copied, the rest come from the reprojected history.
+	bool canReproject = m_historyValid && m_history.width == width && m_history.height == height;
+	XMMATRIX prevMatrix = XMLoadFloat4x4(&m_prevWorldViewProjection);
+	m_resolved.Resize(width, height);
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			size_t pixel = static_cast<size_t>(y) * width + x;
+			uint32_t lx = (x / n < lowWidth) ? x / n : lowWidth - 1;
+			uint32_t ly = (y / n < lowHeight) ? y / n : lowHeight - 1;
+			size_t low = static_cast<size_t>(ly) * lowWidth + lx;
+			const XMFLOAT4& fresh = m_marched.color[low];
+
+			if (x % n == offsetX && y % n == offsetY)
+			{
+				m_resolved.color[pixel] = fresh;
+				m_resolved.entryDepth[pixel] = m_marched.entryDepth[low];
+				m_resolved.weightedDepth[pixel] = m_marched.weightedDepth[low];
+				continue;
+			}
+
+			XMFLOAT3 ro, rd;
+			float tEntry, tExit;
+			if (!ReferenceRaymarcher::ComputeRay(camera, x + 0.5f, y + 0.5f, width, height, ro, rd, tEntry, tExit))
+			{
+				continue;
+			}
+
+			m_resolved.entryDepth[pixel] = tEntry;
+			m_resolved.weightedDepth[pixel] = tEntry;
+			m_resolved.color[pixel] = fresh;
+			if (!canReproject)
+			{
+				continue;
+			}
+
+			// Reproject the point at the nearest fresh sample's weighted depth.
+			float depth = (m_marched.weightedDepth[low] >= 0.0f) ? m_marched.weightedDepth[low] : tEntry;
+			XMVECTOR localPoint = XMVectorSet(ro.x + rd.x * depth, ro.y + rd.y * depth, ro.z + rd.z * depth, 1.0f);
+			XMVECTOR prevClip = XMVector4Transform(localPoint, prevMatrix);
+			float w = XMVectorGetW(prevClip);
+			float u = (w > 0.0f) ? XMVectorGetX(prevClip) / w * 0.5f + 0.5f : -1.0f;
+			float v = (w > 0.0f) ? -XMVectorGetY(prevClip) / w * 0.5f + 0.5f : -1.0f;
+			if (u < 0.0f || v < 0.0f || u > 1.0f || v > 1.0f)
+			{
+				stats.rejected++;
+				continue;
+			}
+
+			// Clamp against the 3x3 fresh neighborhood so disoccluded history cannot persist.
+			XMFLOAT4 lo = fresh, hi = fresh;
+			for (int dy = -1; dy <= 1; ++dy)
+			{
+				for (int dx = -1; dx <= 1; ++dx)
+				{
+					int nx = static_cast<int>(lx) + dx;
+					int ny = static_cast<int>(ly) + dy;
+					nx = (nx < 0) ? 0 : (nx >= static_cast<int>(lowWidth) ? lowWidth - 1 : nx);
+					ny = (ny < 0) ? 0 : (ny >= static_cast<int>(lowHeight) ? lowHeight - 1 : ny);
+					const XMFLOAT4& c = m_marched.color[static_cast<size_t>(ny) * lowWidth + nx];
+					lo = XMFLOAT4((c.x < lo.x) ? c.x : lo.x, (c.y < lo.y) ? c.y : lo.y, (c.z < lo.z) ? c.z : lo.z, (c.w < lo.w) ? c.w : lo.w);
+					hi = XMFLOAT4((c.x > hi.x) ? c.x : hi.x, (c.y > hi.y) ? c.y : hi.y, (c.z > hi.z) ? c.z : hi.z, (c.w > hi.w) ? c.w : hi.w);
+				}
+			}
+
+			XMFLOAT4 history = m_history.SampleColor(u, v);
+			m_resolved.color[pixel] = XMFLOAT4(
+				Clamp(history.x, lo.x, hi.x),
+				Clamp(history.y, lo.y, hi.y),
+				Clamp(history.z, lo.z, hi.z),
+				Clamp(history.w, lo.w, hi.w));
+			stats.reprojected++;
+		}
+	}
+
+	std::swap(m_history, m_resolved);
+	m_history.samples = stats.samples;
+	XMStoreFloat4x4(&m_prevWorldViewProjection, worldViewProjection);
+	m_historyValid = true;
+
+	stats.pixels = static_cast<uint64_t>(width) * height;
+	return stats;
+}
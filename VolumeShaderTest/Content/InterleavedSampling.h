@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "ReferenceRaymarcher.h"
+
+namespace VolumeShaderTest
+{
+	// Pixel marched inside every patternSize x patternSize block on a given frame.
+	// Frames walk the block in Bayer order so consecutive frames land far apart.
+	void GetInterleaveOffset(uint32_t patternSize, uint32_t frameIndex, uint32_t& offsetX, uint32_t& offsetY);
+
+	struct InterleaveStats
+	{
+		uint64_t raysMarched;		// Pixels marched this frame.
+		uint64_t pixels;			// Pixels in the full resolution image.
+		uint64_t samples;			// Volume fetches taken this frame.
+		uint32_t reprojected;		// Pixels filled from the reprojected history.
+		uint32_t rejected;			// Pixels whose history was off screen and fell back to the nearest fresh sample.
+	};
+
+	// CPU mirror of the interleaved march plus InterleaveReconstructPixelShader.hlsl.
+	// Compare GetImage() with a full resolution ReferenceRaymarcher render to measure reconstruction error.
+	class InterleavedReconstructor
+	{
+	public:
+		InterleavedReconstructor();
+
+		void Reset();
+
+		InterleaveStats RenderFrame(
+			const VolumeData& volume,
+			const RaymarchCamera& camera,
+			DirectX::FXMMATRIX worldViewProjection,
+			const RaymarchSettings& settings,
+			uint32_t patternSize,
+			uint32_t frameIndex,
+			uint32_t width,
+			uint32_t height);
+
+		const ReferenceImage& GetImage() const { return m_history; }
+
+	private:
+		ReferenceImage			m_marched;
+		ReferenceImage			m_history;
+		ReferenceImage			m_resolved;
+		DirectX::XMFLOAT4X4		m_prevWorldViewProjection;
+		bool					m_historyValid;
+	};
+}
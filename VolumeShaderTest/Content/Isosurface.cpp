@@ -0,0 +1,418 @@
+﻿#include "pch.h"
+#include "Isosurface.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// Corner i of a cell sits at (i & 1, (i >> 1) & 1, i >> 2); these are the corner pairs of its twelve edges.
+	const int s_cellEdges[12][2] =
+	{
+		{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+		{ 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+		{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+	};
+
+	// Calls work(i) for every i in [0, count), handing the indices out to threads one at a time because
+	// bricks without a surface finish almost immediately.
+	template<typename Work>
+	void ParallelForEach(uint32_t count, uint32_t threadCount, const Work& work)
+	{
+		threadCount = (threadCount == 0) ? std::thread::hardware_concurrency() : threadCount;
+		threadCount = (threadCount < 1) ? 1 : (threadCount > count ? count : threadCount);
+		if (threadCount <= 1)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				work(i);
+			}
+			return;
+		}
+
+		std::atomic<uint32_t> next(0);
+		std::vector<std::thread> workers;
+		for (uint32_t t = 0; t < threadCount; ++t)
+		{
+			workers.emplace_back([&]()
+			{
+				for (uint32_t i = next++; i < count; i = next++)
+				{
+					work(i);
+				}
+			});
+		}
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+}
+
+IsosurfaceExtractor::IsosurfaceExtractor(const IsosurfaceSettings& settings) :
+	m_settings(settings),
+	m_threshold(0.0f),
+	m_extracted(false)
+{
+	m_settings.brickSize = (m_settings.brickSize < 1) ? 1 : m_settings.brickSize;
+	memset(m_size, 0, sizeof(m_size));
+	memset(m_cells, 0, sizeof(m_cells));
+	memset(m_brickCounts, 0, sizeof(m_brickCounts));
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void IsosurfaceExtractor::SetVolume(const float* density, size_t stride, uint32_t width, uint32_t height, uint32_t depth)
+{
+	m_size[0] = width;
+	m_size[1] = height;
+	m_size[2] = depth;
+	m_density.resize(static_cast<size_t>(width) * height * depth);
+	for (size_t i = 0; i < m_density.size(); ++i)
+	{
+		m_density[i] = density[i * stride];
+	}
+
+	uint32_t brickSize = m_settings.brickSize;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		m_cells[axis] = (m_size[axis] >= 2) ? m_size[axis] - 1 : 0;
+		m_brickCounts[axis] = (m_cells[axis] + brickSize - 1) / brickSize;
+	}
+
+	m_bricks.clear();
+	m_bricks.resize(static_cast<size_t>(m_brickCounts[0]) * m_brickCounts[1] * m_brickCounts[2]);
+	ParallelForEach(static_cast<uint32_t>(m_bricks.size()), m_settings.threadCount, [this, brickSize](uint32_t index)
+	{
+		Brick& brick = m_bricks[index];
+		uint32_t coords[3] = { index % m_brickCounts[0], (index / m_brickCounts[0]) % m_brickCounts[1], index / (m_brickCounts[0] * m_brickCounts[1]) };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			brick.cellMin[axis] = coords[axis] * brickSize;
+			brick.cellMax[axis] = std::min(brick.cellMin[axis] + brickSize, m_cells[axis]);
+		}
+		ComputeDensityRange(brick);
+		brick.stale = true;
+	});
+
+	m_extracted = false;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.bricks = static_cast<uint32_t>(m_bricks.size());
+}
+
+void IsosurfaceExtractor::UpdateRegion(const float* density, size_t stride, const uint32_t voxelMin[3], const uint32_t voxelMax[3])
+{
+	uint32_t low[3], high[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		low[axis] = voxelMin[axis];
+		high[axis] = std::min(voxelMax[axis], m_size[axis]);
+		if (low[axis] >= high[axis])
+		{
+			return;
+		}
+	}
+
+	for (uint32_t z = low[2]; z < high[2]; ++z)
+	{
+		for (uint32_t y = low[1]; y < high[1]; ++y)
+		{
+			size_t row = (static_cast<size_t>(z) * m_size[1] + y) * m_size[0];
+			for (uint32_t x = low[0]; x < high[0]; ++x)
+			{
+				m_density[row + x] = density[(row + x) * stride];
+			}
+		}
+	}
+
+	// Voxel v is a corner of cells v - 1 and v. A brick's quads reach one cell below its own range for the
+	// vertices it borrows, and its range test covers the corners one past its last cell.
+	ParallelForEach(static_cast<uint32_t>(m_bricks.size()), m_settings.threadCount, [this, &low, &high](uint32_t index)
+	{
+		Brick& brick = m_bricks[index];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			uint32_t first = (brick.cellMin[axis] > 0) ? brick.cellMin[axis] - 1 : 0;
+			if (high[axis] <= first || low[axis] > brick.cellMax[axis])
+			{
+				return;
+			}
+		}
+		ComputeDensityRange(brick);
+		brick.stale = true;
+	});
+}
+
+void IsosurfaceExtractor::Extract(float threshold)
+{
+	// A brick the old surface did not pass through holds no triangles, and keeps none if the new one misses it too.
+	std::vector<uint32_t> rebuild;
+	for (uint32_t i = 0; i < m_bricks.size(); ++i)
+	{
+		const Brick& brick = m_bricks[i];
+		bool stale = !m_extracted || brick.stale || (threshold != m_threshold && (Straddles(brick, m_threshold) || Straddles(brick, threshold)));
+		if (stale)
+		{
+			rebuild.push_back(i);
+		}
+	}
+
+	ParallelForEach(static_cast<uint32_t>(rebuild.size()), m_settings.threadCount, [this, &rebuild, threshold](uint32_t i)
+	{
+		ExtractBrick(m_bricks[rebuild[i]], threshold);
+		m_bricks[rebuild[i]].stale = false;
+	});
+
+	m_threshold = threshold;
+	m_extracted = true;
+	m_stats.bricksRebuilt = static_cast<uint32_t>(rebuild.size());
+	m_stats.bricksWithSurface = 0;
+	m_stats.vertices = 0;
+	m_stats.triangles = 0;
+	for (const Brick& brick : m_bricks)
+	{
+		m_stats.bricksWithSurface += brick.indices.empty() ? 0 : 1;
+		m_stats.vertices += brick.vertices.size();
+		m_stats.triangles += brick.indices.size() / 3;
+	}
+}
+
+void IsosurfaceExtractor::BuildMesh(IsosurfaceMesh& mesh) const
+{
+	std::vector<uint32_t> base(m_bricks.size());
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (size_t i = 0; i < m_bricks.size(); ++i)
+	{
+		base[i] = static_cast<uint32_t>(vertexCount);
+		vertexCount += m_bricks[i].vertices.size();
+		indexCount += m_bricks[i].indices.size();
+	}
+
+	mesh.vertices.resize(vertexCount);
+	mesh.indices.resize(indexCount);
+	std::vector<uint32_t> remap;
+	size_t indexOffset = 0;
+	for (size_t i = 0; i < m_bricks.size(); ++i)
+	{
+		const Brick& brick = m_bricks[i];
+		std::copy(brick.vertices.begin(), brick.vertices.end(), mesh.vertices.begin() + base[i]);
+
+		// Borrowed vertices resolve to the owner's copy, which welds the seams between bricks.
+		remap.resize(brick.vertices.size() + brick.borrowed.size());
+		for (uint32_t v = 0; v < brick.vertices.size(); ++v)
+		{
+			remap[v] = base[i] + v;
+		}
+		for (size_t b = 0; b < brick.borrowed.size(); ++b)
+		{
+			const Brick& owner = m_bricks[brick.borrowed[b].brick];
+			auto found = std::lower_bound(owner.cells.begin(), owner.cells.end(), brick.borrowed[b].cell);
+			assert(found != owner.cells.end() && *found == brick.borrowed[b].cell);
+			remap[brick.vertices.size() + b] = base[brick.borrowed[b].brick] + static_cast<uint32_t>(found - owner.cells.begin());
+		}
+
+		for (uint32_t index : brick.indices)
+		{
+			mesh.indices[indexOffset++] = remap[index];
+		}
+	}
+}
+
+bool IsosurfaceExtractor::ComputeCellVertex(uint32_t x, uint32_t y, uint32_t z, float threshold, VertexPositionColor& vertex) const
+{
+	float corners[8];
+	uint32_t inside = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		corners[i] = Density(x + (i & 1), y + ((i >> 1) & 1), z + (i >> 2));
+		inside |= (corners[i] >= threshold) ? (1u << i) : 0u;
+	}
+	if (inside == 0 || inside == 0xFF)
+	{
+		return false;
+	}
+
+	float sum[3] = { 0.0f, 0.0f, 0.0f };
+	int crossings = 0;
+	for (const int* edge : s_cellEdges)
+	{
+		float d0 = corners[edge[0]], d1 = corners[edge[1]];
+		if ((d0 >= threshold) == (d1 >= threshold))
+		{
+			continue;
+		}
+
+		float t = (threshold - d0) / (d1 - d0);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float p0 = static_cast<float>((edge[0] >> axis) & 1);
+			float p1 = static_cast<float>((edge[1] >> axis) & 1);
+			sum[axis] += p0 + (p1 - p0) * t;
+		}
+		crossings++;
+	}
+
+	// The gradient averaged over the cell's four edges along each axis, scaled from voxels to local units.
+	float gradient[3] =
+	{
+		(corners[1] - corners[0] + corners[3] - corners[2] + corners[5] - corners[4] + corners[7] - corners[6]) * 0.25f * m_size[0],
+		(corners[2] - corners[0] + corners[3] - corners[1] + corners[6] - corners[4] + corners[7] - corners[5]) * 0.25f * m_size[1],
+		(corners[4] - corners[0] + corners[5] - corners[1] + corners[6] - corners[2] + corners[7] - corners[3]) * 0.25f * m_size[2],
+	};
+	float length = sqrtf(gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2]);
+	float scale = (length > 0.0f) ? -1.0f / length : 0.0f;
+
+	// Voxel centers sit at (i + 0.5) / size in texture space, which is offset by half a unit from local space.
+	uint32_t cell[3] = { x, y, z };
+	float position[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		position[axis] = (cell[axis] + sum[axis] / crossings + 0.5f) / m_size[axis] - 0.5f;
+	}
+	vertex.pos = XMFLOAT3(position[0], position[1], position[2]);
+	vertex.texCoord = XMFLOAT3(gradient[0] * scale, gradient[1] * scale, gradient[2] * scale);
+	return true;
+}
+
+void IsosurfaceExtractor::ComputeDensityRange(Brick& brick) const
+{
+	// A cell reads the voxels at both of its ends, so the corners run one past the last cell.
+	float low = Density(brick.cellMin[0], brick.cellMin[1], brick.cellMin[2]);
+	float high = low;
+	for (uint32_t z = brick.cellMin[2]; z <= brick.cellMax[2]; ++z)
+	{
+		for (uint32_t y = brick.cellMin[1]; y <= brick.cellMax[1]; ++y)
+		{
+			for (uint32_t x = brick.cellMin[0]; x <= brick.cellMax[0]; ++x)
+			{
+				float value = Density(x, y, z);
+				low = (value < low) ? value : low;
+				high = (value > high) ? value : high;
+			}
+		}
+	}
+	brick.densityMin = low;
+	brick.densityMax = high;
+}
+
+void IsosurfaceExtractor::ExtractBrick(Brick& brick, float threshold) const
+{
+	brick.vertices.clear();
+	brick.cells.clear();
+	brick.borrowed.clear();
+	brick.indices.clear();
+	if (!Straddles(brick, threshold))
+	{
+		return;
+	}
+
+	// Slots cover the brick plus the layer of cells below it on each axis, whose vertices the quads on the
+	// brick's lower faces borrow.
+	uint32_t low[3], extent[3], own[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		low[axis] = (brick.cellMin[axis] > 0) ? brick.cellMin[axis] - 1 : 0;
+		extent[axis] = brick.cellMax[axis] - low[axis];
+		own[axis] = brick.cellMax[axis] - brick.cellMin[axis];
+	}
+	std::vector<int32_t> slots(static_cast<size_t>(extent[0]) * extent[1] * extent[2], -1);
+	auto slotIndex = [&](const uint32_t c[3])
+	{
+		return (static_cast<size_t>(c[2] - low[2]) * extent[1] + (c[1] - low[1])) * extent[0] + (c[0] - low[0]);
+	};
+
+	VertexPositionColor vertex;
+	for (uint32_t z = brick.cellMin[2]; z < brick.cellMax[2]; ++z)
+	{
+		for (uint32_t y = brick.cellMin[1]; y < brick.cellMax[1]; ++y)
+		{
+			for (uint32_t x = brick.cellMin[0]; x < brick.cellMax[0]; ++x)
+			{
+				if (ComputeCellVertex(x, y, z, threshold, vertex))
+				{
+					uint32_t c[3] = { x, y, z };
+					slots[slotIndex(c)] = static_cast<int32_t>(brick.vertices.size());
+					brick.vertices.push_back(vertex);
+					brick.cells.push_back(((z - brick.cellMin[2]) * own[1] + (y - brick.cellMin[1])) * own[0] + (x - brick.cellMin[0]));
+				}
+			}
+		}
+	}
+
+	// Every cell around an edge with a sign change has a vertex, so a missing slot is always a neighbor's cell.
+	uint32_t brickSize = m_settings.brickSize;
+	auto vertexOf = [&](const uint32_t c[3]) -> uint32_t
+	{
+		int32_t& slot = slots[slotIndex(c)];
+		if (slot < 0)
+		{
+			BorrowedVertex borrowed;
+			uint32_t ownerCoords[3], ownerMin[3], ownerSize[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				ownerCoords[axis] = c[axis] / brickSize;
+				ownerMin[axis] = ownerCoords[axis] * brickSize;
+				ownerSize[axis] = std::min(ownerMin[axis] + brickSize, m_cells[axis]) - ownerMin[axis];
+			}
+			borrowed.brick = (ownerCoords[2] * m_brickCounts[1] + ownerCoords[1]) * m_brickCounts[0] + ownerCoords[0];
+			borrowed.cell = ((c[2] - ownerMin[2]) * ownerSize[1] + (c[1] - ownerMin[1])) * ownerSize[0] + (c[0] - ownerMin[0]);
+			slot = static_cast<int32_t>(brick.vertices.size() + brick.borrowed.size());
+			brick.borrowed.push_back(borrowed);
+		}
+		return static_cast<uint32_t>(slot);
+	};
+
+	// Each edge leaving a cell's first corner along +axis belongs to that cell. The four cells around it, taken
+	// in this order, wind clockwise seen from +axis in a left-handed frame.
+	for (uint32_t z = brick.cellMin[2]; z < brick.cellMax[2]; ++z)
+	{
+		for (uint32_t y = brick.cellMin[1]; y < brick.cellMax[1]; ++y)
+		{
+			for (uint32_t x = brick.cellMin[0]; x < brick.cellMax[0]; ++x)
+			{
+				uint32_t c[3] = { x, y, z };
+				float d0 = Density(x, y, z);
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					int u = (axis + 1) % 3;
+					int v = (axis + 2) % 3;
+					if (c[u] == 0 || c[v] == 0)
+					{
+						continue;
+					}
+
+					uint32_t e[3] = { x, y, z };
+					e[axis]++;
+					bool inside0 = d0 >= threshold;
+					if (inside0 == (Density(e[0], e[1], e[2]) >= threshold))
+					{
+						continue;
+					}
+
+					uint32_t a[3] = { x, y, z }, b[3] = { x, y, z }, cc[3] = { x, y, z }, d[3] = { x, y, z };
+					b[u]--;
+					cc[u]--;
+					cc[v]--;
+					d[v]--;
+					uint32_t quad[4] = { vertexOf(a), vertexOf(b), vertexOf(cc), vertexOf(d) };
+
+					// The surface faces toward lower density, along +axis when the first corner is inside.
+					if (inside0)
+					{
+						brick.indices.insert(brick.indices.end(), { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] });
+					}
+					else
+					{
+						brick.indices.insert(brick.indices.end(), { quad[0], quad[2], quad[1], quad[0], quad[3], quad[2] });
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,106 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ShaderStructures.h"
+
+namespace VolumeShaderTest
+{
+	// Indexed triangle list for the regular vertex and index buffer path. Positions are in the local space of the
+	// volume box, texCoord holds the unit surface normal (pointing toward lower density) and the triangles are
+	// wound clockwise when seen from the side the normal points to, so back face culling keeps the outside.
+	struct IsosurfaceMesh
+	{
+		std::vector<VertexPositionColor> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	struct IsosurfaceSettings
+	{
+		IsosurfaceSettings() : brickSize(16), threadCount(0) {}
+
+		uint32_t brickSize;		// Cells per brick along each axis.
+		uint32_t threadCount;	// 0 = one per hardware thread.
+	};
+
+	struct IsosurfaceStats
+	{
+		uint32_t bricks;
+		uint32_t bricksRebuilt;		// Bricks extracted by the last Extract call.
+		uint32_t bricksWithSurface;
+		uint64_t vertices;
+		uint64_t triangles;
+	};
+
+	// Surface nets over the voxel grid: every cell the surface passes through gets one vertex at the mean of its
+	// edge crossings, and every grid edge with a sign change becomes a quad joining the four cells around it.
+	// Vertices are shared by construction, so the mesh is welded without a position hash.
+	//
+	// Extraction runs per brick of cells across threads. Each brick remembers the density range of its corners,
+	// so changing the threshold only rebuilds the bricks the old or new surface passes through.
+	class IsosurfaceExtractor
+	{
+	public:
+		explicit IsosurfaceExtractor(const IsosurfaceSettings& settings = IsosurfaceSettings());
+
+		// Copies the density (element i at density[i * stride], x fastest) and drops every brick mesh.
+		void SetVolume(const float* density, size_t stride, uint32_t width, uint32_t height, uint32_t depth);
+
+		// Copies voxels [voxelMin, voxelMax) from the same layout passed to SetVolume and marks the bricks whose
+		// cells or borrowed vertices read them for the next Extract.
+		void UpdateRegion(const float* density, size_t stride, const uint32_t voxelMin[3], const uint32_t voxelMax[3]);
+
+		// Brings every brick up to date for the surface where density crosses threshold (inside is >= threshold).
+		void Extract(float threshold);
+
+		// Joins the brick meshes into one welded mesh.
+		void BuildMesh(IsosurfaceMesh& mesh) const;
+
+		float GetThreshold() const { return m_threshold; }
+		uint32_t GetBrickCount() const { return static_cast<uint32_t>(m_bricks.size()); }
+		const IsosurfaceStats& GetStats() const { return m_stats; }
+
+	private:
+		// A vertex of a neighboring brick, by brick index and the cell's index inside that brick.
+		struct BorrowedVertex
+		{
+			uint32_t brick;
+			uint32_t cell;
+		};
+
+		struct Brick
+		{
+			uint32_t cellMin[3];
+			uint32_t cellMax[3];	// Exclusive.
+			float densityMin;
+			float densityMax;
+			bool stale;			// Edited since it was last extracted.
+
+			// Vertices of the brick's own cells in increasing brick-local cell index, then vertices borrowed from
+			// the bricks below it. Indices address both lists as one.
+			std::vector<VertexPositionColor> vertices;
+			std::vector<uint32_t> cells;
+			std::vector<BorrowedVertex> borrowed;
+			std::vector<uint32_t> indices;
+		};
+
+		static bool Straddles(const Brick& brick, float threshold) { return brick.densityMin < threshold && brick.densityMax >= threshold; }
+
+		void ComputeDensityRange(Brick& brick) const;
+		void ExtractBrick(Brick& brick, float threshold) const;
+		bool ComputeCellVertex(uint32_t x, uint32_t y, uint32_t z, float threshold, VertexPositionColor& vertex) const;
+
+		float Density(uint32_t x, uint32_t y, uint32_t z) const { return m_density[(static_cast<size_t>(z) * m_size[1] + y) * m_size[0] + x]; }
+
+		IsosurfaceSettings	m_settings;
+		std::vector<float>	m_density;
+		uint32_t			m_size[3];
+		uint32_t			m_cells[3];
+		uint32_t			m_brickCounts[3];
+		std::vector<Brick>	m_bricks;
+		float				m_threshold;
+		bool				m_extracted;
+		IsosurfaceStats		m_stats;
+	};
+}
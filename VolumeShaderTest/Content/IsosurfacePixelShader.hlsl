@@ -0,0 +1,22 @@
+#include "ConstantBuffer.hlsli"
+#include "RayClip.hlsli"
+
+struct PixelShaderInput
+{
+    float4 position : SV_POSITION;
+    float3 normal : TEXCOORD0;
+    float3 localPos : TEXCOORD1;
+};
+
+// Opaque Lambert shading in the volume's local space, lit by the same point light as the raymarcher.
+float4 main(PixelShaderInput input) : SV_Target
+{
+    // The surface is cut where the march is, so the fog composited over it lines up with the cut.
+    if (!InsideClipRegion(input.localPos))
+        discard;
+
+    float3 localLightPos = mul(float4(lightPosition.xyz, 1.0f), invWorldMatrix).xyz;
+    float3 lightDir = normalize(localLightPos - input.localPos);
+    float diffuse = saturate(dot(normalize(input.normal), lightDir));
+    return float4(isosurfaceParams.rgb * (isosurfaceParams.w + (1.0f - isosurfaceParams.w) * diffuse), 1.0f);
+}
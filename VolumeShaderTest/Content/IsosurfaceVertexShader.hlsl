@@ -0,0 +1,25 @@
+#include "ConstantBuffer.hlsli"
+
+struct VS_INPUT
+{
+    float3 position : POSITION;
+    float3 normal : TEXCOORD0;  // IsosurfaceMesh stores the surface normal in the texCoord slot
+};
+
+struct PS_INPUT
+{
+    float4 position : SV_POSITION;
+    float3 normal : TEXCOORD0;
+    float3 localPos : TEXCOORD1;
+};
+
+// Full resolution, so none of the volume pass raster offsets apply.
+PS_INPUT main(VS_INPUT input)
+{
+    PS_INPUT output;
+    float4 worldPos = mul(float4(input.position, 1.0f), worldMatrix);
+    output.position = mul(worldPos, mul(viewMatrix, projectionMatrix));
+    output.normal = input.normal;
+    output.localPos = input.position;
+    return output;
+}
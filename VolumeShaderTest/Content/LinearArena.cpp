@@ -0,0 +1,164 @@
+﻿#include "pch.h"
+#include "LinearArena.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	const size_t HugePageSize = 2 * 1024 * 1024;
+
+	inline size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Commits size bytes of zeroed pages. hugePages is updated to whether large pages were actually used.
+	void* AllocatePages(size_t& size, bool& hugePages)
+	{
+#if defined(_WIN32)
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+		// Large pages need SeLockMemoryPrivilege; without it the call fails and normal pages are used.
+		size_t largePage = GetLargePageMinimum();
+		if (hugePages && largePage > 0)
+		{
+			size_t largeSize = AlignUp(size, largePage);
+			void* base = VirtualAlloc(nullptr, largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (base != nullptr)
+			{
+				size = largeSize;
+				return base;
+			}
+		}
+#endif
+		hugePages = false;
+		size = AlignUp(size, 64 * 1024);
+		return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+		if (hugePages)
+		{
+			// Transparent huge pages back 2 MiB aligned ranges once advised; faults then come in 2 MiB steps.
+			size_t hugeSize = AlignUp(size, HugePageSize);
+			void* reserved = mmap(nullptr, hugeSize + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (reserved != MAP_FAILED)
+			{
+				uintptr_t start = reinterpret_cast<uintptr_t>(reserved);
+				uintptr_t aligned = AlignUp(start, HugePageSize);
+				if (aligned > start)
+				{
+					munmap(reserved, aligned - start);
+				}
+				size_t tail = (start + hugeSize + HugePageSize) - (aligned + hugeSize);
+				if (tail > 0)
+				{
+					munmap(reinterpret_cast<void*>(aligned + hugeSize), tail);
+				}
+
+				void* base = reinterpret_cast<void*>(aligned);
+#if defined(MADV_HUGEPAGE)
+				hugePages = madvise(base, hugeSize, MADV_HUGEPAGE) == 0;
+#else
+				hugePages = false;
+#endif
+				size = hugeSize;
+				return base;
+			}
+		}
+
+		hugePages = false;
+		size = AlignUp(size, 4096);
+		void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return (base != MAP_FAILED) ? base : nullptr;
+#endif
+	}
+
+	void FreePages(void* base, size_t size)
+	{
+#if defined(_WIN32)
+		(void)size;
+		VirtualFree(base, 0, MEM_RELEASE);
+#else
+		munmap(base, size);
+#endif
+	}
+}
+
+LinearArena::LinearArena(size_t blockSize, bool useHugePages) :
+	m_blockSize(blockSize > 0 ? blockSize : DefaultBlockSize),
+	m_useHugePages(useHugePages)
+{
+	m_stats = ArenaStats();
+}
+
+LinearArena::~LinearArena()
+{
+	Reset();
+}
+
+bool LinearArena::AllocateBlock(size_t minimumSize)
+{
+	size_t size = (minimumSize > m_blockSize) ? minimumSize : m_blockSize;
+	bool hugePages = m_useHugePages;
+	void* base = AllocatePages(size, hugePages);
+	if (base == nullptr)
+	{
+		return false;
+	}
+
+	Block block = { static_cast<uint8_t*>(base), size, 0, hugePages };
+	m_blocks.push_back(block);
+
+	m_stats.blocks++;
+	m_stats.hugePageBlocks += hugePages ? 1 : 0;
+	m_stats.bytesReserved += size;
+	m_stats.peakBytesReserved = (m_stats.bytesReserved > m_stats.peakBytesReserved) ? m_stats.bytesReserved : m_stats.peakBytesReserved;
+	return true;
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	alignment = (alignment > 0) ? alignment : 1;
+
+	size_t offset = 0;
+	if (!m_blocks.empty())
+	{
+		Block& block = m_blocks.back();
+		offset = AlignUp(reinterpret_cast<uintptr_t>(block.base) + block.used, alignment) - reinterpret_cast<uintptr_t>(block.base);
+	}
+
+	if (m_blocks.empty() || offset + size > m_blocks.back().size)
+	{
+		// Blocks start page aligned, so a fresh one only needs room for the request itself.
+		if (!AllocateBlock(size + alignment))
+		{
+			throw std::bad_alloc();
+		}
+		offset = AlignUp(reinterpret_cast<uintptr_t>(m_blocks.back().base), alignment) - reinterpret_cast<uintptr_t>(m_blocks.back().base);
+	}
+
+	Block& block = m_blocks.back();
+	m_stats.allocations++;
+	m_stats.bytesInUse += (offset + size) - block.used;
+	m_stats.peakBytesInUse = (m_stats.bytesInUse > m_stats.peakBytesInUse) ? m_stats.bytesInUse : m_stats.peakBytesInUse;
+	block.used = offset + size;
+	return block.base + offset;
+}
+
+void LinearArena::Reset()
+{
+	for (const Block& block : m_blocks)
+	{
+		FreePages(block.base, block.size);
+	}
+	m_blocks.clear();
+
+	m_stats.bytesInUse = 0;
+	m_stats.bytesReserved = 0;
+	m_stats.blocks = 0;
+	m_stats.hugePageBlocks = 0;
+}
@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace VolumeShaderTest
+{
+	struct ArenaStats
+	{
+		uint64_t allocations;
+		uint64_t bytesInUse;		// Requested bytes since the last Reset, padding included.
+		uint64_t peakBytesInUse;
+		uint64_t bytesReserved;		// Pages currently held by the arena's blocks.
+		uint64_t peakBytesReserved;
+		uint32_t blocks;
+		uint32_t hugePageBlocks;	// Blocks the OS backed with large pages.
+	};
+
+	// Linear allocator for buffers that live as long as one load. Memory comes straight from the OS page
+	// allocator and is handed out uninitialized; nothing is freed until Reset or destruction.
+	class LinearArena
+	{
+	public:
+		static const size_t DefaultBlockSize = 4 * 1024 * 1024;
+
+		explicit LinearArena(size_t blockSize = DefaultBlockSize, bool useHugePages = true);
+		~LinearArena();
+
+		LinearArena(const LinearArena&) = delete;
+		LinearArena& operator=(const LinearArena&) = delete;
+
+		// Returns uninitialized memory; requests larger than the block size get a block of their own.
+		void* Allocate(size_t size, size_t alignment = 16);
+
+		template <typename T>
+		T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+
+		// Returns every block to the OS; pointers handed out before are invalid afterwards.
+		void Reset();
+
+		ArenaStats GetStats() const { return m_stats; }
+
+	private:
+		struct Block
+		{
+			uint8_t* base;
+			size_t size;
+			size_t used;
+			bool hugePages;
+		};
+
+		bool AllocateBlock(size_t minimumSize);
+
+		std::vector<Block>	m_blocks;
+		size_t				m_blockSize;
+		bool				m_useHugePages;
+		ArenaStats			m_stats;
+	};
+
+	// Standard allocator over a LinearArena, or the heap when the arena is null. Elements are
+	// default-initialized, so resizing a vector of floats leaves them unwritten instead of zero-filling.
+	template <typename T>
+	class ArenaAllocator
+	{
+	public:
+		typedef T value_type;
+
+		ArenaAllocator() : m_arena(nullptr) {}
+		explicit ArenaAllocator(LinearArena* arena) : m_arena(arena) {}
+		template <typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.GetArena()) {}
+
+		T* allocate(size_t count)
+		{
+			if (m_arena != nullptr)
+			{
+				return m_arena->AllocateArray<T>(count);
+			}
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		}
+
+		void deallocate(T* pointer, size_t)
+		{
+			// Arena memory is released all at once by Reset.
+			if (m_arena == nullptr)
+			{
+				::operator delete(pointer);
+			}
+		}
+
+		template <typename U>
+		void construct(U* pointer)
+		{
+			::new (static_cast<void*>(pointer)) U;
+		}
+
+		template <typename U, typename... Args>
+		void construct(U* pointer, Args&&... args)
+		{
+			::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+		}
+
+		LinearArena* GetArena() const { return m_arena; }
+
+		template <typename U>
+		bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.GetArena(); }
+		template <typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const { return m_arena != other.GetArena(); }
+
+	private:
+		LinearArena* m_arena;
+	};
+
+	template <typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
@@ -0,0 +1,34 @@
+Texture2D<float> sceneDepth : register(t0);
+
+struct PixelShaderInput
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+// Keeps the farthest opaque depth of the full resolution pixels under one texel of the occlusion target,
+// which is 1/16 of the depth buffer on each axis (at least 1x1). Mirrors HiZOcclusionBuffer::BuildFromDepth,
+// so the last texel of a row or column also covers the leftover pixels.
+float main(PixelShaderInput input) : SV_Target
+{
+    uint width, height;
+    sceneDepth.GetDimensions(width, height);
+    uint2 depthSize = uint2(width, height);
+    uint2 targetSize = max(depthSize / 16, uint2(1, 1));
+
+    uint2 texel = uint2(input.position.xy);
+    uint2 first = texel * depthSize / targetSize;
+    uint2 last = max((texel + 1) * depthSize / targetSize, first + 1);
+
+    float farthest = 0.0f;
+    [loop]
+    for (uint y = first.y; y < last.y; y++)
+    {
+        [loop]
+        for (uint x = first.x; x < last.x; x++)
+        {
+            farthest = max(farthest, sceneDepth.Load(int3(x, y, 0)));
+        }
+    }
+    return farthest;
+}
@@ -0,0 +1,327 @@
+﻿#include "pch.h"
+#include "OutOfCoreVolume.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace VolumeShaderTest;
+
+ChunkCache::ChunkCache(uint64_t budgetBytes) :
+	m_budget(budgetBytes)
+{
+	m_stats = ChunkCacheStats();
+}
+
+std::shared_ptr<const ChunkData> ChunkCache::Find(uint32_t index)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto entry = m_entries.find(index);
+	if (entry == m_entries.end())
+	{
+		m_stats.misses++;
+		return nullptr;
+	}
+
+	m_stats.hits++;
+	m_lru.splice(m_lru.begin(), m_lru, entry->second);
+	return entry->second->second;
+}
+
+bool ChunkCache::Contains(uint32_t index) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.find(index) != m_entries.end();
+}
+
+bool ChunkCache::Insert(uint32_t index, std::shared_ptr<const ChunkData> chunk)
+{
+	uint64_t bytes = chunk->size() * sizeof(uint16_t);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_entries.find(index) != m_entries.end())
+	{
+		return false;
+	}
+
+	// Find the room first, so a refused insert leaves the cache as it was. Readers only get chunks through Find,
+	// under the lock, so a use count of 1 cannot grow while it is held.
+	uint64_t freeable = 0;
+	auto victim = m_lru.end();
+	while (m_stats.bytes - freeable + bytes > m_budget && victim != m_lru.begin())
+	{
+		--victim;
+		if (victim->second.use_count() == 1)
+		{
+			freeable += victim->second->size() * sizeof(uint16_t);
+		}
+	}
+
+	if (m_stats.bytes - freeable + bytes > m_budget)
+	{
+		m_stats.refused++;
+		return false;
+	}
+
+	for (auto entry = victim; entry != m_lru.end();)
+	{
+		if (entry->second.use_count() != 1)
+		{
+			++entry;
+			continue;
+		}
+
+		m_stats.bytes -= entry->second->size() * sizeof(uint16_t);
+		m_stats.evictions++;
+		m_entries.erase(entry->first);
+		entry = m_lru.erase(entry);
+	}
+
+	m_lru.emplace_front(index, std::move(chunk));
+	m_entries[index] = m_lru.begin();
+	m_stats.bytes += bytes;
+	m_stats.insertions++;
+	m_stats.peakBytes = (m_stats.bytes > m_stats.peakBytes) ? m_stats.bytes : m_stats.peakBytes;
+	return true;
+}
+
+ChunkCacheStats ChunkCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+ChunkFetchScheduler::ChunkFetchScheduler(const VolumeChunkStore& store, ChunkCache& cache, uint32_t threadCount) :
+	m_store(store),
+	m_cache(cache),
+	m_stopping(false)
+{
+	m_stats = ChunkFetchStats();
+
+	threadCount = (threadCount > 0) ? threadCount : 1;
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		m_workers.emplace_back(&ChunkFetchScheduler::WorkerLoop, this);
+	}
+}
+
+ChunkFetchScheduler::~ChunkFetchScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		m_queue.clear();
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ChunkFetchScheduler::SetRequests(const std::vector<ChunkRequest>& requests)
+{
+	std::vector<ChunkRequest> queue;
+	queue.reserve(requests.size());
+	for (const ChunkRequest& request : requests)
+	{
+		if (!m_cache.Contains(request.index))
+		{
+			queue.push_back(request);
+		}
+	}
+
+	std::sort(queue.begin(), queue.end(), [](const ChunkRequest& a, const ChunkRequest& b) { return a.priority < b.priority; });
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.dropped += m_queue.size();
+		m_stats.requested += queue.size();
+
+		queue.erase(std::remove_if(queue.begin(), queue.end(), [this](const ChunkRequest& request) {
+			return m_inFlight.count(request.index) != 0;
+			}), queue.end());
+		m_queue.swap(queue);
+	}
+	m_wake.notify_all();
+}
+
+void ChunkFetchScheduler::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_queue.empty() && m_inFlight.empty(); });
+}
+
+ChunkFetchStats ChunkFetchScheduler::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void ChunkFetchScheduler::WorkerLoop()
+{
+	for (;;)
+	{
+		uint32_t index;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+			if (m_stopping)
+			{
+				return;
+			}
+
+			index = m_queue.back().index;
+			m_queue.pop_back();
+			if (!m_inFlight.insert(index).second)
+			{
+				continue;
+			}
+		}
+
+		auto chunk = std::make_shared<ChunkData>(m_store.GetChunkVoxelCount());
+		bool read = m_store.ReadChunk(index, chunk->data());
+		// A chunk the cache refuses is dropped; the next frame's feedback asks for it again.
+		if (read)
+		{
+			m_cache.Insert(index, chunk);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_inFlight.erase(index);
+			if (read)
+			{
+				m_stats.fetched++;
+			}
+			else
+			{
+				m_stats.failed++;
+			}
+
+			if (m_queue.empty() && m_inFlight.empty())
+			{
+				m_idle.notify_all();
+			}
+		}
+	}
+}
+
+BrickPoolLayout VolumeShaderTest::ChooseBrickPoolLayout(const ChunkStoreHeader& header, uint64_t budgetBytes, uint32_t maxTextureDimension)
+{
+	BrickPoolLayout layout = {};
+
+	// Powers of two that divide the chunk size, then the chunk size itself: one coarse texel per chunk, which is
+	// kept even if it does not fit.
+	uint64_t coarseBudget = budgetBytes / 8;
+	for (uint32_t factor = 1;; factor = (header.chunkSize % (factor * 2) == 0) ? factor * 2 : header.chunkSize)
+	{
+		layout.coarseFactor = factor;
+		layout.coarseSize[0] = (header.width + factor - 1) / factor;
+		layout.coarseSize[1] = (header.height + factor - 1) / factor;
+		layout.coarseSize[2] = (header.depth + factor - 1) / factor;
+		layout.coarseBytes = static_cast<uint64_t>(layout.coarseSize[0]) * layout.coarseSize[1] * layout.coarseSize[2] * sizeof(uint16_t);
+
+		uint32_t largest = std::max(std::max(layout.coarseSize[0], layout.coarseSize[1]), layout.coarseSize[2]);
+		if ((layout.coarseBytes <= coarseBudget && largest <= maxTextureDimension) || factor >= header.chunkSize)
+		{
+			break;
+		}
+	}
+
+	// Pool slots from what is left, capped by the chunk count and the 16-bit page table (0 means not resident).
+	uint32_t padded = header.chunkSize + 2;
+	uint64_t slotBytes = static_cast<uint64_t>(padded) * padded * padded * sizeof(uint16_t);
+	uint64_t remaining = (budgetBytes > layout.coarseBytes) ? budgetBytes - layout.coarseBytes : 0;
+	uint64_t chunkCount = static_cast<uint64_t>(header.chunksX) * header.chunksY * header.chunksZ;
+	uint64_t slotCount = std::min(std::min(remaining / slotBytes, chunkCount), static_cast<uint64_t>(UINT16_MAX));
+	slotCount = std::max<uint64_t>(slotCount, 1);
+
+	// Close to a cube, rounding down so the pool never holds more slots than were paid for.
+	uint32_t maxPerAxis = std::max(1u, maxTextureDimension / padded);
+	uint32_t x = static_cast<uint32_t>(std::cbrt(static_cast<double>(slotCount)) + 1e-6);
+	x = std::max(1u, std::min(x, maxPerAxis));
+	uint32_t y = static_cast<uint32_t>(std::sqrt(static_cast<double>(slotCount / x)) + 1e-6);
+	y = std::max(1u, std::min(y, maxPerAxis));
+	uint32_t z = static_cast<uint32_t>(std::max<uint64_t>(1, std::min<uint64_t>(slotCount / (static_cast<uint64_t>(x) * y), maxPerAxis)));
+
+	layout.slots[0] = x;
+	layout.slots[1] = y;
+	layout.slots[2] = z;
+	layout.poolBytes = static_cast<uint64_t>(x) * y * z * slotBytes;
+	return layout;
+}
+
+void VolumeShaderTest::DownsampleChunk(
+	const ChunkStoreHeader& header,
+	uint32_t chunkIndex,
+	const uint16_t* paddedChunk,
+	uint32_t factor,
+	uint32_t box[6],
+	std::vector<uint16_t>& coarse)
+{
+	const uint32_t dims[3] = { header.width, header.height, header.depth };
+	const uint32_t chunk[3] =
+	{
+		chunkIndex % header.chunksX,
+		(chunkIndex / header.chunksX) % header.chunksY,
+		chunkIndex / (header.chunksX * header.chunksY)
+	};
+
+	// Volume voxels [first, last) of this chunk and the coarse texels covering them.
+	uint32_t first[3], last[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		first[axis] = chunk[axis] * header.chunkSize;
+		last[axis] = std::min(first[axis] + header.chunkSize, dims[axis]);
+		box[axis] = first[axis] / factor;
+		box[axis + 3] = (last[axis] + factor - 1) / factor;
+	}
+
+	uint32_t padded = header.chunkSize + 2;
+	coarse.resize(static_cast<size_t>(box[3] - box[0]) * (box[4] - box[1]) * (box[5] - box[2]));
+	size_t out = 0;
+	for (uint32_t cz = box[2]; cz < box[5]; ++cz)
+	{
+		for (uint32_t cy = box[1]; cy < box[4]; ++cy)
+		{
+			for (uint32_t cx = box[0]; cx < box[3]; ++cx)
+			{
+				uint64_t sum = 0;
+				uint32_t count = 0;
+				for (uint32_t z = cz * factor; z < std::min((cz + 1) * factor, last[2]); ++z)
+				{
+					for (uint32_t y = cy * factor; y < std::min((cy + 1) * factor, last[1]); ++y)
+					{
+						// Padded voxel (0, 0, 0) sits one voxel before the chunk's first voxel on every axis.
+						const uint16_t* row = paddedChunk + (static_cast<size_t>(z - first[2] + 1) * padded + (y - first[1] + 1)) * padded + 1 - first[0];
+						for (uint32_t x = cx * factor; x < std::min((cx + 1) * factor, last[0]); ++x)
+						{
+							sum += row[x];
+							count++;
+						}
+					}
+				}
+				coarse[out++] = static_cast<uint16_t>((sum + count / 2) / count);
+			}
+		}
+	}
+}
+
+OutOfCoreVolume::OutOfCoreVolume(uint64_t cacheBytes, uint32_t ioThreads) :
+	m_cache(cacheBytes),
+	m_ioThreads(ioThreads)
+{
+}
+
+bool OutOfCoreVolume::Open(const DX::FilePath& path)
+{
+	m_scheduler.reset();
+	if (!m_store.Open(path))
+	{
+		return false;
+	}
+
+	m_scheduler.reset(new ChunkFetchScheduler(m_store, m_cache, m_ioThreads));
+	return true;
+}
@@ -0,0 +1,152 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ChunkStore.h"
+
+namespace VolumeShaderTest
+{
+	typedef std::vector<uint16_t> ChunkData;
+
+	struct ChunkCacheStats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t insertions;
+		uint64_t evictions;
+		uint64_t refused;		// Inserts turned away because readers held everything that could have been evicted.
+		uint64_t bytes;
+		uint64_t peakBytes;		// Never above the budget.
+	};
+
+	// LRU cache of decoded chunks in CPU memory, between the chunk store and the GPU brick pool.
+	// Chunks are shared, but one a reader still holds is never evicted, so every chunk the cache has handed
+	// out counts toward the budget until it is evicted and freed.
+	class ChunkCache
+	{
+	public:
+		explicit ChunkCache(uint64_t budgetBytes);
+
+		std::shared_ptr<const ChunkData> Find(uint32_t index);
+		bool Contains(uint32_t index) const;
+
+		// Evicts least recently used chunks nobody else holds until the new one fits. Returns false, dropping the
+		// chunk, when it is already cached, larger than the budget, or cannot fit without evicting a held chunk.
+		bool Insert(uint32_t index, std::shared_ptr<const ChunkData> chunk);
+
+		uint64_t GetBudget() const { return m_budget; }
+		ChunkCacheStats GetStats() const;
+
+	private:
+		typedef std::list<std::pair<uint32_t, std::shared_ptr<const ChunkData>>> LruList;
+
+		mutable std::mutex										m_mutex;
+		uint64_t												m_budget;
+		LruList													m_lru;		// Most recent first.
+		std::unordered_map<uint32_t, LruList::iterator>			m_entries;
+		ChunkCacheStats											m_stats;
+	};
+
+	struct ChunkRequest
+	{
+		uint32_t index;
+		float priority;		// Higher is fetched first.
+	};
+
+	struct ChunkFetchStats
+	{
+		uint64_t requested;
+		uint64_t fetched;
+		uint64_t failed;
+		uint64_t dropped;	// Requests replaced by a newer frame's feedback before a worker reached them.
+	};
+
+	// I/O thread pool that reads chunks requested by the renderer's visibility feedback into the cache.
+	// Each SetRequests call replaces the pending queue, so chunks that fell out of view are never read.
+	// Loaded chunks land in the cache, where the renderer picks them up on a later frame.
+	class ChunkFetchScheduler
+	{
+	public:
+		ChunkFetchScheduler(const VolumeChunkStore& store, ChunkCache& cache, uint32_t threadCount);
+		~ChunkFetchScheduler();
+
+		ChunkFetchScheduler(const ChunkFetchScheduler&) = delete;
+		ChunkFetchScheduler& operator=(const ChunkFetchScheduler&) = delete;
+
+		// Queues the chunks that are neither cached nor being read, highest priority first.
+		void SetRequests(const std::vector<ChunkRequest>& requests);
+
+		// Blocks until the queue is empty and no read is in flight.
+		void WaitIdle();
+
+		ChunkFetchStats GetStats() const;
+
+	private:
+		void WorkerLoop();
+
+		const VolumeChunkStore&			m_store;
+		ChunkCache&						m_cache;
+		std::vector<std::thread>		m_workers;
+
+		mutable std::mutex				m_mutex;
+		std::condition_variable			m_wake;
+		std::condition_variable			m_idle;
+		std::vector<ChunkRequest>		m_queue;		// Sorted by ascending priority; workers pop the back.
+		std::unordered_set<uint32_t>	m_inFlight;
+		ChunkFetchStats					m_stats;
+		bool							m_stopping;
+	};
+
+	// GPU memory plan for an out-of-core volume: a brick pool of full resolution chunks plus a coarse copy of the
+	// whole volume that stands in for chunks the pool cannot hold or has not loaded yet.
+	struct BrickPoolLayout
+	{
+		uint32_t slots[3];			// Pool slots per axis.
+		uint32_t coarseFactor;		// Volume voxels per coarse voxel along each axis; divides the chunk size.
+		uint32_t coarseSize[3];		// Coarse volume size in voxels.
+		uint64_t poolBytes;
+		uint64_t coarseBytes;
+	};
+
+	// Gives the coarse level at most an eighth of the budget, at the finest factor that fits down to one texel per
+	// chunk, and the rest to pool slots of 16-bit voxels. The pool never has more slots than the store has chunks or
+	// the page table can address, and no pool axis exceeds maxTextureDimension. At least one slot is always kept.
+	BrickPoolLayout ChooseBrickPoolLayout(const ChunkStoreHeader& header, uint64_t budgetBytes, uint32_t maxTextureDimension);
+
+	// Averages a padded chunk's own voxels (not its apron) over factor^3 blocks, for the chunk's part of the coarse
+	// volume. Writes the coarse texel range [begin, end) per axis to box as x0, y0, z0, x1, y1, z1 and the texels,
+	// x fastest, to coarse. Coarse texels cut by the volume edge average the voxels inside it.
+	void DownsampleChunk(
+		const ChunkStoreHeader& header,
+		uint32_t chunkIndex,
+		const uint16_t* paddedChunk,
+		uint32_t factor,
+		uint32_t box[6],
+		std::vector<uint16_t>& coarse);
+
+	// A chunk store opened for rendering together with its CPU cache and fetch threads.
+	class OutOfCoreVolume
+	{
+	public:
+		OutOfCoreVolume(uint64_t cacheBytes, uint32_t ioThreads);
+
+		bool Open(const DX::FilePath& path);
+
+		const VolumeChunkStore& GetStore() const { return m_store; }
+		ChunkCache& GetCache() { return m_cache; }
+		ChunkFetchScheduler& GetScheduler() { return *m_scheduler; }
+
+	private:
+		VolumeChunkStore						m_store;
+		ChunkCache								m_cache;
+		uint32_t								m_ioThreads;
+		std::unique_ptr<ChunkFetchScheduler>	m_scheduler;
+	};
+}
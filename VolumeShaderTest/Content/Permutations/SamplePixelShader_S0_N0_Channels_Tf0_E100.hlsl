@@ -0,0 +1,9 @@
+// Raymarch permutation; must match its RAYMARCH_PERMUTATION entry in ShaderPermutationManifest.h.
+#define RAYMARCH_SHADOWS 0
+#define RAYMARCH_STEPS 0
+#define RAYMARCH_FORMAT 3
+#define RAYMARCH_TRANSFER_FUNCTION 0
+#define RAYMARCH_EARLY_OUT 100
+#define RAYMARCH_GRADIENTS 0
+
+#include "..\SamplePixelShader.hlsl"
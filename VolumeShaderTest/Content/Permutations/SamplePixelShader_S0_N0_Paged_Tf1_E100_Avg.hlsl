@@ -0,0 +1,10 @@
+// Raymarch permutation; must match its RAYMARCH_PERMUTATION entry in ShaderPermutationManifest.h.
+#define RAYMARCH_SHADOWS 0
+#define RAYMARCH_STEPS 0
+#define RAYMARCH_FORMAT 2
+#define RAYMARCH_TRANSFER_FUNCTION 1
+#define RAYMARCH_EARLY_OUT 100
+#define RAYMARCH_GRADIENTS 0
+#define RAYMARCH_COMPOSITE 3
+
+#include "..\SamplePixelShader.hlsl"
@@ -0,0 +1,120 @@
+﻿#include "pch.h"
+#include "RayClip.h"
+#include <cfloat>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// Narrows [tEntry, tExit] to the part of the ray where numerator + t * denominator >= 0.
+	inline void ClipHalfSpace(float numerator, float denominator, float& tEntry, float& tExit)
+	{
+		if (denominator > 0.0f)
+		{
+			float t = -numerator / denominator;
+			tEntry = (t > tEntry) ? t : tEntry;
+		}
+		else if (denominator < 0.0f)
+		{
+			float t = -numerator / denominator;
+			tExit = (t < tExit) ? t : tExit;
+		}
+		else if (numerator < 0.0f)
+		{
+			tExit = -FLT_MAX;
+		}
+	}
+}
+
+ClipRegion::ClipRegion() :
+	planeCount(0),
+	cropEnabled(false)
+{
+	for (uint32_t i = 0; i < MaxClipPlanes; ++i)
+	{
+		planes[i] = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+	XMStoreFloat4x4(&cropMatrix, XMMatrixIdentity());
+}
+
+XMFLOAT4X4 VolumeShaderTest::MakeCropMatrix(const XMFLOAT3& center, const XMFLOAT3& halfExtents, const XMFLOAT4& orientation)
+{
+	// Inverse of scale, then rotate, then translate; a flat box keeps a sliver rather than dividing by zero.
+	const float minExtent = 1e-6f;
+	XMMATRIX toCrop = XMMatrixMultiply(
+		XMMatrixTranslation(-center.x, -center.y, -center.z),
+		XMMatrixTranspose(XMMatrixRotationQuaternion(XMQuaternionNormalize(XMLoadFloat4(&orientation)))));
+	toCrop = XMMatrixMultiply(toCrop, XMMatrixScaling(
+		1.0f / ((halfExtents.x > minExtent) ? halfExtents.x : minExtent),
+		1.0f / ((halfExtents.y > minExtent) ? halfExtents.y : minExtent),
+		1.0f / ((halfExtents.z > minExtent) ? halfExtents.z : minExtent)));
+
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, toCrop);
+	return result;
+}
+
+bool VolumeShaderTest::ClipRay(const ClipRegion& region, const XMFLOAT3& origin, const XMFLOAT3& direction, float& tEntry, float& tExit)
+{
+	uint32_t planeCount = (region.planeCount < MaxClipPlanes) ? region.planeCount : MaxClipPlanes;
+	for (uint32_t i = 0; i < planeCount; ++i)
+	{
+		const XMFLOAT4& plane = region.planes[i];
+		ClipHalfSpace(
+			plane.x * origin.x + plane.y * origin.y + plane.z * origin.z + plane.w,
+			plane.x * direction.x + plane.y * direction.y + plane.z * direction.z,
+			tEntry, tExit);
+	}
+
+	if (region.cropEnabled)
+	{
+		// The map to crop space is affine, so distances along the mapped ray stay those of the local one.
+		XMMATRIX toCrop = XMLoadFloat4x4(&region.cropMatrix);
+		XMFLOAT3 o, d;
+		XMStoreFloat3(&o, XMVector3Transform(XMLoadFloat3(&origin), toCrop));
+		XMStoreFloat3(&d, XMVector3TransformNormal(XMLoadFloat3(&direction), toCrop));
+
+		const float os[3] = { o.x, o.y, o.z };
+		const float ds[3] = { d.x, d.y, d.z };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			ClipHalfSpace(1.0f - os[axis], -ds[axis], tEntry, tExit);
+			ClipHalfSpace(1.0f + os[axis], ds[axis], tEntry, tExit);
+		}
+	}
+	return tEntry <= tExit;
+}
+
+bool VolumeShaderTest::InsideClipRegion(const ClipRegion& region, float x, float y, float z)
+{
+	uint32_t planeCount = (region.planeCount < MaxClipPlanes) ? region.planeCount : MaxClipPlanes;
+	for (uint32_t i = 0; i < planeCount; ++i)
+	{
+		const XMFLOAT4& plane = region.planes[i];
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	if (!region.cropEnabled)
+	{
+		return true;
+	}
+
+	XMFLOAT3 c;
+	XMStoreFloat3(&c, XMVector3Transform(XMVectorSet(x, y, z, 1.0f), XMLoadFloat4x4(&region.cropMatrix)));
+	return fabsf(c.x) <= 1.0f && fabsf(c.y) <= 1.0f && fabsf(c.z) <= 1.0f;
+}
+
+void VolumeShaderTest::StoreClipRegion(const ClipRegion& region, ModelViewProjectionConstantBuffer& constants)
+{
+	uint32_t planeCount = (region.planeCount < MaxClipPlanes) ? region.planeCount : MaxClipPlanes;
+	constants.clipParams = XMFLOAT4(static_cast<float>(planeCount), region.cropEnabled ? 1.0f : 0.0f, 0.0f, 0.0f);
+	for (uint32_t i = 0; i < MaxClipPlanes; ++i)
+	{
+		constants.clipPlanes[i] = region.planes[i];
+	}
+	XMStoreFloat4x4(&constants.cropBoxMatrix, XMMatrixTranspose(XMLoadFloat4x4(&region.cropMatrix)));
+}
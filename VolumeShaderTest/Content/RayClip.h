@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include "ShaderStructures.h"
+
+namespace VolumeShaderTest
+{
+	// Region of interest in the volume's local space, where the volume box spans [-0.5, 0.5]: the points on the
+	// kept side of every clip plane and inside the crop box.
+	struct ClipRegion
+	{
+		ClipRegion();
+
+		bool IsActive() const { return planeCount > 0 || cropEnabled; }
+
+		uint32_t planeCount;
+		DirectX::XMFLOAT4 planes[MaxClipPlanes];	// xyz: normal, w: offset; keeps points with dot(n, p) + w >= 0.
+		bool cropEnabled;
+		DirectX::XMFLOAT4X4 cropMatrix;	// Local space to crop space, where the kept box spans [-1, 1].
+	};
+
+	// Crop space of a box with the given center and half extents, turned by the orientation quaternion.
+	DirectX::XMFLOAT4X4 MakeCropMatrix(
+		const DirectX::XMFLOAT3& center,
+		const DirectX::XMFLOAT3& halfExtents,
+		const DirectX::XMFLOAT4& orientation);
+
+	// Same as ClipRay() in RayClip.hlsli: narrows [tEntry, tExit] along the local ray to the part inside the region.
+	// Returns false when nothing is left.
+	bool ClipRay(
+		const ClipRegion& region,
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		float& tEntry,
+		float& tExit);
+
+	bool InsideClipRegion(const ClipRegion& region, float x, float y, float z);
+
+	// Fills clipParams, clipPlanes and cropBoxMatrix.
+	void StoreClipRegion(const ClipRegion& region, ModelViewProjectionConstantBuffer& constants);
+}
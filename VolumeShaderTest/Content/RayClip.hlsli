@@ -0,0 +1,48 @@
+// Region of interest from the clip planes and crop box in the constant buffer, mirrored by RayClip.cpp.
+// Include after ConstantBuffer.hlsli.
+
+// Narrows t to the part of the ray where numerator + t * denominator >= 0.
+void ClipHalfSpace(float numerator, float denominator, inout float2 t)
+{
+    if (denominator > 0.0f)
+        t.x = max(t.x, -numerator / denominator);
+    else if (denominator < 0.0f)
+        t.y = min(t.y, -numerator / denominator);
+    else if (numerator < 0.0f)
+        t.y = -3.402823e38f;
+}
+
+// Intersects the interval t along the local ray with the kept side of every clip plane and with the crop box.
+// Nothing is left when the result has x > y.
+float2 ClipRay(float3 ro, float3 rd, float2 t)
+{
+    int planeCount = min(int(clipParams.x), MAX_CLIP_PLANES);
+    for (int i = 0; i < planeCount; i++)
+        ClipHalfSpace(dot(clipPlanes[i].xyz, ro) + clipPlanes[i].w, dot(clipPlanes[i].xyz, rd), t);
+
+    if (clipParams.y > 0.0f)
+    {
+        // The map to crop space is affine, so distances along the mapped ray stay those of the local one.
+        float3 o = mul(float4(ro, 1.0f), cropBoxMatrix).xyz;
+        float3 d = mul(float4(rd, 0.0f), cropBoxMatrix).xyz;
+        [unroll]
+        for (int axis = 0; axis < 3; axis++)
+        {
+            ClipHalfSpace(1.0f - o[axis], -d[axis], t);
+            ClipHalfSpace(1.0f + o[axis], d[axis], t);
+        }
+    }
+    return t;
+}
+
+bool InsideClipRegion(float3 p)
+{
+    int planeCount = min(int(clipParams.x), MAX_CLIP_PLANES);
+    for (int i = 0; i < planeCount; i++)
+    {
+        if (dot(clipPlanes[i].xyz, p) + clipPlanes[i].w < 0.0f)
+            return false;
+    }
+
+    return clipParams.y == 0.0f || all(abs(mul(float4(p, 1.0f), cropBoxMatrix).xyz) <= 1.0f);
+}
@@ -0,0 +1,571 @@
+﻿#include "pch.h"
+#include "ReferenceRaymarcher.h"
+#include "ChannelVolume.h"
+#include <cfloat>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	inline float Frac(float value)
+	{
+		return value - floorf(value);
+	}
+
+	// Same slab test as IntersectBox() in the shader, including the 1e-6 bias on the direction.
+	inline void IntersectBox(const XMFLOAT3& ro, const XMFLOAT3& rd, float& tNear, float& tFar)
+	{
+		float invX = 1.0f / (rd.x + 1e-6f);
+		float invY = 1.0f / (rd.y + 1e-6f);
+		float invZ = 1.0f / (rd.z + 1e-6f);
+
+		float tx0 = (-0.5f - ro.x) * invX, tx1 = (0.5f - ro.x) * invX;
+		float ty0 = (-0.5f - ro.y) * invY, ty1 = (0.5f - ro.y) * invY;
+		float tz0 = (-0.5f - ro.z) * invZ, tz1 = (0.5f - ro.z) * invZ;
+
+		float minX = (tx0 < tx1) ? tx0 : tx1, maxX = (tx0 < tx1) ? tx1 : tx0;
+		float minY = (ty0 < ty1) ? ty0 : ty1, maxY = (ty0 < ty1) ? ty1 : ty0;
+		float minZ = (tz0 < tz1) ? tz0 : tz1, maxZ = (tz0 < tz1) ? tz1 : tz0;
+
+		tNear = (minX > minY) ? minX : minY;
+		tNear = (tNear > minZ) ? tNear : minZ;
+		tFar = (maxX < maxY) ? maxX : maxY;
+		tFar = (tFar < maxZ) ? tFar : maxZ;
+	}
+
+	// Steps from tCurrent on that the march would still have taken before tExit; only these count as skipped by the
+	// scene depth, not those the box exit ends anyway.
+	inline int StepsBefore(float tCurrent, float stepSize, float tExit, int remaining)
+	{
+		if (tCurrent > tExit)
+		{
+			return 0;
+		}
+		float steps = floorf((tExit - tCurrent) / stepSize) + 1.0f;
+		return (steps < static_cast<float>(remaining)) ? static_cast<int>(steps) : remaining;
+	}
+
+	inline bool InsideBox(float x, float y, float z)
+	{
+		return x > -0.5f && y > -0.5f && z > -0.5f && x < 0.5f && y < 0.5f && z < 0.5f;
+	}
+
+	inline float SampleDensity(const VolumeData& volume, const XMFLOAT3& ro, const XMFLOAT3& rd, float t, uint64_t& samples)
+	{
+		samples++;
+		return volume.SampleAlpha(ro.x + rd.x * t + 0.5f, ro.y + rd.y * t + 0.5f, ro.z + rd.z * t + 0.5f);
+	}
+
+	// Mirror of ProjectRay() in SamplePixelShader.hlsl: the steps of the alpha march reduced to one density, or ended
+	// at the first sample reaching the threshold. Returns the color before dither.
+	XMFLOAT4 ProjectRay(
+		const VolumeData& volume,
+		const RaymarchSettings& settings,
+		const XMFLOAT3& ro,
+		const XMFLOAT3& rd,
+		const XMFLOAT3& localLight,
+		float cellExtent,
+		float tCurrent,
+		float stepSize,
+		int firstStep,
+		float tStart,
+		float tLimit,
+		float& resultDepth,
+		uint64_t& samples)
+	{
+		CompositeMode mode = settings.composite;
+		float result = (mode == CompositeMode::MinimumIntensity) ? 1.0f : 0.0f;
+		resultDepth = tStart;
+		int count = 0;
+		bool hit = false;
+
+		// Only the maximum and the first hit can skip empty space; the minimum and the average need every sample.
+		bool skipping = cellExtent > 0.0f && (mode == CompositeMode::MaximumIntensity || mode == CompositeMode::FirstHit);
+		for (int i = firstStep; i < settings.steps; ++i)
+		{
+			if (tCurrent > tLimit)
+			{
+				break;
+			}
+
+			if (skipping)
+			{
+				float px = ro.x + rd.x * tCurrent, py = ro.y + rd.y * tCurrent, pz = ro.z + rd.z * tCurrent;
+				int skip = static_cast<int>(settings.distanceField->Lookup(px + 0.5f, py + 0.5f, pz + 0.5f) * cellExtent / stepSize);
+				if (skip > 0)
+				{
+					i += skip - 1;
+					tCurrent += skip * stepSize;
+					continue;
+				}
+			}
+
+			float density = SampleDensity(volume, ro, rd, tCurrent, samples);
+			count++;
+			if (mode == CompositeMode::MaximumIntensity)
+			{
+				if (density > result)
+				{
+					result = density;
+					resultDepth = tCurrent;
+					if (result >= 1.0f)
+					{
+						break;
+					}
+				}
+			}
+			else if (mode == CompositeMode::MinimumIntensity)
+			{
+				if (density < result)
+				{
+					result = density;
+					resultDepth = tCurrent;
+					if (result <= 0.0f)
+					{
+						break;
+					}
+				}
+			}
+			else if (mode == CompositeMode::AverageIntensity)
+			{
+				result += density;
+			}
+			else if (density >= settings.firstHitThreshold)
+			{
+				hit = true;
+				break;
+			}
+			tCurrent += stepSize;
+		}
+
+		if (mode != CompositeMode::FirstHit)
+		{
+			if (mode == CompositeMode::AverageIntensity)
+			{
+				result = (count > 0) ? result / count : 0.0f;
+				resultDepth = 0.5f * (tStart + tLimit);
+			}
+			if (count == 0)
+			{
+				return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+			}
+			if (settings.transferFunction != nullptr)
+			{
+				XMFLOAT4 color = SampleTransferFunction(*settings.transferFunction, result);
+				return XMFLOAT4(color.x * color.w, color.y * color.w, color.z * color.w, color.w);
+			}
+			return XMFLOAT4(result, result, result, result);
+		}
+		if (!hit)
+		{
+			return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+
+		// Bisect the crossing between the previous step and this one.
+		float tLow = (tCurrent - stepSize > tStart) ? tCurrent - stepSize : tStart;
+		float tHigh = tCurrent;
+		for (int j = 0; j < 4; ++j)
+		{
+			float tMid = 0.5f * (tLow + tHigh);
+			if (SampleDensity(volume, ro, rd, tMid, samples) >= settings.firstHitThreshold)
+			{
+				tHigh = tMid;
+			}
+			else
+			{
+				tLow = tMid;
+			}
+		}
+		resultDepth = tHigh;
+
+		// Central differences one step wide; the normal faces away from the denser side.
+		float hx = ro.x + rd.x * tHigh + 0.5f, hy = ro.y + rd.y * tHigh + 0.5f, hz = ro.z + rd.z * tHigh + 0.5f;
+		float h = stepSize;
+		XMVECTOR normal = XMVectorSet(
+			volume.SampleAlpha(hx - h, hy, hz) - volume.SampleAlpha(hx + h, hy, hz),
+			volume.SampleAlpha(hx, hy - h, hz) - volume.SampleAlpha(hx, hy + h, hz),
+			volume.SampleAlpha(hx, hy, hz - h) - volume.SampleAlpha(hx, hy, hz + h),
+			0.0f);
+		samples += 6;
+		normal = (XMVectorGetX(XMVector3Dot(normal, normal)) > 0.0f) ? XMVector3Normalize(normal) : XMVectorNegate(XMLoadFloat3(&rd));
+
+		XMVECTOR lightDir = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&localLight), XMVectorSet(hx - 0.5f, hy - 0.5f, hz - 0.5f, 0.0f)));
+		float diffuse = XMVectorGetX(XMVector3Dot(normal, lightDir));
+		diffuse = (diffuse < 0.0f) ? 0.0f : (diffuse > 1.0f ? 1.0f : diffuse);
+		float shade = settings.firstHitAmbient + (1.0f - settings.firstHitAmbient) * diffuse;
+
+		XMFLOAT4 albedo = (settings.transferFunction != nullptr) ?
+			SampleTransferFunction(*settings.transferFunction, volume.SampleAlpha(hx, hy, hz)) :
+			volume.Sample(hx, hy, hz);
+		samples++;
+		return XMFLOAT4(albedo.x * shade, albedo.y * shade, albedo.z * shade, 1.0f);
+	}
+}
+
+RaymarchCamera VolumeShaderTest::MakeRaymarchCamera(
+	FXMMATRIX world,
+	CXMMATRIX view,
+	CXMMATRIX projection,
+	const XMFLOAT3& cameraPosition,
+	const XMFLOAT3& lightPosition)
+{
+	RaymarchCamera camera;
+	XMMATRIX worldViewProjection = XMMatrixMultiply(XMMatrixMultiply(world, view), projection);
+	XMStoreFloat4x4(&camera.invWorldViewProjection, XMMatrixInverse(nullptr, worldViewProjection));
+	XMStoreFloat4x4(&camera.invWorld, XMMatrixInverse(nullptr, world));
+	camera.cameraPosition = cameraPosition;
+	camera.lightPosition = lightPosition;
+	return camera;
+}
+
+void ReferenceImage::Resize(uint32_t w, uint32_t h)
+{
+	width = w;
+	height = h;
+	color.assign(static_cast<size_t>(w) * h, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+	entryDepth.assign(static_cast<size_t>(w) * h, -1.0f);
+	weightedDepth.assign(static_cast<size_t>(w) * h, -1.0f);
+	samples = 0;
+	depthSkippedSamples = 0;
+}
+
+XMFLOAT4 ReferenceImage::SampleColor(float u, float v) const
+{
+	float fx = u * width - 0.5f;
+	float fy = v * height - 0.5f;
+	float bx = floorf(fx);
+	float by = floorf(fy);
+	float tx = fx - bx;
+	float ty = fy - by;
+
+	XMFLOAT4 result(0.0f, 0.0f, 0.0f, 0.0f);
+	for (int tap = 0; tap < 4; ++tap)
+	{
+		int x = static_cast<int>(bx) + (tap & 1);
+		int y = static_cast<int>(by) + (tap >> 1);
+		x = (x < 0) ? 0 : (x >= static_cast<int>(width) ? width - 1 : x);
+		y = (y < 0) ? 0 : (y >= static_cast<int>(height) ? height - 1 : y);
+
+		float weight = ((tap & 1) ? tx : 1.0f - tx) * ((tap >> 1) ? ty : 1.0f - ty);
+		const XMFLOAT4& c = color[static_cast<size_t>(y) * width + x];
+		result.x += c.x * weight;
+		result.y += c.y * weight;
+		result.z += c.z * weight;
+		result.w += c.w * weight;
+	}
+	return result;
+}
+
+ImageError VolumeShaderTest::CompareImages(const ReferenceImage& reference, const ReferenceImage& test, float threshold)
+{
+	ImageError error = {};
+	size_t count = (reference.color.size() < test.color.size()) ? reference.color.size() : test.color.size();
+	if (count == 0)
+	{
+		return error;
+	}
+
+	double sumSquared = 0.0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const XMFLOAT4& a = reference.color[i];
+		const XMFLOAT4& b = test.color[i];
+		float diff[4] = { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+
+		float pixelMax = 0.0f;
+		for (float d : diff)
+		{
+			sumSquared += d * d;
+			pixelMax = (fabsf(d) > pixelMax) ? fabsf(d) : pixelMax;
+		}
+		error.maxError = (pixelMax > error.maxError) ? pixelMax : error.maxError;
+		if (pixelMax > threshold)
+		{
+			error.pixelsAboveThreshold++;
+		}
+	}
+	error.rmse = static_cast<float>(sqrt(sumSquared / (count * 4.0)));
+	return error;
+}
+
+float ReferenceRaymarcher::InterleavedGradientNoise(float x, float y)
+{
+	return Frac(52.9829189f * Frac(x * 0.06711056f + y * 0.00583715f));
+}
+
+float ReferenceRaymarcher::SceneDistance(
+	const RaymarchCamera& camera,
+	const SceneDepthImage& sceneDepth,
+	float fullPixelX,
+	float fullPixelY,
+	const XMFLOAT3& origin,
+	const XMFLOAT3& direction)
+{
+	int x = static_cast<int>(fullPixelX);
+	int y = static_cast<int>(fullPixelY);
+	x = (x < 0) ? 0 : (x >= static_cast<int>(sceneDepth.width) ? sceneDepth.width - 1 : x);
+	y = (y < 0) ? 0 : (y >= static_cast<int>(sceneDepth.height) ? sceneDepth.height - 1 : y);
+	float depth = sceneDepth.depth[static_cast<size_t>(y) * sceneDepth.width + x];
+	if (depth >= 1.0f)
+	{
+		return FLT_MAX;
+	}
+
+	// invWorldViewProjection takes clip space straight back to the volume's local space.
+	float ndcX = fullPixelX / sceneDepth.width * 2.0f - 1.0f;
+	float ndcY = 1.0f - fullPixelY / sceneDepth.height * 2.0f;
+	XMVECTOR local = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, depth, 1.0f), XMLoadFloat4x4(&camera.invWorldViewProjection));
+	XMVECTOR offset = XMVectorSubtract(local, XMLoadFloat3(&origin));
+	return XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&direction)));
+}
+
+bool ReferenceRaymarcher::ComputeRay(
+	const RaymarchCamera& camera,
+	float pixelX,
+	float pixelY,
+	uint32_t width,
+	uint32_t height,
+	XMFLOAT3& origin,
+	XMFLOAT3& direction,
+	float& tEntry,
+	float& tExit)
+{
+	XMMATRIX invWorldViewProjection = XMLoadFloat4x4(&camera.invWorldViewProjection);
+	XMMATRIX invWorld = XMLoadFloat4x4(&camera.invWorld);
+
+	// The shader gets its ray from the rasterized back face; unprojecting the far plane gives the same direction.
+	float ndcX = pixelX / width * 2.0f - 1.0f;
+	float ndcY = 1.0f - pixelY / height * 2.0f;
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), invWorldViewProjection);
+	XMVECTOR localCam = XMVector3TransformCoord(XMLoadFloat3(&camera.cameraPosition), invWorld);
+
+	XMStoreFloat3(&origin, localCam);
+	XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSubtract(farPoint, localCam)));
+
+	float tNear, tFar;
+	IntersectBox(origin, direction, tNear, tFar);
+	tEntry = (tNear > 0.0f) ? tNear : 0.0f;
+	tExit = tFar;
+	return tEntry <= tExit && ClipRay(camera.clip, origin, direction, tEntry, tExit);
+}
+
+void ReferenceRaymarcher::Render(
+	const VolumeData& volume,
+	const RaymarchCamera& camera,
+	const RaymarchSettings& settings,
+	ReferenceImage& image)
+{
+	image.Resize(image.width, image.height);
+	image.samples = RenderRows(volume, camera, settings, image, 0, image.height, &image.depthSkippedSamples);
+}
+
+uint64_t ReferenceRaymarcher::RenderRows(
+	const VolumeData& volume,
+	const RaymarchCamera& camera,
+	const RaymarchSettings& settings,
+	ReferenceImage& image,
+	uint32_t firstRow,
+	uint32_t lastRow,
+	uint64_t* depthSkippedSamples)
+{
+	uint64_t samples = 0;
+	for (uint32_t y = firstRow; y < lastRow && y < image.height; ++y)
+	{
+		for (uint32_t x = 0; x < image.width; ++x)
+		{
+			size_t pixel = static_cast<size_t>(y) * image.width + x;
+			image.color[pixel] = TracePixel(
+				volume,
+				camera,
+				settings,
+				x + 0.5f,
+				y + 0.5f,
+				image.width,
+				image.height,
+				image.entryDepth[pixel],
+				image.weightedDepth[pixel],
+				samples,
+				depthSkippedSamples);
+		}
+	}
+	return samples;
+}
+
+XMFLOAT4 ReferenceRaymarcher::TracePixel(
+	const VolumeData& volume,
+	const RaymarchCamera& camera,
+	const RaymarchSettings& settings,
+	float pixelX,
+	float pixelY,
+	uint32_t width,
+	uint32_t height,
+	float& entryDepth,
+	float& weightedDepth,
+	uint64_t& samples,
+	uint64_t* depthSkippedSamples)
+{
+	entryDepth = -1.0f;
+	weightedDepth = -1.0f;
+
+	XMFLOAT3 ro, rd;
+	float tEntry, tExit;
+	if (!ComputeRay(camera, pixelX, pixelY, width, height, ro, rd, tEntry, tExit))
+	{
+		return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	XMMATRIX invWorld = XMLoadFloat4x4(&camera.invWorld);
+	XMFLOAT3 localLight;
+	XMStoreFloat3(&localLight, XMVector3TransformCoord(XMLoadFloat3(&camera.lightPosition), invWorld));
+
+	// Steps span the whole box as if nothing were clipped, and the march starts at the first step inside the clip
+	// region, so clipped regions cost no samples and the samples that remain do not move.
+	float tBox = tEntry;
+	float stepSize = (tExit - tEntry) / static_cast<float>(settings.steps);
+	if (camera.clip.IsActive())
+	{
+		float tNear, tFar;
+		IntersectBox(ro, rd, tNear, tFar);
+		tBox = (tNear > 0.0f) ? tNear : 0.0f;
+		stepSize = (tFar - tBox) / static_cast<float>(settings.steps);
+	}
+	float frameOffset = 5.588238f * static_cast<float>(settings.frameIndex);
+	float jitter = settings.jitter ? InterleavedGradientNoise(pixelX + frameOffset, pixelY + frameOffset) : 0.0f;
+	float tCurrent = tBox + jitter * stepSize;
+	int firstStep = 0;
+	if (tEntry > tCurrent)
+	{
+		firstStep = static_cast<int>(ceilf((tEntry - tCurrent) / stepSize));
+		tCurrent += firstStep * stepSize;
+	}
+
+	// The step size keeps spanning the whole box, so samples in front of the geometry do not move.
+	float tLimit = tExit;
+	if (settings.sceneDepth != nullptr && !settings.sceneDepth->depth.empty())
+	{
+		float fullX = pixelX * settings.sceneDepth->width / width;
+		float fullY = pixelY * settings.sceneDepth->height / height;
+		float tScene = SceneDistance(camera, *settings.sceneDepth, fullX, fullY, ro, rd);
+		tLimit = (tScene < tExit) ? tScene : tExit;
+		if (tLimit < tEntry)
+		{
+			if (depthSkippedSamples != nullptr)
+			{
+				*depthSkippedSamples += StepsBefore(tCurrent, stepSize, tExit, settings.steps - firstStep);
+			}
+			return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+	}
+
+	XMFLOAT4 accumulated(0.0f, 0.0f, 0.0f, 0.0f);
+	float depthSum = 0.0f;
+	float depthWeight = 0.0f;
+	const DistanceField* field = settings.distanceField;
+	float cellExtent = 0.0f;
+	if (field != nullptr && !field->distance.empty())
+	{
+		uint32_t cells = (field->width > field->height) ? field->width : field->height;
+		cells = (cells > field->depth) ? cells : field->depth;
+		cellExtent = 1.0f / static_cast<float>(cells);
+	}
+
+	if (settings.composite != CompositeMode::Alpha)
+	{
+		float resultDepth;
+		XMFLOAT4 color = ProjectRay(volume, settings, ro, rd, localLight, cellExtent, tCurrent, stepSize, firstStep, tEntry, tLimit, resultDepth, samples);
+		float projectedDither = (jitter - 0.5f) / 255.0f;
+		entryDepth = tEntry;
+		weightedDepth = resultDepth;
+		return XMFLOAT4(color.x + projectedDither, color.y + projectedDither, color.z + projectedDither, color.w);
+	}
+
+	for (int i = firstStep; i < settings.steps; ++i)
+	{
+		if (tCurrent > tLimit)
+		{
+			if (depthSkippedSamples != nullptr)
+			{
+				*depthSkippedSamples += StepsBefore(tCurrent, stepSize, tExit, settings.steps - i);
+			}
+			break;
+		}
+
+		float px = ro.x + rd.x * tCurrent;
+		float py = ro.y + rd.y * tCurrent;
+		float pz = ro.z + rd.z * tCurrent;
+
+		// Whole steps keep the samples on the same positions as a march without the field.
+		if (cellExtent > 0.0f)
+		{
+			int skip = static_cast<int>(field->Lookup(px + 0.5f, py + 0.5f, pz + 0.5f) * cellExtent / stepSize);
+			if (skip > 0)
+			{
+				i += skip - 1;
+				tCurrent += skip * stepSize;
+				continue;
+			}
+		}
+
+		XMFLOAT4 voxel = (settings.transferFunction != nullptr) ?
+			SampleTransferFunction(*settings.transferFunction, volume.SampleAlpha(px + 0.5f, py + 0.5f, pz + 0.5f)) :
+			volume.Sample(px + 0.5f, py + 0.5f, pz + 0.5f);
+		samples++;
+
+		if (voxel.w > 0.001f)
+		{
+			float shadow = 1.0f;
+			if (settings.shadows)
+			{
+				// Lightweight 3-sample shadow loop
+				float lx = localLight.x - px, ly = localLight.y - py, lz = localLight.z - pz;
+				float invLength = 1.0f / sqrtf(lx * lx + ly * ly + lz * lz);
+				lx *= invLength;
+				ly *= invLength;
+				lz *= invLength;
+
+				float lightAccum = 0.0f;
+				for (int j = 1; j <= 3; ++j)
+				{
+					float offset = static_cast<float>(j) * 0.04f;
+					float sx = px + lx * offset, sy = py + ly * offset, sz = pz + lz * offset;
+					if (InsideBox(sx, sy, sz) && InsideClipRegion(camera.clip, sx, sy, sz))
+					{
+						lightAccum += volume.SampleAlpha(sx + 0.5f, sy + 0.5f, sz + 0.5f);
+						samples++;
+					}
+				}
+				shadow = expf(-lightAccum * 10.0f * 0.04f);
+			}
+
+			float localAlpha = voxel.w * settings.globalDensity;
+			if (settings.opacityCorrection != 1.0f)
+			{
+				localAlpha = 1.0f - powf(1.0f - localAlpha, settings.opacityCorrection);
+			}
+			float transmittance = 1.0f - accumulated.w;
+			depthSum += tCurrent * localAlpha * transmittance;
+			depthWeight += localAlpha * transmittance;
+			accumulated.x += voxel.x * localAlpha * shadow * transmittance;
+			accumulated.y += voxel.y * localAlpha * shadow * transmittance;
+			accumulated.z += voxel.z * localAlpha * shadow * transmittance;
+			accumulated.w += localAlpha * transmittance;
+		}
+
+		if (accumulated.w >= 0.99f)
+		{
+			break;
+		}
+		tCurrent += stepSize;
+	}
+
+	// Final Dither to hide banding
+	float dither = (jitter - 0.5f) / 255.0f;
+	accumulated.x += dither;
+	accumulated.y += dither;
+	accumulated.z += dither;
+
+	entryDepth = tEntry;
+	weightedDepth = (depthWeight > 0.0f) ? depthSum / depthWeight : tEntry;
+	return accumulated;
+}
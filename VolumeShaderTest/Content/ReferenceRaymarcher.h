@@ -0,0 +1,162 @@
+﻿#pragma once
+
+#include <vector>
+#include "DistanceField.h"
+#include "RayClip.h"
+#include "ShaderPermutations.h"
+#include "VolumeData.h"
+
+namespace VolumeShaderTest
+{
+	// Camera and light state the pixel shader reads from its constant buffer.
+	struct RaymarchCamera
+	{
+		DirectX::XMFLOAT4X4 invWorldViewProjection;
+		DirectX::XMFLOAT4X4 invWorld;
+		DirectX::XMFLOAT3 cameraPosition;	// World space.
+		DirectX::XMFLOAT3 lightPosition;	// World space.
+		ClipRegion clip;					// Local space, like the clip planes and crop box in the constant buffer.
+	};
+
+	RaymarchCamera MakeRaymarchCamera(
+		DirectX::FXMMATRIX world,
+		DirectX::CXMMATRIX view,
+		DirectX::CXMMATRIX projection,
+		const DirectX::XMFLOAT3& cameraPosition,
+		const DirectX::XMFLOAT3& lightPosition);
+
+	// Hardware depth of the opaque scene (0 near, 1 far), as the marcher reads it from the depth buffer. Usually
+	// at full resolution while the march may run at a lower one.
+	struct SceneDepthImage
+	{
+		SceneDepthImage() : width(0), height(0) {}
+
+		uint32_t width;
+		uint32_t height;
+		std::vector<float> depth;
+	};
+
+	struct RaymarchSettings
+	{
+		RaymarchSettings() :
+			steps(128),
+			globalDensity(0.12f),
+			shadows(true),
+			jitter(true),
+			frameIndex(0),
+			opacityCorrection(1.0f),
+			distanceField(nullptr),
+			sceneDepth(nullptr),
+			composite(CompositeMode::Alpha),
+			firstHitThreshold(0.5f),
+			firstHitAmbient(0.25f),
+			transferFunction(nullptr)
+		{
+		}
+
+		int steps;
+		float globalDensity;
+		bool shadows;
+		bool jitter;
+		uint32_t frameIndex;	// Rotates the jitter pattern, as temporalParams.x does on the GPU.
+		float opacityCorrection;	// Exponent applied to each step's opacity when marching fewer steps than the base count.
+		const DistanceField* distanceField;	// Skips whole steps through empty space, like distanceParams on the GPU.
+		const SceneDepthImage* sceneDepth;	// Ends rays at opaque geometry, like sceneDepthParams on the GPU.
+		CompositeMode composite;			// Modes other than Alpha ignore shadows and opacityCorrection.
+		float firstHitThreshold;			// compositeParams.x on the GPU.
+		float firstHitAmbient;				// isosurfaceParams.w on the GPU.
+		const std::vector<DirectX::XMFLOAT4>* transferFunction;	// Colors density like RAYMARCH_TRANSFER_FUNCTION; null keeps the volume's color.
+	};
+
+	// Output of a CPU render. Pixels that miss the volume box, or whose ray the clip region removes entirely, keep zero
+	// color and an entry depth of -1.
+	struct ReferenceImage
+	{
+		ReferenceImage() : width(0), height(0), samples(0), depthSkippedSamples(0) {}
+
+		void Resize(uint32_t w, uint32_t h);
+
+		// Bilinear color fetch with clamp addressing at normalized coordinates, like SampleLevel on a render target.
+		DirectX::XMFLOAT4 SampleColor(float u, float v) const;
+
+		uint32_t width;
+		uint32_t height;
+		std::vector<DirectX::XMFLOAT4> color;
+		std::vector<float> entryDepth;	// Distance along the local-space ray to the box entry.
+		std::vector<float> weightedDepth;	// Opacity-weighted distance along the ray, used for reprojection.
+		uint64_t samples;				// Volume fetches taken, including shadow taps.
+		uint64_t depthSkippedSamples;	// Steps left untaken because the ray reached opaque depth.
+	};
+
+	// Per-channel color difference between two images of the same size.
+	struct ImageError
+	{
+		float rmse;
+		float maxError;
+		uint32_t pixelsAboveThreshold;
+	};
+
+	ImageError CompareImages(const ReferenceImage& reference, const ReferenceImage& test, float threshold);
+
+	// CPU mirror of SamplePixelShader.hlsl, used to check GPU techniques against a ground truth.
+	class ReferenceRaymarcher
+	{
+	public:
+		// Renders every pixel of the image at its current size.
+		static void Render(
+			const VolumeData& volume,
+			const RaymarchCamera& camera,
+			const RaymarchSettings& settings,
+			ReferenceImage& image);
+
+		// Renders the rows [firstRow, lastRow) so callers can split an image across threads.
+		static uint64_t RenderRows(
+			const VolumeData& volume,
+			const RaymarchCamera& camera,
+			const RaymarchSettings& settings,
+			ReferenceImage& image,
+			uint32_t firstRow,
+			uint32_t lastRow,
+			uint64_t* depthSkippedSamples = nullptr);
+
+		// Marches a single pixel; entry and weighted depth are -1 when the ray misses the box.
+		static DirectX::XMFLOAT4 TracePixel(
+			const VolumeData& volume,
+			const RaymarchCamera& camera,
+			const RaymarchSettings& settings,
+			float pixelX,
+			float pixelY,
+			uint32_t width,
+			uint32_t height,
+			float& entryDepth,
+			float& weightedDepth,
+			uint64_t& samples,
+			uint64_t* depthSkippedSamples = nullptr);
+
+		// Builds the local-space ray through the center of a pixel and intersects it with the unit volume box and the
+		// camera's clip region. Returns false when nothing of the ray is left.
+		static bool ComputeRay(
+			const RaymarchCamera& camera,
+			float pixelX,
+			float pixelY,
+			uint32_t width,
+			uint32_t height,
+			DirectX::XMFLOAT3& origin,
+			DirectX::XMFLOAT3& direction,
+			float& tEntry,
+			float& tExit);
+
+		// Distance along the local ray from origin to the opaque surface behind a full resolution pixel position,
+		// reconstructed from the scene depth like SceneDistance() in the shader. FLT_MAX at the far plane.
+		static float SceneDistance(
+			const RaymarchCamera& camera,
+			const SceneDepthImage& sceneDepth,
+			float fullPixelX,
+			float fullPixelY,
+			const DirectX::XMFLOAT3& origin,
+			const DirectX::XMFLOAT3& direction);
+
+		// Interleaved gradient noise, identical to IGN() in the shader.
+		static float InterleavedGradientNoise(float x, float y);
+	};
+}
@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ShaderPermutations.h"
+#include "VolumeData.h"
+
+namespace VolumeShaderTest
+{
+	// Camera, light and model rotation for one frame, in the world space of the interactive renderer.
+	struct CameraPose
+	{
+		DirectX::XMFLOAT3 eye;
+		DirectX::XMFLOAT3 target;
+		DirectX::XMFLOAT3 lightPosition;
+		float modelRotation;	// Radians about +y, as Update rotates the volume.
+	};
+
+	// Raymarch options. A backend renders them exactly as given or refuses them; see SupportsOptions.
+	struct RenderOptions
+	{
+		RenderOptions() :
+			shadows(true),
+			emptySpaceSkipping(false),
+			composite(CompositeMode::Alpha),
+			firstHitThreshold(0.5f)
+		{
+		}
+
+		bool shadows;
+		bool emptySpaceSkipping;
+		CompositeMode composite;
+		float firstHitThreshold;
+	};
+
+	struct RenderFrameStats
+	{
+		double samplesPerPixel;	// Negative when the backend cannot count its fetches.
+		uint64_t uploadBytes;	// Texture data copied for the frame.
+	};
+
+	// What the platform neutral code (benchmarks, batch jobs, tools) needs from a renderer. Implemented over
+	// Direct3D 11 by D3D11RenderBackend and on the CPU by CpuRenderBackend.
+	class IRenderBackend
+	{
+	public:
+		virtual ~IRenderBackend() {}
+
+		virtual const char* GetName() const = 0;
+
+		// Renders the given RGBA volume in the unit box; null goes back to the generated fog sphere.
+		virtual void SetVolume(const std::shared_ptr<const VolumeData>& volume) = 0;
+
+		// Maps density to color and opacity through the table; an empty table turns the lookup off.
+		virtual void SetTransferFunction(const std::vector<DirectX::XMFLOAT4>& table) = 0;
+
+		// Whether the options render as given with the current volume and transfer function. A backend never
+		// substitutes a nearby combination.
+		virtual bool SupportsOptions(const RenderOptions& options) const = 0;
+
+		// Applies supported options and returns true; otherwise keeps the current options and returns false.
+		virtual bool SetOptions(const RenderOptions& options) = 0;
+
+		virtual void Resize(uint32_t width, uint32_t height) = 0;
+		virtual uint32_t GetWidth() const = 0;
+		virtual uint32_t GetHeight() const = 0;
+
+		// Renders and presents one frame. frameIndex rotates the jitter pattern where the backend does not keep its
+		// own count. Returns false when the backend is not ready yet and nothing was drawn.
+		virtual bool RenderFrame(const CameraPose& pose, uint32_t frameIndex, RenderFrameStats& stats) = 0;
+	};
+}
@@ -1,19 +1,111 @@
 ﻿#include "pch.h"
 #include "Sample3DSceneRenderer.h"
+#include "VolumeData.h"
+#include "InterleavedSampling.h"
+#include "ShaderArchive.h"
+#include "ShaderContentKey.h"
 #include "Common\DirectXHelper.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <ppl.h>
 
 using namespace VolumeShaderTest;
 using namespace DirectX;
 using namespace Windows::Foundation;
 
+namespace
+{
+	// Density straight to gray and opacity.
+	std::vector<XMFLOAT4> DensityRamp()
+	{
+		std::vector<XMFLOAT4> ramp(256);
+		for (size_t i = 0; i < ramp.size(); ++i)
+		{
+			float density = static_cast<float>(i) / (ramp.size() - 1);
+			ramp[i] = XMFLOAT4(density, density, density, density);
+		}
+		return ramp;
+	}
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
 Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
 	m_loadingComplete(false),
 	m_degreesPerSecond(45),
 	m_indexCount(0),
 	m_tracking(false),
+	m_resolutionScale(1),
+	m_volumeTargetScale(0),
+	m_temporalEnabled(false),
+	m_historyValid(false),
+	m_historyIndex(0),
+	m_temporalStepsPerFrame(32),
+	m_frameIndex(0),
+	m_interleavePatternSize(0),
+	m_volumeTargetsInterleaved(false),
+	m_importanceEnabled(false),
+	m_importanceValid(false),
+	m_activeRaymarchRequest(UINT32_MAX),
+	m_shadowsEnabled(true),
+	m_gradientLightingEnabled(false),
+	m_gradientBuildMilliseconds(0.0),
+	m_emptySpaceSkippingEnabled(false),
+	m_distanceFieldBuildMilliseconds(0.0),
+	m_earlyOutPercent(99),
+	m_volumeFormat(VolumeFormat::Rgba),
+	m_compositeMode(CompositeMode::Alpha),
+	m_streamFrame(0),
+	m_isosurfaceIndexCount(0),
+	m_isosurfaceThreshold(0.5f),
+	m_isosurfaceEnabled(false),
+	m_isosurfaceMeshValid(false),
+	m_sceneDepthClipping(true),
+	m_volumeEditingEnabled(false),
+	m_uploadedBytes(0),
+	m_stereoEnabled(false),
+	m_occlusionReadbackNext(0),
+	m_occlusionReadbackPending(0),
+	m_brickPoolBudget(DefaultBrickPoolBytes),
 	m_deviceResources(deviceResources)
 {
+	ZeroMemory(&m_cullingStats, sizeof(m_cullingStats));
+	ZeroMemory(&m_volumeViewport, sizeof(m_volumeViewport));
+	ZeroMemory(&m_importanceViewport, sizeof(m_importanceViewport));
+	ZeroMemory(&m_stereoViewport, sizeof(m_stereoViewport));
+	ZeroMemory(&m_shaderLoadStats, sizeof(m_shaderLoadStats));
+	ZeroMemory(&m_loadArenaStats, sizeof(m_loadArenaStats));
+	ZeroMemory(&m_brickPoolStats, sizeof(m_brickPoolStats));
+	ZeroMemory(m_brickPoolSlots, sizeof(m_brickPoolSlots));
+	ZeroMemory(&m_distanceFieldParams, sizeof(m_distanceFieldParams));
+	ZeroMemory(&m_volumeUploadStats, sizeof(m_volumeUploadStats));
+
+	// Channels default to ramps tinted red, green, blue and yellow.
+	const XMFLOAT3 tints[MaxVolumeChannels] =
+	{
+		XMFLOAT3(1.0f, 0.2f, 0.1f),
+		XMFLOAT3(0.2f, 1.0f, 0.3f),
+		XMFLOAT3(0.2f, 0.4f, 1.0f),
+		XMFLOAT3(1.0f, 0.9f, 0.2f)
+	};
+	for (uint32 channel = 0; channel < MaxVolumeChannels; ++channel)
+	{
+		m_channelTables[channel].resize(256);
+		for (size_t i = 0; i < m_channelTables[channel].size(); ++i)
+		{
+			float value = static_cast<float>(i) / (m_channelTables[channel].size() - 1);
+			m_channelTables[channel][i] = XMFLOAT4(tints[channel].x, tints[channel].y, tints[channel].z, value);
+		}
+	}
+
+	// Entry depths are in local units, where the volume box is one unit wide.
+	m_constantBufferData.upsampleParams = XMFLOAT4(0.05f, 0.0f, 0.0f, 0.0f);
+	m_constantBufferData.gradientParams = XMFLOAT4(0.3f, 8.0f, 0.0f, 0.0f);
+	m_constantBufferData.isosurfaceParams = XMFLOAT4(0.9f, 0.85f, 0.75f, 0.25f);
+	m_constantBufferData.compositeParams = XMFLOAT4(0.5f, 0.0f, 0.0f, 0.0f);
+	m_constantBufferData.channelWeights = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	StoreClipRegion(m_clipRegion, m_constantBufferData);
+
 	CreateDeviceDependentResources();
 	CreateWindowSizeDependentResources();
 }
@@ -56,6 +148,10 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources()
 	// IMPORTANT: Update the camera position in the constant buffer for the raymarcher
 	XMStoreFloat4(&m_constantBufferData.cameraPosition, eye);
 
+	// Stereo eyes each get half of the output side by side.
+	ComputeStereoView(eye, at, up, fovAngleY, 0.5f * aspectRatio, 0.001f, 500.0f, m_stereoRig, m_stereoView);
+	OrientStereoView(m_stereoView, orientationMatrix);
+
 	// --- WORLD MATRIX ---
 	m_worldMatrix = XMMatrixIdentity();
 	XMStoreFloat4x4(&m_constantBufferData.worldMatrix, XMMatrixTranspose(m_worldMatrix));
@@ -68,6 +164,675 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources()
 
 	m_invWorldViewProjectionMatrix = XMMatrixInverse(nullptr, m_worldViewProjectionMatrix);
 	XMStoreFloat4x4(&m_constantBufferData.invWorldViewProjectionMatrix, XMMatrixTranspose(m_invWorldViewProjectionMatrix));
+
+	// The occlusion pyramid works at 1/16 of the depth buffer resolution, the size OcclusionDepthPixelShader reduces
+	// to; it stays at the far plane until the first readback of opaque depth arrives.
+	D3D11_VIEWPORT screenViewport = m_deviceResources->GetScreenViewport();
+	uint32 occlusionWidth = static_cast<uint32>(screenViewport.Width) / 16;
+	uint32 occlusionHeight = static_cast<uint32>(screenViewport.Height) / 16;
+	m_occlusionBuffer.Resize(occlusionWidth > 0 ? occlusionWidth : 1, occlusionHeight > 0 ? occlusionHeight : 1);
+	ReleaseOcclusionTargets();
+
+	// Reduced resolution targets are recreated on the next frame at the new size.
+	ReleaseVolumeTargets();
+}
+
+void Sample3DSceneRenderer::SetStereo(bool enabled, const StereoRig& rig)
+{
+	m_stereoEnabled = enabled;
+	m_stereoRig = rig;
+
+	// Recomputes the eye matrices and drops the offscreen targets, whose history belongs to the other mode.
+	CreateWindowSizeDependentResources();
+}
+
+void Sample3DSceneRenderer::SetResolutionScale(uint32 scale)
+{
+	m_resolutionScale = (scale >= 4) ? 4 : (scale >= 2 ? 2 : 1);
+}
+
+void Sample3DSceneRenderer::SetTemporalAccumulation(bool enabled, uint32 stepsPerFrame)
+{
+	m_temporalEnabled = enabled;
+	m_temporalStepsPerFrame = (stepsPerFrame > 0) ? stepsPerFrame : 1;
+	m_historyValid = false;
+}
+
+void Sample3DSceneRenderer::SetInterleavedMarching(uint32 patternSize)
+{
+	m_interleavePatternSize = (patternSize >= 4) ? 4 : (patternSize >= 2 ? 2 : 0);
+	m_historyValid = false;
+}
+
+void Sample3DSceneRenderer::SetImportanceSampling(bool enabled, const ImportanceSettings& settings)
+{
+	m_importanceEnabled = enabled;
+	m_importanceSettings = settings;
+	m_importanceSettings.tileSize = (settings.tileSize > 0) ? settings.tileSize : 1;
+
+	// The step budget texture is sized by the tile, so rebuild the offscreen targets on the next frame.
+	ReleaseVolumeTargets();
+}
+
+void Sample3DSceneRenderer::SetTransferFunction(const std::vector<XMFLOAT4>& table)
+{
+	// Every paged permutation colors through the transfer function, so paged volumes fall back to a gray ramp.
+	m_transferFunctionTable = (table.empty() && m_outOfCoreVolume != nullptr) ? DensityRamp() : table;
+	CreateTransferFunction();
+}
+
+void Sample3DSceneRenderer::CreateTransferFunction()
+{
+	m_transferFunctionTexture.Reset();
+	m_transferFunctionView.Reset();
+	if (m_transferFunctionTable.empty())
+	{
+		return;
+	}
+
+	CD3D11_TEXTURE1D_DESC textureDesc(
+		DXGI_FORMAT_R32G32B32A32_FLOAT,
+		static_cast<UINT>(m_transferFunctionTable.size()),
+		1,
+		1,
+		D3D11_BIND_SHADER_RESOURCE,
+		D3D11_USAGE_IMMUTABLE
+	);
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = m_transferFunctionTable.data();
+
+	auto device = m_deviceResources->GetD3DDevice();
+	DX::ThrowIfFailed(device->CreateTexture1D(&textureDesc, &initialData, &m_transferFunctionTexture));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_transferFunctionTexture.Get(), nullptr, &m_transferFunctionView));
+}
+
+void Sample3DSceneRenderer::SetOutOfCoreVolume(const std::shared_ptr<OutOfCoreVolume>& volume, uint64 poolBytes)
+{
+	m_outOfCoreVolume = volume;
+	m_brickPoolBudget = poolBytes;
+	m_volumeFormat = (volume != nullptr) ? VolumeFormat::Paged : VolumeFormat::Rgba;
+	m_channelVolume.reset();
+	m_channelVolumeTexture.Reset();
+	m_channelVolumeView.Reset();
+
+	// The pool, page table and coarse level are sized for the chunk store, so they are rebuilt on the next frame.
+	m_brickPoolTexture.Reset();
+	m_brickPoolView.Reset();
+	m_pageTableTexture.Reset();
+	m_pageTableView.Reset();
+	m_coarseVolumeTexture.Reset();
+	m_coarseVolumeView.Reset();
+	ZeroMemory(&m_brickPoolStats, sizeof(m_brickPoolStats));
+
+	// Paged volumes are density only and every paged permutation colors through the transfer function.
+	if (volume != nullptr && m_transferFunctionTable.empty())
+	{
+		SetTransferFunction(DensityRamp());
+	}
+}
+
+void Sample3DSceneRenderer::SetChannelVolume(const std::shared_ptr<const ChannelVolume>& volume, const std::vector<ChannelWindow>& windows)
+{
+	if (m_outOfCoreVolume != nullptr)
+	{
+		SetOutOfCoreVolume(nullptr);
+	}
+	m_channelVolume = volume;
+	m_channelVolumeTexture.Reset();
+	m_channelVolumeView.Reset();
+	m_historyValid = false;
+
+	uint32 channelCount = (volume != nullptr) ? volume->ChannelCount() : 0;
+	if (channelCount < 2 || channelCount > MaxVolumeChannels)
+	{
+		m_channelVolume.reset();
+		m_volumeFormat = VolumeFormat::Rgba;
+		m_constantBufferData.channelParams = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+		return;
+	}
+
+	// Channels without a window keep the default [0, 1].
+	m_channelWindows = windows;
+	m_channelWindows.resize(channelCount);
+	CreateChannelVolumeTexture();
+
+	if (m_channelTransferView == nullptr)
+	{
+		CreateChannelTransferFunctions();
+	}
+	m_volumeFormat = VolumeFormat::Channels;
+	m_constantBufferData.channelParams = XMFLOAT4(static_cast<float>(channelCount), 0.0f, 0.0f, 0.0f);
+}
+
+// Packs the channels to unorm8 and uploads them; the packed copy is dropped once the texture holds it.
+void Sample3DSceneRenderer::CreateChannelVolumeTexture()
+{
+	m_channelVolumeTexture.Reset();
+	m_channelVolumeView.Reset();
+	if (m_channelVolume == nullptr)
+	{
+		return;
+	}
+
+	const ChannelVolume& volume = *m_channelVolume;
+	std::vector<uint8_t> packed;
+	PackChannelVolume(volume, m_channelWindows, packed);
+
+	UINT stride = PackedChannelStride(volume.ChannelCount());
+	CD3D11_TEXTURE3D_DESC textureDesc(
+		(stride == 2) ? DXGI_FORMAT_R8G8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM,
+		volume.width,
+		volume.height,
+		volume.depth,
+		1,
+		D3D11_BIND_SHADER_RESOURCE,
+		D3D11_USAGE_IMMUTABLE
+	);
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = packed.data();
+	initialData.SysMemPitch = volume.width * stride;
+	initialData.SysMemSlicePitch = initialData.SysMemPitch * volume.height;
+
+	auto device = m_deviceResources->GetD3DDevice();
+	DX::ThrowIfFailed(device->CreateTexture3D(&textureDesc, &initialData, &m_channelVolumeTexture));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_channelVolumeTexture.Get(), nullptr, &m_channelVolumeView));
+}
+
+void Sample3DSceneRenderer::SetChannelTransferFunction(uint32 channel, const std::vector<XMFLOAT4>& table, float weight)
+{
+	if (channel >= MaxVolumeChannels)
+	{
+		return;
+	}
+
+	if (!table.empty())
+	{
+		std::vector<XMFLOAT4>& row = m_channelTables[channel];
+		for (size_t i = 0; i < row.size(); ++i)
+		{
+			row[i] = SampleTransferFunction(table, static_cast<float>(i) / (row.size() - 1));
+		}
+	}
+	reinterpret_cast<float*>(&m_constantBufferData.channelWeights)[channel] = weight;
+	m_historyValid = false;
+	CreateChannelTransferFunctions();
+}
+
+// One row per channel, so a single Texture1DArray serves every channel's lookup.
+void Sample3DSceneRenderer::CreateChannelTransferFunctions()
+{
+	std::vector<XMFLOAT4> rows;
+	for (uint32 channel = 0; channel < MaxVolumeChannels; ++channel)
+	{
+		rows.insert(rows.end(), m_channelTables[channel].begin(), m_channelTables[channel].end());
+	}
+
+	CD3D11_TEXTURE1D_DESC textureDesc(
+		DXGI_FORMAT_R32G32B32A32_FLOAT,
+		static_cast<UINT>(m_channelTables[0].size()),
+		MaxVolumeChannels,
+		1,
+		D3D11_BIND_SHADER_RESOURCE,
+		D3D11_USAGE_IMMUTABLE
+	);
+
+	D3D11_SUBRESOURCE_DATA initialData[MaxVolumeChannels] = {};
+	for (uint32 channel = 0; channel < MaxVolumeChannels; ++channel)
+	{
+		initialData[channel].pSysMem = rows.data() + channel * m_channelTables[0].size();
+	}
+
+	m_channelTransferTexture.Reset();
+	m_channelTransferView.Reset();
+	auto device = m_deviceResources->GetD3DDevice();
+	DX::ThrowIfFailed(device->CreateTexture1D(&textureDesc, initialData, &m_channelTransferTexture));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_channelTransferTexture.Get(), nullptr, &m_channelTransferView));
+}
+
+void Sample3DSceneRenderer::SetCompositeMode(CompositeMode mode, float firstHitThreshold)
+{
+	if (mode != m_compositeMode)
+	{
+		m_compositeMode = mode;
+		m_historyValid = false;
+	}
+	m_constantBufferData.compositeParams = XMFLOAT4(firstHitThreshold, 0.0f, 0.0f, 0.0f);
+}
+
+void Sample3DSceneRenderer::SetGradientLighting(bool enabled, float ambient, float magnitudeGain)
+{
+	m_gradientLightingEnabled = enabled;
+	m_constantBufferData.gradientParams = XMFLOAT4(ambient, magnitudeGain, 0.0f, 0.0f);
+}
+
+void Sample3DSceneRenderer::SetIsosurface(bool enabled, float threshold, const XMFLOAT3& albedo)
+{
+	if (threshold != m_isosurfaceThreshold)
+	{
+		m_isosurfaceThreshold = threshold;
+		m_isosurfaceMeshValid = false;
+	}
+	m_isosurfaceEnabled = enabled;
+	m_constantBufferData.isosurfaceParams = XMFLOAT4(albedo.x, albedo.y, albedo.z, m_constantBufferData.isosurfaceParams.w);
+}
+
+void Sample3DSceneRenderer::SetClipPlanes(const std::vector<XMFLOAT4>& planes)
+{
+	m_clipRegion.planeCount = (planes.size() < MaxClipPlanes) ? static_cast<uint32_t>(planes.size()) : MaxClipPlanes;
+	for (uint32_t i = 0; i < m_clipRegion.planeCount; ++i)
+	{
+		m_clipRegion.planes[i] = planes[i];
+	}
+	StoreClipRegion(m_clipRegion, m_constantBufferData);
+	m_historyValid = false;
+}
+
+void Sample3DSceneRenderer::SetCropBox(const XMFLOAT3& center, const XMFLOAT3& halfExtents, const XMFLOAT4& orientation)
+{
+	m_clipRegion.cropEnabled = true;
+	m_clipRegion.cropMatrix = MakeCropMatrix(center, halfExtents, orientation);
+	StoreClipRegion(m_clipRegion, m_constantBufferData);
+	m_historyValid = false;
+}
+
+void Sample3DSceneRenderer::ClearCropBox()
+{
+	m_clipRegion.cropEnabled = false;
+	StoreClipRegion(m_clipRegion, m_constantBufferData);
+	m_historyValid = false;
+}
+
+void Sample3DSceneRenderer::SetVolume(const std::shared_ptr<const VolumeData>& volume)
+{
+	if (m_outOfCoreVolume != nullptr)
+	{
+		SetOutOfCoreVolume(nullptr);
+	}
+	if (m_channelVolume != nullptr)
+	{
+		SetChannelVolume(nullptr, std::vector<ChannelWindow>());
+	}
+
+	// The editor holds a copy of the old volume; it is refilled from the new one.
+	m_sourceVolume = volume;
+	m_volumeEditor.reset();
+	if (m_loadingComplete)
+	{
+		CreateVolumetricTexture();
+		m_historyValid = false;
+	}
+}
+
+IsosurfaceStats Sample3DSceneRenderer::GetIsosurfaceStats() const
+{
+	IsosurfaceStats stats = {};
+	return (m_isosurfaceExtractor != nullptr) ? m_isosurfaceExtractor->GetStats() : stats;
+}
+
+void Sample3DSceneRenderer::SetVolumeEditing(bool enabled)
+{
+	if (enabled == m_volumeEditingEnabled)
+	{
+		return;
+	}
+
+	// Editing needs DEFAULT textures with a mip chain; a volume that is still loading picks the flag up itself.
+	m_volumeEditingEnabled = enabled;
+	if (m_loadingComplete)
+	{
+		CreateVolumetricTexture();
+		m_historyValid = false;
+	}
+}
+
+VoxelRegion Sample3DSceneRenderer::ApplyBrush(const VolumeBrush& brush)
+{
+	if (m_volumeEditor == nullptr)
+	{
+		return VoxelRegion();
+	}
+
+	VoxelRegion region = m_volumeEditor->Apply(brush);
+	RefreshEditedIsosurface(region);
+	return region;
+}
+
+void Sample3DSceneRenderer::BeginBrushStroke()
+{
+	if (m_volumeEditor != nullptr)
+	{
+		m_volumeEditor->BeginStroke();
+	}
+}
+
+void Sample3DSceneRenderer::EndBrushStroke()
+{
+	if (m_volumeEditor != nullptr)
+	{
+		m_volumeEditor->EndStroke();
+	}
+}
+
+bool Sample3DSceneRenderer::UndoVolumeEdit()
+{
+	VoxelRegion region = (m_volumeEditor != nullptr) ? m_volumeEditor->Undo() : VoxelRegion();
+	RefreshEditedIsosurface(region);
+	return !region.Empty();
+}
+
+bool Sample3DSceneRenderer::RedoVolumeEdit()
+{
+	VoxelRegion region = (m_volumeEditor != nullptr) ? m_volumeEditor->Redo() : VoxelRegion();
+	RefreshEditedIsosurface(region);
+	return !region.Empty();
+}
+
+EditJournalStats Sample3DSceneRenderer::GetEditJournalStats() const
+{
+	EditJournalStats stats = {};
+	return (m_volumeEditor != nullptr) ? m_volumeEditor->GetJournalStats() : stats;
+}
+
+// The extractor keeps its own copy of the density, so edited voxels are copied into it as they change.
+void Sample3DSceneRenderer::RefreshEditedIsosurface(const VoxelRegion& region)
+{
+	if (!region.Empty() && m_isosurfaceExtractor != nullptr)
+	{
+		const VolumeData& volume = m_volumeEditor->GetVolume();
+		m_isosurfaceExtractor->UpdateRegion(volume.voxels.data() + 3, 4, region.min, region.max);
+		m_isosurfaceMeshValid = false;
+	}
+}
+
+// Refreshes the derived data for the edits since the last frame and copies each changed box into its texture.
+void Sample3DSceneRenderer::UploadVolumeEdits()
+{
+	ZeroMemory(&m_volumeUploadStats, sizeof(m_volumeUploadStats));
+	if (m_volumeEditor == nullptr || !m_volumeEditor->HasPendingEdits())
+	{
+		return;
+	}
+
+	auto commitStart = std::chrono::steady_clock::now();
+	VolumeEditChanges changes;
+	m_volumeEditor->Commit(changes);
+	m_volumeUploadStats.commitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - commitStart).count();
+
+	// UpdateSubresource reads the source box from the pointer to its first texel with the full image's pitches.
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	auto uploadBox = [&](ID3D11Resource* resource, UINT subresource, const VoxelRegion& region, const void* texels, uint32 width, uint32 height, uint32 texelBytes)
+	{
+		D3D11_BOX box = { region.min[0], region.min[1], region.min[2], region.max[0], region.max[1], region.max[2] };
+		UINT rowPitch = width * texelBytes;
+		UINT depthPitch = rowPitch * height;
+		const uint8_t* source = static_cast<const uint8_t*>(texels) +
+			static_cast<size_t>(region.min[2]) * depthPitch + static_cast<size_t>(region.min[1]) * rowPitch + static_cast<size_t>(region.min[0]) * texelBytes;
+		context->UpdateSubresource(resource, subresource, &box, source, rowPitch, depthPitch);
+		m_volumeUploadStats.regions++;
+		m_volumeUploadStats.bytes += region.VoxelCount() * texelBytes;
+		m_uploadedBytes += region.VoxelCount() * texelBytes;
+	};
+
+	const VolumeMipChain& mips = m_volumeEditor->GetMipChain();
+	for (uint32 level = 0; level < mips.GetLevelCount(); ++level)
+	{
+		const VolumeData& data = mips.GetLevel(level);
+		UINT subresource = D3D11CalcSubresource(level, 0, mips.GetLevelCount());
+		for (const VoxelRegion& region : changes.levels[level])
+		{
+			uploadBox(m_volumeTexture.Get(), subresource, region, data.voxels.data(), data.width, data.height, 4 * sizeof(float));
+		}
+	}
+
+	// Derived textures that no feature has asked for yet are created from the editor's current copies later.
+	const VolumeData& volume = m_volumeEditor->GetVolume();
+	for (const VoxelRegion& region : changes.gradients)
+	{
+		if (m_gradientTexture != nullptr)
+		{
+			uploadBox(m_gradientTexture.Get(), 0, region, m_volumeEditor->GetGradients().data(), volume.width, volume.height, sizeof(uint32_t));
+		}
+	}
+
+	// Any cell that changes state can move distances anywhere, so the small field goes up whole.
+	if (changes.distanceField && m_distanceFieldTexture != nullptr)
+	{
+		const DistanceField& field = m_volumeEditor->GetDistanceField();
+		VoxelRegion all(0, 0, 0, field.width, field.height, field.depth);
+		uploadBox(m_distanceFieldTexture.Get(), 0, all, field.distance.data(), field.width, field.height, sizeof(float));
+	}
+
+	// Accumulated frames show the old voxels.
+	m_historyValid = false;
+}
+
+// Brings the brick meshes up to date for the current threshold and replaces the GPU buffers with the joined mesh.
+void Sample3DSceneRenderer::UpdateIsosurfaceMesh()
+{
+	m_isosurfaceExtractor->Extract(m_isosurfaceThreshold);
+
+	IsosurfaceMesh mesh;
+	m_isosurfaceExtractor->BuildMesh(mesh);
+
+	m_isosurfaceVertexBuffer.Reset();
+	m_isosurfaceIndexBuffer.Reset();
+	m_isosurfaceIndexCount = 0;
+	m_isosurfaceMeshValid = true;
+	if (mesh.indices.empty())
+	{
+		return;
+	}
+
+	auto device = m_deviceResources->GetD3DDevice();
+	D3D11_SUBRESOURCE_DATA vertexData = {};
+	vertexData.pSysMem = mesh.vertices.data();
+	CD3D11_BUFFER_DESC vertexDesc(static_cast<UINT>(mesh.vertices.size() * sizeof(VertexPositionColor)), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+	DX::ThrowIfFailed(device->CreateBuffer(&vertexDesc, &vertexData, &m_isosurfaceVertexBuffer));
+
+	D3D11_SUBRESOURCE_DATA indexData = {};
+	indexData.pSysMem = mesh.indices.data();
+	CD3D11_BUFFER_DESC indexDesc(static_cast<UINT>(mesh.indices.size() * sizeof(uint32_t)), D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+	DX::ThrowIfFailed(device->CreateBuffer(&indexDesc, &indexData, &m_isosurfaceIndexBuffer));
+	m_isosurfaceIndexCount = static_cast<uint32>(mesh.indices.size());
+}
+
+// Draws the isosurface opaque into the bound back buffer and depth buffer.
+void Sample3DSceneRenderer::RenderIsosurface()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	UINT stride = sizeof(VertexPositionColor);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, m_isosurfaceVertexBuffer.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(m_isosurfaceIndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->IASetInputLayout(m_inputLayout.Get());
+
+	context->VSSetShader(m_isosurfaceVertexShader.Get(), nullptr, 0);
+	context->VSSetConstantBuffers1(0, 1, m_constantBuffer.GetAddressOf(), nullptr, nullptr);
+	context->PSSetShader(m_isosurfacePixelShader.Get(), nullptr, 0);
+	context->PSSetConstantBuffers(0, 1, m_constantBuffer.GetAddressOf());
+
+	// Default states: back face culling, depth test and write, no blending.
+	context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+	context->OMSetDepthStencilState(nullptr, 0);
+	context->RSSetState(nullptr);
+
+	context->DrawIndexed(m_isosurfaceIndexCount, 0, 0);
+}
+
+// Looks up the specialized raymarcher for the current options, or the nearest one built for the same format, transfer
+// function and compositing mode. Returns false when there is none; a variant for another format would read the wrong
+// textures, so nothing stands in for it.
+RaymarchPermutationKey Sample3DSceneRenderer::MakeFrameRaymarchRequest(bool shadows, bool dynamicSteps, CompositeMode composite) const
+{
+	return MakeRaymarchRequest(
+		shadows,
+		dynamicSteps,
+		m_volumeFormat,
+		m_transferFunctionView != nullptr,
+		m_earlyOutPercent,
+		m_gradientLightingEnabled && m_gradientTextureView != nullptr,
+		composite
+	);
+}
+
+bool Sample3DSceneRenderer::SupportsRaymarchOptions(bool shadows, bool emptySpaceSkipping, CompositeMode composite) const
+{
+	if (emptySpaceSkipping && m_volumeFormat != VolumeFormat::Rgba)
+	{
+		return false;
+	}
+
+	// The step mode Render picks for the current frame modes.
+	bool dynamicSteps = !m_stereoEnabled && (m_importanceEnabled || (m_temporalEnabled && m_interleavePatternSize <= 1));
+	size_t count;
+	const RaymarchPermutation* table = GetRaymarchPermutations(count);
+	int index = SelectNearestRaymarchPermutation(table, count, MakeFrameRaymarchRequest(shadows, dynamicSteps, composite));
+
+	// Until loading completes only the manifest can answer; after that the shader must also have loaded.
+	return index >= 0 && (!m_loadingComplete || m_raymarchShaders.count(table[index].key.Pack()) != 0);
+}
+
+bool Sample3DSceneRenderer::SelectRaymarchShader(bool dynamicSteps)
+{
+	RaymarchPermutationKey request = MakeFrameRaymarchRequest(m_shadowsEnabled, dynamicSteps, m_compositeMode);
+
+	uint32 packedRequest = request.Pack();
+	if (packedRequest == m_activeRaymarchRequest)
+	{
+		return m_activeRaymarchShader != nullptr;
+	}
+
+	size_t count;
+	const RaymarchPermutation* table = GetRaymarchPermutations(count);
+	int index = SelectNearestRaymarchPermutation(table, count, request);
+
+	m_activeRaymarchShader.Reset();
+	m_activeRaymarchKey = RaymarchPermutationKey();
+	if (index >= 0)
+	{
+		auto shader = m_raymarchShaders.find(table[index].key.Pack());
+		if (shader != m_raymarchShaders.end())
+		{
+			m_activeRaymarchShader = shader->second;
+			m_activeRaymarchKey = table[index].key;
+		}
+	}
+	m_activeRaymarchRequest = packedRequest;
+	return m_activeRaymarchShader != nullptr;
+}
+
+void Sample3DSceneRenderer::CreateVolumeTargets(uint32 scale, bool interleaved)
+{
+	ReleaseVolumeTargets();
+
+	// Interleaved marching rounds up so every block of the full resolution image owns one reduced pixel.
+	D3D11_VIEWPORT screenViewport = m_deviceResources->GetScreenViewport();
+	UINT screenWidth = static_cast<UINT>(screenViewport.Width);
+	UINT screenHeight = static_cast<UINT>(screenViewport.Height);
+	UINT width = interleaved ? (screenWidth + scale - 1) / scale : screenWidth / scale;
+	UINT height = interleaved ? (screenHeight + scale - 1) / scale : screenHeight / scale;
+	width = (width > 0) ? width : 1;
+	height = (height > 0) ? height : 1;
+
+	auto device = m_deviceResources->GetD3DDevice();
+
+	// Color of the reduced resolution march.
+	CD3D11_TEXTURE2D_DESC colorDesc(
+		DXGI_FORMAT_R16G16B16A16_FLOAT,
+		width,
+		height,
+		1,
+		1,
+		D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE
+	);
+	DX::ThrowIfFailed(device->CreateTexture2D(&colorDesc, nullptr, &m_volumeColorTarget));
+	DX::ThrowIfFailed(device->CreateRenderTargetView(m_volumeColorTarget.Get(), nullptr, &m_volumeColorTargetView));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_volumeColorTarget.Get(), nullptr, &m_volumeColorResourceView));
+
+	// Ray entry depth (upsample guide) and opacity-weighted depth (temporal reprojection).
+	CD3D11_TEXTURE2D_DESC depthDesc(
+		DXGI_FORMAT_R32G32_FLOAT,
+		width,
+		height,
+		1,
+		1,
+		D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE
+	);
+	DX::ThrowIfFailed(device->CreateTexture2D(&depthDesc, nullptr, &m_volumeDepthTarget));
+	DX::ThrowIfFailed(device->CreateRenderTargetView(m_volumeDepthTarget.Get(), nullptr, &m_volumeDepthTargetView));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_volumeDepthTarget.Get(), nullptr, &m_volumeDepthResourceView));
+
+	// Accumulated color for temporal reprojection; interleaved reconstruction keeps it at full resolution.
+	CD3D11_TEXTURE2D_DESC historyDesc = colorDesc;
+	if (interleaved)
+	{
+		historyDesc.Width = screenWidth;
+		historyDesc.Height = screenHeight;
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		DX::ThrowIfFailed(device->CreateTexture2D(&historyDesc, nullptr, &m_historyTargets[i]));
+		DX::ThrowIfFailed(device->CreateRenderTargetView(m_historyTargets[i].Get(), nullptr, &m_historyTargetViews[i]));
+		DX::ThrowIfFailed(device->CreateShaderResourceView(m_historyTargets[i].Get(), nullptr, &m_historyResourceViews[i]));
+	}
+
+	// One step budget per tile of the march; half floats hold the budget fractions exactly.
+	UINT tileSize = m_importanceSettings.tileSize;
+	CD3D11_TEXTURE2D_DESC importanceDesc(
+		DXGI_FORMAT_R16_FLOAT,
+		(width + tileSize - 1) / tileSize,
+		(height + tileSize - 1) / tileSize,
+		1,
+		1,
+		D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE
+	);
+	DX::ThrowIfFailed(device->CreateTexture2D(&importanceDesc, nullptr, &m_importanceTarget));
+	DX::ThrowIfFailed(device->CreateRenderTargetView(m_importanceTarget.Get(), nullptr, &m_importanceTargetView));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_importanceTarget.Get(), nullptr, &m_importanceResourceView));
+	m_importanceViewport = CD3D11_VIEWPORT(0.0f, 0.0f, static_cast<float>(importanceDesc.Width), static_cast<float>(importanceDesc.Height));
+
+	// The interleaved viewport is exactly 1/scale of the screen so the raster grid offset in the vertex shader is uniform.
+	if (interleaved)
+	{
+		m_volumeViewport = CD3D11_VIEWPORT(0.0f, 0.0f, screenViewport.Width / scale, screenViewport.Height / scale);
+	}
+	else
+	{
+		m_volumeViewport = CD3D11_VIEWPORT(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height));
+	}
+	m_volumeTargetScale = scale;
+	m_volumeTargetsInterleaved = interleaved;
+}
+
+void Sample3DSceneRenderer::ReleaseVolumeTargets()
+{
+	m_volumeColorTarget.Reset();
+	m_volumeColorTargetView.Reset();
+	m_volumeColorResourceView.Reset();
+	m_volumeDepthTarget.Reset();
+	m_volumeDepthTargetView.Reset();
+	m_volumeDepthResourceView.Reset();
+	for (int i = 0; i < 2; ++i)
+	{
+		m_historyTargets[i].Reset();
+		m_historyTargetViews[i].Reset();
+		m_historyResourceViews[i].Reset();
+	}
+	m_importanceTarget.Reset();
+	m_importanceTargetView.Reset();
+	m_importanceResourceView.Reset();
+	m_stereoTarget.Reset();
+	m_stereoTargetView.Reset();
+	m_stereoResourceView.Reset();
+	m_volumeTargetScale = 0;
+	m_volumeTargetsInterleaved = false;
+	m_historyValid = false;
+	m_importanceValid = false;
 }
 
 // Called once per frame, rotates the cube and calculates the model and view matrices.
@@ -116,6 +881,19 @@ void Sample3DSceneRenderer::Rotate(float radians)
 	XMStoreFloat4x4(&m_constantBufferData.invWorldViewProjectionMatrix, XMMatrixTranspose(m_invWorldViewProjectionMatrix));
 }
 
+void Sample3DSceneRenderer::SetCameraPose(const CameraPose& pose)
+{
+	static const XMVECTORF32 up = { 0.0f, 1.0f, 0.0f, 0.0f };
+
+	m_viewMatrix = XMMatrixLookAtLH(XMLoadFloat3(&pose.eye), XMLoadFloat3(&pose.target), up);
+	XMStoreFloat4x4(&m_constantBufferData.viewMatrix, XMMatrixTranspose(m_viewMatrix));
+	m_constantBufferData.cameraPosition = XMFLOAT4(pose.eye.x, pose.eye.y, pose.eye.z, 0.0f);
+	m_constantBufferData.lightPosition = XMFLOAT4(pose.lightPosition.x, pose.lightPosition.y, pose.lightPosition.z, 1.0f);
+
+	// Also refreshes the combined matrices for the new view.
+	Rotate(pose.modelRotation);
+}
+
 void Sample3DSceneRenderer::StartTracking()
 {
 	m_tracking = true;
@@ -136,16 +914,541 @@ void Sample3DSceneRenderer::StopTracking()
 	m_tracking = false;
 }
 
+// Tests every brick against the current frustum and the Hi-Z occlusion buffer. In stereo the frustum holds both eyes
+// and the pyramid, built for the mono view, is not used.
+void Sample3DSceneRenderer::CullBricks()
+{
+	m_brickVisibility.resize(m_brickBounds.size());
+	if (m_stereoEnabled)
+	{
+		m_volumeCuller.SetWorldViewProjection(XMMatrixMultiply(m_worldMatrix, XMLoadFloat4x4(&m_stereoView.cullViewProjection)));
+	}
+	else
+	{
+		m_volumeCuller.SetWorldViewProjection(m_worldViewProjectionMatrix);
+	}
+	if (!m_stereoEnabled)
+	{
+		ReadOcclusionDepth();
+	}
+	m_cullingStats = m_volumeCuller.Cull(
+		m_brickBounds.data(),
+		m_brickBounds.size(),
+		m_brickVisibility.data(),
+		m_stereoEnabled ? nullptr : &m_occlusionBuffer
+	);
+}
+
+// Reduces the opaque depth drawn so far this frame to the finest occlusion level and queues a copy for readback.
+// Without scene depth the pyramid goes back to the far plane, so nothing is culled against stale geometry.
+void Sample3DSceneRenderer::CaptureOcclusionDepth()
+{
+	ID3D11ShaderResourceView* sceneDepthView = m_deviceResources->GetDepthStencilResourceView();
+	if (m_stereoEnabled || !m_sceneDepthClipping || sceneDepthView == nullptr || m_occlusionDepthPixelShader == nullptr)
+	{
+		m_occlusionBuffer.Clear();
+		ReleaseOcclusionTargets();
+		return;
+	}
+
+	// Every copy is still in flight; the GPU is far enough behind that another one would only queue up.
+	if (m_occlusionReadbackPending == OcclusionReadbackCount)
+	{
+		return;
+	}
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	uint32 width = m_occlusionBuffer.GetWidth();
+	uint32 height = m_occlusionBuffer.GetHeight();
+	if (m_occlusionDepthTarget == nullptr)
+	{
+		auto device = m_deviceResources->GetD3DDevice();
+		CD3D11_TEXTURE2D_DESC targetDesc(DXGI_FORMAT_R32_FLOAT, width, height, 1, 1, D3D11_BIND_RENDER_TARGET);
+		DX::ThrowIfFailed(device->CreateTexture2D(&targetDesc, nullptr, &m_occlusionDepthTarget));
+		DX::ThrowIfFailed(device->CreateRenderTargetView(m_occlusionDepthTarget.Get(), nullptr, &m_occlusionDepthTargetView));
+
+		CD3D11_TEXTURE2D_DESC readbackDesc(DXGI_FORMAT_R32_FLOAT, width, height, 1, 1, 0, D3D11_USAGE_STAGING, D3D11_CPU_ACCESS_READ);
+		for (uint32 i = 0; i < OcclusionReadbackCount; ++i)
+		{
+			DX::ThrowIfFailed(device->CreateTexture2D(&readbackDesc, nullptr, &m_occlusionReadback[i]));
+		}
+		m_occlusionDepth.resize(static_cast<size_t>(width) * height);
+	}
+
+	// The depth buffer is read, so it comes off the output merger for the reduction and goes back afterwards.
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> boundTarget;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> boundDepth;
+	context->OMGetRenderTargets(1, &boundTarget, &boundDepth);
+	context->OMSetRenderTargets(1, m_occlusionDepthTargetView.GetAddressOf(), nullptr);
+	D3D11_VIEWPORT occlusionViewport = CD3D11_VIEWPORT(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height));
+	context->RSSetViewports(1, &occlusionViewport);
+
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	context->OMSetBlendState(nullptr, blendFactor, 0xffffffff);
+	context->RSSetState(nullptr);
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->VSSetShader(m_fullscreenVertexShader.Get(), nullptr, 0);
+	context->GSSetShader(nullptr, nullptr, 0);
+	context->PSSetShader(m_occlusionDepthPixelShader.Get(), nullptr, 0);
+	context->PSSetShaderResources(0, 1, &sceneDepthView);
+	context->Draw(3, 0);
+
+	ID3D11ShaderResourceView* const nullView[1] = { nullptr };
+	context->PSSetShaderResources(0, 1, nullView);
+	ID3D11RenderTargetView* const restoredTarget[1] = { boundTarget.Get() };
+	context->OMSetRenderTargets(1, restoredTarget, boundDepth.Get());
+	D3D11_VIEWPORT screenViewport = m_deviceResources->GetScreenViewport();
+	context->RSSetViewports(1, &screenViewport);
+
+	context->CopyResource(m_occlusionReadback[m_occlusionReadbackNext].Get(), m_occlusionDepthTarget.Get());
+	XMStoreFloat4x4(&m_occlusionReadbackMatrix[m_occlusionReadbackNext], m_worldViewProjectionMatrix);
+	m_occlusionReadbackNext = (m_occlusionReadbackNext + 1) % OcclusionReadbackCount;
+	m_occlusionReadbackPending++;
+}
+
+// Rebuilds the occlusion pyramid from the newest readback the GPU has finished, without waiting for any.
+void Sample3DSceneRenderer::ReadOcclusionDepth()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	uint32 width = m_occlusionBuffer.GetWidth();
+	uint32 height = m_occlusionBuffer.GetHeight();
+	int newest = -1;
+
+	while (m_occlusionReadbackPending > 0)
+	{
+		uint32 oldest = (m_occlusionReadbackNext + OcclusionReadbackCount - m_occlusionReadbackPending) % OcclusionReadbackCount;
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		HRESULT hr = context->Map(m_occlusionReadback[oldest].Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+		if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+		{
+			break;
+		}
+		DX::ThrowIfFailed(hr);
+
+		for (uint32 y = 0; y < height; ++y)
+		{
+			memcpy(&m_occlusionDepth[static_cast<size_t>(y) * width], static_cast<const uint8_t*>(mapped.pData) + static_cast<size_t>(y) * mapped.RowPitch, width * sizeof(float));
+		}
+		context->Unmap(m_occlusionReadback[oldest].Get(), 0);
+		m_occlusionReadbackPending--;
+		newest = static_cast<int>(oldest);
+	}
+
+	if (newest >= 0)
+	{
+		m_occlusionBuffer.BuildFromDepth(m_occlusionDepth.data(), width, height, XMLoadFloat4x4(&m_occlusionReadbackMatrix[newest]));
+	}
+}
+
+void Sample3DSceneRenderer::ReleaseOcclusionTargets()
+{
+	m_occlusionDepthTarget.Reset();
+	m_occlusionDepthTargetView.Reset();
+	for (uint32 i = 0; i < OcclusionReadbackCount; ++i)
+	{
+		m_occlusionReadback[i].Reset();
+	}
+	m_occlusionReadbackNext = 0;
+	m_occlusionReadbackPending = 0;
+}
+
+// Sizes the brick pool and page table for the chunk store and builds the chunk bounds the streamer culls.
+void Sample3DSceneRenderer::CreateBrickPool()
+{
+	const VolumeChunkStore& store = m_outOfCoreVolume->GetStore();
+	const ChunkStoreHeader& header = store.GetHeader();
+	uint32 padded = store.GetPaddedChunkSize();
+	uint32 chunkCount = store.GetChunkCount();
+
+	// As many slots as the memory budget pays for once the coarse level has its share.
+	m_brickPoolLayout = ChooseBrickPoolLayout(header, m_brickPoolBudget, D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		m_brickPoolSlots[axis] = m_brickPoolLayout.slots[axis];
+	}
+	uint32 slotCount = m_brickPoolSlots[0] * m_brickPoolSlots[1] * m_brickPoolSlots[2];
+
+	auto device = m_deviceResources->GetD3DDevice();
+
+	CD3D11_TEXTURE3D_DESC poolDesc(
+		DXGI_FORMAT_R16_UNORM,
+		m_brickPoolSlots[0] * padded,
+		m_brickPoolSlots[1] * padded,
+		m_brickPoolSlots[2] * padded,
+		1,
+		D3D11_BIND_SHADER_RESOURCE
+	);
+	DX::ThrowIfFailed(device->CreateTexture3D(&poolDesc, nullptr, &m_brickPoolTexture));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_brickPoolTexture.Get(), nullptr, &m_brickPoolView));
+
+	// Every chunk starts out non-resident.
+	m_chunkSlots.assign(chunkCount, 0);
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = m_chunkSlots.data();
+	initialData.SysMemPitch = header.chunksX * sizeof(uint16_t);
+	initialData.SysMemSlicePitch = header.chunksX * header.chunksY * sizeof(uint16_t);
+
+	CD3D11_TEXTURE3D_DESC pageTableDesc(DXGI_FORMAT_R16_UINT, header.chunksX, header.chunksY, header.chunksZ, 1, D3D11_BIND_SHADER_RESOURCE);
+	DX::ThrowIfFailed(device->CreateTexture3D(&pageTableDesc, &initialData, &m_pageTableTexture));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_pageTableTexture.Get(), nullptr, &m_pageTableView));
+
+	// The coarse level starts empty and fills in as chunks load, so a chunk reads as empty space until then.
+	const uint32* coarseSize = m_brickPoolLayout.coarseSize;
+	std::vector<uint16_t> emptyCoarse(static_cast<size_t>(coarseSize[0]) * coarseSize[1] * coarseSize[2], 0);
+	D3D11_SUBRESOURCE_DATA coarseData = {};
+	coarseData.pSysMem = emptyCoarse.data();
+	coarseData.SysMemPitch = coarseSize[0] * sizeof(uint16_t);
+	coarseData.SysMemSlicePitch = coarseSize[0] * coarseSize[1] * sizeof(uint16_t);
+	CD3D11_TEXTURE3D_DESC coarseDesc(DXGI_FORMAT_R16_UNORM, coarseSize[0], coarseSize[1], coarseSize[2], 1, D3D11_BIND_SHADER_RESOURCE);
+	DX::ThrowIfFailed(device->CreateTexture3D(&coarseDesc, &coarseData, &m_coarseVolumeTexture));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_coarseVolumeTexture.Get(), nullptr, &m_coarseVolumeView));
+	m_chunkCoarse.assign(chunkCount, 0);
+
+	m_slotChunks.assign(slotCount, UINT32_MAX);
+	m_slotLastVisible.assign(slotCount, 0);
+	ZeroMemory(&m_brickPoolStats, sizeof(m_brickPoolStats));
+	m_brickPoolStats.slots = slotCount;
+	m_brickPoolStats.coarseFactor = m_brickPoolLayout.coarseFactor;
+	m_brickPoolStats.poolBytes = m_brickPoolLayout.poolBytes;
+	m_brickPoolStats.coarseBytes = m_brickPoolLayout.coarseBytes;
+
+	// Chunk bounds in the local space of the unit volume box; edge chunks are clipped to the volume.
+	float size = static_cast<float>(header.chunkSize);
+	XMFLOAT3 dims(static_cast<float>(header.width), static_cast<float>(header.height), static_cast<float>(header.depth));
+	m_chunkBounds.resize(chunkCount);
+	for (uint32 z = 0; z < header.chunksZ; ++z)
+	{
+		for (uint32 y = 0; y < header.chunksY; ++y)
+		{
+			for (uint32 x = 0; x < header.chunksX; ++x)
+			{
+				XMFLOAT3 lo(x * size / dims.x - 0.5f, y * size / dims.y - 0.5f, z * size / dims.z - 0.5f);
+				XMFLOAT3 hi(
+					std::min((x + 1) * size / dims.x, 1.0f) - 0.5f,
+					std::min((y + 1) * size / dims.y, 1.0f) - 0.5f,
+					std::min((z + 1) * size / dims.z, 1.0f) - 0.5f);
+
+				VolumeBrickBounds& bounds = m_chunkBounds[store.GetChunkIndex(x, y, z)];
+				bounds.center = XMFLOAT3((lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f);
+				bounds.extents = XMFLOAT3((hi.x - lo.x) * 0.5f, (hi.y - lo.y) * 0.5f, (hi.z - lo.z) * 0.5f);
+			}
+		}
+	}
+
+	m_constantBufferData.outOfCoreParams = XMFLOAT4(dims.x / size, dims.y / size, dims.z / size, size);
+	m_constantBufferData.outOfCorePool = XMFLOAT4(
+		static_cast<float>(m_brickPoolSlots[0]),
+		static_cast<float>(m_brickPoolSlots[1]),
+		static_cast<float>(m_brickPoolSlots[2]),
+		static_cast<float>(padded)
+	);
+
+	// Coarse texels span coarseFactor voxels, so the coarse texture reaches a little past a volume whose size is
+	// not a multiple of the factor.
+	float coarseSpan = static_cast<float>(m_brickPoolLayout.coarseFactor);
+	m_constantBufferData.outOfCoreCoarse = XMFLOAT4(
+		dims.x / (coarseSize[0] * coarseSpan),
+		dims.y / (coarseSize[1] * coarseSpan),
+		dims.z / (coarseSize[2] * coarseSpan),
+		0.0f
+	);
+}
+
+// Culls the chunk grid with this frame's frustum and Hi-Z buffer, uploads visible chunks the cache already holds
+// (nearest first, a few per frame) and hands the rest to the I/O threads.
+void Sample3DSceneRenderer::StreamOutOfCoreChunks()
+{
+	const uint32 maxUploadsPerFrame = 8;
+
+	if (m_brickPoolTexture == nullptr)
+	{
+		CreateBrickPool();
+	}
+
+	m_streamFrame++;
+	m_brickPoolStats.visibleChunks = 0;
+	m_brickPoolStats.missingChunks = 0;
+	m_brickPoolStats.coarseChunks = 0;
+	m_brickPoolStats.uploads = 0;
+	m_brickPoolStats.evictions = 0;
+
+	// CullBricks has already loaded this frame's matrix into the culler.
+	m_chunkVisibility.assign(m_chunkBounds.size(), 0);
+	m_volumeCuller.Cull(m_chunkBounds.data(), m_chunkBounds.size(), m_chunkVisibility.data(), &m_occlusionBuffer);
+
+	XMVECTOR localCamera = XMVector3TransformCoord(
+		XMLoadFloat4(&m_constantBufferData.cameraPosition),
+		XMMatrixInverse(nullptr, m_worldMatrix));
+
+	std::vector<ChunkRequest> missing;
+	for (uint32 i = 0; i < m_chunkBounds.size(); ++i)
+	{
+		if (!m_chunkVisibility[i])
+		{
+			continue;
+		}
+
+		m_brickPoolStats.visibleChunks++;
+		if (m_chunkSlots[i] != 0)
+		{
+			m_slotLastVisible[m_chunkSlots[i] - 1] = m_streamFrame;
+			continue;
+		}
+
+		ChunkRequest request;
+		request.index = i;
+		request.priority = -XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&m_chunkBounds[i].center), localCamera)));
+		missing.push_back(request);
+	}
+	m_brickPoolStats.missingChunks = static_cast<uint32>(missing.size());
+
+	std::sort(missing.begin(), missing.end(), [](const ChunkRequest& a, const ChunkRequest& b) { return a.priority > b.priority; });
+
+	// Chunks the pool cannot take this frame, or at all, still get their coarse block, which is small.
+	std::vector<ChunkRequest> requests;
+	ChunkCache& cache = m_outOfCoreVolume->GetCache();
+	bool poolFull = false;
+	for (const ChunkRequest& request : missing)
+	{
+		auto chunk = cache.Find(request.index);
+		if (chunk == nullptr)
+		{
+			requests.push_back(request);
+			m_brickPoolStats.coarseChunks += m_chunkCoarse[request.index];
+			continue;
+		}
+
+		if (!m_chunkCoarse[request.index])
+		{
+			UploadCoarseChunk(request.index, *chunk);
+		}
+		m_brickPoolStats.coarseChunks++;
+
+		// Stop filling the pool once it is full of chunks that are all visible this frame.
+		if (!poolFull && m_brickPoolStats.uploads < maxUploadsPerFrame)
+		{
+			poolFull = !UploadChunk(request.index, *chunk);
+			m_brickPoolStats.coarseChunks -= poolFull ? 0 : 1;
+		}
+	}
+
+	m_outOfCoreVolume->GetScheduler().SetRequests(requests);
+}
+
+// Copies a loaded chunk into a free pool slot, or the slot visible least recently, and points the page table at it.
+// Returns false when every slot holds a chunk that is visible this frame.
+bool Sample3DSceneRenderer::UploadChunk(uint32 chunk, const ChunkData& voxels)
+{
+	uint32 slot = UINT32_MAX;
+	uint32 oldest = m_streamFrame;
+	for (uint32 i = 0; i < m_slotChunks.size(); ++i)
+	{
+		if (m_slotChunks[i] == UINT32_MAX)
+		{
+			slot = i;
+			break;
+		}
+		if (m_slotLastVisible[i] < oldest)
+		{
+			oldest = m_slotLastVisible[i];
+			slot = i;
+		}
+	}
+
+	if (slot == UINT32_MAX)
+	{
+		return false;
+	}
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+	const ChunkStoreHeader& header = m_outOfCoreVolume->GetStore().GetHeader();
+	auto writePageEntry = [&](uint32 index, uint16_t value)
+	{
+		UINT x = index % header.chunksX;
+		UINT y = (index / header.chunksX) % header.chunksY;
+		UINT z = index / (header.chunksX * header.chunksY);
+		D3D11_BOX box = { x, y, z, x + 1, y + 1, z + 1 };
+		context->UpdateSubresource(m_pageTableTexture.Get(), 0, &box, &value, sizeof(value), sizeof(value));
+		m_uploadedBytes += sizeof(value);
+	};
+
+	if (m_slotChunks[slot] != UINT32_MAX)
+	{
+		m_chunkSlots[m_slotChunks[slot]] = 0;
+		writePageEntry(m_slotChunks[slot], 0);
+		m_brickPoolStats.evictions++;
+	}
+	else
+	{
+		m_brickPoolStats.resident++;
+	}
+
+	UINT padded = m_outOfCoreVolume->GetStore().GetPaddedChunkSize();
+	UINT x = (slot % m_brickPoolSlots[0]) * padded;
+	UINT y = ((slot / m_brickPoolSlots[0]) % m_brickPoolSlots[1]) * padded;
+	UINT z = (slot / (m_brickPoolSlots[0] * m_brickPoolSlots[1])) * padded;
+	D3D11_BOX box = { x, y, z, x + padded, y + padded, z + padded };
+	context->UpdateSubresource(
+		m_brickPoolTexture.Get(),
+		0,
+		&box,
+		voxels.data(),
+		padded * sizeof(uint16_t),
+		padded * padded * sizeof(uint16_t)
+	);
+
+	m_uploadedBytes += static_cast<uint64>(padded) * padded * padded * sizeof(uint16_t);
+
+	m_slotChunks[slot] = chunk;
+	m_slotLastVisible[slot] = m_streamFrame;
+	m_chunkSlots[chunk] = static_cast<uint16_t>(slot + 1);
+	writePageEntry(chunk, static_cast<uint16_t>(slot + 1));
+	m_brickPoolStats.uploads++;
+	return true;
+}
+
+// Writes a loaded chunk's block of the coarse level; it stays there after the chunk leaves the pool.
+void Sample3DSceneRenderer::UploadCoarseChunk(uint32 chunk, const ChunkData& voxels)
+{
+	uint32 box[6];
+	DownsampleChunk(m_outOfCoreVolume->GetStore().GetHeader(), chunk, voxels.data(), m_brickPoolLayout.coarseFactor, box, m_coarseScratch);
+
+	UINT rowPitch = (box[3] - box[0]) * sizeof(uint16_t);
+	UINT slicePitch = rowPitch * (box[4] - box[1]);
+	D3D11_BOX region = { box[0], box[1], box[2], box[3], box[4], box[5] };
+	m_deviceResources->GetD3DDeviceContext()->UpdateSubresource(m_coarseVolumeTexture.Get(), 0, &region, m_coarseScratch.data(), rowPitch, slicePitch);
+	m_uploadedBytes += m_coarseScratch.size() * sizeof(uint16_t);
+
+	m_chunkCoarse[chunk] = 1;
+}
+
 // Renders one frame using the vertex and pixel shaders.
 void Sample3DSceneRenderer::Render()
 {
 	// Loading is asynchronous. Only draw geometry after it's loaded.
 	if (!m_loadingComplete)
 	{
-		return;
+		return;
+	}
+
+	// Skip the whole volume pass when no brick survives culling. The opaque depth is still captured, or a volume
+	// hidden behind geometry would never be found visible again.
+	CullBricks();
+	if (m_cullingStats.visible == 0)
+	{
+		CaptureOcclusionDepth();
+		return;
+	}
+
+	if (m_outOfCoreVolume != nullptr)
+	{
+		StreamOutOfCoreChunks();
+	}
+	UploadVolumeEdits();
+	UpdateDerivedVolumes();
+
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	// The volume is marched offscreen when it is upsampled, interleaved or accumulated over frames. Stereo marches
+	// every eye at full resolution into its own target instead.
+	bool stereo = m_stereoEnabled;
+	bool interleaved = !stereo && m_interleavePatternSize > 1;
+	bool temporal = !stereo && m_temporalEnabled && !interleaved;
+	bool importanceEnabled = !stereo && m_importanceEnabled;
+	bool offscreen = interleaved || temporal || importanceEnabled || (!stereo && m_resolutionScale > 1);
+	uint32 marchScale = interleaved ? m_interleavePatternSize : m_resolutionScale;
+	if (offscreen && (m_volumeTargetScale != marchScale || m_volumeTargetsInterleaved != interleaved))
+	{
+		CreateVolumeTargets(marchScale, interleaved);
+	}
+
+	D3D11_VIEWPORT screenViewport = m_deviceResources->GetScreenViewport();
+	D3D11_VIEWPORT volumeViewport = offscreen ? m_volumeViewport : screenViewport;
+	m_constantBufferData.renderTargetSize = XMFLOAT4(
+		screenViewport.Width,
+		screenViewport.Height,
+		volumeViewport.Width,
+		volumeViewport.Height
+	);
+
+	if (temporal || interleaved)
+	{
+		// Keep the frame index small so the jitter offset stays exact in float.
+		m_constantBufferData.temporalParams = XMFLOAT4(
+			static_cast<float>(m_frameIndex % 64),
+			0.125f,
+			temporal ? static_cast<float>(m_temporalStepsPerFrame) : 0.0f,
+			m_historyValid ? 1.0f : 0.0f
+		);
+	}
+	else
+	{
+		m_constantBufferData.temporalParams = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	if (interleaved)
+	{
+		uint32 offsetX, offsetY;
+		GetInterleaveOffset(m_interleavePatternSize, m_frameIndex, offsetX, offsetY);
+		m_constantBufferData.interleaveParams = XMFLOAT4(
+			static_cast<float>(offsetX),
+			static_cast<float>(offsetY),
+			static_cast<float>(m_interleavePatternSize),
+			0.0f
+		);
+	}
+	else
+	{
+		m_constantBufferData.interleaveParams = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	// Step budgets need a previous volume pass at the current size to classify.
+	bool importance = importanceEnabled && m_importanceValid;
+
+	// Temporal accumulation and importance budgets vary the step count, so they need a dynamic step variant.
+	if (!SelectRaymarchShader(temporal || importanceEnabled))
+	{
+		CaptureOcclusionDepth();
+		return;
+	}
+	if (importance)
+	{
+		const ImportanceSettings& settings = m_importanceSettings;
+		m_constantBufferData.importanceParams = XMFLOAT4(static_cast<float>(settings.tileSize), static_cast<float>(settings.margin), 0.0f, 0.0f);
+		m_constantBufferData.importanceThresholds = XMFLOAT4(settings.emptyAlpha, settings.opaqueAlpha, settings.varianceThreshold, 0.0f);
+		m_constantBufferData.importanceBudgets = XMFLOAT4(
+			settings.budget[static_cast<int>(TileClass::Empty)],
+			settings.budget[static_cast<int>(TileClass::Transparent)],
+			settings.budget[static_cast<int>(TileClass::Opaque)],
+			settings.budget[static_cast<int>(TileClass::Detailed)]
+		);
+	}
+	else
+	{
+		m_constantBufferData.importanceParams = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	// The field describes the generated volume, not the brick pool or a channel volume.
+	bool skipping = m_emptySpaceSkippingEnabled && m_distanceFieldView != nullptr && m_volumeFormat == VolumeFormat::Rgba;
+	m_constantBufferData.distanceParams = skipping ? m_distanceFieldParams : XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	bool sceneDepth = !stereo && m_sceneDepthClipping && m_deviceResources->GetDepthStencilResourceView() != nullptr;
+	m_constantBufferData.sceneDepthParams = XMFLOAT4(sceneDepth ? 1.0f : 0.0f, 0.0f, 0.0f, 0.0f);
+
+	if (stereo)
+	{
+		if (m_stereoTarget == nullptr)
+		{
+			CreateStereoTargets();
+		}
+		StoreStereoView(m_stereoView, m_worldMatrix, m_constantBufferData);
+		m_constantBufferData.stereoParams = XMFLOAT4(1.0f, m_stereoViewport.Width, m_stereoViewport.Height, 0.0f);
+	}
+	else
+	{
+		m_constantBufferData.stereoParams = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
 	}
-
-	auto context = m_deviceResources->GetD3DDeviceContext();
 
 	// Preparereat the constant buffer to send it to the graphics device.
 	context->UpdateSubresource1(
@@ -158,6 +1461,118 @@ void Sample3DSceneRenderer::Render()
 		0
 	);
 
+	// The surface goes into the back buffer first; every volume path composites over it.
+	bool isosurface = !stereo && m_isosurfaceEnabled && m_isosurfaceExtractor != nullptr && m_volumeFormat == VolumeFormat::Rgba;
+	if (isosurface && !m_isosurfaceMeshValid)
+	{
+		UpdateIsosurfaceMesh();
+	}
+	isosurface = isosurface && m_isosurfaceIndexCount > 0;
+	if (isosurface)
+	{
+		RenderIsosurface();
+	}
+
+	// All opaque geometry is in the depth buffer now; next frames cull against it.
+	CaptureOcclusionDepth();
+
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferTarget;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthStencilView;
+	if (offscreen)
+	{
+		// March into the offscreen targets unblended; blending happens when the result is composited into the back buffer.
+		context->OMGetRenderTargets(1, &backBufferTarget, &depthStencilView);
+
+		// Classify the previous pass before its targets are cleared.
+		if (importance)
+		{
+			RenderImportanceMap();
+		}
+
+		ID3D11RenderTargetView* const volumeTargets[2] = { m_volumeColorTargetView.Get(), m_volumeDepthTargetView.Get() };
+		context->OMSetRenderTargets(2, volumeTargets, nullptr);
+
+		const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const float clearDepth[4] = { -1.0f, -1.0f, -1.0f, -1.0f };
+		context->ClearRenderTargetView(m_volumeColorTargetView.Get(), clearColor);
+		context->ClearRenderTargetView(m_volumeDepthTargetView.Get(), clearDepth);
+		context->RSSetViewports(1, &m_volumeViewport);
+	}
+	else if (stereo)
+	{
+		// Both eyes are marched unblended into their slices and composited into the back buffer afterwards.
+		context->OMGetRenderTargets(1, &backBufferTarget, &depthStencilView);
+		context->OMSetRenderTargets(1, m_stereoTargetView.GetAddressOf(), nullptr);
+
+		const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		context->ClearRenderTargetView(m_stereoTargetView.Get(), clearColor);
+		context->RSSetViewports(1, &m_stereoViewport);
+	}
+	else if (sceneDepth)
+	{
+		// The march reads the depth buffer, so it cannot stay bound for writing.
+		context->OMGetRenderTargets(1, &backBufferTarget, &depthStencilView);
+		context->OMSetRenderTargets(1, backBufferTarget.GetAddressOf(), nullptr);
+	}
+
+	RenderVolumePass(!offscreen && !stereo);
+
+	if (stereo)
+	{
+		context->OMSetRenderTargets(1, backBufferTarget.GetAddressOf(), depthStencilView.Get());
+		context->RSSetViewports(1, &screenViewport);
+		CompositeStereo();
+	}
+
+	if (sceneDepth)
+	{
+		ID3D11ShaderResourceView* const nullView[1] = { nullptr };
+		context->PSSetShaderResources(6, 1, nullView);
+		if (!offscreen)
+		{
+			context->OMSetRenderTargets(1, backBufferTarget.GetAddressOf(), depthStencilView.Get());
+		}
+	}
+
+	if (offscreen)
+	{
+		// Unbind the step budgets so the next frame can render into them.
+		ID3D11ShaderResourceView* const nullView[1] = { nullptr };
+		context->PSSetShaderResources(1, 1, nullView);
+		m_importanceValid = m_importanceEnabled;
+
+		ID3D11ShaderResourceView* compositeSource = m_volumeColorResourceView.Get();
+		if (interleaved)
+		{
+			compositeSource = ReconstructInterleaved();
+		}
+		else if (temporal)
+		{
+			compositeSource = ResolveTemporal();
+		}
+
+		if (interleaved || temporal)
+		{
+			// The history just written becomes the input of the next frame.
+			m_historyIndex ^= 1;
+			m_historyValid = true;
+			m_frameIndex++;
+		}
+
+		context->OMSetRenderTargets(1, backBufferTarget.GetAddressOf(), depthStencilView.Get());
+		context->RSSetViewports(1, &screenViewport);
+		CompositeVolume(compositeSource, !interleaved);
+	}
+
+	// Remember this frame's matrix for next frame's reprojection.
+	XMStoreFloat4x4(&m_constantBufferData.prevWorldViewProjectionMatrix, XMMatrixTranspose(m_worldViewProjectionMatrix));
+}
+
+// Draws the cube with the raymarching shaders into whatever targets are bound.
+void Sample3DSceneRenderer::RenderVolumePass(bool blend)
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
 	UINT stride = sizeof(VertexPositionColor);
 	UINT offset = 0;
 	context->IASetVertexBuffers(
@@ -177,12 +1592,13 @@ void Sample3DSceneRenderer::Render()
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	context->IASetInputLayout(m_inputLayout.Get());
 
-	// Attach our vertex shader.
+	// Attach our vertex shader. Stereo draws one instance per eye, which the geometry shader sends to that eye's slice.
 	context->VSSetShader(
-		m_vertexShader.Get(),
+		m_stereoEnabled ? m_stereoVertexShader.Get() : m_vertexShader.Get(),
 		nullptr,
 		0
 	);
+	context->GSSetShader(m_stereoEnabled ? m_stereoGeometryShader.Get() : nullptr, nullptr, 0);
 
 	// Send the constant buffer to the graphics device.
 	context->VSSetConstantBuffers1(
@@ -195,7 +1611,7 @@ void Sample3DSceneRenderer::Render()
 
 	// Attach our pixel shader.
 	context->PSSetShader(
-		m_pixelShader.Get(),
+		m_activeRaymarchShader.Get(),
 		nullptr,
 		0
 	);
@@ -205,32 +1621,242 @@ void Sample3DSceneRenderer::Render()
 		1,
 		m_constantBuffer.GetAddressOf());
 
-	context->PSSetShaderResources(0, 1, m_volumeTextureView.GetAddressOf());
+	bool paged = m_volumeFormat == VolumeFormat::Paged;
+	bool channels = m_volumeFormat == VolumeFormat::Channels;
+	bool generated = m_volumeFormat == VolumeFormat::Rgba;
+	ID3D11ShaderResourceView* const views[9] =
+	{
+		paged ? m_brickPoolView.Get() : (channels ? m_channelVolumeView.Get() : m_volumeTextureView.Get()),
+		(m_constantBufferData.importanceParams.x > 0.0f) ? m_importanceResourceView.Get() : nullptr,
+		m_transferFunctionView.Get(),
+		paged ? m_pageTableView.Get() : nullptr,
+		generated ? m_gradientTextureView.Get() : nullptr,
+		generated ? m_distanceFieldView.Get() : nullptr,
+		(m_constantBufferData.sceneDepthParams.x > 0.0f) ? m_deviceResources->GetDepthStencilResourceView() : nullptr,
+		channels ? m_channelTransferView.Get() : nullptr,
+		paged ? m_coarseVolumeView.Get() : nullptr
+	};
+	context->PSSetShaderResources(0, 9, views);
 	context->PSSetSamplers(0, 1, m_samplerState.GetAddressOf());
 
 	// Bind the blend state for volume accumulation
 	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 	UINT sampleMask = 0xffffffff;
-	context->OMSetBlendState(m_blendState.Get(), blendFactor, sampleMask);
+	context->OMSetBlendState(blend ? m_blendState.Get() : nullptr, blendFactor, sampleMask);
 
 	// Set the rasterizer state for Front-Face Culling
 	context->RSSetState(m_rasterState.Get());
 
+	// The box's back faces lie behind an isosurface, so they must not be depth tested against it.
+	bool isosurface = m_isosurfaceEnabled && m_isosurfaceIndexCount > 0 && m_volumeFormat == VolumeFormat::Rgba;
+	context->OMSetDepthStencilState(isosurface ? m_depthDisabledState.Get() : nullptr, 0);
+
 	// Draw the objects.
-	context->DrawIndexed(
-		m_indexCount,
-		0,
-		0
+	if (m_stereoEnabled)
+	{
+		context->DrawIndexedInstanced(m_indexCount, StereoViewCount, 0, 0, 0);
+		context->GSSetShader(nullptr, nullptr, 0);
+	}
+	else
+	{
+		context->DrawIndexed(
+			m_indexCount,
+			0,
+			0
+		);
+	}
+}
+
+// Blends the current march with the reprojected history and returns the view of the new history.
+ID3D11ShaderResourceView* Sample3DSceneRenderer::ResolveTemporal()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	uint32 current = m_historyIndex;
+	uint32 previous = m_historyIndex ^ 1;
+
+	ID3D11RenderTargetView* const historyTarget[1] = { m_historyTargetViews[current].Get() };
+	context->OMSetRenderTargets(1, historyTarget, nullptr);
+	context->RSSetViewports(1, &m_volumeViewport);
+
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	context->OMSetBlendState(nullptr, blendFactor, 0xffffffff);
+	context->RSSetState(nullptr);
+
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->VSSetShader(m_fullscreenVertexShader.Get(), nullptr, 0);
+	context->PSSetShader(m_temporalResolvePixelShader.Get(), nullptr, 0);
+
+	ID3D11ShaderResourceView* const views[3] =
+	{
+		m_volumeColorResourceView.Get(),
+		m_volumeDepthResourceView.Get(),
+		m_historyResourceViews[previous].Get()
+	};
+	context->PSSetShaderResources(0, 3, views);
+
+	context->Draw(3, 0);
+
+	ID3D11ShaderResourceView* const nullViews[3] = { nullptr, nullptr, nullptr };
+	context->PSSetShaderResources(0, 3, nullViews);
+
+	return m_historyResourceViews[current].Get();
+}
+
+// Writes one step budget per tile from the color and ray depth the previous frame left in the volume targets.
+void Sample3DSceneRenderer::RenderImportanceMap()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	ID3D11RenderTargetView* const importanceTarget[1] = { m_importanceTargetView.Get() };
+	context->OMSetRenderTargets(1, importanceTarget, nullptr);
+	context->RSSetViewports(1, &m_importanceViewport);
+
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	context->OMSetBlendState(nullptr, blendFactor, 0xffffffff);
+	context->RSSetState(nullptr);
+
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->VSSetShader(m_fullscreenVertexShader.Get(), nullptr, 0);
+	context->PSSetShader(m_importancePixelShader.Get(), nullptr, 0);
+	context->PSSetConstantBuffers(0, 1, m_constantBuffer.GetAddressOf());
+
+	ID3D11ShaderResourceView* const views[2] = { m_volumeColorResourceView.Get(), m_volumeDepthResourceView.Get() };
+	context->PSSetShaderResources(0, 2, views);
+
+	context->Draw(3, 0);
+
+	ID3D11ShaderResourceView* const nullViews[2] = { nullptr, nullptr };
+	context->PSSetShaderResources(0, 2, nullViews);
+}
+
+// Fills the full resolution history from this frame's interleaved samples and the reprojected previous history.
+ID3D11ShaderResourceView* Sample3DSceneRenderer::ReconstructInterleaved()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	uint32 current = m_historyIndex;
+	uint32 previous = m_historyIndex ^ 1;
+
+	ID3D11RenderTargetView* const historyTarget[1] = { m_historyTargetViews[current].Get() };
+	context->OMSetRenderTargets(1, historyTarget, nullptr);
+	D3D11_VIEWPORT screenViewport = m_deviceResources->GetScreenViewport();
+	context->RSSetViewports(1, &screenViewport);
+
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	context->OMSetBlendState(nullptr, blendFactor, 0xffffffff);
+	context->RSSetState(nullptr);
+
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->VSSetShader(m_fullscreenVertexShader.Get(), nullptr, 0);
+	context->PSSetShader(m_interleaveReconstructPixelShader.Get(), nullptr, 0);
+
+	ID3D11ShaderResourceView* const views[3] =
+	{
+		m_volumeColorResourceView.Get(),
+		m_volumeDepthResourceView.Get(),
+		m_historyResourceViews[previous].Get()
+	};
+	context->PSSetShaderResources(0, 3, views);
+
+	context->Draw(3, 0);
+
+	ID3D11ShaderResourceView* const nullViews[3] = { nullptr, nullptr, nullptr };
+	context->PSSetShaderResources(0, 3, nullViews);
+
+	return m_historyResourceViews[current].Get();
+}
+
+// Writes an offscreen volume result into the bound back buffer with a single fullscreen triangle,
+// either through the depth-aware upsample or as a straight copy of a full resolution result.
+void Sample3DSceneRenderer::CompositeVolume(ID3D11ShaderResourceView* volumeColor, bool upsample)
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	context->OMSetBlendState(m_blendState.Get(), blendFactor, 0xffffffff);
+	context->RSSetState(nullptr);
+
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->VSSetShader(m_fullscreenVertexShader.Get(), nullptr, 0);
+	context->PSSetShader(upsample ? m_upsamplePixelShader.Get() : m_compositePixelShader.Get(), nullptr, 0);
+
+	ID3D11ShaderResourceView* const volumeViews[2] = { volumeColor, m_volumeDepthResourceView.Get() };
+	context->PSSetShaderResources(0, 2, volumeViews);
+
+	context->Draw(3, 0);
+
+	// Unbind so the targets can be written again next frame.
+	ID3D11ShaderResourceView* const nullViews[2] = { nullptr, nullptr };
+	context->PSSetShaderResources(0, 2, nullViews);
+}
+
+// One slice per eye, each half the back buffer wide.
+void Sample3DSceneRenderer::CreateStereoTargets()
+{
+	D3D11_VIEWPORT screenViewport = m_deviceResources->GetScreenViewport();
+	UINT width = static_cast<UINT>(screenViewport.Width) / StereoViewCount;
+	UINT height = static_cast<UINT>(screenViewport.Height);
+	width = (width > 0) ? width : 1;
+	height = (height > 0) ? height : 1;
+
+	CD3D11_TEXTURE2D_DESC colorDesc(
+		DXGI_FORMAT_R16G16B16A16_FLOAT,
+		width,
+		height,
+		StereoViewCount,
+		1,
+		D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE
 	);
+
+	// The default views of an array texture cover every slice.
+	auto device = m_deviceResources->GetD3DDevice();
+	DX::ThrowIfFailed(device->CreateTexture2D(&colorDesc, nullptr, &m_stereoTarget));
+	DX::ThrowIfFailed(device->CreateRenderTargetView(m_stereoTarget.Get(), nullptr, &m_stereoTargetView));
+	DX::ThrowIfFailed(device->CreateShaderResourceView(m_stereoTarget.Get(), nullptr, &m_stereoResourceView));
+	m_stereoViewport = CD3D11_VIEWPORT(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height));
+}
+
+// Places both eyes side by side in the bound back buffer with a single fullscreen draw.
+void Sample3DSceneRenderer::CompositeStereo()
+{
+	auto context = m_deviceResources->GetD3DDeviceContext();
+
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	context->OMSetBlendState(m_blendState.Get(), blendFactor, 0xffffffff);
+	context->RSSetState(nullptr);
+
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->VSSetShader(m_fullscreenVertexShader.Get(), nullptr, 0);
+	context->PSSetShader(m_stereoCompositePixelShader.Get(), nullptr, 0);
+	context->PSSetConstantBuffers(0, 1, m_constantBuffer.GetAddressOf());
+	context->PSSetShaderResources(0, 1, m_stereoResourceView.GetAddressOf());
+
+	context->Draw(3, 0);
+
+	// Unbind so the target can be written again next frame.
+	ID3D11ShaderResourceView* const nullView[1] = { nullptr };
+	context->PSSetShaderResources(0, 1, nullView);
 }
 
-void GenerateNestedCubes(std::vector<VertexPositionColor>& vertices, std::vector<unsigned int>& indices,
-	XMFLOAT3 min, XMFLOAT3 max, int level, uint32& currentIndex) {
+void GenerateNestedCubes(ArenaVector<VertexPositionColor>& vertices, ArenaVector<unsigned int>& indices,
+	std::vector<VolumeBrickBounds>& bricks, XMFLOAT3 min, XMFLOAT3 max, int level, uint32& currentIndex) {
 
 	float cubeCntWidth = 1.0f;
 	float cubeSize = 1.0f / cubeCntWidth;
 	unsigned int indexOffset = 0;
 
+	// Reserve the whole mesh up front so the arena is not left holding every outgrown buffer.
+	size_t cubeCount = static_cast<size_t>(cubeCntWidth * cubeCntWidth * cubeCntWidth);
+	vertices.reserve(vertices.size() + cubeCount * 8);
+	indices.reserve(indices.size() + cubeCount * 36);
+	bricks.reserve(bricks.size() + cubeCount);
+
 	for (float z = 0; z < cubeCntWidth; z++)
 	{
 		for (float y = 0; y < cubeCntWidth; y++)
@@ -286,6 +1912,12 @@ void GenerateNestedCubes(std::vector<VertexPositionColor>& vertices, std::vector
 
 				indices.insert(indices.end(), std::begin(cubeIndices), std::end(cubeIndices));
 
+				// Record the cube's bounds so the culling pass can test it.
+				VolumeBrickBounds brick;
+				brick.center = XMFLOAT3((startX + endX) * 0.5f, (startY + endY) * 0.5f, (startZ + endZ) * 0.5f);
+				brick.extents = XMFLOAT3((endX - startX) * 0.5f, (endY - startY) * 0.5f, (endZ - startZ) * 0.5f);
+				bricks.push_back(brick);
+
 				indexOffset = vertices.size();
 			}
 		}
@@ -293,67 +1925,305 @@ void GenerateNestedCubes(std::vector<VertexPositionColor>& vertices, std::vector
 	currentIndex = indices.size();
 }
 
+namespace
+{
+	// Every shader the renderer creates besides the raymarch permutations.
+	const wchar_t* const s_shaderFiles[] =
+	{
+		L"SampleVertexShader.cso",
+		L"SamplePixelShader.cso",
+		L"FullscreenVertexShader.cso",
+		L"UpsamplePixelShader.cso",
+		L"TemporalResolvePixelShader.cso",
+		L"InterleaveReconstructPixelShader.cso",
+		L"CompositePixelShader.cso",
+		L"ImportancePixelShader.cso",
+		L"IsosurfaceVertexShader.cso",
+		L"IsosurfacePixelShader.cso",
+		L"StereoVertexShader.cso",
+		L"StereoGeometryShader.cso",
+		L"StereoCompositePixelShader.cso",
+		L"OcclusionDepthPixelShader.cso",
+	};
+
+	const wchar_t s_shaderArchiveFile[] = L"ShaderArchive.bin";
+
+	// Archive bytes and the index over them, shared by the parallel creation jobs.
+	struct ShaderArchiveBuffer
+	{
+		DX::FileView data;
+		ShaderArchiveReader reader;
+		bool fromCache;
+	};
+
+	// Shader file names are ASCII, so the archive stores them narrowed.
+	std::string ToArchiveName(const std::wstring& fileName)
+	{
+		std::string name;
+		name.reserve(fileName.size());
+		for (wchar_t c : fileName)
+		{
+			name.push_back(static_cast<char>(c));
+		}
+		return name;
+	}
+
+	// An archive is only reused by a build whose compiled shaders are byte for byte the ones it holds. The build
+	// hashes every .cso into ShaderContentKey.h, so the key costs nothing at startup.
+	uint64_t GetShaderArchiveBuildId()
+	{
+		static const char contentHashes[] = SHADER_CONTENT_HASHES;
+		return HashShaderArchiveKey(contentHashes, sizeof(contentHashes) - 1);
+	}
+
+	void FindShader(const ShaderArchiveBuffer& archive, const std::wstring& fileName, const uint8_t*& data, size_t& size)
+	{
+		if (!archive.reader.Find(ToArchiveName(fileName), data, size) || size == 0)
+		{
+			DX::ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+		}
+	}
+
+	// Reads the shader archive left in local data by an earlier launch. When it is missing or stale, the loose
+	// .cso files are read in parallel instead and packed into a new archive for the next launch.
+	Concurrency::task<std::shared_ptr<ShaderArchiveBuffer>> LoadShaderArchiveAsync(const std::vector<std::wstring>& files)
+	{
+		uint64_t buildId = GetShaderArchiveBuildId();
+		auto readArchiveTask = DX::OpenLocalFileViewAsync(s_shaderArchiveFile);
+
+		return readArchiveTask.then([files, buildId](DX::FileView archiveData) {
+			auto archive = std::make_shared<ShaderArchiveBuffer>();
+			archive->data = archiveData;
+			archive->fromCache = archive->reader.Open(archive->data.Data(), archive->data.Size(), buildId);
+
+			const uint8_t* data;
+			size_t size;
+			for (const std::wstring& file : files)
+			{
+				archive->fromCache = archive->fromCache && archive->reader.Find(ToArchiveName(file), data, size);
+			}
+
+			if (archive->fromCache)
+			{
+				return Concurrency::task_from_result(archive);
+			}
+
+			std::vector<Concurrency::task<DX::FileView>> readTasks;
+			for (const std::wstring& file : files)
+			{
+				readTasks.push_back(DX::OpenFileViewAsync(file));
+			}
+
+			return Concurrency::when_all(readTasks.begin(), readTasks.end()).then([files, buildId](std::vector<DX::FileView> blobs) {
+				ShaderArchiveWriter writer;
+				for (size_t i = 0; i < files.size(); ++i)
+				{
+					writer.Add(ToArchiveName(files[i]), blobs[i].Data(), blobs[i].Size());
+				}
+
+				std::vector<uint8_t> serialized = writer.Serialize(buildId);
+
+				// A failed write only costs the next launch the loose reads again.
+				DX::WriteLocalDataAsync(s_shaderArchiveFile, serialized).then([](Concurrency::task<void> writeTask) {
+					try
+					{
+						writeTask.get();
+					}
+					catch (Platform::Exception^)
+					{
+					}
+					});
+
+				auto archive = std::make_shared<ShaderArchiveBuffer>();
+				archive->data = DX::MakeFileView(std::move(serialized));
+				archive->reader.Open(archive->data.Data(), archive->data.Size(), buildId);
+				archive->fromCache = false;
+				return archive;
+				});
+			});
+	}
+}
+
 void Sample3DSceneRenderer::CreateDeviceDependentResources()
 {
-	// Load shaders asynchronously.
-	auto loadVSTask = DX::ReadDataAsync(L"SampleVertexShader.cso");
-	auto loadPSTask = DX::ReadDataAsync(L"SamplePixelShader.cso");
+	auto loadStart = std::chrono::steady_clock::now();
 
-	// After the vertex shader file is loaded, create the shader and input layout.
-	auto createVSTask = loadVSTask.then([this](const std::vector<byte>& fileData) {
-		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateVertexShader(
-				&fileData[0],
-				fileData.size(),
-				nullptr,
-				&m_vertexShader
-			)
-		);
+	size_t permutationCount;
+	const RaymarchPermutation* permutations = GetRaymarchPermutations(permutationCount);
+
+	std::vector<std::wstring> files(std::begin(s_shaderFiles), std::end(s_shaderFiles));
+	for (size_t i = 0; i < permutationCount; ++i)
+	{
+		// The general permutation is SamplePixelShader.cso itself.
+		if (std::find(files.begin(), files.end(), permutations[i].shaderFile) == files.end())
+		{
+			files.push_back(permutations[i].shaderFile);
+		}
+	}
+
+	// Load every shader with one archive read, then create shaders and states in parallel.
+	auto createResourcesTask = LoadShaderArchiveAsync(files).then([this, loadStart, permutations, permutationCount](std::shared_ptr<ShaderArchiveBuffer> archive) {
+		auto createStart = std::chrono::steady_clock::now();
+		ID3D11Device3* device = m_deviceResources->GetD3DDevice();
+
+		// Each job creates one object; the device is free threaded, so the jobs run concurrently.
+		std::vector<std::function<void()>> jobs;
+
+		jobs.push_back([this, device, archive]() {
+			const uint8_t* data;
+			size_t size;
+			FindShader(*archive, L"SampleVertexShader.cso", data, size);
+			DX::ThrowIfFailed(device->CreateVertexShader(data, size, nullptr, &m_vertexShader));
+
+			static const D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
+			{
+				{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+				{ "TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			};
+
+			DX::ThrowIfFailed(device->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc), data, size, &m_inputLayout));
+			});
+
+		jobs.push_back([this, device, archive]() {
+			const uint8_t* data;
+			size_t size;
+			FindShader(*archive, L"FullscreenVertexShader.cso", data, size);
+			DX::ThrowIfFailed(device->CreateVertexShader(data, size, nullptr, &m_fullscreenVertexShader));
+			});
+
+		jobs.push_back([this, device, archive]() {
+			const uint8_t* data;
+			size_t size;
+			FindShader(*archive, L"IsosurfaceVertexShader.cso", data, size);
+			DX::ThrowIfFailed(device->CreateVertexShader(data, size, nullptr, &m_isosurfaceVertexShader));
+			});
+
+		jobs.push_back([this, device, archive]() {
+			const uint8_t* data;
+			size_t size;
+			FindShader(*archive, L"StereoVertexShader.cso", data, size);
+			DX::ThrowIfFailed(device->CreateVertexShader(data, size, nullptr, &m_stereoVertexShader));
+			FindShader(*archive, L"StereoGeometryShader.cso", data, size);
+			DX::ThrowIfFailed(device->CreateGeometryShader(data, size, nullptr, &m_stereoGeometryShader));
+			});
+
+		struct PixelShaderSlot
+		{
+			const wchar_t* file;
+			Microsoft::WRL::ComPtr<ID3D11PixelShader>* shader;
+		};
 
-		static const D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
+		const PixelShaderSlot pixelShaders[] =
 		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ L"SamplePixelShader.cso", &m_pixelShader },
+			{ L"UpsamplePixelShader.cso", &m_upsamplePixelShader },
+			{ L"TemporalResolvePixelShader.cso", &m_temporalResolvePixelShader },
+			{ L"InterleaveReconstructPixelShader.cso", &m_interleaveReconstructPixelShader },
+			{ L"CompositePixelShader.cso", &m_compositePixelShader },
+			{ L"ImportancePixelShader.cso", &m_importancePixelShader },
+			{ L"IsosurfacePixelShader.cso", &m_isosurfacePixelShader },
+			{ L"StereoCompositePixelShader.cso", &m_stereoCompositePixelShader },
+			{ L"OcclusionDepthPixelShader.cso", &m_occlusionDepthPixelShader },
 		};
 
-		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateInputLayout(
-				vertexDesc,
-				ARRAYSIZE(vertexDesc),
-				&fileData[0],
-				fileData.size(),
-				&m_inputLayout
-			)
-		);
-		});
+		// Raymarch permutations are created into their own slots and moved into the keyed cache afterwards.
+		auto permutationShaders = std::make_shared<std::vector<Microsoft::WRL::ComPtr<ID3D11PixelShader>>>(permutationCount);
 
-	// After the pixel shader file is loaded, create the shader and constant buffer.
-	auto createPSTask = loadPSTask.then([this](const std::vector<byte>& fileData) {
-		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreatePixelShader(
-				&fileData[0],
-				fileData.size(),
-				nullptr,
-				&m_pixelShader
-			)
-		);
+		std::vector<PixelShaderSlot> slots(std::begin(pixelShaders), std::end(pixelShaders));
+		for (size_t i = 0; i < permutationCount; ++i)
+		{
+			slots.push_back({ permutations[i].shaderFile, &(*permutationShaders)[i] });
+		}
 
-		CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ModelViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
-		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateBuffer(
-				&constantBufferDesc,
-				nullptr,
-				&m_constantBuffer
-			)
-		);
+		for (const PixelShaderSlot& slot : slots)
+		{
+			jobs.push_back([device, archive, slot]() {
+				const uint8_t* data;
+				size_t size;
+				FindShader(*archive, slot.file, data, size);
+				DX::ThrowIfFailed(device->CreatePixelShader(data, size, nullptr, slot.shader->ReleaseAndGetAddressOf()));
+				});
+		}
+
+		jobs.push_back([this, device]() {
+			CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ModelViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+			DX::ThrowIfFailed(device->CreateBuffer(&constantBufferDesc, nullptr, &m_constantBuffer));
+			});
+
+		jobs.push_back([this, device]() {
+			// Create the rasterizer state for front culling
+			D3D11_RASTERIZER_DESC rasterDesc;
+			ZeroMemory(&rasterDesc, sizeof(rasterDesc));
+			rasterDesc.FillMode = D3D11_FILL_SOLID;
+			rasterDesc.CullMode = D3D11_CULL_FRONT; // Cull front faces to see the back of the box
+			rasterDesc.FrontCounterClockwise = false;
+			rasterDesc.DepthBias = 0;
+			rasterDesc.SlopeScaledDepthBias = 0.0f;
+			rasterDesc.DepthBiasClamp = 0.0f;
+			rasterDesc.DepthClipEnable = true;
+			rasterDesc.ScissorEnable = false;
+			rasterDesc.MultisampleEnable = false;
+			rasterDesc.AntialiasedLineEnable = false;
+
+			DX::ThrowIfFailed(device->CreateRasterizerState(&rasterDesc, &m_rasterState));
+			});
+
+		jobs.push_back([this, device]() {
+			// Create the blend state for transparency accumulation
+			D3D11_BLEND_DESC blendDesc = {};
+			blendDesc.RenderTarget[0].BlendEnable = TRUE;
+			blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+			blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+			blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+			blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+			blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+			blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+			blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+			DX::ThrowIfFailed(device->CreateBlendState(&blendDesc, &m_blendState));
+			});
+
+		jobs.push_back([this, device]() {
+			D3D11_DEPTH_STENCIL_DESC dsDesc = {};
+			dsDesc.DepthEnable = TRUE;
+			dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO; // Important: Don't write to depth!
+			dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
+
+			DX::ThrowIfFailed(device->CreateDepthStencilState(&dsDesc, &m_depthStencilState));
+
+			D3D11_DEPTH_STENCIL_DESC disabledDesc = {};
+			disabledDesc.DepthEnable = FALSE;
+			disabledDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+			disabledDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+			DX::ThrowIfFailed(device->CreateDepthStencilState(&disabledDesc, &m_depthDisabledState));
+			});
+
+		Concurrency::parallel_for(size_t(0), jobs.size(), [&jobs](size_t i) {
+			jobs[i]();
+			});
+
+		for (size_t i = 0; i < permutationCount; ++i)
+		{
+			m_raymarchShaders[permutations[i].key.Pack()] = (*permutationShaders)[i];
+		}
+		m_activeRaymarchRequest = UINT32_MAX;
+
+		auto createEnd = std::chrono::steady_clock::now();
+		m_shaderLoadStats.fromArchive = archive->fromCache;
+		m_shaderLoadStats.shaderCount = static_cast<uint32>(archive->reader.GetEntryCount());
+		m_shaderLoadStats.archiveBytes = archive->data.Size();
+		m_shaderLoadStats.readMilliseconds = std::chrono::duration<double, std::milli>(createStart - loadStart).count();
+		m_shaderLoadStats.createMilliseconds = std::chrono::duration<double, std::milli>(createEnd - createStart).count();
 		});
 
-	// Once both shaders are loaded, create the mesh.
-	auto createCubeTask = (createPSTask && createVSTask).then([this]() {
+	// Once all shaders are loaded, create the mesh.
+	auto createCubeTask = createResourcesTask.then([this]() {
 
-		std::vector<VertexPositionColor> vertices;
-		std::vector<unsigned int> indices;
-		GenerateNestedCubes(vertices, indices, XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(0.5f, 0.5f, 0.5f), 0, m_indexCount);
+		LinearArena arena;
+		ArenaVector<VertexPositionColor> vertices{ ArenaAllocator<VertexPositionColor>(&arena) };
+		ArenaVector<unsigned int> indices{ ArenaAllocator<unsigned int>(&arena) };
+		m_brickBounds.clear();
+		GenerateNestedCubes(vertices, indices, m_brickBounds, XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(0.5f, 0.5f, 0.5f), 0, m_indexCount);
 
 		D3D11_SUBRESOURCE_DATA vertexBufferData = { 0 };
 		vertexBufferData.pSysMem = vertices.data();
@@ -380,69 +2250,49 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 				&m_indexBuffer
 			)
 		);
-
-		// Create the rasterizer state for front culling
-		D3D11_RASTERIZER_DESC rasterDesc;
-		ZeroMemory(&rasterDesc, sizeof(rasterDesc));
-		rasterDesc.FillMode = D3D11_FILL_SOLID;
-		rasterDesc.CullMode = D3D11_CULL_FRONT; // Cull front faces to see the back of the box
-		rasterDesc.FrontCounterClockwise = false;
-		rasterDesc.DepthBias = 0;
-		rasterDesc.SlopeScaledDepthBias = 0.0f;
-		rasterDesc.DepthBiasClamp = 0.0f;
-		rasterDesc.DepthClipEnable = true;
-		rasterDesc.ScissorEnable = false;
-		rasterDesc.MultisampleEnable = false;
-		rasterDesc.AntialiasedLineEnable = false;
-
-		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateRasterizerState(&rasterDesc, &m_rasterState)
-		);
-
-		// Create the blend state for transparency accumulation
-		D3D11_BLEND_DESC blendDesc = {};
-		blendDesc.RenderTarget[0].BlendEnable = TRUE;
-		blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-		blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-		blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-		blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
-		blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
-		blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-		blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-
-		DX::ThrowIfFailed(
-			m_deviceResources->GetD3DDevice()->CreateBlendState(&blendDesc, &m_blendState)
-		);
 		});
-	D3D11_DEPTH_STENCIL_DESC dsDesc = {};
-	dsDesc.DepthEnable = TRUE;
-	dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO; // Important: Don't write to depth!
-	dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
 
-	// Create and bind this state in your Render() function
-	m_deviceResources->GetD3DDevice()->CreateDepthStencilState(&dsDesc, &m_depthStencilState);
 	// Once the cube is loaded, the object is ready to be rendered.
 	createCubeTask.then([this]() {
 		CreateVolumetricTexture();
+		CreateTransferFunction();
+		CreateChannelVolumeTexture();
+		CreateChannelTransferFunctions();
 		m_loadingComplete = true;
 		});
 }
-// Add this helper at the top of Sample3DSceneRenderer.cpp to generate fog noise
-float FractalNoise(float x, float y, float z) {
-	auto hash = [](int n) {
-		n = (n << 13) ^ n;
-		return (1.0f - ((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0f);
-		};
-	float h = hash(static_cast<int>(x + y * 57 + z * 113));
-	float h2 = hash(static_cast<int>(x * 2 + y * 114 + z * 226)) * 0.5f;
-	return (h + h2 + 1.5f) / 3.0f;
-}
-
 void Sample3DSceneRenderer::CreateVolumetricTexture()
 {
-	const int textureWidth = 256;
-	const int textureHeight = 256;
-	const int textureDepth = 256;
+	// Generate the fog sphere on the CPU unless SetVolume supplied one; the same generator feeds the reference raymarcher.
+	// The voxels only live until the upload, so they come from a load-scoped arena, unless the editor keeps them.
+	LinearArena arena(LinearArena::DefaultBlockSize, true);
+	// An existing editor is reused so edits survive a lost device.
+	VolumeData loadVolume(&arena);
+	std::unique_ptr<VolumeEditor> editor;
+	if (m_volumeEditingEnabled)
+	{
+		editor = (m_volumeEditor != nullptr) ? std::move(m_volumeEditor) : std::unique_ptr<VolumeEditor>(new VolumeEditor());
+	}
+	m_volumeEditor.reset();
+	VolumeData& editable = (editor != nullptr) ? editor->GetVolume() : loadVolume;
+	if (editable.VoxelCount() == 0)
+	{
+		if (m_sourceVolume == nullptr)
+		{
+			GenerateFogSphereVolume(editable, GeneratedVolumeSize);
+		}
+		else if (editor != nullptr)
+		{
+			editable.Resize(m_sourceVolume->width, m_sourceVolume->height, m_sourceVolume->depth);
+			std::copy(m_sourceVolume->voxels.begin(), m_sourceVolume->voxels.end(), editable.voxels.begin());
+		}
+	}
+
+	// A supplied volume that is not edited is uploaded straight from its own voxels.
+	const VolumeData& volume = (editor == nullptr && m_sourceVolume != nullptr) ? *m_sourceVolume : editable;
+	const uint32 textureWidth = volume.width;
+	const uint32 textureHeight = volume.height;
+	const uint32 textureDepth = volume.depth;
 
 	D3D11_TEXTURE3D_DESC textureDesc = {};
 	textureDesc.Width = textureWidth;
@@ -453,60 +2303,56 @@ void Sample3DSceneRenderer::CreateVolumetricTexture()
 	textureDesc.Usage = D3D11_USAGE_DEFAULT;
 	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 
-	std::vector<float> textureData(textureWidth * textureHeight * textureDepth * 4, 0.0f);
-
-	const float centerX = textureWidth / 2.0f;
-	const float centerY = textureHeight / 2.0f;
-	const float centerZ = textureDepth / 2.0f;
-	const float maxRadius = textureWidth / 2.0f;
-
-	for (int z = 0; z < textureDepth; ++z) {
-		for (int y = 0; y < textureHeight; ++y) {
-			for (int x = 0; x < textureWidth; ++x) {
-				float dx = centerX - (float)x;
-				float dy = centerY - (float)y;
-				float dz = centerZ - (float)z;
-				float dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
-
-				// FIXED: Using a ternary operator to avoid the std::max macro conflict
-				float rawAlpha = 1.0f - (dist / maxRadius);
-				float sphereAlpha = (rawAlpha > 0.0f) ? rawAlpha : 0.0f;
-
-				// Add fractal noise for the "actual fog" look
-				float noise = FractalNoise((float)x * 0.15f, (float)y * 0.15f, (float)z * 0.15f);
-				float finalAlpha = pow(sphereAlpha * noise, 1.5f);
-
-				// Smooth color blending logic
-				float factor = ((float)(y - x) / 30.0f) * 0.5f + 0.5f;
-				factor = (factor < 0.0f) ? 0.0f : (factor > 1.0f ? 1.0f : factor);
-
-				float r = (1.0f - factor) * 0.0f + factor * 0.4f;
-				float g = (1.0f - factor) * 0.5f + factor * 1.0f;
-				float b = (1.0f - factor) * 0.6f + factor * 0.3f;
-
-				int index = (z * textureHeight * textureWidth + y * textureWidth + x) * 4;
-				textureData[index] = r;
-				textureData[index + 1] = g;
-				textureData[index + 2] = b;
-				textureData[index + 3] = finalAlpha;
-			}
+	// Edits keep every mip level current, so the editable texture carries the full chain.
+	auto gradientStart = std::chrono::steady_clock::now();
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(1);
+	if (editor != nullptr)
+	{
+		editor->Rebuild();
+		const VolumeMipChain& mips = editor->GetMipChain();
+		textureDesc.MipLevels = mips.GetLevelCount();
+		initialData.resize(mips.GetLevelCount());
+		for (uint32 level = 0; level < mips.GetLevelCount(); ++level)
+		{
+			const VolumeData& data = mips.GetLevel(level);
+			initialData[level].pSysMem = data.voxels.data();
+			initialData[level].SysMemPitch = data.width * 4 * sizeof(float);
+			initialData[level].SysMemSlicePitch = data.width * data.height * 4 * sizeof(float);
 		}
 	}
-
-	D3D11_SUBRESOURCE_DATA initialData = {};
-	initialData.pSysMem = textureData.data();
-	initialData.SysMemPitch = textureWidth * 4 * sizeof(float);
-	initialData.SysMemSlicePitch = textureWidth * textureHeight * 4 * sizeof(float);
+	else
+	{
+		initialData[0].pSysMem = volume.voxels.data();
+		initialData[0].SysMemPitch = textureWidth * 4 * sizeof(float);
+		initialData[0].SysMemSlicePitch = textureWidth * textureHeight * 4 * sizeof(float);
+	}
 
 	DX::ThrowIfFailed(
-		m_deviceResources->GetD3DDevice()->CreateTexture3D(&textureDesc, &initialData, &m_volumeTexture)
+		m_deviceResources->GetD3DDevice()->CreateTexture3D(&textureDesc, initialData.data(), &m_volumeTexture)
 	);
 
+	// The editor's Rebuild above made the gradients and distance field along with the mip chain, and counts
+	// toward the gradient time. Without an editor they are built when a feature first needs them.
+	m_gradientBuildMilliseconds = (editor != nullptr) ? std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gradientStart).count() : 0.0;
+	m_distanceFieldBuildMilliseconds = 0.0;
+	m_volumeEditor = std::move(editor);
+
+	// Whatever belonged to the previous volume is stale; features already on rebuild it now, from the voxels
+	// still in memory, instead of regenerating them on the next frame.
+	m_gradientTexture.Reset();
+	m_gradientTextureView.Reset();
+	m_distanceFieldTexture.Reset();
+	m_distanceFieldView.Reset();
+	m_isosurfaceExtractor.reset();
+	m_isosurfaceMeshValid = false;
+	CreateDerivedVolumes(volume);
+	m_loadArenaStats = arena.GetStats();
+
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = textureDesc.Format;
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE3D;
 	srvDesc.Texture3D.MostDetailedMip = 0;
-	srvDesc.Texture3D.MipLevels = 1;
+	srvDesc.Texture3D.MipLevels = textureDesc.MipLevels;
 
 	DX::ThrowIfFailed(
 		m_deviceResources->GetD3DDevice()->CreateShaderResourceView(m_volumeTexture.Get(), &srvDesc, &m_volumeTextureView)
@@ -525,6 +2371,108 @@ void Sample3DSceneRenderer::CreateVolumetricTexture()
 	);
 }
 
+// Builds the gradient volume, distance field and isosurface density copy for the features that are on and do
+// not have theirs yet, so a load only pays for the ones in use. The editor's copies are uploaded as they are.
+void Sample3DSceneRenderer::CreateDerivedVolumes(const VolumeData& volume)
+{
+	bool gradients = m_gradientLightingEnabled && m_gradientTexture == nullptr;
+	bool distances = m_emptySpaceSkippingEnabled && m_distanceFieldTexture == nullptr;
+	bool isosurface = m_isosurfaceEnabled && m_isosurfaceExtractor == nullptr;
+	auto device = m_deviceResources->GetD3DDevice();
+
+	// Editable textures take box updates, so they cannot be immutable.
+	D3D11_USAGE derivedUsage = (m_volumeEditor != nullptr) ? D3D11_USAGE_DEFAULT : D3D11_USAGE_IMMUTABLE;
+
+	// Sobel normals of the density for gradient lighting.
+	if (gradients)
+	{
+		auto gradientStart = std::chrono::steady_clock::now();
+		std::vector<uint32_t> builtGradients;
+		if (m_volumeEditor == nullptr)
+		{
+			BuildGradientVolume(volume.voxels.data() + 3, 4, volume.width, volume.height, volume.depth, GradientBuildSettings(), builtGradients);
+			m_gradientBuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gradientStart).count();
+		}
+		const std::vector<uint32_t>& gradientTexels = (m_volumeEditor != nullptr) ? m_volumeEditor->GetGradients() : builtGradients;
+
+		CD3D11_TEXTURE3D_DESC gradientDesc(DXGI_FORMAT_R8G8B8A8_UNORM, volume.width, volume.height, volume.depth, 1, D3D11_BIND_SHADER_RESOURCE, derivedUsage);
+		D3D11_SUBRESOURCE_DATA gradientData = {};
+		gradientData.pSysMem = gradientTexels.data();
+		gradientData.SysMemPitch = volume.width * sizeof(uint32_t);
+		gradientData.SysMemSlicePitch = volume.width * volume.height * sizeof(uint32_t);
+		DX::ThrowIfFailed(device->CreateTexture3D(&gradientDesc, &gradientData, &m_gradientTexture));
+		DX::ThrowIfFailed(device->CreateShaderResourceView(m_gradientTexture.Get(), nullptr, &m_gradientTextureView));
+	}
+
+	// Empty space distances for sphere tracing; one cell spans 1 / cells of the unit box along each axis, and the
+	// shortest of those keeps the jump conservative for non-cubic grids.
+	if (distances)
+	{
+		auto distanceStart = std::chrono::steady_clock::now();
+		DistanceField builtField;
+		if (m_volumeEditor == nullptr)
+		{
+			BuildDistanceField(volume, DistanceFieldSettings(), builtField);
+			m_distanceFieldBuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - distanceStart).count();
+		}
+		const DistanceField& field = (m_volumeEditor != nullptr) ? m_volumeEditor->GetDistanceField() : builtField;
+
+		CD3D11_TEXTURE3D_DESC distanceDesc(DXGI_FORMAT_R32_FLOAT, field.width, field.height, field.depth, 1, D3D11_BIND_SHADER_RESOURCE, derivedUsage);
+		D3D11_SUBRESOURCE_DATA distanceData = {};
+		distanceData.pSysMem = field.distance.data();
+		distanceData.SysMemPitch = field.width * sizeof(float);
+		distanceData.SysMemSlicePitch = field.width * field.height * sizeof(float);
+		DX::ThrowIfFailed(device->CreateTexture3D(&distanceDesc, &distanceData, &m_distanceFieldTexture));
+		DX::ThrowIfFailed(device->CreateShaderResourceView(m_distanceFieldTexture.Get(), nullptr, &m_distanceFieldView));
+
+		uint32 largestAxis = std::max(std::max(field.width, field.height), field.depth);
+		m_distanceFieldParams = XMFLOAT4(
+			static_cast<float>(field.width),
+			static_cast<float>(field.height),
+			static_cast<float>(field.depth),
+			1.0f / static_cast<float>(largestAxis)
+		);
+	}
+
+	// The voxels are usually gone after loading, so the extractor keeps its own copy of the density.
+	if (isosurface)
+	{
+		std::unique_ptr<IsosurfaceExtractor> extractor(new IsosurfaceExtractor());
+		extractor->SetVolume(volume.voxels.data() + 3, 4, volume.width, volume.height, volume.depth);
+		m_isosurfaceExtractor = std::move(extractor);
+		m_isosurfaceMeshValid = false;
+	}
+}
+
+// Catches features switched on after loading. The generated volume is not kept once uploaded, so it is
+// generated again here, once, for whatever is missing.
+void Sample3DSceneRenderer::UpdateDerivedVolumes()
+{
+	bool missing = (m_gradientLightingEnabled && m_gradientTexture == nullptr) ||
+		(m_emptySpaceSkippingEnabled && m_distanceFieldTexture == nullptr) ||
+		(m_isosurfaceEnabled && m_isosurfaceExtractor == nullptr);
+	if (!missing || m_volumeFormat != VolumeFormat::Rgba)
+	{
+		return;
+	}
+
+	if (m_volumeEditor != nullptr)
+	{
+		CreateDerivedVolumes(m_volumeEditor->GetVolume());
+	}
+	else if (m_sourceVolume != nullptr)
+	{
+		CreateDerivedVolumes(*m_sourceVolume);
+	}
+	else
+	{
+		LinearArena arena(LinearArena::DefaultBlockSize, true);
+		VolumeData generated(&arena);
+		GenerateFogSphereVolume(generated, GeneratedVolumeSize);
+		CreateDerivedVolumes(generated);
+	}
+}
+
 void Sample3DSceneRenderer::ReleaseDeviceDependentResources()
 {
 	m_loadingComplete = false;
@@ -536,4 +2484,43 @@ void Sample3DSceneRenderer::ReleaseDeviceDependentResources()
 	m_indexBuffer.Reset();
 	m_rasterState.Reset();
 	m_blendState.Reset();
+	m_fullscreenVertexShader.Reset();
+	m_upsamplePixelShader.Reset();
+	m_temporalResolvePixelShader.Reset();
+	m_interleaveReconstructPixelShader.Reset();
+	m_compositePixelShader.Reset();
+	m_importancePixelShader.Reset();
+	m_raymarchShaders.clear();
+	m_activeRaymarchShader.Reset();
+	m_activeRaymarchRequest = UINT32_MAX;
+	m_transferFunctionTexture.Reset();
+	m_transferFunctionView.Reset();
+	m_channelVolumeTexture.Reset();
+	m_channelVolumeView.Reset();
+	m_channelTransferTexture.Reset();
+	m_channelTransferView.Reset();
+	m_gradientTexture.Reset();
+	m_gradientTextureView.Reset();
+	m_distanceFieldTexture.Reset();
+	m_distanceFieldView.Reset();
+	m_brickPoolTexture.Reset();
+	m_brickPoolView.Reset();
+	m_pageTableTexture.Reset();
+	m_pageTableView.Reset();
+	m_coarseVolumeTexture.Reset();
+	m_coarseVolumeView.Reset();
+	m_isosurfaceVertexShader.Reset();
+	m_isosurfacePixelShader.Reset();
+	m_isosurfaceVertexBuffer.Reset();
+	m_isosurfaceIndexBuffer.Reset();
+	m_depthDisabledState.Reset();
+	m_isosurfaceIndexCount = 0;
+	m_isosurfaceMeshValid = false;
+	m_stereoVertexShader.Reset();
+	m_stereoGeometryShader.Reset();
+	m_stereoCompositePixelShader.Reset();
+	m_occlusionDepthPixelShader.Reset();
+	ReleaseOcclusionTargets();
+	m_occlusionBuffer.Clear();
+	ReleaseVolumeTargets();
 }
@@ -2,11 +2,50 @@
 
 #include "..\Common\DeviceResources.h"
 #include "ShaderStructures.h"
+#include "VolumeCulling.h"
+#include "ImportanceMap.h"
+#include "ShaderPermutations.h"
+#include "LinearArena.h"
+#include "OutOfCoreVolume.h"
+#include "DistanceField.h"
+#include "GradientVolume.h"
+#include "Isosurface.h"
+#include "VolumeEditing.h"
+#include "RayClip.h"
+#include "ChannelVolume.h"
+#include "StereoCamera.h"
+#include "RenderBackend.h"
+#include <unordered_map>
 #include "..\Common\StepTimer.h"
 
 using namespace DirectX;
 namespace VolumeShaderTest
 {
+	// Startup cost of getting every shader and pipeline state ready.
+	struct ShaderLoadStats
+	{
+		bool fromArchive;			// False on the first launch after the compiled shaders change, which builds the archive.
+		uint32 shaderCount;
+		uint64 archiveBytes;
+		double readMilliseconds;	// From the start of loading until every blob was in memory.
+		double createMilliseconds;	// Parallel creation of shaders, input layout, constant buffer and states.
+	};
+
+	// Residency of an out-of-core volume's chunks in the GPU brick pool.
+	struct BrickPoolStats
+	{
+		uint32 slots;
+		uint32 resident;
+		uint32 visibleChunks;		// Chunks that survived culling this frame.
+		uint32 missingChunks;		// Visible chunks not resident yet; they render from the coarse level.
+		uint32 coarseChunks;		// Missing chunks the coarse level already holds; the rest render as empty space.
+		uint32 uploads;				// Chunks copied into the pool this frame.
+		uint32 evictions;			// Resident chunks replaced this frame.
+		uint32 coarseFactor;		// Volume voxels per coarse voxel along each axis.
+		uint64 poolBytes;
+		uint64 coarseBytes;
+	};
+
 	// This sample renderer instantiates a basic rendering pipeline.
 	class Sample3DSceneRenderer
 	{
@@ -22,12 +61,163 @@ namespace VolumeShaderTest
 		void TrackingUpdate(float positionX);
 		void StopTracking();
 		bool IsTracking() { return m_tracking; }
+		bool IsLoadingComplete() const { return m_loadingComplete; }
+		CullingStats GetCullingStats() const { return m_cullingStats; }
+		HiZOcclusionBuffer& GetOcclusionBuffer() { return m_occlusionBuffer; }
+		ShaderLoadStats GetShaderLoadStats() const { return m_shaderLoadStats; }
+		// Peak bytes, allocation count and huge page use of the arena that held the generated volume.
+		ArenaStats GetLoadArenaStats() const { return m_loadArenaStats; }
+
+		// Marches the volume at 1/scale of the output resolution (1, 2 or 4) and upsamples into the back buffer.
+		void SetResolutionScale(uint32 scale);
+		uint32 GetResolutionScale() const { return m_resolutionScale; }
+
+		// Marches stepsPerFrame steps with a per-frame jitter and converges by blending with the reprojected history.
+		void SetTemporalAccumulation(bool enabled, uint32 stepsPerFrame);
+		bool IsTemporalAccumulationEnabled() const { return m_temporalEnabled; }
+
+		// Marches one pixel of every patternSize x patternSize block per frame (0 or 1 = off, 2 or 4) and
+		// reconstructs the rest from previous frames. Takes precedence over the resolution scale and temporal modes.
+		void SetInterleavedMarching(uint32 patternSize);
+		uint32 GetInterleavePatternSize() const { return m_interleavePatternSize; }
+
+		// Classifies screen tiles of the previous volume pass and marches each with a fraction of the steps.
+		void SetImportanceSampling(bool enabled, const ImportanceSettings& settings);
+		bool IsImportanceSamplingEnabled() const { return m_importanceEnabled; }
+
+		// Options that pick a compile-time specialized raymarch shader from ShaderPermutationManifest.h.
+		void SetShadowsEnabled(bool enabled) { m_shadowsEnabled = enabled; }
+		void SetEarlyOutThreshold(uint32 percent) { m_earlyOutPercent = (percent < 100) ? percent : 100; }
+		// Maps density to color and opacity through the table; an empty table turns the lookup off.
+		void SetTransferFunction(const std::vector<XMFLOAT4>& table);
+		RaymarchPermutationKey GetActiveRaymarchPermutation() const { return m_activeRaymarchKey; }
+
+		// Replaces alpha compositing with a projection of the density along each ray (maximum, minimum or average)
+		// or with a lit surface at the first sample reaching firstHitThreshold. These modes take no shadow taps and
+		// do not use the gradient volume; the first-hit surface shares the isosurface's ambient term.
+		void SetCompositeMode(CompositeMode mode, float firstHitThreshold = 0.5f);
+		CompositeMode GetCompositeMode() const { return m_compositeMode; }
+
+		// Whether the current volume, transfer function and frame modes leave a raymarch permutation for these
+		// options, so that they render as asked. Empty space skipping only applies to RGBA volumes.
+		bool SupportsRaymarchOptions(bool shadows, bool emptySpaceSkipping, CompositeMode composite) const;
+
+		// Renders a chunk store instead of the generated volume, streaming the chunks that survive culling into a
+		// brick pool sized to poolBytes of GPU memory. Part of the budget holds a coarse copy of every chunk loaded
+		// so far, which chunks the pool cannot hold fall back to. Pass nullptr to go back to the generated volume.
+		static const uint64 DefaultBrickPoolBytes = 256ull * 1024 * 1024;
+		void SetOutOfCoreVolume(const std::shared_ptr<OutOfCoreVolume>& volume, uint64 poolBytes = DefaultBrickPoolBytes);
+		BrickPoolStats GetBrickPoolStats() const { return m_brickPoolStats; }
+
+		// Renders 2 to 4 co-registered scalar channels instead of the generated volume, quantized through one
+		// window per channel and packed into a single texture so each sample is one fetch. Every channel is
+		// colored by its own transfer function and the results are mixed by weight in the same march. Every
+		// compositing mode has channel variants. Pass nullptr to go back to the generated volume.
+		void SetChannelVolume(const std::shared_ptr<const ChannelVolume>& volume, const std::vector<ChannelWindow>& windows);
+		// Replaces the transfer function of one channel, resampled to 256 entries; an empty table keeps the current one.
+		void SetChannelTransferFunction(uint32 channel, const std::vector<XMFLOAT4>& table, float weight = 1.0f);
+
+		// Lights the generated volume with normals from a gradient volume, built the first time lighting is enabled.
+		// Shading fades from unlit to ambient + diffuse as the stored gradient magnitude times magnitudeGain goes
+		// from 0 to 1. The build time reads 0 until then.
+		void SetGradientLighting(bool enabled, float ambient = 0.3f, float magnitudeGain = 8.0f);
+		double GetGradientBuildMilliseconds() const { return m_gradientBuildMilliseconds; }
+
+		// Lets the march jump through empty space using a distance field over 4^3 voxel cells, built the first time
+		// skipping is enabled. Has no effect on out-of-core volumes.
+		void SetEmptySpaceSkipping(bool enabled) { m_emptySpaceSkippingEnabled = enabled; }
+		double GetDistanceFieldBuildMilliseconds() const { return m_distanceFieldBuildMilliseconds; }
+
+		// Draws an opaque surface where the generated volume's density crosses threshold, with the fog composited
+		// over it. The extractor's density copy is made the first time the surface is enabled and the mesh is
+		// extracted before the next frame; threshold changes only rebuild the bricks the old or new surface passes
+		// through.
+		void SetIsosurface(bool enabled, float threshold, const XMFLOAT3& albedo = XMFLOAT3(0.9f, 0.85f, 0.75f));
+		IsosurfaceStats GetIsosurfaceStats() const;
+
+		// Ends every ray at the opaque depth already in the bound depth buffer (the isosurface, or anything the
+		// app drew before Render), so no sample behind geometry is taken. On by default.
+		void SetSceneDepthClipping(bool enabled) { m_sceneDepthClipping = enabled; }
+
+		// Cuts the volume down to a region of interest in its local space, where the box spans [-0.5, 0.5]. Each
+		// ray is clipped analytically before marching, so cut away space takes no samples; shadows and the
+		// isosurface are cut the same way. At most MaxClipPlanes planes are kept, and an empty list removes them.
+		void SetClipPlanes(const std::vector<XMFLOAT4>& planes);
+		void SetCropBox(const XMFLOAT3& center, const XMFLOAT3& halfExtents, const XMFLOAT4& orientation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+		void ClearCropBox();
+		const ClipRegion& GetClipRegion() const { return m_clipRegion; }
 
+		// Keeps an editable CPU copy of the generated volume with its mip chain, gradients and distance field, and
+		// recreates the textures to match (switching after loading regenerates the volume). Brush dabs change the
+		// CPU copy at once; the next frame uploads only the coalesced boxes they touched. Out-of-core volumes are
+		// not editable.
+		void SetVolumeEditing(bool enabled);
+		bool IsVolumeEditingEnabled() const { return m_volumeEditingEnabled; }
+		VoxelRegion ApplyBrush(const VolumeBrush& brush);
+		VolumeUploadStats GetVolumeUploadStats() const { return m_volumeUploadStats; }
+
+		// Dabs between BeginBrushStroke and EndBrushStroke undo as one step; any other dab is a step by itself.
+		// Undo and redo copy back only the bricks the step touched and upload them like an edit.
+		void BeginBrushStroke();
+		void EndBrushStroke();
+		bool UndoVolumeEdit();
+		bool RedoVolumeEdit();
+		EditJournalStats GetEditJournalStats() const;
+
+		// Renders both eyes of a stereo rig in one instanced pass into a two slice target array and places them side
+		// by side in the back buffer, left eye on the left. The eyes share one constant buffer update, every texture
+		// binding and one culling pass over a frustum around both. Offscreen marching modes, the isosurface and scene
+		// depth clipping are mono only and are skipped while it is on.
+		void SetStereo(bool enabled, const StereoRig& rig = StereoRig());
+		bool IsStereoEnabled() const { return m_stereoEnabled; }
+		const StereoView& GetStereoView() const { return m_stereoView; }
+
+		// Places the camera, light and volume for one frame of a scripted path; call in place of Update. Stereo
+		// eyes keep the default camera.
+		void SetCameraPose(const CameraPose& pose);
+
+		// Renders the given RGBA volume at its own size in place of the generated fog sphere; null goes back to the
+		// fog sphere. The renderer keeps a reference for rebuilding its textures after a lost device.
+		void SetVolume(const std::shared_ptr<const VolumeData>& volume);
+
+		// Bytes of volume texels, bricks and page table entries copied to the GPU since creation.
+		uint64 GetUploadedBytes() const { return m_uploadedBytes; }
 
 	private:
 		void Rotate(float radians);
+		void CullBricks();
+		void CaptureOcclusionDepth();
+		void ReadOcclusionDepth();
+		void ReleaseOcclusionTargets();
+		void CreateVolumeTargets(uint32 scale, bool interleaved);
+		void ReleaseVolumeTargets();
+		void RenderVolumePass(bool blend);
+		void RenderImportanceMap();
+		RaymarchPermutationKey MakeFrameRaymarchRequest(bool shadows, bool dynamicSteps, CompositeMode composite) const;
+		bool SelectRaymarchShader(bool dynamicSteps);
+		ID3D11ShaderResourceView* ResolveTemporal();
+		ID3D11ShaderResourceView* ReconstructInterleaved();
+		void CompositeVolume(ID3D11ShaderResourceView* volumeColor, bool upsample);
+		void CreateStereoTargets();
+		void CompositeStereo();
+		void CreateBrickPool();
+		void StreamOutOfCoreChunks();
+		bool UploadChunk(uint32 chunk, const ChunkData& voxels);
+		void UploadCoarseChunk(uint32 chunk, const ChunkData& voxels);
+		void UpdateIsosurfaceMesh();
+		void RenderIsosurface();
+		void UploadVolumeEdits();
+		void CreateTransferFunction();
+		void CreateChannelVolumeTexture();
+		void CreateChannelTransferFunctions();
+		void RefreshEditedIsosurface(const VoxelRegion& region);
+		void CreateDerivedVolumes(const VolumeData& volume);
+		void UpdateDerivedVolumes();
 
 	private:
+		// Edge length of the fog sphere generated when no volume is supplied.
+		static const uint32 GeneratedVolumeSize = 256;
+
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
@@ -41,11 +231,120 @@ namespace VolumeShaderTest
 		Microsoft::WRL::ComPtr<ID3D11Buffer>		m_constantBuffer;
 		Microsoft::WRL::ComPtr<ID3D11Texture3D>		m_volumeTexture;
 		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>		m_volumeTextureView;
+		Microsoft::WRL::ComPtr<ID3D11Texture3D>		m_gradientTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>		m_gradientTextureView;
+		Microsoft::WRL::ComPtr<ID3D11Texture3D>		m_distanceFieldTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>		m_distanceFieldView;
+		XMFLOAT4	m_distanceFieldParams;
 		Microsoft::WRL::ComPtr<ID3D11SamplerState>		m_samplerState;
 		Microsoft::WRL::ComPtr<ID3D11BlendState>		m_blendState;
 		Microsoft::WRL::ComPtr<ID3D11DepthStencilState>		m_depthStencilState;
 		Microsoft::WRL::ComPtr<ID3D11RasterizerState>		m_rasterState;
 
+		// Reduced resolution volume pass and its depth-aware upsample.
+		Microsoft::WRL::ComPtr<ID3D11VertexShader>			m_fullscreenVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_upsamplePixelShader;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>				m_volumeColorTarget;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>		m_volumeColorTargetView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_volumeColorResourceView;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>				m_volumeDepthTarget;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>		m_volumeDepthTargetView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_volumeDepthResourceView;
+		D3D11_VIEWPORT										m_volumeViewport;
+
+		// Ping-ponged history for temporal accumulation.
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_temporalResolvePixelShader;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>				m_historyTargets[2];
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>		m_historyTargetViews[2];
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_historyResourceViews[2];
+
+		// Interleaved marching reconstructs into the history at full resolution.
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_interleaveReconstructPixelShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_compositePixelShader;
+
+		// Per-tile step budgets built from the previous volume pass.
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_importancePixelShader;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>				m_importanceTarget;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>		m_importanceTargetView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_importanceResourceView;
+		D3D11_VIEWPORT										m_importanceViewport;
+		ImportanceSettings									m_importanceSettings;
+
+		// Raymarch permutations keyed by RaymarchPermutationKey::Pack(), and the one selected for this frame.
+		std::unordered_map<uint32, Microsoft::WRL::ComPtr<ID3D11PixelShader>>	m_raymarchShaders;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_activeRaymarchShader;
+		RaymarchPermutationKey								m_activeRaymarchKey;
+		uint32												m_activeRaymarchRequest;
+		std::vector<XMFLOAT4>								m_transferFunctionTable;	// Kept to recreate the texture after a lost device.
+		Microsoft::WRL::ComPtr<ID3D11Texture1D>				m_transferFunctionTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_transferFunctionView;
+
+		// Out-of-core streaming.
+		std::shared_ptr<OutOfCoreVolume>					m_outOfCoreVolume;
+		Microsoft::WRL::ComPtr<ID3D11Texture3D>				m_brickPoolTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_brickPoolView;
+		Microsoft::WRL::ComPtr<ID3D11Texture3D>				m_pageTableTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_pageTableView;
+		Microsoft::WRL::ComPtr<ID3D11Texture3D>				m_coarseVolumeTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_coarseVolumeView;
+		uint64												m_brickPoolBudget;
+		BrickPoolLayout										m_brickPoolLayout;
+		std::vector<uint8_t>								m_chunkCoarse;		// 1 once a chunk's coarse block is uploaded.
+		std::vector<uint16_t>								m_coarseScratch;
+		std::vector<VolumeBrickBounds>						m_chunkBounds;
+		std::vector<uint8_t>								m_chunkVisibility;
+		std::vector<uint16_t>								m_chunkSlots;		// Pool slot + 1 per chunk, mirrors the page table.
+		std::vector<uint32>									m_slotChunks;		// Chunk per pool slot, UINT32_MAX when free.
+		std::vector<uint32>									m_slotLastVisible;	// Frame each slot's chunk was last visible.
+		std::vector<uint32>									m_pendingUploads;	// Loaded chunks waiting for the per-frame upload limit.
+		uint32												m_brickPoolSlots[3];
+		uint32												m_streamFrame;
+		BrickPoolStats										m_brickPoolStats;
+
+		// Multi-channel volume and one transfer function row per channel.
+		std::shared_ptr<const ChannelVolume>				m_channelVolume;
+		std::vector<ChannelWindow>							m_channelWindows;	// One per channel; with the volume, enough to re-pack after a lost device.
+		Microsoft::WRL::ComPtr<ID3D11Texture3D>				m_channelVolumeTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_channelVolumeView;
+		Microsoft::WRL::ComPtr<ID3D11Texture1D>				m_channelTransferTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_channelTransferView;
+		std::vector<XMFLOAT4>								m_channelTables[MaxVolumeChannels];
+
+		// Isosurface mesh drawn before the volume pass.
+		std::unique_ptr<IsosurfaceExtractor>				m_isosurfaceExtractor;
+		Microsoft::WRL::ComPtr<ID3D11VertexShader>			m_isosurfaceVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_isosurfacePixelShader;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>				m_isosurfaceVertexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer>				m_isosurfaceIndexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilState>		m_depthDisabledState;
+		uint32												m_isosurfaceIndexCount;
+		float												m_isosurfaceThreshold;
+		bool												m_isosurfaceEnabled;
+		bool												m_isosurfaceMeshValid;
+		bool												m_sceneDepthClipping;
+
+		// Editable copy of the generated volume, present while editing is enabled.
+		std::unique_ptr<VolumeEditor>						m_volumeEditor;
+		std::shared_ptr<const VolumeData>					m_sourceVolume;
+		VolumeUploadStats									m_volumeUploadStats;
+		bool												m_volumeEditingEnabled;
+		uint64												m_uploadedBytes;
+
+		// Multi-view rendering, one target slice per eye, each half the back buffer wide.
+		Microsoft::WRL::ComPtr<ID3D11VertexShader>			m_stereoVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11GeometryShader>		m_stereoGeometryShader;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_stereoCompositePixelShader;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>				m_stereoTarget;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>		m_stereoTargetView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_stereoResourceView;
+		D3D11_VIEWPORT										m_stereoViewport;
+		StereoRig											m_stereoRig;
+		StereoView											m_stereoView;
+		bool												m_stereoEnabled;
+
+		// Region of interest, also stored in the constant buffer.
+		ClipRegion											m_clipRegion;
+
 		// System resources for cube geometry.
 		ModelViewProjectionConstantBuffer	m_constantBufferData;
 		XMMATRIX	m_projectionMatrix;
@@ -56,10 +355,50 @@ namespace VolumeShaderTest
 		uint32	m_indexCount;
 		uint32	m_vertexCount;
 
+		// Brick bounds in local space and the results of the per-frame culling pass.
+		VolumeCuller						m_volumeCuller;
+		HiZOcclusionBuffer					m_occlusionBuffer;
+
+		// Opaque depth reduced to the finest occlusion level on the GPU and read back without stalling: a copy is
+		// mapped once the GPU has finished it, usually one or two frames later.
+		static const uint32 OcclusionReadbackCount = 3;
+		Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_occlusionDepthPixelShader;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>				m_occlusionDepthTarget;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>		m_occlusionDepthTargetView;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>				m_occlusionReadback[OcclusionReadbackCount];
+		XMFLOAT4X4											m_occlusionReadbackMatrix[OcclusionReadbackCount];
+		uint32												m_occlusionReadbackNext;		// Copy written next.
+		uint32												m_occlusionReadbackPending;	// Copies the GPU may still be writing.
+		std::vector<float>									m_occlusionDepth;
+		std::vector<VolumeBrickBounds>		m_brickBounds;
+		std::vector<uint8_t>				m_brickVisibility;
+		CullingStats						m_cullingStats;
+		ShaderLoadStats						m_shaderLoadStats;
+		ArenaStats							m_loadArenaStats;
+
 		// Variables used with the rendering loop.
 		bool	m_loadingComplete;
 		float	m_degreesPerSecond;
 		bool	m_tracking;
+		uint32	m_resolutionScale;
+		uint32	m_volumeTargetScale;
+		bool	m_temporalEnabled;
+		bool	m_historyValid;
+		uint32	m_historyIndex;
+		uint32	m_temporalStepsPerFrame;
+		uint32	m_frameIndex;
+		uint32	m_interleavePatternSize;
+		bool	m_volumeTargetsInterleaved;
+		bool	m_importanceEnabled;
+		bool	m_importanceValid;
+		bool	m_shadowsEnabled;
+		bool	m_gradientLightingEnabled;
+		double	m_gradientBuildMilliseconds;
+		bool	m_emptySpaceSkippingEnabled;
+		double	m_distanceFieldBuildMilliseconds;
+		uint32	m_earlyOutPercent;
+		VolumeFormat	m_volumeFormat;
+		CompositeMode	m_compositeMode;
 	};
 }
 
@@ -1,23 +1,66 @@
-Texture3D<float4> voxelTexture : register(t0);
+// Permutation defines, set by the wrappers in Permutations\ from ShaderPermutationManifest.h.
+// Compiled on its own this file is the general variant the renderer falls back to.
+#ifndef RAYMARCH_SHADOWS
+#define RAYMARCH_SHADOWS 1              // 3-tap self shadowing
+#endif
+#ifndef RAYMARCH_STEPS
+#define RAYMARCH_STEPS 0                // 0: read from temporalParams.z and the importance map
+#endif
+#ifndef RAYMARCH_FORMAT
+#define RAYMARCH_FORMAT 0               // 0: RGBA color and density, 1: single channel density, 2: paged density bricks,
+                                        // 3: two to four channels, each with its own transfer function
+#endif
+#ifndef RAYMARCH_TRANSFER_FUNCTION
+#define RAYMARCH_TRANSFER_FUNCTION 0    // Color and opacity from a 1D lookup of the density
+#endif
+#ifndef RAYMARCH_EARLY_OUT
+#define RAYMARCH_EARLY_OUT 99           // Percent opacity that ends the march, 100 = never
+#endif
+#ifndef RAYMARCH_GRADIENTS
+#define RAYMARCH_GRADIENTS 0            // Diffuse lighting from the precomputed gradient volume
+#endif
+#ifndef RAYMARCH_COMPOSITE
+#define RAYMARCH_COMPOSITE 0            // CompositeMode: 0 alpha, 1 maximum, 2 minimum, 3 average intensity, 4 first hit
+#endif
+
+#if RAYMARCH_FORMAT == 1 || RAYMARCH_FORMAT == 2
+Texture3D<float> voxelTexture : register(t0);   // Format 2: the brick pool, one padded chunk per slot
+#else
+Texture3D<float4> voxelTexture : register(t0);  // Format 3: up to four unorm channels
+#endif
+Texture2D<float> stepBudget : register(t1);
+Texture1D<float4> transferFunction : register(t2);
+#if RAYMARCH_FORMAT == 2
+Texture3D<uint> pageTable : register(t3);        // Brick pool slot + 1 per chunk, 0 = not resident
+#endif
+#if RAYMARCH_GRADIENTS
+Texture3D<float4> gradientTexture : register(t4); // rg: octahedral normal, b: gradient magnitude
+#endif
+Texture3D<float> distanceField : register(t5);   // Empty space distance per cell, see DistanceField.h
+Texture2D<float> sceneDepth : register(t6);       // Full resolution hardware depth of the opaque scene
+#if RAYMARCH_FORMAT == 3
+Texture1DArray<float4> channelTransferFunctions : register(t7); // One row per channel
+#endif
+#if RAYMARCH_FORMAT == 2
+Texture3D<float> coarseVolume : register(t8);    // Whole volume at a coarse factor, for chunks missing from the pool
+#endif
 SamplerState voxelSampler : register(s0);
 
-cbuffer ConstantBuffer : register(b0)
-{
-    float4x4 worldMatrix;
-    float4x4 viewMatrix;
-    float4x4 projectionMatrix;
-    float4x4 worldviewprojection;
-    float4x4 invworldviewprojection;
-    float4x4 invWorldMatrix;
-    float4 cameraPosition;
-    float4 lightPosition;
-};
+#include "ConstantBuffer.hlsli"
+#include "RayClip.hlsli"
 
 struct PixelShaderInput
 {
     float4 position : SV_POSITION;
     float3 texCoord : TEXCOORD0;
     float3 localPos : TEXCOORD1;
+    nointerpolation uint viewIndex : TEXCOORD2;
+};
+
+struct PixelShaderOutput
+{
+    float4 color : SV_Target0;
+    float2 rayDepth : SV_Target1; // x: entry depth (upsample guide), y: opacity-weighted depth (reprojection); ignored when no second target is bound.
 };
 
 float IGN(float2 uv)
@@ -41,10 +84,225 @@ float2 IntersectBox(float3 ro, float3 rd, float3 boxMin, float3 boxMax)
     return float2(tNear, tFar);
 }
 
-float4 main(PixelShaderInput input) : SV_Target
+// Inverse of PackGradient in GradientVolume.cpp.
+float3 DecodeOctahedral(float2 encoded)
+{
+    float2 f = encoded * 2.0f - 1.0f;
+    float3 n = float3(f, 1.0f - abs(f.x) - abs(f.y));
+    if (n.z < 0.0f)
+        n.xy = (1.0f - abs(n.yx)) * float2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    return normalize(n);
+}
+
+// Distance along the local ray to the opaque surface behind a full resolution pixel, mirrored by
+// ReferenceRaymarcher::SceneDistance. Pixels at the far plane have nothing in front of the volume.
+float SceneDistance(float2 fullPixel, float3 rayOrigin, float3 rayDir)
+{
+    float depth = sceneDepth.Load(int3(min(int2(fullPixel), int2(renderTargetSize.xy) - 1), 0));
+    if (depth >= 1.0f)
+        return 3.402823e38f;
+
+    float2 ndc = float2(fullPixel.x / renderTargetSize.x * 2.0f - 1.0f, 1.0f - fullPixel.y / renderTargetSize.y * 2.0f);
+    float4 localPos = mul(float4(ndc, depth, 1.0f), invworldviewprojection);
+    return dot(localPos.xyz / localPos.w - rayOrigin, rayDir);
+}
+
+// Whole steps of empty space ahead of pos according to the distance field, 0 when skipping is off.
+int EmptySteps(float3 pos, float stepSize)
+{
+    if (distanceParams.w <= 0.0f)
+        return 0;
+
+    int3 cell = min(int3(saturate(pos + 0.5f) * distanceParams.xyz), int3(distanceParams.xyz) - 1);
+    return int(distanceField.Load(int4(cell, 0)) * distanceParams.w / stepSize);
+}
+
+#if RAYMARCH_FORMAT == 3
+// Every channel colored by its own transfer function and mixed by opacity times weight, mirrored by MixChannels() in
+// ChannelVolume.cpp. The opacities add up and saturate; the color is their weighted average.
+float4 MixChannels(float4 values)
+{
+    float3 color = float3(0.0f, 0.0f, 0.0f);
+    float alpha = 0.0f;
+    int channelCount = int(channelParams.x);
+    for (int c = 0; c < channelCount; c++)
+    {
+        float4 channel = channelTransferFunctions.SampleLevel(voxelSampler, float2(values[c], float(c)), 0);
+        float weighted = channel.a * channelWeights[c];
+        color += channel.rgb * weighted;
+        alpha += weighted;
+    }
+    return (alpha > 0.0f) ? float4(color / alpha, saturate(alpha)) : float4(0.0f, 0.0f, 0.0f, 0.0f);
+}
+#endif
+
+float SampleDensity(float3 uvw)
+{
+#if RAYMARCH_FORMAT == 3
+    // Shadows and the projection modes read the mixed opacity.
+    return MixChannels(voxelTexture.SampleLevel(voxelSampler, uvw, 0)).a;
+#elif RAYMARCH_FORMAT == 2
+    // Chunks the page table has not made resident read from the coarse level, which is empty space for chunks
+    // that have never been loaded.
+    float3 chunkPos = saturate(uvw) * outOfCoreParams.xyz;
+    uint3 chunk = min(uint3(chunkPos), uint3(ceil(outOfCoreParams.xyz)) - 1);
+    uint slot = pageTable.Load(int4(chunk, 0));
+    if (slot == 0)
+        return coarseVolume.SampleLevel(voxelSampler, saturate(uvw) * outOfCoreCoarse.xyz, 0);
+
+    slot -= 1;
+    uint3 poolSlots = uint3(outOfCorePool.xyz);
+    uint3 slotCoord = uint3(slot % poolSlots.x, (slot / poolSlots.x) % poolSlots.y, slot / (poolSlots.x * poolSlots.y));
+    float3 poolPos = slotCoord * outOfCorePool.w + 1.0f + (chunkPos - chunk) * outOfCoreParams.w;
+    return voxelTexture.SampleLevel(voxelSampler, poolPos / (poolSlots * outOfCorePool.w), 0);
+#elif RAYMARCH_FORMAT == 1
+    return voxelTexture.SampleLevel(voxelSampler, uvw, 0);
+#else
+    return voxelTexture.SampleLevel(voxelSampler, uvw, 0).a;
+#endif
+}
+
+float4 SampleVoxel(float3 uvw)
+{
+#if RAYMARCH_FORMAT == 3
+    return MixChannels(voxelTexture.SampleLevel(voxelSampler, uvw, 0));
+#elif RAYMARCH_TRANSFER_FUNCTION
+    return transferFunction.SampleLevel(voxelSampler, SampleDensity(uvw), 0);
+#elif RAYMARCH_FORMAT == 1 || RAYMARCH_FORMAT == 2
+    return float4(1.0f, 1.0f, 1.0f, SampleDensity(uvw));
+#else
+    return voxelTexture.SampleLevel(voxelSampler, uvw, 0);
+#endif
+}
+
+#if RAYMARCH_COMPOSITE != 0
+// Color of a projected density: through the transfer function when there is one, else white at that opacity.
+float4 ProjectedColor(float density)
+{
+#if RAYMARCH_TRANSFER_FUNCTION
+    float4 color = transferFunction.SampleLevel(voxelSampler, density, 0);
+    return float4(color.rgb * color.a, color.a);
+#else
+    return float4(density, density, density, density);
+#endif
+}
+
+// The non-alpha modes, mirrored by ProjectRay() in ReferenceRaymarcher.cpp. Walks the same steps as the alpha march
+// but reduces them to one density, or stops at the first sample reaching compositeParams.x. rayDepth.y is the depth
+// of the sample that decided the pixel.
+PixelShaderOutput ProjectRay(float3 ro, float3 rd, float tCurrent, float stepSize, int firstStep, int steps, float tStart, float tLimit, float jitter)
+{
+#if RAYMARCH_COMPOSITE == 2
+    float result = 1.0f;
+#else
+    float result = 0.0f;
+#endif
+    float resultDepth = tStart;
+    int count = 0;
+#if RAYMARCH_COMPOSITE == 4
+    bool hit = false;
+#endif
+
+    for (int i = firstStep; i < steps; i++)
+    {
+        if (tCurrent > tLimit)
+            break;
+
+        float3 currentPos = ro + rd * tCurrent;
+#if RAYMARCH_COMPOSITE == 1 || RAYMARCH_COMPOSITE == 4
+        // Skipped space holds nothing above the occupancy threshold, which can neither raise the maximum nor reach
+        // a useful isovalue. The minimum and the average need every sample.
+        int skip = EmptySteps(currentPos, stepSize);
+        if (skip > 0)
+        {
+            i += skip - 1;
+            tCurrent += float(skip) * stepSize;
+            continue;
+        }
+#endif
+
+        float density = SampleDensity(currentPos + 0.5f);
+        count++;
+#if RAYMARCH_COMPOSITE == 1
+        if (density > result)
+        {
+            result = density;
+            resultDepth = tCurrent;
+            if (result >= 1.0f)
+                break;
+        }
+#elif RAYMARCH_COMPOSITE == 2
+        if (density < result)
+        {
+            result = density;
+            resultDepth = tCurrent;
+            if (result <= 0.0f)
+                break;
+        }
+#elif RAYMARCH_COMPOSITE == 3
+        result += density;
+#else
+        if (density >= compositeParams.x)
+        {
+            hit = true;
+            break;
+        }
+#endif
+        tCurrent += stepSize;
+    }
+
+    PixelShaderOutput output;
+#if RAYMARCH_COMPOSITE == 4
+    output.color = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    if (hit)
+    {
+        // Bisect the crossing between the previous step and this one.
+        float tLow = max(tCurrent - stepSize, tStart);
+        float tHigh = tCurrent;
+        [unroll]
+        for (int j = 0; j < 4; j++)
+        {
+            float tMid = 0.5f * (tLow + tHigh);
+            if (SampleDensity(ro + rd * tMid + 0.5f) >= compositeParams.x)
+                tHigh = tMid;
+            else
+                tLow = tMid;
+        }
+        resultDepth = tHigh;
+
+        // Central differences one step wide; the normal faces away from the denser side.
+        float3 hitPos = ro + rd * tHigh;
+        float3 normal = float3(
+            SampleDensity(hitPos + float3(-stepSize, 0.0f, 0.0f) + 0.5f) - SampleDensity(hitPos + float3(stepSize, 0.0f, 0.0f) + 0.5f),
+            SampleDensity(hitPos + float3(0.0f, -stepSize, 0.0f) + 0.5f) - SampleDensity(hitPos + float3(0.0f, stepSize, 0.0f) + 0.5f),
+            SampleDensity(hitPos + float3(0.0f, 0.0f, -stepSize) + 0.5f) - SampleDensity(hitPos + float3(0.0f, 0.0f, stepSize) + 0.5f));
+        normal = (dot(normal, normal) > 0.0f) ? normalize(normal) : -rd;
+
+        float3 localLightPos = mul(float4(lightPosition.xyz, 1.0f), invWorldMatrix).xyz;
+        float diffuse = saturate(dot(normal, normalize(localLightPos - hitPos)));
+        output.color = float4(SampleVoxel(hitPos + 0.5f).rgb * (isosurfaceParams.w + (1.0f - isosurfaceParams.w) * diffuse), 1.0f);
+    }
+#else
+#if RAYMARCH_COMPOSITE == 3
+    result = (count > 0) ? result / float(count) : 0.0f;
+    resultDepth = 0.5f * (tStart + tLimit);
+#endif
+    output.color = (count > 0) ? ProjectedColor(result) : float4(0.0f, 0.0f, 0.0f, 0.0f);
+#endif
+
+    // Final Dither to hide banding
+    output.color.rgb += (jitter - 0.5f) / 255.0f;
+    output.rayDepth = float2(tStart, resultDepth);
+    return output;
+}
+#endif
+
+PixelShaderOutput main(PixelShaderInput input)
 {
     // 1. Ray Setup
-    float4 localCam = mul(float4(cameraPosition.xyz, 1.0f), invWorldMatrix);
+    // Multi-view passes march from the eye that drew the pixel.
+    float3 eyePosition = (stereoParams.x > 0.0f) ? eyePositions[input.viewIndex].xyz : cameraPosition.xyz;
+    float4 localCam = mul(float4(eyePosition, 1.0f), invWorldMatrix);
     float3 rayDir = normalize(input.localPos - localCam.xyz);
     
     // Define box bounds explicitly as float3 constructors
@@ -58,48 +316,142 @@ float4 main(PixelShaderInput input) : SV_Target
     if (tEntry > tExit)
         discard;
 
+    // Clipping narrows the span marched but not the one the steps divide, as with the scene depth below.
+    float2 clipped = ClipRay(localCam.xyz, rayDir, float2(tEntry, tExit));
+    if (clipped.x > clipped.y)
+        discard;
+
     // 2. Performance Tuning: 128 steps to stop the "chugging"
-    const int steps = 128;
+    // Temporal accumulation marches fewer steps and rotates the jitter every frame instead.
+#if RAYMARCH_STEPS > 0
+    // Fixed step variants let the compiler see the trip count.
+    const int steps = RAYMARCH_STEPS;
+#else
+    int baseSteps = (temporalParams.z > 0.0f) ? int(temporalParams.z) : 128;
+    int steps = baseSteps;
+
+    // The importance map trims the steps per tile; each step's opacity is raised to baseSteps / steps so
+    // fewer, longer steps still integrate to the same density.
+    float opacityExponent = 1.0f;
+    if (importanceParams.x > 0.0f)
+    {
+        float budget = stepBudget.Load(int3(int2(input.position.xy / importanceParams.x), 0));
+        steps = max(int(ceil(float(baseSteps) * budget)), 1);
+        opacityExponent = float(baseSteps) / float(steps);
+    }
+#endif
     float stepSize = (tExit - tEntry) / float(steps);
     
-    float jitter = IGN(input.position.xy);
+    // Interleaved marching keys the noise on the full resolution pixel it stands in for.
+    float2 pixelPos = input.position.xy;
+    if (interleaveParams.z > 1.0f)
+        pixelPos = floor(input.position.xy) * interleaveParams.z + interleaveParams.xy + 0.5f;
+
+    float jitter = IGN(pixelPos + 5.588238f * temporalParams.x);
     float tCurrent = tEntry + (jitter * stepSize);
-    
+
+    // Start at the first whole step inside the clip region so clipped space costs no samples.
+    int firstStep = 0;
+    if (clipped.x > tCurrent)
+    {
+        firstStep = int(ceil((clipped.x - tCurrent) / stepSize));
+        tCurrent += float(firstStep) * stepSize;
+    }
+
+    // Stop at opaque geometry; the step size still spans the whole box so the samples in front of it do not move.
+    float tLimit = clipped.y;
+    if (sceneDepthParams.x > 0.0f)
+    {
+        float2 fullPixel = (interleaveParams.z > 1.0f) ? pixelPos : input.position.xy * renderTargetSize.xy / renderTargetSize.zw;
+        tLimit = min(tLimit, SceneDistance(fullPixel, localCam.xyz, rayDir));
+        if (tLimit < clipped.x)
+            discard;
+    }
+
+#if RAYMARCH_COMPOSITE != 0
+    return ProjectRay(localCam.xyz, rayDir, tCurrent, stepSize, firstStep, steps, clipped.x, tLimit, jitter);
+#else
+#if RAYMARCH_SHADOWS || RAYMARCH_GRADIENTS
     float3 localLightPos = mul(float4(lightPosition.xyz, 1.0f), invWorldMatrix).xyz;
+#endif
     float globalDensity = 0.12f;
     float4 accumulatedColor = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    float depthSum = 0.0f;
+    float depthWeight = 0.0f;
 
     // 3. Main Raymarching Loop
-    for (int i = 0; i < steps; i++)
+    for (int i = firstStep; i < steps; i++)
     {
+        if (tCurrent > tLimit)
+            break;
+
         float3 currentPos = localCam.xyz + rayDir * tCurrent;
-        float4 voxel = voxelTexture.SampleLevel(voxelSampler, currentPos + 0.5f, 0);
 
+        // Jump whole steps through empty space so the samples that remain land where they would without the field.
+        int skip = EmptySteps(currentPos, stepSize);
+        if (skip > 0)
+        {
+            i += skip - 1;
+            tCurrent += float(skip) * stepSize;
+            continue;
+        }
+
+        float4 voxel = SampleVoxel(currentPos + 0.5f);
+
+#if RAYMARCH_SHADOWS
+        // The branch only pays for itself when it skips the shadow taps; without them empty voxels add nothing.
         if (voxel.a > 0.001f)
+#endif
         {
-            // Lightweight 3-sample shadow loop
+#if RAYMARCH_SHADOWS || RAYMARCH_GRADIENTS
             float3 lightDir = normalize(localLightPos - currentPos);
+#endif
+#if RAYMARCH_SHADOWS
+            // Lightweight 3-sample shadow loop
             float lightAccum = 0;
             [unroll] // Performance hint for the GPU
             for (int j = 1; j <= 3; j++)
             {
                 float3 shadowPos = currentPos + lightDir * (float(j) * 0.04f);
-                if (all(shadowPos > bMin) && all(shadowPos < bMax))
-                    lightAccum += voxelTexture.SampleLevel(voxelSampler, shadowPos + 0.5f, 0).a;
+                if (all(shadowPos > bMin) && all(shadowPos < bMax) && InsideClipRegion(shadowPos))
+                    lightAccum += SampleDensity(shadowPos + 0.5f);
             }
             float shadow = exp(-lightAccum * 10.0f * 0.04f);
+#else
+            float shadow = 1.0f;
+#endif
+
+#if RAYMARCH_GRADIENTS
+            // Fade the diffuse term in with the gradient magnitude so homogeneous regions stay unlit.
+            float4 gradient = gradientTexture.SampleLevel(voxelSampler, currentPos + 0.5f, 0);
+            float diffuse = saturate(dot(DecodeOctahedral(gradient.rg), lightDir));
+            shadow *= lerp(1.0f, gradientParams.x + (1.0f - gradientParams.x) * diffuse, saturate(gradient.b * gradientParams.y));
+#endif
             
             float localAlpha = voxel.a * globalDensity;
+#if RAYMARCH_STEPS == 0
+            if (opacityExponent != 1.0f)
+                localAlpha = 1.0f - pow(1.0f - localAlpha, opacityExponent);
+#endif
+            depthSum += tCurrent * localAlpha * (1.0f - accumulatedColor.a);
+            depthWeight += localAlpha * (1.0f - accumulatedColor.a);
             accumulatedColor.rgb += voxel.rgb * localAlpha * shadow * (1.0f - accumulatedColor.a);
             accumulatedColor.a += localAlpha * (1.0f - accumulatedColor.a);
         }
 
-        if (accumulatedColor.a >= 0.99f)
+#if RAYMARCH_EARLY_OUT < 100
+        if (accumulatedColor.a >= RAYMARCH_EARLY_OUT / 100.0f)
             break;
+#endif
         tCurrent += stepSize;
     }
 
     // Final Dither to hide banding
     accumulatedColor.rgb += (jitter - 0.5f) / 255.0f;
-    return accumulatedColor;
+
+    PixelShaderOutput output;
+    output.color = accumulatedColor;
+    output.rayDepth = float2(clipped.x, (depthWeight > 0.0f) ? depthSum / depthWeight : clipped.x);
+    return output;
+#endif
 }
\ No newline at end of file
@@ -1,13 +1,4 @@
-cbuffer ConstantBuffer : register(b0)
-{
-    float4x4 worldMatrix;
-    float4x4 viewMatrix;
-    float4x4 projectionMatrix;
-    float4x4 worldviewprojection;
-    float4x4 invworldviewprojection;
-    float4x4 invWorldMatrix;
-    float4 cameraPosition;
-};
+#include "ConstantBuffer.hlsli"
 
 struct VS_INPUT
 {
@@ -20,6 +11,7 @@ struct PS_INPUT
     float4 position : SV_POSITION;
     float3 texCoord : TEXCOORD0;
     float3 localPos : TEXCOORD1;
+    nointerpolation uint viewIndex : TEXCOORD2; // Eye in multi-view passes, see StereoVertexShader.hlsl
 };
 
 PS_INPUT main(VS_INPUT input)
@@ -27,7 +19,16 @@ PS_INPUT main(VS_INPUT input)
     PS_INPUT output;
     float4 worldPos = mul(float4(input.position, 1.0f), worldMatrix);
     output.position = mul(worldPos, mul(viewMatrix, projectionMatrix));
+
+    // Interleaved marching renders at 1/N resolution; shift the raster grid so each
+    // reduced pixel center lands on the full resolution pixel marched this frame.
+    if (interleaveParams.z > 1.0f)
+    {
+        float2 offsetPixels = interleaveParams.xy + 0.5f - 0.5f * interleaveParams.z;
+        output.position.xy += float2(2.0f, -2.0f) * offsetPixels / renderTargetSize.xy * output.position.w;
+    }
     output.texCoord = input.texCoord;
     output.localPos = input.position; // Pass raw coordinates for raymarching [cite: 26, 33]
+    output.viewIndex = 0;
     return output;
 }
\ No newline at end of file
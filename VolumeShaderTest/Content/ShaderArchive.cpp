@@ -0,0 +1,162 @@
+﻿#include "pch.h"
+#include "ShaderArchive.h"
+#include <cstring>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	const size_t HeaderSize = 24;
+	const size_t EntrySize = 24;
+
+	inline size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	template <typename T>
+	inline void Store(std::vector<uint8_t>& buffer, size_t offset, T value)
+	{
+		// The archive is little endian, as are all the targets this project builds for.
+		memcpy(&buffer[offset], &value, sizeof(T));
+	}
+
+	template <typename T>
+	inline T Load(const uint8_t* data, size_t offset)
+	{
+		T value;
+		memcpy(&value, data + offset, sizeof(T));
+		return value;
+	}
+}
+
+uint64_t VolumeShaderTest::HashShaderArchiveKey(const void* data, size_t size, uint64_t hash)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	}
+	return hash;
+}
+
+void ShaderArchiveWriter::Add(const std::string& name, const uint8_t* data, size_t size)
+{
+	m_names.push_back(name);
+	m_blobs.emplace_back(data, data + size);
+}
+
+std::vector<uint8_t> ShaderArchiveWriter::Serialize(uint64_t buildId) const
+{
+	size_t entryCount = m_names.size();
+	size_t namesOffset = HeaderSize + entryCount * EntrySize;
+
+	size_t namesSize = 0;
+	for (const std::string& name : m_names)
+	{
+		namesSize += name.size();
+	}
+
+	// Lay out the blobs first so the buffer is sized once.
+	std::vector<size_t> dataOffsets(entryCount);
+	size_t end = namesOffset + namesSize;
+	for (size_t i = 0; i < entryCount; ++i)
+	{
+		dataOffsets[i] = AlignUp(end, ShaderArchiveAlignment);
+		end = dataOffsets[i] + m_blobs[i].size();
+	}
+
+	std::vector<uint8_t> buffer(end, 0);
+	Store<uint32_t>(buffer, 0, ShaderArchiveMagic);
+	Store<uint32_t>(buffer, 4, ShaderArchiveVersion);
+	Store<uint64_t>(buffer, 8, buildId);
+	Store<uint32_t>(buffer, 16, static_cast<uint32_t>(entryCount));
+	Store<uint32_t>(buffer, 20, 0);
+
+	size_t nameOffset = namesOffset;
+	for (size_t i = 0; i < entryCount; ++i)
+	{
+		size_t entry = HeaderSize + i * EntrySize;
+		Store<uint64_t>(buffer, entry, dataOffsets[i]);
+		Store<uint64_t>(buffer, entry + 8, m_blobs[i].size());
+		Store<uint32_t>(buffer, entry + 16, static_cast<uint32_t>(nameOffset));
+		Store<uint32_t>(buffer, entry + 20, static_cast<uint32_t>(m_names[i].size()));
+
+		memcpy(&buffer[nameOffset], m_names[i].data(), m_names[i].size());
+		nameOffset += m_names[i].size();
+
+		if (!m_blobs[i].empty())
+		{
+			memcpy(&buffer[dataOffsets[i]], m_blobs[i].data(), m_blobs[i].size());
+		}
+	}
+	return buffer;
+}
+
+ShaderArchiveReader::ShaderArchiveReader() :
+	m_buildId(0)
+{
+}
+
+bool ShaderArchiveReader::Open(const uint8_t* data, size_t size, uint64_t expectedBuildId)
+{
+	m_buildId = 0;
+	m_names.clear();
+	m_entries.clear();
+	m_index.clear();
+
+	if (data == nullptr || size < HeaderSize ||
+		Load<uint32_t>(data, 0) != ShaderArchiveMagic ||
+		Load<uint32_t>(data, 4) != ShaderArchiveVersion ||
+		Load<uint64_t>(data, 8) != expectedBuildId)
+	{
+		return false;
+	}
+
+	size_t entryCount = Load<uint32_t>(data, 16);
+	if (entryCount > (size - HeaderSize) / EntrySize)
+	{
+		return false;
+	}
+
+	m_names.reserve(entryCount);
+	m_entries.reserve(entryCount);
+	for (size_t i = 0; i < entryCount; ++i)
+	{
+		size_t entry = HeaderSize + i * EntrySize;
+		uint64_t dataOffset = Load<uint64_t>(data, entry);
+		uint64_t dataSize = Load<uint64_t>(data, entry + 8);
+		uint32_t nameOffset = Load<uint32_t>(data, entry + 16);
+		uint32_t nameLength = Load<uint32_t>(data, entry + 20);
+
+		// Written without overflow so a corrupt offset near 2^64 cannot wrap past the check.
+		if (dataOffset > size || dataSize > size - dataOffset ||
+			nameOffset > size || nameLength > size - nameOffset)
+		{
+			m_names.clear();
+			m_entries.clear();
+			m_index.clear();
+			return false;
+		}
+
+		m_names.emplace_back(reinterpret_cast<const char*>(data + nameOffset), nameLength);
+		m_entries.push_back({ data + dataOffset, static_cast<size_t>(dataSize) });
+		m_index[m_names.back()] = i;
+	}
+
+	m_buildId = expectedBuildId;
+	return true;
+}
+
+bool ShaderArchiveReader::Find(const std::string& name, const uint8_t*& data, size_t& size) const
+{
+	auto entry = m_index.find(name);
+	if (entry == m_index.end())
+	{
+		return false;
+	}
+
+	data = m_entries[entry->second].data;
+	size = m_entries[entry->second].size;
+	return true;
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VolumeShaderTest
+{
+	// Single file holding many compiled shaders so startup pays for one read instead of one per .cso.
+	//
+	// Layout, little endian, offsets from the start of the file:
+	//   header    magic 'VSSA', version, build id, entry count
+	//   entries   data offset, data size, name offset, name length
+	//   names     entry names, not terminated
+	//   data      blobs, each aligned to ShaderArchiveAlignment
+	const uint32_t ShaderArchiveMagic = 0x41535356;	// "VSSA"
+	const uint32_t ShaderArchiveVersion = 1;
+	const uint32_t ShaderArchiveAlignment = 16;
+
+	// 64-bit FNV-1a, for build ids derived from the shaders' contents. Chain calls by passing the previous
+	// result as hash.
+	const uint64_t ShaderArchiveHashSeed = 0xCBF29CE484222325ull;
+	uint64_t HashShaderArchiveKey(const void* data, size_t size, uint64_t hash = ShaderArchiveHashSeed);
+
+	class ShaderArchiveWriter
+	{
+	public:
+		// Copies the blob; names must be unique.
+		void Add(const std::string& name, const uint8_t* data, size_t size);
+
+		size_t GetEntryCount() const { return m_names.size(); }
+
+		// The build id lets readers reject an archive written for different shaders; hashing the shaders'
+		// contents makes any change to them invalidate it.
+		std::vector<uint8_t> Serialize(uint64_t buildId) const;
+
+	private:
+		std::vector<std::string>			m_names;
+		std::vector<std::vector<uint8_t>>	m_blobs;
+	};
+
+	// Indexes an archive in place; the bytes must outlive the reader and every pointer it hands out.
+	class ShaderArchiveReader
+	{
+	public:
+		ShaderArchiveReader();
+
+		// Returns false when the data is truncated, malformed or was written with a different build id.
+		bool Open(const uint8_t* data, size_t size, uint64_t expectedBuildId);
+
+		size_t GetEntryCount() const { return m_names.size(); }
+		const std::string& GetName(size_t index) const { return m_names[index]; }
+		uint64_t GetBuildId() const { return m_buildId; }
+
+		bool Find(const std::string& name, const uint8_t*& data, size_t& size) const;
+
+	private:
+		struct Entry
+		{
+			const uint8_t* data;
+			size_t size;
+		};
+
+		uint64_t								m_buildId;
+		std::vector<std::string>				m_names;
+		std::vector<Entry>						m_entries;
+		std::unordered_map<std::string, size_t>	m_index;
+	};
+}
@@ -0,0 +1,59 @@
+﻿// Raymarch pixel shader permutations compiled at build time.
+// Every entry except the first has a wrapper in Content\Permutations\ that sets the same defines and includes
+// SamplePixelShader.hlsl; the first is SamplePixelShader.hlsl itself, compiled with its defaults.
+// Adding a permutation means adding a line here, its wrapper, and an FxCompile item in the project.
+//
+// Wrapper names end in _G1 when RAYMARCH_GRADIENTS is on, and in _Mip, _MinIp, _Avg or _Hit for a compositing mode
+// other than Alpha. Those modes ignore shadows, early out and gradients, so their entries turn all three off, and
+// each of them has an entry for every format and transfer function pair a request can carry.
+//
+// Every request MakeRaymarchRequest can build must find an entry here; ShaderPermutationTests checks it. Each alpha
+// combination of format, transfer function, shadows and gradients has a dynamic step E100 entry, which serves any step
+// count and threshold, and the common ones also have faster fixed step or E99 entries.
+//
+// RAYMARCH_PERMUTATION(shaderFile, shadows, steps, format, transferFunction, earlyOutPercent, gradients, composite)
+
+RAYMARCH_PERMUTATION(L"SamplePixelShader.cso", 1, 0, VolumeFormat::Rgba, 0, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N128_Rgba_Tf0_E99.cso", 1, 128, VolumeFormat::Rgba, 0, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N128_Rgba_Tf0_E99.cso", 0, 128, VolumeFormat::Rgba, 0, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf0_E99.cso", 0, 0, VolumeFormat::Rgba, 0, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N128_Rgba_Tf0_E95.cso", 1, 128, VolumeFormat::Rgba, 0, 95, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N128_Rgba_Tf1_E99.cso", 1, 128, VolumeFormat::Rgba, 1, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Rgba_Tf1_E99.cso", 1, 0, VolumeFormat::Rgba, 1, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N128_Paged_Tf1_E99.cso", 1, 128, VolumeFormat::Paged, 1, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Paged_Tf1_E99.cso", 1, 0, VolumeFormat::Paged, 1, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N128_Rgba_Tf0_E99_G1.cso", 1, 128, VolumeFormat::Rgba, 0, 99, 1, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Rgba_Tf0_E99_G1.cso", 1, 0, VolumeFormat::Rgba, 0, 99, 1, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Rgba_Tf0_E100.cso", 1, 0, VolumeFormat::Rgba, 0, 100, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf0_E100.cso", 0, 0, VolumeFormat::Rgba, 0, 100, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Rgba_Tf0_E100_G1.cso", 1, 0, VolumeFormat::Rgba, 0, 100, 1, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf0_E100_G1.cso", 0, 0, VolumeFormat::Rgba, 0, 100, 1, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Rgba_Tf1_E100.cso", 1, 0, VolumeFormat::Rgba, 1, 100, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf1_E100.cso", 0, 0, VolumeFormat::Rgba, 1, 100, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Rgba_Tf1_E100_G1.cso", 1, 0, VolumeFormat::Rgba, 1, 100, 1, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf1_E100_G1.cso", 0, 0, VolumeFormat::Rgba, 1, 100, 1, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf1_E99.cso", 0, 0, VolumeFormat::Rgba, 1, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Paged_Tf1_E100.cso", 1, 0, VolumeFormat::Paged, 1, 100, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Paged_Tf1_E100.cso", 0, 0, VolumeFormat::Paged, 1, 100, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Paged_Tf1_E99.cso", 0, 0, VolumeFormat::Paged, 1, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Channels_Tf0_E100.cso", 1, 0, VolumeFormat::Channels, 0, 100, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Channels_Tf0_E100.cso", 0, 0, VolumeFormat::Channels, 0, 100, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf0_E100_Mip.cso", 0, 0, VolumeFormat::Rgba, 0, 100, 0, CompositeMode::MaximumIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf1_E100_Mip.cso", 0, 0, VolumeFormat::Rgba, 1, 100, 0, CompositeMode::MaximumIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Paged_Tf1_E100_Mip.cso", 0, 0, VolumeFormat::Paged, 1, 100, 0, CompositeMode::MaximumIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf0_E100_MinIp.cso", 0, 0, VolumeFormat::Rgba, 0, 100, 0, CompositeMode::MinimumIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf1_E100_MinIp.cso", 0, 0, VolumeFormat::Rgba, 1, 100, 0, CompositeMode::MinimumIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Paged_Tf1_E100_MinIp.cso", 0, 0, VolumeFormat::Paged, 1, 100, 0, CompositeMode::MinimumIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf0_E100_Avg.cso", 0, 0, VolumeFormat::Rgba, 0, 100, 0, CompositeMode::AverageIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf1_E100_Avg.cso", 0, 0, VolumeFormat::Rgba, 1, 100, 0, CompositeMode::AverageIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Paged_Tf1_E100_Avg.cso", 0, 0, VolumeFormat::Paged, 1, 100, 0, CompositeMode::AverageIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf0_E100_Hit.cso", 0, 0, VolumeFormat::Rgba, 0, 100, 0, CompositeMode::FirstHit)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Rgba_Tf1_E100_Hit.cso", 0, 0, VolumeFormat::Rgba, 1, 100, 0, CompositeMode::FirstHit)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Paged_Tf1_E100_Hit.cso", 0, 0, VolumeFormat::Paged, 1, 100, 0, CompositeMode::FirstHit)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N128_Channels_Tf0_E99.cso", 1, 128, VolumeFormat::Channels, 0, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S1_N0_Channels_Tf0_E99.cso", 1, 0, VolumeFormat::Channels, 0, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Channels_Tf0_E99.cso", 0, 0, VolumeFormat::Channels, 0, 99, 0, CompositeMode::Alpha)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Channels_Tf0_E100_Mip.cso", 0, 0, VolumeFormat::Channels, 0, 100, 0, CompositeMode::MaximumIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Channels_Tf0_E100_MinIp.cso", 0, 0, VolumeFormat::Channels, 0, 100, 0, CompositeMode::MinimumIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Channels_Tf0_E100_Avg.cso", 0, 0, VolumeFormat::Channels, 0, 100, 0, CompositeMode::AverageIntensity)
+RAYMARCH_PERMUTATION(L"SamplePixelShader_S0_N0_Channels_Tf0_E100_Hit.cso", 0, 0, VolumeFormat::Channels, 0, 100, 0, CompositeMode::FirstHit)
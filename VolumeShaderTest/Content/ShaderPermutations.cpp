@@ -0,0 +1,134 @@
+﻿#include "pch.h"
+#include "ShaderPermutations.h"
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	const RaymarchPermutation s_raymarchPermutations[] =
+	{
+#define RAYMARCH_PERMUTATION(shaderFile, shadows, steps, format, transferFunction, earlyOutPercent, gradients, composite) \
+		{ shaderFile, RaymarchPermutationKey(shadows != 0, steps, format, transferFunction != 0, earlyOutPercent, gradients != 0, composite) },
+#include "ShaderPermutationManifest.h"
+#undef RAYMARCH_PERMUTATION
+	};
+}
+
+// Bit layout: [0] shadows, [1] transfer function, [2..3] format, [4..10] early out percent, [11] gradients, [12..14] composite,
+// [15..31] steps.
+uint32_t RaymarchPermutationKey::Pack() const
+{
+	return (shadows ? 1u : 0u) |
+		((transferFunction ? 1u : 0u) << 1) |
+		((static_cast<uint32_t>(format) & 0x3u) << 2) |
+		((earlyOutPercent & 0x7fu) << 4) |
+		((gradients ? 1u : 0u) << 11) |
+		((static_cast<uint32_t>(composite) & 0x7u) << 12) |
+		(steps << 15);
+}
+
+RaymarchPermutationKey RaymarchPermutationKey::Unpack(uint32_t packed)
+{
+	return RaymarchPermutationKey(
+		(packed & 1u) != 0,
+		packed >> 15,
+		static_cast<VolumeFormat>((packed >> 2) & 0x3u),
+		(packed & 2u) != 0,
+		(packed >> 4) & 0x7fu,
+		(packed & 0x800u) != 0,
+		static_cast<CompositeMode>((packed >> 12) & 0x7u));
+}
+
+const RaymarchPermutation* VolumeShaderTest::GetRaymarchPermutations(size_t& count)
+{
+	count = sizeof(s_raymarchPermutations) / sizeof(s_raymarchPermutations[0]);
+	return s_raymarchPermutations;
+}
+
+int VolumeShaderTest::SelectRaymarchPermutation(const RaymarchPermutation* table, size_t count, const RaymarchPermutationKey& request)
+{
+	int best = -1;
+	uint32_t bestScore = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const RaymarchPermutationKey& key = table[i].key;
+		if (key.format != request.format || key.transferFunction != request.transferFunction || key.composite != request.composite)
+		{
+			continue;
+		}
+		bool alpha = (request.composite == CompositeMode::Alpha);
+		if (alpha && (key.shadows != request.shadows || key.gradients != request.gradients))
+		{
+			continue;
+		}
+		if (key.steps != 0 && key.steps != request.steps)
+		{
+			continue;
+		}
+		if (alpha && key.earlyOutPercent < request.earlyOutPercent)
+		{
+			continue;
+		}
+
+		// Step match outranks any threshold difference, which is at most 100.
+		uint32_t score = (key.steps == request.steps) ? 256u : 128u;
+		score += alpha ? 100u - (key.earlyOutPercent - request.earlyOutPercent) : 100u;
+		if (score > bestScore)
+		{
+			bestScore = score;
+			best = static_cast<int>(i);
+		}
+	}
+	return best;
+}
+
+int VolumeShaderTest::SelectNearestRaymarchPermutation(const RaymarchPermutation* table, size_t count, const RaymarchPermutationKey& request)
+{
+	int exact = SelectRaymarchPermutation(table, count, request);
+	if (exact >= 0)
+	{
+		return exact;
+	}
+
+	int best = -1;
+	uint32_t bestScore = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const RaymarchPermutationKey& key = table[i].key;
+		if (key.format != request.format || key.transferFunction != request.transferFunction || key.composite != request.composite)
+		{
+			continue;
+		}
+
+		uint32_t score = 1;
+		score += (key.shadows == request.shadows) ? 8u : 0u;
+		score += (key.gradients == request.gradients) ? 4u : 0u;
+		score += (key.steps == 0 || key.steps == request.steps) ? 2u : 0u;
+		score += (key.earlyOutPercent >= request.earlyOutPercent) ? 1u : 0u;
+		if (score > bestScore)
+		{
+			bestScore = score;
+			best = static_cast<int>(i);
+		}
+	}
+	return best;
+}
+
+RaymarchPermutationKey VolumeShaderTest::MakeRaymarchRequest(
+	bool shadows,
+	bool dynamicSteps,
+	VolumeFormat format,
+	bool transferFunction,
+	uint32_t earlyOutPercent,
+	bool gradients,
+	CompositeMode composite)
+{
+	return RaymarchPermutationKey(
+		shadows,
+		dynamicSteps ? 0 : 128,
+		format,
+		format == VolumeFormat::Paged || (format != VolumeFormat::Channels && transferFunction),
+		(earlyOutPercent < 100) ? earlyOutPercent : 100,
+		gradients && format == VolumeFormat::Rgba,
+		composite);
+}
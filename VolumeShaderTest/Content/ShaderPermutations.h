@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VolumeShaderTest
+{
+	// Layout of the volume texture the raymarcher samples (RAYMARCH_FORMAT).
+	enum class VolumeFormat : uint8_t
+	{
+		Rgba,		// Color in rgb, density in a.
+		Density,	// Single channel density; color comes from the transfer function or is white.
+		Paged,		// Single channel density streamed into a brick pool through a page table (out-of-core volumes).
+		Channels	// Two to four packed scalar channels, each colored by its own transfer function and mixed by weight.
+	};
+
+	// How the samples along a ray become a pixel (RAYMARCH_COMPOSITE).
+	enum class CompositeMode : uint8_t
+	{
+		Alpha,				// Front-to-back emission and absorption with shadows and lighting.
+		MaximumIntensity,	// Highest density along the ray.
+		MinimumIntensity,	// Lowest density along the ray.
+		AverageIntensity,	// Mean density of the samples taken.
+		FirstHit			// Lit surface at the first sample whose density reaches a threshold.
+	};
+
+	// Compile-time options of SamplePixelShader.hlsl, one field per RAYMARCH_* define.
+	struct RaymarchPermutationKey
+	{
+		RaymarchPermutationKey() : shadows(true), steps(0), format(VolumeFormat::Rgba), transferFunction(false), earlyOutPercent(99), gradients(false), composite(CompositeMode::Alpha) {}
+		RaymarchPermutationKey(bool shadows, uint32_t steps, VolumeFormat format, bool transferFunction, uint32_t earlyOutPercent, bool gradients = false, CompositeMode composite = CompositeMode::Alpha) :
+			shadows(shadows), steps(steps), format(format), transferFunction(transferFunction), earlyOutPercent(earlyOutPercent), gradients(gradients), composite(composite) {}
+
+		// Packs the key into 32 bits for cache lookups.
+		uint32_t Pack() const;
+		static RaymarchPermutationKey Unpack(uint32_t packed);
+
+		bool operator==(const RaymarchPermutationKey& other) const { return Pack() == other.Pack(); }
+		bool operator!=(const RaymarchPermutationKey& other) const { return Pack() != other.Pack(); }
+
+		bool shadows;
+		uint32_t steps;				// 0 = read per frame from the constant buffer and the importance map.
+		VolumeFormat format;
+		bool transferFunction;
+		uint32_t earlyOutPercent;	// Accumulated opacity that ends the march, 100 = never.
+		bool gradients;				// Diffuse lighting from the precomputed gradient volume.
+		CompositeMode composite;
+	};
+
+	struct RaymarchPermutation
+	{
+		const wchar_t* shaderFile;
+		RaymarchPermutationKey key;
+	};
+
+	// Permutations listed in ShaderPermutationManifest.h, in manifest order.
+	const RaymarchPermutation* GetRaymarchPermutations(size_t& count);
+
+	// Picks the table entry that can render the requested key, or returns -1 when none can.
+	// Shadows, format, transfer function, gradient lighting and compositing mode must match. A dynamic step entry serves any
+	// step count, but a fixed one only its own. The early-out threshold may be later than requested, never earlier.
+	// Modes other than Alpha take no shadow taps, stop on their own criteria and never read the gradient volume, so
+	// shadows, early out and gradients are not matched for them.
+	// Exact step and threshold matches win, then the closest threshold, then manifest order.
+	int SelectRaymarchPermutation(const RaymarchPermutation* table, size_t count, const RaymarchPermutationKey& request);
+
+	// Stand-in for a request SelectRaymarchPermutation cannot serve: the closest entry with the same format, transfer
+	// function and compositing mode, preferring matching shadows, then gradients, then a step count and threshold the
+	// exact rules would accept. Returns -1 when no entry shares those three; a shader built for another format reads
+	// the wrong textures, so it never stands in.
+	int SelectNearestRaymarchPermutation(const RaymarchPermutation* table, size_t count, const RaymarchPermutationKey& request);
+
+	// The request Sample3DSceneRenderer builds from its options. Channel volumes color through their per-channel
+	// tables, paged volumes always through the transfer function, and only RGBA volumes have a gradient volume.
+	RaymarchPermutationKey MakeRaymarchRequest(
+		bool shadows,
+		bool dynamicSteps,
+		VolumeFormat format,
+		bool transferFunction,
+		uint32_t earlyOutPercent,
+		bool gradients,
+		CompositeMode composite);
+}
@@ -2,6 +2,12 @@
 
 namespace VolumeShaderTest
 {
+    // Size of clipPlanes; MAX_CLIP_PLANES in ConstantBuffer.hlsli.
+    const uint32_t MaxClipPlanes = 6;
+
+    // Views rendered by one multi-view pass; STEREO_VIEW_COUNT in ConstantBuffer.hlsli.
+    const uint32_t StereoViewCount = 2;
+
     struct ModelViewProjectionConstantBuffer
     {
         DirectX::XMFLOAT4X4 worldMatrix;
@@ -12,6 +18,30 @@ namespace VolumeShaderTest
         DirectX::XMFLOAT4X4 invWorldMatrix; // For local space transformation
         DirectX::XMFLOAT4 cameraPosition;   // For ray origin
         DirectX::XMFLOAT4 lightPosition;    // For animated self-shadowing
+        DirectX::XMFLOAT4 renderTargetSize; // xy: full resolution, zw: volume pass resolution
+        DirectX::XMFLOAT4 upsampleParams;   // x: depth sigma for the bilateral upsample
+        DirectX::XMFLOAT4X4 prevWorldViewProjectionMatrix; // For temporal reprojection
+        DirectX::XMFLOAT4 temporalParams;   // x: frame index, y: history blend weight, z: steps per frame (0 = 128), w: history valid
+        DirectX::XMFLOAT4 interleaveParams; // xy: pixel marched inside each block this frame, z: block size (0 = off)
+        DirectX::XMFLOAT4 importanceParams;     // x: tile size in volume pass pixels (0 = off), y: margin read around each tile
+        DirectX::XMFLOAT4 importanceThresholds; // x: transparent alpha, y: opaque alpha, z: detailed variance
+        DirectX::XMFLOAT4 importanceBudgets;    // Fraction of the base steps for empty, transparent, opaque and detailed tiles
+        DirectX::XMFLOAT4 outOfCoreParams;      // xyz: volume size in chunks (fractional for partial edge chunks), w: chunk size in voxels
+        DirectX::XMFLOAT4 outOfCorePool;        // xyz: brick pool slots per axis, w: padded chunk size
+        DirectX::XMFLOAT4 gradientParams;       // x: ambient term of the gradient lighting, y: gain on the stored magnitude
+        DirectX::XMFLOAT4 distanceParams;       // xyz: distance field size in cells, w: local units per cell distance (0 = off)
+        DirectX::XMFLOAT4 isosurfaceParams;     // rgb: isosurface albedo, w: ambient term
+        DirectX::XMFLOAT4 sceneDepthParams;     // x: 1 when the opaque scene depth is bound and limits the march
+        DirectX::XMFLOAT4 clipParams;           // x: active clip planes, y: 1 when the crop box is active
+        DirectX::XMFLOAT4 clipPlanes[MaxClipPlanes]; // xyz: local space normal, w: offset; keeps dot(n, p) + w >= 0
+        DirectX::XMFLOAT4X4 cropBoxMatrix;      // Local space to crop space, where the kept box spans [-1, 1]
+        DirectX::XMFLOAT4 compositeParams;      // x: density threshold of the first-hit mode
+        DirectX::XMFLOAT4 channelParams;        // x: channels packed in the volume texture (format 3)
+        DirectX::XMFLOAT4 channelWeights;       // Blending weight of each channel's transfer function
+        DirectX::XMFLOAT4X4 eyeWorldViewProjection[StereoViewCount]; // Local to clip of the left and right eye
+        DirectX::XMFLOAT4 eyePositions[StereoViewCount]; // World space position of each eye
+        DirectX::XMFLOAT4 stereoParams;         // x: 1 in multi-view mode, yz: size of one eye's target
+        DirectX::XMFLOAT4 outOfCoreCoarse;      // xyz: volume to coarse texture coordinate scale
     };
 
     struct VertexPositionColor
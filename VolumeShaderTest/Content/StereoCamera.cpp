@@ -0,0 +1,80 @@
+﻿#include "pch.h"
+#include "StereoCamera.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+void VolumeShaderTest::ComputeStereoView(
+	FXMVECTOR eye,
+	FXMVECTOR at,
+	FXMVECTOR up,
+	float fovAngleY,
+	float aspectRatio,
+	float nearZ,
+	float farZ,
+	const StereoRig& rig,
+	StereoView& stereo)
+{
+	XMVECTOR forward = XMVector3Normalize(XMVectorSubtract(at, eye));
+	XMVECTOR right = XMVector3Normalize(XMVector3Cross(up, forward));
+
+	// Slopes of the frustum sides, and the shift that moves each eye's image center onto the mono axis at the
+	// convergence distance.
+	float halfSeparation = 0.5f * rig.eyeSeparation;
+	float slopeY = tanf(0.5f * fovAngleY);
+	float slopeX = slopeY * aspectRatio;
+	float shift = (rig.convergenceDistance > 0.0f) ? halfSeparation / rig.convergenceDistance : 0.0f;
+
+	for (uint32_t i = 0; i < StereoViewCount; ++i)
+	{
+		float side = (i == 0) ? -1.0f : 1.0f;
+		XMVECTOR position = XMVectorMultiplyAdd(right, XMVectorReplicate(side * halfSeparation), eye);
+		XMStoreFloat3(&stereo.eyePosition[i], position);
+		XMStoreFloat4x4(&stereo.view[i], XMMatrixLookToLH(position, forward, up));
+
+		float center = -side * shift;
+		XMStoreFloat4x4(&stereo.projection[i], XMMatrixPerspectiveOffCenterLH(
+			(center - slopeX) * nearZ,
+			(center + slopeX) * nearZ,
+			-slopeY * nearZ,
+			slopeY * nearZ,
+			nearZ,
+			farZ));
+	}
+
+	// The frusta cross at the convergence distance: nearer than it each eye's outer side is the outermost, beyond it
+	// the other eye's side, which spreads by slopeX + shift per unit of depth. Sides with that slope through the
+	// outer edges of the eyes hold both.
+	float outerSlope = slopeX + shift;
+	float apexDistance = halfSeparation / outerSlope;
+
+	XMVECTOR apex = XMVectorMultiplyAdd(forward, XMVectorReplicate(-apexDistance), eye);
+	float cullNear = nearZ + apexDistance;
+	XMMATRIX cullView = XMMatrixLookToLH(apex, forward, up);
+	XMMATRIX cullProjection = XMMatrixPerspectiveLH(
+		2.0f * outerSlope * cullNear,
+		2.0f * slopeY * cullNear,
+		cullNear,
+		farZ + apexDistance);
+	XMStoreFloat4x4(&stereo.cullViewProjection, XMMatrixMultiply(cullView, cullProjection));
+}
+
+void VolumeShaderTest::OrientStereoView(StereoView& stereo, FXMMATRIX orientation)
+{
+	for (uint32_t i = 0; i < StereoViewCount; ++i)
+	{
+		XMStoreFloat4x4(&stereo.projection[i], XMMatrixMultiply(XMLoadFloat4x4(&stereo.projection[i]), orientation));
+	}
+	XMStoreFloat4x4(&stereo.cullViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&stereo.cullViewProjection), orientation));
+}
+
+void VolumeShaderTest::StoreStereoView(const StereoView& stereo, FXMMATRIX world, ModelViewProjectionConstantBuffer& constants)
+{
+	for (uint32_t i = 0; i < StereoViewCount; ++i)
+	{
+		XMMATRIX viewProjection = XMMatrixMultiply(XMLoadFloat4x4(&stereo.view[i]), XMLoadFloat4x4(&stereo.projection[i]));
+		XMStoreFloat4x4(&constants.eyeWorldViewProjection[i], XMMatrixTranspose(XMMatrixMultiply(world, viewProjection)));
+		const XMFLOAT3& position = stereo.eyePosition[i];
+		constants.eyePositions[i] = XMFLOAT4(position.x, position.y, position.z, 1.0f);
+	}
+}
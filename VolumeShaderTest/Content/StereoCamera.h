@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include "ShaderStructures.h"
+
+namespace VolumeShaderTest
+{
+	// Two eyes looking along the mono camera's axis, offset to either side of it.
+	struct StereoRig
+	{
+		StereoRig() : eyeSeparation(0.064f), convergenceDistance(3.0f) {}
+
+		float eyeSeparation;		// World units between the eyes.
+		float convergenceDistance;	// Distance in front of the eyes where both images line up (zero parallax).
+	};
+
+	// Matrices of each eye, left eye first, and one frustum holding both for culling.
+	struct StereoView
+	{
+		DirectX::XMFLOAT4X4 view[StereoViewCount];
+		DirectX::XMFLOAT4X4 projection[StereoViewCount];
+		DirectX::XMFLOAT3 eyePosition[StereoViewCount];
+		DirectX::XMFLOAT4X4 cullViewProjection;
+	};
+
+	// Parallel eye axes with off-axis frusta, which unlike toed-in cameras keeps vertical parallax at 0. fovAngleY
+	// and aspectRatio describe one eye's image. The eyes share the top, bottom, near and far planes. The cull frustum
+	// is symmetric about the mono axis with its apex just behind the eyes, so a box outside it is outside both eyes;
+	// it is wider than the two eyes together by at most the eye separation over the convergence distance per unit
+	// of depth.
+	void ComputeStereoView(
+		DirectX::FXMVECTOR eye,
+		DirectX::FXMVECTOR at,
+		DirectX::FXMVECTOR up,
+		float fovAngleY,
+		float aspectRatio,
+		float nearZ,
+		float farZ,
+		const StereoRig& rig,
+		StereoView& stereo);
+
+	// Applies the display orientation after every projection, as the mono projection does.
+	void OrientStereoView(StereoView& stereo, DirectX::FXMMATRIX orientation);
+
+	// Fills eyeWorldViewProjection and eyePositions for the given world matrix.
+	void StoreStereoView(const StereoView& stereo, DirectX::FXMMATRIX world, ModelViewProjectionConstantBuffer& constants);
+}
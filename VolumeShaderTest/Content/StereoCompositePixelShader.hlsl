@@ -0,0 +1,19 @@
+#include "ConstantBuffer.hlsli"
+
+Texture2DArray<float4> eyeColor : register(t0);
+
+struct PixelShaderInput
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+// Places the eyes of a multi-view pass side by side in the back buffer, left eye on the left; blending is done by
+// the output merger.
+float4 main(PixelShaderInput input) : SV_Target
+{
+    int eyeWidth = int(stereoParams.y);
+    int2 pixel = int2(input.position.xy);
+    int eye = (pixel.x >= eyeWidth) ? 1 : 0;
+    return eyeColor.Load(int4(pixel.x - eye * eyeWidth, pixel.y, eye, 0));
+}
@@ -0,0 +1,33 @@
+struct GS_INPUT
+{
+    float4 position : SV_POSITION;
+    float3 texCoord : TEXCOORD0;
+    float3 localPos : TEXCOORD1;
+    nointerpolation uint viewIndex : TEXCOORD2;
+};
+
+struct GS_OUTPUT
+{
+    float4 position : SV_POSITION;
+    float3 texCoord : TEXCOORD0;
+    float3 localPos : TEXCOORD1;
+    nointerpolation uint viewIndex : TEXCOORD2;
+    uint renderTargetIndex : SV_RenderTargetArrayIndex;
+};
+
+// Sends each triangle of a multi-view pass to its eye's slice. Devices that can write the slice index from the
+// vertex shader would not need this stage, but every feature level 11 device can run it.
+[maxvertexcount(3)]
+void main(triangle GS_INPUT input[3], inout TriangleStream<GS_OUTPUT> stream)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        GS_OUTPUT output;
+        output.position = input[i].position;
+        output.texCoord = input[i].texCoord;
+        output.localPos = input[i].localPos;
+        output.viewIndex = input[i].viewIndex;
+        output.renderTargetIndex = input[i].viewIndex;
+        stream.Append(output);
+    }
+}
@@ -0,0 +1,27 @@
+#include "ConstantBuffer.hlsli"
+
+struct VS_INPUT
+{
+    float3 position : POSITION;
+    float3 texCoord : TEXCOORD0;
+};
+
+struct VS_OUTPUT
+{
+    float4 position : SV_POSITION;
+    float3 texCoord : TEXCOORD0;
+    float3 localPos : TEXCOORD1;
+    nointerpolation uint viewIndex : TEXCOORD2;
+};
+
+// Multi-view variant of SampleVertexShader: instance i draws the cube for eye i, and StereoGeometryShader routes it
+// to slice i of the target array.
+VS_OUTPUT main(VS_INPUT input, uint instance : SV_InstanceID)
+{
+    VS_OUTPUT output;
+    output.position = mul(float4(input.position, 1.0f), eyeWorldViewProjection[instance]);
+    output.texCoord = input.texCoord;
+    output.localPos = input.position;
+    output.viewIndex = instance;
+    return output;
+}
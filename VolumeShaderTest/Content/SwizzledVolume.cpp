@@ -0,0 +1,149 @@
+﻿#include "pch.h"
+#include "SwizzledVolume.h"
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	inline uint32_t ClampCoord(int64_t value, uint32_t size)
+	{
+		return static_cast<uint32_t>((value < 0) ? 0 : (value >= size ? size - 1 : value));
+	}
+}
+
+void VolumeShaderTest::BoxFilter3x3x3(const float* source, uint32_t width, uint32_t height, uint32_t depth, float* destination)
+{
+	size_t slice = static_cast<size_t>(width) * height;
+	for (uint32_t z = 0; z < depth; ++z)
+	{
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const float* rows[9];
+			for (int dz = -1; dz <= 1; ++dz)
+			{
+				for (int dy = -1; dy <= 1; ++dy)
+				{
+					rows[(dz + 1) * 3 + dy + 1] = source + ClampCoord(static_cast<int64_t>(z) + dz, depth) * slice + static_cast<size_t>(ClampCoord(static_cast<int64_t>(y) + dy, height)) * width;
+				}
+			}
+
+			float* out = destination + z * slice + static_cast<size_t>(y) * width;
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				uint32_t x0 = ClampCoord(static_cast<int64_t>(x) - 1, width);
+				uint32_t x2 = ClampCoord(static_cast<int64_t>(x) + 1, width);
+				float sum = 0.0f;
+				for (const float* row : rows)
+				{
+					sum += row[x0] + row[x] + row[x2];
+				}
+				out[x] = sum * (1.0f / 27.0f);
+			}
+		}
+	}
+}
+
+void VolumeShaderTest::BoxFilter3x3x3(const TiledVolume<float>& source, TiledVolume<float>& destination)
+{
+	const uint32_t TileSize = TiledVolume<float>::TileSize;
+	const uint32_t Block = TileSize + 2;
+
+	uint32_t width = source.GetWidth();
+	uint32_t height = source.GetHeight();
+	uint32_t depth = source.GetDepth();
+	destination.Resize(width, height, depth);
+
+	// Block coordinate b (0 = apron before the tile, Block - 1 = apron after it) maps to a neighbor tile step
+	// and that tile's Morton bits on each axis, so interior tiles gather without any per-voxel index math.
+	int neighbor[Block];
+	uint32_t mortonBits[3][Block];
+	for (uint32_t b = 0; b < Block; ++b)
+	{
+		uint32_t local = (b + TileSize - 1) % TileSize;
+		neighbor[b] = (b == 0) ? -1 : (b == Block - 1 ? 1 : 0);
+		mortonBits[0][b] = static_cast<uint32_t>(MortonEncode3(local, 0, 0));
+		mortonBits[1][b] = static_cast<uint32_t>(MortonEncode3(0, local, 0));
+		mortonBits[2][b] = static_cast<uint32_t>(MortonEncode3(0, 0, local));
+	}
+
+	// Each tile gathers itself plus a one voxel apron into a small linear block, which then filters like the
+	// linear layout without leaving L1. The gather only touches this tile and the 26 around it.
+	float block[Block * Block * Block];
+	const int64_t strideY = source.GetTilesX();
+	const int64_t strideZ = strideY * source.GetTilesY();
+	for (size_t tile = 0; tile < source.GetTileCount(); ++tile)
+	{
+		uint32_t ox, oy, oz;
+		source.GetTileOrigin(tile, ox, oy, oz);
+
+		size_t in = 0;
+		bool interior = ox > 0 && oy > 0 && oz > 0 && ox + TileSize < width && oy + TileSize < height && oz + TileSize < depth;
+		if (interior)
+		{
+			for (uint32_t z = 0; z < Block; ++z)
+			{
+				for (uint32_t y = 0; y < Block; ++y)
+				{
+					const float* tiles[3];
+					for (int dx = -1; dx <= 1; ++dx)
+					{
+						tiles[dx + 1] = source.GetTile(static_cast<size_t>(tile + neighbor[z] * strideZ + neighbor[y] * strideY + dx));
+					}
+
+					uint32_t bitsYZ = mortonBits[1][y] | mortonBits[2][z];
+					for (uint32_t x = 0; x < Block; ++x)
+					{
+						block[in++] = tiles[neighbor[x] + 1][bitsYZ | mortonBits[0][x]];
+					}
+				}
+			}
+		}
+		else
+		{
+			for (uint32_t z = 0; z < Block; ++z)
+			{
+				uint32_t sz = ClampCoord(static_cast<int64_t>(oz) + z - 1, depth);
+				for (uint32_t y = 0; y < Block; ++y)
+				{
+					uint32_t sy = ClampCoord(static_cast<int64_t>(oy) + y - 1, height);
+					for (uint32_t x = 0; x < Block; ++x)
+					{
+						block[in++] = source.At(ClampCoord(static_cast<int64_t>(ox) + x - 1, width), sy, sz);
+					}
+				}
+			}
+		}
+
+		// Filter rows into a linear tile so the inner loop vectorizes, then scatter it into Morton order.
+		float filtered[TileSize];
+		float* out = destination.GetTile(tile);
+		for (uint32_t z = 0; z < TileSize; ++z)
+		{
+			for (uint32_t y = 0; y < TileSize; ++y)
+			{
+				const float* center = block + (static_cast<size_t>(z + 1) * Block + (y + 1)) * Block + 1;
+				for (uint32_t x = 0; x < TileSize; ++x)
+				{
+					filtered[x] = 0.0f;
+				}
+				for (int dz = -1; dz <= 1; ++dz)
+				{
+					for (int dy = -1; dy <= 1; ++dy)
+					{
+						const float* row = center + (dz * static_cast<int>(Block) + dy) * static_cast<int>(Block);
+						for (int x = 0; x < static_cast<int>(TileSize); ++x)
+						{
+							filtered[x] += row[x - 1] + row[x] + row[x + 1];
+						}
+					}
+				}
+
+				uint32_t bitsYZ = mortonBits[1][y + 1] | mortonBits[2][z + 1];
+				for (uint32_t x = 0; x < TileSize; ++x)
+				{
+					out[bitsYZ | mortonBits[0][x + 1]] = filtered[x] * (1.0f / 27.0f);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,181 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define VOLUME_MORTON_BMI2 1
+#else
+#define VOLUME_MORTON_BMI2 0
+#endif
+
+namespace VolumeShaderTest
+{
+	// 3D Morton (Z-order) codes: bit i of x, y and z lands in bits 3i, 3i + 1 and 3i + 2. Coordinates up to 21 bits.
+	// With BMI2 (GCC/Clang -mbmi2, MSVC /arch:AVX2) each direction is a single pdep/pext per axis.
+	const uint64_t MortonMaskX = 0x1249249249249249ull;
+	const uint64_t MortonMaskY = MortonMaskX << 1;
+	const uint64_t MortonMaskZ = MortonMaskX << 2;
+
+	inline uint64_t MortonSpreadBits(uint64_t value)
+	{
+		value &= 0x1FFFFF;
+		value = (value | (value << 32)) & 0x001F00000000FFFFull;
+		value = (value | (value << 16)) & 0x001F0000FF0000FFull;
+		value = (value | (value << 8)) & 0x100F00F00F00F00Full;
+		value = (value | (value << 4)) & 0x10C30C30C30C30C3ull;
+		value = (value | (value << 2)) & MortonMaskX;
+		return value;
+	}
+
+	inline uint32_t MortonCompactBits(uint64_t value)
+	{
+		value &= MortonMaskX;
+		value = (value ^ (value >> 2)) & 0x10C30C30C30C30C3ull;
+		value = (value ^ (value >> 4)) & 0x100F00F00F00F00Full;
+		value = (value ^ (value >> 8)) & 0x001F0000FF0000FFull;
+		value = (value ^ (value >> 16)) & 0x001F00000000FFFFull;
+		value = (value ^ (value >> 32)) & 0x1FFFFF;
+		return static_cast<uint32_t>(value);
+	}
+
+	inline uint64_t MortonEncode3(uint32_t x, uint32_t y, uint32_t z)
+	{
+#if VOLUME_MORTON_BMI2
+		return _pdep_u64(x, MortonMaskX) | _pdep_u64(y, MortonMaskY) | _pdep_u64(z, MortonMaskZ);
+#else
+		return MortonSpreadBits(x) | (MortonSpreadBits(y) << 1) | (MortonSpreadBits(z) << 2);
+#endif
+	}
+
+	inline void MortonDecode3(uint64_t code, uint32_t& x, uint32_t& y, uint32_t& z)
+	{
+#if VOLUME_MORTON_BMI2
+		x = static_cast<uint32_t>(_pext_u64(code, MortonMaskX));
+		y = static_cast<uint32_t>(_pext_u64(code, MortonMaskY));
+		z = static_cast<uint32_t>(_pext_u64(code, MortonMaskZ));
+#else
+		x = MortonCompactBits(code);
+		y = MortonCompactBits(code >> 1);
+		z = MortonCompactBits(code >> 2);
+#endif
+	}
+
+	// Volume stored as 8^3 tiles in x, y, z tile order, with Morton order inside each tile. Neighbors in every
+	// direction are at most a few cache lines away, where the linear layout puts z neighbors a whole slice apart.
+	// Edge tiles are padded to the full size; padding voxels are never visited.
+	template<typename T>
+	class TiledVolume
+	{
+	public:
+		static const uint32_t TileBits = 3;
+		static const uint32_t TileSize = 1u << TileBits;
+		static const uint32_t TileVoxels = TileSize * TileSize * TileSize;
+
+		TiledVolume() : m_width(0), m_height(0), m_depth(0), m_tilesX(0), m_tilesY(0), m_tilesZ(0) {}
+
+		void Resize(uint32_t width, uint32_t height, uint32_t depth)
+		{
+			m_width = width;
+			m_height = height;
+			m_depth = depth;
+			m_tilesX = (width + TileSize - 1) >> TileBits;
+			m_tilesY = (height + TileSize - 1) >> TileBits;
+			m_tilesZ = (depth + TileSize - 1) >> TileBits;
+			m_voxels.assign(static_cast<size_t>(m_tilesX) * m_tilesY * m_tilesZ * TileVoxels, T());
+		}
+
+		uint32_t GetWidth() const { return m_width; }
+		uint32_t GetHeight() const { return m_height; }
+		uint32_t GetDepth() const { return m_depth; }
+		uint32_t GetTilesX() const { return m_tilesX; }
+		uint32_t GetTilesY() const { return m_tilesY; }
+		uint32_t GetTilesZ() const { return m_tilesZ; }
+		size_t GetTileCount() const { return static_cast<size_t>(m_tilesX) * m_tilesY * m_tilesZ; }
+
+		size_t Index(uint32_t x, uint32_t y, uint32_t z) const
+		{
+			const uint32_t mask = TileSize - 1;
+			size_t tile = (static_cast<size_t>(z >> TileBits) * m_tilesY + (y >> TileBits)) * m_tilesX + (x >> TileBits);
+			return (tile << (3 * TileBits)) | static_cast<size_t>(MortonEncode3(x & mask, y & mask, z & mask));
+		}
+
+		T& At(uint32_t x, uint32_t y, uint32_t z) { return m_voxels[Index(x, y, z)]; }
+		const T& At(uint32_t x, uint32_t y, uint32_t z) const { return m_voxels[Index(x, y, z)]; }
+
+		T* GetTile(size_t tile) { return m_voxels.data() + tile * TileVoxels; }
+		const T* GetTile(size_t tile) const { return m_voxels.data() + tile * TileVoxels; }
+
+		// Voxel origin of a tile.
+		void GetTileOrigin(size_t tile, uint32_t& x, uint32_t& y, uint32_t& z) const
+		{
+			x = static_cast<uint32_t>(tile % m_tilesX) << TileBits;
+			y = static_cast<uint32_t>((tile / m_tilesX) % m_tilesY) << TileBits;
+			z = static_cast<uint32_t>(tile / (static_cast<size_t>(m_tilesX) * m_tilesY)) << TileBits;
+		}
+
+		// Visits every voxel inside the volume in memory order: visit(x, y, z, voxel).
+		template<typename Visit>
+		void ForEachVoxel(Visit visit) { VisitVoxels(*this, visit); }
+		template<typename Visit>
+		void ForEachVoxel(Visit visit) const { VisitVoxels(*this, visit); }
+
+		// Copies from and to the x-fastest linear layout the texture upload expects.
+		void FromLinear(const T* source, uint32_t width, uint32_t height, uint32_t depth)
+		{
+			Resize(width, height, depth);
+			ForEachVoxel([&](uint32_t x, uint32_t y, uint32_t z, T& voxel)
+			{
+				voxel = source[(static_cast<size_t>(z) * m_height + y) * m_width + x];
+			});
+		}
+
+		void ToLinear(T* destination) const
+		{
+			ForEachVoxel([&](uint32_t x, uint32_t y, uint32_t z, const T& voxel)
+			{
+				destination[(static_cast<size_t>(z) * m_height + y) * m_width + x] = voxel;
+			});
+		}
+
+	private:
+		template<typename Volume, typename Visit>
+		static void VisitVoxels(Volume& volume, Visit& visit)
+		{
+			for (size_t tile = 0; tile < volume.GetTileCount(); ++tile)
+			{
+				uint32_t ox, oy, oz;
+				volume.GetTileOrigin(tile, ox, oy, oz);
+				bool interior = ox + TileSize <= volume.m_width && oy + TileSize <= volume.m_height && oz + TileSize <= volume.m_depth;
+
+				auto voxels = volume.GetTile(tile);
+				for (uint32_t code = 0; code < TileVoxels; ++code)
+				{
+					uint32_t x, y, z;
+					MortonDecode3(code, x, y, z);
+					x += ox;
+					y += oy;
+					z += oz;
+					if (interior || (x < volume.m_width && y < volume.m_height && z < volume.m_depth))
+					{
+						visit(x, y, z, voxels[code]);
+					}
+				}
+			}
+		}
+
+		uint32_t		m_width;
+		uint32_t		m_height;
+		uint32_t		m_depth;
+		uint32_t		m_tilesX;
+		uint32_t		m_tilesY;
+		uint32_t		m_tilesZ;
+		std::vector<T>	m_voxels;
+	};
+
+	// 3x3x3 mean filter with clamped edges, on both layouts, for comparing their neighborhood access costs.
+	void BoxFilter3x3x3(const float* source, uint32_t width, uint32_t height, uint32_t depth, float* destination);
+	void BoxFilter3x3x3(const TiledVolume<float>& source, TiledVolume<float>& destination);
+}
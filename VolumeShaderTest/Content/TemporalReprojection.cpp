@@ -0,0 +1,131 @@
+﻿#include "pch.h"
+#include "TemporalReprojection.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	inline float Clamp(float value, float lo, float hi)
+	{
+		return (value < lo) ? lo : (value > hi ? hi : value);
+	}
+}
+
+TemporalStats VolumeShaderTest::TemporalResolve(
+	const ReferenceImage& current,
+	const ReferenceImage& history,
+	bool historyValid,
+	const RaymarchCamera& camera,
+	const XMFLOAT4X4& prevWorldViewProjection,
+	const TemporalSettings& settings,
+	ReferenceImage& output)
+{
+	TemporalStats stats = {};
+	output = current;
+
+	bool canReproject = historyValid && history.width == current.width && history.height == current.height;
+	if (!canReproject)
+	{
+		return stats;
+	}
+
+	XMMATRIX prevMatrix = XMLoadFloat4x4(&prevWorldViewProjection);
+
+	for (uint32_t y = 0; y < current.height; ++y)
+	{
+		for (uint32_t x = 0; x < current.width; ++x)
+		{
+			size_t pixel = static_cast<size_t>(y) * current.width + x;
+			if (current.entryDepth[pixel] < 0.0f)
+			{
+				continue;
+			}
+
+			// 1. Representative local-space point of this ray.
+			XMFLOAT3 ro, rd;
+			float tEntry, tExit;
+			ReferenceRaymarcher::ComputeRay(camera, x + 0.5f, y + 0.5f, current.width, current.height, ro, rd, tEntry, tExit);
+			float depth = current.weightedDepth[pixel];
+			XMVECTOR localPoint = XMVectorSet(ro.x + rd.x * depth, ro.y + rd.y * depth, ro.z + rd.z * depth, 1.0f);
+
+			// 2. Project with last frame's matrix.
+			XMVECTOR prevClip = XMVector4Transform(localPoint, prevMatrix);
+			float w = XMVectorGetW(prevClip);
+			float u = (w > 0.0f) ? XMVectorGetX(prevClip) / w * 0.5f + 0.5f : -1.0f;
+			float v = (w > 0.0f) ? -XMVectorGetY(prevClip) / w * 0.5f + 0.5f : -1.0f;
+			if (u < 0.0f || v < 0.0f || u > 1.0f || v > 1.0f)
+			{
+				stats.rejected++;
+				continue;
+			}
+
+			XMFLOAT4 previous = history.SampleColor(u, v);
+			const XMFLOAT4& c = current.color[pixel];
+
+			// 3. Neighborhood clamp against the current frame.
+			if (settings.neighborhoodClamp)
+			{
+				XMFLOAT4 lo = c, hi = c;
+				for (int dy = -1; dy <= 1; ++dy)
+				{
+					for (int dx = -1; dx <= 1; ++dx)
+					{
+						int nx = static_cast<int>(x) + dx;
+						int ny = static_cast<int>(y) + dy;
+						nx = (nx < 0) ? 0 : (nx >= static_cast<int>(current.width) ? current.width - 1 : nx);
+						ny = (ny < 0) ? 0 : (ny >= static_cast<int>(current.height) ? current.height - 1 : ny);
+						const XMFLOAT4& n = current.color[static_cast<size_t>(ny) * current.width + nx];
+						lo = XMFLOAT4((n.x < lo.x) ? n.x : lo.x, (n.y < lo.y) ? n.y : lo.y, (n.z < lo.z) ? n.z : lo.z, (n.w < lo.w) ? n.w : lo.w);
+						hi = XMFLOAT4((n.x > hi.x) ? n.x : hi.x, (n.y > hi.y) ? n.y : hi.y, (n.z > hi.z) ? n.z : hi.z, (n.w > hi.w) ? n.w : hi.w);
+					}
+				}
+
+				XMFLOAT4 clamped(
+					Clamp(previous.x, lo.x, hi.x),
+					Clamp(previous.y, lo.y, hi.y),
+					Clamp(previous.z, lo.z, hi.z),
+					Clamp(previous.w, lo.w, hi.w));
+				if (clamped.x != previous.x || clamped.y != previous.y || clamped.z != previous.z || clamped.w != previous.w)
+				{
+					stats.clamped++;
+				}
+				previous = clamped;
+			}
+
+			float a = settings.blendWeight;
+			output.color[pixel] = XMFLOAT4(
+				previous.x + (c.x - previous.x) * a,
+				previous.y + (c.y - previous.y) * a,
+				previous.z + (c.z - previous.z) * a,
+				previous.w + (c.w - previous.w) * a);
+			stats.reprojected++;
+		}
+	}
+	return stats;
+}
+
+TemporalAccumulator::TemporalAccumulator() :
+	m_historyValid(false)
+{
+	XMStoreFloat4x4(&m_prevWorldViewProjection, XMMatrixIdentity());
+}
+
+void TemporalAccumulator::Reset()
+{
+	m_historyValid = false;
+}
+
+TemporalStats TemporalAccumulator::Accumulate(
+	const ReferenceImage& current,
+	const RaymarchCamera& camera,
+	FXMMATRIX worldViewProjection,
+	const TemporalSettings& settings)
+{
+	TemporalStats stats = TemporalResolve(current, m_history, m_historyValid, camera, m_prevWorldViewProjection, settings, m_resolved);
+
+	std::swap(m_history, m_resolved);
+	XMStoreFloat4x4(&m_prevWorldViewProjection, worldViewProjection);
+	m_historyValid = true;
+	return stats;
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "ReferenceRaymarcher.h"
+
+namespace VolumeShaderTest
+{
+	struct TemporalSettings
+	{
+		TemporalSettings() : blendWeight(0.125f), neighborhoodClamp(true) {}
+
+		float blendWeight;		// Weight of the current frame; the history keeps the rest.
+		bool neighborhoodClamp;	// Clamp the history to the current 3x3 neighborhood to reject stale samples.
+	};
+
+	struct TemporalStats
+	{
+		uint32_t reprojected;	// Pixels that blended a reprojected history sample.
+		uint32_t rejected;		// Pixels whose history fell off screen or behind the camera.
+		uint32_t clamped;		// Reprojected pixels whose history was changed by the neighborhood clamp.
+	};
+
+	// CPU mirror of TemporalResolvePixelShader.hlsl. prevWorldViewProjection is last frame's local-to-clip matrix.
+	TemporalStats TemporalResolve(
+		const ReferenceImage& current,
+		const ReferenceImage& history,
+		bool historyValid,
+		const RaymarchCamera& camera,
+		const DirectX::XMFLOAT4X4& prevWorldViewProjection,
+		const TemporalSettings& settings,
+		ReferenceImage& output);
+
+	// Keeps the history and previous matrix between frames so accumulation can be simulated headlessly.
+	class TemporalAccumulator
+	{
+	public:
+		TemporalAccumulator();
+
+		void Reset();
+
+		// Resolves a new frame against the history; the result becomes the new history.
+		TemporalStats Accumulate(
+			const ReferenceImage& current,
+			const RaymarchCamera& camera,
+			DirectX::FXMMATRIX worldViewProjection,
+			const TemporalSettings& settings);
+
+		const ReferenceImage& GetHistory() const { return m_history; }
+
+	private:
+		ReferenceImage			m_history;
+		ReferenceImage			m_resolved;
+		DirectX::XMFLOAT4X4		m_prevWorldViewProjection;
+		bool					m_historyValid;
+	};
+}
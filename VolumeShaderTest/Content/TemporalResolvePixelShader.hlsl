@@ -0,0 +1,61 @@
+Texture2D<float4> currentColor : register(t0);
+Texture2D<float2> currentRayDepth : register(t1);
+Texture2D<float4> historyColor : register(t2);
+SamplerState linearSampler : register(s0);
+
+#include "ConstantBuffer.hlsli"
+
+struct PixelShaderInput
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+float4 main(PixelShaderInput input) : SV_Target
+{
+    int2 coord = int2(input.position.xy);
+    int2 maxCoord = int2(renderTargetSize.zw) - 1;
+
+    float4 current = currentColor.Load(int3(coord, 0));
+    float2 rayDepth = currentRayDepth.Load(int3(coord, 0));
+
+    // Rays that missed the box, or a history that was just reset, take the current frame as is.
+    if (rayDepth.x < 0.0f || temporalParams.w == 0.0f)
+        return current;
+
+    // 1. Reconstruct the representative local-space point of this ray.
+    float2 ndc = float2(input.position.x / renderTargetSize.z * 2.0f - 1.0f, 1.0f - input.position.y / renderTargetSize.w * 2.0f);
+    float4 farPoint = mul(float4(ndc, 1.0f, 1.0f), invworldviewprojection);
+    float3 localCam = mul(float4(cameraPosition.xyz, 1.0f), invWorldMatrix).xyz;
+    float3 rayDir = normalize(farPoint.xyz / farPoint.w - localCam);
+    float3 localPoint = localCam + rayDir * rayDepth.y;
+
+    // 2. Project it with last frame's matrix; the point is fixed in the volume, so this also follows the rotation.
+    float4 prevClip = mul(float4(localPoint, 1.0f), prevWorldViewProjection);
+    if (prevClip.w <= 0.0f)
+        return current;
+
+    float2 prevUV = float2(prevClip.x / prevClip.w * 0.5f + 0.5f, -prevClip.y / prevClip.w * 0.5f + 0.5f);
+    if (any(prevUV < 0.0f) || any(prevUV > 1.0f))
+        return current;
+
+    float4 history = historyColor.SampleLevel(linearSampler, prevUV, 0);
+
+    // 3. Neighborhood clamp: stale history is pulled into the range of the current 3x3 neighborhood.
+    float4 minColor = current;
+    float4 maxColor = current;
+    [unroll]
+    for (int y = -1; y <= 1; y++)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; x++)
+        {
+            float4 neighbor = currentColor.Load(int3(clamp(coord + int2(x, y), int2(0, 0), maxCoord), 0));
+            minColor = min(minColor, neighbor);
+            maxColor = max(maxColor, neighbor);
+        }
+    }
+    history = clamp(history, minColor, maxColor);
+
+    return lerp(history, current, temporalParams.y);
+}
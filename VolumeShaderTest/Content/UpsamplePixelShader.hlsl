@@ -0,0 +1,75 @@
+Texture2D<float4> volumeColor : register(t0);
+Texture2D<float2> volumeRayDepth : register(t1);
+
+#include "ConstantBuffer.hlsli"
+#include "RayClip.hlsli"
+
+struct PixelShaderInput
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+float2 IntersectBox(float3 ro, float3 rd, float3 boxMin, float3 boxMax)
+{
+    float3 invRd = 1.0f / (rd + 1e-6f);
+    float3 t0 = (boxMin - ro) * invRd;
+    float3 t1 = (boxMax - ro) * invRd;
+    
+    float3 tMin = min(t0, t1);
+    float3 tMax = max(t0, t1);
+    
+    float tNear = max(max(tMin.x, tMin.y), tMin.z);
+    float tFar = min(min(tMax.x, tMax.y), tMax.z);
+    return float2(tNear, tFar);
+}
+
+float4 main(PixelShaderInput input) : SV_Target
+{
+    // 1. Full resolution guide depth: analytic entry into the clipped volume box, no marching.
+    float2 ndc = float2(input.position.x / renderTargetSize.x * 2.0f - 1.0f, 1.0f - input.position.y / renderTargetSize.y * 2.0f);
+    float4 farPoint = mul(float4(ndc, 1.0f, 1.0f), invworldviewprojection);
+    float3 localCam = mul(float4(cameraPosition.xyz, 1.0f), invWorldMatrix).xyz;
+    float3 rayDir = normalize(farPoint.xyz / farPoint.w - localCam);
+
+    float2 t = IntersectBox(localCam, rayDir, float3(-0.5f, -0.5f, -0.5f), float3(0.5f, 0.5f, 0.5f));
+    t = ClipRay(localCam, rayDir, float2(max(t.x, 0.0f), t.y));
+    float tEntry = t.x;
+    if (tEntry > t.y)
+        discard;
+
+    // 2. Bilinear footprint in the reduced resolution target, weighted by entry depth similarity.
+    float2 lowPos = input.position.xy * renderTargetSize.zw / renderTargetSize.xy - 0.5f;
+    float2 base = floor(lowPos);
+    float2 f = lowPos - base;
+    int2 maxCoord = int2(renderTargetSize.zw) - 1;
+
+    float4 sum = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    float weightSum = 0.0f;
+    float bestDiff = 3.402823466e+38f;
+    float4 bestColor = float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    [unroll]
+    for (int tap = 0; tap < 4; tap++)
+    {
+        int2 offset = int2(tap & 1, tap >> 1);
+        int2 coord = clamp(int2(base) + offset, int2(0, 0), maxCoord);
+
+        float4 color = volumeColor.Load(int3(coord, 0));
+        float depthDiff = abs(volumeRayDepth.Load(int3(coord, 0)).x - tEntry);
+        float bilinear = (offset.x ? f.x : 1.0f - f.x) * (offset.y ? f.y : 1.0f - f.y);
+        float weight = bilinear * exp(-depthDiff / upsampleParams.x);
+
+        sum += color * weight;
+        weightSum += weight;
+
+        if (depthDiff < bestDiff)
+        {
+            bestDiff = depthDiff;
+            bestColor = color;
+        }
+    }
+
+    // Fall back to the closest-depth tap when every neighbor is rejected (e.g. along the box silhouette).
+    return (weightSum > 1e-4f) ? sum / weightSum : bestColor;
+}
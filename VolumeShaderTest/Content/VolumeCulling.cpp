@@ -0,0 +1,303 @@
+﻿#include "pch.h"
+#include "VolumeCulling.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+HiZOcclusionBuffer::HiZOcclusionBuffer()
+{
+	XMStoreFloat4x4(&m_worldViewProjection, XMMatrixIdentity());
+}
+
+void HiZOcclusionBuffer::Resize(uint32_t width, uint32_t height)
+{
+	m_levels.clear();
+
+	// Build a full chain down to 1x1 so any rectangle fits into a 2x2 footprint on some level.
+	while (width > 0 && height > 0)
+	{
+		Level level;
+		level.width = width;
+		level.height = height;
+		level.depth.assign(width * height, 1.0f);
+		m_levels.push_back(std::move(level));
+
+		if (width == 1 && height == 1)
+		{
+			break;
+		}
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+}
+
+void HiZOcclusionBuffer::Clear()
+{
+	for (auto& level : m_levels)
+	{
+		std::fill(level.depth.begin(), level.depth.end(), 1.0f);
+	}
+}
+
+void HiZOcclusionBuffer::BuildFromDepth(const float* depth, uint32_t depthWidth, uint32_t depthHeight, FXMMATRIX worldViewProjection)
+{
+	if (m_levels.empty() || depth == nullptr || depthWidth == 0 || depthHeight == 0)
+	{
+		return;
+	}
+	XMStoreFloat4x4(&m_worldViewProjection, worldViewProjection);
+
+	// Each coarse texel keeps the farthest depth of the full resolution pixels it covers.
+	Level& finest = m_levels[0];
+	for (uint32_t y = 0; y < finest.height; ++y)
+	{
+		uint32_t y0 = y * depthHeight / finest.height;
+		uint32_t y1 = (y + 1) * depthHeight / finest.height;
+		y1 = (y1 > y0) ? y1 : y0 + 1;
+
+		for (uint32_t x = 0; x < finest.width; ++x)
+		{
+			uint32_t x0 = x * depthWidth / finest.width;
+			uint32_t x1 = (x + 1) * depthWidth / finest.width;
+			x1 = (x1 > x0) ? x1 : x0 + 1;
+
+			float farthest = 0.0f;
+			for (uint32_t sy = y0; sy < y1 && sy < depthHeight; ++sy)
+			{
+				const float* row = depth + sy * depthWidth;
+				for (uint32_t sx = x0; sx < x1 && sx < depthWidth; ++sx)
+				{
+					farthest = (row[sx] > farthest) ? row[sx] : farthest;
+				}
+			}
+			finest.depth[y * finest.width + x] = farthest;
+		}
+	}
+
+	BuildMipChain();
+}
+
+void HiZOcclusionBuffer::BuildMipChain()
+{
+	for (size_t i = 1; i < m_levels.size(); ++i)
+	{
+		const Level& src = m_levels[i - 1];
+		Level& dst = m_levels[i];
+
+		for (uint32_t y = 0; y < dst.height; ++y)
+		{
+			// Odd source sizes fold the last row/column into the final destination texel.
+			uint32_t sy0 = y * 2;
+			uint32_t sy1 = (y + 1 == dst.height) ? src.height : sy0 + 2;
+
+			for (uint32_t x = 0; x < dst.width; ++x)
+			{
+				uint32_t sx0 = x * 2;
+				uint32_t sx1 = (x + 1 == dst.width) ? src.width : sx0 + 2;
+
+				float farthest = 0.0f;
+				for (uint32_t sy = sy0; sy < sy1 && sy < src.height; ++sy)
+				{
+					for (uint32_t sx = sx0; sx < sx1 && sx < src.width; ++sx)
+					{
+						float d = src.depth[sy * src.width + sx];
+						farthest = (d > farthest) ? d : farthest;
+					}
+				}
+				dst.depth[y * dst.width + x] = farthest;
+			}
+		}
+	}
+}
+
+bool HiZOcclusionBuffer::IsOccluded(float minU, float minV, float maxU, float maxV, float nearestDepth) const
+{
+	if (m_levels.empty())
+	{
+		return false;
+	}
+
+	minU = (minU < 0.0f) ? 0.0f : minU;
+	minV = (minV < 0.0f) ? 0.0f : minV;
+	maxU = (maxU > 1.0f) ? 1.0f : maxU;
+	maxV = (maxV > 1.0f) ? 1.0f : maxV;
+	if (minU >= maxU || minV >= maxV)
+	{
+		return false;
+	}
+
+	// Pick the finest level on which the rectangle covers at most 2x2 texels.
+	size_t levelIndex = 0;
+	for (; levelIndex + 1 < m_levels.size(); ++levelIndex)
+	{
+		const Level& level = m_levels[levelIndex];
+		float texelsX = (maxU - minU) * level.width;
+		float texelsY = (maxV - minV) * level.height;
+		if (texelsX <= 2.0f && texelsY <= 2.0f)
+		{
+			break;
+		}
+	}
+
+	const Level& level = m_levels[levelIndex];
+	uint32_t x0 = static_cast<uint32_t>(minU * level.width);
+	uint32_t y0 = static_cast<uint32_t>(minV * level.height);
+	uint32_t x1 = static_cast<uint32_t>(maxU * level.width);
+	uint32_t y1 = static_cast<uint32_t>(maxV * level.height);
+	x1 = (x1 < level.width) ? x1 : level.width - 1;
+	y1 = (y1 < level.height) ? y1 : level.height - 1;
+
+	for (uint32_t y = y0; y <= y1; ++y)
+	{
+		for (uint32_t x = x0; x <= x1; ++x)
+		{
+			if (nearestDepth <= level.depth[y * level.width + x])
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+VolumeCuller::VolumeCuller()
+{
+	SetWorldViewProjection(XMMatrixIdentity());
+}
+
+void VolumeCuller::SetWorldViewProjection(FXMMATRIX worldViewProjection)
+{
+	// With row vectors, clip = v * M, so each clip component is a dot product with a column of M.
+	XMMATRIX columns = XMMatrixTranspose(worldViewProjection);
+	XMVECTOR planes[6] =
+	{
+		XMVectorAdd(columns.r[3], columns.r[0]),		// Left:   w + x >= 0
+		XMVectorSubtract(columns.r[3], columns.r[0]),	// Right:  w - x >= 0
+		XMVectorAdd(columns.r[3], columns.r[1]),		// Bottom: w + y >= 0
+		XMVectorSubtract(columns.r[3], columns.r[1]),	// Top:    w - y >= 0
+		columns.r[2],									// Near:   z >= 0
+		XMVectorSubtract(columns.r[3], columns.r[2]),	// Far:    w - z >= 0
+	};
+
+	for (int i = 0; i < 6; ++i)
+	{
+		XMStoreFloat4(&m_planes[i], XMPlaneNormalize(planes[i]));
+	}
+}
+
+CullingStats VolumeCuller::Cull(
+	const VolumeBrickBounds* bricks,
+	size_t count,
+	uint8_t* visibility,
+	const HiZOcclusionBuffer* occlusion) const
+{
+	CullingStats stats = {};
+	stats.tested = static_cast<uint32_t>(count);
+
+	// Frustum test in structure-of-arrays form: each XMVECTOR lane holds one of four boxes.
+	for (size_t first = 0; first < count; first += 4)
+	{
+		size_t batch = (count - first < 4) ? count - first : 4;
+
+		float cx[4] = {}, cy[4] = {}, cz[4] = {};
+		float ex[4] = {}, ey[4] = {}, ez[4] = {};
+		for (size_t lane = 0; lane < batch; ++lane)
+		{
+			const VolumeBrickBounds& brick = bricks[first + lane];
+			cx[lane] = brick.center.x;
+			cy[lane] = brick.center.y;
+			cz[lane] = brick.center.z;
+			ex[lane] = brick.extents.x;
+			ey[lane] = brick.extents.y;
+			ez[lane] = brick.extents.z;
+		}
+
+		XMVECTOR centerX = XMVectorSet(cx[0], cx[1], cx[2], cx[3]);
+		XMVECTOR centerY = XMVectorSet(cy[0], cy[1], cy[2], cy[3]);
+		XMVECTOR centerZ = XMVectorSet(cz[0], cz[1], cz[2], cz[3]);
+		XMVECTOR extentX = XMVectorSet(ex[0], ex[1], ex[2], ex[3]);
+		XMVECTOR extentY = XMVectorSet(ey[0], ey[1], ey[2], ey[3]);
+		XMVECTOR extentZ = XMVectorSet(ez[0], ez[1], ez[2], ez[3]);
+
+		XMVECTOR outside = XMVectorFalseInt();
+		for (int i = 0; i < 6; ++i)
+		{
+			const XMFLOAT4& plane = m_planes[i];
+
+			// Signed distance of the box center and the projected radius of the box onto the plane normal.
+			XMVECTOR distance = XMVectorReplicate(plane.w);
+			distance = XMVectorMultiplyAdd(centerX, XMVectorReplicate(plane.x), distance);
+			distance = XMVectorMultiplyAdd(centerY, XMVectorReplicate(plane.y), distance);
+			distance = XMVectorMultiplyAdd(centerZ, XMVectorReplicate(plane.z), distance);
+
+			XMVECTOR radius = XMVectorMultiply(extentX, XMVectorReplicate(fabsf(plane.x)));
+			radius = XMVectorMultiplyAdd(extentY, XMVectorReplicate(fabsf(plane.y)), radius);
+			radius = XMVectorMultiplyAdd(extentZ, XMVectorReplicate(fabsf(plane.z)), radius);
+
+			outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, radius), XMVectorZero()));
+		}
+
+		uint32_t outsideMask[4];
+		XMVectorGetIntPtr(outsideMask, outside);
+
+		for (size_t lane = 0; lane < batch; ++lane)
+		{
+			size_t index = first + lane;
+			if (outsideMask[lane] != 0)
+			{
+				visibility[index] = 0;
+				stats.frustumCulled++;
+			}
+			else if (occlusion != nullptr && !occlusion->IsEmpty() && IsOccluded(bricks[index], *occlusion))
+			{
+				visibility[index] = 0;
+				stats.occlusionCulled++;
+			}
+			else
+			{
+				visibility[index] = 1;
+				stats.visible++;
+			}
+		}
+	}
+
+	return stats;
+}
+
+bool VolumeCuller::IsOccluded(const VolumeBrickBounds& brick, const HiZOcclusionBuffer& occlusion) const
+{
+	// Project with the view the depth was captured from, which may trail the frustum by a few frames.
+	XMMATRIX worldViewProjection = XMLoadFloat4x4(&occlusion.GetWorldViewProjection());
+
+	float minU = 1.0f, minV = 1.0f, maxU = 0.0f, maxV = 0.0f;
+	float nearestDepth = 1.0f;
+
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		XMVECTOR position = XMVectorSet(
+			brick.center.x + ((corner & 1) ? brick.extents.x : -brick.extents.x),
+			brick.center.y + ((corner & 2) ? brick.extents.y : -brick.extents.y),
+			brick.center.z + ((corner & 4) ? brick.extents.z : -brick.extents.z),
+			1.0f);
+		XMVECTOR clip = XMVector4Transform(position, worldViewProjection);
+
+		// A corner behind the eye makes the projected rectangle unbounded; keep the brick.
+		float w = XMVectorGetW(clip);
+		if (w <= 0.0f)
+		{
+			return false;
+		}
+
+		float u = XMVectorGetX(clip) / w * 0.5f + 0.5f;
+		float v = -XMVectorGetY(clip) / w * 0.5f + 0.5f;
+		float depth = XMVectorGetZ(clip) / w;
+
+		minU = (u < minU) ? u : minU;
+		maxU = (u > maxU) ? u : maxU;
+		minV = (v < minV) ? v : minV;
+		maxV = (v > maxV) ? v : maxV;
+		nearestDepth = (depth < nearestDepth) ? depth : nearestDepth;
+	}
+
+	return occlusion.IsOccluded(minU, minV, maxU, maxV, nearestDepth);
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <vector>
+
+namespace VolumeShaderTest
+{
+	// Axis-aligned bounds of one volume brick in the volume's local (object) space.
+	struct VolumeBrickBounds
+	{
+		DirectX::XMFLOAT3 center;
+		DirectX::XMFLOAT3 extents;
+	};
+
+	// Per-frame results of the culling stage.
+	struct CullingStats
+	{
+		uint32_t tested;
+		uint32_t frustumCulled;
+		uint32_t occlusionCulled;
+		uint32_t visible;
+	};
+
+	// Coarse hierarchical-Z buffer built from the depth of opaque geometry.
+	// Each texel of a coarser level holds the farthest depth of the texels it covers,
+	// so a box whose nearest depth is behind that value is guaranteed to be hidden.
+	// The buffer remembers the local-to-clip matrix the depth was rendered with, so depth
+	// read back from the GPU a few frames late is still tested from the view it shows.
+	class HiZOcclusionBuffer
+	{
+	public:
+		HiZOcclusionBuffer();
+
+		// Resizes the finest level and clears every level to the far plane.
+		void Resize(uint32_t width, uint32_t height);
+		void Clear();
+
+		// Downsamples a full resolution depth buffer (0 = near, 1 = far) into the finest level and rebuilds the mip chain.
+		void BuildFromDepth(const float* depth, uint32_t depthWidth, uint32_t depthHeight, DirectX::FXMMATRIX worldViewProjection);
+
+		// Tests a screen rectangle in normalized [0, 1] coordinates against the pyramid.
+		bool IsOccluded(float minU, float minV, float maxU, float maxV, float nearestDepth) const;
+
+		bool IsEmpty() const { return m_levels.empty(); }
+		uint32_t GetWidth() const { return m_levels.empty() ? 0 : m_levels[0].width; }
+		uint32_t GetHeight() const { return m_levels.empty() ? 0 : m_levels[0].height; }
+		const DirectX::XMFLOAT4X4& GetWorldViewProjection() const { return m_worldViewProjection; }
+
+	private:
+		struct Level
+		{
+			uint32_t width;
+			uint32_t height;
+			std::vector<float> depth;
+		};
+
+		void BuildMipChain();
+
+		std::vector<Level> m_levels;
+		DirectX::XMFLOAT4X4 m_worldViewProjection;
+	};
+
+	// Tests brick bounds against the view frustum four boxes at a time, then against the Hi-Z buffer.
+	class VolumeCuller
+	{
+	public:
+		VolumeCuller();
+
+		// Extracts the six clip planes from a local-to-clip matrix (row-vector convention, D3D depth range).
+		void SetWorldViewProjection(DirectX::FXMMATRIX worldViewProjection);
+
+		// Writes 1 into visibility[i] for every brick that survives culling and returns the stats for this pass.
+		// The occlusion buffer is optional; pass nullptr to run frustum culling only. Bricks are tested against it
+		// with its own matrix, not the one given to SetWorldViewProjection.
+		CullingStats Cull(
+			const VolumeBrickBounds* bricks,
+			size_t count,
+			uint8_t* visibility,
+			const HiZOcclusionBuffer* occlusion) const;
+
+	private:
+		bool IsOccluded(const VolumeBrickBounds& brick, const HiZOcclusionBuffer& occlusion) const;
+
+		DirectX::XMFLOAT4	m_planes[6];
+	};
+}
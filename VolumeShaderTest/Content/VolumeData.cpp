@@ -0,0 +1,162 @@
+﻿#include "pch.h"
+#include "VolumeData.h"
+#include <cstring>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+void VolumeData::Resize(uint32_t w, uint32_t h, uint32_t d)
+{
+	width = w;
+	height = h;
+	depth = d;
+	voxels.resize(VoxelCount() * 4);
+}
+
+namespace
+{
+	struct TrilinearTap
+	{
+		size_t index[8];
+		float weight[8];
+	};
+
+	inline int ClampCoord(int value, int size)
+	{
+		return (value < 0) ? 0 : (value >= size ? size - 1 : value);
+	}
+
+	TrilinearTap ComputeTap(const VolumeData& volume, float u, float v, float w)
+	{
+		// Texel centers sit at (i + 0.5) / size, as with D3D11_FILTER_MIN_MAG_MIP_LINEAR.
+		float fx = u * volume.width - 0.5f;
+		float fy = v * volume.height - 0.5f;
+		float fz = w * volume.depth - 0.5f;
+		float bx = floorf(fx);
+		float by = floorf(fy);
+		float bz = floorf(fz);
+		float tx = fx - bx;
+		float ty = fy - by;
+		float tz = fz - bz;
+
+		int x0 = ClampCoord(static_cast<int>(bx), volume.width);
+		int y0 = ClampCoord(static_cast<int>(by), volume.height);
+		int z0 = ClampCoord(static_cast<int>(bz), volume.depth);
+		int x1 = ClampCoord(static_cast<int>(bx) + 1, volume.width);
+		int y1 = ClampCoord(static_cast<int>(by) + 1, volume.height);
+		int z1 = ClampCoord(static_cast<int>(bz) + 1, volume.depth);
+
+		TrilinearTap tap;
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			int x = (corner & 1) ? x1 : x0;
+			int y = (corner & 2) ? y1 : y0;
+			int z = (corner & 4) ? z1 : z0;
+			tap.index[corner] = volume.Index(x, y, z);
+			tap.weight[corner] =
+				((corner & 1) ? tx : 1.0f - tx) *
+				((corner & 2) ? ty : 1.0f - ty) *
+				((corner & 4) ? tz : 1.0f - tz);
+		}
+		return tap;
+	}
+
+	// Hash based noise that gives the sphere its "fog" look.
+	float FractalNoise(float x, float y, float z) {
+		auto hash = [](int n) {
+			n = (n << 13) ^ n;
+			return (1.0f - ((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0f);
+			};
+		float h = hash(static_cast<int>(x + y * 57 + z * 113));
+		float h2 = hash(static_cast<int>(x * 2 + y * 114 + z * 226)) * 0.5f;
+		return (h + h2 + 1.5f) / 3.0f;
+	}
+}
+
+XMFLOAT4 VolumeData::Sample(float u, float v, float w) const
+{
+	TrilinearTap tap = ComputeTap(*this, u, v, w);
+
+	XMFLOAT4 result(0.0f, 0.0f, 0.0f, 0.0f);
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		const float* voxel = &voxels[tap.index[corner]];
+		result.x += voxel[0] * tap.weight[corner];
+		result.y += voxel[1] * tap.weight[corner];
+		result.z += voxel[2] * tap.weight[corner];
+		result.w += voxel[3] * tap.weight[corner];
+	}
+	return result;
+}
+
+float VolumeData::SampleAlpha(float u, float v, float w) const
+{
+	TrilinearTap tap = ComputeTap(*this, u, v, w);
+
+	float result = 0.0f;
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		result += voxels[tap.index[corner] + 3] * tap.weight[corner];
+	}
+	return result;
+}
+
+void VolumeShaderTest::GenerateFogSphereVolume(VolumeData& volume, uint32_t size)
+{
+	const int textureWidth = static_cast<int>(size);
+	const int textureHeight = static_cast<int>(size);
+	const int textureDepth = static_cast<int>(size);
+
+	volume.Resize(size, size, size);
+
+	const float centerX = textureWidth / 2.0f;
+	const float centerY = textureHeight / 2.0f;
+	const float centerZ = textureDepth / 2.0f;
+	const float maxRadius = textureWidth / 2.0f;
+
+	for (int z = 0; z < textureDepth; ++z) {
+		for (int y = 0; y < textureHeight; ++y) {
+			for (int x = 0; x < textureWidth; ++x) {
+				float dx = centerX - (float)x;
+				float dy = centerY - (float)y;
+				float dz = centerZ - (float)z;
+				float dist = sqrt((dx * dx) + (dy * dy) + (dz * dz));
+
+				// FIXED: Using a ternary operator to avoid the std::max macro conflict
+				float rawAlpha = 1.0f - (dist / maxRadius);
+				float sphereAlpha = (rawAlpha > 0.0f) ? rawAlpha : 0.0f;
+
+				// Add fractal noise for the "actual fog" look
+				float noise = FractalNoise((float)x * 0.15f, (float)y * 0.15f, (float)z * 0.15f);
+				float finalAlpha = pow(sphereAlpha * noise, 1.5f);
+
+				// Smooth color blending logic
+				float factor = ((float)(y - x) / 30.0f) * 0.5f + 0.5f;
+				factor = (factor < 0.0f) ? 0.0f : (factor > 1.0f ? 1.0f : factor);
+
+				float r = (1.0f - factor) * 0.0f + factor * 0.4f;
+				float g = (1.0f - factor) * 0.5f + factor * 1.0f;
+				float b = (1.0f - factor) * 0.6f + factor * 0.3f;
+
+				size_t index = volume.Index(x, y, z);
+				volume.voxels[index] = r;
+				volume.voxels[index + 1] = g;
+				volume.voxels[index + 2] = b;
+				volume.voxels[index + 3] = finalAlpha;
+			}
+		}
+	}
+}
+
+bool VolumeShaderTest::LoadRawVolume(const DX::FileView& view, uint32_t width, uint32_t height, uint32_t depth, VolumeData& volume)
+{
+	size_t bytes = static_cast<size_t>(width) * height * depth * 4 * sizeof(float);
+	if (view.Size() != bytes)
+	{
+		return false;
+	}
+
+	volume.Resize(width, height, depth);
+	memcpy(volume.voxels.data(), view.Data(), bytes);
+	return true;
+}
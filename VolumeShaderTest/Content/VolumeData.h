@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <vector>
+#include "Common/FileView.h"
+#include "LinearArena.h"
+
+namespace VolumeShaderTest
+{
+	// CPU copy of an RGBA float volume laid out like the Texture3D upload (x fastest, then y, then z).
+	struct VolumeData
+	{
+		// Voxels come from the arena when one is given, otherwise from the heap.
+		explicit VolumeData(LinearArena* arena = nullptr) : width(0), height(0), depth(0), voxels(ArenaAllocator<float>(arena)) {}
+
+		// New voxels are left uninitialized; every caller overwrites them.
+		void Resize(uint32_t w, uint32_t h, uint32_t d);
+
+		size_t VoxelCount() const { return static_cast<size_t>(width) * height * depth; }
+		size_t Index(uint32_t x, uint32_t y, uint32_t z) const { return ((static_cast<size_t>(z) * height + y) * width + x) * 4; }
+
+		// Trilinear sample with clamp addressing, matching voxelSampler for texture coordinates in [0, 1].
+		DirectX::XMFLOAT4 Sample(float u, float v, float w) const;
+		float SampleAlpha(float u, float v, float w) const;
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		ArenaVector<float> voxels;
+	};
+
+	// Fills the volume with the noisy fog sphere shown by the sample.
+	void GenerateFogSphereVolume(VolumeData& volume, uint32_t size);
+
+	// Fills the volume from raw RGBA float voxels in upload order, copying once out of the view.
+	// Returns false when the view does not hold exactly width * height * depth voxels.
+	bool LoadRawVolume(const DX::FileView& view, uint32_t width, uint32_t height, uint32_t depth, VolumeData& volume);
+}
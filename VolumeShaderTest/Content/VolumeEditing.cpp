@@ -0,0 +1,434 @@
+﻿#include "pch.h"
+#include "VolumeEditing.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+VoxelRegion::VoxelRegion()
+{
+	min[0] = min[1] = min[2] = 0;
+	max[0] = max[1] = max[2] = 0;
+}
+
+VoxelRegion::VoxelRegion(uint32_t minX, uint32_t minY, uint32_t minZ, uint32_t maxX, uint32_t maxY, uint32_t maxZ)
+{
+	min[0] = minX;
+	min[1] = minY;
+	min[2] = minZ;
+	max[0] = maxX;
+	max[1] = maxY;
+	max[2] = maxZ;
+}
+
+uint64_t VoxelRegion::VoxelCount() const
+{
+	return Empty() ? 0 : static_cast<uint64_t>(max[0] - min[0]) * (max[1] - min[1]) * (max[2] - min[2]);
+}
+
+VoxelRegion VolumeShaderTest::UnionRegion(const VoxelRegion& a, const VoxelRegion& b)
+{
+	if (a.Empty())
+	{
+		return b;
+	}
+	if (b.Empty())
+	{
+		return a;
+	}
+
+	VoxelRegion result;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		result.min[axis] = std::min(a.min[axis], b.min[axis]);
+		result.max[axis] = std::max(a.max[axis], b.max[axis]);
+	}
+	return result;
+}
+
+VoxelRegion VolumeShaderTest::IntersectRegion(const VoxelRegion& a, const VoxelRegion& b)
+{
+	VoxelRegion result;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		result.min[axis] = std::max(a.min[axis], b.min[axis]);
+		result.max[axis] = std::min(a.max[axis], b.max[axis]);
+	}
+	return result.Empty() ? VoxelRegion() : result;
+}
+
+DirtyRegionSet::DirtyRegionSet(uint32_t maxRegions, float mergeSlack) :
+	m_maxRegions(maxRegions < 1 ? 1 : maxRegions),
+	m_mergeSlack(mergeSlack < 0.0f ? 0.0f : mergeSlack)
+{
+}
+
+uint64_t DirtyRegionSet::MergeWaste(const VoxelRegion& a, const VoxelRegion& b)
+{
+	uint64_t covered = a.VoxelCount() + b.VoxelCount() - IntersectRegion(a, b).VoxelCount();
+	return UnionRegion(a, b).VoxelCount() - covered;
+}
+
+void DirtyRegionSet::Insert(VoxelRegion region)
+{
+	// A merge can make the grown box worth merging with boxes it was skipped for, so rescan after each one.
+	size_t i = 0;
+	while (i < m_regions.size())
+	{
+		const VoxelRegion& other = m_regions[i];
+		uint64_t covered = region.VoxelCount() + other.VoxelCount() - IntersectRegion(region, other).VoxelCount();
+		if (MergeWaste(region, other) <= static_cast<uint64_t>(covered * m_mergeSlack))
+		{
+			region = UnionRegion(region, other);
+			m_regions[i] = m_regions.back();
+			m_regions.pop_back();
+			i = 0;
+		}
+		else
+		{
+			++i;
+		}
+	}
+	m_regions.push_back(region);
+}
+
+void DirtyRegionSet::Add(const VoxelRegion& region)
+{
+	if (region.Empty())
+	{
+		return;
+	}
+
+	Insert(region);
+
+	// Over the limit, give up the fewest extra voxels. Each round removes at least one box.
+	while (m_regions.size() > m_maxRegions)
+	{
+		size_t bestA = 0;
+		size_t bestB = 1;
+		uint64_t bestWaste = UINT64_MAX;
+		for (size_t a = 0; a < m_regions.size(); ++a)
+		{
+			for (size_t b = a + 1; b < m_regions.size(); ++b)
+			{
+				uint64_t waste = MergeWaste(m_regions[a], m_regions[b]);
+				if (waste < bestWaste)
+				{
+					bestWaste = waste;
+					bestA = a;
+					bestB = b;
+				}
+			}
+		}
+
+		VoxelRegion merged = UnionRegion(m_regions[bestA], m_regions[bestB]);
+		m_regions.erase(m_regions.begin() + bestB);
+		m_regions.erase(m_regions.begin() + bestA);
+		Insert(merged);
+	}
+}
+
+uint64_t DirtyRegionSet::GetVoxelCount() const
+{
+	uint64_t count = 0;
+	for (const VoxelRegion& region : m_regions)
+	{
+		count += region.VoxelCount();
+	}
+	return count;
+}
+
+VolumeMipChain::VolumeMipChain()
+{
+}
+
+void VolumeMipChain::Build()
+{
+	m_coarser.clear();
+	if (m_base.VoxelCount() == 0)
+	{
+		return;
+	}
+
+	uint32_t size[3] = { m_base.width, m_base.height, m_base.depth };
+	while (size[0] > 1 || size[1] > 1 || size[2] > 1)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			size[axis] = (size[axis] > 1) ? size[axis] / 2 : 1;
+		}
+		m_coarser.emplace_back();
+		m_coarser.back().Resize(size[0], size[1], size[2]);
+	}
+
+	for (uint32_t level = 1; level < GetLevelCount(); ++level)
+	{
+		const VolumeData& target = GetLevel(level);
+		Downsample(level, VoxelRegion(0, 0, 0, target.width, target.height, target.depth));
+	}
+}
+
+void VolumeMipChain::Update(const VoxelRegion& region, std::vector<VoxelRegion>& levelRegions)
+{
+	levelRegions.clear();
+	VoxelRegion current = IntersectRegion(region, VoxelRegion(0, 0, 0, m_base.width, m_base.height, m_base.depth));
+	levelRegions.push_back(current);
+
+	// Texel p of a coarser level reads texels 2p and 2p + 1 below it.
+	for (uint32_t level = 1; level < GetLevelCount(); ++level)
+	{
+		const VolumeData& target = GetLevel(level);
+		uint32_t size[3] = { target.width, target.height, target.depth };
+		VoxelRegion parent;
+		if (!current.Empty())
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				parent.min[axis] = current.min[axis] / 2;
+				parent.max[axis] = std::min((current.max[axis] + 1) / 2, size[axis]);
+			}
+		}
+		current = parent.Empty() ? VoxelRegion() : parent;
+		Downsample(level, current);
+		levelRegions.push_back(current);
+	}
+}
+
+void VolumeMipChain::Downsample(uint32_t level, const VoxelRegion& region)
+{
+	const VolumeData& source = GetLevel(level - 1);
+	VolumeData& target = m_coarser[level - 1];
+	for (uint32_t z = region.min[2]; z < region.max[2]; ++z)
+	{
+		for (uint32_t y = region.min[1]; y < region.max[1]; ++y)
+		{
+			for (uint32_t x = region.min[0]; x < region.max[0]; ++x)
+			{
+				float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (uint32_t corner = 0; corner < 8; ++corner)
+				{
+					uint32_t sx = std::min(2 * x + (corner & 1), source.width - 1);
+					uint32_t sy = std::min(2 * y + ((corner >> 1) & 1), source.height - 1);
+					uint32_t sz = std::min(2 * z + (corner >> 2), source.depth - 1);
+					const float* texel = source.voxels.data() + source.Index(sx, sy, sz);
+					for (int c = 0; c < 4; ++c)
+					{
+						sum[c] += texel[c];
+					}
+				}
+
+				float* out = target.voxels.data() + target.Index(x, y, z);
+				for (int c = 0; c < 4; ++c)
+				{
+					out[c] = sum[c] * 0.125f;
+				}
+			}
+		}
+	}
+}
+
+VolumeEditor::VolumeEditor(const VolumeEditorSettings& settings) :
+	m_settings(settings),
+	m_pending(settings.maxRegions, settings.mergeSlack),
+	m_journal(settings.journal),
+	m_strokeOpen(false)
+{
+}
+
+void VolumeEditor::Rebuild()
+{
+	const VolumeData& volume = GetVolume();
+	m_mips.Build();
+	BuildGradientVolume(volume.voxels.data() + 3, 4, volume.width, volume.height, volume.depth, m_settings.gradients, m_gradients);
+	BuildDistanceField(volume, m_settings.distanceField, m_distanceField);
+	m_pending.Clear();
+	m_journal.Reset(volume);
+	m_strokeOpen = false;
+}
+
+VoxelRegion VolumeEditor::Apply(const VolumeBrush& brush)
+{
+	VolumeData& volume = GetVolume();
+	const float center[3] = { brush.center.x, brush.center.y, brush.center.z };
+	const float extents[3] = { std::max(brush.extents.x, 1e-3f), std::max(brush.extents.y, 1e-3f), std::max(brush.extents.z, 1e-3f) };
+	const float color[3] = { brush.color.x, brush.color.y, brush.color.z };
+	const uint32_t size[3] = { volume.width, volume.height, volume.depth };
+
+	// Voxels strictly inside the shape; the strength is 0 on its surface.
+	VoxelRegion region;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		double low = floor(center[axis] - extents[axis]) + 1.0;
+		double high = ceil(center[axis] + extents[axis]);
+		low = (low < 0.0) ? 0.0 : low;
+		high = (high > size[axis]) ? size[axis] : high;
+		if (low >= high)
+		{
+			return VoxelRegion();
+		}
+		region.min[axis] = static_cast<uint32_t>(low);
+		region.max[axis] = static_cast<uint32_t>(high);
+	}
+
+	m_journal.BeforeEdit(volume, region);
+	float softness = (brush.softness < 0.0f) ? 0.0f : (brush.softness > 1.0f ? 1.0f : brush.softness);
+	for (uint32_t z = region.min[2]; z < region.max[2]; ++z)
+	{
+		float dz = (z - center[2]) / extents[2];
+		for (uint32_t y = region.min[1]; y < region.max[1]; ++y)
+		{
+			float dy = (y - center[1]) / extents[1];
+			float* row = volume.voxels.data() + volume.Index(0, y, z);
+			for (uint32_t x = region.min[0]; x < region.max[0]; ++x)
+			{
+				float dx = (x - center[0]) / extents[0];
+				float distance = (brush.shape == BrushShape::Sphere) ?
+					sqrtf(dx * dx + dy * dy + dz * dz) :
+					std::max(std::max(fabsf(dx), fabsf(dy)), fabsf(dz));
+				if (distance >= 1.0f)
+				{
+					continue;
+				}
+
+				float strength = (softness > 0.0f) ? std::min((1.0f - distance) / softness, 1.0f) : 1.0f;
+				float* voxel = row + static_cast<size_t>(x) * 4;
+				switch (brush.mode)
+				{
+				case BrushMode::Add:
+				{
+					float alpha = voxel[3];
+					float total = std::min(alpha + strength * brush.density, 1.0f);
+					if (total > alpha)
+					{
+						for (int c = 0; c < 3; ++c)
+						{
+							voxel[c] = (voxel[c] * alpha + color[c] * (total - alpha)) / total;
+						}
+						voxel[3] = total;
+					}
+					break;
+				}
+
+				case BrushMode::Subtract:
+					voxel[3] = std::max(voxel[3] - strength * brush.density, 0.0f);
+					break;
+
+				case BrushMode::Paint:
+					for (int c = 0; c < 3; ++c)
+					{
+						voxel[c] += (color[c] - voxel[c]) * strength;
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	m_pending.Add(region);
+	if (!m_strokeOpen)
+	{
+		m_journal.CloseStep(volume);
+	}
+	return region;
+}
+
+void VolumeEditor::BeginStroke()
+{
+	// Dabs before the stroke stay a step of their own.
+	m_journal.CloseStep(GetVolume());
+	m_strokeOpen = true;
+}
+
+void VolumeEditor::EndStroke()
+{
+	m_journal.CloseStep(GetVolume());
+	m_strokeOpen = false;
+}
+
+VoxelRegion VolumeEditor::Undo()
+{
+	m_strokeOpen = false;
+	std::vector<VoxelRegion> restored;
+	VoxelRegion bounds;
+	if (m_journal.Undo(GetVolume(), restored))
+	{
+		for (const VoxelRegion& region : restored)
+		{
+			m_pending.Add(region);
+			bounds = UnionRegion(bounds, region);
+		}
+	}
+	return bounds;
+}
+
+VoxelRegion VolumeEditor::Redo()
+{
+	m_strokeOpen = false;
+	std::vector<VoxelRegion> restored;
+	VoxelRegion bounds;
+	if (m_journal.Redo(GetVolume(), restored))
+	{
+		for (const VoxelRegion& region : restored)
+		{
+			m_pending.Add(region);
+			bounds = UnionRegion(bounds, region);
+		}
+	}
+	return bounds;
+}
+
+void VolumeEditor::Commit(VolumeEditChanges& changes)
+{
+	uint32_t levelCount = m_mips.GetLevelCount();
+	changes.levels.assign(levelCount, std::vector<VoxelRegion>());
+	changes.gradients.clear();
+	changes.distanceField = false;
+	if (m_pending.Empty())
+	{
+		return;
+	}
+
+	const VolumeData& volume = GetVolume();
+	const uint32_t size[3] = { volume.width, volume.height, volume.depth };
+	std::vector<DirtyRegionSet> levelSets(levelCount, DirtyRegionSet(m_settings.maxRegions, m_settings.mergeSlack));
+	DirtyRegionSet gradientSet(m_settings.maxRegions, m_settings.mergeSlack);
+	std::vector<VoxelRegion> levelRegions;
+	bool occupancyChanged = false;
+	for (const VoxelRegion& region : m_pending.GetRegions())
+	{
+		m_mips.Update(region, levelRegions);
+		for (uint32_t level = 0; level < levelCount; ++level)
+		{
+			levelSets[level].Add(levelRegions[level]);
+		}
+
+		// The Sobel filter reads one voxel around each texel, so the gradients change one voxel past the edit.
+		if (!m_gradients.empty())
+		{
+			VoxelRegion grown;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				grown.min[axis] = (region.min[axis] > 0) ? region.min[axis] - 1 : 0;
+				grown.max[axis] = std::min(region.max[axis] + 1, size[axis]);
+			}
+			UpdateGradientRegion(volume.voxels.data() + 3, 4, size[0], size[1], size[2], grown.min, grown.max, m_settings.gradients, m_gradients);
+			gradientSet.Add(grown);
+		}
+
+		occupancyChanged |= UpdateOccupancy(volume, m_settings.distanceField, region.min, region.max, m_distanceField);
+	}
+
+	if (occupancyChanged)
+	{
+		RecomputeDistances(m_settings.distanceField, m_distanceField);
+	}
+
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		changes.levels[level] = levelSets[level].GetRegions();
+	}
+	changes.gradients = gradientSet.GetRegions();
+	changes.distanceField = occupancyChanged;
+	m_pending.Clear();
+}
@@ -0,0 +1,196 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "VolumeData.h"
+#include "DistanceField.h"
+#include "GradientVolume.h"
+#include "EditJournal.h"
+
+namespace VolumeShaderTest
+{
+	// Box of voxels [min, max) along each axis.
+	struct VoxelRegion
+	{
+		VoxelRegion();
+		VoxelRegion(uint32_t minX, uint32_t minY, uint32_t minZ, uint32_t maxX, uint32_t maxY, uint32_t maxZ);
+
+		bool Empty() const { return min[0] >= max[0] || min[1] >= max[1] || min[2] >= max[2]; }
+		uint64_t VoxelCount() const;
+
+		uint32_t min[3];
+		uint32_t max[3];
+	};
+
+	VoxelRegion UnionRegion(const VoxelRegion& a, const VoxelRegion& b);
+	VoxelRegion IntersectRegion(const VoxelRegion& a, const VoxelRegion& b);
+
+	// Boxes touched since the last upload. A new box is merged with any box whose union costs little extra upload,
+	// and past maxRegions the cheapest pair is merged, so a brush stroke collapses into a few boxes and the number
+	// of UpdateSubresource calls per frame stays bounded. Boxes may overlap; uploading both copies the shared voxels
+	// twice, which is harmless since they read the same source.
+	class DirtyRegionSet
+	{
+	public:
+		// mergeSlack is the fraction of extra voxels a merge may add on top of the voxels the two boxes cover.
+		explicit DirtyRegionSet(uint32_t maxRegions = 16, float mergeSlack = 0.25f);
+
+		void Add(const VoxelRegion& region);
+		void Clear() { m_regions.clear(); }
+
+		bool Empty() const { return m_regions.empty(); }
+		const std::vector<VoxelRegion>& GetRegions() const { return m_regions; }
+
+		// Sum over the boxes, so voxels in an overlap count once per box.
+		uint64_t GetVoxelCount() const;
+
+	private:
+		void Insert(VoxelRegion region);
+
+		// Voxels the union of a and b covers beyond the voxels of a and b themselves.
+		static uint64_t MergeWaste(const VoxelRegion& a, const VoxelRegion& b);
+
+		uint32_t					m_maxRegions;
+		float						m_mergeSlack;
+		std::vector<VoxelRegion>	m_regions;
+	};
+
+	// Box filtered mip levels of an RGBA volume, level 0 being the volume itself. Each level is half the one below
+	// rounded down (at least 1) along each axis, like a Texture3D mip chain, and each texel averages the 2x2x2 texels
+	// under it with clamped addressing.
+	class VolumeMipChain
+	{
+	public:
+		VolumeMipChain();
+
+		// Level 0, filled by the caller before Build. It is kept apart from the coarser levels so references to it
+		// survive rebuilding them.
+		VolumeData& GetBase() { return m_base; }
+		const VolumeData& GetLevel(uint32_t level) const { return (level == 0) ? m_base : m_coarser[level - 1]; }
+		uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_coarser.size()) + 1; }
+
+		void Build();
+
+		// Refilters the texels of every coarser level that cover region of level 0. levelRegions[i] receives the box
+		// changed in level i, starting with region itself.
+		void Update(const VoxelRegion& region, std::vector<VoxelRegion>& levelRegions);
+
+	private:
+		void Downsample(uint32_t level, const VoxelRegion& region);
+
+		VolumeData				m_base;
+		std::vector<VolumeData>	m_coarser;
+	};
+
+	enum class BrushShape
+	{
+		Sphere,
+		Box,
+	};
+
+	enum class BrushMode
+	{
+		Add,		// Adds density, mixing the brush color into the voxel by the share of density it adds.
+		Subtract,	// Removes density and leaves the color.
+		Paint,		// Blends the color toward the brush color and leaves the density.
+	};
+
+	// One dab of an editing brush. Positions and sizes are in voxels, voxel i being centered at i.
+	struct VolumeBrush
+	{
+		VolumeBrush() :
+			shape(BrushShape::Sphere),
+			mode(BrushMode::Add),
+			center(0.0f, 0.0f, 0.0f),
+			extents(8.0f, 8.0f, 8.0f),
+			color(1.0f, 1.0f, 1.0f),
+			density(1.0f),
+			softness(0.25f)
+		{
+		}
+
+		BrushShape shape;
+		BrushMode mode;
+		DirectX::XMFLOAT3 center;
+		DirectX::XMFLOAT3 extents;	// Radii of the ellipsoid, or half sizes of the box.
+		DirectX::XMFLOAT3 color;
+		float density;				// Opacity added or removed at full strength.
+		float softness;				// Fraction of the extents over which the strength falls to 0 at the edge.
+	};
+
+	// Regions of each derived texture changed by VolumeEditor::Commit, ready to upload.
+	struct VolumeEditChanges
+	{
+		VolumeEditChanges() : distanceField(false) {}
+
+		std::vector<std::vector<VoxelRegion>> levels;	// One list per mip level.
+		std::vector<VoxelRegion> gradients;
+		bool distanceField;								// The whole field changed.
+	};
+
+	// GPU copies made for the edits committed in one frame.
+	struct VolumeUploadStats
+	{
+		uint32_t regions;
+		uint64_t bytes;
+		double commitMilliseconds;	// CPU time spent refreshing the derived data.
+	};
+
+	struct VolumeEditorSettings
+	{
+		VolumeEditorSettings() : maxRegions(16), mergeSlack(0.25f) {}
+
+		DistanceFieldSettings distanceField;
+		GradientBuildSettings gradients;
+		EditJournalSettings journal;
+		uint32_t maxRegions;	// Per texture level, see DirtyRegionSet.
+		float mergeSlack;
+	};
+
+	// Owns an editable volume and everything derived from it: the mip chain, the gradient texels and the empty
+	// space distance field. Apply only changes voxels and remembers the box; Commit folds the boxes gathered since
+	// the last call into a few coalesced regions and refreshes the derived data over those alone.
+	//
+	// Every dab is an undo step of its own unless it falls between BeginStroke and EndStroke. Undo and Redo put
+	// back the touched bricks and leave them pending for the next Commit like any other edit.
+	class VolumeEditor
+	{
+	public:
+		explicit VolumeEditor(const VolumeEditorSettings& settings = VolumeEditorSettings());
+
+		// Fill the volume, then call Rebuild.
+		VolumeData& GetVolume() { return m_mips.GetBase(); }
+		const VolumeData& GetVolume() const { return m_mips.GetLevel(0); }
+
+		// Recomputes all derived data and drops pending edits.
+		void Rebuild();
+
+		// Returns the box of voxels the dab may have changed, empty when it misses the volume.
+		VoxelRegion Apply(const VolumeBrush& brush);
+
+		void BeginStroke();
+		void EndStroke();
+
+		// Return the bounds of the restored bricks, empty when there was nothing to undo or redo.
+		VoxelRegion Undo();
+		VoxelRegion Redo();
+		EditJournalStats GetJournalStats() const { return m_journal.GetStats(); }
+
+		bool HasPendingEdits() const { return !m_pending.Empty(); }
+		void Commit(VolumeEditChanges& changes);
+
+		const VolumeMipChain& GetMipChain() const { return m_mips; }
+		const std::vector<uint32_t>& GetGradients() const { return m_gradients; }
+		const DistanceField& GetDistanceField() const { return m_distanceField; }
+		const VolumeEditorSettings& GetSettings() const { return m_settings; }
+
+	private:
+		VolumeEditorSettings	m_settings;
+		VolumeMipChain			m_mips;
+		std::vector<uint32_t>	m_gradients;
+		DistanceField			m_distanceField;
+		DirtyRegionSet			m_pending;
+		EditJournal				m_journal;
+		bool					m_strokeOpen;
+	};
+}
@@ -0,0 +1,595 @@
+﻿#pragma once
+
+// Scalar fallback for the subset of DirectXMath used by the platform-neutral sources.
+// Only used by the CMake build when the real DirectXMath package cannot be found; the
+// semantics (row vectors, left-handed projections, 0..1 depth) match the library's
+// _XM_NO_INTRINSICS_ path so results agree with the Windows build.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace DirectX
+{
+	const float XM_PI = 3.141592654f;
+	const float XM_2PI = 6.283185307f;
+	const float XM_1DIVPI = 0.318309886f;
+	const float XM_PIDIV2 = 1.570796327f;
+	const float XM_PIDIV4 = 0.785398163f;
+
+	struct XMVECTOR
+	{
+		union
+		{
+			float vector4_f32[4];
+			uint32_t vector4_u32[4];
+		};
+	};
+
+	typedef const XMVECTOR& FXMVECTOR;
+	typedef const XMVECTOR& GXMVECTOR;
+	typedef const XMVECTOR& HXMVECTOR;
+	typedef const XMVECTOR& CXMVECTOR;
+
+	struct XMMATRIX
+	{
+		XMVECTOR r[4];
+	};
+
+	typedef const XMMATRIX& FXMMATRIX;
+	typedef const XMMATRIX& CXMMATRIX;
+
+	struct XMVECTORF32
+	{
+		union
+		{
+			float f[4];
+			XMVECTOR v;
+		};
+
+		operator XMVECTOR() const { return v; }
+		operator const float*() const { return f; }
+	};
+
+	struct XMVECTORU32
+	{
+		union
+		{
+			uint32_t u[4];
+			XMVECTOR v;
+		};
+
+		operator XMVECTOR() const { return v; }
+	};
+
+	struct XMFLOAT2
+	{
+		float x, y;
+
+		XMFLOAT2() = default;
+		XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+
+		XMFLOAT3() = default;
+		XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+
+		XMFLOAT4() = default;
+		XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct XMUINT3
+	{
+		uint32_t x, y, z;
+
+		XMUINT3() = default;
+		XMUINT3(uint32_t _x, uint32_t _y, uint32_t _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4X4
+	{
+		float m[4][4];
+
+		XMFLOAT4X4() = default;
+		float operator()(size_t row, size_t column) const { return m[row][column]; }
+		float& operator()(size_t row, size_t column) { return m[row][column]; }
+	};
+
+	inline float XMConvertToRadians(float degrees) { return degrees * (XM_PI / 180.0f); }
+	inline float XMConvertToDegrees(float radians) { return radians * (180.0f / XM_PI); }
+
+	// Vector construction and access.
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w)
+	{
+		XMVECTOR result;
+		result.vector4_f32[0] = x;
+		result.vector4_f32[1] = y;
+		result.vector4_f32[2] = z;
+		result.vector4_f32[3] = w;
+		return result;
+	}
+
+	inline XMVECTOR XMVectorZero() { return XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f); }
+	inline XMVECTOR XMVectorReplicate(float value) { return XMVectorSet(value, value, value, value); }
+
+	inline XMVECTOR XMVectorFalseInt()
+	{
+		XMVECTOR result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.vector4_u32[i] = 0;
+		}
+		return result;
+	}
+
+	inline float XMVectorGetX(FXMVECTOR v) { return v.vector4_f32[0]; }
+	inline float XMVectorGetY(FXMVECTOR v) { return v.vector4_f32[1]; }
+	inline float XMVectorGetZ(FXMVECTOR v) { return v.vector4_f32[2]; }
+	inline float XMVectorGetW(FXMVECTOR v) { return v.vector4_f32[3]; }
+
+	inline void XMVectorGetIntPtr(uint32_t* x, FXMVECTOR v)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			x[i] = v.vector4_u32[i];
+		}
+	}
+
+	// Component-wise arithmetic.
+
+	inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.vector4_f32[i] = a.vector4_f32[i] + b.vector4_f32[i];
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.vector4_f32[i] = a.vector4_f32[i] - b.vector4_f32[i];
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.vector4_f32[i] = a.vector4_f32[i] * b.vector4_f32[i];
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c)
+	{
+		XMVECTOR result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.vector4_f32[i] = a.vector4_f32[i] * b.vector4_f32[i] + c.vector4_f32[i];
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMVectorScale(FXMVECTOR v, float scale)
+	{
+		return XMVectorMultiply(v, XMVectorReplicate(scale));
+	}
+
+	inline XMVECTOR XMVectorNegate(FXMVECTOR v)
+	{
+		return XMVectorSubtract(XMVectorZero(), v);
+	}
+
+	inline XMVECTOR XMVectorLess(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.vector4_u32[i] = (a.vector4_f32[i] < b.vector4_f32[i]) ? 0xFFFFFFFFu : 0u;
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMVectorOrInt(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.vector4_u32[i] = a.vector4_u32[i] | b.vector4_u32[i];
+		}
+		return result;
+	}
+
+	inline XMVECTOR operator+(FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+	inline XMVECTOR operator-(FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+	inline XMVECTOR operator*(FXMVECTOR a, FXMVECTOR b) { return XMVectorMultiply(a, b); }
+	inline XMVECTOR operator*(FXMVECTOR v, float s) { return XMVectorScale(v, s); }
+	inline XMVECTOR operator*(float s, FXMVECTOR v) { return XMVectorScale(v, s); }
+	inline XMVECTOR operator-(FXMVECTOR v) { return XMVectorNegate(v); }
+
+	// 3D and 4D vector operations.
+
+	inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorReplicate(
+			a.vector4_f32[0] * b.vector4_f32[0] +
+			a.vector4_f32[1] * b.vector4_f32[1] +
+			a.vector4_f32[2] * b.vector4_f32[2]);
+	}
+
+	inline XMVECTOR XMVector4Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorReplicate(
+			a.vector4_f32[0] * b.vector4_f32[0] +
+			a.vector4_f32[1] * b.vector4_f32[1] +
+			a.vector4_f32[2] * b.vector4_f32[2] +
+			a.vector4_f32[3] * b.vector4_f32[3]);
+	}
+
+	inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorSet(
+			a.vector4_f32[1] * b.vector4_f32[2] - a.vector4_f32[2] * b.vector4_f32[1],
+			a.vector4_f32[2] * b.vector4_f32[0] - a.vector4_f32[0] * b.vector4_f32[2],
+			a.vector4_f32[0] * b.vector4_f32[1] - a.vector4_f32[1] * b.vector4_f32[0],
+			0.0f);
+	}
+
+	inline XMVECTOR XMVector3Length(FXMVECTOR v)
+	{
+		return XMVectorReplicate(std::sqrt(XMVectorGetX(XMVector3Dot(v, v))));
+	}
+
+	inline XMVECTOR XMVector3Normalize(FXMVECTOR v)
+	{
+		float length = XMVectorGetX(XMVector3Length(v));
+		return (length > 0.0f) ? XMVectorScale(v, 1.0f / length) : v;
+	}
+
+	inline XMVECTOR XMVector4Transform(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR result = XMVectorZero();
+		for (int row = 0; row < 4; ++row)
+		{
+			result = XMVectorMultiplyAdd(XMVectorReplicate(v.vector4_f32[row]), m.r[row], result);
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMVector3Transform(FXMVECTOR v, FXMMATRIX m)
+	{
+		return XMVector4Transform(XMVectorSet(XMVectorGetX(v), XMVectorGetY(v), XMVectorGetZ(v), 1.0f), m);
+	}
+
+	inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR result = XMVector3Transform(v, m);
+		return XMVectorScale(result, 1.0f / XMVectorGetW(result));
+	}
+
+	inline XMVECTOR XMVector3TransformNormal(FXMVECTOR v, FXMMATRIX m)
+	{
+		return XMVector4Transform(XMVectorSet(XMVectorGetX(v), XMVectorGetY(v), XMVectorGetZ(v), 0.0f), m);
+	}
+
+	inline XMVECTOR XMPlaneNormalize(FXMVECTOR p)
+	{
+		float length = XMVectorGetX(XMVector3Length(p));
+		return XMVectorScale(p, (length > 0.0f) ? 1.0f / length : 0.0f);
+	}
+
+	inline XMVECTOR XMQuaternionNormalize(FXMVECTOR q)
+	{
+		float length = std::sqrt(XMVectorGetX(XMVector4Dot(q, q)));
+		return (length > 0.0f) ? XMVectorScale(q, 1.0f / length) : q;
+	}
+
+	inline XMVECTOR XMQuaternionRotationAxis(FXMVECTOR axis, float angle)
+	{
+		XMVECTOR n = XMVector3Normalize(axis);
+		float s = std::sin(0.5f * angle);
+		return XMVectorSet(XMVectorGetX(n) * s, XMVectorGetY(n) * s, XMVectorGetZ(n) * s, std::cos(0.5f * angle));
+	}
+
+	// Loads and stores.
+
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) { return XMVectorSet(source->x, source->y, source->z, 0.0f); }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return XMVectorSet(source->x, source->y, source->z, source->w); }
+
+	inline void XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v)
+	{
+		destination->x = v.vector4_f32[0];
+		destination->y = v.vector4_f32[1];
+		destination->z = v.vector4_f32[2];
+	}
+
+	inline void XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v)
+	{
+		destination->x = v.vector4_f32[0];
+		destination->y = v.vector4_f32[1];
+		destination->z = v.vector4_f32[2];
+		destination->w = v.vector4_f32[3];
+	}
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source)
+	{
+		XMMATRIX result;
+		for (int row = 0; row < 4; ++row)
+		{
+			result.r[row] = XMVectorSet(source->m[row][0], source->m[row][1], source->m[row][2], source->m[row][3]);
+		}
+		return result;
+	}
+
+	inline void XMStoreFloat4x4(XMFLOAT4X4* destination, FXMMATRIX m)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				destination->m[row][column] = m.r[row].vector4_f32[column];
+			}
+		}
+	}
+
+	// Matrices.
+
+	inline XMMATRIX XMMatrixSet(
+		float m00, float m01, float m02, float m03,
+		float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23,
+		float m30, float m31, float m32, float m33)
+	{
+		XMMATRIX result;
+		result.r[0] = XMVectorSet(m00, m01, m02, m03);
+		result.r[1] = XMVectorSet(m10, m11, m12, m13);
+		result.r[2] = XMVectorSet(m20, m21, m22, m23);
+		result.r[3] = XMVectorSet(m30, m31, m32, m33);
+		return result;
+	}
+
+	inline XMMATRIX XMMatrixIdentity()
+	{
+		return XMMatrixSet(
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b)
+	{
+		XMMATRIX result;
+		for (int row = 0; row < 4; ++row)
+		{
+			result.r[row] = XMVector4Transform(a.r[row], b);
+		}
+		return result;
+	}
+
+	inline XMMATRIX operator*(FXMMATRIX a, CXMMATRIX b) { return XMMatrixMultiply(a, b); }
+
+	inline XMMATRIX XMMatrixTranspose(FXMMATRIX m)
+	{
+		XMMATRIX result;
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result.r[row].vector4_f32[column] = m.r[column].vector4_f32[row];
+			}
+		}
+		return result;
+	}
+
+	// Gauss-Jordan elimination with partial pivoting in double precision; singular
+	// matrices return the partially reduced result and a zero determinant, as the
+	// library does.
+	inline XMMATRIX XMMatrixInverse(XMVECTOR* determinant, FXMMATRIX m)
+	{
+		double a[4][8];
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				a[row][column] = m.r[row].vector4_f32[column];
+				a[row][column + 4] = (row == column) ? 1.0 : 0.0;
+			}
+		}
+
+		double det = 1.0;
+		for (int column = 0; column < 4; ++column)
+		{
+			int pivot = column;
+			for (int row = column + 1; row < 4; ++row)
+			{
+				if (std::fabs(a[row][column]) > std::fabs(a[pivot][column]))
+				{
+					pivot = row;
+				}
+			}
+			if (pivot != column)
+			{
+				std::swap(a[pivot], a[column]);
+				det = -det;
+			}
+
+			double diagonal = a[column][column];
+			det *= diagonal;
+			if (diagonal == 0.0)
+			{
+				continue;
+			}
+			for (int j = 0; j < 8; ++j)
+			{
+				a[column][j] /= diagonal;
+			}
+			for (int row = 0; row < 4; ++row)
+			{
+				if (row != column)
+				{
+					double factor = a[row][column];
+					for (int j = 0; j < 8; ++j)
+					{
+						a[row][j] -= factor * a[column][j];
+					}
+				}
+			}
+		}
+
+		if (determinant)
+		{
+			*determinant = XMVectorReplicate(static_cast<float>(det));
+		}
+
+		XMMATRIX result;
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result.r[row].vector4_f32[column] = static_cast<float>(a[row][column + 4]);
+			}
+		}
+		return result;
+	}
+
+	inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+	{
+		XMMATRIX result = XMMatrixIdentity();
+		result.r[3] = XMVectorSet(x, y, z, 1.0f);
+		return result;
+	}
+
+	inline XMMATRIX XMMatrixScaling(float x, float y, float z)
+	{
+		XMMATRIX result = XMMatrixIdentity();
+		result.r[0].vector4_f32[0] = x;
+		result.r[1].vector4_f32[1] = y;
+		result.r[2].vector4_f32[2] = z;
+		return result;
+	}
+
+	inline XMMATRIX XMMatrixRotationX(float angle)
+	{
+		float s = std::sin(angle);
+		float c = std::cos(angle);
+		return XMMatrixSet(
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, c, s, 0.0f,
+			0.0f, -s, c, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixRotationY(float angle)
+	{
+		float s = std::sin(angle);
+		float c = std::cos(angle);
+		return XMMatrixSet(
+			c, 0.0f, -s, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			s, 0.0f, c, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixRotationZ(float angle)
+	{
+		float s = std::sin(angle);
+		float c = std::cos(angle);
+		return XMMatrixSet(
+			c, s, 0.0f, 0.0f,
+			-s, c, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixRotationQuaternion(FXMVECTOR q)
+	{
+		float x = XMVectorGetX(q);
+		float y = XMVectorGetY(q);
+		float z = XMVectorGetZ(q);
+		float w = XMVectorGetW(q);
+		return XMMatrixSet(
+			1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f,
+			2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f,
+			2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixLookToLH(FXMVECTOR eyePosition, FXMVECTOR eyeDirection, FXMVECTOR upDirection)
+	{
+		XMVECTOR zAxis = XMVector3Normalize(eyeDirection);
+		XMVECTOR xAxis = XMVector3Normalize(XMVector3Cross(upDirection, zAxis));
+		XMVECTOR yAxis = XMVector3Cross(zAxis, xAxis);
+		XMVECTOR negativeEye = XMVectorNegate(eyePosition);
+
+		return XMMatrixSet(
+			XMVectorGetX(xAxis), XMVectorGetX(yAxis), XMVectorGetX(zAxis), 0.0f,
+			XMVectorGetY(xAxis), XMVectorGetY(yAxis), XMVectorGetY(zAxis), 0.0f,
+			XMVectorGetZ(xAxis), XMVectorGetZ(yAxis), XMVectorGetZ(zAxis), 0.0f,
+			XMVectorGetX(XMVector3Dot(xAxis, negativeEye)),
+			XMVectorGetX(XMVector3Dot(yAxis, negativeEye)),
+			XMVectorGetX(XMVector3Dot(zAxis, negativeEye)),
+			1.0f);
+	}
+
+	inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eyePosition, FXMVECTOR focusPosition, FXMVECTOR upDirection)
+	{
+		return XMMatrixLookToLH(eyePosition, XMVectorSubtract(focusPosition, eyePosition), upDirection);
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveOffCenterLH(float viewLeft, float viewRight, float viewBottom, float viewTop, float nearZ, float farZ)
+	{
+		float twoNearZ = nearZ + nearZ;
+		float reciprocalWidth = 1.0f / (viewRight - viewLeft);
+		float reciprocalHeight = 1.0f / (viewTop - viewBottom);
+		float range = farZ / (farZ - nearZ);
+
+		return XMMatrixSet(
+			twoNearZ * reciprocalWidth, 0.0f, 0.0f, 0.0f,
+			0.0f, twoNearZ * reciprocalHeight, 0.0f, 0.0f,
+			-(viewLeft + viewRight) * reciprocalWidth, -(viewTop + viewBottom) * reciprocalHeight, range, 1.0f,
+			0.0f, 0.0f, -range * nearZ, 0.0f);
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveLH(float viewWidth, float viewHeight, float nearZ, float farZ)
+	{
+		float twoNearZ = nearZ + nearZ;
+		float range = farZ / (farZ - nearZ);
+
+		return XMMatrixSet(
+			twoNearZ / viewWidth, 0.0f, 0.0f, 0.0f,
+			0.0f, twoNearZ / viewHeight, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -range * nearZ, 0.0f);
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+	{
+		float height = std::cos(0.5f * fovAngleY) / std::sin(0.5f * fovAngleY);
+		float width = height / aspectRatio;
+		float range = farZ / (farZ - nearZ);
+
+		return XMMatrixSet(
+			width, 0.0f, 0.0f, 0.0f,
+			0.0f, height, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -range * nearZ, 0.0f);
+	}
+}
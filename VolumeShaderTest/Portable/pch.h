@@ -0,0 +1,8 @@
+﻿#pragma once
+
+// Prefix header for the platform-neutral sources when built outside the UWP project
+// (see CMakeLists.txt). Mirrors pch.h minus the Windows, Direct3D and XAML headers, so
+// anything that compiles against it stays free of platform dependencies.
+
+#include <DirectXMath.h>
+#include <memory>
@@ -0,0 +1,206 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "BatchRenderer.h"
+#include <atomic>
+#include <filesystem>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// frameIndex doubles as the job's index, since it is passed back with the job and rotates the jitter the same
+	// way for the reference render.
+	BatchJob MakeJob(const std::shared_ptr<const VolumeData>& volume, uint32_t index)
+	{
+		BatchJob job;
+		job.volume = volume;
+		job.width = 24;
+		job.height = 20;
+		job.settings.steps = 48;
+		job.settings.frameIndex = index;
+		job.camera = MakeOrbitCamera(0.37f * index, 0.3f, 1.8f, 24.0f / 20.0f, XMFLOAT3(2.0f, 1.5f, 0.0f));
+		return job;
+	}
+
+	DX::FilePath ToFilePath(const std::filesystem::path& path)
+	{
+#if defined(_WIN32)
+		return path.wstring();
+#else
+		return path.string();
+#endif
+	}
+
+	std::shared_ptr<const VolumeData> MakeVolume()
+	{
+		std::shared_ptr<VolumeData> volume = std::make_shared<VolumeData>();
+		GenerateFogSphereVolume(*volume, 32);
+		return volume;
+	}
+
+	// Holds every worker inside the completion callback until Open is called.
+	class Gate
+	{
+	public:
+		Gate() : m_open(false), m_waiting(0) {}
+
+		void Wait()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_waiting++;
+			m_changed.notify_all();
+			m_changed.wait(lock, [this]() { return m_open; });
+		}
+
+		void WaitForWaiters(uint32_t count)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_changed.wait(lock, [&]() { return m_waiting >= count; });
+		}
+
+		void Open()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_open = true;
+			m_changed.notify_all();
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_changed;
+		bool m_open;
+		uint32_t m_waiting;
+	};
+}
+
+TEST_CASE(ImagesMatchTheReferenceRenderer)
+{
+	std::shared_ptr<const VolumeData> volume = MakeVolume();
+	const uint32_t jobCount = 12;
+	std::vector<ReferenceImage> expected(jobCount);
+	for (uint32_t i = 0; i < jobCount; ++i)
+	{
+		BatchJob job = MakeJob(volume, i);
+		expected[i].Resize(job.width, job.height);
+		ReferenceRaymarcher::Render(*volume, job.camera, job.settings, expected[i]);
+	}
+
+	std::atomic<uint32_t> mismatches(0);
+	BatchSettings settings;
+	settings.threadCount = 3;
+	settings.queueCapacity = 2;
+	BatchRenderer renderer(settings, [&](const BatchJob& job, const ReferenceImage& image, bool written)
+	{
+		const ReferenceImage& reference = expected[job.settings.frameIndex];
+		bool same = written && image.samples == reference.samples && image.color.size() == reference.color.size() &&
+			std::memcmp(image.color.data(), reference.color.data(), image.color.size() * sizeof(XMFLOAT4)) == 0;
+		mismatches += same ? 0 : 1;
+	});
+	for (uint32_t i = 0; i < jobCount; ++i)
+	{
+		renderer.Submit(MakeJob(volume, i));
+	}
+	renderer.WaitIdle();
+
+	BatchStats stats = renderer.GetStats();
+	CHECK(mismatches == 0);
+	CHECK(stats.submitted == jobCount && stats.completed == jobCount);
+	uint64_t samples = 0;
+	for (const ReferenceImage& image : expected)
+	{
+		samples += image.samples;
+	}
+	CHECK(stats.samples == samples);
+}
+
+TEST_CASE(FullQueuePushesBackOnTheProducer)
+{
+	std::shared_ptr<const VolumeData> volume = MakeVolume();
+	Gate gate;
+	BatchSettings settings;
+	settings.threadCount = 1;
+	settings.queueCapacity = 2;
+	BatchRenderer renderer(settings, [&](const BatchJob&, const ReferenceImage&, bool) { gate.Wait(); });
+
+	// The only worker holds the first job, so two more fill the queue and the next one is refused.
+	renderer.Submit(MakeJob(volume, 0));
+	gate.WaitForWaiters(1);
+	BatchJob job = MakeJob(volume, 1);
+	CHECK(renderer.TrySubmit(job));
+	job = MakeJob(volume, 2);
+	CHECK(renderer.TrySubmit(job));
+	job = MakeJob(volume, 3);
+	CHECK(!renderer.TrySubmit(job));
+	CHECK(job.volume == volume);
+	CHECK(renderer.GetStats().blockedSubmits == 0);
+
+	// A blocking submit waits until the worker frees a slot.
+	std::atomic<bool> submitted(false);
+	std::thread producer([&]()
+	{
+		renderer.Submit(MakeJob(volume, 3));
+		submitted = true;
+	});
+	while (renderer.GetStats().blockedSubmits == 0)
+	{
+		std::this_thread::yield();
+	}
+	CHECK(!submitted);
+	CHECK(renderer.GetStats().submitted == 3);
+
+	gate.Open();
+	producer.join();
+	renderer.WaitIdle();
+	BatchStats stats = renderer.GetStats();
+	CHECK(submitted);
+	CHECK(stats.submitted == 4 && stats.completed == 4);
+	CHECK(stats.blockedSubmits == 1);
+}
+
+TEST_CASE(ThroughputCoversTheWholeBatch)
+{
+	std::shared_ptr<const VolumeData> volume = MakeVolume();
+	BatchSettings settings;
+	settings.threadCount = 2;
+	settings.queueCapacity = 1;
+	BatchRenderer renderer(settings);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		renderer.Submit(MakeJob(volume, i));
+	}
+	renderer.WaitIdle();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// A producer faster than two workers keeps running into the one-slot queue.
+	BatchStats stats = renderer.GetStats();
+	CHECK(stats.completed == 16);
+	CHECK(stats.blockedSubmits > 0);
+	CHECK(stats.seconds > 0.0 && stats.seconds <= elapsed);
+	CHECK_NEAR(stats.imagesPerSecond, stats.completed / stats.seconds, 1e-6 * stats.imagesPerSecond);
+	CHECK(stats.imagesPerSecond >= 16.0 / elapsed);
+}
+
+TEST_CASE(UnwritablePathsCountAsFailedWrites)
+{
+	std::shared_ptr<const VolumeData> volume = MakeVolume();
+	std::filesystem::path written = std::filesystem::temp_directory_path() / "BatchRendererTests.tga";
+	std::filesystem::path missing = std::filesystem::temp_directory_path() / "BatchRendererTests-missing" / "frame.tga";
+	std::atomic<uint32_t> reportedFailures(0);
+	BatchRenderer renderer(BatchSettings(), [&](const BatchJob&, const ReferenceImage&, bool ok) { reportedFailures += ok ? 0 : 1; });
+
+	BatchJob job = MakeJob(volume, 0);
+	job.outputPath = ToFilePath(written);
+	renderer.Submit(job);
+	job.outputPath = ToFilePath(missing);
+	renderer.Submit(job);
+	renderer.WaitIdle();
+
+	// 18-byte header plus 4 bytes per pixel.
+	CHECK(std::filesystem::exists(written) && std::filesystem::file_size(written) == 18 + 24 * 20 * 4);
+	CHECK(renderer.GetStats().completed == 2);
+	CHECK(renderer.GetStats().failedWrites == 1);
+	CHECK(reportedFailures == 1);
+	std::filesystem::remove(written);
+}
@@ -0,0 +1,157 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "Benchmark.h"
+#include "CpuRenderBackend.h"
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	bool SamePose(const CameraPose& a, const CameraPose& b)
+	{
+		return std::memcmp(&a, &b, sizeof(CameraPose)) == 0;
+	}
+
+	// Drives the runner by hand and returns every pose it hands out, warmup frames included.
+	std::vector<CameraPose> RecordPoses(const BenchmarkSettings& settings, const std::vector<BenchmarkPath>& paths)
+	{
+		BenchmarkRunner runner(settings, paths);
+		DX::StepTimer timer;
+		runner.ConfigureTimer(timer);
+
+		std::vector<CameraPose> poses;
+		while (!runner.IsFinished())
+		{
+			timer.Tick([&]()
+			{
+				poses.push_back(runner.BeginFrame(timer.GetTotalSeconds()));
+			});
+
+			BenchmarkFrameSample sample = { 1.0, -1.0, 0 };
+			runner.EndFrame(sample);
+		}
+		return poses;
+	}
+}
+
+TEST_CASE(DeterministicTimerStepsOncePerTick)
+{
+	DX::StepTimer timer;
+	timer.SetDeterministic(true);
+	timer.SetTargetElapsedSeconds(1.0 / 30.0);
+	CHECK(timer.IsDeterministic());
+
+	// Back-to-back ticks, then one after a stall of several steps: one update each, of exactly one step.
+	for (int i = 0; i < 4; ++i)
+	{
+		int updates = 0;
+		if (i == 3)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(120));
+		}
+		timer.Tick([&]() { ++updates; });
+		CHECK(updates == 1);
+		CHECK(timer.GetElapsedTicks() == DX::StepTimer::SecondsToTicks(1.0 / 30.0));
+	}
+
+	CHECK(timer.GetFrameCount() == 4);
+	CHECK(timer.GetTotalTicks() == 4 * DX::StepTimer::SecondsToTicks(1.0 / 30.0));
+}
+
+TEST_CASE(DeterministicModeOverridesFixedTimeStep)
+{
+	// A fixed timestep ticked at once has not yet accumulated a step; the deterministic timer runs one regardless.
+	DX::StepTimer fixed;
+	fixed.SetFixedTimeStep(true);
+	fixed.SetTargetElapsedSeconds(10.0);
+	int fixedUpdates = 0;
+	fixed.Tick([&]() { ++fixedUpdates; });
+	CHECK(fixedUpdates == 0);
+
+	fixed.SetDeterministic(true);
+	fixed.Tick([&]() { ++fixedUpdates; });
+	CHECK(fixedUpdates == 1);
+	CHECK_NEAR(fixed.GetTotalSeconds(), 10.0, 1e-9);
+}
+
+TEST_CASE(RunnerConfiguresTimerFromSettings)
+{
+	BenchmarkSettings settings;
+	settings.frameSeconds = 0.025;
+	BenchmarkRunner runner(settings, GetDefaultBenchmarkPaths());
+
+	DX::StepTimer timer;
+	runner.ConfigureTimer(timer);
+	CHECK(timer.IsDeterministic());
+
+	timer.Tick([]() {});
+	timer.Tick([]() {});
+	CHECK_NEAR(timer.GetElapsedSeconds(), 0.025, 1e-9);
+	CHECK_NEAR(timer.GetTotalSeconds(), 0.05, 1e-9);
+}
+
+TEST_CASE(RunsReplayTheSamePoses)
+{
+	BenchmarkSettings settings;
+	settings.warmupFrames = 3;
+	settings.measuredFrames = 7;
+	settings.frameSeconds = 0.1;
+	std::vector<BenchmarkPath> paths = GetDefaultBenchmarkPaths();
+
+	std::vector<CameraPose> first = RecordPoses(settings, paths);
+	std::vector<CameraPose> second = RecordPoses(settings, paths);
+	REQUIRE(first.size() == paths.size() * 10);
+	REQUIRE(second.size() == first.size());
+	for (size_t i = 0; i < first.size(); ++i)
+	{
+		CHECK(SamePose(first[i], second[i]));
+	}
+
+	// Warmup and measured phases both start their path at zero.
+	for (size_t p = 0; p < paths.size(); ++p)
+	{
+		CHECK(SamePose(first[p * 10], paths[p].Evaluate(0.0)));
+		CHECK(SamePose(first[p * 10 + 3], paths[p].Evaluate(0.0)));
+		CHECK(SamePose(first[p * 10 + 5], paths[p].Evaluate(0.2)));
+	}
+}
+
+TEST_CASE(HeadlessRunsCountTheSameSamples)
+{
+	CpuRenderBackendSettings backendSettings;
+	backendSettings.width = 24;
+	backendSettings.height = 16;
+	backendSettings.steps = 32;
+	backendSettings.generatedVolumeSize = 24;
+	CpuRenderBackend backend(backendSettings);
+
+	BenchmarkSettings settings;
+	settings.warmupFrames = 2;
+	settings.measuredFrames = 5;
+	std::vector<BenchmarkPath> paths = GetDefaultBenchmarkPaths();
+
+	BenchmarkReport first = RunBenchmark(backend, settings, paths, "first");
+	BenchmarkReport second = RunBenchmark(backend, settings, paths, "second");
+	REQUIRE(first.paths.size() == paths.size());
+	REQUIRE(second.paths.size() == paths.size());
+	for (size_t p = 0; p < paths.size(); ++p)
+	{
+		REQUIRE(first.paths[p].frames.size() == 5);
+		REQUIRE(second.paths[p].frames.size() == 5);
+		for (size_t f = 0; f < 5; ++f)
+		{
+			CHECK(first.paths[p].frames[f].samplesPerPixel > 0.0);
+			CHECK(first.paths[p].frames[f].samplesPerPixel == second.paths[p].frames[f].samplesPerPixel);
+		}
+	}
+
+	std::ostringstream json;
+	WriteBenchmarkJson(json, first);
+	CHECK(json.str().find("\"label\": \"first\"") != std::string::npos);
+	CHECK(json.str().find("\"name\": \"grazing\"") != std::string::npos);
+	CHECK(json.str().find("\"samplesPerPixel\": null") == std::string::npos);
+}
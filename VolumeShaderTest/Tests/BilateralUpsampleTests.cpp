@@ -0,0 +1,161 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "BilateralUpsample.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// An opaque half next to a faint one, so the image has a hard edge inside the box as well as the silhouette.
+	void MakeSlabVolume(VolumeData& volume, uint32_t size)
+	{
+		volume.Resize(size, size, size);
+		for (uint32_t z = 0; z < size; ++z)
+		{
+			for (uint32_t y = 0; y < size; ++y)
+			{
+				for (uint32_t x = 0; x < size; ++x)
+				{
+					bool front = x < size / 2;
+					float* voxel = &volume.voxels[volume.Index(x, y, z)];
+					voxel[0] = front ? 1.0f : 0.2f;
+					voxel[1] = front ? 0.6f : 0.3f;
+					voxel[2] = front ? 0.1f : 1.0f;
+					voxel[3] = front ? 1.0f : 0.3f;
+				}
+			}
+		}
+	}
+
+	// Slightly above and to the side, so the silhouette crosses pixel rows and columns at an angle.
+	RaymarchCamera TestCamera(uint32_t width, uint32_t height)
+	{
+		XMFLOAT3 eye(0.9f, 0.7f, -1.6f);
+		XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, static_cast<float>(width) / height, 0.01f, 100.0f);
+		return MakeRaymarchCamera(XMMatrixRotationY(0.4f), view, projection, eye, XMFLOAT3(0.0f, 2.0f, -2.0f));
+	}
+
+	void Render(const VolumeData& volume, uint32_t width, uint32_t height, ReferenceImage& image)
+	{
+		RaymarchSettings settings;
+		settings.steps = 96;
+		settings.shadows = false;
+		settings.jitter = false;
+		image.Resize(width, height);
+		ReferenceRaymarcher::Render(volume, TestCamera(width, height), settings, image);
+	}
+
+	void NearestUpsample(const ReferenceImage& lowRes, ReferenceImage& highRes)
+	{
+		for (uint32_t y = 0; y < highRes.height; ++y)
+		{
+			for (uint32_t x = 0; x < highRes.width; ++x)
+			{
+				uint32_t sx = x * lowRes.width / highRes.width;
+				uint32_t sy = y * lowRes.height / highRes.height;
+				highRes.color[y * highRes.width + x] = lowRes.color[sy * lowRes.width + sx];
+			}
+		}
+	}
+
+	void BilinearUpsample(const ReferenceImage& lowRes, ReferenceImage& highRes)
+	{
+		for (uint32_t y = 0; y < highRes.height; ++y)
+		{
+			for (uint32_t x = 0; x < highRes.width; ++x)
+			{
+				highRes.color[y * highRes.width + x] = lowRes.SampleColor((x + 0.5f) / highRes.width, (y + 0.5f) / highRes.height);
+			}
+		}
+	}
+
+	struct UpsampleErrors
+	{
+		ImageError nearest;
+		ImageError bilinear;
+		ImageError bilateral;
+	};
+
+	UpsampleErrors CompareUpsamplers(uint32_t scale)
+	{
+		const uint32_t width = 128;
+		const uint32_t height = 96;
+		VolumeData volume;
+		MakeSlabVolume(volume, 32);
+
+		ReferenceImage full, lowRes;
+		Render(volume, width, height, full);
+		Render(volume, width / scale, height / scale, lowRes);
+
+		ReferenceImage nearest, bilinear, bilateral;
+		nearest.Resize(width, height);
+		bilinear.Resize(width, height);
+		bilateral.Resize(width, height);
+		NearestUpsample(lowRes, nearest);
+		BilinearUpsample(lowRes, bilinear);
+		BilateralUpsample(lowRes, TestCamera(width, height), 0.02f, bilateral);
+
+		UpsampleErrors errors;
+		errors.nearest = CompareImages(full, nearest, 0.1f);
+		errors.bilinear = CompareImages(full, bilinear, 0.1f);
+		errors.bilateral = CompareImages(full, bilateral, 0.1f);
+		std::printf("  1/%u: rmse nearest %.4f bilinear %.4f bilateral %.4f; pixels off by > 0.1: %u %u %u\n", scale,
+			errors.nearest.rmse, errors.bilinear.rmse, errors.bilateral.rmse,
+			errors.nearest.pixelsAboveThreshold, errors.bilinear.pixelsAboveThreshold, errors.bilateral.pixelsAboveThreshold);
+		return errors;
+	}
+}
+
+TEST_CASE(UpsamplingAFullResolutionImageIsExact)
+{
+	VolumeData volume;
+	MakeSlabVolume(volume, 16);
+	ReferenceImage full;
+	Render(volume, 40, 30, full);
+
+	ReferenceImage upsampled;
+	upsampled.Resize(40, 30);
+	BilateralUpsample(full, TestCamera(40, 30), 0.02f, upsampled);
+	ImageError error = CompareImages(full, upsampled, 1e-5f);
+	CHECK(error.pixelsAboveThreshold == 0);
+}
+
+TEST_CASE(HalfResolutionHasFewerEdgeArtifactsThanNearestOrBilinear)
+{
+	UpsampleErrors errors = CompareUpsamplers(2);
+	CHECK(errors.bilateral.rmse < errors.bilinear.rmse);
+	CHECK(errors.bilateral.rmse < errors.nearest.rmse);
+	CHECK(errors.bilateral.pixelsAboveThreshold < errors.bilinear.pixelsAboveThreshold);
+	CHECK(errors.bilateral.pixelsAboveThreshold < errors.nearest.pixelsAboveThreshold);
+}
+
+TEST_CASE(QuarterResolutionHasFewerEdgeArtifactsThanNearestOrBilinear)
+{
+	UpsampleErrors errors = CompareUpsamplers(4);
+	CHECK(errors.bilateral.rmse < errors.bilinear.rmse);
+	CHECK(errors.bilateral.rmse < errors.nearest.rmse);
+	CHECK(errors.bilateral.pixelsAboveThreshold < errors.bilinear.pixelsAboveThreshold);
+	CHECK(errors.bilateral.pixelsAboveThreshold < errors.nearest.pixelsAboveThreshold);
+}
+
+TEST_CASE(PixelsOffTheVolumeStayEmpty)
+{
+	VolumeData volume;
+	MakeSlabVolume(volume, 16);
+	ReferenceImage full, lowRes;
+	Render(volume, 64, 48, full);
+	Render(volume, 16, 12, lowRes);
+
+	ReferenceImage upsampled;
+	upsampled.Resize(64, 48);
+	BilateralUpsample(lowRes, TestCamera(64, 48), 0.02f, upsampled);
+
+	uint32_t bled = 0;
+	for (size_t i = 0; i < full.color.size(); ++i)
+	{
+		bled += (full.entryDepth[i] < 0.0f && upsampled.color[i].w != 0.0f) ? 1 : 0;
+	}
+	CHECK(bled == 0);
+}
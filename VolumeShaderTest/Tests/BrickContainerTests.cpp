@@ -0,0 +1,380 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "BrickContainer.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	DX::FilePath ToFilePath(const std::filesystem::path& path)
+	{
+#if defined(_WIN32)
+		return path.wstring();
+#else
+		return path.string();
+#endif
+	}
+
+	struct Grid
+	{
+		uint32_t width, height, depth;
+		std::vector<uint16_t> voxels;
+
+		uint16_t At(uint32_t x, uint32_t y, uint32_t z) const
+		{
+			x = std::min(x, width - 1);
+			y = std::min(y, height - 1);
+			z = std::min(z, depth - 1);
+			return voxels[(static_cast<size_t>(z) * height + y) * width + x];
+		}
+	};
+
+	// Smooth 12-bit ramp with a little noise, which the filters compress well.
+	Grid MakeGrid(uint32_t width, uint32_t height, uint32_t depth)
+	{
+		Grid grid = { width, height, depth, std::vector<uint16_t>(static_cast<size_t>(width) * height * depth) };
+		std::mt19937 random(36);
+		size_t i = 0;
+		for (uint32_t z = 0; z < depth; ++z)
+		{
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					grid.voxels[i++] = static_cast<uint16_t>(x * 40 + y * 25 + z * 60 + random() % 4);
+				}
+			}
+		}
+		return grid;
+	}
+
+	// The 2x box filter the writer documents, edges reusing the last voxel.
+	Grid Halve(const Grid& from)
+	{
+		Grid to = { (from.width + 1) / 2, (from.height + 1) / 2, (from.depth + 1) / 2, {} };
+		to.voxels.resize(static_cast<size_t>(to.width) * to.height * to.depth);
+		size_t i = 0;
+		for (uint32_t z = 0; z < to.depth; ++z)
+		{
+			for (uint32_t y = 0; y < to.height; ++y)
+			{
+				for (uint32_t x = 0; x < to.width; ++x)
+				{
+					uint32_t sum = 0;
+					for (uint32_t corner = 0; corner < 8; ++corner)
+					{
+						sum += from.At(2 * x + (corner & 1), 2 * y + ((corner >> 1) & 1), 2 * z + (corner >> 2));
+					}
+					to.voxels[i++] = static_cast<uint16_t>((sum + 4) / 8);
+				}
+			}
+		}
+		return to;
+	}
+
+	std::vector<uint8_t> ReadBytes(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	// Writes the grid and returns the container's bytes.
+	std::vector<uint8_t> WriteContainer(const Grid& grid, const BrickContainerSettings& settings)
+	{
+		std::filesystem::path path = std::filesystem::temp_directory_path() / "BrickContainerTests.vsbc";
+		bool written = WriteBrickContainer(ToFilePath(path), grid.voxels.data(), grid.width, grid.height, grid.depth, settings);
+		std::vector<uint8_t> bytes = written ? ReadBytes(path) : std::vector<uint8_t>();
+		std::filesystem::remove(path);
+		return bytes;
+	}
+
+	bool Opens(const std::vector<uint8_t>& bytes)
+	{
+		BrickContainerReader reader;
+		return reader.Open(DX::MakeFileView(std::vector<uint8_t>(bytes)));
+	}
+
+	template<typename T>
+	void Poke(std::vector<uint8_t>& bytes, size_t offset, T value)
+	{
+		std::memcpy(bytes.data() + offset, &value, sizeof(T));
+	}
+
+	// Checks every brick of every level against the grid and its halvings, edge voxels repeated past the edge.
+	void CheckEveryBrick(const BrickContainerReader& reader, const Grid& grid)
+	{
+		uint32_t brickSize = reader.GetHeader().brickSize;
+		std::vector<uint16_t> brick(reader.GetBrickVoxelCount());
+		std::vector<uint8_t> scratch;
+		Grid level = grid;
+		for (uint32_t l = 0; l < reader.GetLevelCount(); ++l)
+		{
+			if (l > 0)
+			{
+				level = Halve(level);
+			}
+			const BrickLevelInfo& info = reader.GetLevel(l);
+			CHECK(info.width == level.width && info.height == level.height && info.depth == level.depth);
+
+			for (uint32_t bz = 0; bz < info.bricksZ; ++bz)
+			{
+				for (uint32_t by = 0; by < info.bricksY; ++by)
+				{
+					for (uint32_t bx = 0; bx < info.bricksX; ++bx)
+					{
+						REQUIRE(reader.ReadBrick(reader.GetBrickIndex(l, bx, by, bz), brick.data(), scratch));
+						bool same = true;
+						size_t i = 0;
+						for (uint32_t z = 0; z < brickSize; ++z)
+						{
+							for (uint32_t y = 0; y < brickSize; ++y)
+							{
+								for (uint32_t x = 0; x < brickSize; ++x)
+								{
+									same = same && brick[i++] == level.At(bx * brickSize + x, by * brickSize + y, bz * brickSize + z);
+								}
+							}
+						}
+						CHECK(same);
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE(EveryBrickRoundTripsWithEveryFilter)
+{
+	// Odd sizes on every axis, so every level has partial bricks at its far edges.
+	Grid grid = MakeGrid(37, 21, 13);
+	const uint8_t filterSets[] = { BrickFilterNone, BrickFilterDelta, BrickFilterBitPlane, BrickFilterDelta | BrickFilterBitPlane };
+	for (uint8_t filters : filterSets)
+	{
+		BrickContainerSettings settings;
+		settings.brickSize = 8;
+		settings.filters = filters;
+		std::vector<uint8_t> bytes = WriteContainer(grid, settings);
+		REQUIRE(!bytes.empty());
+
+		BrickContainerReader reader;
+		REQUIRE(reader.Open(DX::MakeFileView(std::move(bytes))));
+		const BrickContainerHeader& header = reader.GetHeader();
+		CHECK(header.width == 37 && header.height == 21 && header.depth == 13);
+
+		// 37x21x13, 19x11x7, 10x6x4, then 5x3x2 fits in one brick.
+		REQUIRE(reader.GetLevelCount() == 4);
+		CHECK(header.brickCount == 5 * 3 * 2 + 3 * 2 * 1 + 2 * 1 * 1 + 1);
+		CheckEveryBrick(reader, grid);
+	}
+}
+
+TEST_CASE(LevelLimitStopsEarly)
+{
+	Grid grid = MakeGrid(40, 40, 40);
+	BrickContainerSettings settings;
+	settings.brickSize = 8;
+	settings.maxLevels = 2;
+
+	BrickContainerReader reader;
+	REQUIRE(reader.Open(DX::MakeFileView(WriteContainer(grid, settings))));
+	REQUIRE(reader.GetLevelCount() == 2);
+	CHECK(reader.GetLevel(1).width == 20);
+	CheckEveryBrick(reader, grid);
+}
+
+TEST_CASE(IncompressibleBricksAreStored)
+{
+	Grid grid = { 16, 16, 16, std::vector<uint16_t>(16 * 16 * 16) };
+	std::mt19937 random(7);
+	for (uint16_t& voxel : grid.voxels)
+	{
+		voxel = static_cast<uint16_t>(random());
+	}
+
+	BrickContainerSettings settings;
+	settings.brickSize = 16;
+	BrickContainerReader reader;
+	REQUIRE(reader.Open(DX::MakeFileView(WriteContainer(grid, settings))));
+	REQUIRE(reader.GetLevelCount() == 1);
+
+	const BrickIndexEntry& entry = reader.GetBrickEntry(0);
+	CHECK(entry.codec == BrickCodec::Stored);
+	CHECK(entry.filters == BrickFilterNone);
+	CHECK(entry.size == 16 * 16 * 16 * sizeof(uint16_t));
+	CheckEveryBrick(reader, grid);
+
+	// A stored brick of the wrong size never decodes.
+	std::vector<uint16_t> brick(reader.GetBrickVoxelCount());
+	std::vector<uint8_t> scratch;
+	std::vector<uint8_t> raw(entry.size - 2);
+	CHECK(!DecompressBrick(raw.data(), raw.size(), BrickCodec::Stored, BrickFilterNone, brick.data(), brick.size(), scratch));
+	CHECK(!reader.ReadBrick(1, brick.data(), scratch));
+}
+
+TEST_CASE(OpenRejectsDamagedContainers)
+{
+	BrickContainerSettings settings;
+	settings.brickSize = 8;
+	const std::vector<uint8_t> good = WriteContainer(MakeGrid(20, 12, 9), settings);
+	REQUIRE(Opens(good));
+
+	BrickContainerHeader header;
+	std::memcpy(&header, good.data(), sizeof(header));
+	const size_t levels = sizeof(BrickContainerHeader);
+	const size_t index = static_cast<size_t>(header.indexOffset);
+
+	// Truncated anywhere: inside the header, the level table, the bricks or the index.
+	for (size_t size : { size_t(0), sizeof(header) - 1, levels + 10, index - 1, good.size() - 1 })
+	{
+		CHECK(!Opens(std::vector<uint8_t>(good.begin(), good.begin() + size)));
+	}
+
+	std::vector<uint8_t> bad = good;
+	Poke<uint32_t>(bad, offsetof(BrickContainerHeader, magic), 0x12345678);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint32_t>(bad, offsetof(BrickContainerHeader, version), BrickContainerVersion + 1);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint32_t>(bad, offsetof(BrickContainerHeader, brickSize), 0);
+	CHECK(!Opens(bad));
+
+	// Level table: no levels, too many to fit, a brick grid that does not match the size, a wrong first brick,
+	// and a brick count that does not add up.
+	bad = good;
+	Poke<uint32_t>(bad, offsetof(BrickContainerHeader, levelCount), 0);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint32_t>(bad, offsetof(BrickContainerHeader, levelCount), 0x10000000);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint32_t>(bad, levels + offsetof(BrickLevelInfo, bricksX), 7);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint32_t>(bad, levels + offsetof(BrickLevelInfo, width), 0);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint32_t>(bad, levels + sizeof(BrickLevelInfo) + offsetof(BrickLevelInfo, firstBrick), 1);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint32_t>(bad, offsetof(BrickContainerHeader, brickCount), header.brickCount - 1);
+	CHECK(!Opens(bad));
+
+	// Index: past the end, misaligned, and entries pointing past the brick data.
+	bad = good;
+	Poke<uint64_t>(bad, offsetof(BrickContainerHeader, indexOffset), good.size() + 8);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint64_t>(bad, offsetof(BrickContainerHeader, indexOffset), header.indexOffset + 1);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint64_t>(bad, index + offsetof(BrickIndexEntry, offset), header.indexOffset + 1);
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint32_t>(bad, index + sizeof(BrickIndexEntry) + offsetof(BrickIndexEntry, size), static_cast<uint32_t>(header.indexOffset));
+	CHECK(!Opens(bad));
+
+	bad = good;
+	Poke<uint64_t>(bad, index + offsetof(BrickIndexEntry, offset), UINT64_MAX - 4);
+	CHECK(!Opens(bad));
+
+	// A failed open leaves nothing behind.
+	BrickContainerReader reader;
+	REQUIRE(reader.Open(DX::MakeFileView(std::vector<uint8_t>(good))));
+	CHECK(!reader.Open(DX::MakeFileView(std::move(bad))));
+	CHECK(reader.GetLevelCount() == 0);
+	CHECK(reader.GetHeader().brickCount == 0);
+}
+
+TEST_CASE(OpenReadsFilesAndRejectsMissingOnes)
+{
+	Grid grid = MakeGrid(9, 9, 9);
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "BrickContainerTests-open.vsbc";
+	REQUIRE(WriteBrickContainer(ToFilePath(path), grid.voxels.data(), 9, 9, 9, BrickContainerSettings()));
+
+	BrickContainerReader reader;
+	CHECK(reader.Open(ToFilePath(path)));
+	CHECK(reader.GetHeader().brickCount == 1);
+	std::filesystem::remove(path);
+	CHECK(!reader.Open(ToFilePath(path)));
+
+	// Empty volumes and zero brick sizes are refused up front.
+	BrickContainerSettings zeroBricks;
+	zeroBricks.brickSize = 0;
+	CHECK(!WriteBrickContainer(ToFilePath(path), grid.voxels.data(), 9, 9, 9, zeroBricks));
+	CHECK(!WriteBrickContainer(ToFilePath(path), grid.voxels.data(), 9, 0, 9, BrickContainerSettings()));
+}
+
+TEST_CASE(LzRoundTripsAndRejectsCorruptStreams)
+{
+	std::mt19937 random(99);
+	std::vector<uint8_t> source(5000);
+	for (size_t i = 0; i < source.size(); ++i)
+	{
+		// Runs, repeats at several distances and literals.
+		source[i] = (i % 700 < 300) ? static_cast<uint8_t>(i / 50) : (i % 3 == 0) ? static_cast<uint8_t>(random()) : source[i - 17];
+	}
+
+	std::vector<uint8_t> block;
+	CompressLz(source.data(), source.size(), block);
+	REQUIRE(block.size() < source.size());
+	std::vector<uint8_t> output(source.size());
+	REQUIRE(DecompressLz(block.data(), block.size(), output.data(), output.size()));
+	CHECK(output == source);
+
+	// The output must come out exactly the expected size.
+	CHECK(!DecompressLz(block.data(), block.size(), output.data(), output.size() - 1));
+	std::vector<uint8_t> larger(source.size() + 1);
+	CHECK(!DecompressLz(block.data(), block.size(), larger.data(), larger.size()));
+
+	// Cut short anywhere, the block never decodes in full.
+	for (size_t size = 0; size < block.size(); size += 1 + size / 8)
+	{
+		CHECK(!DecompressLz(block.data(), size, output.data(), output.size()));
+	}
+
+	// Hand-made sequences: a zero offset, an offset before the start of the output, a cut-off offset, a literal run
+	// past the end of the block, and a length that never ends.
+	const uint8_t zeroOffset[] = { 0x10, 'a', 0x00, 0x00 };
+	const uint8_t farOffset[] = { 0x10, 'a', 0x02, 0x00 };
+	const uint8_t cutOffset[] = { 0x10, 'a', 0x01 };
+	const uint8_t longLiterals[] = { 0x50, 'a', 'b' };
+	const uint8_t endlessLength[] = { 0xf0, 0xff, 0xff };
+	std::vector<uint8_t> small(64);
+	CHECK(!DecompressLz(zeroOffset, sizeof(zeroOffset), small.data(), 5));
+	CHECK(!DecompressLz(farOffset, sizeof(farOffset), small.data(), 5));
+	CHECK(!DecompressLz(cutOffset, sizeof(cutOffset), small.data(), 5));
+	CHECK(!DecompressLz(longLiterals, sizeof(longLiterals), small.data(), 5));
+	CHECK(!DecompressLz(endlessLength, sizeof(endlessLength), small.data(), small.size()));
+
+	// The smallest valid match: one literal repeated by an overlapping match of four.
+	const uint8_t overlap[] = { 0x10, 'a', 0x01, 0x00 };
+	REQUIRE(DecompressLz(overlap, sizeof(overlap), small.data(), 5));
+	CHECK(std::string(small.begin(), small.begin() + 5) == "aaaaa");
+
+	// Random damage may still decode, but never outside the buffers and never to another size.
+	for (int trial = 0; trial < 500; ++trial)
+	{
+		std::vector<uint8_t> damaged = block;
+		for (int flips = 0; flips < 3; ++flips)
+		{
+			damaged[random() % damaged.size()] ^= static_cast<uint8_t>(1 + random() % 255);
+		}
+		DecompressLz(damaged.data(), damaged.size(), output.data(), output.size());
+	}
+}
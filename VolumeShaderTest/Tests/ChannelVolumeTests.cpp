@@ -0,0 +1,125 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "ChannelVolume.h"
+#include <limits>
+#include <random>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+TEST_CASE(StrideFitsTheChannelCount)
+{
+	CHECK(PackedChannelStride(2) == 2);
+	CHECK(PackedChannelStride(3) == 4);
+	CHECK(PackedChannelStride(4) == 4);
+}
+
+TEST_CASE(SimdPackingMatchesScalar)
+{
+	// Odd voxel counts run the scalar tail after the 16-voxel blocks; special values hit the clamps.
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> values(-0.5f, 1.5f);
+	const size_t counts[] = { 0, 1, 15, 16, 17, 1000, 4099 };
+	for (uint32_t channelCount = 2; channelCount <= 4; ++channelCount)
+	{
+		for (size_t count : counts)
+		{
+			std::vector<std::vector<float>> channels(channelCount, std::vector<float>(count));
+			const float* planes[MaxVolumeChannels];
+			ChannelWindow windows[MaxVolumeChannels];
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				for (float& value : channels[c])
+				{
+					value = values(random);
+				}
+				if (count > 3)
+				{
+					channels[c][0] = std::numeric_limits<float>::quiet_NaN();
+					channels[c][1] = std::numeric_limits<float>::infinity();
+					channels[c][2] = -std::numeric_limits<float>::infinity();
+					channels[c][3] = 0.5f / 255.0f;
+				}
+				planes[c] = channels[c].data();
+				// Channel 2 gets a zero-width window, channel 3 a shifted one.
+				windows[c] = ChannelWindow((c == 3) ? 0.2f : 0.0f, (c == 2) ? 0.0f : 1.0f);
+			}
+
+			// One guard byte past the end catches overruns.
+			size_t bytes = count * PackedChannelStride(channelCount);
+			std::vector<uint8_t> simd(bytes + 1, 0xab), scalar(bytes + 1, 0xcd);
+			PackChannels(planes, windows, channelCount, count, simd.data());
+			PackChannelsScalar(planes, windows, channelCount, count, scalar.data());
+			CHECK(std::memcmp(simd.data(), scalar.data(), bytes) == 0);
+			CHECK(simd[bytes] == 0xab);
+		}
+	}
+}
+
+TEST_CASE(QuantizingRoundsAndClampsToTheWindow)
+{
+	const float a[] = { 0.0f, 1.0f, 0.5f, -3.0f, 7.0f, 1.0f / 255.0f, 0.49f / 255.0f, std::numeric_limits<float>::quiet_NaN() };
+	const float b[] = { 10.0f, 20.0f, 15.0f, 0.0f, 30.0f, 12.0f, 19.99f, 20.01f };
+	const float* planes[2] = { a, b };
+	ChannelWindow windows[2] = { ChannelWindow(0.0f, 1.0f), ChannelWindow(10.0f, 20.0f) };
+	uint8_t packed[16];
+	PackChannels(planes, windows, 2, 8, packed);
+
+	const uint8_t expectedA[] = { 0, 255, 128, 0, 255, 1, 0, 0 };
+	const uint8_t expectedB[] = { 0, 255, 128, 0, 255, 51, 255, 255 };
+	for (int i = 0; i < 8; ++i)
+	{
+		CHECK(packed[i * 2] == expectedA[i]);
+		CHECK(packed[i * 2 + 1] == expectedB[i]);
+	}
+}
+
+TEST_CASE(ThreeChannelsPadTheFourthByte)
+{
+	ChannelVolume volume;
+	GenerateChannelVolume(volume, 8, 3);
+	std::vector<uint8_t> packed;
+	PackChannelVolume(volume, std::vector<ChannelWindow>(3), packed);
+	REQUIRE(packed.size() == volume.VoxelCount() * 4);
+
+	bool padded = true;
+	float worstError = 0.0f;
+	for (size_t i = 0; i < volume.VoxelCount(); ++i)
+	{
+		padded = padded && packed[i * 4 + 3] == 0;
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			float value = volume.channels[c][i];
+			value = (value < 0.0f) ? 0.0f : (value > 1.0f ? 1.0f : value);
+			float error = fabsf(packed[i * 4 + c] / 255.0f - value);
+			worstError = (error > worstError) ? error : worstError;
+		}
+	}
+	CHECK(padded);
+	CHECK(worstError <= 0.5f / 255.0f + 1e-6f);
+}
+
+TEST_CASE(MixWeighsChannelsByOpacity)
+{
+	std::vector<XMFLOAT4> tables[2] =
+	{
+		{ XMFLOAT4(1.0f, 0.0f, 0.0f, 0.0f), XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f) },
+		{ XMFLOAT4(0.0f, 0.0f, 1.0f, 0.0f), XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f) },
+	};
+	// Texel centers sit at 0.25 and 0.75, like a two texel texture row.
+	CHECK_NEAR(SampleTransferFunction(tables[0], 0.25f).w, 0.0f, 1e-6f);
+	CHECK_NEAR(SampleTransferFunction(tables[0], 0.5f).w, 0.5f, 1e-6f);
+	CHECK_NEAR(SampleTransferFunction(tables[0], 2.0f).w, 1.0f, 1e-6f);
+
+	const float weights[2] = { 1.0f, 0.5f };
+	const float values[2] = { 0.5f, 0.625f };
+	XMFLOAT4 mixed = MixChannels(values, 2, tables, weights);
+	CHECK_NEAR(mixed.w, 0.875f, 1e-5f);
+	CHECK_NEAR(mixed.x, 0.5f / 0.875f, 1e-5f);
+	CHECK_NEAR(mixed.z, 0.375f / 0.875f, 1e-5f);
+
+	// Opacities saturate instead of passing 1.
+	const float bright[2] = { 0.75f, 0.75f };
+	const float full[2] = { 1.0f, 1.0f };
+	CHECK_NEAR(MixChannels(bright, 2, tables, full).w, 1.0f, 1e-6f);
+}
@@ -0,0 +1,197 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "ReferenceRaymarcher.h"
+#include "ShaderPermutations.h"
+#include <algorithm>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	const CompositeMode ProjectionModes[] =
+	{
+		CompositeMode::MaximumIntensity,
+		CompositeMode::MinimumIntensity,
+		CompositeMode::AverageIntensity,
+		CompositeMode::FirstHit,
+	};
+
+	RaymarchCamera TestCamera()
+	{
+		XMMATRIX world = XMMatrixRotationY(0.3f);
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.7f, -2.0f, 0.0f), XMVectorSet(0.0f, -0.1f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, 1.0f, 0.01f, 100.0f);
+		return MakeRaymarchCamera(world, view, projection, XMFLOAT3(0.0f, 0.7f, -2.0f), XMFLOAT3(2.0f, 1.5f, 0.0f));
+	}
+}
+
+TEST_CASE(EachModeSelectsItsOwnPermutation)
+{
+	size_t count = 0;
+	const RaymarchPermutation* table = GetRaymarchPermutations(count);
+	REQUIRE(count > 0);
+	for (size_t i = 0; i < count; ++i)
+	{
+		CHECK(RaymarchPermutationKey::Unpack(table[i].key.Pack()) == table[i].key);
+	}
+
+	// Every format and transfer function pair a request can carry has each mode. Shadows, early out, gradients and
+	// the step count mean nothing to the projection modes, so asking for them changes nothing.
+	const VolumeFormat formats[] = { VolumeFormat::Rgba, VolumeFormat::Paged, VolumeFormat::Channels };
+	for (VolumeFormat format : formats)
+	{
+		for (int transferFunction = 0; transferFunction < 2; ++transferFunction)
+		{
+			for (CompositeMode mode : ProjectionModes)
+			{
+				RaymarchPermutationKey plainRequest = MakeRaymarchRequest(false, true, format, transferFunction != 0, 100, false, mode);
+				int plain = SelectRaymarchPermutation(table, count, plainRequest);
+				REQUIRE(plain >= 0);
+				CHECK(table[plain].key.composite == mode);
+				CHECK(table[plain].key.format == format);
+				CHECK(table[plain].key.transferFunction == plainRequest.transferFunction);
+
+				for (int options = 0; options < 8; ++options)
+				{
+					RaymarchPermutationKey request = MakeRaymarchRequest(
+						(options & 1) != 0, (options & 2) == 0, format, transferFunction != 0, (options & 4) ? 90 : 0, true, mode);
+					CHECK(SelectNearestRaymarchPermutation(table, count, request) == plain);
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE(ProjectionsMatchAPlainReduction)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 48);
+	RaymarchCamera camera = TestCamera();
+	const uint32_t size = 40;
+
+	const CompositeMode modes[] = { CompositeMode::MaximumIntensity, CompositeMode::MinimumIntensity, CompositeMode::AverageIntensity };
+	for (CompositeMode mode : modes)
+	{
+		RaymarchSettings settings;
+		settings.steps = 64;
+		settings.composite = mode;
+		ReferenceImage image;
+		image.Resize(size, size);
+		ReferenceRaymarcher::Render(volume, camera, settings, image);
+
+		// The same jittered sample positions, reduced without any of the march's early stops.
+		float maxError = 0.0f;
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				XMFLOAT3 origin, direction;
+				float tEntry, tExit;
+				if (!ReferenceRaymarcher::ComputeRay(camera, x + 0.5f, y + 0.5f, size, size, origin, direction, tEntry, tExit))
+				{
+					continue;
+				}
+				float stepSize = (tExit - tEntry) / settings.steps;
+				float t = tEntry + ReferenceRaymarcher::InterleavedGradientNoise(x + 0.5f, y + 0.5f) * stepSize;
+				float maximum = 0.0f, minimum = 1.0f, sum = 0.0f;
+				int count = 0;
+				for (int i = 0; i < settings.steps && t <= tExit; ++i, t += stepSize)
+				{
+					float density = volume.SampleAlpha(origin.x + direction.x * t + 0.5f, origin.y + direction.y * t + 0.5f, origin.z + direction.z * t + 0.5f);
+					maximum = std::max(maximum, density);
+					minimum = std::min(minimum, density);
+					sum += density;
+					++count;
+				}
+				float expected = (mode == CompositeMode::MaximumIntensity) ? maximum :
+					(mode == CompositeMode::MinimumIntensity) ? minimum : (count > 0 ? sum / count : 0.0f);
+				expected = (count > 0) ? expected : 0.0f;
+				maxError = std::max(maxError, fabsf(image.color[y * size + x].w - expected));
+			}
+		}
+		CHECK(maxError < 1e-6f);
+	}
+}
+
+TEST_CASE(FirstHitFindsTheSurface)
+{
+	// Density 1 on the side x >= 0 of the box and 0 elsewhere; trilinear filtering puts the 0.5 crossing on x = 0.
+	const uint32_t size = 32;
+	VolumeData volume;
+	volume.Resize(size, size, size);
+	for (uint32_t z = 0; z < size; ++z)
+	{
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				float* voxel = volume.voxels.data() + volume.Index(x, y, z);
+				voxel[0] = voxel[1] = voxel[2] = 1.0f;
+				voxel[3] = (x >= size / 2) ? 1.0f : 0.0f;
+			}
+		}
+	}
+
+	RaymarchCamera camera = TestCamera();
+	RaymarchSettings settings;
+	settings.steps = 128;
+	settings.composite = CompositeMode::FirstHit;
+	ReferenceImage image;
+	image.Resize(32, 32);
+	ReferenceRaymarcher::Render(volume, camera, settings, image);
+
+	uint32_t hits = 0;
+	float maxOffset = 0.0f;
+	for (uint32_t y = 0; y < 32; ++y)
+	{
+		for (uint32_t x = 0; x < 32; ++x)
+		{
+			size_t i = y * 32 + x;
+			if (image.color[i].w != 1.0f)
+			{
+				continue;
+			}
+			++hits;
+			XMFLOAT3 origin, direction;
+			float tEntry, tExit;
+			ReferenceRaymarcher::ComputeRay(camera, x + 0.5f, y + 0.5f, 32, 32, origin, direction, tEntry, tExit);
+			float hitX = origin.x + direction.x * image.weightedDepth[i];
+
+			// Rays entering through the dense half hit at once; the rest should land on the plane.
+			if (origin.x + direction.x * tEntry < -1e-3f)
+			{
+				maxOffset = std::max(maxOffset, fabsf(hitX));
+			}
+		}
+	}
+	CHECK(hits > 0);
+	CHECK(maxOffset < 0.25f / size);
+}
+
+TEST_CASE(SkippingLeavesProjectionsUnchanged)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 48);
+	DistanceField field;
+	BuildDistanceField(volume, DistanceFieldSettings(), field);
+	RaymarchCamera camera = TestCamera();
+
+	const CompositeMode skippingModes[] = { CompositeMode::MaximumIntensity, CompositeMode::FirstHit };
+	for (CompositeMode mode : skippingModes)
+	{
+		RaymarchSettings settings;
+		settings.steps = 96;
+		settings.composite = mode;
+		settings.firstHitThreshold = 0.15f;
+		ReferenceImage plain, skipping;
+		plain.Resize(40, 40);
+		skipping.Resize(40, 40);
+		ReferenceRaymarcher::Render(volume, camera, settings, plain);
+		settings.distanceField = &field;
+		ReferenceRaymarcher::Render(volume, camera, settings, skipping);
+		// Skipped steps advance tCurrent in one addition, so positions agree only to rounding.
+		CHECK(CompareImages(plain, skipping, 1.0f / 255.0f).pixelsAboveThreshold == 0);
+		CHECK(skipping.samples < plain.samples);
+	}
+}
@@ -0,0 +1,166 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "CpuRenderBackend.h"
+#include "Benchmark.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	std::shared_ptr<VolumeData> MakeFogSphere(uint32_t size)
+	{
+		std::shared_ptr<VolumeData> volume = std::make_shared<VolumeData>();
+		GenerateFogSphereVolume(*volume, size);
+		return volume;
+	}
+
+	CameraPose TestPose()
+	{
+		return GetDefaultBenchmarkPaths()[0].Evaluate(1.3);
+	}
+
+	bool SameColors(const ReferenceImage& a, const ReferenceImage& b)
+	{
+		return a.color.size() == b.color.size() &&
+			std::memcmp(a.color.data(), b.color.data(), a.color.size() * sizeof(XMFLOAT4)) == 0;
+	}
+}
+
+TEST_CASE(FrameMatchesDirectReferenceRender)
+{
+	std::shared_ptr<VolumeData> volume = MakeFogSphere(48);
+	CpuRenderBackendSettings settings;
+	settings.width = 80;
+	settings.height = 45;
+	settings.steps = 64;
+	CpuRenderBackend backend(settings);
+	backend.SetVolume(volume);
+
+	CameraPose pose = TestPose();
+	RenderFrameStats stats;
+	REQUIRE(backend.RenderFrame(pose, 7, stats));
+
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, 80.0f / 45.0f, 0.001f, 500.0f);
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&pose.eye), XMLoadFloat3(&pose.target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	RaymarchCamera camera = MakeRaymarchCamera(XMMatrixRotationY(pose.modelRotation), view, projection, pose.eye, pose.lightPosition);
+	RaymarchSettings reference;
+	reference.steps = 64;
+	reference.frameIndex = 7;
+	ReferenceImage image;
+	image.Resize(80, 45);
+	ReferenceRaymarcher::Render(*volume, camera, reference, image);
+
+	CHECK(SameColors(image, backend.GetImage()));
+	CHECK(image.samples == backend.GetImage().samples);
+	CHECK_NEAR(stats.samplesPerPixel, static_cast<double>(image.samples) / (80.0 * 45.0), 1e-9);
+	CHECK(stats.uploadBytes == 0);
+}
+
+TEST_CASE(ThreadCountDoesNotChangeTheImage)
+{
+	std::shared_ptr<VolumeData> volume = MakeFogSphere(32);
+	CpuRenderBackendSettings settings;
+	settings.width = 40;
+	settings.height = 33;
+	settings.steps = 48;
+
+	settings.threadCount = 1;
+	CpuRenderBackend single(settings);
+	single.SetVolume(volume);
+	settings.threadCount = 4;
+	CpuRenderBackend banded(settings);
+	banded.SetVolume(volume);
+
+	RenderFrameStats stats;
+	single.RenderFrame(TestPose(), 3, stats);
+	banded.RenderFrame(TestPose(), 3, stats);
+	CHECK(SameColors(single.GetImage(), banded.GetImage()));
+	CHECK(single.GetImage().samples == banded.GetImage().samples);
+}
+
+TEST_CASE(EmptySpaceSkippingTakesFewerSamples)
+{
+	CpuRenderBackendSettings settings;
+	settings.width = 48;
+	settings.height = 48;
+	settings.steps = 64;
+	CpuRenderBackend backend(settings);
+	backend.SetVolume(MakeFogSphere(48));
+
+	RenderFrameStats plain;
+	backend.RenderFrame(TestPose(), 0, plain);
+
+	RenderOptions options;
+	options.emptySpaceSkipping = true;
+	CHECK(backend.SetOptions(options));
+	RenderFrameStats skipping;
+	backend.RenderFrame(TestPose(), 0, skipping);
+
+	CHECK(plain.samplesPerPixel > 0.0);
+	CHECK(skipping.samplesPerPixel < plain.samplesPerPixel);
+}
+
+TEST_CASE(GeneratesDefaultVolumeAndResizes)
+{
+	CpuRenderBackendSettings settings;
+	settings.width = 16;
+	settings.height = 16;
+	settings.generatedVolumeSize = 32;
+	CpuRenderBackend backend(settings);
+
+	RenderFrameStats stats;
+	CHECK(backend.RenderFrame(TestPose(), 0, stats));
+	CHECK(stats.samplesPerPixel > 0.0);
+
+	backend.Resize(24, 10);
+	CHECK(backend.GetWidth() == 24);
+	CHECK(backend.GetHeight() == 10);
+	backend.RenderFrame(TestPose(), 0, stats);
+	CHECK(backend.GetImage().color.size() == 240);
+}
+
+TEST_CASE(SupportsAndAppliesEveryOption)
+{
+	CpuRenderBackendSettings settings;
+	settings.width = 24;
+	settings.height = 24;
+	settings.steps = 32;
+	CpuRenderBackend backend(settings);
+	backend.SetVolume(MakeFogSphere(32));
+
+	RenderFrameStats stats;
+	backend.RenderFrame(TestPose(), 0, stats);
+	ReferenceImage alpha = backend.GetImage();
+
+	const CompositeMode modes[] =
+	{
+		CompositeMode::Alpha,
+		CompositeMode::MaximumIntensity,
+		CompositeMode::MinimumIntensity,
+		CompositeMode::AverageIntensity,
+		CompositeMode::FirstHit,
+	};
+	const std::vector<XMFLOAT4> tables[] = { std::vector<XMFLOAT4>(), std::vector<XMFLOAT4>(16, XMFLOAT4(1.0f, 0.5f, 0.25f, 0.5f)) };
+	for (const std::vector<XMFLOAT4>& table : tables)
+	{
+		backend.SetTransferFunction(table);
+		for (CompositeMode mode : modes)
+		{
+			for (int flags = 0; flags < 4; ++flags)
+			{
+				RenderOptions options;
+				options.shadows = (flags & 1) != 0;
+				options.emptySpaceSkipping = (flags & 2) != 0;
+				options.composite = mode;
+				CHECK(backend.SupportsOptions(options));
+				CHECK(backend.SetOptions(options));
+			}
+		}
+	}
+
+	// The last options applied are the ones rendered.
+	backend.SetTransferFunction(std::vector<XMFLOAT4>());
+	backend.RenderFrame(TestPose(), 0, stats);
+	CHECK(!SameColors(backend.GetImage(), alpha));
+}
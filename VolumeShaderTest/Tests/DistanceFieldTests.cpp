@@ -0,0 +1,212 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "Benchmark.h"
+#include "DistanceField.h"
+#include "ReferenceRaymarcher.h"
+#include <limits>
+#include <random>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// Squared distance to the nearest occupied cell by checking every pair.
+	std::vector<float> BruteForceTransform(const std::vector<uint8_t>& occupied, uint32_t width, uint32_t height, uint32_t depth)
+	{
+		std::vector<float> result(occupied.size(), std::numeric_limits<float>::infinity());
+		for (uint32_t z = 0; z < depth; ++z)
+		{
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					float& nearest = result[(static_cast<size_t>(z) * height + y) * width + x];
+					for (size_t i = 0; i < occupied.size(); ++i)
+					{
+						if (!occupied[i])
+						{
+							continue;
+						}
+						float dx = static_cast<float>(static_cast<int>(i % width) - static_cast<int>(x));
+						float dy = static_cast<float>(static_cast<int>((i / width) % height) - static_cast<int>(y));
+						float dz = static_cast<float>(static_cast<int>(i / (static_cast<size_t>(width) * height)) - static_cast<int>(z));
+						float squared = dx * dx + dy * dy + dz * dz;
+						nearest = (squared < nearest) ? squared : nearest;
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+	RaymarchCamera TestCamera(uint32_t width, uint32_t height)
+	{
+		CameraPose pose = GetDefaultBenchmarkPaths()[0].Evaluate(1.3);
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, static_cast<float>(width) / height, 0.001f, 500.0f);
+		XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&pose.eye), XMLoadFloat3(&pose.target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		return MakeRaymarchCamera(XMMatrixRotationY(pose.modelRotation), view, projection, pose.eye, pose.lightPosition);
+	}
+}
+
+TEST_CASE(TransformMatchesBruteForce)
+{
+	const uint32_t width = 11, height = 7, depth = 9;
+	std::mt19937 random(17);
+	std::bernoulli_distribution occupiedChance(0.04);
+	std::vector<uint8_t> occupied(static_cast<size_t>(width) * height * depth);
+	for (uint8_t& cell : occupied)
+	{
+		cell = occupiedChance(random) ? 1 : 0;
+	}
+	occupied[0] = 1;
+	std::vector<float> expected = BruteForceTransform(occupied, width, height, depth);
+
+	const uint32_t threadCounts[] = { 1, 3, 8 };
+	for (uint32_t threads : threadCounts)
+	{
+		std::vector<float> squared;
+		ComputeSquaredDistanceTransform(occupied.data(), width, height, depth, threads, squared);
+		REQUIRE(squared.size() == expected.size());
+		bool same = true;
+		for (size_t i = 0; i < squared.size(); ++i)
+		{
+			same = same && squared[i] == expected[i];
+		}
+		CHECK(same);
+	}
+}
+
+TEST_CASE(EmptyGridIsInfinitelyFar)
+{
+	std::vector<uint8_t> occupied(5 * 4 * 3, 0);
+	std::vector<float> squared;
+	ComputeSquaredDistanceTransform(occupied.data(), 5, 4, 3, 2, squared);
+	REQUIRE(squared.size() == occupied.size());
+	for (float value : squared)
+	{
+		CHECK(value == std::numeric_limits<float>::infinity());
+	}
+
+	// The field still bounds a jump by the grid rather than passing infinity to the shader.
+	VolumeData volume;
+	volume.Resize(16, 16, 16);
+	std::fill(volume.voxels.begin(), volume.voxels.end(), 0.0f);
+	DistanceField field;
+	BuildDistanceField(volume, DistanceFieldSettings(), field);
+	REQUIRE(field.distance.size() == 64);
+	CHECK_NEAR(field.distance[0], sqrtf(48.0f), 1e-5);
+}
+
+TEST_CASE(FieldIsConservative)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 48);
+	DistanceFieldSettings settings;
+	DistanceField field;
+	BuildDistanceField(volume, settings, field);
+	REQUIRE(field.width == 12 && field.height == 12 && field.depth == 12);
+
+	// Every voxel above the threshold lies in an occupied cell.
+	bool covered = true;
+	for (uint32_t z = 0; z < volume.depth; ++z)
+	{
+		for (uint32_t y = 0; y < volume.height; ++y)
+		{
+			for (uint32_t x = 0; x < volume.width; ++x)
+			{
+				if (volume.voxels[volume.Index(x, y, z) + 3] > settings.threshold)
+				{
+					covered = covered && field.occupied[field.Index(x / 4, y / 4, z / 4)] != 0;
+				}
+			}
+		}
+	}
+	CHECK(covered);
+
+	// No cell claims more room than the closest pair of points between it and an occupied cell allows.
+	bool bounded = true;
+	size_t emptyCells = 0;
+	for (uint32_t z = 0; z < field.depth; ++z)
+	{
+		for (uint32_t y = 0; y < field.height; ++y)
+		{
+			for (uint32_t x = 0; x < field.width; ++x)
+			{
+				float distance = field.distance[field.Index(x, y, z)];
+				emptyCells += (distance > 0.0f) ? 1 : 0;
+				for (size_t i = 0; i < field.occupied.size(); ++i)
+				{
+					if (!field.occupied[i])
+					{
+						continue;
+					}
+					float dx = static_cast<float>(static_cast<int>(i % field.width) - static_cast<int>(x));
+					float dy = static_cast<float>(static_cast<int>((i / field.width) % field.height) - static_cast<int>(y));
+					float dz = static_cast<float>(static_cast<int>(i / (static_cast<size_t>(field.width) * field.height)) - static_cast<int>(z));
+					float gap = sqrtf(dx * dx + dy * dy + dz * dz) - 1.7320508f;
+					bounded = bounded && distance <= ((gap > 0.0f) ? gap : 0.0f) + 1e-5f;
+				}
+			}
+		}
+	}
+	CHECK(bounded);
+	CHECK(emptyCells > 0);
+}
+
+TEST_CASE(UpdateMatchesRebuildAfterEdit)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 48);
+	DistanceFieldSettings settings;
+	DistanceField field;
+	BuildDistanceField(volume, settings, field);
+
+	// Clears a block near one corner, then lights a single voxel inside it.
+	uint32_t voxelMin[3] = { 2, 2, 2 };
+	uint32_t voxelMax[3] = { 12, 10, 11 };
+	for (uint32_t z = voxelMin[2]; z < voxelMax[2]; ++z)
+	{
+		for (uint32_t y = voxelMin[1]; y < voxelMax[1]; ++y)
+		{
+			for (uint32_t x = voxelMin[0]; x < voxelMax[0]; ++x)
+			{
+				volume.voxels[volume.Index(x, y, z) + 3] = 0.0f;
+			}
+		}
+	}
+	volume.voxels[volume.Index(5, 6, 7) + 3] = 0.5f;
+
+	CHECK(UpdateOccupancy(volume, settings, voxelMin, voxelMax, field));
+	CHECK(!UpdateOccupancy(volume, settings, voxelMin, voxelMax, field));
+	RecomputeDistances(settings, field);
+
+	DistanceField rebuilt;
+	BuildDistanceField(volume, settings, rebuilt);
+	CHECK(field.occupied == rebuilt.occupied);
+	CHECK(field.distance == rebuilt.distance);
+}
+
+TEST_CASE(SkippingKeepsTheImageWithFewerSamples)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 48);
+	DistanceField field;
+	BuildDistanceField(volume, DistanceFieldSettings(), field);
+
+	RaymarchCamera camera = TestCamera(64, 48);
+	RaymarchSettings settings;
+	settings.steps = 128;
+	ReferenceImage plain;
+	plain.Resize(64, 48);
+	ReferenceRaymarcher::Render(volume, camera, settings, plain);
+
+	settings.distanceField = &field;
+	ReferenceImage skipping;
+	skipping.Resize(64, 48);
+	ReferenceRaymarcher::Render(volume, camera, settings, skipping);
+
+	ImageError error = CompareImages(plain, skipping, 1.0f / 255.0f);
+	CHECK(skipping.samples < plain.samples);
+	CHECK(error.pixelsAboveThreshold == 0);
+}
@@ -0,0 +1,326 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "EditJournal.h"
+#include "VolumeEditing.h"
+#include <algorithm>
+#include <random>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	typedef ArenaVector<float> Voxels;
+
+	// 8^3 bricks of four floats per voxel.
+	const uint64_t BrickBytes = 8 * 8 * 8 * 4 * sizeof(float);
+
+	EditJournalSettings Settings(uint32_t maxEntries = 256, uint64_t memoryBudget = 512ull << 20)
+	{
+		EditJournalSettings settings;
+		settings.brickSize = 8;
+		settings.maxEntries = maxEntries;
+		settings.memoryBudget = memoryBudget;
+		return settings;
+	}
+
+	void FillRandom(VolumeData& volume, uint32_t width, uint32_t height, uint32_t depth, uint32_t seed)
+	{
+		volume.Resize(width, height, depth);
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> values(0.0f, 1.0f);
+		for (float& value : volume.voxels)
+		{
+			value = values(random);
+		}
+	}
+
+	// One closed step writing seeded noise into region.
+	void Edit(EditJournal& journal, VolumeData& volume, const VoxelRegion& region, uint32_t seed)
+	{
+		journal.BeforeEdit(volume, region);
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> values(0.0f, 1.0f);
+		for (uint32_t z = region.min[2]; z < region.max[2]; ++z)
+		{
+			for (uint32_t y = region.min[1]; y < region.max[1]; ++y)
+			{
+				for (uint32_t x = region.min[0]; x < region.max[0]; ++x)
+				{
+					float* voxel = volume.voxels.data() + volume.Index(x, y, z);
+					for (int c = 0; c < 4; ++c)
+					{
+						voxel[c] = values(random);
+					}
+				}
+			}
+		}
+		journal.CloseStep(volume);
+	}
+
+	// Every voxel that differs between the two volumes lies in one of the regions.
+	bool ChangesCovered(const VolumeData& a, const VolumeData& b, const std::vector<VoxelRegion>& regions)
+	{
+		for (uint32_t z = 0; z < a.depth; ++z)
+		{
+			for (uint32_t y = 0; y < a.height; ++y)
+			{
+				for (uint32_t x = 0; x < a.width; ++x)
+				{
+					size_t i = a.Index(x, y, z);
+					if (std::equal(a.voxels.begin() + i, a.voxels.begin() + i + 4, b.voxels.begin() + i))
+					{
+						continue;
+					}
+					bool covered = false;
+					for (const VoxelRegion& region : regions)
+					{
+						covered = covered || (x >= region.min[0] && x < region.max[0] && y >= region.min[1] && y < region.max[1] && z >= region.min[2] && z < region.max[2]);
+					}
+					if (!covered)
+					{
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+}
+
+TEST_CASE(UndoAndRedoRestoreExactVoxels)
+{
+	// Odd sizes leave partial bricks on the far side of every axis.
+	VolumeData volume;
+	FillRandom(volume, 21, 18, 11, 1);
+	EditJournal journal(Settings());
+	journal.Reset(volume);
+
+	std::vector<Voxels> states(1, volume.voxels);
+	const VoxelRegion edits[] =
+	{
+		VoxelRegion(2, 2, 2, 5, 5, 5),
+		VoxelRegion(6, 6, 0, 20, 12, 11),
+		VoxelRegion(3, 3, 3, 4, 4, 4),
+		VoxelRegion(0, 0, 0, 21, 18, 11),
+		VoxelRegion(16, 16, 8, 21, 18, 11),
+	};
+	for (uint32_t i = 0; i < 5; ++i)
+	{
+		Edit(journal, volume, edits[i], 100 + i);
+		states.push_back(volume.voxels);
+	}
+	CHECK(journal.GetStats().undoSteps == 5);
+
+	std::vector<VoxelRegion> restored;
+	for (size_t i = states.size() - 1; i > 0; --i)
+	{
+		VolumeData before = volume;
+		restored.clear();
+		REQUIRE(journal.Undo(volume, restored));
+		CHECK(volume.voxels == states[i - 1]);
+		CHECK(ChangesCovered(before, volume, restored));
+	}
+	CHECK(!journal.Undo(volume, restored));
+	CHECK(journal.GetStats().redoSteps == 5);
+
+	for (size_t i = 1; i < states.size(); ++i)
+	{
+		VolumeData before = volume;
+		restored.clear();
+		REQUIRE(journal.Redo(volume, restored));
+		CHECK(volume.voxels == states[i]);
+		CHECK(ChangesCovered(before, volume, restored));
+	}
+	CHECK(!journal.Redo(volume, restored));
+	CHECK(journal.GetStats().undoSteps == 5);
+	CHECK(journal.GetStats().redoSteps == 0);
+}
+
+TEST_CASE(NewEditDropsRedo)
+{
+	VolumeData volume;
+	FillRandom(volume, 16, 16, 16, 2);
+	EditJournal journal(Settings());
+	journal.Reset(volume);
+	Voxels initial = volume.voxels;
+
+	Edit(journal, volume, VoxelRegion(0, 0, 0, 4, 4, 4), 1);
+	Voxels afterFirst = volume.voxels;
+	Edit(journal, volume, VoxelRegion(2, 2, 2, 10, 10, 10), 2);
+
+	std::vector<VoxelRegion> restored;
+	REQUIRE(journal.Undo(volume, restored));
+	CHECK(journal.GetStats().redoSteps == 1);
+
+	Edit(journal, volume, VoxelRegion(12, 12, 12, 16, 16, 16), 3);
+	Voxels afterThird = volume.voxels;
+	CHECK(journal.GetStats().undoSteps == 2);
+	CHECK(journal.GetStats().redoSteps == 0);
+	CHECK(!journal.Redo(volume, restored));
+	CHECK(volume.voxels == afterThird);
+
+	REQUIRE(journal.Undo(volume, restored));
+	CHECK(volume.voxels == afterFirst);
+	REQUIRE(journal.Undo(volume, restored));
+	CHECK(volume.voxels == initial);
+
+	// A step that changed nothing is not a step and does not drop redo either.
+	journal.BeforeEdit(volume, VoxelRegion(0, 0, 0, 16, 16, 16));
+	journal.CloseStep(volume);
+	CHECK(journal.GetStats().redoSteps == 2);
+}
+
+TEST_CASE(StrokesAreOneStep)
+{
+	VolumeEditorSettings settings;
+	settings.journal = Settings();
+	VolumeEditor editor(settings);
+	editor.GetVolume().Resize(24, 24, 24);
+	std::fill(editor.GetVolume().voxels.begin(), editor.GetVolume().voxels.end(), 0.0f);
+	editor.Rebuild();
+	Voxels initial = editor.GetVolume().voxels;
+
+	VolumeBrush brush;
+	brush.extents = DirectX::XMFLOAT3(3.0f, 3.0f, 3.0f);
+	brush.center = DirectX::XMFLOAT3(4.0f, 4.0f, 4.0f);
+	editor.Apply(brush);
+	Voxels afterDab = editor.GetVolume().voxels;
+
+	editor.BeginStroke();
+	for (int i = 0; i < 4; ++i)
+	{
+		brush.center = DirectX::XMFLOAT3(6.0f + 3.0f * i, 12.0f, 12.0f);
+		editor.Apply(brush);
+	}
+	editor.EndStroke();
+	Voxels afterStroke = editor.GetVolume().voxels;
+
+	// Dabs outside a stroke are a step each.
+	brush.center = DirectX::XMFLOAT3(18.0f, 18.0f, 18.0f);
+	editor.Apply(brush);
+	brush.center = DirectX::XMFLOAT3(18.0f, 4.0f, 18.0f);
+	editor.Apply(brush);
+	CHECK(editor.GetJournalStats().undoSteps == 4);
+
+	CHECK(!editor.Undo().Empty());
+	CHECK(!editor.Undo().Empty());
+	CHECK(editor.GetVolume().voxels == afterStroke);
+	CHECK(!editor.Undo().Empty());
+	CHECK(editor.GetVolume().voxels == afterDab);
+	CHECK(!editor.Undo().Empty());
+	CHECK(editor.GetVolume().voxels == initial);
+	CHECK(editor.Undo().Empty());
+
+	CHECK(!editor.Redo().Empty());
+	CHECK(!editor.Redo().Empty());
+	CHECK(editor.GetVolume().voxels == afterStroke);
+
+	// Undo in the middle of a stroke closes it first, so it takes back the dabs made so far.
+	editor.BeginStroke();
+	brush.center = DirectX::XMFLOAT3(12.0f, 4.0f, 4.0f);
+	editor.Apply(brush);
+	brush.center = DirectX::XMFLOAT3(14.0f, 4.0f, 4.0f);
+	editor.Apply(brush);
+	CHECK(!editor.Undo().Empty());
+	CHECK(editor.GetVolume().voxels == afterStroke);
+	CHECK(editor.GetJournalStats().undoSteps == 2);
+	CHECK(editor.GetJournalStats().redoSteps == 1);
+}
+
+TEST_CASE(TrimKeepsMaxEntries)
+{
+	VolumeData volume;
+	FillRandom(volume, 16, 16, 16, 3);
+	EditJournal journal(Settings(3));
+	journal.Reset(volume);
+
+	std::vector<Voxels> states(1, volume.voxels);
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		Edit(journal, volume, VoxelRegion(i, i, i, i + 4, i + 4, i + 4), 10 + i);
+		states.push_back(volume.voxels);
+		CHECK(journal.GetStats().undoSteps == std::min(i + 1, 3u));
+	}
+
+	std::vector<VoxelRegion> restored;
+	for (size_t i = 6; i > 3; --i)
+	{
+		REQUIRE(journal.Undo(volume, restored));
+		CHECK(volume.voxels == states[i - 1]);
+	}
+	CHECK(!journal.Undo(volume, restored));
+	CHECK(volume.voxels == states[3]);
+}
+
+TEST_CASE(TrimKeepsTheMemoryBudget)
+{
+	// Steps in separate bricks each keep two versions, so five versions hold two steps.
+	VolumeData volume;
+	FillRandom(volume, 32, 8, 8, 4);
+	const uint64_t budget = 5 * BrickBytes;
+	EditJournal journal(Settings(256, budget));
+	journal.Reset(volume);
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		Edit(journal, volume, VoxelRegion(8 * i + 1, 1, 1, 8 * i + 3, 3, 3), 20 + i);
+		CHECK(journal.GetStats().versionBytes <= budget);
+		CHECK(journal.GetStats().undoSteps == std::min(i + 1, 2u));
+	}
+	CHECK(journal.GetStats().versions == 4);
+	CHECK(journal.GetStats().versionBytes == 4 * BrickBytes);
+
+	// A step larger than the whole budget cannot be kept at all.
+	Edit(journal, volume, VoxelRegion(0, 0, 0, 32, 8, 8), 30);
+	CHECK(journal.GetStats().undoSteps == 0);
+	CHECK(journal.GetStats().versions == 0);
+	CHECK(journal.GetStats().versionBytes == 0);
+	std::vector<VoxelRegion> restored;
+	CHECK(!journal.Undo(volume, restored));
+}
+
+TEST_CASE(VersionsReturnToBaseline)
+{
+	VolumeData volume;
+	FillRandom(volume, 16, 16, 16, 5);
+	EditJournal journal(Settings());
+	journal.Reset(volume);
+	CHECK(journal.GetStats().versions == 0);
+	CHECK(journal.GetStats().versionBytes == 0);
+
+	// Nothing changed, nothing kept.
+	journal.BeforeEdit(volume, VoxelRegion(0, 0, 0, 16, 16, 16));
+	journal.CloseStep(volume);
+	CHECK(journal.GetStats().undoSteps == 0);
+	CHECK(journal.GetStats().versions == 0);
+
+	// Three steps on one brick share versions: four in all, not six.
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		Edit(journal, volume, VoxelRegion(1, 1, 1, 3, 3, 3), 40 + i);
+	}
+	CHECK(journal.GetStats().versions == 4);
+	CHECK(journal.GetStats().versionBytes == 4 * BrickBytes);
+
+	// Undo keeps every version for redo; dropping the redo steps frees the ones only they needed.
+	std::vector<VoxelRegion> restored;
+	REQUIRE(journal.Undo(volume, restored));
+	REQUIRE(journal.Undo(volume, restored));
+	CHECK(journal.GetStats().versions == 4);
+	Edit(journal, volume, VoxelRegion(9, 9, 9, 11, 11, 11), 50);
+	CHECK(journal.GetStats().undoSteps == 2);
+	CHECK(journal.GetStats().versions == 4);
+	CHECK(journal.GetStats().versionBytes == 4 * BrickBytes);
+
+	journal.Reset(volume);
+	CHECK(journal.GetStats().versions == 0);
+	CHECK(journal.GetStats().versionBytes == 0);
+
+	// With no history allowed, nothing outlives the step.
+	EditJournal none(Settings(0));
+	none.Reset(volume);
+	Edit(none, volume, VoxelRegion(0, 0, 0, 12, 12, 12), 60);
+	CHECK(none.GetStats().undoSteps == 0);
+	CHECK(none.GetStats().versions == 0);
+	CHECK(none.GetStats().versionBytes == 0);
+}
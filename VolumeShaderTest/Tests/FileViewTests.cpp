@@ -0,0 +1,122 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "Common/FileView.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	DX::FilePath ToFilePath(const std::filesystem::path& path)
+	{
+#if defined(_WIN32)
+		return path.wstring();
+#else
+		return path.string();
+#endif
+	}
+
+	std::filesystem::path WriteFile(const char* name, const std::vector<uint8_t>& bytes)
+	{
+		std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return path;
+	}
+
+	std::vector<uint8_t> Pattern(size_t size)
+	{
+		std::vector<uint8_t> bytes(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			bytes[i] = static_cast<uint8_t>(i * 131 + (i >> 8));
+		}
+		return bytes;
+	}
+}
+
+TEST_CASE(MapsTheWholeFile)
+{
+	// Not a whole number of pages, so the tail of the last page is past the end of the file.
+	std::vector<uint8_t> bytes = Pattern(3 * 4096 + 123);
+	std::filesystem::path path = WriteFile("FileViewTests-map.bin", bytes);
+
+	bool valid = false;
+	DX::FileView view = DX::OpenFileView(ToFilePath(path), valid);
+	CHECK(valid);
+	REQUIRE(view.Size() == bytes.size());
+	CHECK(!view.Empty());
+	CHECK(view.IsMapped());
+	CHECK(std::memcmp(view.Data(), bytes.data(), bytes.size()) == 0);
+
+	view = DX::FileView();
+	std::filesystem::remove(path);
+}
+
+TEST_CASE(EmptyFileIsValidAndEmpty)
+{
+	std::filesystem::path path = WriteFile("FileViewTests-empty.bin", std::vector<uint8_t>());
+
+	bool valid = false;
+	DX::FileView view = DX::OpenFileView(ToFilePath(path), valid);
+	CHECK(valid);
+	CHECK(view.Empty());
+	CHECK(view.Size() == 0);
+
+	std::filesystem::remove(path);
+}
+
+TEST_CASE(MissingFileIsNotValid)
+{
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "FileViewTests-missing" / "none.bin";
+
+	bool valid = true;
+	DX::FileView view = DX::OpenFileView(ToFilePath(path), valid);
+	CHECK(!valid);
+	CHECK(view.Empty());
+	CHECK(view.Data() == nullptr);
+}
+
+TEST_CASE(SubviewsAndCopiesOutliveTheView)
+{
+	std::vector<uint8_t> bytes = Pattern(10000);
+	std::filesystem::path path = WriteFile("FileViewTests-subview.bin", bytes);
+
+	DX::FileView copy;
+	DX::FileView tail;
+	{
+		bool valid = false;
+		DX::FileView view = DX::OpenFileView(ToFilePath(path), valid);
+		REQUIRE(valid);
+		copy = view;
+		tail = view.Subview(9000, 5000);
+	}
+
+	// The file can go too; the mapping holds the pages.
+	std::filesystem::remove(path);
+
+	REQUIRE(copy.Size() == bytes.size());
+	CHECK(std::memcmp(copy.Data(), bytes.data(), bytes.size()) == 0);
+	REQUIRE(tail.Size() == 1000);
+	CHECK(tail.IsMapped());
+	CHECK(std::memcmp(tail.Data(), bytes.data() + 9000, 1000) == 0);
+
+	// Subviews clamp to the view.
+	CHECK(tail.Subview(2000, 10).Empty());
+	CHECK(copy.Subview(0, bytes.size() + 1).Size() == bytes.size());
+}
+
+TEST_CASE(BufferViewsKeepTheirBuffer)
+{
+	std::vector<uint8_t> bytes = Pattern(777);
+	DX::FileView middle;
+	{
+		DX::FileView view = DX::MakeFileView(std::vector<uint8_t>(bytes));
+		CHECK(!view.IsMapped());
+		middle = view.Subview(100, 200);
+	}
+
+	REQUIRE(middle.Size() == 200);
+	CHECK(std::memcmp(middle.Data(), bytes.data() + 100, 200) == 0);
+}
@@ -0,0 +1,230 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "GradientVolume.h"
+#include <random>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	// One quantization step of the packed normal, plus rounding in the unpacked length.
+	const float NormalTolerance = 0.02f;
+
+	struct Field
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		std::vector<float> values;	// Four floats per voxel, density in the last one, like VolumeData.
+
+		size_t Index(uint32_t x, uint32_t y, uint32_t z) const { return (static_cast<size_t>(z) * height + y) * width + x; }
+		const float* Density() const { return values.data() + 3; }
+	};
+
+	template <typename Function>
+	Field MakeField(uint32_t width, uint32_t height, uint32_t depth, Function&& density)
+	{
+		Field field = { width, height, depth };
+		field.values.assign(static_cast<size_t>(width) * height * depth * 4, 0.25f);
+		for (uint32_t z = 0; z < depth; ++z)
+		{
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					field.values[field.Index(x, y, z) * 4 + 3] = density(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+				}
+			}
+		}
+		return field;
+	}
+
+	std::vector<uint32_t> Build(const Field& field, uint32_t threadCount = 1)
+	{
+		GradientBuildSettings settings;
+		settings.threadCount = threadCount;
+		std::vector<uint32_t> texels;
+		BuildGradientVolume(field.Density(), 4, field.width, field.height, field.depth, settings, texels);
+		return texels;
+	}
+
+	void CheckTexel(uint32_t texel, float gx, float gy, float gz)
+	{
+		const float maxMagnitude = GradientBuildSettings().maxMagnitude;
+		float normal[3], magnitude;
+		UnpackGradient(texel, maxMagnitude, normal, magnitude);
+		float length = std::sqrt(gx * gx + gy * gy + gz * gz);
+		CHECK_NEAR(magnitude, length, maxMagnitude / 255.0f);
+		CHECK_NEAR(normal[0], -gx / length, NormalTolerance);
+		CHECK_NEAR(normal[1], -gy / length, NormalTolerance);
+		CHECK_NEAR(normal[2], -gz / length, NormalTolerance);
+	}
+}
+
+TEST_CASE(LinearFieldHasItsSlopeEverywhereInside)
+{
+	const float a = 0.02f, b = -0.03f, c = 0.01f;
+	Field field = MakeField(13, 10, 9, [&](float x, float y, float z) { return 0.5f + a * x + b * y + c * z; });
+	std::vector<uint32_t> texels = Build(field);
+	REQUIRE(texels.size() == static_cast<size_t>(13) * 10 * 9);
+
+	for (uint32_t z = 1; z + 1 < field.depth; ++z)
+	{
+		for (uint32_t y = 1; y + 1 < field.height; ++y)
+		{
+			for (uint32_t x = 1; x + 1 < field.width; ++x)
+			{
+				CheckTexel(texels[field.Index(x, y, z)], a, b, c);
+			}
+		}
+	}
+}
+
+TEST_CASE(SphereNormalsPointOutward)
+{
+	const float center = 15.5f, radius = 12.0f;
+	Field field = MakeField(32, 32, 32, [&](float x, float y, float z)
+	{
+		float dx = x - center, dy = y - center, dz = z - center;
+		float falloff = 1.0f - std::sqrt(dx * dx + dy * dy + dz * dz) / radius;
+		return (falloff < 0.0f) ? 0.0f : falloff;
+	});
+	std::vector<uint32_t> texels = Build(field);
+
+	// Away from the center and the rim, the gradient is radial with a magnitude of 1 / radius.
+	const float maxMagnitude = GradientBuildSettings().maxMagnitude;
+	float worst = 1.0f;
+	size_t checked = 0;
+	for (uint32_t z = 0; z < field.depth; ++z)
+	{
+		for (uint32_t y = 0; y < field.height; ++y)
+		{
+			for (uint32_t x = 0; x < field.width; ++x)
+			{
+				float dx = x - center, dy = y - center, dz = z - center;
+				float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+				if (distance < 3.0f || distance > radius - 2.0f)
+				{
+					continue;
+				}
+				float normal[3], magnitude;
+				UnpackGradient(texels[field.Index(x, y, z)], maxMagnitude, normal, magnitude);
+				float cosine = (normal[0] * dx + normal[1] * dy + normal[2] * dz) / distance;
+				worst = (cosine < worst) ? cosine : worst;
+				CHECK_NEAR(magnitude, 1.0f / radius, 0.1f / radius + maxMagnitude / 255.0f);
+				++checked;
+			}
+		}
+	}
+	CHECK(checked > 1000);
+	CHECK(worst > 0.98f);
+}
+
+TEST_CASE(OctahedralEncodingRoundTrips)
+{
+	const float maxMagnitude = 2.0f;
+	std::vector<std::vector<float>> directions = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ 1, 1, 1 }, { -1, 1, -1 }, { 1, -1, 1 }, { -1, -1, -1 }, { 0.3f, 0, -0.9f }, { 0, 0.5f, 0.5f } };
+	std::mt19937 random(3);
+	std::normal_distribution<float> gaussian;
+	for (int i = 0; i < 2000; ++i)
+	{
+		directions.push_back({ gaussian(random), gaussian(random), gaussian(random) });
+	}
+
+	std::uniform_real_distribution<float> lengths(0.01f, 1.9f);
+	for (const std::vector<float>& direction : directions)
+	{
+		float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+		float scale = lengths(random) / length;
+		float gx = direction[0] * scale, gy = direction[1] * scale, gz = direction[2] * scale;
+
+		uint32_t texel = PackGradient(gx, gy, gz, maxMagnitude);
+		CHECK((texel >> 24) == 0xFF);
+		float normal[3], magnitude;
+		UnpackGradient(texel, maxMagnitude, normal, magnitude);
+		CHECK_NEAR(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2], 1.0f, 1e-5f);
+		float cosine = -(normal[0] * gx + normal[1] * gy + normal[2] * gz) / (length * scale);
+		CHECK(cosine > 0.9995f);
+		CHECK_NEAR(magnitude, length * scale, 0.5f * maxMagnitude / 255.0f + 1e-5f);
+	}
+
+	// Magnitudes past the range saturate instead of wrapping.
+	float normal[3], magnitude;
+	UnpackGradient(PackGradient(0.0f, 0.0f, -5.0f, maxMagnitude), maxMagnitude, normal, magnitude);
+	CHECK(magnitude == maxMagnitude);
+	CHECK_NEAR(normal[2], 1.0f, NormalTolerance);
+}
+
+TEST_CASE(ZeroGradientPacksToAFixedTexel)
+{
+	const uint32_t zero = 0xFF000000u | (128u << 8) | 128u;
+	CHECK(PackGradient(0.0f, 0.0f, 0.0f, 1.0f) == zero);
+
+	float normal[3], magnitude;
+	UnpackGradient(zero, 1.0f, normal, magnitude);
+	CHECK(magnitude == 0.0f);
+	CHECK(normal[2] > 0.99f);
+
+	// A flat field is zero everywhere, edges included.
+	Field field = MakeField(7, 6, 5, [](float, float, float) { return 0.6f; });
+	for (uint32_t texel : Build(field))
+	{
+		CHECK(texel == zero);
+	}
+}
+
+TEST_CASE(EdgesReplicateTheBorderVoxel)
+{
+	// With clamped edges the central difference at the border spans one voxel instead of two, so the slope
+	// along the axis halves and the other axes stay zero.
+	const float a = 0.05f;
+	Field field = MakeField(9, 5, 4, [&](float x, float, float) { return 0.1f + a * x; });
+	std::vector<uint32_t> texels = Build(field);
+	for (uint32_t z = 0; z < field.depth; ++z)
+	{
+		for (uint32_t y = 0; y < field.height; ++y)
+		{
+			CheckTexel(texels[field.Index(0, y, z)], a * 0.5f, 0.0f, 0.0f);
+			CheckTexel(texels[field.Index(4, y, z)], a, 0.0f, 0.0f);
+			CheckTexel(texels[field.Index(field.width - 1, y, z)], a * 0.5f, 0.0f, 0.0f);
+		}
+	}
+
+	// One voxel thick along an axis, the difference along it is zero.
+	Field slab = MakeField(6, 6, 1, [&](float x, float y, float) { return 0.2f + a * (x + y); });
+	std::vector<uint32_t> slabTexels = Build(slab);
+	CheckTexel(slabTexels[slab.Index(2, 3, 0)], a, a, 0.0f);
+}
+
+TEST_CASE(ThreadsAndRegionUpdatesMatchOneBuild)
+{
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	Field field = MakeField(21, 14, 17, [&](float, float, float) { return unit(random); });
+	std::vector<uint32_t> single = Build(field, 1);
+	CHECK(Build(field, 3) == single);
+	CHECK(Build(field, 64) == single);
+	CHECK(Build(field, 0) == single);
+
+	// Edit a box, then refilter it grown by one voxel.
+	std::vector<uint32_t> texels = single;
+	for (uint32_t z = 4; z < 9; ++z)
+	{
+		for (uint32_t y = 0; y < 3; ++y)
+		{
+			for (uint32_t x = 15; x < 21; ++x)
+			{
+				field.values[field.Index(x, y, z) * 4 + 3] = 1.0f;
+			}
+		}
+	}
+	const uint32_t voxelMin[3] = { 14, 0, 3 };
+	const uint32_t voxelMax[3] = { 22, 4, 10 };
+	GradientBuildSettings settings;
+	settings.threadCount = 2;
+	UpdateGradientRegion(field.Density(), 4, field.width, field.height, field.depth, voxelMin, voxelMax, settings, texels);
+	CHECK(texels != single);
+	CHECK(texels == Build(field, 1));
+}
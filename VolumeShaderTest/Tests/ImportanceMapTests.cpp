@@ -0,0 +1,155 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "ImportanceMap.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// An image with every pixel a hit of the given alpha.
+	ReferenceImage MakeImage(uint32_t width, uint32_t height, float alpha)
+	{
+		ReferenceImage image;
+		image.Resize(width, height);
+		for (size_t i = 0; i < image.color.size(); ++i)
+		{
+			image.color[i] = XMFLOAT4(alpha, alpha, alpha, alpha);
+			image.entryDepth[i] = 1.0f;
+		}
+		return image;
+	}
+
+	void FillTile(ReferenceImage& image, uint32_t tileX, uint32_t tileY, uint32_t tileSize, float (*alpha)(uint32_t x, uint32_t y))
+	{
+		for (uint32_t y = tileY * tileSize; y < (tileY + 1) * tileSize; ++y)
+		{
+			for (uint32_t x = tileX * tileSize; x < (tileX + 1) * tileSize; ++x)
+			{
+				size_t pixel = static_cast<size_t>(y) * image.width + x;
+				float a = alpha(x, y);
+				image.color[pixel] = XMFLOAT4(a, a, a, a < 0.0f ? 0.0f : a);
+				image.entryDepth[pixel] = (a < 0.0f) ? -1.0f : 1.0f;
+			}
+		}
+	}
+
+	ImportanceSettings NoMargin()
+	{
+		ImportanceSettings settings;
+		settings.margin = 0;
+		return settings;
+	}
+
+	const char* const ClassNames[] = { "empty", "transparent", "opaque", "detailed" };
+}
+
+TEST_CASE(BudgetedStepsRoundUpAndNeverReachZero)
+{
+	CHECK(GetBudgetedSteps(128, 1.0f) == 128);
+	CHECK(GetBudgetedSteps(128, 0.125f) == 16);
+	CHECK(GetBudgetedSteps(100, 0.333f) == 34);
+	CHECK(GetBudgetedSteps(128, 0.0f) == 1);
+	CHECK(GetBudgetedSteps(3, 0.1f) == 1);
+}
+
+TEST_CASE(ClassifiesEachKindOfTile)
+{
+	// Six 16x16 tiles: missed, faint, saturated, half opacity, a hard edge and a gentle ramp.
+	ReferenceImage image = MakeImage(96, 16, 0.5f);
+	FillTile(image, 0, 0, 16, [](uint32_t, uint32_t) { return -1.0f; });
+	FillTile(image, 1, 0, 16, [](uint32_t, uint32_t) { return 0.01f; });
+	FillTile(image, 2, 0, 16, [](uint32_t, uint32_t) { return 0.99f; });
+	FillTile(image, 4, 0, 16, [](uint32_t x, uint32_t) { return (x % 16 < 8) ? 0.0f : 1.0f; });
+	FillTile(image, 5, 0, 16, [](uint32_t x, uint32_t) { return 0.9f + 0.005f * (x % 16); });
+
+	ImportanceMap map;
+	map.Classify(image, NoMargin());
+	REQUIRE(map.GetTilesX() == 6);
+	REQUIRE(map.GetTilesY() == 1);
+	CHECK(map.GetClass(0, 0) == TileClass::Empty);
+	CHECK(map.GetClass(1, 0) == TileClass::Transparent);
+	CHECK(map.GetClass(2, 0) == TileClass::Opaque);
+	CHECK(map.GetClass(3, 0) == TileClass::Detailed);
+	CHECK(map.GetClass(4, 0) == TileClass::Detailed);
+	// Low variance but not every pixel is saturated.
+	CHECK(map.GetClass(5, 0) == TileClass::Detailed);
+
+	CHECK(map.GetBudget(5, 5) == 0.125f);
+	CHECK(map.GetBudget(40, 5) == 0.5f);
+	// Pixels past the image clamp to the edge tiles.
+	CHECK(map.GetBudget(500, 500) == 1.0f);
+}
+
+TEST_CASE(MarginPullsInNeighboringContent)
+{
+	// A missed tile next to a detailed one stays cheap without a margin but not with one, so content moving
+	// into it next frame is not undersampled.
+	ReferenceImage image = MakeImage(32, 16, 0.5f);
+	FillTile(image, 0, 0, 16, [](uint32_t, uint32_t) { return -1.0f; });
+
+	ImportanceMap map;
+	map.Classify(image, NoMargin());
+	CHECK(map.GetClass(0, 0) == TileClass::Empty);
+
+	ImportanceSettings settings;
+	settings.margin = 4;
+	map.Classify(image, settings);
+	CHECK(map.GetClass(0, 0) == TileClass::Detailed);
+}
+
+TEST_CASE(StatsWeighEdgeTilesByTheirPixels)
+{
+	// 40x20 with 16 pixel tiles: the right column and bottom row of tiles are partial.
+	ReferenceImage image = MakeImage(40, 20, 0.0f);
+	ImportanceMap map;
+	map.Classify(image, NoMargin());
+
+	ImportanceStats stats = map.GetStats(128);
+	CHECK(stats.tiles == 6);
+	CHECK(stats.tilesPerClass[static_cast<int>(TileClass::Transparent)] == 6);
+	CHECK(stats.stepsFull == 40ull * 20 * 128);
+	CHECK(stats.stepsBudgeted == 40ull * 20 * 32);
+}
+
+TEST_CASE(ImportanceRenderSavesSamplesOnTheFogSphere)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 48);
+	XMFLOAT3 eye(0.0f, 0.4f, -1.6f);
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 4.0f / 3.0f, 0.01f, 100.0f);
+	RaymarchCamera camera = MakeRaymarchCamera(XMMatrixRotationY(0.5f), view, projection, eye, XMFLOAT3(0.0f, 2.0f, -2.0f));
+
+	RaymarchSettings settings;
+	settings.steps = 128;
+	settings.shadows = false;
+	ReferenceImage full;
+	full.Resize(128, 96);
+	ReferenceRaymarcher::Render(volume, camera, settings, full);
+
+	// Classified from the previous frame, which for a still view is the same image.
+	ImportanceMap map;
+	map.Classify(full, ImportanceSettings());
+	ReferenceImage budgeted;
+	budgeted.Resize(128, 96);
+	uint64_t samples = RenderWithImportance(volume, camera, settings, map, budgeted);
+
+	ImportanceStats stats = map.GetStats(settings.steps);
+	ImageError error = CompareImages(full, budgeted, 0.05f);
+	std::printf("  step budgets over %u tiles:", stats.tiles);
+	for (int i = 0; i < static_cast<int>(TileClass::Count); ++i)
+	{
+		std::printf(" %s %u", ClassNames[i], stats.tilesPerClass[i]);
+	}
+	std::printf("\n  steps budgeted %.1f%% of full, samples %llu vs %llu (%.1f%% saved), rmse %.4f\n",
+		100.0 * stats.stepsBudgeted / stats.stepsFull,
+		static_cast<unsigned long long>(samples), static_cast<unsigned long long>(full.samples),
+		100.0 - 100.0 * samples / full.samples, error.rmse);
+
+	CHECK(stats.tilesPerClass[static_cast<int>(TileClass::Empty)] > 0);
+	CHECK(stats.tilesPerClass[static_cast<int>(TileClass::Detailed)] > 0);
+	CHECK(stats.stepsBudgeted < stats.stepsFull);
+	CHECK(samples < full.samples);
+	CHECK(error.rmse < 0.02f);
+}
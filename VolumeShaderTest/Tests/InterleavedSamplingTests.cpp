@@ -0,0 +1,138 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "InterleavedSampling.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t Width = 96;
+	const uint32_t Height = 72;
+
+	struct Frame
+	{
+		RaymarchCamera camera;
+		XMFLOAT4X4 worldViewProjection;
+	};
+
+	Frame MakeFrame(float yaw)
+	{
+		XMFLOAT3 eye(0.0f, 0.5f, -1.8f);
+		XMMATRIX world = XMMatrixRotationY(yaw);
+		XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, static_cast<float>(Width) / Height, 0.01f, 100.0f);
+
+		Frame frame;
+		frame.camera = MakeRaymarchCamera(world, view, projection, eye, XMFLOAT3(0.0f, 2.0f, -2.0f));
+		XMStoreFloat4x4(&frame.worldViewProjection, world * view * projection);
+		return frame;
+	}
+
+	RaymarchSettings TestSettings()
+	{
+		RaymarchSettings settings;
+		settings.steps = 64;
+		settings.shadows = false;
+		settings.jitter = false;
+		return settings;
+	}
+
+	struct PatternResult
+	{
+		uint64_t raysPerFrame;
+		float staticError;		// After one full cycle of the pattern with the view held still.
+		float orbitError;		// After the same frames while orbiting.
+	};
+
+	PatternResult RunPattern(const VolumeData& volume, uint32_t patternSize)
+	{
+		PatternResult result = {};
+		uint32_t frames = patternSize * patternSize;
+		ReferenceImage truth;
+		truth.Resize(Width, Height);
+
+		InterleavedReconstructor still;
+		Frame frame = MakeFrame(0.3f);
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			result.raysPerFrame = still.RenderFrame(volume, frame.camera, XMLoadFloat4x4(&frame.worldViewProjection), TestSettings(), patternSize, i, Width, Height).raysMarched;
+		}
+		ReferenceRaymarcher::Render(volume, frame.camera, TestSettings(), truth);
+		result.staticError = CompareImages(truth, still.GetImage(), 0.05f).rmse;
+
+		InterleavedReconstructor orbit;
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			frame = MakeFrame(0.3f + 0.01f * i);
+			orbit.RenderFrame(volume, frame.camera, XMLoadFloat4x4(&frame.worldViewProjection), TestSettings(), patternSize, i, Width, Height);
+		}
+		ReferenceRaymarcher::Render(volume, frame.camera, TestSettings(), truth);
+		result.orbitError = CompareImages(truth, orbit.GetImage(), 0.05f).rmse;
+
+		std::printf("  %ux%u: %llu of %u rays per frame, rmse still %.4f, orbiting %.4f\n", patternSize, patternSize,
+			static_cast<unsigned long long>(result.raysPerFrame), Width * Height, result.staticError, result.orbitError);
+		return result;
+	}
+}
+
+TEST_CASE(PatternVisitsEveryPixelOfTheBlockOncePerCycle)
+{
+	for (uint32_t patternSize = 2; patternSize <= 4; patternSize *= 2)
+	{
+		std::vector<int> visits(patternSize * patternSize, 0);
+		for (uint32_t frame = 0; frame < patternSize * patternSize; ++frame)
+		{
+			uint32_t x, y;
+			GetInterleaveOffset(patternSize, frame, x, y);
+			REQUIRE(x < patternSize && y < patternSize);
+			visits[y * patternSize + x]++;
+		}
+		for (int count : visits)
+		{
+			CHECK(count == 1);
+		}
+	}
+
+	// Consecutive frames of the 2x2 pattern land diagonally apart.
+	uint32_t x0, y0, x1, y1;
+	GetInterleaveOffset(2, 0, x0, y0);
+	GetInterleaveOffset(2, 1, x1, y1);
+	CHECK(x0 != x1 && y0 != y1);
+}
+
+TEST_CASE(TwoByTwoMarchesAQuarterOfThePixels)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 32);
+	PatternResult result = RunPattern(volume, 2);
+	CHECK(result.raysPerFrame == (Width / 2) * (Height / 2));
+	CHECK(result.staticError < 0.002f);
+	CHECK(result.orbitError < 0.005f);
+}
+
+TEST_CASE(FourByFourMarchesASixteenthOfThePixels)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 32);
+	PatternResult result = RunPattern(volume, 4);
+	CHECK(result.raysPerFrame == (Width / 4) * (Height / 4));
+	CHECK(result.staticError < 0.003f);
+	CHECK(result.orbitError < 0.015f);
+}
+
+TEST_CASE(FirstFrameFillsEveryPixel)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 32);
+	Frame frame = MakeFrame(0.3f);
+	InterleavedReconstructor reconstructor;
+	InterleaveStats stats = reconstructor.RenderFrame(volume, frame.camera, XMLoadFloat4x4(&frame.worldViewProjection), TestSettings(), 2, 0, Width, Height);
+
+	ReferenceImage truth;
+	truth.Resize(Width, Height);
+	ReferenceRaymarcher::Render(volume, frame.camera, TestSettings(), truth);
+	CHECK(stats.pixels == Width * Height);
+	CHECK(stats.reprojected == 0);
+	CHECK(CompareImages(truth, reconstructor.GetImage(), 0.05f).rmse < 0.02f);
+}
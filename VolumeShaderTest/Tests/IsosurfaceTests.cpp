@@ -0,0 +1,304 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "Isosurface.h"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <tuple>
+#include <utility>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	const uint32_t Size = 30;
+	const uint32_t BrickSize = 8;
+	const float Center[3] = { 14.3f, 13.8f, 14.6f };
+
+	// Density falling off linearly from 1 at the center to 0 at 24 voxels, so the surface at threshold t is a
+	// sphere of 24 * (1 - t) voxels. The center is off the grid so no voxel lands exactly on a threshold.
+	std::vector<float> MakeBall()
+	{
+		std::vector<float> density(static_cast<size_t>(Size) * Size * Size);
+		size_t i = 0;
+		for (uint32_t z = 0; z < Size; ++z)
+		{
+			for (uint32_t y = 0; y < Size; ++y)
+			{
+				for (uint32_t x = 0; x < Size; ++x)
+				{
+					float dx = x - Center[0], dy = y - Center[1], dz = z - Center[2];
+					density[i++] = std::max(0.0f, 1.0f - std::sqrt(dx * dx + dy * dy + dz * dz) / 24.0f);
+				}
+			}
+		}
+		return density;
+	}
+
+	IsosurfaceSettings Settings(uint32_t threadCount = 1)
+	{
+		IsosurfaceSettings settings;
+		settings.brickSize = BrickSize;
+		settings.threadCount = threadCount;
+		return settings;
+	}
+
+	IsosurfaceMesh FreshMesh(const std::vector<float>& density, float threshold)
+	{
+		IsosurfaceExtractor extractor(Settings());
+		extractor.SetVolume(density.data(), 1, Size, Size, Size);
+		extractor.Extract(threshold);
+		IsosurfaceMesh mesh;
+		extractor.BuildMesh(mesh);
+		return mesh;
+	}
+
+	std::tuple<float, float, float> Position(const VertexPositionColor& vertex)
+	{
+		return std::make_tuple(vertex.pos.x, vertex.pos.y, vertex.pos.z);
+	}
+
+	bool SameMesh(const IsosurfaceMesh& a, const IsosurfaceMesh& b)
+	{
+		if (a.vertices.size() != b.vertices.size() || a.indices != b.indices)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.vertices.size(); ++i)
+		{
+			const VertexPositionColor& va = a.vertices[i];
+			const VertexPositionColor& vb = b.vertices[i];
+			if (Position(va) != Position(vb) ||
+				va.texCoord.x != vb.texCoord.x || va.texCoord.y != vb.texCoord.y || va.texCoord.z != vb.texCoord.z)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Bricks whose corner range straddles threshold, found without the extractor's own bookkeeping.
+	uint32_t CountStraddlingBricks(const std::vector<float>& density, float thresholdA, float thresholdB)
+	{
+		const uint32_t cells = Size - 1;
+		const uint32_t bricks = (cells + BrickSize - 1) / BrickSize;
+		uint32_t count = 0;
+		for (uint32_t bz = 0; bz < bricks; ++bz)
+		{
+			for (uint32_t by = 0; by < bricks; ++by)
+			{
+				for (uint32_t bx = 0; bx < bricks; ++bx)
+				{
+					float low = 1.0f, high = 0.0f;
+					for (uint32_t z = bz * BrickSize; z <= std::min((bz + 1) * BrickSize, cells); ++z)
+					{
+						for (uint32_t y = by * BrickSize; y <= std::min((by + 1) * BrickSize, cells); ++y)
+						{
+							for (uint32_t x = bx * BrickSize; x <= std::min((bx + 1) * BrickSize, cells); ++x)
+							{
+								float value = density[(static_cast<size_t>(z) * Size + y) * Size + x];
+								low = std::min(low, value);
+								high = std::max(high, value);
+							}
+						}
+					}
+					bool a = low < thresholdA && high >= thresholdA;
+					bool b = low < thresholdB && high >= thresholdB;
+					count += (a || b) ? 1 : 0;
+				}
+			}
+		}
+		return count;
+	}
+}
+
+TEST_CASE(VerticesAreWelded)
+{
+	// Small bricks put many seams through the surface; every vertex must still appear once and be used.
+	std::vector<float> density = MakeBall();
+	IsosurfaceSettings settings = Settings(3);
+	settings.brickSize = 5;
+	IsosurfaceExtractor extractor(settings);
+	extractor.SetVolume(density.data(), 1, Size, Size, Size);
+	extractor.Extract(0.5f);
+	IsosurfaceMesh mesh;
+	extractor.BuildMesh(mesh);
+	REQUIRE(!mesh.vertices.empty());
+
+	std::vector<std::tuple<float, float, float>> positions;
+	for (const VertexPositionColor& vertex : mesh.vertices)
+	{
+		positions.push_back(Position(vertex));
+	}
+	std::sort(positions.begin(), positions.end());
+	CHECK(std::adjacent_find(positions.begin(), positions.end()) == positions.end());
+
+	std::vector<uint8_t> used(mesh.vertices.size(), 0);
+	for (uint32_t index : mesh.indices)
+	{
+		REQUIRE(index < mesh.vertices.size());
+		used[index] = 1;
+	}
+	CHECK(std::count(used.begin(), used.end(), 0) == 0);
+	CHECK(extractor.GetStats().vertices == mesh.vertices.size());
+	CHECK(extractor.GetStats().triangles * 3 == mesh.indices.size());
+}
+
+TEST_CASE(SphereIsClosedAndFacesOutward)
+{
+	std::vector<float> density = MakeBall();
+	IsosurfaceMesh mesh = FreshMesh(density, 0.5f);
+	REQUIRE(mesh.indices.size() % 3 == 0);
+	REQUIRE(!mesh.indices.empty());
+
+	// Watertight and consistently wound: every directed edge appears once and its reverse once.
+	std::map<std::pair<uint32_t, uint32_t>, int> edges;
+	for (size_t t = 0; t < mesh.indices.size(); t += 3)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			edges[std::make_pair(mesh.indices[t + i], mesh.indices[t + (i + 1) % 3])]++;
+		}
+	}
+	size_t unmatched = 0;
+	for (const auto& edge : edges)
+	{
+		auto reverse = edges.find(std::make_pair(edge.first.second, edge.first.first));
+		unmatched += (edge.second != 1 || reverse == edges.end() || reverse->second != 1) ? 1 : 0;
+	}
+	CHECK(unmatched == 0);
+
+	// A closed surface of genus zero.
+	int64_t euler = static_cast<int64_t>(mesh.vertices.size()) - static_cast<int64_t>(edges.size() / 2) + static_cast<int64_t>(mesh.indices.size() / 3);
+	CHECK(euler == 2);
+
+	// Local space spans the volume, so the sphere's radius is 12 voxels of 30. The divergence theorem over the
+	// triangles gives its volume, positive when the triangles face outward.
+	const float center[3] = { (Center[0] + 0.5f) / Size - 0.5f, (Center[1] + 0.5f) / Size - 0.5f, (Center[2] + 0.5f) / Size - 0.5f };
+	double volume = 0.0;
+	size_t inward = 0;
+	for (size_t t = 0; t < mesh.indices.size(); t += 3)
+	{
+		DirectX::XMFLOAT3 p[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			const DirectX::XMFLOAT3& pos = mesh.vertices[mesh.indices[t + i]].pos;
+			p[i] = DirectX::XMFLOAT3(pos.x - center[0], pos.y - center[1], pos.z - center[2]);
+		}
+
+		// Clockwise from the front in a left-handed frame, so the front face's normal is (p1 - p0) x (p2 - p0).
+		float e1[3] = { p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z };
+		float e2[3] = { p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z };
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		float outward = n[0] * (p[0].x + p[1].x + p[2].x) + n[1] * (p[0].y + p[1].y + p[2].y) + n[2] * (p[0].z + p[1].z + p[2].z);
+		inward += (outward <= 0.0f) ? 1 : 0;
+		volume += (p[0].x * (p[1].y * p[2].z - p[1].z * p[2].y) -
+			p[0].y * (p[1].x * p[2].z - p[1].z * p[2].x) +
+			p[0].z * (p[1].x * p[2].y - p[1].y * p[2].x)) / 6.0;
+	}
+	CHECK(inward == 0);
+	const double radius = 12.0 / Size;
+	CHECK_NEAR(volume, 4.0 / 3.0 * 3.14159265358979 * radius * radius * radius, 0.03 * volume);
+
+	// Vertex normals point away from the center too.
+	size_t badNormals = 0;
+	for (const VertexPositionColor& vertex : mesh.vertices)
+	{
+		float dot = vertex.texCoord.x * (vertex.pos.x - center[0]) + vertex.texCoord.y * (vertex.pos.y - center[1]) + vertex.texCoord.z * (vertex.pos.z - center[2]);
+		badNormals += (dot <= 0.0f) ? 1 : 0;
+	}
+	CHECK(badNormals == 0);
+}
+
+TEST_CASE(IncrementalExtractionMatchesAFreshExtractor)
+{
+	std::vector<float> density = MakeBall();
+	IsosurfaceExtractor extractor(Settings(2));
+	extractor.SetVolume(density.data(), 1, Size, Size, Size);
+
+	const float thresholds[] = { 0.5f, 0.6f, 0.6f, 0.35f, 0.5f };
+	for (float threshold : thresholds)
+	{
+		extractor.Extract(threshold);
+		IsosurfaceMesh mesh;
+		extractor.BuildMesh(mesh);
+		CHECK(SameMesh(mesh, FreshMesh(density, threshold)));
+	}
+
+	// Edits of every size, including ones ending on and straddling brick boundaries and the volume's edges.
+	std::mt19937 random(23);
+	std::uniform_int_distribution<uint32_t> coordinate(0, Size - 1), extent(1, 10);
+	std::uniform_real_distribution<float> value(0.0f, 1.0f);
+	const uint32_t boxes[][6] = { { 7, 7, 7, 9, 9, 9 }, { 8, 0, 0, 9, Size, Size }, { 0, 16, 3, Size, 17, 25 }, { 20, 20, 20, Size, Size, Size } };
+	for (int edit = 0; edit < 24; ++edit)
+	{
+		uint32_t voxelMin[3], voxelMax[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			voxelMin[axis] = (edit < 4) ? boxes[edit][axis] : coordinate(random);
+			voxelMax[axis] = (edit < 4) ? boxes[edit][axis + 3] : std::min(Size, voxelMin[axis] + extent(random));
+		}
+		for (uint32_t z = voxelMin[2]; z < voxelMax[2]; ++z)
+		{
+			for (uint32_t y = voxelMin[1]; y < voxelMax[1]; ++y)
+			{
+				for (uint32_t x = voxelMin[0]; x < voxelMax[0]; ++x)
+				{
+					density[(static_cast<size_t>(z) * Size + y) * Size + x] = value(random);
+				}
+			}
+		}
+
+		extractor.UpdateRegion(density.data(), 1, voxelMin, voxelMax);
+		extractor.Extract(0.5f);
+		IsosurfaceMesh mesh;
+		extractor.BuildMesh(mesh);
+		CHECK(SameMesh(mesh, FreshMesh(density, 0.5f)));
+	}
+}
+
+TEST_CASE(OnlyBricksTheSurfaceCrossesAreRebuilt)
+{
+	std::vector<float> density = MakeBall();
+	IsosurfaceExtractor extractor(Settings());
+	extractor.SetVolume(density.data(), 1, Size, Size, Size);
+	REQUIRE(extractor.GetBrickCount() == 64);
+
+	extractor.Extract(0.5f);
+	CHECK(extractor.GetStats().bricksRebuilt == 64);
+	const uint32_t withSurface = extractor.GetStats().bricksWithSurface;
+	CHECK(withSurface == CountStraddlingBricks(density, 0.5f, 0.5f));
+
+	extractor.Extract(0.5f);
+	CHECK(extractor.GetStats().bricksRebuilt == 0);
+	CHECK(extractor.GetStats().bricksWithSurface == withSurface);
+
+	// A threshold change revisits the bricks either surface passes through, and nothing else.
+	extractor.Extract(0.7f);
+	uint32_t expected = CountStraddlingBricks(density, 0.5f, 0.7f);
+	CHECK(extractor.GetStats().bricksRebuilt == expected);
+	CHECK(expected < 64);
+
+	// Nudging one voxel in the middle of a brick rebuilds that brick alone; on a brick's lower corner it also
+	// rebuilds the bricks below, which borrow its cells' vertices.
+	const uint32_t inner[3] = { 11, 12, 13 };
+	const uint32_t innerEnd[3] = { 12, 13, 14 };
+	density[(static_cast<size_t>(13) * Size + 12) * Size + 11] += 0.01f;
+	extractor.UpdateRegion(density.data(), 1, inner, innerEnd);
+	extractor.Extract(0.7f);
+	CHECK(extractor.GetStats().bricksRebuilt == 1);
+
+	const uint32_t corner[3] = { 8, 8, 8 };
+	const uint32_t cornerEnd[3] = { 9, 9, 9 };
+	density[(static_cast<size_t>(8) * Size + 8) * Size + 8] += 0.01f;
+	extractor.UpdateRegion(density.data(), 1, corner, cornerEnd);
+	extractor.Extract(0.7f);
+	CHECK(extractor.GetStats().bricksRebuilt == 8);
+
+	// Edits outside the volume are ignored.
+	const uint32_t outside[3] = { Size, 0, 0 };
+	const uint32_t outsideEnd[3] = { Size + 4, 4, 4 };
+	extractor.UpdateRegion(density.data(), 1, outside, outsideEnd);
+	extractor.Extract(0.7f);
+	CHECK(extractor.GetStats().bricksRebuilt == 0);
+}
@@ -0,0 +1,264 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "OutOfCoreVolume.h"
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	// Counts the bytes of every chunk still alive, wherever it is held.
+	std::atomic<int64_t> g_liveBytes(0);
+	std::atomic<int64_t> g_peakLiveBytes(0);
+
+	std::shared_ptr<const ChunkData> MakeChunk(size_t voxels)
+	{
+		int64_t bytes = static_cast<int64_t>(voxels * sizeof(uint16_t));
+		int64_t live = g_liveBytes += bytes;
+		int64_t peak = g_peakLiveBytes.load();
+		while (live > peak && !g_peakLiveBytes.compare_exchange_weak(peak, live))
+		{
+		}
+		return std::shared_ptr<const ChunkData>(new ChunkData(voxels), [bytes](const ChunkData* chunk)
+		{
+			g_liveBytes -= bytes;
+			delete chunk;
+		});
+	}
+
+	ChunkStoreHeader MakeHeader(uint32_t width, uint32_t height, uint32_t depth, uint32_t chunkSize)
+	{
+		ChunkStoreHeader header = {};
+		header.magic = ChunkStoreMagic;
+		header.version = ChunkStoreVersion;
+		header.width = width;
+		header.height = height;
+		header.depth = depth;
+		header.chunkSize = chunkSize;
+		header.chunksX = (width + chunkSize - 1) / chunkSize;
+		header.chunksY = (height + chunkSize - 1) / chunkSize;
+		header.chunksZ = (depth + chunkSize - 1) / chunkSize;
+		return header;
+	}
+
+	uint64_t SlotBytes(uint32_t chunkSize)
+	{
+		uint64_t padded = chunkSize + 2;
+		return padded * padded * padded * sizeof(uint16_t);
+	}
+}
+
+TEST_CASE(CacheEvictsLeastRecentlyUsed)
+{
+	const size_t voxels = 256;
+	ChunkCache cache(4 * voxels * sizeof(uint16_t));
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		CHECK(cache.Insert(i, MakeChunk(voxels)));
+	}
+	CHECK(cache.Find(0) != nullptr);
+	CHECK(cache.Insert(4, MakeChunk(voxels)));
+	CHECK(cache.Contains(0));
+	CHECK(!cache.Contains(1));
+	CHECK(!cache.Insert(4, MakeChunk(voxels)));
+
+	ChunkCacheStats stats = cache.GetStats();
+	CHECK(stats.evictions == 1);
+	CHECK(stats.bytes == 4 * voxels * sizeof(uint16_t));
+}
+
+TEST_CASE(CacheRefusesWhenEverythingIsHeld)
+{
+	const size_t voxels = 256;
+	ChunkCache cache(4 * voxels * sizeof(uint16_t));
+	std::vector<std::shared_ptr<const ChunkData>> held;
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		cache.Insert(i, MakeChunk(voxels));
+		held.push_back(cache.Find(i));
+	}
+
+	CHECK(!cache.Insert(10, MakeChunk(voxels)));
+	CHECK(!cache.Insert(11, MakeChunk(5 * voxels)));
+	CHECK(cache.GetStats().refused == 2);
+	CHECK(!cache.Contains(10));
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		CHECK(cache.Contains(i));
+	}
+
+	// Releasing one chunk frees exactly its room, even though it is not the least recently used.
+	held[2].reset();
+	CHECK(cache.Insert(10, MakeChunk(voxels)));
+	CHECK(!cache.Contains(2));
+	CHECK(cache.Contains(0));
+	CHECK(cache.GetStats().bytes == 4 * voxels * sizeof(uint16_t));
+}
+
+TEST_CASE(CacheBudgetHoldsUnderConcurrentReaders)
+{
+	// Fetch threads insert while render threads hold chunks for a while. Every chunk the cache accepted stays
+	// alive until it is evicted and nobody holds it, so live chunk memory is the budget plus, at most, the one
+	// chunk each inserting thread has read but not handed over yet.
+	const size_t voxels = 1024;
+	const uint64_t chunkBytes = voxels * sizeof(uint16_t);
+	const uint64_t budget = 16 * chunkBytes;
+	const uint32_t inserters = 3;
+	const uint32_t readers = 3;
+	const uint32_t chunkCount = 64;
+
+	g_liveBytes = 0;
+	g_peakLiveBytes = 0;
+	{
+		ChunkCache cache(budget);
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < inserters; ++t)
+		{
+			threads.emplace_back([&cache, t]()
+			{
+				std::mt19937 random(t);
+				for (int i = 0; i < 20000; ++i)
+				{
+					cache.Insert(random() % chunkCount, MakeChunk(voxels));
+				}
+			});
+		}
+		for (uint32_t t = 0; t < readers; ++t)
+		{
+			threads.emplace_back([&cache, t]()
+			{
+				std::mt19937 random(100 + t);
+				std::vector<std::shared_ptr<const ChunkData>> held(4);
+				for (int i = 0; i < 20000; ++i)
+				{
+					held[random() % held.size()] = cache.Find(random() % chunkCount);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		ChunkCacheStats stats = cache.GetStats();
+		CHECK(stats.peakBytes <= budget);
+		CHECK(stats.bytes <= budget);
+		CHECK(stats.insertions - stats.evictions == stats.bytes / chunkBytes);
+		CHECK(stats.hits > 0);
+		CHECK(g_liveBytes.load() == static_cast<int64_t>(stats.bytes));
+	}
+	CHECK(g_peakLiveBytes.load() <= static_cast<int64_t>(budget + inserters * chunkBytes));
+	CHECK(g_liveBytes.load() == 0);
+}
+
+TEST_CASE(PoolLayoutFitsTheBudget)
+{
+	ChunkStoreHeader header = MakeHeader(1024, 1024, 1024, 64);
+	const uint64_t budgets[] = { 1ull << 20, 64ull << 20, 256ull << 20, 1ull << 30 };
+	for (uint64_t budget : budgets)
+	{
+		BrickPoolLayout layout = ChooseBrickPoolLayout(header, budget, 2048);
+		uint32_t slots = layout.slots[0] * layout.slots[1] * layout.slots[2];
+		CHECK(slots >= 1);
+		CHECK(header.chunkSize % layout.coarseFactor == 0);
+		CHECK(layout.poolBytes == slots * SlotBytes(64));
+		CHECK(layout.coarseSize[0] * layout.coarseFactor >= header.width);
+		CHECK(layout.coarseSize[0] < (header.width + layout.coarseFactor) / layout.coarseFactor + 1);
+		if (slots > 1)
+		{
+			CHECK(layout.poolBytes + layout.coarseBytes <= budget);
+		}
+	}
+
+	// 256 MB: the 256^3 coarse level (factor 4, 32 MB) just fits an eighth of it and the pool takes most of the rest.
+	BrickPoolLayout layout = ChooseBrickPoolLayout(header, 256ull << 20, 2048);
+	CHECK(layout.coarseFactor == 4);
+	CHECK(layout.coarseBytes == 256ull * 256 * 256 * 2);
+	uint64_t slotsPaidFor = ((256ull << 20) - layout.coarseBytes) / SlotBytes(64);
+	uint32_t slots = layout.slots[0] * layout.slots[1] * layout.slots[2];
+	CHECK(slots <= slotsPaidFor);
+	CHECK(slots * 10 >= slotsPaidFor * 7);
+
+	// Less budget coarsens the fallback level instead of dropping it.
+	CHECK(ChooseBrickPoolLayout(header, 4ull << 20, 2048).coarseFactor > layout.coarseFactor);
+}
+
+TEST_CASE(PoolLayoutCaps)
+{
+	// Never more slots than chunks.
+	ChunkStoreHeader small = MakeHeader(100, 60, 20, 32);
+	BrickPoolLayout layout = ChooseBrickPoolLayout(small, 1ull << 30, 2048);
+	CHECK(layout.slots[0] * layout.slots[1] * layout.slots[2] <= 4 * 2 * 1);
+	CHECK(layout.coarseFactor == 1);
+
+	// The page table addresses at most 65535 slots.
+	ChunkStoreHeader huge = MakeHeader(8192, 8192, 8192, 8);
+	layout = ChooseBrickPoolLayout(huge, 64ull << 30, 16384);
+	CHECK(layout.slots[0] * layout.slots[1] * layout.slots[2] <= UINT16_MAX);
+
+	// A small texture size limit caps each pool axis and forces a coarser fallback level.
+	layout = ChooseBrickPoolLayout(MakeHeader(1024, 1024, 1024, 64), 1ull << 30, 256);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		CHECK(layout.slots[axis] * 66 <= 256);
+		CHECK(layout.coarseSize[axis] <= 256);
+	}
+
+	// A budget below one slot still keeps one slot and one coarse texel per chunk.
+	layout = ChooseBrickPoolLayout(MakeHeader(512, 512, 512, 64), 1024, 2048);
+	CHECK(layout.slots[0] * layout.slots[1] * layout.slots[2] == 1);
+	CHECK(layout.coarseFactor == 64);
+	CHECK(layout.coarseSize[0] == 8);
+
+	// Chunk sizes that are not powers of two fall back from the largest power of two straight to the chunk size.
+	layout = ChooseBrickPoolLayout(MakeHeader(480, 480, 480, 48), 1024, 2048);
+	CHECK(layout.coarseFactor == 48);
+}
+
+TEST_CASE(DownsampleAveragesOnlyTheChunkVoxels)
+{
+	// 20 voxels wide with chunks of 8: the last chunk along x has 4 voxels, half a coarse texel at factor 8.
+	const uint32_t chunkSize = 8;
+	const uint32_t padded = chunkSize + 2;
+	ChunkStoreHeader header = MakeHeader(20, 8, 8, chunkSize);
+
+	// Apron voxels are 60000 and must not leak into the average; inside voxels are their x coordinate.
+	std::vector<uint16_t> chunk(padded * padded * padded, 60000);
+	for (uint32_t z = 0; z < chunkSize; ++z)
+	{
+		for (uint32_t y = 0; y < chunkSize; ++y)
+		{
+			for (uint32_t x = 0; x < chunkSize; ++x)
+			{
+				chunk[((z + 1) * padded + (y + 1)) * padded + (x + 1)] = static_cast<uint16_t>(16 + x);
+			}
+		}
+	}
+
+	uint32_t box[6];
+	std::vector<uint16_t> coarse;
+	DownsampleChunk(header, header.chunksX - 1, chunk.data(), 4, box, coarse);
+	CHECK(box[0] == 4 && box[3] == 5);
+	CHECK(box[1] == 0 && box[4] == 2);
+	CHECK(box[2] == 0 && box[5] == 2);
+	REQUIRE(coarse.size() == 4);
+	for (uint16_t value : coarse)
+	{
+		// Voxels 16..19 average to 17.5, which rounds up.
+		CHECK(value == 18);
+	}
+
+	DownsampleChunk(header, header.chunksX - 1, chunk.data(), 8, box, coarse);
+	CHECK(box[0] == 2 && box[3] == 3);
+	REQUIRE(coarse.size() == 1);
+	CHECK(coarse[0] == 18);
+
+	DownsampleChunk(header, 0, chunk.data(), 2, box, coarse);
+	CHECK(box[0] == 0 && box[3] == 4);
+	REQUIRE(coarse.size() == 64);
+	CHECK(coarse[0] == 17);
+	CHECK(coarse[3] == 23);
+}
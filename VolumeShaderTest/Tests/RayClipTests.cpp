@@ -0,0 +1,210 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "RayClip.h"
+#include "ReferenceRaymarcher.h"
+#include <cfloat>
+#include <random>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	const XMFLOAT4 IdentityRotation(0.0f, 0.0f, 0.0f, 1.0f);
+
+	ClipRegion RandomRegion(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		ClipRegion region;
+		region.planeCount = random() % (MaxClipPlanes + 1);
+		for (uint32_t i = 0; i < region.planeCount; ++i)
+		{
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random), 0.0f)));
+			region.planes[i] = XMFLOAT4(normal.x, normal.y, normal.z, 0.3f * unit(random));
+		}
+		region.cropEnabled = (random() % 2) == 0;
+		if (region.cropEnabled)
+		{
+			XMFLOAT4 orientation;
+			XMStoreFloat4(&orientation, XMQuaternionRotationAxis(XMVectorSet(unit(random), unit(random), unit(random) + 0.01f, 0.0f), XM_PI * unit(random)));
+			XMFLOAT3 center(0.2f * unit(random), 0.2f * unit(random), 0.2f * unit(random));
+			XMFLOAT3 halfExtents(0.05f + 0.3f * fabsf(unit(random)), 0.05f + 0.3f * fabsf(unit(random)), 0.05f + 0.3f * fabsf(unit(random)));
+			region.cropMatrix = MakeCropMatrix(center, halfExtents, orientation);
+		}
+		return region;
+	}
+
+	RaymarchCamera TestCamera()
+	{
+		XMMATRIX world = XMMatrixRotationY(0.3f);
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.7f, -3.0f, 0.0f), XMVectorSet(0.0f, -0.1f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, 1.0f, 0.01f, 100.0f);
+		return MakeRaymarchCamera(world, view, projection, XMFLOAT3(0.0f, 0.7f, -3.0f), XMFLOAT3(2.0f, 1.5f, 0.0f));
+	}
+}
+
+TEST_CASE(InactiveRegionKeepsTheInterval)
+{
+	ClipRegion region;
+	CHECK(!region.IsActive());
+	float tEntry = 0.5f, tExit = 2.5f;
+	CHECK(ClipRay(region, XMFLOAT3(0.0f, 0.0f, -2.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), tEntry, tExit));
+	CHECK(tEntry == 0.5f && tExit == 2.5f);
+	CHECK(InsideClipRegion(region, 10.0f, -10.0f, 3.0f));
+}
+
+TEST_CASE(PlaneCutsTheRayWhereItCrosses)
+{
+	// Keeps x >= 0.25.
+	ClipRegion region;
+	region.planeCount = 1;
+	region.planes[0] = XMFLOAT4(1.0f, 0.0f, 0.0f, -0.25f);
+
+	float tEntry = 0.0f, tExit = 4.0f;
+	CHECK(ClipRay(region, XMFLOAT3(-2.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), tEntry, tExit));
+	CHECK_NEAR(tEntry, 2.25f, 1e-6);
+	CHECK_NEAR(tExit, 4.0f, 1e-6);
+
+	// The same plane seen from the other side ends the ray instead.
+	tEntry = 0.0f;
+	tExit = 4.0f;
+	CHECK(ClipRay(region, XMFLOAT3(2.0f, 0.0f, 0.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), tEntry, tExit));
+	CHECK_NEAR(tEntry, 0.0f, 1e-6);
+	CHECK_NEAR(tExit, 1.75f, 1e-6);
+
+	// Parallel rays are kept or dropped whole.
+	tEntry = 0.0f;
+	tExit = 4.0f;
+	CHECK(ClipRay(region, XMFLOAT3(0.5f, 0.0f, -2.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), tEntry, tExit));
+	CHECK(tEntry == 0.0f && tExit == 4.0f);
+	CHECK(!ClipRay(region, XMFLOAT3(0.0f, 0.0f, -2.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), tEntry, tExit));
+}
+
+TEST_CASE(PlanesThatExcludeEachOtherLeaveNothing)
+{
+	ClipRegion region;
+	region.planeCount = 2;
+	region.planes[0] = XMFLOAT4(0.0f, 1.0f, 0.0f, -0.1f);	// y >= 0.1
+	region.planes[1] = XMFLOAT4(0.0f, -1.0f, 0.0f, -0.1f);	// y <= -0.1
+	float tEntry = 0.0f, tExit = 4.0f;
+	CHECK(!ClipRay(region, XMFLOAT3(0.0f, -2.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), tEntry, tExit));
+	CHECK(!InsideClipRegion(region, 0.0f, 0.0f, 0.0f));
+}
+
+TEST_CASE(CropBoxFollowsItsCenterAndOrientation)
+{
+	ClipRegion region;
+	region.cropEnabled = true;
+	region.cropMatrix = MakeCropMatrix(XMFLOAT3(0.1f, 0.0f, 0.0f), XMFLOAT3(0.2f, 0.05f, 0.05f), IdentityRotation);
+
+	float tEntry = 0.0f, tExit = 4.0f;
+	CHECK(ClipRay(region, XMFLOAT3(-2.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), tEntry, tExit));
+	CHECK_NEAR(tEntry, 1.9f, 1e-5);
+	CHECK_NEAR(tExit, 2.3f, 1e-5);
+
+	// A quarter turn about z lays the long side along y.
+	XMFLOAT4 quarterTurn;
+	XMStoreFloat4(&quarterTurn, XMQuaternionRotationAxis(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XM_PIDIV2));
+	region.cropMatrix = MakeCropMatrix(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.2f, 0.05f, 0.05f), quarterTurn);
+	tEntry = 0.0f;
+	tExit = 4.0f;
+	CHECK(ClipRay(region, XMFLOAT3(-2.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), tEntry, tExit));
+	CHECK_NEAR(tEntry, 1.95f, 1e-5);
+	CHECK_NEAR(tExit, 2.05f, 1e-5);
+	CHECK(InsideClipRegion(region, 0.0f, 0.19f, 0.0f));
+	CHECK(!InsideClipRegion(region, 0.19f, 0.0f, 0.0f));
+
+	// A flat box still keeps a sliver rather than dividing by zero.
+	region.cropMatrix = MakeCropMatrix(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.2f, 0.2f, 0.0f), IdentityRotation);
+	tEntry = 0.0f;
+	tExit = 4.0f;
+	CHECK(ClipRay(region, XMFLOAT3(0.0f, 0.0f, -2.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), tEntry, tExit));
+	CHECK(tExit - tEntry < 1e-5f);
+}
+
+TEST_CASE(IntervalAgreesWithPointClassification)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	uint32_t mismatches = 0;
+	uint32_t checked = 0;
+	for (int ray = 0; ray < 2000; ++ray)
+	{
+		ClipRegion region = RandomRegion(random);
+		XMFLOAT3 origin(2.0f * unit(random), 2.0f * unit(random), 2.0f * unit(random));
+		XMFLOAT3 direction(0.0f, 0.0f, 1.0f);
+		if (ray % 50 != 0)
+		{
+			XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random), 0.0f)));
+		}
+
+		float tEntry = 0.0f, tExit = 6.0f;
+		bool hit = ClipRay(region, origin, direction, tEntry, tExit);
+		for (int i = 0; i <= 200; ++i)
+		{
+			float t = 6.0f * i / 200.0f;
+
+			// Points within rounding of the interval's ends may land on either side.
+			if (hit && (fabsf(t - tEntry) < 1e-4f || fabsf(t - tExit) < 1e-4f))
+			{
+				continue;
+			}
+			bool inside = InsideClipRegion(region, origin.x + direction.x * t, origin.y + direction.y * t, origin.z + direction.z * t);
+			mismatches += (inside != (hit && t >= tEntry && t <= tExit)) ? 1 : 0;
+			++checked;
+		}
+	}
+	CHECK(checked > 300000);
+	CHECK(mismatches == 0);
+}
+
+TEST_CASE(StoresTheShaderConstants)
+{
+	ClipRegion region;
+	region.planeCount = 2;
+	region.planes[1] = XMFLOAT4(0.0f, 1.0f, 0.0f, 0.2f);
+	region.cropEnabled = true;
+	region.cropMatrix = MakeCropMatrix(XMFLOAT3(0.1f, 0.2f, 0.3f), XMFLOAT3(0.25f, 0.25f, 0.25f), IdentityRotation);
+
+	ModelViewProjectionConstantBuffer constants = {};
+	StoreClipRegion(region, constants);
+	CHECK(constants.clipParams.x == 2.0f && constants.clipParams.y == 1.0f);
+	CHECK(constants.clipPlanes[1].y == 1.0f && constants.clipPlanes[1].w == 0.2f);
+
+	// HLSL reads the matrix column major, so the translation sits in the last column.
+	CHECK_NEAR(constants.cropBoxMatrix.m[0][3], -0.4f, 1e-6);
+	CHECK_NEAR(constants.cropBoxMatrix.m[1][3], -0.8f, 1e-6);
+	CHECK_NEAR(constants.cropBoxMatrix.m[2][3], -1.2f, 1e-6);
+}
+
+TEST_CASE(ClippedRenderSkipsTheCutAway)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 32);
+	RaymarchCamera camera = TestCamera();
+	RaymarchSettings settings;
+	settings.steps = 64;
+	ReferenceImage full, kept, halved;
+	full.Resize(48, 48);
+	kept.Resize(48, 48);
+	halved.Resize(48, 48);
+	ReferenceRaymarcher::Render(volume, camera, settings, full);
+
+	// A plane beyond the box keeps every step where it was.
+	camera.clip.planeCount = 1;
+	camera.clip.planes[0] = XMFLOAT4(1.0f, 0.0f, 0.0f, 10.0f);
+	ReferenceRaymarcher::Render(volume, camera, settings, kept);
+	CHECK(std::memcmp(full.color.data(), kept.color.data(), full.color.size() * sizeof(XMFLOAT4)) == 0);
+	CHECK(full.samples == kept.samples);
+
+	camera.clip.planes[0] = XMFLOAT4(1.0f, 0.0f, 0.0f, 0.0f);
+	ReferenceRaymarcher::Render(volume, camera, settings, halved);
+	CHECK(halved.samples < full.samples);
+	uint32_t gainedOpacity = 0;
+	for (size_t i = 0; i < full.color.size(); ++i)
+	{
+		gainedOpacity += (halved.color[i].w > full.color[i].w + 1e-6f) ? 1 : 0;
+	}
+	CHECK(gainedOpacity == 0);
+}
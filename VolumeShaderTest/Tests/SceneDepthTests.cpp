@@ -0,0 +1,207 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "ReferenceRaymarcher.h"
+#include <cfloat>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	struct TestScene
+	{
+		XMMATRIX worldViewProjection;
+		RaymarchCamera camera;
+	};
+
+	TestScene MakeScene()
+	{
+		XMMATRIX world = XMMatrixRotationY(0.3f);
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.7f, -3.0f, 0.0f), XMVectorSet(0.0f, -0.1f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(70.0f * XM_PI / 180.0f, 1.0f, 0.01f, 100.0f);
+		TestScene scene;
+		scene.worldViewProjection = world * view * projection;
+		scene.camera = MakeRaymarchCamera(world, view, projection, XMFLOAT3(0.0f, 0.7f, -3.0f), XMFLOAT3(2.0f, 1.5f, 0.0f));
+		return scene;
+	}
+
+	// Rasterizes the local plane z = planeZ into a depth image; hit holds the analytic distance along each pixel's
+	// ray, FLT_MAX where the plane is behind the camera.
+	void RenderPlaneDepth(const TestScene& scene, float planeZ, uint32_t size, SceneDepthImage& depth, std::vector<float>& hit)
+	{
+		depth.width = size;
+		depth.height = size;
+		depth.depth.assign(static_cast<size_t>(size) * size, 1.0f);
+		hit.assign(depth.depth.size(), FLT_MAX);
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				XMFLOAT3 origin, direction;
+				float tEntry, tExit;
+				ReferenceRaymarcher::ComputeRay(scene.camera, x + 0.5f, y + 0.5f, size, size, origin, direction, tEntry, tExit);
+				float t = (fabsf(direction.z) > 1e-6f) ? (planeZ - origin.z) / direction.z : -1.0f;
+				if (t <= 0.0f)
+				{
+					continue;
+				}
+				XMVECTOR point = XMVectorSet(origin.x + direction.x * t, origin.y + direction.y * t, planeZ, 1.0f);
+				XMVECTOR clip = XMVector4Transform(point, scene.worldViewProjection);
+				depth.depth[static_cast<size_t>(y) * size + x] = XMVectorGetZ(clip) / XMVectorGetW(clip);
+				hit[static_cast<size_t>(y) * size + x] = t;
+			}
+		}
+	}
+}
+
+TEST_CASE(DistanceReconstructsThePlane)
+{
+	TestScene scene = MakeScene();
+	SceneDepthImage depth;
+	std::vector<float> hit;
+	RenderPlaneDepth(scene, 0.0f, 128, depth, hit);
+
+	float maxError = 0.0f;
+	uint32_t covered = 0;
+	for (uint32_t y = 0; y < 128; ++y)
+	{
+		for (uint32_t x = 0; x < 128; ++x)
+		{
+			XMFLOAT3 origin, direction;
+			float tEntry, tExit;
+			ReferenceRaymarcher::ComputeRay(scene.camera, x + 0.5f, y + 0.5f, 128, 128, origin, direction, tEntry, tExit);
+			float t = ReferenceRaymarcher::SceneDistance(scene.camera, depth, x + 0.5f, y + 0.5f, origin, direction);
+			float expected = hit[y * 128 + x];
+			if (expected == FLT_MAX)
+			{
+				CHECK(t == FLT_MAX);
+				continue;
+			}
+			++covered;
+			maxError = (fabsf(t - expected) > maxError) ? fabsf(t - expected) : maxError;
+		}
+	}
+	CHECK(covered > 0);
+	CHECK(maxError < 1e-3f);
+}
+
+TEST_CASE(FarPlaneLeavesTheImageAlone)
+{
+	TestScene scene = MakeScene();
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 32);
+	SceneDepthImage depth;
+	depth.width = depth.height = 48;
+	depth.depth.assign(48 * 48, 1.0f);
+
+	RaymarchSettings settings;
+	settings.steps = 64;
+	ReferenceImage plain, clamped;
+	plain.Resize(48, 48);
+	clamped.Resize(48, 48);
+	ReferenceRaymarcher::Render(volume, scene.camera, settings, plain);
+	settings.sceneDepth = &depth;
+	ReferenceRaymarcher::Render(volume, scene.camera, settings, clamped);
+
+	CHECK(std::memcmp(plain.color.data(), clamped.color.data(), plain.color.size() * sizeof(XMFLOAT4)) == 0);
+	CHECK(plain.samples == clamped.samples);
+	CHECK(clamped.depthSkippedSamples == 0);
+}
+
+TEST_CASE(ClampStopsRaysAtTheSurface)
+{
+	TestScene scene = MakeScene();
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 48);
+	SceneDepthImage depth;
+	std::vector<float> hit;
+	RenderPlaneDepth(scene, 0.0f, 96, depth, hit);
+
+	// Full resolution, then a half resolution march against the same full resolution depth.
+	const uint32_t sizes[] = { 96, 48 };
+	for (uint32_t size : sizes)
+	{
+		uint32_t scale = 96 / size;
+		RaymarchSettings settings;
+		settings.steps = 64;
+		ReferenceImage plain, clamped;
+		plain.Resize(size, size);
+		clamped.Resize(size, size);
+		ReferenceRaymarcher::Render(volume, scene.camera, settings, plain);
+		settings.sceneDepth = &depth;
+		ReferenceRaymarcher::Render(volume, scene.camera, settings, clamped);
+
+		uint32_t unoccludedChanged = 0;
+		uint32_t gainedOpacity = 0;
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				size_t i = static_cast<size_t>(y) * size + x;
+				uint32_t fullX = static_cast<uint32_t>((x + 0.5f) * scale);
+				uint32_t fullY = static_cast<uint32_t>((y + 0.5f) * scale);
+				bool occluded = hit[static_cast<size_t>(fullY) * 96 + fullX] != FLT_MAX;
+				unoccludedChanged += (!occluded && std::memcmp(&plain.color[i], &clamped.color[i], sizeof(XMFLOAT4)) != 0) ? 1 : 0;
+				gainedOpacity += (clamped.color[i].w > plain.color[i].w + 1e-6f) ? 1 : 0;
+			}
+		}
+		CHECK(unoccludedChanged == 0);
+		CHECK(gainedOpacity == 0);
+		CHECK(clamped.samples < plain.samples);
+		CHECK(clamped.depthSkippedSamples > 0);
+		CHECK(plain.depthSkippedSamples == 0);
+	}
+}
+
+TEST_CASE(SkippedStepsAccountForTheDifference)
+{
+	TestScene scene = MakeScene();
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 48);
+	SceneDepthImage depth;
+	std::vector<float> hit;
+	RenderPlaneDepth(scene, 0.1f, 64, depth, hit);
+
+	// Without shadow taps or early termination every step is one sample, so the steps the clamp skipped are exactly
+	// the samples it saved.
+	RaymarchSettings settings;
+	settings.steps = 64;
+	settings.shadows = false;
+	settings.globalDensity = 0.01f;
+	ReferenceImage plain, clamped;
+	plain.Resize(64, 64);
+	clamped.Resize(64, 64);
+	ReferenceRaymarcher::Render(volume, scene.camera, settings, plain);
+	settings.sceneDepth = &depth;
+	ReferenceRaymarcher::Render(volume, scene.camera, settings, clamped);
+
+	CHECK(clamped.depthSkippedSamples > 0);
+	CHECK(clamped.samples + clamped.depthSkippedSamples == plain.samples);
+}
+
+TEST_CASE(SurfaceInFrontOfTheBoxTakesNoSamples)
+{
+	TestScene scene = MakeScene();
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 32);
+	SceneDepthImage depth;
+	std::vector<float> hit;
+	RenderPlaneDepth(scene, -1.5f, 40, depth, hit);
+
+	RaymarchSettings settings;
+	settings.steps = 64;
+	settings.sceneDepth = &depth;
+	ReferenceImage image;
+	image.Resize(40, 40);
+	ReferenceRaymarcher::Render(volume, scene.camera, settings, image);
+
+	// The plane covers the whole view, so every ray that reaches the box is skipped outright.
+	bool allEmpty = true;
+	for (const XMFLOAT4& color : image.color)
+	{
+		allEmpty = allEmpty && color.x == 0.0f && color.y == 0.0f && color.z == 0.0f && color.w == 0.0f;
+	}
+	CHECK(allEmpty);
+	CHECK(image.samples == 0);
+	CHECK(image.depthSkippedSamples > 0);
+}
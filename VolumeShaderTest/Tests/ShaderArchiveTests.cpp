@@ -0,0 +1,127 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "ShaderArchive.h"
+#include <cstring>
+#include <string>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	const uint64_t TestBuildId = 0x1234567890ABCDEFull;
+
+	std::vector<uint8_t> MakeBlob(size_t size, uint8_t seed)
+	{
+		std::vector<uint8_t> blob(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			blob[i] = static_cast<uint8_t>(seed + i * 7);
+		}
+		return blob;
+	}
+
+	std::vector<uint8_t> MakeArchive(uint64_t buildId)
+	{
+		ShaderArchiveWriter writer;
+		std::vector<uint8_t> vertex = MakeBlob(1000, 1);
+		std::vector<uint8_t> pixel = MakeBlob(37, 2);
+		writer.Add("SampleVertexShader.cso", vertex.data(), vertex.size());
+		writer.Add("SamplePixelShader.cso", pixel.data(), pixel.size());
+		writer.Add("Empty.cso", nullptr, 0);
+		return writer.Serialize(buildId);
+	}
+}
+
+TEST_CASE(RoundTripsEveryEntry)
+{
+	std::vector<uint8_t> archive = MakeArchive(TestBuildId);
+	ShaderArchiveReader reader;
+	REQUIRE(reader.Open(archive.data(), archive.size(), TestBuildId));
+	CHECK(reader.GetEntryCount() == 3);
+	CHECK(reader.GetBuildId() == TestBuildId);
+	CHECK(reader.GetName(1) == "SamplePixelShader.cso");
+
+	const uint8_t* data;
+	size_t size;
+	REQUIRE(reader.Find("SampleVertexShader.cso", data, size));
+	std::vector<uint8_t> vertex = MakeBlob(1000, 1);
+	CHECK(size == vertex.size() && std::memcmp(data, vertex.data(), size) == 0);
+	CHECK((data - archive.data()) % ShaderArchiveAlignment == 0);
+
+	REQUIRE(reader.Find("SamplePixelShader.cso", data, size));
+	std::vector<uint8_t> pixel = MakeBlob(37, 2);
+	CHECK(size == pixel.size() && std::memcmp(data, pixel.data(), size) == 0);
+	CHECK((data - archive.data()) % ShaderArchiveAlignment == 0);
+
+	REQUIRE(reader.Find("Empty.cso", data, size));
+	CHECK(size == 0);
+	CHECK(!reader.Find("Missing.cso", data, size));
+}
+
+TEST_CASE(RejectsOtherBuilds)
+{
+	std::vector<uint8_t> archive = MakeArchive(TestBuildId);
+	ShaderArchiveReader reader;
+	CHECK(!reader.Open(archive.data(), archive.size(), TestBuildId + 1));
+	CHECK(reader.GetEntryCount() == 0);
+
+	// A version bump invalidates archives even with the same build id.
+	archive[4]++;
+	CHECK(!reader.Open(archive.data(), archive.size(), TestBuildId));
+}
+
+TEST_CASE(RejectsTruncatedAndCorruptArchives)
+{
+	std::vector<uint8_t> archive = MakeArchive(TestBuildId);
+	ShaderArchiveReader reader;
+	CHECK(!reader.Open(nullptr, 0, TestBuildId));
+	for (size_t size = 0; size < archive.size(); size += 7)
+	{
+		// Anything cut before the last blob ends fails; the data is never read past size.
+		CHECK(!reader.Open(archive.data(), size, TestBuildId));
+	}
+
+	// An entry count larger than the file can hold.
+	std::vector<uint8_t> corrupt = archive;
+	corrupt[16] = 0xFF;
+	corrupt[17] = 0xFF;
+	CHECK(!reader.Open(corrupt.data(), corrupt.size(), TestBuildId));
+
+	// A data offset near 2^64 must not wrap past the bounds check.
+	corrupt = archive;
+	const uint64_t farOffset = ~0ull - 4;
+	std::memcpy(&corrupt[24], &farOffset, sizeof(farOffset));
+	CHECK(!reader.Open(corrupt.data(), corrupt.size(), TestBuildId));
+	CHECK(reader.GetEntryCount() == 0);
+
+	// A name running past the end.
+	corrupt = archive;
+	const uint32_t longName = 1u << 30;
+	std::memcpy(&corrupt[24 + 20], &longName, sizeof(longName));
+	CHECK(!reader.Open(corrupt.data(), corrupt.size(), TestBuildId));
+}
+
+TEST_CASE(ContentKeyTracksEveryByte)
+{
+	// Published FNV-1a test vectors.
+	CHECK(HashShaderArchiveKey("", 0) == 0xCBF29CE484222325ull);
+	CHECK(HashShaderArchiveKey("a", 1) == 0xAF63DC4C8601EC8Cull);
+	CHECK(HashShaderArchiveKey("foobar", 6) == 0x85944171F73967E8ull);
+
+	// Chaining is the same as hashing the concatenation.
+	CHECK(HashShaderArchiveKey("bar", 3, HashShaderArchiveKey("foo", 3)) == HashShaderArchiveKey("foobar", 6));
+
+	// The build hashes each .cso and then hashes the list; one changed byte, or a reordering, changes the key.
+	std::string hashes = "3F2A00" "9B1C44";
+	uint64_t key = HashShaderArchiveKey(hashes.data(), hashes.size());
+	std::string edited = hashes;
+	edited[5] = '1';
+	CHECK(HashShaderArchiveKey(edited.data(), edited.size()) != key);
+	std::string swapped = "9B1C44" "3F2A00";
+	CHECK(HashShaderArchiveKey(swapped.data(), swapped.size()) != key);
+
+	std::vector<uint8_t> archive = MakeArchive(key);
+	ShaderArchiveReader reader;
+	CHECK(reader.Open(archive.data(), archive.size(), key));
+	CHECK(!reader.Open(archive.data(), archive.size(), HashShaderArchiveKey(edited.data(), edited.size())));
+}
@@ -0,0 +1,176 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "ShaderPermutations.h"
+#include <random>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	const VolumeFormat RendererFormats[] = { VolumeFormat::Rgba, VolumeFormat::Paged, VolumeFormat::Channels };
+
+	RaymarchPermutation Entry(const RaymarchPermutationKey& key)
+	{
+		RaymarchPermutation permutation = { L"Test.cso", key };
+		return permutation;
+	}
+}
+
+TEST_CASE(PackRoundTripsEveryField)
+{
+	std::mt19937 random(31);
+	for (int i = 0; i < 2000; ++i)
+	{
+		RaymarchPermutationKey key(
+			(random() & 1) != 0,
+			random() % 4096,
+			static_cast<VolumeFormat>(random() % 4),
+			(random() & 1) != 0,
+			random() % 101,
+			(random() & 1) != 0,
+			static_cast<CompositeMode>(random() % 5));
+		RaymarchPermutationKey unpacked = RaymarchPermutationKey::Unpack(key.Pack());
+		CHECK(unpacked.shadows == key.shadows);
+		CHECK(unpacked.steps == key.steps);
+		CHECK(unpacked.format == key.format);
+		CHECK(unpacked.transferFunction == key.transferFunction);
+		CHECK(unpacked.earlyOutPercent == key.earlyOutPercent);
+		CHECK(unpacked.gradients == key.gradients);
+		CHECK(unpacked.composite == key.composite);
+	}
+
+	// Each field has its own bits.
+	RaymarchPermutationKey base(false, 0, VolumeFormat::Rgba, false, 0);
+	CHECK(base != RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 0));
+	CHECK(base != RaymarchPermutationKey(false, 1, VolumeFormat::Rgba, false, 0));
+	CHECK(base != RaymarchPermutationKey(false, 0, VolumeFormat::Channels, false, 0));
+	CHECK(base != RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, true, 0));
+	CHECK(base != RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, false, 100));
+	CHECK(base != RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, false, 0, true));
+	CHECK(base != RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, false, 0, false, CompositeMode::FirstHit));
+}
+
+TEST_CASE(SelectionMatchesExactly)
+{
+	const RaymarchPermutation table[] =
+	{
+		Entry(RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 99)),
+		Entry(RaymarchPermutationKey(true, 128, VolumeFormat::Rgba, false, 99)),
+		Entry(RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, false, 99)),
+		Entry(RaymarchPermutationKey(true, 0, VolumeFormat::Paged, true, 99)),
+		Entry(RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 99, true)),
+		Entry(RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, false, 100, false, CompositeMode::MaximumIntensity)),
+	};
+	const size_t count = sizeof(table) / sizeof(table[0]);
+
+	// A fixed step entry serves only its own count and beats the dynamic one there.
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 128, VolumeFormat::Rgba, false, 99)) == 1);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 64, VolumeFormat::Rgba, false, 99)) == 0);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 99)) == 0);
+
+	// Shadows, gradients, format and transfer function must all match.
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(false, 128, VolumeFormat::Rgba, false, 99)) == 2);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 99, true)) == 4);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, false, 99, true)) == -1);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Paged, true, 99)) == 3);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Paged, false, 99)) == -1);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, true, 99)) == -1);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Channels, false, 99)) == -1);
+
+	// The compositing mode must match; projections ignore shadows, gradients and early out.
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 128, VolumeFormat::Rgba, false, 50, true, CompositeMode::MaximumIntensity)) == 5);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, false, 100, false, CompositeMode::MinimumIntensity)) == -1);
+}
+
+TEST_CASE(EarlyOutMayComeLaterButNeverEarlier)
+{
+	const RaymarchPermutation table[] =
+	{
+		Entry(RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 99)),
+		Entry(RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 100)),
+		Entry(RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 95)),
+	};
+	const size_t count = sizeof(table) / sizeof(table[0]);
+
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 95)) == 2);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 90)) == 2);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 97)) == 0);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 99)) == 0);
+	CHECK(SelectRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 100)) == 1);
+
+	// Without the E100 entry nothing may stop a march that asked never to stop.
+	CHECK(SelectRaymarchPermutation(table, 1, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 100)) == -1);
+}
+
+TEST_CASE(FallbackNeverChangesFormatOrComposite)
+{
+	const RaymarchPermutation table[] =
+	{
+		Entry(RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 99)),
+		Entry(RaymarchPermutationKey(true, 128, VolumeFormat::Paged, true, 99)),
+		Entry(RaymarchPermutationKey(false, 0, VolumeFormat::Paged, true, 90)),
+		Entry(RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, false, 100, false, CompositeMode::MaximumIntensity)),
+	};
+	const size_t count = sizeof(table) / sizeof(table[0]);
+
+	// Exact matches come back unchanged.
+	CHECK(SelectNearestRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, false, 99)) == 0);
+
+	// Matching shadows outweigh the step count and the threshold.
+	CHECK(SelectNearestRaymarchPermutation(table, count, RaymarchPermutationKey(false, 128, VolumeFormat::Paged, true, 99)) == 2);
+	CHECK(SelectNearestRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Paged, true, 100)) == 1);
+
+	// Never another format, transfer function or mode.
+	CHECK(SelectNearestRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Channels, false, 99)) == -1);
+	CHECK(SelectNearestRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Rgba, true, 99)) == -1);
+	CHECK(SelectNearestRaymarchPermutation(table, count, RaymarchPermutationKey(true, 0, VolumeFormat::Paged, true, 99, false, CompositeMode::FirstHit)) == -1);
+}
+
+TEST_CASE(RequestsFollowTheVolumeFormat)
+{
+	RaymarchPermutationKey channels = MakeRaymarchRequest(true, false, VolumeFormat::Channels, true, 99, true, CompositeMode::Alpha);
+	CHECK(!channels.transferFunction);
+	CHECK(!channels.gradients);
+	CHECK(channels.steps == 128);
+
+	RaymarchPermutationKey paged = MakeRaymarchRequest(true, true, VolumeFormat::Paged, false, 120, true, CompositeMode::Alpha);
+	CHECK(paged.transferFunction);
+	CHECK(!paged.gradients);
+	CHECK(paged.steps == 0);
+	CHECK(paged.earlyOutPercent == 100);
+
+	RaymarchPermutationKey rgba = MakeRaymarchRequest(false, true, VolumeFormat::Rgba, true, 95, true, CompositeMode::Alpha);
+	CHECK(rgba == RaymarchPermutationKey(false, 0, VolumeFormat::Rgba, true, 95, true));
+}
+
+TEST_CASE(EveryAlphaRequestHasAVariant)
+{
+	size_t count = 0;
+	const RaymarchPermutation* table = GetRaymarchPermutations(count);
+	REQUIRE(count > 0);
+	for (size_t i = 0; i < count; ++i)
+	{
+		CHECK(table[i].key.format != VolumeFormat::Density);
+	}
+
+	for (VolumeFormat format : RendererFormats)
+	{
+		for (uint32_t options = 0; options < 16; ++options)
+		{
+			for (uint32_t earlyOut = 0; earlyOut <= 100; ++earlyOut)
+			{
+				RaymarchPermutationKey request = MakeRaymarchRequest(
+					(options & 1) != 0, (options & 2) != 0, format, (options & 4) != 0, earlyOut, (options & 8) != 0, CompositeMode::Alpha);
+				int index = SelectRaymarchPermutation(table, count, request);
+				REQUIRE(index >= 0);
+				const RaymarchPermutationKey& key = table[index].key;
+				CHECK(key.format == request.format);
+				CHECK(key.transferFunction == request.transferFunction);
+				CHECK(key.composite == request.composite);
+				CHECK(key.shadows == request.shadows);
+				CHECK(key.gradients == request.gradients);
+				CHECK(key.earlyOutPercent >= request.earlyOutPercent);
+			}
+		}
+	}
+}
@@ -0,0 +1,191 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "StereoCamera.h"
+#include "VolumeCulling.h"
+#include <algorithm>
+#include <random>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	struct TestRig
+	{
+		XMVECTOR eye;
+		XMVECTOR forward;
+		StereoRig rig;
+		StereoView stereo;
+		XMMATRIX viewProjection[StereoViewCount];
+	};
+
+	TestRig MakeRig()
+	{
+		TestRig test;
+		test.eye = XMVectorSet(0.0f, 0.7f, -3.0f, 0.0f);
+		XMVECTOR at = XMVectorSet(0.0f, -0.1f, 0.0f, 0.0f);
+		test.forward = XMVector3Normalize(XMVectorSubtract(at, test.eye));
+		ComputeStereoView(test.eye, at, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), 70.0f * XM_PI / 180.0f, 0.5f * 16.0f / 9.0f, 0.01f, 100.0f, test.rig, test.stereo);
+		for (uint32_t i = 0; i < StereoViewCount; ++i)
+		{
+			test.viewProjection[i] = XMMatrixMultiply(XMLoadFloat4x4(&test.stereo.view[i]), XMLoadFloat4x4(&test.stereo.projection[i]));
+		}
+		return test;
+	}
+
+	XMVECTOR ToClip(FXMVECTOR point, CXMMATRIX matrix)
+	{
+		return XMVector4Transform(XMVectorSet(XMVectorGetX(point), XMVectorGetY(point), XMVectorGetZ(point), 1.0f), matrix);
+	}
+
+	// Inside the D3D clip volume, give or take slack times w.
+	bool InsideClip(FXMVECTOR clip, float slack)
+	{
+		float x = XMVectorGetX(clip), y = XMVectorGetY(clip), z = XMVectorGetZ(clip), w = XMVectorGetW(clip);
+		float margin = slack * w;
+		return x >= -w - margin && x <= w + margin && y >= -w - margin && y <= w + margin && z >= -margin && z <= w + margin;
+	}
+}
+
+TEST_CASE(EyesSitEitherSideOfTheMonoCamera)
+{
+	TestRig test = MakeRig();
+	XMVECTOR left = XMLoadFloat3(&test.stereo.eyePosition[0]);
+	XMVECTOR right = XMLoadFloat3(&test.stereo.eyePosition[1]);
+	CHECK_NEAR(XMVectorGetX(XMVector3Length(XMVectorSubtract(right, left))), test.rig.eyeSeparation, 1e-6);
+	CHECK_NEAR(XMVectorGetX(XMVector3Length(XMVectorSubtract(XMVectorScale(XMVectorAdd(left, right), 0.5f), test.eye))), 0.0f, 1e-6);
+	CHECK(XMVectorGetX(right) > XMVectorGetX(left));
+
+	// The baseline is square to the view axis.
+	CHECK_NEAR(XMVectorGetX(XMVector3Dot(XMVectorSubtract(right, left), test.forward)), 0.0f, 1e-6);
+}
+
+TEST_CASE(ParallaxIsHorizontalAndVanishesAtConvergence)
+{
+	TestRig test = MakeRig();
+	XMVECTOR convergence = XMVectorMultiplyAdd(test.forward, XMVectorReplicate(test.rig.convergenceDistance), test.eye);
+	XMVECTOR left = ToClip(convergence, test.viewProjection[0]);
+	XMVECTOR right = ToClip(convergence, test.viewProjection[1]);
+	CHECK_NEAR(XMVectorGetX(left) / XMVectorGetW(left), 0.0f, 1e-5);
+	CHECK_NEAR(XMVectorGetX(right) / XMVectorGetW(right), 0.0f, 1e-5);
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	float maxVertical = 0.0f;
+	uint32_t wrongSign = 0;
+	for (int i = 0; i < 20000; ++i)
+	{
+		XMVECTOR point = XMVectorSet(unit(random) * 4.0f - 2.0f, unit(random) * 4.0f - 2.0f, unit(random) * 20.0f - 2.0f, 0.0f);
+		left = ToClip(point, test.viewProjection[0]);
+		right = ToClip(point, test.viewProjection[1]);
+		if (XMVectorGetW(left) < 0.01f)
+		{
+			continue;
+		}
+		maxVertical = std::max(maxVertical, fabsf(XMVectorGetY(left) / XMVectorGetW(left) - XMVectorGetY(right) / XMVectorGetW(right)));
+
+		// Beyond convergence the left image lies left of the right one; nearer, the other way round.
+		float depth = XMVectorGetX(XMVector3Dot(XMVectorSubtract(point, test.eye), test.forward));
+		float parallax = XMVectorGetX(left) / XMVectorGetW(left) - XMVectorGetX(right) / XMVectorGetW(right);
+		wrongSign += ((depth > test.rig.convergenceDistance * 1.001f && parallax >= 0.0f) ||
+			(depth < test.rig.convergenceDistance * 0.999f && parallax <= 0.0f)) ? 1 : 0;
+	}
+	CHECK(maxVertical < 1e-5f);
+	CHECK(wrongSign == 0);
+}
+
+TEST_CASE(CullFrustumHoldsBothEyes)
+{
+	TestRig test = MakeRig();
+	XMMATRIX cull = XMLoadFloat4x4(&test.stereo.cullViewProjection);
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	uint32_t outside = 0;
+	for (uint32_t eye = 0; eye < StereoViewCount; ++eye)
+	{
+		XMMATRIX inverse = XMMatrixInverse(nullptr, test.viewProjection[eye]);
+		for (int i = 0; i < 20000; ++i)
+		{
+			// Cubing the depth spreads the points over distance rather than bunching them at the far plane.
+			float z = unit(random);
+			XMVECTOR world = XMVector3TransformCoord(XMVectorSet(unit(random) * 2.0f - 1.0f, unit(random) * 2.0f - 1.0f, z * z * z, 1.0f), inverse);
+			outside += InsideClip(ToClip(world, cull), 1e-4f) ? 0 : 1;
+		}
+	}
+	CHECK(outside == 0);
+}
+
+TEST_CASE(OnePassKeepsEveryBrickEitherEyeSees)
+{
+	TestRig test = MakeRig();
+	XMMATRIX cull = XMLoadFloat4x4(&test.stereo.cullViewProjection);
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<VolumeBrickBounds> bricks(4096);
+	for (VolumeBrickBounds& brick : bricks)
+	{
+		brick.center = XMFLOAT3((unit(random) * 2.0f - 1.0f) * 6.0f, (unit(random) * 2.0f - 1.0f) * 6.0f, (unit(random) * 2.0f - 1.0f) * 6.0f);
+		float extent = 0.02f + unit(random) * 0.05f;
+		brick.extents = XMFLOAT3(extent, extent, extent);
+	}
+
+	std::vector<uint8_t> left(bricks.size()), right(bricks.size()), combined(bricks.size());
+	uint64_t eitherEye = 0, onePass = 0;
+	bool lostBrick = false;
+	for (int frame = 0; frame < 8; ++frame)
+	{
+		XMMATRIX world = XMMatrixRotationY(frame * 0.4f);
+		VolumeCuller leftCuller, rightCuller, combinedCuller;
+		leftCuller.SetWorldViewProjection(XMMatrixMultiply(world, test.viewProjection[0]));
+		rightCuller.SetWorldViewProjection(XMMatrixMultiply(world, test.viewProjection[1]));
+		combinedCuller.SetWorldViewProjection(XMMatrixMultiply(world, cull));
+		leftCuller.Cull(bricks.data(), bricks.size(), left.data(), nullptr);
+		rightCuller.Cull(bricks.data(), bricks.size(), right.data(), nullptr);
+		combinedCuller.Cull(bricks.data(), bricks.size(), combined.data(), nullptr);
+		for (size_t i = 0; i < bricks.size(); ++i)
+		{
+			bool seen = left[i] || right[i];
+			eitherEye += seen ? 1 : 0;
+			onePass += combined[i] ? 1 : 0;
+			lostBrick = lostBrick || (seen && !combined[i]);
+		}
+	}
+	CHECK(!lostBrick);
+	CHECK(eitherEye > 0);
+
+	// The cull frustum is only slightly wider than the two eyes together.
+	CHECK(onePass <= eitherEye + eitherEye / 20);
+}
+
+TEST_CASE(OrientationAndConstantsFollowEachEye)
+{
+	TestRig test = MakeRig();
+	StereoView oriented = test.stereo;
+	XMMATRIX orientation = XMMatrixRotationZ(XM_PIDIV2);
+	OrientStereoView(oriented, orientation);
+	XMFLOAT4X4 expected;
+	XMStoreFloat4x4(&expected, XMMatrixMultiply(XMLoadFloat4x4(&test.stereo.projection[1]), orientation));
+	bool sameProjection = true;
+	for (int row = 0; row < 4; ++row)
+	{
+		for (int column = 0; column < 4; ++column)
+		{
+			sameProjection = sameProjection && fabsf(oriented.projection[1].m[row][column] - expected.m[row][column]) < 1e-6f;
+		}
+	}
+	CHECK(sameProjection);
+
+	// The shader reads column-major matrices, so each stored row is a column of world * view * projection.
+	ModelViewProjectionConstantBuffer constants = {};
+	XMMATRIX world = XMMatrixTranslation(0.25f, 0.0f, 0.0f);
+	StoreStereoView(test.stereo, world, constants);
+	for (uint32_t eye = 0; eye < StereoViewCount; ++eye)
+	{
+		XMVECTOR point = XMVectorSet(0.1f, 0.2f, 0.3f, 1.0f);
+		XMVECTOR direct = XMVector4Transform(point, XMMatrixMultiply(world, test.viewProjection[eye]));
+		XMVECTOR stored = XMVector4Transform(point, XMMatrixTranspose(XMLoadFloat4x4(&constants.eyeWorldViewProjection[eye])));
+		CHECK_NEAR(XMVectorGetX(XMVector3Length(XMVectorSubtract(direct, stored))), 0.0f, 1e-5);
+		CHECK_NEAR(XMVectorGetW(direct), XMVectorGetW(stored), 1e-5);
+		CHECK(constants.eyePositions[eye].x == test.stereo.eyePosition[eye].x && constants.eyePositions[eye].w == 1.0f);
+	}
+}
@@ -0,0 +1,153 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "SwizzledVolume.h"
+#include <algorithm>
+#include <random>
+
+using namespace VolumeShaderTest;
+
+namespace
+{
+	std::vector<float> MakeNoise(uint32_t width, uint32_t height, uint32_t depth, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> values(0.0f, 1.0f);
+		std::vector<float> voxels(static_cast<size_t>(width) * height * depth);
+		for (float& voxel : voxels)
+		{
+			voxel = values(random);
+		}
+		return voxels;
+	}
+
+	// Straightforward clamped 3x3x3 mean, independent of either optimized filter.
+	float ReferenceMean(const std::vector<float>& voxels, uint32_t width, uint32_t height, uint32_t depth, uint32_t x, uint32_t y, uint32_t z)
+	{
+		auto clamp = [](int value, uint32_t size) { return static_cast<uint32_t>(value < 0 ? 0 : (value >= static_cast<int>(size) ? size - 1 : value)); };
+		double sum = 0.0;
+		for (int dz = -1; dz <= 1; ++dz)
+		{
+			for (int dy = -1; dy <= 1; ++dy)
+			{
+				for (int dx = -1; dx <= 1; ++dx)
+				{
+					uint32_t sx = clamp(static_cast<int>(x) + dx, width);
+					uint32_t sy = clamp(static_cast<int>(y) + dy, height);
+					uint32_t sz = clamp(static_cast<int>(z) + dz, depth);
+					sum += voxels[(static_cast<size_t>(sz) * height + sy) * width + sx];
+				}
+			}
+		}
+		return static_cast<float>(sum / 27.0);
+	}
+}
+
+TEST_CASE(MortonRoundTrips)
+{
+	std::mt19937 random(1);
+	for (int i = 0; i < 10000; ++i)
+	{
+		uint32_t x = random() & 0x1FFFFF, y = random() & 0x1FFFFF, z = random() & 0x1FFFFF;
+		uint64_t code = MortonEncode3(x, y, z);
+		CHECK(code == (MortonSpreadBits(x) | (MortonSpreadBits(y) << 1) | (MortonSpreadBits(z) << 2)));
+
+		uint32_t dx, dy, dz;
+		MortonDecode3(code, dx, dy, dz);
+		CHECK(dx == x && dy == y && dz == z);
+		CHECK(MortonCompactBits(code >> 1) == y);
+	}
+
+	CHECK(MortonEncode3(1, 0, 0) == 1);
+	CHECK(MortonEncode3(0, 1, 0) == 2);
+	CHECK(MortonEncode3(0, 0, 1) == 4);
+	CHECK(MortonEncode3(7, 7, 7) == 511);
+	CHECK(MortonEncode3(0x1FFFFF, 0x1FFFFF, 0x1FFFFF) == 0x7FFFFFFFFFFFFFFFull);
+}
+
+TEST_CASE(TiledLayoutRoundTrips)
+{
+	// Sizes that leave partial edge tiles on every axis.
+	const uint32_t width = 19, height = 9, depth = 13;
+	std::vector<float> linear = MakeNoise(width, height, depth, 2);
+	TiledVolume<float> tiled;
+	tiled.FromLinear(linear.data(), width, height, depth);
+	CHECK(tiled.GetTilesX() == 3 && tiled.GetTilesY() == 2 && tiled.GetTilesZ() == 2);
+
+	uint32_t mismatches = 0;
+	for (uint32_t z = 0; z < depth; ++z)
+	{
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				mismatches += tiled.At(x, y, z) == linear[(static_cast<size_t>(z) * height + y) * width + x] ? 0 : 1;
+			}
+		}
+	}
+	CHECK(mismatches == 0);
+
+	std::vector<float> back(linear.size(), -1.0f);
+	tiled.ToLinear(back.data());
+	CHECK(back == linear);
+
+	size_t visited = 0;
+	tiled.ForEachVoxel([&](uint32_t x, uint32_t y, uint32_t z, float&)
+	{
+		CHECK(x < width && y < height && z < depth);
+		++visited;
+	});
+	CHECK(visited == linear.size());
+}
+
+TEST_CASE(BothFiltersMatchTheReference)
+{
+	// Odd sizes exercise edge tiles, and 24 along x gives the tiled filter whole interior tiles too.
+	const uint32_t sizes[][3] = { { 24, 24, 24 }, { 19, 9, 13 }, { 1, 1, 1 }, { 8, 3, 17 } };
+	for (const auto& size : sizes)
+	{
+		uint32_t width = size[0], height = size[1], depth = size[2];
+		std::vector<float> source = MakeNoise(width, height, depth, width * 31 + depth);
+
+		std::vector<float> linear(source.size());
+		BoxFilter3x3x3(source.data(), width, height, depth, linear.data());
+
+		TiledVolume<float> tiledSource, tiledResult;
+		tiledSource.FromLinear(source.data(), width, height, depth);
+		BoxFilter3x3x3(tiledSource, tiledResult);
+		std::vector<float> tiled(source.size());
+		tiledResult.ToLinear(tiled.data());
+
+		double worstLinear = 0.0, worstTiled = 0.0;
+		for (uint32_t z = 0; z < depth; ++z)
+		{
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					size_t index = (static_cast<size_t>(z) * height + y) * width + x;
+					float expected = ReferenceMean(source, width, height, depth, x, y, z);
+					worstLinear = std::max(worstLinear, std::fabs(static_cast<double>(linear[index]) - expected));
+					worstTiled = std::max(worstTiled, std::fabs(static_cast<double>(tiled[index]) - expected));
+				}
+			}
+		}
+		CHECK_NEAR(worstLinear, 0.0, 1e-5);
+		CHECK_NEAR(worstTiled, 0.0, 1e-5);
+	}
+}
+
+TEST_CASE(FilterKeepsAConstantVolume)
+{
+	const uint32_t width = 17, height = 16, depth = 10;
+	std::vector<float> source(static_cast<size_t>(width) * height * depth, 0.75f);
+	TiledVolume<float> tiledSource, tiledResult;
+	tiledSource.FromLinear(source.data(), width, height, depth);
+	BoxFilter3x3x3(tiledSource, tiledResult);
+
+	double worst = 0.0;
+	tiledResult.ForEachVoxel([&](uint32_t, uint32_t, uint32_t, const float& voxel)
+	{
+		worst = std::max(worst, std::fabs(voxel - 0.75));
+	});
+	CHECK_NEAR(worst, 0.0, 1e-6);
+}
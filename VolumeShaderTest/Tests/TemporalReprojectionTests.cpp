@@ -0,0 +1,174 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "TemporalReprojection.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t Width = 96;
+	const uint32_t Height = 72;
+	const int BaseSteps = 128;
+
+	struct Frame
+	{
+		RaymarchCamera camera;
+		XMFLOAT4X4 worldViewProjection;
+	};
+
+	// Orbits the volume by yaw radians, like the sample's rotating cube.
+	Frame MakeFrame(float yaw)
+	{
+		XMFLOAT3 eye(0.0f, 0.5f, -1.8f);
+		XMMATRIX world = XMMatrixRotationY(yaw);
+		XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, static_cast<float>(Width) / Height, 0.01f, 100.0f);
+
+		Frame frame;
+		frame.camera = MakeRaymarchCamera(world, view, projection, eye, XMFLOAT3(0.0f, 2.0f, -2.0f));
+		XMStoreFloat4x4(&frame.worldViewProjection, world * view * projection);
+		return frame;
+	}
+
+	// A cheap frame: fewer steps with the start jittered per frame, opacity corrected back to the base step count.
+	void RenderCheap(const VolumeData& volume, const Frame& frame, int steps, uint32_t frameIndex, ReferenceImage& image)
+	{
+		RaymarchSettings settings;
+		settings.steps = steps;
+		settings.frameIndex = frameIndex;
+		settings.opacityCorrection = static_cast<float>(BaseSteps) / steps;
+		settings.shadows = false;
+		image.Resize(Width, Height);
+		ReferenceRaymarcher::Render(volume, frame.camera, settings, image);
+	}
+
+	void RenderTruth(const VolumeData& volume, const Frame& frame, ReferenceImage& image)
+	{
+		RaymarchSettings settings;
+		settings.steps = BaseSteps * 4;
+		settings.opacityCorrection = 0.25f;
+		settings.shadows = false;
+		settings.jitter = false;
+		image.Resize(Width, Height);
+		ReferenceRaymarcher::Render(volume, frame.camera, settings, image);
+	}
+
+	// Ghosting after a sudden change: runs frames on the new volume with a history built on the old one and returns
+	// the error against the new volume's ground truth after each frame.
+	std::vector<float> GhostingCurve(bool neighborhoodClamp, int frames)
+	{
+		VolumeData before, after;
+		GenerateFogSphereVolume(before, 32);
+		after = before;
+		for (size_t i = 0; i < after.voxels.size(); i += 4)
+		{
+			// Same shape, different color: history that survives reprojection is now simply wrong.
+			std::swap(after.voxels[i], after.voxels[i + 2]);
+		}
+
+		TemporalSettings settings;
+		settings.neighborhoodClamp = neighborhoodClamp;
+		TemporalAccumulator accumulator;
+		Frame frame = MakeFrame(0.3f);
+		ReferenceImage current;
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			RenderCheap(before, frame, 32, i, current);
+			accumulator.Accumulate(current, frame.camera, XMLoadFloat4x4(&frame.worldViewProjection), settings);
+		}
+
+		ReferenceImage truth;
+		RenderTruth(after, frame, truth);
+		std::vector<float> curve;
+		for (int i = 0; i < frames; ++i)
+		{
+			RenderCheap(after, frame, 32, 8 + i, current);
+			accumulator.Accumulate(current, frame.camera, XMLoadFloat4x4(&frame.worldViewProjection), settings);
+			curve.push_back(CompareImages(truth, accumulator.GetHistory(), 0.05f).rmse);
+		}
+		return curve;
+	}
+}
+
+TEST_CASE(FirstFrameHasNoHistory)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 24);
+	Frame frame = MakeFrame(0.0f);
+	ReferenceImage current;
+	RenderCheap(volume, frame, 32, 0, current);
+
+	TemporalAccumulator accumulator;
+	TemporalStats stats = accumulator.Accumulate(current, frame.camera, XMLoadFloat4x4(&frame.worldViewProjection), TemporalSettings());
+	CHECK(stats.reprojected == 0);
+	CHECK(CompareImages(current, accumulator.GetHistory(), 0.0f).pixelsAboveThreshold == 0);
+}
+
+TEST_CASE(StaticViewConvergesTowardsTheFullStepRender)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 32);
+	Frame frame = MakeFrame(0.3f);
+	ReferenceImage truth;
+	RenderTruth(volume, frame, truth);
+
+	TemporalAccumulator accumulator;
+	ReferenceImage current;
+	float singleFrame = 0.0f;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		RenderCheap(volume, frame, 16, i, current);
+		singleFrame = CompareImages(truth, current, 0.05f).rmse;
+		accumulator.Accumulate(current, frame.camera, XMLoadFloat4x4(&frame.worldViewProjection), TemporalSettings());
+	}
+	float accumulated = CompareImages(truth, accumulator.GetHistory(), 0.05f).rmse;
+	std::printf("  16 steps: single frame rmse %.4f, after 16 frames %.4f\n", singleFrame, accumulated);
+	CHECK(accumulated < singleFrame * 0.75f);
+}
+
+TEST_CASE(OrbitReprojectsMostPixels)
+{
+	VolumeData volume;
+	GenerateFogSphereVolume(volume, 32);
+	TemporalAccumulator accumulator;
+	ReferenceImage current, truth;
+	TemporalStats stats = {};
+	float rmse = 0.0f;
+	for (uint32_t i = 0; i < 12; ++i)
+	{
+		Frame frame = MakeFrame(0.3f + 0.02f * i);
+		RenderCheap(volume, frame, 32, i, current);
+		stats = accumulator.Accumulate(current, frame.camera, XMLoadFloat4x4(&frame.worldViewProjection), TemporalSettings());
+		if (i == 11)
+		{
+			RenderTruth(volume, frame, truth);
+			rmse = CompareImages(truth, accumulator.GetHistory(), 0.05f).rmse;
+		}
+	}
+
+	uint32_t covered = stats.reprojected + stats.rejected;
+	std::printf("  orbit: %u reprojected, %u rejected, %u clamped, rmse %.4f\n", stats.reprojected, stats.rejected, stats.clamped, rmse);
+	REQUIRE(covered > 0);
+	CHECK(stats.reprojected > covered * 9 / 10);
+	CHECK(rmse < 0.01f);
+}
+
+TEST_CASE(NeighborhoodClampLimitsGhosting)
+{
+	std::vector<float> clamped = GhostingCurve(true, 8);
+	std::vector<float> unclamped = GhostingCurve(false, 8);
+	std::printf("  ghosting rmse after the change, clamped / unclamped:");
+	for (size_t i = 0; i < clamped.size(); ++i)
+	{
+		std::printf(" %.3f/%.3f", clamped[i], unclamped[i]);
+	}
+	std::printf("\n");
+
+	for (size_t i = 0; i < clamped.size(); ++i)
+	{
+		CHECK(clamped[i] < unclamped[i]);
+	}
+	// Without the clamp the history decays by 1 - blendWeight per frame; with it the stale color is gone at once.
+	CHECK(clamped[0] < unclamped[0] * 0.5f);
+}
@@ -0,0 +1,117 @@
+﻿#pragma once
+
+// Minimal self-registering test harness for the headless CMake build. Each test executable
+// links TestMain.cpp, declares cases with TEST_CASE and checks them with CHECK / REQUIRE;
+// the process exits non-zero when any check failed so ctest reports it.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+namespace VolumeShaderTest
+{
+	namespace Testing
+	{
+		struct TestCase
+		{
+			const char* name;
+			void (*function)();
+		};
+
+		// Thrown by REQUIRE to abandon the current case after reporting the failure.
+		struct RequireFailed {};
+
+		inline std::vector<TestCase>& Registry()
+		{
+			static std::vector<TestCase> cases;
+			return cases;
+		}
+
+		inline int& FailureCount()
+		{
+			static int failures = 0;
+			return failures;
+		}
+
+		struct Registrar
+		{
+			Registrar(const char* name, void (*function)())
+			{
+				TestCase testCase = { name, function };
+				Registry().push_back(testCase);
+			}
+		};
+
+		inline void ReportFailure(const char* file, int line, const char* expression)
+		{
+			std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+			++FailureCount();
+		}
+
+		inline void ReportNearFailure(const char* file, int line, const char* expression, double actual, double expected, double tolerance)
+		{
+			std::fprintf(stderr, "%s(%d): check failed: %s (%g vs %g, tolerance %g)\n", file, line, expression, actual, expected, tolerance);
+			++FailureCount();
+		}
+
+		// Runs every registered case, or only those whose name contains argv[1].
+		inline int RunAllTests(int argc, char** argv)
+		{
+			const char* filter = (argc > 1) ? argv[1] : nullptr;
+			int run = 0;
+			int failedCases = 0;
+			for (const TestCase& testCase : Registry())
+			{
+				if (filter && !std::strstr(testCase.name, filter))
+				{
+					continue;
+				}
+
+				int failuresBefore = FailureCount();
+				try
+				{
+					testCase.function();
+				}
+				catch (const RequireFailed&)
+				{
+				}
+				catch (const std::exception& e)
+				{
+					std::fprintf(stderr, "%s: unexpected exception: %s\n", testCase.name, e.what());
+					++FailureCount();
+				}
+
+				++run;
+				bool passed = FailureCount() == failuresBefore;
+				failedCases += passed ? 0 : 1;
+				std::printf("[%s] %s\n", passed ? "pass" : "FAIL", testCase.name);
+			}
+
+			std::printf("%d of %d test cases passed\n", run - failedCases, run);
+			return (failedCases == 0 && run > 0) ? 0 : 1;
+		}
+	}
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static ::VolumeShaderTest::Testing::Registrar name##_registrar(#name, &name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) ::VolumeShaderTest::Testing::ReportFailure(__FILE__, __LINE__, #expression); } while (0)
+
+#define REQUIRE(expression) \
+	do { if (!(expression)) { ::VolumeShaderTest::Testing::ReportFailure(__FILE__, __LINE__, #expression); throw ::VolumeShaderTest::Testing::RequireFailed(); } } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do \
+	{ \
+		double actualValue_ = static_cast<double>(actual); \
+		double expectedValue_ = static_cast<double>(expected); \
+		double toleranceValue_ = static_cast<double>(tolerance); \
+		if (!(std::fabs(actualValue_ - expectedValue_) <= toleranceValue_)) \
+			::VolumeShaderTest::Testing::ReportNearFailure(__FILE__, __LINE__, #actual " ~= " #expected, actualValue_, expectedValue_, toleranceValue_); \
+	} while (0)
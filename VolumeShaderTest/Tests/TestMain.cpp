@@ -0,0 +1,6 @@
+﻿#include "TestHarness.h"
+
+int main(int argc, char** argv)
+{
+	return VolumeShaderTest::Testing::RunAllTests(argc, argv);
+}
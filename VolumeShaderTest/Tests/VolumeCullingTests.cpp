@@ -0,0 +1,147 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "VolumeCulling.h"
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// Camera at (0, 0, -2) looking down +z at the unit volume.
+	XMMATRIX TestViewProjection(float eyeX)
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(eyeX, 0.0f, -2.0f, 1.0f), XMVectorSet(eyeX, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.1f, 10.0f);
+		return XMMatrixMultiply(view, projection);
+	}
+
+	VolumeBrickBounds Brick(float x, float y, float z, float extent)
+	{
+		VolumeBrickBounds brick = { XMFLOAT3(x, y, z), XMFLOAT3(extent, extent, extent) };
+		return brick;
+	}
+
+	// Post-projection depth of a point on the view axis at distance z from the eye.
+	float ProjectedDepth(float z)
+	{
+		return 10.0f / 9.9f * (1.0f - 0.1f / z);
+	}
+}
+
+TEST_CASE(FrustumCullsOnlyBricksOutsideTheView)
+{
+	VolumeCuller culler;
+	culler.SetWorldViewProjection(TestViewProjection(0.0f));
+
+	VolumeBrickBounds bricks[6] =
+	{
+		Brick(0.0f, 0.0f, 0.0f, 0.1f),		// Centered.
+		Brick(0.0f, 0.0f, -3.0f, 0.1f),		// Behind the eye.
+		Brick(5.0f, 0.0f, 0.0f, 0.1f),		// Far to the right.
+		Brick(0.0f, 0.0f, 20.0f, 0.1f),		// Beyond the far plane.
+		Brick(2.05f, 0.0f, 0.0f, 0.1f),		// Straddles the right plane at x = 2.
+		Brick(0.0f, -1.0f, 1.0f, 0.1f),		// Below the axis but inside.
+	};
+	uint8_t visibility[6] = {};
+	CullingStats stats = culler.Cull(bricks, 6, visibility, nullptr);
+
+	CHECK(stats.tested == 6);
+	CHECK(stats.frustumCulled == 3);
+	CHECK(stats.occlusionCulled == 0);
+	CHECK(stats.visible == 3);
+	CHECK(visibility[0] == 1);
+	CHECK(visibility[1] == 0);
+	CHECK(visibility[2] == 0);
+	CHECK(visibility[3] == 0);
+	CHECK(visibility[4] == 1);
+	CHECK(visibility[5] == 1);
+}
+
+TEST_CASE(BuildFromDepthKeepsTheFarthestDepthPerTexel)
+{
+	// 7x5 depth folded into 3x2: the last texel of each row and column also takes the leftover pixels.
+	std::vector<float> depth(7 * 5, 0.25f);
+	depth[4 * 7 + 6] = 0.9f;
+	depth[0] = 0.5f;
+
+	HiZOcclusionBuffer occlusion;
+	occlusion.Resize(3, 2);
+	occlusion.BuildFromDepth(depth.data(), 7, 5, XMMatrixIdentity());
+
+	CHECK(occlusion.GetWidth() == 3);
+	CHECK(occlusion.GetHeight() == 2);
+	// Only the bottom right texel saw the 0.9 pixel; the top left one saw 0.5.
+	CHECK(occlusion.IsOccluded(0.8f, 0.6f, 0.95f, 0.95f, 0.85f) == false);
+	CHECK(occlusion.IsOccluded(0.0f, 0.0f, 0.3f, 0.45f, 0.6f) == true);
+	CHECK(occlusion.IsOccluded(0.0f, 0.0f, 0.3f, 0.45f, 0.45f) == false);
+	CHECK(occlusion.IsOccluded(0.4f, 0.0f, 0.6f, 0.45f, 0.3f) == true);
+	// The coarsest level covers everything, so only depth past the farthest pixel is hidden.
+	CHECK(occlusion.IsOccluded(0.0f, 0.0f, 1.0f, 1.0f, 0.89f) == false);
+	CHECK(occlusion.IsOccluded(0.0f, 0.0f, 1.0f, 1.0f, 0.95f) == true);
+}
+
+TEST_CASE(NearOccluderHidesBricksBehindIt)
+{
+	XMMATRIX viewProjection = TestViewProjection(0.0f);
+	VolumeCuller culler;
+	culler.SetWorldViewProjection(viewProjection);
+
+	// A wall 1 unit in front of the eye covers the whole screen.
+	std::vector<float> depth(64 * 64, ProjectedDepth(1.0f));
+	HiZOcclusionBuffer occlusion;
+	occlusion.Resize(4, 4);
+	occlusion.BuildFromDepth(depth.data(), 64, 64, viewProjection);
+
+	VolumeBrickBounds bricks[2] =
+	{
+		Brick(0.0f, 0.0f, 0.0f, 0.1f),		// 2 units away, behind the wall.
+		Brick(0.0f, 0.0f, -1.5f, 0.1f),		// 0.5 units away, in front of it.
+	};
+	uint8_t visibility[2] = {};
+	CullingStats stats = culler.Cull(bricks, 2, visibility, &occlusion);
+
+	CHECK(stats.occlusionCulled == 1);
+	CHECK(visibility[0] == 0);
+	CHECK(visibility[1] == 1);
+
+	// A cleared buffer sits at the far plane and hides nothing.
+	occlusion.Clear();
+	stats = culler.Cull(bricks, 2, visibility, &occlusion);
+	CHECK(stats.occlusionCulled == 0);
+	CHECK(stats.visible == 2);
+}
+
+TEST_CASE(OcclusionUsesTheMatrixTheDepthWasCapturedWith)
+{
+	// Depth read back late: captured with the camera at x = 0 it has a near wall over the left half of the
+	// screen only. The camera has since moved to x = 1.
+	XMMATRIX captured = TestViewProjection(0.0f);
+	std::vector<float> depth(64 * 64, 1.0f);
+	for (uint32_t y = 0; y < 64; ++y)
+	{
+		for (uint32_t x = 0; x < 32; ++x)
+		{
+			depth[y * 64 + x] = ProjectedDepth(1.0f);
+		}
+	}
+	HiZOcclusionBuffer occlusion;
+	occlusion.Resize(16, 16);
+	occlusion.BuildFromDepth(depth.data(), 64, 64, captured);
+
+	VolumeCuller culler;
+	culler.SetWorldViewProjection(TestViewProjection(1.0f));
+
+	// The second brick is on the open right half in the captured view but would land behind the wall if it were
+	// projected with the new camera's matrix.
+	VolumeBrickBounds bricks[2] =
+	{
+		Brick(-0.5f, 0.0f, 0.0f, 0.1f),
+		Brick(0.5f, 0.0f, 0.0f, 0.1f),
+	};
+	uint8_t visibility[2] = {};
+	CullingStats stats = culler.Cull(bricks, 2, visibility, &occlusion);
+
+	CHECK(stats.frustumCulled == 0);
+	CHECK(visibility[0] == 0);
+	CHECK(visibility[1] == 1);
+}
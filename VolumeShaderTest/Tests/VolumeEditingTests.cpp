@@ -0,0 +1,226 @@
+﻿#include "pch.h"
+#include "TestHarness.h"
+#include "VolumeEditing.h"
+#include <random>
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	bool Contains(const VoxelRegion& outer, const VoxelRegion& inner)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (inner.min[axis] < outer.min[axis] || inner.max[axis] > outer.max[axis])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ContainedInAny(const std::vector<VoxelRegion>& regions, const VoxelRegion& region)
+	{
+		for (const VoxelRegion& candidate : regions)
+		{
+			if (Contains(candidate, region))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool SameVoxels(const VolumeData& a, const VolumeData& b)
+	{
+		return a.width == b.width && a.height == b.height && a.depth == b.depth &&
+			std::equal(a.voxels.begin(), a.voxels.end(), b.voxels.begin());
+	}
+
+	void FillRandom(VolumeData& volume, uint32_t width, uint32_t height, uint32_t depth, uint32_t seed)
+	{
+		volume.Resize(width, height, depth);
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> values(0.0f, 1.0f);
+		for (float& value : volume.voxels)
+		{
+			value = values(random);
+		}
+	}
+}
+
+TEST_CASE(AbuttingBoxesMergeAndDistantOnesStayApart)
+{
+	DirtyRegionSet set;
+	set.Add(VoxelRegion());
+	CHECK(set.Empty());
+
+	set.Add(VoxelRegion(0, 0, 0, 8, 8, 8));
+	set.Add(VoxelRegion(8, 0, 0, 16, 8, 8));
+	REQUIRE(set.GetRegions().size() == 1);
+	CHECK(Contains(set.GetRegions()[0], VoxelRegion(0, 0, 0, 16, 8, 8)));
+	CHECK(set.GetVoxelCount() == 16 * 8 * 8);
+
+	// Joining these would upload almost 32 times the voxels they cover.
+	set.Add(VoxelRegion(100, 100, 100, 104, 104, 104));
+	CHECK(set.GetRegions().size() == 2);
+
+	// A box inside an existing one adds nothing.
+	set.Add(VoxelRegion(2, 2, 2, 4, 4, 4));
+	CHECK(set.GetRegions().size() == 2);
+	CHECK(set.GetVoxelCount() == 16 * 8 * 8 + 4 * 4 * 4);
+
+	set.Clear();
+	CHECK(set.Empty());
+}
+
+TEST_CASE(SlackBoundsTheExtraVoxels)
+{
+	// Two 4^3 boxes offset diagonally: the union is 6^3 = 216 for 2 * 64 - 8 = 120 covered voxels.
+	VoxelRegion a(0, 0, 0, 4, 4, 4);
+	VoxelRegion b(2, 2, 2, 6, 6, 6);
+
+	DirtyRegionSet tight(16, 0.5f);
+	tight.Add(a);
+	tight.Add(b);
+	CHECK(tight.GetRegions().size() == 2);
+
+	DirtyRegionSet loose(16, 1.0f);
+	loose.Add(a);
+	loose.Add(b);
+	REQUIRE(loose.GetRegions().size() == 1);
+	CHECK(loose.GetVoxelCount() == 216);
+}
+
+TEST_CASE(StrokeCollapsesWithinTheLimit)
+{
+	// A brush dragged along x leaves overlapping dabs; scattered dabs past the limit are forced together.
+	DirtyRegionSet stroke(4, 0.25f);
+	for (uint32_t i = 0; i < 40; ++i)
+	{
+		stroke.Add(VoxelRegion(10 + 2 * i, 20, 20, 18 + 2 * i, 28, 28));
+	}
+	CHECK(stroke.GetRegions().size() == 1);
+	CHECK(stroke.GetVoxelCount() == 86 * 8 * 8);
+
+	DirtyRegionSet scattered(4, 0.25f);
+	std::vector<VoxelRegion> added;
+	std::mt19937 random(5);
+	std::uniform_int_distribution<uint32_t> positions(0, 240);
+	for (int i = 0; i < 50; ++i)
+	{
+		uint32_t x = positions(random), y = positions(random), z = positions(random);
+		added.push_back(VoxelRegion(x, y, z, x + 6, y + 6, z + 6));
+		scattered.Add(added.back());
+		CHECK(scattered.GetRegions().size() <= 4);
+	}
+
+	// Merging only ever grows boxes, so every added box survives whole inside one of them.
+	bool covered = true;
+	for (const VoxelRegion& region : added)
+	{
+		covered = covered && ContainedInAny(scattered.GetRegions(), region);
+	}
+	CHECK(covered);
+}
+
+TEST_CASE(MipUpdateMatchesRebuild)
+{
+	// Odd sizes exercise the clamped edge texels and the levels that stop shrinking along one axis.
+	VolumeMipChain chain;
+	FillRandom(chain.GetBase(), 13, 10, 7, 3);
+	chain.Build();
+	REQUIRE(chain.GetLevelCount() == 4);
+	std::vector<VolumeData> before;
+	for (uint32_t level = 0; level < chain.GetLevelCount(); ++level)
+	{
+		before.push_back(chain.GetLevel(level));
+	}
+
+	VoxelRegion edit(5, 3, 2, 12, 9, 4);
+	VolumeData& base = chain.GetBase();
+	for (uint32_t z = edit.min[2]; z < edit.max[2]; ++z)
+	{
+		for (uint32_t y = edit.min[1]; y < edit.max[1]; ++y)
+		{
+			for (uint32_t x = edit.min[0]; x < edit.max[0]; ++x)
+			{
+				base.voxels[base.Index(x, y, z) + 3] = 0.0f;
+			}
+		}
+	}
+	std::vector<VoxelRegion> levelRegions;
+	chain.Update(edit, levelRegions);
+	REQUIRE(levelRegions.size() == chain.GetLevelCount());
+
+	VolumeMipChain rebuilt;
+	rebuilt.GetBase() = chain.GetLevel(0);
+	rebuilt.Build();
+	for (uint32_t level = 1; level < chain.GetLevelCount(); ++level)
+	{
+		const VolumeData& updated = chain.GetLevel(level);
+		CHECK(SameVoxels(updated, rebuilt.GetLevel(level)));
+
+		// Texels outside the reported box kept their old values.
+		bool outsideUnchanged = true;
+		for (uint32_t z = 0; z < updated.depth; ++z)
+		{
+			for (uint32_t y = 0; y < updated.height; ++y)
+			{
+				for (uint32_t x = 0; x < updated.width; ++x)
+				{
+					if (Contains(levelRegions[level], VoxelRegion(x, y, z, x + 1, y + 1, z + 1)))
+					{
+						continue;
+					}
+					size_t index = updated.Index(x, y, z);
+					outsideUnchanged = outsideUnchanged && std::equal(&updated.voxels[index], &updated.voxels[index] + 4, &before[level].voxels[index]);
+				}
+			}
+		}
+		CHECK(outsideUnchanged);
+	}
+}
+
+TEST_CASE(CommitMatchesRebuild)
+{
+	VolumeEditor editor;
+	GenerateFogSphereVolume(editor.GetVolume(), 40);
+	editor.Rebuild();
+
+	VolumeBrush brush;
+	brush.center = XMFLOAT3(12.0f, 20.0f, 18.0f);
+	brush.extents = XMFLOAT3(5.0f, 5.0f, 5.0f);
+	editor.Apply(brush);
+	brush.mode = BrushMode::Subtract;
+	brush.shape = BrushShape::Box;
+	brush.center = XMFLOAT3(26.0f, 14.0f, 20.0f);
+	editor.Apply(brush);
+	brush.mode = BrushMode::Paint;
+	brush.color = XMFLOAT3(1.0f, 0.2f, 0.1f);
+	brush.center = XMFLOAT3(20.0f, 28.0f, 8.0f);
+	editor.Apply(brush);
+	REQUIRE(editor.HasPendingEdits());
+
+	VolumeEditChanges changes;
+	editor.Commit(changes);
+	CHECK(!editor.HasPendingEdits());
+	CHECK(changes.levels.size() == editor.GetMipChain().GetLevelCount());
+	CHECK(!changes.levels[0].empty() && !changes.gradients.empty());
+
+	VolumeEditor reference;
+	reference.GetVolume() = editor.GetVolume();
+	reference.Rebuild();
+	for (uint32_t level = 0; level < editor.GetMipChain().GetLevelCount(); ++level)
+	{
+		CHECK(SameVoxels(editor.GetMipChain().GetLevel(level), reference.GetMipChain().GetLevel(level)));
+	}
+	CHECK(editor.GetGradients() == reference.GetGradients());
+	CHECK(editor.GetDistanceField().occupied == reference.GetDistanceField().occupied);
+	CHECK(editor.GetDistanceField().distance == reference.GetDistanceField().distance);
+
+	// A commit with nothing pending reports no regions.
+	editor.Commit(changes);
+	CHECK(changes.levels[0].empty() && changes.gradients.empty() && !changes.distanceField);
+}
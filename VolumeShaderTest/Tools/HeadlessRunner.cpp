@@ -0,0 +1,479 @@
+﻿#include "pch.h"
+#include "BatchRenderer.h"
+#include "Benchmark.h"
+#include "BrickContainer.h"
+#include "CpuRenderBackend.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Command-line front end for the headless backends: renders without a window, device or GPU on any
+// platform the CMake build supports.
+
+using namespace VolumeShaderTest;
+using namespace DirectX;
+
+namespace
+{
+	// --name value pairs and bare --flags after the command name.
+	class Arguments
+	{
+	public:
+		Arguments(int argc, char** argv, int first)
+		{
+			for (int i = first; i < argc; ++i)
+			{
+				m_items.push_back(argv[i]);
+			}
+		}
+
+		bool Has(const char* name) const
+		{
+			for (const std::string& item : m_items)
+			{
+				if (item == name)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		std::string Get(const char* name, const char* fallback) const
+		{
+			for (size_t i = 0; i + 1 < m_items.size(); ++i)
+			{
+				if (m_items[i] == name)
+				{
+					return m_items[i + 1];
+				}
+			}
+			return fallback;
+		}
+
+		uint32_t GetUInt(const char* name, uint32_t fallback) const
+		{
+			std::string value = Get(name, "");
+			return value.empty() ? fallback : static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+		}
+
+		double GetDouble(const char* name, double fallback) const
+		{
+			std::string value = Get(name, "");
+			return value.empty() ? fallback : std::strtod(value.c_str(), nullptr);
+		}
+
+	private:
+		std::vector<std::string> m_items;
+	};
+
+	// Command-line paths are narrow; DX::FilePath is wide on Windows.
+	DX::FilePath ToFilePath(const std::string& path)
+	{
+		return DX::FilePath(path.begin(), path.end());
+	}
+
+	bool ParseCompositeMode(const std::string& name, CompositeMode& mode)
+	{
+		static const struct { const char* name; CompositeMode mode; } modes[] =
+		{
+			{ "alpha", CompositeMode::Alpha },
+			{ "mip", CompositeMode::MaximumIntensity },
+			{ "minip", CompositeMode::MinimumIntensity },
+			{ "average", CompositeMode::AverageIntensity },
+			{ "firsthit", CompositeMode::FirstHit },
+		};
+		for (const auto& entry : modes)
+		{
+			if (name == entry.name)
+			{
+				mode = entry.mode;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// --raw file --dims WxHxD loads RGBA float voxels; otherwise --volume-size generates the fog sphere.
+	std::shared_ptr<VolumeData> LoadVolume(const Arguments& args)
+	{
+		std::shared_ptr<VolumeData> volume = std::make_shared<VolumeData>();
+		std::string rawPath = args.Get("--raw", "");
+		if (rawPath.empty())
+		{
+			GenerateFogSphereVolume(*volume, args.GetUInt("--volume-size", 128));
+			return volume;
+		}
+
+		unsigned width = 0, height = 0, depth = 0;
+		if (std::sscanf(args.Get("--dims", "").c_str(), "%ux%ux%u", &width, &height, &depth) != 3)
+		{
+			std::fprintf(stderr, "--raw needs --dims WxHxD\n");
+			return nullptr;
+		}
+
+		bool valid = false;
+		DX::FileView view = DX::OpenFileView(ToFilePath(rawPath), valid);
+		if (!valid || !LoadRawVolume(view, width, height, depth, *volume))
+		{
+			std::fprintf(stderr, "cannot load %s as %ux%ux%u RGBA float voxels\n", rawPath.c_str(), width, height, depth);
+			return nullptr;
+		}
+		return volume;
+	}
+
+	bool ApplyRenderOptions(const Arguments& args, IRenderBackend& backend)
+	{
+		RenderOptions options;
+		options.shadows = !args.Has("--no-shadows");
+		options.emptySpaceSkipping = args.Has("--skipping");
+		if (!ParseCompositeMode(args.Get("--composite", "alpha"), options.composite))
+		{
+			std::fprintf(stderr, "unknown --composite mode\n");
+			return false;
+		}
+		if (!backend.SetOptions(options))
+		{
+			std::fprintf(stderr, "the %s backend cannot render these options\n", backend.GetName());
+			return false;
+		}
+		return true;
+	}
+
+	CpuRenderBackendSettings BackendSettings(const Arguments& args)
+	{
+		CpuRenderBackendSettings settings;
+		settings.width = args.GetUInt("--width", 512);
+		settings.height = args.GetUInt("--height", 512);
+		settings.threadCount = args.GetUInt("--threads", 0);
+		settings.steps = static_cast<int>(args.GetUInt("--steps", 128));
+		return settings;
+	}
+
+	// Renders one frame at a point of a benchmark path and writes it as a TGA.
+	int RenderCommand(const Arguments& args)
+	{
+		std::shared_ptr<VolumeData> volume = LoadVolume(args);
+		if (!volume)
+		{
+			return 1;
+		}
+
+		CpuRenderBackend backend(BackendSettings(args));
+		backend.SetVolume(volume);
+		if (!ApplyRenderOptions(args, backend))
+		{
+			return 1;
+		}
+
+		std::string pathName = args.Get("--path", "orbit");
+		std::vector<BenchmarkPath> paths = GetDefaultBenchmarkPaths();
+		const BenchmarkPath* path = nullptr;
+		for (const BenchmarkPath& candidate : paths)
+		{
+			path = (candidate.name == pathName) ? &candidate : path;
+		}
+		if (!path)
+		{
+			std::fprintf(stderr, "unknown --path %s\n", pathName.c_str());
+			return 1;
+		}
+
+		RenderFrameStats stats;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		backend.RenderFrame(path->Evaluate(args.GetDouble("--time", 0.0)), args.GetUInt("--frame", 0), stats);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::string output = args.Get("--output", "frame.tga");
+		if (!WriteTga(ToFilePath(output), backend.GetImage()))
+		{
+			std::fprintf(stderr, "cannot write %s\n", output.c_str());
+			return 1;
+		}
+
+		std::printf("%s: %ux%u in %.2f ms, %.1f samples per pixel\n", output.c_str(), backend.GetWidth(), backend.GetHeight(), milliseconds, stats.samplesPerPixel);
+		return 0;
+	}
+
+	// Reads a path script with the ParseBenchmarkPaths format.
+	bool LoadBenchmarkScript(const std::string& scriptPath, std::vector<BenchmarkPath>& paths)
+	{
+		bool valid = false;
+		DX::FileView view = DX::OpenFileView(ToFilePath(scriptPath), valid);
+		if (!valid)
+		{
+			std::fprintf(stderr, "cannot read %s\n", scriptPath.c_str());
+			return false;
+		}
+
+		std::string error;
+		if (!ParseBenchmarkPaths(std::string(reinterpret_cast<const char*>(view.Data()), view.Size()), paths, &error))
+		{
+			std::fprintf(stderr, "%s: %s\n", scriptPath.c_str(), error.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// Plays the default paths, or those of --script, on the CPU backend with a deterministic timer and writes the
+	// same JSON report as the app's benchmark mode.
+	int BenchmarkCommand(const Arguments& args)
+	{
+		std::shared_ptr<VolumeData> volume = LoadVolume(args);
+		if (!volume)
+		{
+			return 1;
+		}
+
+		CpuRenderBackend backend(BackendSettings(args));
+		backend.SetVolume(volume);
+		if (!ApplyRenderOptions(args, backend))
+		{
+			return 1;
+		}
+
+		std::vector<BenchmarkPath> paths;
+		std::string scriptPath = args.Get("--script", "");
+		if (scriptPath.empty())
+		{
+			paths = GetDefaultBenchmarkPaths();
+		}
+		else if (!LoadBenchmarkScript(scriptPath, paths))
+		{
+			return 1;
+		}
+
+		std::string pathName = args.Get("--path", "");
+		if (!pathName.empty())
+		{
+			paths.erase(std::remove_if(paths.begin(), paths.end(), [&](const BenchmarkPath& path) { return path.name != pathName; }), paths.end());
+		}
+		if (paths.empty())
+		{
+			std::fprintf(stderr, pathName.empty() ? "no benchmark path to run\n" : "unknown --path %s\n", pathName.c_str());
+			return 1;
+		}
+
+		BenchmarkSettings settings;
+		settings.warmupFrames = args.GetUInt("--warmup", settings.warmupFrames);
+		settings.measuredFrames = args.GetUInt("--frames", settings.measuredFrames);
+		settings.frameSeconds = 1.0 / std::max(1.0, args.GetDouble("--fps", 60.0));
+
+		BenchmarkReport report = RunBenchmark(backend, settings, paths, args.Get("--label", "headless"));
+		for (const BenchmarkPathResult& result : report.paths)
+		{
+			BenchmarkFrameTimeSummary summary = SummarizeFrameTimes(result.frames);
+			std::printf("%s: %zu frames, p50 %.2f ms, p95 %.2f ms, max %.2f ms\n",
+				result.name.c_str(), result.frames.size(), summary.p50, summary.p95, summary.max);
+		}
+
+		std::string output = args.Get("--output", "benchmark.json");
+		if (!WriteBenchmarkJson(ToFilePath(output), report))
+		{
+			std::fprintf(stderr, "cannot write %s\n", output.c_str());
+			return 1;
+		}
+		std::printf("wrote %s\n", output.c_str());
+		return 0;
+	}
+
+	// Renders --count views on an orbit around the volume through a BatchRenderer and reports the throughput and how
+	// often the bounded queue pushed back on the producer.
+	int BatchCommand(const Arguments& args)
+	{
+		std::shared_ptr<VolumeData> volume = LoadVolume(args);
+		if (!volume)
+		{
+			return 1;
+		}
+
+		RaymarchSettings settings;
+		settings.steps = static_cast<int>(args.GetUInt("--steps", 128));
+		settings.shadows = !args.Has("--no-shadows");
+		if (!ParseCompositeMode(args.Get("--composite", "alpha"), settings.composite))
+		{
+			std::fprintf(stderr, "unknown --composite mode\n");
+			return 1;
+		}
+
+		uint32_t count = args.GetUInt("--count", 64);
+		uint32_t width = args.GetUInt("--width", 256);
+		uint32_t height = args.GetUInt("--height", 256);
+		float pitch = static_cast<float>(args.GetDouble("--pitch", 0.3));
+		float distance = static_cast<float>(args.GetDouble("--distance", 1.8));
+		std::string outputDirectory = args.Get("--output-dir", "");
+		if (count == 0 || width == 0 || height == 0)
+		{
+			std::fprintf(stderr, "--count, --width and --height must be positive\n");
+			return 1;
+		}
+
+		BatchSettings batchSettings;
+		batchSettings.threadCount = args.GetUInt("--threads", 0);
+		batchSettings.queueCapacity = args.GetUInt("--queue", 0);
+		BatchStats stats;
+		{
+			BatchRenderer renderer(batchSettings);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				BatchJob job;
+				job.volume = volume;
+				job.settings = settings;
+				job.settings.frameIndex = i;
+				job.width = width;
+				job.height = height;
+				job.camera = MakeOrbitCamera(2.0f * XM_PI * i / count, pitch, distance, static_cast<float>(width) / height, XMFLOAT3(2.0f, 1.5f, 0.0f));
+				if (!outputDirectory.empty())
+				{
+					char name[32];
+					std::snprintf(name, sizeof(name), "/frame_%04u.tga", i);
+					job.outputPath = ToFilePath(outputDirectory + name);
+				}
+				renderer.Submit(std::move(job));
+			}
+			renderer.WaitIdle();
+			stats = renderer.GetStats();
+			std::printf("%llu images of %ux%u on %u thread%s in %.2f s: %.2f images/s, %.1f samples per pixel\n",
+				static_cast<unsigned long long>(stats.completed), width, height, renderer.GetThreadCount(),
+				renderer.GetThreadCount() == 1 ? "" : "s", stats.seconds,
+				stats.imagesPerSecond, static_cast<double>(stats.samples) / (static_cast<double>(width) * height * std::max<uint64_t>(1, stats.completed)));
+		}
+		std::printf("%llu of %llu submits waited for room in the queue\n",
+			static_cast<unsigned long long>(stats.blockedSubmits), static_cast<unsigned long long>(stats.submitted));
+		if (stats.failedWrites > 0)
+		{
+			std::fprintf(stderr, "%llu images could not be written to %s\n", static_cast<unsigned long long>(stats.failedWrites), outputDirectory.c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	bool ParseBrickFilters(const std::string& name, uint8_t& filters)
+	{
+		static const struct { const char* name; uint8_t filters; } options[] =
+		{
+			{ "none", BrickFilterNone },
+			{ "delta", BrickFilterDelta },
+			{ "bitplane", BrickFilterBitPlane },
+			{ "both", BrickFilterDelta | BrickFilterBitPlane },
+		};
+		for (const auto& option : options)
+		{
+			if (name == option.name)
+			{
+				filters = option.filters;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Converts a 16-bit RAW volume into a brick container and reports how well it compressed.
+	int ConvertCommand(const Arguments& args)
+	{
+		std::string rawPath = args.Get("--raw", "");
+		std::string output = args.Get("--output", "");
+		unsigned width = 0, height = 0, depth = 0;
+		if (rawPath.empty() || output.empty() || std::sscanf(args.Get("--dims", "").c_str(), "%ux%ux%u", &width, &height, &depth) != 3)
+		{
+			std::fprintf(stderr, "convert needs --raw FILE --dims WxHxD --output FILE\n");
+			return 1;
+		}
+
+		BrickContainerSettings settings;
+		settings.brickSize = args.GetUInt("--brick-size", settings.brickSize);
+		settings.maxLevels = args.GetUInt("--levels", settings.maxLevels);
+		if (settings.brickSize == 0 || !ParseBrickFilters(args.Get("--filters", "both"), settings.filters))
+		{
+			std::fprintf(stderr, "--brick-size must be positive and --filters one of none, delta, bitplane, both\n");
+			return 1;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (!ConvertRawToBrickContainer(ToFilePath(rawPath), ToFilePath(output), width, height, depth, settings))
+		{
+			std::fprintf(stderr, "cannot convert %s as %ux%ux%u 16-bit voxels to %s\n", rawPath.c_str(), width, height, depth, output.c_str());
+			return 1;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		BrickContainerReader reader;
+		if (!reader.Open(ToFilePath(output)))
+		{
+			std::fprintf(stderr, "%s does not read back\n", output.c_str());
+			return 1;
+		}
+
+		const BrickContainerHeader& header = reader.GetHeader();
+		uint64_t compressed = 0;
+		uint32_t stored = 0;
+		for (uint32_t i = 0; i < header.brickCount; ++i)
+		{
+			compressed += reader.GetBrickEntry(i).size;
+			stored += (reader.GetBrickEntry(i).codec == BrickCodec::Stored) ? 1 : 0;
+		}
+		double rawBytes = static_cast<double>(width) * height * depth * sizeof(uint16_t);
+		std::printf("%s: %u levels, %u bricks (%u stored), %.2f MB of bricks for %.2f MB of level 0 voxels (%.2fx) in %.2f s, %.1f MB/s\n",
+			output.c_str(), header.levelCount, header.brickCount, stored, compressed / 1e6, rawBytes / 1e6,
+			rawBytes / std::max<double>(1.0, static_cast<double>(compressed)), seconds, rawBytes / 1e6 / seconds);
+		return 0;
+	}
+
+	struct Command
+	{
+		const char* name;
+		int (*run)(const Arguments& args);
+		const char* usage;
+	};
+
+	const Command commands[] =
+	{
+		{ "render", &RenderCommand,
+			"render [--width N] [--height N] [--steps N] [--threads N] [--volume-size N | --raw FILE --dims WxHxD]\n"
+			"       [--path orbit|dolly|grazing] [--time SECONDS] [--frame N] [--skipping] [--no-shadows]\n"
+			"       [--composite alpha|mip|minip|average|firsthit] [--output FILE.tga]" },
+		{ "batch", &BatchCommand,
+			"batch [--count N] [--width N] [--height N] [--steps N] [--threads N] [--queue N]\n"
+			"       [--volume-size N | --raw FILE --dims WxHxD] [--pitch RADIANS] [--distance D] [--no-shadows]\n"
+			"       [--composite alpha|mip|minip|average|firsthit] [--output-dir DIR]" },
+		{ "benchmark", &BenchmarkCommand,
+			"benchmark [--width N] [--height N] [--steps N] [--threads N] [--volume-size N | --raw FILE --dims WxHxD]\n"
+			"       [--script FILE] [--path NAME] [--warmup N] [--frames N] [--fps N] [--skipping] [--no-shadows]\n"
+			"       [--composite alpha|mip|minip|average|firsthit] [--label TEXT] [--output FILE.json]" },
+		{ "convert", &ConvertCommand,
+			"convert --raw FILE --dims WxHxD --output FILE [--brick-size N] [--levels N]\n"
+			"       [--filters none|delta|bitplane|both]" },
+	};
+
+	void PrintUsage()
+	{
+		std::fprintf(stderr, "usage: VolumeShaderTestHeadless <command> [options]\n");
+		for (const Command& command : commands)
+		{
+			std::fprintf(stderr, "  %s\n", command.usage);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	for (const Command& command : commands)
+	{
+		if (std::strcmp(argv[1], command.name) == 0)
+		{
+			return command.run(Arguments(argc, argv, 2));
+		}
+	}
+
+	PrintUsage();
+	return 2;
+}
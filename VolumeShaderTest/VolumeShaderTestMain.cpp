@@ -19,6 +19,8 @@ VolumeShaderTestMain::VolumeShaderTestMain(const std::shared_ptr<DX::DeviceResou
 
 	m_fpsTextRenderer = std::unique_ptr<SampleFpsTextRenderer>(new SampleFpsTextRenderer(m_deviceResources));
 
+	m_renderBackend = std::unique_ptr<D3D11RenderBackend>(new D3D11RenderBackend(m_deviceResources, *m_sceneRenderer));
+
 	// TODO: Change the timer settings if you want something other than the default variable timestep mode.
 	// e.g. for 60 FPS fixed timestep update logic, call:
 	/*
@@ -55,6 +57,12 @@ void VolumeShaderTestMain::StartRenderLoop()
 		while (action->Status == AsyncStatus::Started)
 		{
 			critical_section::scoped_lock lock(m_criticalSection);
+			if (m_benchmark != nullptr)
+			{
+				StepBenchmark();
+				continue;
+			}
+
 			Update();
 			if (Render())
 			{
@@ -125,6 +133,23 @@ bool VolumeShaderTestMain::Render()
 	return true;
 }
 
+// Renders the next benchmark frame, which the backend presents, and writes the report once every path has been measured.
+void VolumeShaderTestMain::StepBenchmark()
+{
+	RunBenchmarkFrame(*m_benchmark, m_timer, *m_renderBackend);
+	if (!m_benchmark->IsFinished())
+	{
+		return;
+	}
+
+	WriteBenchmarkJson(m_benchmarkOutputPath, MakeBenchmarkReport(*m_benchmark, *m_renderBackend, m_benchmarkLabel));
+
+	// Back to the animation, without a catch-up step for the time the benchmark took.
+	m_benchmark.reset();
+	m_timer.SetDeterministic(false);
+	m_timer.ResetElapsedTime();
+}
+
 // Notifies renderers that device resources need to be released.
 void VolumeShaderTestMain::OnDeviceLost()
 {
@@ -4,6 +4,8 @@
 #include "Common\DeviceResources.h"
 #include "Content\Sample3DSceneRenderer.h"
 #include "Content\SampleFpsTextRenderer.h"
+#include "Content\D3D11RenderBackend.h"
+#include "Content\Benchmark.h"
 
 // Renders Direct2D and 3D content on the screen.
 namespace VolumeShaderTest
@@ -18,6 +20,84 @@ namespace VolumeShaderTest
 		void TrackingUpdate(float positionX) { m_pointerLocationX = positionX; }
 		void StopTracking() { m_sceneRenderer->StopTracking(); }
 		bool IsTracking() { return m_sceneRenderer->IsTracking(); }
+		void SetResolutionScale(uint32 scale) { m_sceneRenderer->SetResolutionScale(scale); }
+		void SetTemporalAccumulation(bool enabled, uint32 stepsPerFrame) { m_sceneRenderer->SetTemporalAccumulation(enabled, stepsPerFrame); }
+		void SetInterleavedMarching(uint32 patternSize) { m_sceneRenderer->SetInterleavedMarching(patternSize); }
+		void SetImportanceSampling(bool enabled, const ImportanceSettings& settings) { m_sceneRenderer->SetImportanceSampling(enabled, settings); }
+		void SetShadowsEnabled(bool enabled) { m_sceneRenderer->SetShadowsEnabled(enabled); }
+		void SetEarlyOutThreshold(uint32 percent) { m_sceneRenderer->SetEarlyOutThreshold(percent); }
+		void SetOutOfCoreVolume(const std::shared_ptr<OutOfCoreVolume>& volume, uint64 poolBytes = Sample3DSceneRenderer::DefaultBrickPoolBytes) { m_sceneRenderer->SetOutOfCoreVolume(volume, poolBytes); }
+		void SetChannelVolume(const std::shared_ptr<const ChannelVolume>& volume, const std::vector<ChannelWindow>& windows) { m_sceneRenderer->SetChannelVolume(volume, windows); }
+		void SetStereo(bool enabled, const StereoRig& rig) { m_sceneRenderer->SetStereo(enabled, rig); }
+		void SetChannelTransferFunction(uint32 channel, const std::vector<XMFLOAT4>& table, float weight) { m_sceneRenderer->SetChannelTransferFunction(channel, table, weight); }
+		void SetGradientLighting(bool enabled, float ambient, float magnitudeGain) { m_sceneRenderer->SetGradientLighting(enabled, ambient, magnitudeGain); }
+		void SetEmptySpaceSkipping(bool enabled) { m_sceneRenderer->SetEmptySpaceSkipping(enabled); }
+		void SetIsosurface(bool enabled, float threshold) { m_sceneRenderer->SetIsosurface(enabled, threshold); }
+		void SetCompositeMode(CompositeMode mode, float firstHitThreshold) { m_sceneRenderer->SetCompositeMode(mode, firstHitThreshold); }
+		void SetClipPlanes(const std::vector<XMFLOAT4>& planes) { m_sceneRenderer->SetClipPlanes(planes); }
+		void SetCropBox(const XMFLOAT3& center, const XMFLOAT3& halfExtents, const XMFLOAT4& orientation) { m_sceneRenderer->SetCropBox(center, halfExtents, orientation); }
+		void ClearCropBox() { m_sceneRenderer->ClearCropBox(); }
+		// Editing swaps textures and brush dabs change voxels the render loop reads, so both run under its lock.
+		void SetVolumeEditing(bool enabled)
+		{
+			Concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			m_sceneRenderer->SetVolumeEditing(enabled);
+		}
+
+		VoxelRegion ApplyBrush(const VolumeBrush& brush)
+		{
+			Concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			return m_sceneRenderer->ApplyBrush(brush);
+		}
+
+		void BeginBrushStroke()
+		{
+			Concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			m_sceneRenderer->BeginBrushStroke();
+		}
+
+		void EndBrushStroke()
+		{
+			Concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			m_sceneRenderer->EndBrushStroke();
+		}
+
+		bool UndoVolumeEdit()
+		{
+			Concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			return m_sceneRenderer->UndoVolumeEdit();
+		}
+
+		bool RedoVolumeEdit()
+		{
+			Concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			return m_sceneRenderer->RedoVolumeEdit();
+		}
+
+		// Recreates the volume textures, so it also runs under the render loop's lock.
+		void SetVolume(const std::shared_ptr<const VolumeData>& volume)
+		{
+			Concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			m_sceneRenderer->SetVolume(volume);
+		}
+
+		// Plays the paths through the render backend with a deterministic timer in place of the animation,
+		// measuring each frame from the draw through Present, and writes the results as JSON to outputPath after
+		// the last path.
+		void StartBenchmark(const BenchmarkSettings& settings, const std::vector<BenchmarkPath>& paths, const DX::FilePath& outputPath, const std::string& label)
+		{
+			Concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			m_benchmark.reset(new BenchmarkRunner(settings, paths));
+			m_benchmark->ConfigureTimer(m_timer);
+			m_benchmarkOutputPath = outputPath;
+			m_benchmarkLabel = label;
+		}
+
+		bool IsBenchmarkRunning()
+		{
+			Concurrency::critical_section::scoped_lock lock(m_criticalSection);
+			return m_benchmark != nullptr;
+		}
 		void StartRenderLoop();
 		void StopRenderLoop();
 		Concurrency::critical_section& GetCriticalSection() { return m_criticalSection; }
@@ -30,6 +110,7 @@ namespace VolumeShaderTest
 		void ProcessInput();
 		void Update();
 		bool Render();
+		void StepBenchmark();
 
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
@@ -38,6 +119,9 @@ namespace VolumeShaderTest
 		std::unique_ptr<Sample3DSceneRenderer> m_sceneRenderer;
 		std::unique_ptr<SampleFpsTextRenderer> m_fpsTextRenderer;
 
+		// The scene renderer seen through the platform neutral backend interface.
+		std::unique_ptr<D3D11RenderBackend> m_renderBackend;
+
 		Windows::Foundation::IAsyncAction^ m_renderLoopWorker;
 		Concurrency::critical_section m_criticalSection;
 
@@ -46,5 +130,10 @@ namespace VolumeShaderTest
 
 		// Track current input pointer position.
 		float m_pointerLocationX;
+
+		// Scripted benchmark in progress, if any.
+		std::unique_ptr<BenchmarkRunner> m_benchmark;
+		DX::FilePath m_benchmarkOutputPath;
+		std::string m_benchmarkLabel;
 	};
 }
\ No newline at end of file